@@ -0,0 +1,679 @@
+/*
+*  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are
+*  met:
+*    * Redistributions of source code must retain the above copyright
+*      notice, this list of conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above
+*      copyright notice, this list of conditions and the following
+*      disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its
+*      contributors may be used to endorse or promote products derived
+*      from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+*  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+*  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+*  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+*  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+*  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+*  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+*  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+*  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+*  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * @file    AudioBufferPool.hpp
+ *
+ * @brief   AudioBufferPool keeps a fixed set of audio buffers that are recycled across read and
+ *          write operations of streams and transcoders, and TranscodeSession drives a transcoder
+ *          with pipelined reads and writes using such pools.
+ *
+ * @note    Eval: This is a new API and is being evaluated. It is subject to change
+ *          and could break backwards compatibility.
+ */
+
+#ifndef AUDIOBUFFERPOOL_HPP
+#define AUDIOBUFFERPOOL_HPP
+
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/audio/AudioDefines.hpp>
+#include <telux/audio/AudioListener.hpp>
+#include <telux/audio/AudioManager.hpp>
+#include <telux/audio/AudioTranscoder.hpp>
+
+namespace telux {
+
+namespace audio {
+/** @addtogroup telematics_audio_stream
+ * @{ */
+
+/**
+ * @brief   Buffer whose memory is owned by an AudioBufferPool. It is a stream buffer, and
+ *          therefore also an audio buffer, so the same buffer can be captured into, transcoded
+ *          and played back without copying it.
+ */
+class PooledAudioBuffer : public IStreamBuffer {
+public:
+    PooledAudioBuffer(uint8_t *data, size_t minSize, size_t maxSize)
+       : data_(data)
+       , minSize_(minSize)
+       , maxSize_(maxSize) {
+    }
+
+    size_t getMinSize() override {
+        return minSize_;
+    }
+
+    size_t getMaxSize() override {
+        return maxSize_;
+    }
+
+    uint8_t *getRawBuffer() override {
+        return data_;
+    }
+
+    uint32_t getDataSize() override {
+        return dataSize_;
+    }
+
+    void setDataSize(uint32_t size) override {
+        dataSize_ = size;
+    }
+
+    telux::common::Status reset() override {
+        dataSize_ = 0;
+        return telux::common::Status::SUCCESS;
+    }
+
+private:
+    uint8_t *data_;
+    size_t minSize_;
+    size_t maxSize_;
+    uint32_t dataSize_ = 0;
+};
+
+/**
+ * @brief   AudioBufferPool holds a fixed number of buffers allocated once, either from its own
+ *          memory or from a buffer factory such as ITranscoder::getWriteBuffer() or
+ *          IAudioPlayStream::getStreamBuffer().
+ *
+ *          acquire() hands out a free buffer without allocating memory. A buffer returns to the
+ *          pool when the last std::shared_ptr to it outside the pool is released, e.g. once the
+ *          completion callback of the operation using it has run. Buffers are reset when they
+ *          are acquired.
+ *
+ *          BufferT is IStreamBuffer for stream operations or IAudioBuffer for transcoder
+ *          operations. A pool of IStreamBuffer with its own memory serves both, as an
+ *          std::shared_ptr<IStreamBuffer> converts to std::shared_ptr<IAudioBuffer>.
+ *
+ *          The pool is thread safe.
+ */
+template <typename BufferT>
+class AudioBufferPool {
+public:
+    using BufferFactory = std::function<std::shared_ptr<BufferT>()>;
+
+    /**
+     * Creates a pool of count buffers of maxSize bytes in one block of memory.
+     *
+     * @param [in] count     Number of buffers
+     * @param [in] maxSize   Size of each buffer in bytes
+     * @param [in] minSize   Value reported by IAudioBuffer::getMinSize()
+     *
+     * @returns the pool, or nullptr if count or maxSize is 0.
+     */
+    static std::shared_ptr<AudioBufferPool> create(uint32_t count, size_t maxSize,
+            size_t minSize = 0) {
+        if (count == 0 || maxSize == 0) {
+            return nullptr;
+        }
+        std::shared_ptr<AudioBufferPool> pool(new AudioBufferPool());
+        // Buffers start on separate cache lines
+        const size_t stride = (maxSize + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        pool->memory_.resize(stride * count + CACHE_LINE);
+        uintptr_t base = reinterpret_cast<uintptr_t>(pool->memory_.data());
+        uint8_t *data = pool->memory_.data() + (CACHE_LINE - base % CACHE_LINE) % CACHE_LINE;
+        for (uint32_t i = 0; i < count; ++i) {
+            pool->buffers_.push_back(
+                std::make_shared<PooledAudioBuffer>(data + i * stride, minSize, maxSize));
+        }
+        return pool;
+    }
+
+    /**
+     * Creates a pool of count buffers obtained from factory.
+     *
+     * @returns the pool, or nullptr if factory fails to provide count buffers.
+     */
+    static std::shared_ptr<AudioBufferPool> create(uint32_t count, BufferFactory factory) {
+        if (count == 0 || !factory) {
+            return nullptr;
+        }
+        std::shared_ptr<AudioBufferPool> pool(new AudioBufferPool());
+        for (uint32_t i = 0; i < count; ++i) {
+            std::shared_ptr<BufferT> buffer = factory();
+            if (!buffer) {
+                return nullptr;
+            }
+            pool->buffers_.push_back(buffer);
+        }
+        return pool;
+    }
+
+    /**
+     * Gets a free buffer.
+     *
+     * @returns a reset buffer, or nullptr if all buffers are in use.
+     */
+    std::shared_ptr<BufferT> acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t count = buffers_.size();
+        for (size_t i = 0; i < count; ++i) {
+            std::shared_ptr<BufferT> &buffer = buffers_[next_];
+            next_ = (next_ + 1 == count) ? 0 : next_ + 1;
+            // Only the pool holds it; no reference can be created concurrently as references
+            // are only handed out here
+            if (buffer.use_count() == 1) {
+                buffer->reset();
+                ++acquired_;
+                return buffer;
+            }
+        }
+        ++exhausted_;
+        return nullptr;
+    }
+
+    /**
+     * Number of buffers in the pool.
+     */
+    uint32_t getCount() const {
+        return static_cast<uint32_t>(buffers_.size());
+    }
+
+    /**
+     * Number of buffers not in use. Buffers may be released concurrently.
+     */
+    uint32_t getFreeCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t free = 0;
+        for (auto &buffer : buffers_) {
+            free += (buffer.use_count() == 1) ? 1 : 0;
+        }
+        return free;
+    }
+
+    /**
+     * Number of successful acquire() calls.
+     */
+    uint64_t getAcquireCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return acquired_;
+    }
+
+    /**
+     * Number of acquire() calls that found no free buffer.
+     */
+    uint64_t getExhaustedCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return exhausted_;
+    }
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    AudioBufferPool() {
+    }
+
+    std::vector<uint8_t> memory_;
+    std::vector<std::shared_ptr<BufferT>> buffers_;
+    size_t next_ = 0;
+    uint64_t acquired_ = 0;
+    uint64_t exhausted_ = 0;
+    mutable std::mutex mutex_;
+};
+
+template <typename BufferT>
+const size_t AudioBufferPool<BufferT>::CACHE_LINE;
+
+/**
+ * Pool of buffers for stream read and write operations
+ */
+using StreamBufferPool = AudioBufferPool<IStreamBuffer>;
+
+/**
+ * Pool of buffers for transcoder read and write operations
+ */
+using TranscodeBufferPool = AudioBufferPool<IAudioBuffer>;
+
+/**
+ * Configuration of a TranscodeSession
+ */
+struct TranscodeSessionConfig {
+    /** Maximum number of write operations in flight */
+    uint32_t writeDepth = 2;
+    /** Maximum number of read operations in flight */
+    uint32_t readDepth = 2;
+};
+
+/**
+ * Counters of a TranscodeSession
+ */
+struct TranscodeSessionStats {
+    uint64_t bytesWritten = 0;  /**< Input bytes accepted by the transcoder */
+    uint64_t bytesRead = 0;     /**< Output bytes delivered to the sink */
+    uint32_t writes = 0;        /**< Write operations completed */
+    uint32_t reads = 0;         /**< Read operations completed */
+    uint32_t partialWrites = 0; /**< Writes resent after the transcoder accepted part of them */
+    uint32_t bufferStalls = 0;  /**< Operations postponed as a pool had no free buffer */
+};
+
+/**
+ * @brief   TranscodeSession transcodes the data of a source into a sink using an ITranscoder.
+ *
+ *          It keeps up to TranscodeSessionConfig::writeDepth writes and readDepth reads in
+ *          flight, so the transcoder does not wait for the application between operations.
+ *          Writes the transcoder accepts only in part are resent from the leftover offset after
+ *          ITranscodeListener::onReadyForWrite(), in order. Read buffers are passed to the sink
+ *          in the order the reads were issued.
+ *
+ *          Buffers are taken from the given pools as needed and kept by the session, which
+ *          reuses the buffer of a completed operation for the next one, until the session ends.
+ *          When transcoding does not expand the data (see @ref canShareBuffers), one pool can
+ *          be given for both directions; writes and reads then reuse each other's buffers, so
+ *          the session holds no more buffers than operations in flight at once.
+ *
+ *          The session ends with ErrorCode::NO_RESOURCES if it gets no buffer while no
+ *          operation is in flight. It is released once it has ended and the transcoder has
+ *          completed all operations in flight, e.g. after ITranscoder::tearDown().
+ *
+ *          The source and sink are called one at a time from the thread calling start() or
+ *          from the transcoder callback threads, and must not call the session.
+ */
+class TranscodeSession : public ITranscodeListener,
+                         public std::enable_shared_from_this<TranscodeSession> {
+public:
+    /**
+     * Fills data with up to maxBytes input bytes, returns the number of bytes filled; fewer
+     * than maxBytes ends the input.
+     */
+    using Source = std::function<size_t(uint8_t *data, size_t maxBytes)>;
+
+    /**
+     * Receives size output bytes; isLast is set on the last call.
+     */
+    using Sink = std::function<void(const uint8_t *data, size_t size, bool isLast)>;
+
+    /**
+     * Called once with the outcome of the session.
+     */
+    using DoneCb = std::function<void(telux::common::ErrorCode error)>;
+
+    /**
+     * Whether a transcoding from input to output produces no more bytes than it consumes, so
+     * that buffers sized for the input can also receive the output.
+     */
+    static bool canShareBuffers(const FormatInfo &input, const FormatInfo &output) {
+        if (input.format == output.format) {
+            return input.sampleRate >= output.sampleRate;
+        }
+        return input.format == AudioFormat::PCM_16BIT_SIGNED;
+    }
+
+    /**
+     * Creates a session. writePool and readPool may be the same pool.
+     *
+     * @returns the session or nullptr if an argument is missing.
+     */
+    static std::shared_ptr<TranscodeSession> create(std::shared_ptr<ITranscoder> transcoder,
+            std::shared_ptr<TranscodeBufferPool> writePool,
+            std::shared_ptr<TranscodeBufferPool> readPool, Source source, Sink sink,
+            TranscodeSessionConfig config = TranscodeSessionConfig()) {
+        if (!transcoder || !writePool || !readPool || !source || !sink
+                || config.writeDepth == 0 || config.readDepth == 0) {
+            return nullptr;
+        }
+        return std::shared_ptr<TranscodeSession>(new TranscodeSession(
+            transcoder, writePool, readPool, source, sink, config));
+    }
+
+    /**
+     * Registers as listener of the transcoder and starts issuing writes and reads. The
+     * session stays alive until done is called. ITranscoder::tearDown() is left to the
+     * application.
+     */
+    telux::common::Status start(DoneCb done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (started_) {
+                return telux::common::Status::ALREADY;
+            }
+            started_ = true;
+            done_ = done;
+            self_ = shared_from_this();
+        }
+        telux::common::Status status = transcoder_->registerListener(shared_from_this());
+        if (status != telux::common::Status::SUCCESS) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            self_.reset();
+            return status;
+        }
+        pump();
+        return telux::common::Status::SUCCESS;
+    }
+
+    TranscodeSessionStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void onReadyForWrite() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writeBlocked_ = false;
+        }
+        pump();
+    }
+
+private:
+    struct PendingWrite {
+        std::shared_ptr<IAudioBuffer> buffer;
+        bool isLast;
+    };
+
+    struct PendingRead {
+        std::shared_ptr<IAudioBuffer> buffer;
+        uint32_t isLast;
+        bool complete;
+    };
+
+    TranscodeSession(std::shared_ptr<ITranscoder> transcoder,
+            std::shared_ptr<TranscodeBufferPool> writePool,
+            std::shared_ptr<TranscodeBufferPool> readPool, Source source, Sink sink,
+            TranscodeSessionConfig config)
+       : transcoder_(transcoder)
+       , writePool_(writePool)
+       , readPool_(readPool)
+       , source_(source)
+       , sink_(sink)
+       , config_(config) {
+    }
+
+    // Issues the operations the depths, buffers and transcoder state allow. One thread pumps at
+    // a time so that operations reach the transcoder in the order of the source and of reads_;
+    // a call while another thread pumps returns at once, that thread sees the new state.
+    // Transcoder calls are made without holding mutex_, as they may call back synchronously.
+    // The callbacks capture this; self_ keeps the session alive while operations are in flight.
+    void pump() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pumping_) {
+                return;
+            }
+            pumping_ = true;
+        }
+        for (;;) {
+            std::shared_ptr<IAudioBuffer> writeBuffer;
+            std::shared_ptr<IAudioBuffer> readBuffer;
+            bool writeLast = false;
+            bool stalled = false;
+            uint32_t bytesToRead = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (finished_) {
+                    pumping_ = false;
+                    return;
+                }
+                if (!writeBlocked_ && !inputDone_ && writesInFlight_ < config_.writeDepth) {
+                    if (!resend_.empty()) {
+                        writeBuffer = resend_.front().buffer;
+                        writeLast = resend_.front().isLast;
+                        resend_.pop_front();
+                    } else if (!lastWritten_) {
+                        writeBuffer = takeBuffer(freeWrite_, writePool_);
+                        if (writeBuffer) {
+                            size_t size = writeBuffer->getMinSize();
+                            size = (size == 0) ? writeBuffer->getMaxSize() : size;
+                            size_t filled = source_(writeBuffer->getRawBuffer(), size);
+                            writeBuffer->setDataSize(static_cast<uint32_t>(filled));
+                            writeLast = (filled < size);
+                            lastWritten_ = writeLast;
+                        }
+                    }
+                    if (writeBuffer) {
+                        ++writesInFlight_;
+                    }
+                }
+                if (!lastRead_ && reads_.size() < config_.readDepth) {
+                    readBuffer = takeBuffer(readFree(), readPool_);
+                    if (readBuffer) {
+                        bytesToRead = static_cast<uint32_t>(readBuffer->getMinSize());
+                        if (bytesToRead == 0) {
+                            bytesToRead = static_cast<uint32_t>(readBuffer->getMaxSize());
+                        }
+                        reads_.push_back(PendingRead{readBuffer, 0, false});
+                    }
+                }
+                if (!writeBuffer && !readBuffer) {
+                    pumping_ = false;
+                    if (writesInFlight_ > 0 || !reads_.empty() || writeBlocked_) {
+                        return;
+                    }
+                    // No operation would ever complete to free a buffer
+                    stalled = true;
+                }
+            }
+            if (stalled) {
+                finish(telux::common::ErrorCode::NO_RESOURCES);
+                return;
+            }
+            if (writeBuffer) {
+                telux::common::Status status = transcoder_->write(writeBuffer, writeLast ? 1 : 0,
+                    [this, writeLast](std::shared_ptr<IAudioBuffer> buffer, uint32_t bytes,
+                            telux::common::ErrorCode error) {
+                        onWriteComplete(buffer, bytes, writeLast, error);
+                    });
+                if (status != telux::common::Status::SUCCESS) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        --writesInFlight_;
+                        if (readBuffer) {
+                            reads_.pop_back();
+                        }
+                        pumping_ = false;
+                    }
+                    finish(telux::common::ErrorCode::GENERIC_FAILURE);
+                    return;
+                }
+            }
+            if (readBuffer) {
+                telux::common::Status status = transcoder_->read(readBuffer, bytesToRead,
+                    [this](std::shared_ptr<IAudioBuffer> buffer, uint32_t isLast,
+                            telux::common::ErrorCode error) {
+                        onReadComplete(buffer, isLast, error);
+                    });
+                if (status != telux::common::Status::SUCCESS) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        reads_.pop_back();
+                        pumping_ = false;
+                    }
+                    finish(telux::common::ErrorCode::GENERIC_FAILURE);
+                    return;
+                }
+            }
+        }
+    }
+
+    void onWriteComplete(std::shared_ptr<IAudioBuffer> buffer, uint32_t bytes, bool isLast,
+            telux::common::ErrorCode error) {
+        std::shared_ptr<TranscodeSession> keep = shared_from_this();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --writesInFlight_;
+            ++stats_.writes;
+            stats_.bytesWritten += bytes;
+            uint32_t size = buffer->getDataSize();
+            if (finished_ || error != telux::common::ErrorCode::SUCCESS) {
+                // Reported below
+            } else if (bytes < size) {
+                // Resend the leftover once the pipeline has room, ahead of later writes
+                uint8_t *data = buffer->getRawBuffer();
+                std::memmove(data, data + bytes, size - bytes);
+                buffer->setDataSize(size - bytes);
+                resend_.push_back(PendingWrite{buffer, isLast});
+                writeBlocked_ = true;
+                ++stats_.partialWrites;
+            } else {
+                inputDone_ = isLast;
+                freeWrite_.push_back(buffer);
+            }
+        }
+        buffer.reset();
+        if (error != telux::common::ErrorCode::SUCCESS) {
+            finish(error);
+        } else {
+            pump();
+        }
+        releaseIfIdle();
+    }
+
+    void onReadComplete(std::shared_ptr<IAudioBuffer> buffer, uint32_t isLast,
+            telux::common::ErrorCode error) {
+        std::shared_ptr<TranscodeSession> keep = shared_from_this();
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto &read : reads_) {
+                if (read.buffer == buffer && !read.complete) {
+                    read.complete = true;
+                    read.isLast = isLast;
+                    break;
+                }
+            }
+            // Deliver in issue order
+            while (!reads_.empty() && reads_.front().complete) {
+                PendingRead &read = reads_.front();
+                const bool last = (read.isLast != 0);
+                if (!finished_ && error == telux::common::ErrorCode::SUCCESS) {
+                    ++stats_.reads;
+                    stats_.bytesRead += read.buffer->getDataSize();
+                    sink_(read.buffer->getRawBuffer(), read.buffer->getDataSize(), last);
+                    if (last) {
+                        lastRead_ = true;
+                        done = true;
+                    }
+                }
+                readFree().push_back(read.buffer);
+                reads_.pop_front();
+            }
+        }
+        buffer.reset();
+        if (error != telux::common::ErrorCode::SUCCESS) {
+            finish(error);
+        } else if (done) {
+            finish(telux::common::ErrorCode::SUCCESS);
+        } else {
+            pump();
+        }
+        releaseIfIdle();
+    }
+
+    void finish(telux::common::ErrorCode error) {
+        DoneCb done;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_) {
+                return;
+            }
+            finished_ = true;
+            done = done_;
+        }
+        transcoder_->deRegisterListener(shared_from_this());
+        if (done) {
+            done(error);
+        }
+        releaseIfIdle();
+    }
+
+    // Drops the reference held for the transcoder callbacks once the session has finished and
+    // none is pending. The caller holds another reference.
+    void releaseIfIdle() {
+        std::shared_ptr<TranscodeSession> self;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_ && writesInFlight_ == 0 && reads_.empty()) {
+            self.swap(self_);
+            // Back to the pools
+            freeWrite_.clear();
+            freeRead_.clear();
+            resend_.clear();
+        }
+    }
+
+    // Callers hold mutex_. Buffers taken from the pools stay with the session until it ends,
+    // so a completed operation frees its buffer for the next one even while the transcoder
+    // still holds a reference to it.
+    std::shared_ptr<IAudioBuffer> takeBuffer(
+            std::vector<std::shared_ptr<IAudioBuffer>> &freeBuffers,
+            const std::shared_ptr<TranscodeBufferPool> &pool) {
+        if (!freeBuffers.empty()) {
+            std::shared_ptr<IAudioBuffer> buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+            buffer->reset();
+            return buffer;
+        }
+        std::shared_ptr<IAudioBuffer> buffer = pool->acquire();
+        if (!buffer) {
+            ++stats_.bufferStalls;
+        }
+        return buffer;
+    }
+
+    // Writes and reads share their free buffers when they share a pool
+    std::vector<std::shared_ptr<IAudioBuffer>> &readFree() {
+        return (readPool_ == writePool_) ? freeWrite_ : freeRead_;
+    }
+
+    std::shared_ptr<ITranscoder> transcoder_;
+    std::shared_ptr<TranscodeBufferPool> writePool_;
+    std::shared_ptr<TranscodeBufferPool> readPool_;
+    Source source_;
+    Sink sink_;
+    const TranscodeSessionConfig config_;
+
+    mutable std::mutex mutex_;
+    DoneCb done_;
+    std::shared_ptr<TranscodeSession> self_;
+    bool started_ = false;
+    bool pumping_ = false;
+    bool finished_ = false;
+    bool writeBlocked_ = false;
+    bool lastWritten_ = false;
+    bool inputDone_ = false;
+    bool lastRead_ = false;
+    uint32_t writesInFlight_ = 0;
+    std::deque<PendingWrite> resend_;
+    std::deque<PendingRead> reads_;
+    std::vector<std::shared_ptr<IAudioBuffer>> freeWrite_;
+    std::vector<std::shared_ptr<IAudioBuffer>> freeRead_;
+    TranscodeSessionStats stats_;
+};
+
+/** @} */ /* end_addtogroup telematics_audio_stream */
+}  // End of namespace audio
+
+}  // End of namespace telux
+
+#endif  // end of AUDIOBUFFERPOOL_HPP
@@ -0,0 +1,669 @@
+/*
+*  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are
+*  met:
+*    * Redistributions of source code must retain the above copyright
+*      notice, this list of conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above
+*      copyright notice, this list of conditions and the following
+*      disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its
+*      contributors may be used to endorse or promote products derived
+*      from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+*  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+*  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+*  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+*  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+*  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+*  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+*  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+*  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+*  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * @file    AudioStreamEngine.hpp
+ *
+ * @brief   AudioStreamEngine runs PCM capture, playback or capture to playback over audio
+ *          streams with a fixed number of buffers in flight, processes the audio on a dedicated
+ *          worker thread and measures underruns, callback latency and end to end delay.
+ *
+ * @note    Eval: This is a new API and is being evaluated. It is subject to change
+ *          and could break backwards compatibility.
+ */
+
+#ifndef AUDIOSTREAMENGINE_HPP
+#define AUDIOSTREAMENGINE_HPP
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/audio/AudioDefines.hpp>
+#include <telux/audio/AudioManager.hpp>
+#include <telux/audio/AudioBufferPool.hpp>
+
+namespace telux {
+
+namespace audio {
+/** @addtogroup telematics_audio_stream
+ * @{ */
+
+/**
+ * @brief   Histogram of durations in microseconds with power of two buckets. Bucket 0 counts
+ *          durations below 64 us, bucket i durations from 32 << i up to 64 << i us, and the
+ *          last bucket everything longer.
+ */
+struct AudioLatencyHistogram {
+    static const int BUCKETS = 16;
+
+    uint64_t counts[BUCKETS] = {};
+    uint64_t samples = 0;
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+
+    void add(uint32_t us) {
+        int bucket = 0;
+        while (bucket < BUCKETS - 1 && us >= (64u << bucket)) {
+            ++bucket;
+        }
+        ++counts[bucket];
+        ++samples;
+        totalUs += us;
+        maxUs = std::max(maxUs, us);
+    }
+
+    uint32_t meanUs() const {
+        return samples ? static_cast<uint32_t>(totalUs / samples) : 0;
+    }
+
+    /**
+     * Upper bound of the bucket holding the given fraction (0 to 1) of the samples, or maxUs
+     * when that is the last bucket.
+     */
+    uint32_t percentileUs(double fraction) const {
+        if (samples == 0) {
+            return 0;
+        }
+        const double target = fraction * static_cast<double>(samples);
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BUCKETS - 1; ++bucket) {
+            seen += counts[bucket];
+            if (static_cast<double>(seen) >= target) {
+                return std::min(64u << bucket, maxUs);
+            }
+        }
+        return maxUs;
+    }
+};
+
+/**
+ * Configuration of an AudioStreamEngine
+ */
+struct AudioEngineConfig {
+    uint32_t depth = 2;             /**< Operations in flight per stream: 2 for double buffering,
+                                         3 for triple buffering */
+    uint32_t prerollPeriods = 1;    /**< Silent periods written ahead of the first captured one
+                                         when both streams are used, to absorb jitter */
+    uint32_t periodBytes = 0;       /**< Bytes per read and write, 0 for the minimum size of the
+                                         stream buffers */
+    uint32_t bytesPerSecond = 0;    /**< PCM data rate, used for period jitter and delay; 0 to
+                                         derive it from the StreamConfig in open() */
+    int realTimePriority = 0;       /**< SCHED_FIFO priority of the worker thread, 0 to keep the
+                                         default scheduling policy */
+};
+
+/**
+ * Statistics of an AudioStreamEngine
+ */
+struct AudioEngineStats {
+    uint64_t capturedPeriods = 0;        /**< Reads completed */
+    uint64_t playedPeriods = 0;          /**< Writes completed */
+    uint32_t underruns = 0;              /**< Writes completed with no other write queued, so
+                                              that playback ran dry */
+    uint32_t overruns = 0;               /**< Captured periods dropped or reads completed with no
+                                              buffer left to read into */
+    uint32_t shortWrites = 0;            /**< Writes that did not take the whole period */
+    uint32_t errors = 0;                 /**< Operations failed or completed with an error */
+    bool realTimeWorker = false;         /**< Whether the worker runs with SCHED_FIFO */
+    AudioLatencyHistogram callbackLatency; /**< From a stream callback to the worker having
+                                                processed its period and issued the follow-up
+                                                write */
+    AudioLatencyHistogram periodJitter;  /**< Deviation of the interval between read completions
+                                              from the period */
+    uint32_t glassToGlassUs = 0;         /**< Smoothed estimate of the delay from a sample being
+                                              captured to it being played */
+    uint32_t glassToGlassMaxUs = 0;      /**< Largest estimate */
+};
+
+/**
+ * @brief   AudioStreamEngine keeps depth reads and writes in flight on PCM capture and playback
+ *          streams and hands every period to a processor on its own worker thread, which can run
+ *          with real time priority. Stream callbacks only queue completed buffers and issue the
+ *          next read, so a slow processor delays playback but not capture.
+ *
+ *          With both streams, every captured period is processed into a playback buffer and
+ *          written, behind prerollPeriods of silence. With only a capture stream the processor
+ *          gets no output buffer, and with only a playback stream it fills each period to play.
+ *
+ *          The buffers come from the streams and are recycled for the life of the engine.
+ *
+ *          The end to end delay is estimated for each period as the time from its first sample
+ *          being captured, one period before its read completed, to it starting to play, which is
+ *          when the writes queued ahead of it have been played. It assumes that the playback
+ *          stream completes a write when it starts playing the next one.
+ *
+ *          The processor is called on the worker thread only. The engine is thread safe.
+ */
+class AudioStreamEngine {
+public:
+    /**
+     * Processes bytes of audio: in is the captured period or nullptr without a capture stream,
+     * out the period to play or nullptr without a playback stream.
+     */
+    using Processor = std::function<void(const uint8_t *in, uint8_t *out, size_t bytes)>;
+
+    /**
+     * Called with the engine created by open(), or nullptr and the error.
+     */
+    using OpenCb = std::function<void(
+        std::shared_ptr<AudioStreamEngine> engine, telux::common::ErrorCode error)>;
+
+    /**
+     * Creates an engine over existing streams, either of which may be nullptr. A missing
+     * processor copies the capture to the playback.
+     *
+     * @returns the engine, or nullptr if both streams are missing, depth is 0 or the processor
+     *          is missing with a single stream.
+     */
+    static std::shared_ptr<AudioStreamEngine> create(
+            std::shared_ptr<IAudioCaptureStream> capture, std::shared_ptr<IAudioPlayStream> play,
+            AudioEngineConfig config = AudioEngineConfig(), Processor processor = nullptr) {
+        if ((!capture && !play) || config.depth == 0) {
+            return nullptr;
+        }
+        if (!processor) {
+            if (!capture || !play) {
+                return nullptr;
+            }
+            processor = [](const uint8_t *in, uint8_t *out, size_t bytes) {
+                std::memcpy(out, in, bytes);
+            };
+        }
+        std::shared_ptr<AudioStreamEngine> engine(
+            new AudioStreamEngine(capture, play, config, processor));
+        engine->weakSelf_ = engine;
+        return engine;
+    }
+
+    /**
+     * Creates a capture and a playback stream with IAudioManager::createStream() and an engine
+     * over them. config.bytesPerSecond, when 0, is derived from the capture configuration.
+     * The streams are deleted again if either cannot be created.
+     */
+    static telux::common::Status open(std::shared_ptr<IAudioManager> manager,
+            StreamConfig captureConfig, StreamConfig playConfig, AudioEngineConfig config,
+            Processor processor, OpenCb callback) {
+        if (!manager || !callback) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        if (config.bytesPerSecond == 0
+                && captureConfig.format == AudioFormat::PCM_16BIT_SIGNED) {
+            uint32_t channels = 0;
+            for (ChannelTypeMask mask = captureConfig.channelTypeMask; mask; mask &= mask - 1) {
+                ++channels;
+            }
+            config.bytesPerSecond = captureConfig.sampleRate * channels * 2;
+        }
+        return manager->createStream(captureConfig,
+            [manager, playConfig, config, processor, callback](
+                    std::shared_ptr<IAudioStream> &captureStream,
+                    telux::common::ErrorCode error) {
+                auto capture = std::dynamic_pointer_cast<IAudioCaptureStream>(captureStream);
+                if (error != telux::common::ErrorCode::SUCCESS || !capture) {
+                    if (captureStream) {
+                        manager->deleteStream(captureStream);
+                    }
+                    callback(nullptr, (error != telux::common::ErrorCode::SUCCESS)
+                        ? error : telux::common::ErrorCode::INVALID_ARGUMENTS);
+                    return;
+                }
+                auto status = manager->createStream(playConfig,
+                    [manager, capture, config, processor, callback](
+                            std::shared_ptr<IAudioStream> &playStream,
+                            telux::common::ErrorCode error) {
+                        auto play = std::dynamic_pointer_cast<IAudioPlayStream>(playStream);
+                        if (error != telux::common::ErrorCode::SUCCESS || !play) {
+                            if (playStream) {
+                                manager->deleteStream(playStream);
+                            }
+                            manager->deleteStream(capture);
+                            callback(nullptr, (error != telux::common::ErrorCode::SUCCESS)
+                                ? error : telux::common::ErrorCode::INVALID_ARGUMENTS);
+                            return;
+                        }
+                        callback(create(capture, play, config, processor),
+                            telux::common::ErrorCode::SUCCESS);
+                    });
+                if (status != telux::common::Status::SUCCESS) {
+                    manager->deleteStream(capture);
+                    callback(nullptr, telux::common::ErrorCode::GENERIC_FAILURE);
+                }
+            });
+    }
+
+    /**
+     * Gets the buffers, writes the preroll, issues the first reads and starts the worker.
+     *
+     * @returns SUCCESS, ALREADY if started before, FAILED if the streams provide no buffers or
+     *          INVALIDPARAM if periodBytes exceeds their size.
+     */
+    telux::common::Status start() {
+        std::lock_guard<std::mutex> startLock(startMutex_);
+        if (started_) {
+            return telux::common::Status::ALREADY;
+        }
+        const bool duplex = capture_ && play_;
+        if (capture_) {
+            auto capture = capture_;
+            if (!takeBuffers(freeCapture_, config_.depth + 1,
+                    [capture]() { return capture->getStreamBuffer(); })) {
+                return telux::common::Status::FAILED;
+            }
+        }
+        if (play_) {
+            auto play = play_;
+            const uint32_t count = config_.depth + (duplex ? config_.prerollPeriods + 1 : 0);
+            if (!takeBuffers(freePlay_, count, [play]() { return play->getStreamBuffer(); })) {
+                freeCapture_.clear();
+                return telux::common::Status::FAILED;
+            }
+        }
+        std::shared_ptr<IStreamBuffer> sizing = capture_ ? freeCapture_.front() : freePlay_.front();
+        periodBytes_ = config_.periodBytes;
+        if (periodBytes_ == 0) {
+            periodBytes_ = static_cast<uint32_t>(sizing->getMinSize()
+                ? sizing->getMinSize() : sizing->getMaxSize());
+        }
+        for (auto &buffer : freeCapture_) {
+            if (periodBytes_ > buffer->getMaxSize()) {
+                periodBytes_ = 0;
+            }
+        }
+        for (auto &buffer : freePlay_) {
+            if (periodBytes_ > buffer->getMaxSize()) {
+                periodBytes_ = 0;
+            }
+        }
+        if (periodBytes_ == 0) {
+            freeCapture_.clear();
+            freePlay_.clear();
+            return telux::common::Status::INVALIDPARAM;
+        }
+        periodUs_ = config_.bytesPerSecond
+            ? static_cast<uint32_t>(1000000ull * periodBytes_ / config_.bytesPerSecond) : 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = true;
+            frontStart_ = Clock::now();
+            lastWriteDone_ = frontStart_;
+            if (!capture_) {
+                fillsPending_ = config_.depth;
+            }
+        }
+        started_ = true;
+        worker_ = std::thread(&AudioStreamEngine::run, this);
+        if (duplex) {
+            for (uint32_t i = 0; i < config_.prerollPeriods; ++i) {
+                std::shared_ptr<IStreamBuffer> buffer;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    buffer = freePlay_.back();
+                    freePlay_.pop_back();
+                    ++writesInFlight_;
+                }
+                std::memset(buffer->getRawBuffer(), 0, periodBytes_);
+                buffer->setDataSize(periodBytes_);
+                issueWrite(buffer);
+            }
+        }
+        if (capture_) {
+            issueReads();
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Stops issuing operations and joins the worker. Operations in flight complete into the
+     * free buffers. The streams are left to the application.
+     */
+    telux::common::Status stop() {
+        std::lock_guard<std::mutex> startLock(startMutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return telux::common::Status::INVALIDSTATE;
+            }
+            running_ = false;
+            captured_.clear();
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    AudioEngineStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    /**
+     * Bytes per read and write, known once started.
+     */
+    uint32_t getPeriodBytes() const {
+        return periodBytes_;
+    }
+
+    ~AudioStreamEngine() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Captured {
+        std::shared_ptr<IStreamBuffer> buffer;
+        Clock::time_point completed;
+    };
+
+    AudioStreamEngine(std::shared_ptr<IAudioCaptureStream> capture,
+            std::shared_ptr<IAudioPlayStream> play, AudioEngineConfig config, Processor processor)
+       : capture_(capture)
+       , play_(play)
+       , config_(config)
+       , processor_(processor) {
+    }
+
+    static uint32_t elapsedUs(Clock::time_point from, Clock::time_point to) {
+        if (to <= from) {
+            return 0;
+        }
+        return static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+    }
+
+    // Buffers are obtained once through a pool so that none is allocated while running; the
+    // engine then keeps them in its own free lists, since a stream may still hold a reference
+    // to a buffer while calling back with it.
+    static bool takeBuffers(std::vector<std::shared_ptr<IStreamBuffer>> &buffers, uint32_t count,
+            StreamBufferPool::BufferFactory factory) {
+        auto pool = StreamBufferPool::create(count, factory);
+        if (!pool) {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            buffers.push_back(pool->acquire());
+        }
+        return true;
+    }
+
+    void run() {
+        if (config_.realTimePriority > 0) {
+            sched_param param{};
+            param.sched_priority = config_.realTimePriority;
+            const bool realTime
+                = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0);
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.realTimeWorker = realTime;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this] {
+                return !running_ || !captured_.empty() || (fillsPending_ > 0 && !freePlay_.empty());
+            });
+            if (!running_) {
+                return;
+            }
+            std::shared_ptr<IStreamBuffer> in;
+            std::shared_ptr<IStreamBuffer> out;
+            Clock::time_point completed;
+            if (!captured_.empty()) {
+                in = captured_.front().buffer;
+                completed = captured_.front().completed;
+                captured_.pop_front();
+                if (play_) {
+                    if (freePlay_.empty()) {
+                        // Playback is stuck; drop the period rather than fall further behind
+                        ++stats_.overruns;
+                        freeCapture_.push_back(in);
+                        lock.unlock();
+                        issueReads();
+                        lock.lock();
+                        continue;
+                    }
+                    out = freePlay_.back();
+                    freePlay_.pop_back();
+                }
+            } else {
+                --fillsPending_;
+                out = freePlay_.back();
+                freePlay_.pop_back();
+                completed = lastWriteDone_;
+            }
+            lock.unlock();
+
+            processor_(in ? in->getRawBuffer() : nullptr, out ? out->getRawBuffer() : nullptr,
+                periodBytes_);
+            if (out) {
+                out->setDataSize(periodBytes_);
+                const Clock::time_point now = Clock::now();
+                lock.lock();
+                if (in) {
+                    estimateDelay(completed, now);
+                }
+                ++writesInFlight_;
+                lock.unlock();
+                issueWrite(out);
+            }
+            const Clock::time_point handled = Clock::now();
+            lock.lock();
+            stats_.callbackLatency.add(elapsedUs(completed, handled));
+            if (in) {
+                in->reset();
+                freeCapture_.push_back(in);
+                lock.unlock();
+                issueReads();
+                lock.lock();
+            }
+        }
+    }
+
+    // Callers hold mutex_. The period starts playing once the writes ahead of it are played:
+    // the one playing since frontStart_ and the others a period each.
+    void estimateDelay(Clock::time_point captureCompleted, Clock::time_point now) {
+        if (periodUs_ == 0) {
+            return;
+        }
+        Clock::time_point playStart = now;
+        if (writesInFlight_ > 0) {
+            playStart = std::max(now,
+                frontStart_ + std::chrono::microseconds(uint64_t(periodUs_) * writesInFlight_));
+        }
+        const Clock::time_point captureStart
+            = captureCompleted - std::chrono::microseconds(periodUs_);
+        const uint32_t delayUs = elapsedUs(captureStart, playStart);
+        stats_.glassToGlassUs = stats_.glassToGlassUs
+            ? stats_.glassToGlassUs - stats_.glassToGlassUs / 8 + delayUs / 8 : delayUs;
+        stats_.glassToGlassMaxUs = std::max(stats_.glassToGlassMaxUs, delayUs);
+    }
+
+    // Keeps depth reads in flight with the free capture buffers
+    void issueReads() {
+        for (;;) {
+            std::shared_ptr<IStreamBuffer> buffer;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_ || readsInFlight_ >= config_.depth || freeCapture_.empty()) {
+                    return;
+                }
+                buffer = freeCapture_.back();
+                freeCapture_.pop_back();
+                ++readsInFlight_;
+            }
+            std::weak_ptr<AudioStreamEngine> weak = weakSelf_;
+            auto status = capture_->read(buffer, periodBytes_,
+                [weak](std::shared_ptr<IStreamBuffer> buffer, telux::common::ErrorCode error) {
+                    if (auto engine = weak.lock()) {
+                        engine->onReadComplete(buffer, error);
+                    }
+                });
+            if (status != telux::common::Status::SUCCESS) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --readsInFlight_;
+                ++stats_.errors;
+                freeCapture_.push_back(buffer);
+                return;
+            }
+        }
+    }
+
+    void issueWrite(std::shared_ptr<IStreamBuffer> buffer) {
+        std::weak_ptr<AudioStreamEngine> weak = weakSelf_;
+        auto status = play_->write(buffer,
+            [weak](std::shared_ptr<IStreamBuffer> buffer, uint32_t bytesWritten,
+                    telux::common::ErrorCode error) {
+                if (auto engine = weak.lock()) {
+                    engine->onWriteComplete(buffer, bytesWritten, error);
+                }
+            });
+        if (status != telux::common::Status::SUCCESS) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --writesInFlight_;
+            ++stats_.errors;
+            freePlay_.push_back(buffer);
+            if (!capture_) {
+                ++fillsPending_;
+            }
+        }
+    }
+
+    void onReadComplete(std::shared_ptr<IStreamBuffer> buffer, telux::common::ErrorCode error) {
+        const Clock::time_point now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --readsInFlight_;
+            if (!running_ || error != telux::common::ErrorCode::SUCCESS) {
+                if (error != telux::common::ErrorCode::SUCCESS) {
+                    ++stats_.errors;
+                }
+                buffer->reset();
+                freeCapture_.push_back(buffer);
+            } else {
+                ++stats_.capturedPeriods;
+                if (periodUs_ && lastReadDone_ != Clock::time_point()) {
+                    const uint32_t intervalUs = elapsedUs(lastReadDone_, now);
+                    stats_.periodJitter.add(intervalUs > periodUs_
+                        ? intervalUs - periodUs_ : periodUs_ - intervalUs);
+                }
+                lastReadDone_ = now;
+                captured_.push_back(Captured{buffer, now});
+                if (readsInFlight_ == 0 && freeCapture_.empty()) {
+                    // Nothing is being captured into until the worker returns a buffer
+                    ++stats_.overruns;
+                }
+            }
+        }
+        cv_.notify_one();
+        issueReads();
+    }
+
+    void onWriteComplete(std::shared_ptr<IStreamBuffer> buffer, uint32_t bytesWritten,
+            telux::common::ErrorCode error) {
+        const Clock::time_point now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --writesInFlight_;
+            if (error != telux::common::ErrorCode::SUCCESS) {
+                ++stats_.errors;
+            } else {
+                ++stats_.playedPeriods;
+                if (bytesWritten < buffer->getDataSize()) {
+                    ++stats_.shortWrites;
+                }
+            }
+            frontStart_ = now;
+            lastWriteDone_ = now;
+            if (running_ && writesInFlight_ == 0) {
+                ++stats_.underruns;
+            }
+            buffer->reset();
+            freePlay_.push_back(buffer);
+            if (!capture_) {
+                ++fillsPending_;
+            }
+        }
+        cv_.notify_one();
+    }
+
+    // Callbacks and the worker hold no strong reference, so the engine is never destroyed on
+    // its own worker thread
+    std::weak_ptr<AudioStreamEngine> weakSelf_;
+    std::shared_ptr<IAudioCaptureStream> capture_;
+    std::shared_ptr<IAudioPlayStream> play_;
+    const AudioEngineConfig config_;
+    Processor processor_;
+    uint32_t periodBytes_ = 0;
+    uint32_t periodUs_ = 0;
+
+    std::mutex startMutex_;
+    bool started_ = false;
+    std::thread worker_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    uint32_t readsInFlight_ = 0;
+    uint32_t writesInFlight_ = 0;
+    uint32_t fillsPending_ = 0;
+    std::deque<Captured> captured_;
+    std::vector<std::shared_ptr<IStreamBuffer>> freeCapture_;
+    std::vector<std::shared_ptr<IStreamBuffer>> freePlay_;
+    Clock::time_point frontStart_;
+    Clock::time_point lastReadDone_;
+    Clock::time_point lastWriteDone_;
+    AudioEngineStats stats_;
+};
+
+/** @} */ /* end_addtogroup telematics_audio_stream */
+}  // End of namespace audio
+
+}  // End of namespace telux
+
+#endif  // end of AUDIOSTREAMENGINE_HPP
@@ -112,8 +112,32 @@ struct RxPacketMetaDataReport {
  * - 1 byte Length which specify how many bytes the value occupies
  * - Length bytes of the value
  *
+ * Each report opens with START and the subframe number and subchannel index TLVs, in that
+ * order. Any of the other TLVs of @ref RxMetaDataTlvType and single 0x00 padding bytes may
+ * follow before END. Every TLV type has a fixed length, values are little-endian. Several
+ * reports may follow each other back to back before the real payload, the meta data ends at
+ * the first byte that does not open a report.
  */
 
+/**
+ * TLV types of the received packet's meta data and the length of their values.
+ */
+enum RxMetaDataTlvType : uint8_t {
+    RX_META_DATA_TLV_SUBFRAME_NUMBER = 0x02,    /**< 2 bytes, sfn */
+    RX_META_DATA_TLV_SUBCHANNEL_INDEX = 0x03,   /**< 1 byte, subChannelIndex */
+    RX_META_DATA_TLV_L2_DEST_ID = 0x04,         /**< 4 bytes, l2DestinationId */
+    RX_META_DATA_TLV_RSSI = 0x05,               /**< 2 bytes, prxRssi then drxRssi */
+    RX_META_DATA_TLV_SCI_FORMAT1 = 0x06,        /**< 4 bytes, sciFormat1Info */
+    RX_META_DATA_TLV_DELAY_ESTIMATION = 0x07,   /**< 4 bytes, delayEstimation */
+    RX_META_DATA_TLV_SUBCHANNEL_NUMBER = 0x08,  /**< 1 byte, subChannelNum */
+};
+
+static constexpr uint8_t RX_META_DATA_START = 0xFF;
+static constexpr uint8_t RX_META_DATA_END = 0x01;
+static constexpr uint8_t RX_META_DATA_PADDING = 0x00;
+/* START plus the subframe number and subchannel index TLVs every report opens with */
+static constexpr size_t RX_META_DATA_HEADER_LEN = 8u;
+
 class Cv2xRxMetaDataHelper {
 public:
     /*
@@ -134,8 +158,196 @@ public:
      */
     static telux::common::Status getRxMetaDataInfo(const uint8_t* payload, uint32_t payloadLength,
         size_t& metaDataLen, std::shared_ptr<std::vector<RxPacketMetaDataReport>> metaDatas);
+
+    /*
+     * Same as above, but parses into an array owned by the caller and allocates nothing, so it
+     * can be used per packet at full channel load.
+     *
+     * @param [in]  payload       - the pointer to the received packet's data
+     * @param [in]  payloadLength - received packet's length
+     * @param [out] metaDataLen   - meta data length parsed
+     * @param [out] metaDatas     - array the Rx meta data reports are parsed into
+     * @param [in,out] num        - size of metaDatas as input, number of reports stored as output
+     *
+     * @Returns SUCCESS if no error occurred, NOMEMORY if the payload has more than num reports
+     *          (metaDataLen still covers all of them, the extra ones are dropped), FAILED if
+     *          the meta data is malformed, INVALIDPARAM if payload or metaDatas is null.
+     */
+    static telux::common::Status getRxMetaDataInfo(const uint8_t* payload, uint32_t payloadLength,
+        size_t& metaDataLen, RxPacketMetaDataReport* metaDatas, size_t& num);
+
+    /*
+     * Whether a report opens at payload[offset], i.e. whether the meta data goes on there.
+     */
+    static bool hasRxMetaDataReport(const uint8_t* payload, uint32_t payloadLength,
+        size_t offset);
+
+    /*
+     * Parses the report starting at payload[offset] (the START byte) into report and moves
+     * offset past its END byte. Used by the array variant and by @ref Cv2xRxMetaDataReader.
+     *
+     * @Returns SUCCESS, or FAILED with offset unchanged if the report is truncated, has a TLV
+     *          of an unknown type or with the wrong length, or no END.
+     */
+    static telux::common::Status parseRxMetaDataReport(const uint8_t* payload,
+        uint32_t payloadLength, size_t& offset, RxPacketMetaDataReport& report);
 };
 
+/**
+ * Streaming form of @ref Cv2xRxMetaDataHelper::getRxMetaDataInfo: yields the meta data reports
+ * at the beginning of a received payload one at a time, without allocating.
+ *
+ *     Cv2xRxMetaDataReader reader(buf, len);
+ *     RxPacketMetaDataReport report;
+ *     while (reader.next(report)) {
+ *         ...
+ *     }
+ *     if (reader.status() == telux::common::Status::SUCCESS) {
+ *         handlePayload(buf + reader.metaDataLen(), len - reader.metaDataLen());
+ *     }
+ */
+class Cv2xRxMetaDataReader {
+public:
+    Cv2xRxMetaDataReader(const uint8_t* payload, uint32_t payloadLength)
+        : payload_(payload), payloadLength_(payloadLength), offset_(0),
+          status_(payload == nullptr && payloadLength > 0 ?
+              telux::common::Status::INVALIDPARAM : telux::common::Status::SUCCESS) {
+    }
+
+    /*
+     * Parses the next report into report. Returns false once the meta data ends or on a
+     * malformed report, check @ref status to tell which.
+     */
+    bool next(RxPacketMetaDataReport& report) {
+        if (status_ != telux::common::Status::SUCCESS
+            || !Cv2xRxMetaDataHelper::hasRxMetaDataReport(payload_, payloadLength_, offset_)) {
+            return false;
+        }
+        status_ = Cv2xRxMetaDataHelper::parseRxMetaDataReport(payload_, payloadLength_, offset_,
+            report);
+        return status_ == telux::common::Status::SUCCESS;
+    }
+
+    /* Length of the meta data consumed so far, the real payload starts there at the end. */
+    size_t metaDataLen() const {
+        return offset_;
+    }
+
+    telux::common::Status status() const {
+        return status_;
+    }
+
+private:
+    const uint8_t* payload_;
+    uint32_t payloadLength_;
+    size_t offset_;
+    telux::common::Status status_;
+};
+
+inline bool Cv2xRxMetaDataHelper::hasRxMetaDataReport(const uint8_t* payload,
+    uint32_t payloadLength, size_t offset) {
+    const uint8_t* p = payload + offset;
+
+    return offset < payloadLength && payloadLength - offset > RX_META_DATA_HEADER_LEN
+        && p[0] == RX_META_DATA_START
+        && p[1] == RX_META_DATA_TLV_SUBFRAME_NUMBER && p[2] == sizeof(uint16_t)
+        && p[5] == RX_META_DATA_TLV_SUBCHANNEL_INDEX && p[6] == sizeof(uint8_t);
+}
+
+inline telux::common::Status Cv2xRxMetaDataHelper::parseRxMetaDataReport(const uint8_t* payload,
+    uint32_t payloadLength, size_t& offset, RxPacketMetaDataReport& report) {
+    if (!hasRxMetaDataReport(payload, payloadLength, offset)) {
+        return telux::common::Status::FAILED;
+    }
+
+    const uint8_t* p = payload + offset;
+    size_t pos = offset + RX_META_DATA_HEADER_LEN;
+
+    report.metaDataMask = RX_SUBFRAME_NUMBER | RX_SUBCHANNEL_INDEX;
+    report.sfn = static_cast<uint16_t>(p[3] | (p[4] << 8));
+    report.subChannelIndex = p[7];
+    while (pos < payloadLength) {
+        uint8_t type = payload[pos];
+        if (type == RX_META_DATA_END) {
+            offset = pos + 1;
+            return telux::common::Status::SUCCESS;
+        }
+        if (type == RX_META_DATA_PADDING) {
+            ++pos;
+            continue;
+        }
+
+        uint8_t size;
+        switch (type) {
+            case RX_META_DATA_TLV_SUBCHANNEL_NUMBER: size = 1; break;
+            case RX_META_DATA_TLV_RSSI: size = 2; break;
+            case RX_META_DATA_TLV_L2_DEST_ID:
+            case RX_META_DATA_TLV_SCI_FORMAT1:
+            case RX_META_DATA_TLV_DELAY_ESTIMATION: size = 4; break;
+            default:
+                return telux::common::Status::FAILED;
+        }
+        if (payloadLength - pos < 2u + size || payload[pos + 1] != size) {
+            return telux::common::Status::FAILED;
+        }
+
+        const uint8_t* val = payload + pos + 2;
+        uint32_t v = 0;
+        for (uint8_t i = size; i > 0; --i) {
+            v = (v << 8) | val[i - 1];
+        }
+        switch (type) {
+            case RX_META_DATA_TLV_SUBCHANNEL_NUMBER:
+                report.subChannelNum = static_cast<uint8_t>(v);
+                report.metaDataMask |= RX_SUBCHANNEL_NUMBER;
+                break;
+            case RX_META_DATA_TLV_RSSI:
+                report.prxRssi = static_cast<int8_t>(val[0]);
+                report.drxRssi = static_cast<int8_t>(val[1]);
+                report.metaDataMask |= RX_PRX_RSSI | RX_DRX_RSSI;
+                break;
+            case RX_META_DATA_TLV_L2_DEST_ID:
+                report.l2DestinationId = v;
+                report.metaDataMask |= RX_L2_DEST_ID;
+                break;
+            case RX_META_DATA_TLV_SCI_FORMAT1:
+                report.sciFormat1Info = v;
+                report.metaDataMask |= RX_SCI_FORMAT1;
+                break;
+            default:
+                report.delayEstimation = static_cast<int32_t>(v);
+                report.metaDataMask |= RX_DELAY_ESTIMATION;
+                break;
+        }
+        pos += 2u + size;
+    }
+    return telux::common::Status::FAILED;
+}
+
+inline telux::common::Status Cv2xRxMetaDataHelper::getRxMetaDataInfo(const uint8_t* payload,
+    uint32_t payloadLength, size_t& metaDataLen, RxPacketMetaDataReport* metaDatas, size_t& num) {
+    size_t cap = num;
+    RxPacketMetaDataReport spare;
+
+    num = 0;
+    metaDataLen = 0;
+    if ((payload == nullptr && payloadLength > 0) || (metaDatas == nullptr && cap > 0)) {
+        return telux::common::Status::INVALIDPARAM;
+    }
+
+    size_t total = 0;
+    while (hasRxMetaDataReport(payload, payloadLength, metaDataLen)) {
+        RxPacketMetaDataReport& report = (total < cap) ? metaDatas[total] : spare;
+        auto status = parseRxMetaDataReport(payload, payloadLength, metaDataLen, report);
+        if (status != telux::common::Status::SUCCESS) {
+            return status;
+        }
+        ++total;
+    }
+    num = (total < cap) ? total : cap;
+    return (total > cap) ? telux::common::Status::NOMEMORY : telux::common::Status::SUCCESS;
+}
+
 /** @} */ /* end_addtogroup telematics_cv2x_cpp */
 
 }  // end namespace cv2x
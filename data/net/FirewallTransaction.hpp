@@ -0,0 +1,702 @@
+/*
+ *  Copyright (c) 2019-2020 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       FirewallTransaction.hpp
+ *
+ * @brief      FirewallRuleCache programs firewall rules in batches that are applied as one
+ *             transaction, and keeps a local copy of the rules so that only changes are sent
+ *             to the modem.
+ */
+
+#ifndef FIREWALLTRANSACTION_HPP
+#define FIREWALLTRANSACTION_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+
+#include <telux/data/DataDefines.hpp>
+#include <telux/data/IpFilter.hpp>
+#include <telux/data/net/FirewallManager.hpp>
+
+namespace telux {
+namespace data {
+namespace net {
+
+/** @addtogroup telematics_data_net
+ * @{ */
+
+/**
+ * Outcome of a firewall transaction
+ */
+struct FirewallTransactionResult {
+    uint32_t added = 0;           /**< Rules added and kept */
+    uint32_t removed = 0;         /**< Rules removed and kept removed */
+    uint32_t unchanged = 0;       /**< Requested rules that were in place already */
+    uint32_t requests = 0;        /**< Requests sent to the firewall manager */
+    bool rolledBack = false;      /**< A change failed and the completed changes were undone */
+    bool rollbackFailed = false;  /**< Some completed changes could not be undone */
+};
+
+/**
+ * This function is called when a transaction of @ref FirewallRuleCache completed.
+ *
+ * @param [in] result      -     Changes made, see @ref FirewallTransactionResult
+ * @param [in] error       -     SUCCESS if all changes were applied, otherwise the error of
+ *                               the first change that failed. @ref telux::common::ErrorCode
+ *
+ */
+using FirewallTransactionCb = std::function<void(
+    const FirewallTransactionResult &result, telux::common::ErrorCode error)>;
+
+/**
+ * @brief   A set of firewall rules to add and remove in one transaction
+ */
+class FirewallBatch {
+ public:
+    /**
+     * Adds a rule, created with DataFactory::getNewFirewallEntry
+     */
+    void addEntry(std::shared_ptr<IFirewallEntry> entry) {
+        adds_.push_back(entry);
+    }
+
+    /**
+     * Removes the rule with the given handle, see IFirewallEntry::getHandle
+     */
+    void removeEntry(uint32_t handle) {
+        removes_.push_back(handle);
+    }
+
+    const std::vector<std::shared_ptr<IFirewallEntry>> &getAdds() const {
+        return adds_;
+    }
+
+    const std::vector<uint32_t> &getRemoves() const {
+        return removes_;
+    }
+
+    bool empty() const {
+        return adds_.empty() && removes_.empty();
+    }
+
+ private:
+    std::vector<std::shared_ptr<IFirewallEntry>> adds_;
+    std::vector<uint32_t> removes_;
+};
+
+/**
+ *@brief    FirewallRuleCache programs the firewall rules of a profile through an
+ *          @ref IFirewallManager in transactions.
+ *
+ *          A transaction first removes rules, then adds rules. Up to maxInFlight requests are
+ *          outstanding at a time, so a batch costs about one modem round-trip per maxInFlight
+ *          rules rather than one per rule. If a change fails, no further changes are sent,
+ *          the changes already made are undone (removed rules are added back, added rules
+ *          are removed) and the callback reports the error with rolledBack set.
+ *
+ *          The cache holds the rules of the profile as of the last transaction or
+ *          @ref refresh. @ref sync compares a complete requested rule set with the cache and
+ *          sends only the rules to add and remove; rules are compared by their contents, see
+ *          @ref getRuleKey. Each transaction ends with one requestFirewallEntries() to learn
+ *          the handles of the added rules.
+ *
+ *          One transaction runs at a time. Callbacks are invoked on the threads of the
+ *          firewall manager callbacks. Rules changed by other clients of the profile are seen
+ *          at the next refresh.
+ *
+ * @note    Eval: This is a new API and is being evaluated. It is subject to change
+ *          and could break backwards compatibility.
+ */
+class FirewallRuleCache {
+ public:
+    static const size_t DEFAULT_MAX_IN_FLIGHT = 8;
+
+    /**
+     * @param [in] manager       Firewall manager the rules are programmed through
+     * @param [in] profileId     Profile identifier of the rules
+     * @param [in] slotId        Slot id which has the sim that contains profile id
+     * @param [in] maxInFlight   Requests outstanding at a time, 1 to send one by one
+     */
+    FirewallRuleCache(std::shared_ptr<IFirewallManager> manager, int profileId,
+        SlotId slotId = DEFAULT_SLOT_ID, size_t maxInFlight = DEFAULT_MAX_IN_FLIGHT)
+       : state_(std::make_shared<State>()) {
+        state_->manager = manager;
+        state_->profileId = profileId;
+        state_->slotId = slotId;
+        state_->maxInFlight = maxInFlight ? maxInFlight : 1;
+    }
+
+    /**
+     * Reloads the cache from the firewall manager.
+     *
+     * @param [in] callback      optional callback to get the response of refresh
+     *
+     * @returns INVALIDSTATE if a transaction is in progress, or the status of
+     *          requestFirewallEntries
+     */
+    telux::common::Status refresh(telux::common::ResponseCallback callback = nullptr) {
+        auto state = state_;
+        if (!state->begin()) {
+            return telux::common::Status::INVALIDSTATE;
+        }
+        auto status = reload(state, [state, callback](telux::common::ErrorCode error) {
+            state->end();
+            if (callback) {
+                callback(error);
+            }
+        });
+        if (status != telux::common::Status::SUCCESS) {
+            state->end();
+        }
+        return status;
+    }
+
+    /**
+     * Applies the removes and adds of batch as one transaction. The cache is refreshed first
+     * if it is not valid.
+     *
+     * @param [in] batch         Rules to remove and add
+     * @param [in] callback      optional callback to get the result of the transaction
+     *
+     * @returns INVALIDSTATE if a transaction is in progress, INVALIDPARAM if an entry is
+     *          null, or the status of the first request
+     */
+    telux::common::Status apply(const FirewallBatch &batch,
+        FirewallTransactionCb callback = nullptr) {
+        for (const auto &entry : batch.getAdds()) {
+            if (!entry) {
+                return telux::common::Status::INVALIDPARAM;
+            }
+        }
+        auto removes = batch.getRemoves();
+        auto adds = batch.getAdds();
+        return start([removes, adds](State &state, Plan &plan) {
+            std::unordered_set<uint32_t> pending(removes.begin(), removes.end());
+            for (const auto &entry : state.entries) {
+                if (pending.erase(entry->getHandle())) {
+                    plan.removes.push_back(entry);
+                }
+            }
+            plan.adds = adds;
+            // Handles not in the profile
+            return pending.empty() ? telux::common::ErrorCode::SUCCESS
+                                   : telux::common::ErrorCode::INVALID_ARG;
+        }, callback);
+    }
+
+    /**
+     * Makes the rules of the profile equal to rules: rules in the cache but not in rules are
+     * removed, rules not in the cache are added, in one transaction. The cache is refreshed
+     * first if it is not valid.
+     *
+     * @param [in] rules         Complete requested rule set
+     * @param [in] callback      optional callback to get the result of the transaction
+     *
+     * @returns INVALIDSTATE if a transaction is in progress, INVALIDPARAM if an entry is
+     *          null, or the status of the first request
+     */
+    telux::common::Status sync(const std::vector<std::shared_ptr<IFirewallEntry>> &rules,
+        FirewallTransactionCb callback = nullptr) {
+        for (const auto &entry : rules) {
+            if (!entry) {
+                return telux::common::Status::INVALIDPARAM;
+            }
+        }
+        return start([rules](State &state, Plan &plan) {
+            // Requested rules by key; repeated rules are requested once
+            std::unordered_map<std::string, std::shared_ptr<IFirewallEntry>> wanted;
+            std::vector<std::string> order;
+            for (const auto &entry : rules) {
+                std::string key = getRuleKey(*entry);
+                if (wanted.emplace(key, entry).second) {
+                    order.push_back(std::move(key));
+                }
+            }
+            std::unordered_set<std::string> kept;
+            for (const auto &entry : state.entries) {
+                std::string key = getRuleKey(*entry);
+                if (wanted.count(key) && kept.insert(key).second) {
+                    ++plan.result.unchanged;
+                } else {
+                    plan.removes.push_back(entry);
+                }
+            }
+            for (const auto &key : order) {
+                if (!kept.count(key)) {
+                    plan.adds.push_back(wanted[key]);
+                }
+            }
+            return telux::common::ErrorCode::SUCCESS;
+        }, callback);
+    }
+
+    /**
+     * Rules of the profile as of the last transaction or refresh
+     */
+    std::vector<std::shared_ptr<IFirewallEntry>> getEntries() {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        return state_->entries;
+    }
+
+    /**
+     * Whether the cache was loaded and no request to reload it failed since
+     */
+    bool isValid() {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        return state_->valid;
+    }
+
+    bool isBusy() {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        return state_->busy;
+    }
+
+    /**
+     * Contents of a rule as a string: rules with the same key filter the same traffic.
+     * The handle is not part of the key.
+     */
+    static std::string getRuleKey(IFirewallEntry &entry) {
+        std::string key;
+        key.reserve(96);
+        auto field = [&key](long long value) {
+            key += std::to_string(value);
+            key += ',';
+        };
+        auto text = [&key](const std::string &value) {
+            key += value;
+            key += ',';
+        };
+        field(static_cast<int>(entry.getDirection()));
+        field(static_cast<int>(entry.getIpFamilyType()));
+        auto filter = entry.getIProtocolFilter();
+        if (!filter) {
+            return key;
+        }
+        field(filter->getIpProtocol());
+        const IpFamilyType family = filter->getIpFamily();
+        field(static_cast<int>(family));
+        if (family == IpFamilyType::IPV4 || family == IpFamilyType::IPV4V6) {
+            const IPv4Info v4 = filter->getIPv4Info();
+            text(v4.srcAddr);
+            text(v4.srcSubnetMask);
+            text(v4.destAddr);
+            text(v4.destSubnetMask);
+            field(v4.value);
+            field(v4.mask);
+            field(v4.nextProtoId);
+        }
+        if (family == IpFamilyType::IPV6 || family == IpFamilyType::IPV4V6) {
+            const IPv6Info v6 = filter->getIPv6Info();
+            text(v6.srcAddr);
+            field(v6.srcPrefixLen);
+            text(v6.destAddr);
+            field(v6.dstPrefixLen);
+            field(v6.nextProtoId);
+            field(v6.val);
+            field(v6.mask);
+            field(v6.flowLabel);
+            field(v6.natEnabled);
+        }
+        if (auto tcp = std::dynamic_pointer_cast<ITcpFilter>(filter)) {
+            const TcpInfo info = tcp->getTcpInfo();
+            key += "tcp,";
+            field(info.src.port);
+            field(info.src.range);
+            field(info.dest.port);
+            field(info.dest.range);
+        } else if (auto udp = std::dynamic_pointer_cast<IUdpFilter>(filter)) {
+            const UdpInfo info = udp->getUdpInfo();
+            key += "udp,";
+            field(info.src.port);
+            field(info.src.range);
+            field(info.dest.port);
+            field(info.dest.range);
+        } else if (auto icmp = std::dynamic_pointer_cast<IIcmpFilter>(filter)) {
+            const IcmpInfo info = icmp->getIcmpInfo();
+            key += "icmp,";
+            field(info.type);
+            field(info.code);
+        } else if (auto esp = std::dynamic_pointer_cast<IEspFilter>(filter)) {
+            key += "esp,";
+            field(esp->getEspInfo().spi);
+        }
+        return key;
+    }
+
+ private:
+    using EntryList = std::vector<std::shared_ptr<IFirewallEntry>>;
+
+    // Shared with the callbacks of outstanding requests
+    struct State {
+        std::mutex mtx;
+        std::shared_ptr<IFirewallManager> manager;
+        int profileId = 0;
+        SlotId slotId = DEFAULT_SLOT_ID;
+        size_t maxInFlight = 1;
+        EntryList entries;
+        bool valid = false;
+        bool busy = false;
+
+        bool begin() {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (busy) {
+                return false;
+            }
+            busy = true;
+            return true;
+        }
+
+        void end() {
+            std::lock_guard<std::mutex> lock(mtx);
+            busy = false;
+        }
+    };
+
+    struct Plan {
+        EntryList removes;
+        EntryList adds;
+        FirewallTransactionResult result;
+    };
+
+    using Planner = std::function<telux::common::ErrorCode(State &state, Plan &plan)>;
+    using ResultsCb = std::function<void(std::vector<telux::common::ErrorCode> results)>;
+
+    // Sends adds or removes with up to maxInFlight outstanding, optionally stopping at the
+    // first failure. Operations not sent are reported as CANCELLED.
+    class Pipeline : public std::enable_shared_from_this<Pipeline> {
+     public:
+        Pipeline(std::shared_ptr<State> state, bool add, EntryList entries, bool stopOnFailure,
+            uint32_t &requests, ResultsCb done)
+           : state_(state)
+           , add_(add)
+           , entries_(std::move(entries))
+           , stopOnFailure_(stopOnFailure)
+           , requests_(requests)
+           , results_(entries_.size(), telux::common::ErrorCode::CANCELLED)
+           , done_(done) {
+        }
+
+        void start() {
+            pump();
+        }
+
+     private:
+        void pump() {
+            for (;;) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    if (finished_) {
+                        return;
+                    }
+                    if (stopped_ || next_ == entries_.size()) {
+                        if (inFlight_ > 0) {
+                            return;
+                        }
+                        finished_ = true;
+                        auto results = results_;
+                        lock.unlock();
+                        done_(results);
+                        return;
+                    }
+                    if (inFlight_ >= state_->maxInFlight) {
+                        return;
+                    }
+                    index = next_++;
+                    ++inFlight_;
+                    ++requests_;
+                }
+                auto self = shared_from_this();
+                auto callback = [self, index](telux::common::ErrorCode error) {
+                    self->complete(index, error);
+                };
+                const auto status = add_
+                    ? state_->manager->addFirewallEntry(state_->profileId, entries_[index],
+                        callback, state_->slotId)
+                    : state_->manager->removeFirewallEntry(state_->profileId,
+                        entries_[index]->getHandle(), callback, state_->slotId);
+                if (status != telux::common::Status::SUCCESS) {
+                    complete(index, telux::common::ErrorCode::GENERIC_FAILURE);
+                }
+            }
+        }
+
+        void complete(size_t index, telux::common::ErrorCode error) {
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                results_[index] = error;
+                --inFlight_;
+                if (error != telux::common::ErrorCode::SUCCESS && stopOnFailure_) {
+                    stopped_ = true;
+                }
+            }
+            pump();
+        }
+
+        std::shared_ptr<State> state_;
+        const bool add_;
+        const EntryList entries_;
+        const bool stopOnFailure_;
+        // Counted under mtx_; read by the transaction once done_ was called
+        uint32_t &requests_;
+        std::mutex mtx_;
+        std::vector<telux::common::ErrorCode> results_;
+        size_t next_ = 0;
+        size_t inFlight_ = 0;
+        bool stopped_ = false;
+        bool finished_ = false;
+        ResultsCb done_;
+    };
+
+    // One transaction, from the plan to the final reload
+    struct Transaction {
+        std::shared_ptr<State> state;
+        Plan plan;
+        FirewallTransactionCb callback;
+        telux::common::ErrorCode error = telux::common::ErrorCode::SUCCESS;
+        // Rules removed and added so far
+        EntryList removed;
+        EntryList added;
+        // Handles before the transaction, to tell added rules apart from existing ones
+        std::unordered_set<uint32_t> handlesBefore;
+    };
+
+    static void runPipeline(std::shared_ptr<Transaction> tx, bool add, EntryList entries,
+        bool stopOnFailure, ResultsCb done) {
+        if (entries.empty()) {
+            done(std::vector<telux::common::ErrorCode>());
+            return;
+        }
+        auto pipeline = std::make_shared<Pipeline>(tx->state, add, std::move(entries),
+            stopOnFailure, tx->plan.result.requests, done);
+        pipeline->start();
+    }
+
+    // Requests the rules of the profile into the cache
+    static telux::common::Status reload(std::shared_ptr<State> state,
+        telux::common::ResponseCallback done) {
+        return state->manager->requestFirewallEntries(state->profileId,
+            [state, done](EntryList entries, telux::common::ErrorCode error) {
+                {
+                    std::lock_guard<std::mutex> lock(state->mtx);
+                    state->valid = (error == telux::common::ErrorCode::SUCCESS);
+                    if (state->valid) {
+                        state->entries = std::move(entries);
+                    }
+                }
+                done(error);
+            },
+            state->slotId);
+    }
+
+    telux::common::Status start(Planner planner, FirewallTransactionCb callback) {
+        auto state = state_;
+        if (!state->begin()) {
+            return telux::common::Status::INVALIDSTATE;
+        }
+        auto tx = std::make_shared<Transaction>();
+        tx->state = state;
+        tx->callback = callback;
+        bool valid;
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            valid = state->valid;
+        }
+        telux::common::Status status = telux::common::Status::SUCCESS;
+        if (valid) {
+            plan(tx, planner);
+        } else {
+            ++tx->plan.result.requests;
+            status = reload(state, [tx, planner](telux::common::ErrorCode error) {
+                if (error != telux::common::ErrorCode::SUCCESS) {
+                    finish(tx, error);
+                } else {
+                    plan(tx, planner);
+                }
+            });
+            if (status != telux::common::Status::SUCCESS) {
+                state->end();
+            }
+        }
+        return status;
+    }
+
+    static void plan(std::shared_ptr<Transaction> tx, Planner planner) {
+        telux::common::ErrorCode error;
+        {
+            std::lock_guard<std::mutex> lock(tx->state->mtx);
+            error = planner(*tx->state, tx->plan);
+            for (const auto &entry : tx->state->entries) {
+                tx->handlesBefore.insert(entry->getHandle());
+            }
+        }
+        if (error != telux::common::ErrorCode::SUCCESS) {
+            finish(tx, error);
+            return;
+        }
+        if (tx->plan.removes.empty() && tx->plan.adds.empty()) {
+            finish(tx, telux::common::ErrorCode::SUCCESS);
+            return;
+        }
+        runPipeline(tx, false, tx->plan.removes, true,
+            [tx](std::vector<telux::common::ErrorCode> results) {
+                collect(tx, tx->plan.removes, results, tx->removed);
+                if (tx->error != telux::common::ErrorCode::SUCCESS) {
+                    rollBack(tx);
+                    return;
+                }
+                runPipeline(tx, true, tx->plan.adds, true,
+                    [tx](std::vector<telux::common::ErrorCode> results) {
+                        collect(tx, tx->plan.adds, results, tx->added);
+                        if (tx->error != telux::common::ErrorCode::SUCCESS) {
+                            rollBack(tx);
+                            return;
+                        }
+                        tx->plan.result.removed = static_cast<uint32_t>(tx->removed.size());
+                        tx->plan.result.added = static_cast<uint32_t>(tx->added.size());
+                        finishWithReload(tx, telux::common::ErrorCode::SUCCESS);
+                    });
+            });
+    }
+
+    // Keeps the entries that were changed and the first error
+    static void collect(std::shared_ptr<Transaction> tx, const EntryList &entries,
+        const std::vector<telux::common::ErrorCode> &results, EntryList &changed) {
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (results[i] == telux::common::ErrorCode::SUCCESS) {
+                changed.push_back(entries[i]);
+            } else if (results[i] != telux::common::ErrorCode::CANCELLED
+                && tx->error == telux::common::ErrorCode::SUCCESS) {
+                tx->error = results[i];
+            }
+        }
+    }
+
+    // Removes the rules added by the transaction and adds back the rules it removed
+    static void rollBack(std::shared_ptr<Transaction> tx) {
+        tx->plan.result.rolledBack = true;
+        if (tx->added.empty()) {
+            restoreRemoved(tx);
+            return;
+        }
+        // The handles of the added rules are known from the rules of the profile only
+        ++tx->plan.result.requests;
+        auto status = reload(tx->state, [tx](telux::common::ErrorCode error) {
+            if (error != telux::common::ErrorCode::SUCCESS) {
+                tx->plan.result.rollbackFailed = true;
+                restoreRemoved(tx);
+                return;
+            }
+            std::unordered_map<std::string, size_t> addedKeys;
+            for (const auto &entry : tx->added) {
+                ++addedKeys[getRuleKey(*entry)];
+            }
+            EntryList undo;
+            {
+                std::lock_guard<std::mutex> lock(tx->state->mtx);
+                for (const auto &entry : tx->state->entries) {
+                    if (tx->handlesBefore.count(entry->getHandle())) {
+                        continue;
+                    }
+                    auto it = addedKeys.find(getRuleKey(*entry));
+                    if (it != addedKeys.end() && it->second > 0) {
+                        --it->second;
+                        undo.push_back(entry);
+                    }
+                }
+            }
+            if (undo.size() != tx->added.size()) {
+                tx->plan.result.rollbackFailed = true;
+            }
+            runPipeline(tx, false, undo, false,
+                [tx](std::vector<telux::common::ErrorCode> results) {
+                    for (const auto result : results) {
+                        if (result != telux::common::ErrorCode::SUCCESS) {
+                            tx->plan.result.rollbackFailed = true;
+                        }
+                    }
+                    restoreRemoved(tx);
+                });
+        });
+        if (status != telux::common::Status::SUCCESS) {
+            tx->plan.result.rollbackFailed = true;
+            restoreRemoved(tx);
+        }
+    }
+
+    static void restoreRemoved(std::shared_ptr<Transaction> tx) {
+        runPipeline(tx, true, tx->removed, false,
+            [tx](std::vector<telux::common::ErrorCode> results) {
+                for (const auto result : results) {
+                    if (result != telux::common::ErrorCode::SUCCESS) {
+                        tx->plan.result.rollbackFailed = true;
+                    }
+                }
+                finishWithReload(tx, tx->error);
+            });
+    }
+
+    static void finishWithReload(std::shared_ptr<Transaction> tx,
+        telux::common::ErrorCode error) {
+        ++tx->plan.result.requests;
+        auto status = reload(tx->state, [tx, error](telux::common::ErrorCode) {
+            finish(tx, error);
+        });
+        if (status != telux::common::Status::SUCCESS) {
+            {
+                std::lock_guard<std::mutex> lock(tx->state->mtx);
+                tx->state->valid = false;
+            }
+            finish(tx, error);
+        }
+    }
+
+    static void finish(std::shared_ptr<Transaction> tx, telux::common::ErrorCode error) {
+        tx->state->end();
+        if (tx->callback) {
+            tx->callback(tx->plan.result, error);
+        }
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+/** @} */ /* end_addtogroup telematics_data_net */
+}
+}
+}
+#endif
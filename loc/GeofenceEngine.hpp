@@ -0,0 +1,649 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       GeofenceEngine.hpp
+ *
+ * @brief      Evaluation of large sets of circular and polygonal geofences against location
+ *             fixes, with enter, exit and dwell events.
+ */
+
+#ifndef TELUX_LOC_GEOFENCEENGINE_HPP
+#define TELUX_LOC_GEOFENCEENGINE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/loc/LocationDefines.hpp>
+#include <telux/loc/LocationListener.hpp>
+
+namespace telux {
+namespace loc {
+
+/** @addtogroup telematics_location
+ * @{ */
+
+/**
+ * A position in degrees.
+ */
+struct GeofencePoint {
+    double latitude;
+    double longitude;
+};
+
+/**
+ * Geofence event types, bits of @ref GeofenceEventMask.
+ */
+enum GeofenceEventType : uint32_t {
+    GEOFENCE_ENTER = (1 << 0), /**< The position moved into the fence */
+    GEOFENCE_EXIT = (1 << 1),  /**< The position moved out of the fence by the hysteresis */
+    GEOFENCE_DWELL = (1 << 2)  /**< The position stayed in the fence for its dwell time */
+};
+
+using GeofenceEventMask = uint32_t;
+
+constexpr GeofenceEventMask GEOFENCE_EVENT_ALL = 0x7;
+
+/**
+ * A circular or polygonal geofence.
+ */
+struct Geofence {
+    /** Identifier chosen by the application, unique in an engine */
+    uint32_t id = 0;
+    /** Corners of a polygon in order, or the center of a circle */
+    std::vector<GeofencePoint> vertices;
+    /** Radius of a circle in meters, 0 for a polygon */
+    double radius = 0;
+    /** Time inside the fence after which a GEOFENCE_DWELL event is reported, 0 for none */
+    uint32_t dwellTimeMs = 0;
+    /** Events reported for the fence */
+    GeofenceEventMask events = GEOFENCE_EVENT_ALL;
+
+    static Geofence circle(uint32_t id, GeofencePoint center, double radius,
+        uint32_t dwellTimeMs = 0) {
+        Geofence fence;
+        fence.id = id;
+        fence.vertices.push_back(center);
+        fence.radius = radius;
+        fence.dwellTimeMs = dwellTimeMs;
+        return fence;
+    }
+
+    static Geofence polygon(uint32_t id, std::vector<GeofencePoint> vertices,
+        uint32_t dwellTimeMs = 0) {
+        Geofence fence;
+        fence.id = id;
+        fence.vertices = std::move(vertices);
+        fence.dwellTimeMs = dwellTimeMs;
+        return fence;
+    }
+
+    bool isCircle() const {
+        return radius > 0;
+    }
+};
+
+/**
+ * A transition of the position with respect to a geofence.
+ */
+struct GeofenceEvent {
+    uint32_t id;             /**< Geofence::id */
+    GeofenceEventType type;
+    uint64_t timestamp;      /**< Timestamp of the fix, in milliseconds since the epoch */
+    GeofencePoint position;  /**< Position of the fix */
+};
+
+/**
+ * @brief Listener of geofence events.
+ */
+class IGeofenceListener {
+ public:
+    /**
+     * Events caused by one fix, in the order of the fences evaluated. Called on the thread
+     * that reported the fix.
+     */
+    virtual void onGeofenceEvents(const std::vector<GeofenceEvent> &events) {
+    }
+
+    virtual ~IGeofenceListener() {
+    }
+};
+
+/**
+ * @brief GeofenceEngine evaluates location fixes against a large set of geofences and reports
+ * enter, exit and dwell events.
+ *
+ * Fences are indexed in a grid of latitude and longitude cells, so a fix is tested exactly
+ * only against the fences whose bounding box covers its cell and the fences the position is
+ * currently in; the cost of a fix does not grow with the number of fences elsewhere. Fences
+ * spanning more than Config::maxCellsPerFence cells are kept out of the grid and tested on
+ * every fix.
+ *
+ * Detection is incremental: each fence keeps whether the position is inside it. The position
+ * enters a fence when it is inside the boundary, and exits it only once it is outside by the
+ * hysteresis, widened by the horizontal uncertainty of the fix if configured, so that fixes
+ * jittering across a boundary do not report repeated transitions. A dwell event is reported
+ * once per visit when the position stayed inside for the dwell time of the fence. Fences added
+ * while the position is inside them report an enter event with the next fix.
+ *
+ * The engine is an @ref telux::loc::ILocationListener: register it with the location manager
+ * to feed it basic, detailed or fused engine fixes. Fences are added and removed in batches,
+ * each batch indexed under one lock. Events of a fix are delivered in one call.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class GeofenceEngine : public ILocationListener {
+ public:
+    /** Meters per degree of latitude. */
+    static constexpr double METERS_PER_DEGREE = 111195.0;
+
+    /**
+     * Engine parameters.
+     */
+    struct Config {
+        /** Distance in meters outside a fence at which the position exits it */
+        double hysteresis = 10.0;
+        /** Added to the hysteresis per meter of horizontal uncertainty of a fix */
+        double uncertaintyFactor = 0.0;
+        /** Size of the grid cells in degrees */
+        double cellSize = 0.01;
+        /** Fences covering more cells are not indexed and tested on every fix */
+        uint32_t maxCellsPerFence = 1024;
+    };
+
+    /**
+     * Evaluation counters.
+     */
+    struct Stats {
+        uint64_t fixes;       /**< Fixes evaluated */
+        uint64_t candidates;  /**< Fences looked at, summed over the fixes */
+        uint64_t tests;       /**< Exact distance computations, summed over the fixes */
+        uint64_t events;      /**< Events reported */
+        uint32_t fences;      /**< Fences in the engine */
+        uint32_t cells;       /**< Grid cells holding fences */
+        uint32_t unindexed;   /**< Fences tested on every fix */
+    };
+
+    GeofenceEngine()
+       : config_() {
+    }
+
+    explicit GeofenceEngine(const Config &config)
+       : config_(config) {
+    }
+
+    GeofenceEngine(const GeofenceEngine &) = delete;
+    GeofenceEngine &operator=(const GeofenceEngine &) = delete;
+
+    /**
+     * Adds fences. Either all fences are added or none.
+     *
+     * @returns INVALIDPARAM if a fence has too few vertices, a negative radius or an
+     * identifier already in use or repeated in the batch
+     */
+    telux::common::Status addGeofences(const std::vector<Geofence> &fences) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unordered_set<uint32_t> batch;
+        for (const auto &fence : fences) {
+            if ((fence.isCircle() ? fence.vertices.size() != 1 : fence.vertices.size() < 3)
+                || fence.radius < 0 || slotOf_.count(fence.id) || !batch.insert(fence.id).second) {
+                return telux::common::Status::INVALIDPARAM;
+            }
+        }
+        for (const auto &fence : fences) {
+            uint32_t slot;
+            if (freeSlots_.empty()) {
+                slot = static_cast<uint32_t>(slots_.size());
+                slots_.emplace_back();
+            } else {
+                slot = freeSlots_.back();
+                freeSlots_.pop_back();
+            }
+            slots_[slot].reset(new Fence(fence));
+            slotOf_[fence.id] = slot;
+            index(slot);
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Removes fences. No exit event is reported for a removed fence.
+     *
+     * @returns NOSUCH if an identifier is unknown; the other fences are removed
+     */
+    telux::common::Status removeGeofences(const std::vector<uint32_t> &ids) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        telux::common::Status status = telux::common::Status::SUCCESS;
+        for (const uint32_t id : ids) {
+            auto it = slotOf_.find(id);
+            if (it == slotOf_.end()) {
+                status = telux::common::Status::NOSUCH;
+                continue;
+            }
+            const uint32_t slot = it->second;
+            slotOf_.erase(it);
+            unindex(slot);
+            inside_.erase(std::remove(inside_.begin(), inside_.end(), slot), inside_.end());
+            slots_[slot].reset();
+            freeSlots_.push_back(slot);
+        }
+        return status;
+    }
+
+    /**
+     * @returns INVALIDPARAM if listener is expired, ALREADY if it is registered
+     */
+    telux::common::Status registerListener(std::weak_ptr<IGeofenceListener> listener) {
+        if (listener.expired()) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        for (const auto &registered : listeners_) {
+            if (!registered.owner_before(listener) && !listener.owner_before(registered)) {
+                return telux::common::Status::ALREADY;
+            }
+        }
+        listeners_.push_back(listener);
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * @returns NOSUCH if listener is not registered
+     */
+    telux::common::Status deregisterListener(std::weak_ptr<IGeofenceListener> listener) {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+            if (!it->owner_before(listener) && !listener.owner_before(*it)) {
+                listeners_.erase(it);
+                return telux::common::Status::SUCCESS;
+            }
+        }
+        return telux::common::Status::NOSUCH;
+    }
+
+    /**
+     * Evaluates a fix and delivers its events to the listeners.
+     *
+     * @param [in] timestamp             - time of the fix in milliseconds
+     * @param [in] position              - position of the fix
+     * @param [in] horizontalUncertainty - in meters, 0 if unknown
+     * @param [out] events               - if not nullptr, receives the events of the fix
+     *
+     * @returns the number of events
+     */
+    size_t updatePosition(uint64_t timestamp, GeofencePoint position,
+        float horizontalUncertainty = 0, std::vector<GeofenceEvent> *events = nullptr) {
+        std::vector<GeofenceEvent> local;
+        std::vector<GeofenceEvent> &out = events ? *events : local;
+        out.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            evaluate(timestamp, position, horizontalUncertainty, out);
+        }
+        if (!out.empty()) {
+            deliver(out);
+        }
+        return out.size();
+    }
+
+    /**
+     * Whether the position is inside the fence as of the last fix.
+     */
+    bool isInside(uint32_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = slotOf_.find(id);
+        return it != slotOf_.end() && slots_[it->second]->inside;
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats stats = stats_;
+        stats.fences = static_cast<uint32_t>(slotOf_.size());
+        stats.cells = static_cast<uint32_t>(grid_.size());
+        stats.unindexed = static_cast<uint32_t>(unindexed_.size());
+        return stats;
+    }
+
+    /**
+     * Signed distance in meters from position to the boundary of fence, negative inside.
+     * Fences are evaluated on a local flat projection, accurate for fences up to some tens
+     * of kilometers.
+     */
+    static double signedDistance(const Geofence &fence, GeofencePoint position) {
+        const Projection projection(fence.vertices[0]);
+        if (fence.isCircle()) {
+            double x, y;
+            projection.project(position, x, y);
+            return std::sqrt(x * x + y * y) - fence.radius;
+        }
+        std::vector<double> xs, ys;
+        projectPolygon(fence, projection, xs, ys);
+        return polygonDistance(xs, ys, projection, position);
+    }
+
+    void onBasicLocationUpdate(const std::shared_ptr<ILocationInfoBase> &info) override {
+        update(info.get());
+    }
+
+    void onDetailedLocationUpdate(const std::shared_ptr<ILocationInfoEx> &info) override {
+        update(info.get());
+    }
+
+    void onDetailedEngineLocationUpdate(
+        const std::vector<std::shared_ptr<ILocationInfoEx>> &infos) override {
+        for (const auto &info : infos) {
+            if (info && info->getLocOutputEngType() == LOC_OUTPUT_ENGINE_FUSED) {
+                update(info.get());
+            }
+        }
+    }
+
+ private:
+    // Equirectangular projection to meters around an origin
+    struct Projection {
+        explicit Projection(GeofencePoint origin)
+           : origin(origin)
+           , metersPerDegreeLongitude(
+                 METERS_PER_DEGREE * std::max(std::cos(origin.latitude * M_PI / 180), 1e-6)) {
+        }
+
+        void project(GeofencePoint p, double &x, double &y) const {
+            double dLon = p.longitude - origin.longitude;
+            if (dLon > 180) {
+                dLon -= 360;
+            } else if (dLon < -180) {
+                dLon += 360;
+            }
+            x = dLon * metersPerDegreeLongitude;
+            y = (p.latitude - origin.latitude) * METERS_PER_DEGREE;
+        }
+
+        GeofencePoint origin;
+        double metersPerDegreeLongitude;
+    };
+
+    struct Fence {
+        explicit Fence(const Geofence &fence)
+           : def(fence)
+           , projection(fence.vertices[0]) {
+            if (fence.isCircle()) {
+                const double dLat = fence.radius / METERS_PER_DEGREE;
+                const double dLon = fence.radius / projection.metersPerDegreeLongitude;
+                minLat = fence.vertices[0].latitude - dLat;
+                maxLat = fence.vertices[0].latitude + dLat;
+                minLon = fence.vertices[0].longitude - dLon;
+                maxLon = fence.vertices[0].longitude + dLon;
+            } else {
+                projectPolygon(fence, projection, xs, ys);
+                minLat = maxLat = fence.vertices[0].latitude;
+                minLon = maxLon = fence.vertices[0].longitude;
+                for (const auto &v : fence.vertices) {
+                    minLat = std::min(minLat, v.latitude);
+                    maxLat = std::max(maxLat, v.latitude);
+                    minLon = std::min(minLon, v.longitude);
+                    maxLon = std::max(maxLon, v.longitude);
+                }
+            }
+            // Across the antimeridian the box spans all longitudes
+            if (minLon < -180 || maxLon > 180 || maxLon - minLon >= 180) {
+                minLon = -180;
+                maxLon = 180;
+            }
+        }
+
+        double distance(GeofencePoint position) const {
+            if (def.isCircle()) {
+                double x, y;
+                projection.project(position, x, y);
+                return std::sqrt(x * x + y * y) - def.radius;
+            }
+            return polygonDistance(xs, ys, projection, position);
+        }
+
+        bool inBox(GeofencePoint p) const {
+            return p.latitude >= minLat && p.latitude <= maxLat && p.longitude >= minLon
+                && p.longitude <= maxLon;
+        }
+
+        Geofence def;
+        Projection projection;
+        std::vector<double> xs;
+        std::vector<double> ys;
+        double minLat, maxLat, minLon, maxLon;
+        std::vector<uint64_t> cells;
+        bool indexed = false;
+        bool inside = false;
+        bool dwellReported = false;
+        uint64_t enteredAt = 0;
+        uint64_t visit = 0;
+    };
+
+    static void projectPolygon(const Geofence &fence, const Projection &projection,
+        std::vector<double> &xs, std::vector<double> &ys) {
+        xs.resize(fence.vertices.size());
+        ys.resize(fence.vertices.size());
+        for (size_t i = 0; i < fence.vertices.size(); ++i) {
+            projection.project(fence.vertices[i], xs[i], ys[i]);
+        }
+    }
+
+    static double polygonDistance(const std::vector<double> &xs, const std::vector<double> &ys,
+        const Projection &projection, GeofencePoint position) {
+        double px, py;
+        projection.project(position, px, py);
+        bool inside = false;
+        double best = INFINITY;
+        const size_t n = xs.size();
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            const double xi = xs[i], yi = ys[i], xj = xs[j], yj = ys[j];
+            if ((yi > py) != (yj > py) && px < (xj - xi) * (py - yi) / (yj - yi) + xi) {
+                inside = !inside;
+            }
+            // Squared distance to the edge from j to i
+            const double ex = xi - xj, ey = yi - yj;
+            const double length = ex * ex + ey * ey;
+            double t = length > 0 ? ((px - xj) * ex + (py - yj) * ey) / length : 0;
+            t = std::min(1.0, std::max(0.0, t));
+            const double dx = xj + t * ex - px, dy = yj + t * ey - py;
+            best = std::min(best, dx * dx + dy * dy);
+        }
+        const double distance = std::sqrt(best);
+        return inside ? -distance : distance;
+    }
+
+    int64_t cellRow(double latitude) const {
+        return static_cast<int64_t>(std::floor((latitude + 90) / config_.cellSize));
+    }
+
+    int64_t cellColumn(double longitude) const {
+        return static_cast<int64_t>(std::floor((longitude + 180) / config_.cellSize));
+    }
+
+    static uint64_t cellKey(int64_t row, int64_t column) {
+        return (static_cast<uint64_t>(row) << 32) | static_cast<uint32_t>(column);
+    }
+
+    // Enters the fence into the cells its bounding box covers, or into the unindexed fences
+    void index(uint32_t slot) {
+        Fence &fence = *slots_[slot];
+        const int64_t row0 = cellRow(fence.minLat), row1 = cellRow(fence.maxLat);
+        const int64_t column0 = cellColumn(fence.minLon), column1 = cellColumn(fence.maxLon);
+        const double cells = static_cast<double>(row1 - row0 + 1) * (column1 - column0 + 1);
+        if (fence.maxLon - fence.minLon >= 180 || cells > config_.maxCellsPerFence) {
+            unindexed_.push_back(slot);
+            return;
+        }
+        fence.indexed = true;
+        fence.cells.reserve(static_cast<size_t>(cells));
+        for (int64_t row = row0; row <= row1; ++row) {
+            for (int64_t column = column0; column <= column1; ++column) {
+                const uint64_t key = cellKey(row, column);
+                grid_[key].push_back(slot);
+                fence.cells.push_back(key);
+            }
+        }
+    }
+
+    void unindex(uint32_t slot) {
+        Fence &fence = *slots_[slot];
+        if (!fence.indexed) {
+            unindexed_.erase(std::remove(unindexed_.begin(), unindexed_.end(), slot),
+                unindexed_.end());
+            return;
+        }
+        for (const uint64_t key : fence.cells) {
+            auto it = grid_.find(key);
+            auto &list = it->second;
+            list.erase(std::remove(list.begin(), list.end(), slot), list.end());
+            if (list.empty()) {
+                grid_.erase(it);
+            }
+        }
+    }
+
+    void evaluate(uint64_t timestamp, GeofencePoint position, float horizontalUncertainty,
+        std::vector<GeofenceEvent> &events) {
+        const double exitDistance = config_.hysteresis
+            + config_.uncertaintyFactor * std::max(0.0f, horizontalUncertainty);
+        const uint64_t visit = ++stats_.fixes;
+        auto test = [&](uint32_t slot) {
+            Fence &fence = *slots_[slot];
+            if (fence.visit == visit) {
+                return;
+            }
+            fence.visit = visit;
+            ++stats_.candidates;
+            // Outside the bounding box the position cannot enter
+            if (!fence.inside && !fence.inBox(position)) {
+                return;
+            }
+            ++stats_.tests;
+            const double distance = fence.distance(position);
+            if (!fence.inside && distance <= 0) {
+                fence.inside = true;
+                fence.dwellReported = false;
+                fence.enteredAt = timestamp;
+                inside_.push_back(slot);
+                report(fence, GEOFENCE_ENTER, timestamp, position, events);
+            } else if (fence.inside && distance >= exitDistance) {
+                fence.inside = false;
+                report(fence, GEOFENCE_EXIT, timestamp, position, events);
+            }
+            if (fence.inside && fence.def.dwellTimeMs && !fence.dwellReported
+                && timestamp >= fence.enteredAt + fence.def.dwellTimeMs) {
+                fence.dwellReported = true;
+                report(fence, GEOFENCE_DWELL, timestamp, position, events);
+            }
+        };
+
+        auto cell = grid_.find(cellKey(cellRow(position.latitude),
+            cellColumn(position.longitude)));
+        if (cell != grid_.end()) {
+            for (const uint32_t slot : cell->second) {
+                test(slot);
+            }
+        }
+        for (const uint32_t slot : unindexed_) {
+            test(slot);
+        }
+        // Fences entered above are marked visited
+        const size_t insideCount = inside_.size();
+        for (size_t i = 0; i < insideCount; ++i) {
+            test(inside_[i]);
+        }
+        inside_.erase(std::remove_if(inside_.begin(), inside_.end(),
+                          [this](uint32_t slot) { return !slots_[slot]->inside; }),
+            inside_.end());
+        stats_.events += events.size();
+    }
+
+    static void report(const Fence &fence, GeofenceEventType type, uint64_t timestamp,
+        GeofencePoint position, std::vector<GeofenceEvent> &events) {
+        if (fence.def.events & type) {
+            events.push_back(GeofenceEvent{fence.def.id, type, timestamp, position});
+        }
+    }
+
+    void deliver(const std::vector<GeofenceEvent> &events) {
+        std::vector<std::shared_ptr<IGeofenceListener>> listeners;
+        {
+            std::lock_guard<std::mutex> lock(listenerMutex_);
+            for (const auto &weak : listeners_) {
+                if (auto listener = weak.lock()) {
+                    listeners.push_back(listener);
+                }
+            }
+        }
+        for (const auto &listener : listeners) {
+            listener->onGeofenceEvents(events);
+        }
+    }
+
+    void update(ILocationInfoBase *info) {
+        if (info && (info->getLocationInfoValidity() & HAS_LAT_LONG_BIT)) {
+            const float uncertainty = (info->getLocationInfoValidity()
+                                          & HAS_HORIZONTAL_ACCURACY_BIT)
+                ? info->getHorizontalUncertainty() : 0;
+            updatePosition(info->getTimeStamp(),
+                GeofencePoint{info->getLatitude(), info->getLongitude()}, uncertainty);
+        }
+    }
+
+    const Config config_;
+
+    std::mutex mutex_;
+    // Fences by slot; slots of removed fences are reused
+    std::vector<std::unique_ptr<Fence>> slots_;
+    std::vector<uint32_t> freeSlots_;
+    std::unordered_map<uint32_t, uint32_t> slotOf_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> grid_;
+    std::vector<uint32_t> unindexed_;
+    // Fences the position is in
+    std::vector<uint32_t> inside_;
+    Stats stats_ = Stats();
+
+    std::mutex listenerMutex_;
+    std::vector<std::weak_ptr<IGeofenceListener>> listeners_;
+};
+
+constexpr double GeofenceEngine::METERS_PER_DEGREE;
+
+/** @} */ /* end_addtogroup telematics_location */
+}  // namespace loc
+}  // namespace telux
+
+#endif  // TELUX_LOC_GEOFENCEENGINE_HPP
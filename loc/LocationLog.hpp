@@ -0,0 +1,1372 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       LocationLog.hpp
+ *
+ * @brief      Recording of location callbacks into a compact binary log, and an
+ *             ILocationManager that replays a log into applications at the recorded pace, N
+ *             times faster or as fast as possible.
+ */
+
+#ifndef TELUX_LOC_LOCATIONLOG_HPP
+#define TELUX_LOC_LOCATIONLOG_HPP
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/loc/LocationDefines.hpp>
+#include <telux/loc/LocationListener.hpp>
+#include <telux/loc/LocationManager.hpp>
+#include <telux/loc/LocationReport.hpp>
+
+namespace telux {
+namespace loc {
+
+/** @addtogroup telematics_location
+ * @{ */
+
+/**
+ * Record types of a location log, one per @ref telux::loc::ILocationListener callback.
+ */
+enum LocationLogRecordType : uint32_t {
+    LOC_LOG_BASIC_FIX = 1,     /**< onBasicLocationUpdate: CompactLocationFix */
+    LOC_LOG_DETAILED_FIX = 2,  /**< onDetailedLocationUpdate: CompactLocationFix */
+    LOC_LOG_ENGINE_FIXES = 3,  /**< onDetailedEngineLocationUpdate: count, LoggedEngineFix[] */
+    LOC_LOG_SV_INFO = 4,       /**< onGnssSVInfo: LoggedSvInfoHeader, CompactSvInfo[] */
+    LOC_LOG_SIGNAL_INFO = 5,   /**< onGnssSignalInfo: GnssData */
+    LOC_LOG_NMEA = 6,          /**< onGnssNmeaInfo: uint64_t timestamp, characters */
+    LOC_LOG_MEASUREMENTS = 7,  /**< onGnssMeasurementsInfo: LoggedMeasurementsHeader, data[] */
+    LOC_LOG_CAPABILITIES = 8   /**< onCapabilitiesInfo: LocCapability */
+};
+
+/**
+ * Start of a location log file. The log is in the byte order and structure layout of the
+ * machine that recorded it.
+ */
+struct LocationLogFileHeader {
+    char magic[8];     /**< "TLXLOCLG" */
+    uint32_t version;  /**< LocationLogWriter::VERSION */
+    uint32_t recordHeaderSize;
+};
+
+/**
+ * Header of each record, followed by size bytes of payload.
+ */
+struct LocationLogRecordHeader {
+    uint32_t type;      /**< LocationLogRecordType */
+    uint32_t size;      /**< Payload size in bytes */
+    uint64_t offsetNs;  /**< Monotonic time of the callback since the recording started */
+};
+
+/** One fix of LOC_LOG_ENGINE_FIXES. */
+struct LoggedEngineFix {
+    LocationAggregationType engineType;
+    PositioningEngine engineMask;
+    CompactLocationFix fix;
+};
+
+/** Payload header of LOC_LOG_SV_INFO. */
+struct LoggedSvInfoHeader {
+    AltitudeType altitudeType;
+    uint32_t count;
+};
+
+/** Payload header of LOC_LOG_MEASUREMENTS. */
+struct LoggedMeasurementsHeader {
+    GnssMeasurementsClock clock;
+    uint32_t isNHz;
+    uint32_t count;
+};
+
+/**
+ * @brief LocationLogWriter appends records to a location log file. Thread safe.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationLogWriter {
+ public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+    LocationLogWriter() = default;
+
+    ~LocationLogWriter() {
+        close();
+    }
+
+    LocationLogWriter(const LocationLogWriter &) = delete;
+    LocationLogWriter &operator=(const LocationLogWriter &) = delete;
+
+    /**
+     * Creates or truncates the log at path.
+     *
+     * @returns FAILED if the file cannot be written
+     */
+    telux::common::Status open(const std::string &path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closeLocked();
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            return telux::common::Status::FAILED;
+        }
+        buffer_.resize(BUFFER_SIZE);
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+        LocationLogFileHeader header;
+        std::memcpy(header.magic, "TLXLOCLG", sizeof(header.magic));
+        header.version = VERSION;
+        header.recordHeaderSize = sizeof(LocationLogRecordHeader);
+        if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+            closeLocked();
+            return telux::common::Status::FAILED;
+        }
+        bytes_ = sizeof(header);
+        records_ = 0;
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Appends a record whose payload is head followed by tail.
+     */
+    telux::common::Status append(LocationLogRecordType type, uint64_t offsetNs,
+        const void *head, size_t headSize, const void *tail = nullptr, size_t tailSize = 0) {
+        LocationLogRecordHeader header;
+        header.type = type;
+        header.size = static_cast<uint32_t>(headSize + tailSize);
+        header.offsetNs = offsetNs;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_ == nullptr) {
+            return telux::common::Status::INVALIDSTATE;
+        }
+        if (std::fwrite(&header, sizeof(header), 1, file_) != 1
+            || (headSize && std::fwrite(head, headSize, 1, file_) != 1)
+            || (tailSize && std::fwrite(tail, tailSize, 1, file_) != 1)) {
+            return telux::common::Status::FAILED;
+        }
+        bytes_ += sizeof(header) + header.size;
+        ++records_;
+        return telux::common::Status::SUCCESS;
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_) {
+            std::fflush(file_);
+        }
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closeLocked();
+    }
+
+    uint64_t getRecordCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return records_;
+    }
+
+    uint64_t getBytesWritten() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+ private:
+    void closeLocked() {
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    std::mutex mutex_;
+    std::FILE *file_ = nullptr;
+    std::vector<char> buffer_;
+    uint64_t bytes_ = 0;
+    uint64_t records_ = 0;
+};
+
+/**
+ * @brief A record read from a location log. The typed getters return nullptr or false if the
+ * record is of another type or its payload is inconsistent.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationLogRecord {
+ public:
+    LocationLogRecordType getType() const {
+        return static_cast<LocationLogRecordType>(header_.type);
+    }
+
+    uint64_t getOffsetNs() const {
+        return header_.offsetNs;
+    }
+
+    size_t getSize() const {
+        return header_.size;
+    }
+
+    const uint8_t *getPayload() const {
+        return reinterpret_cast<const uint8_t *>(storage_.data());
+    }
+
+    /**
+     * The fix of LOC_LOG_BASIC_FIX or LOC_LOG_DETAILED_FIX.
+     */
+    const CompactLocationFix *getFix() const {
+        if ((getType() != LOC_LOG_BASIC_FIX && getType() != LOC_LOG_DETAILED_FIX)
+            || getSize() != sizeof(CompactLocationFix)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const CompactLocationFix *>(getPayload());
+    }
+
+    const LoggedEngineFix *getEngineFixes(uint32_t &count) const {
+        if (getType() != LOC_LOG_ENGINE_FIXES || getSize() < sizeof(uint64_t)) {
+            return nullptr;
+        }
+        std::memcpy(&count, getPayload(), sizeof(count));
+        if (getSize() != sizeof(uint64_t) + count * sizeof(LoggedEngineFix)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const LoggedEngineFix *>(getPayload() + sizeof(uint64_t));
+    }
+
+    const CompactSvInfo *getSvInfo(LoggedSvInfoHeader &header) const {
+        if (getType() != LOC_LOG_SV_INFO || getSize() < sizeof(header)) {
+            return nullptr;
+        }
+        std::memcpy(&header, getPayload(), sizeof(header));
+        if (getSize() != sizeof(header) + header.count * sizeof(CompactSvInfo)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const CompactSvInfo *>(getPayload() + sizeof(header));
+    }
+
+    const GnssData *getSignalInfo() const {
+        if (getType() != LOC_LOG_SIGNAL_INFO || getSize() != sizeof(GnssData)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const GnssData *>(getPayload());
+    }
+
+    bool getNmea(uint64_t &timestamp, const char *&sentence, size_t &length) const {
+        if (getType() != LOC_LOG_NMEA || getSize() < sizeof(timestamp)) {
+            return false;
+        }
+        std::memcpy(&timestamp, getPayload(), sizeof(timestamp));
+        sentence = reinterpret_cast<const char *>(getPayload() + sizeof(timestamp));
+        length = getSize() - sizeof(timestamp);
+        return true;
+    }
+
+    const GnssMeasurementsData *getMeasurements(LoggedMeasurementsHeader &header) const {
+        if (getType() != LOC_LOG_MEASUREMENTS || getSize() < sizeof(header)) {
+            return nullptr;
+        }
+        std::memcpy(&header, getPayload(), sizeof(header));
+        if (getSize() != sizeof(header) + header.count * sizeof(GnssMeasurementsData)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const GnssMeasurementsData *>(getPayload() + sizeof(header));
+    }
+
+    bool getCapabilities(LocCapability &capabilities) const {
+        if (getType() != LOC_LOG_CAPABILITIES || getSize() != sizeof(capabilities)) {
+            return false;
+        }
+        std::memcpy(&capabilities, getPayload(), sizeof(capabilities));
+        return true;
+    }
+
+ private:
+    friend class LocationLogReader;
+
+    LocationLogRecordHeader header_ = {};
+    // 8 byte aligned payload, reused from record to record
+    std::vector<uint64_t> storage_;
+};
+
+/**
+ * @brief LocationLogReader reads the records of a location log in order.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationLogReader {
+ public:
+    /** Larger records are taken as corruption. */
+    static constexpr uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+    LocationLogReader() = default;
+
+    ~LocationLogReader() {
+        close();
+    }
+
+    LocationLogReader(const LocationLogReader &) = delete;
+    LocationLogReader &operator=(const LocationLogReader &) = delete;
+
+    /**
+     * @returns FAILED if the file cannot be read, INVALIDPARAM if it is not a location log of
+     * a supported version
+     */
+    telux::common::Status open(const std::string &path) {
+        close();
+        file_ = std::fopen(path.c_str(), "rb");
+        if (file_ == nullptr) {
+            return telux::common::Status::FAILED;
+        }
+        LocationLogFileHeader header;
+        if (std::fread(&header, sizeof(header), 1, file_) != 1
+            || std::memcmp(header.magic, "TLXLOCLG", sizeof(header.magic)) != 0
+            || header.version != LocationLogWriter::VERSION
+            || header.recordHeaderSize != sizeof(LocationLogRecordHeader)) {
+            close();
+            return telux::common::Status::INVALIDPARAM;
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Reads the next record into record, reusing its memory.
+     *
+     * @returns false at the end of the log, or at a truncated or corrupt record (see
+     * @ref isTruncated)
+     */
+    bool next(LocationLogRecord &record) {
+        if (file_ == nullptr) {
+            return false;
+        }
+        LocationLogRecordHeader header;
+        const size_t read = std::fread(&header, 1, sizeof(header), file_);
+        if (read != sizeof(header)) {
+            truncated_ = (read != 0);
+            return false;
+        }
+        if (header.size > MAX_RECORD_SIZE) {
+            truncated_ = true;
+            return false;
+        }
+        record.header_ = header;
+        record.storage_.resize((header.size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        if (header.size && std::fread(record.storage_.data(), header.size, 1, file_) != 1) {
+            truncated_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Whether reading stopped at an incomplete or corrupt record rather than at the end.
+     */
+    bool isTruncated() const {
+        return truncated_;
+    }
+
+    void rewind() {
+        if (file_) {
+            std::fseek(file_, sizeof(LocationLogFileHeader), SEEK_SET);
+            truncated_ = false;
+        }
+    }
+
+    void close() {
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+        truncated_ = false;
+    }
+
+ private:
+    std::FILE *file_ = nullptr;
+    bool truncated_ = false;
+};
+
+/**
+ * @brief ILocationInfoEx on a CompactLocationFix, the fixes of a replayed log. Fields outside
+ * CompactLocationFix read as zero or empty.
+ */
+class LoggedLocationInfo : public ILocationInfoEx {
+ public:
+    explicit LoggedLocationInfo(const CompactLocationFix &fix,
+        LocationAggregationType engineType = LOC_OUTPUT_ENGINE_FUSED,
+        PositioningEngine engineMask = 0)
+       : fix_(fix)
+       , engineType_(engineType)
+       , engineMask_(engineMask) {
+    }
+
+    const CompactLocationFix &getFix() const {
+        return fix_;
+    }
+
+    LocationInfoValidity getLocationInfoValidity() override {
+        return fix_.validity;
+    }
+    LocationTechnology getTechMask() override {
+        return fix_.techMask;
+    }
+    float getSpeed() override {
+        return fix_.speed;
+    }
+    double getLatitude() override {
+        return fix_.latitude;
+    }
+    double getLongitude() override {
+        return fix_.longitude;
+    }
+    double getAltitude() override {
+        return fix_.altitude;
+    }
+    float getHeading() override {
+        return fix_.heading;
+    }
+    float getHorizontalUncertainty() override {
+        return fix_.horizontalUncertainty;
+    }
+    float getVerticalUncertainty() override {
+        return fix_.verticalUncertainty;
+    }
+    uint64_t getTimeStamp() override {
+        return fix_.timestamp;
+    }
+    float getSpeedUncertainty() override {
+        return fix_.speedUncertainty;
+    }
+    float getHeadingUncertainty() override {
+        return fix_.headingUncertainty;
+    }
+    uint64_t getElapsedRealTime() override {
+        return fix_.elapsedRealTime;
+    }
+    uint64_t getElapsedRealTimeUncertainty() override {
+        return 0;
+    }
+    LocationInfoExValidity getLocationInfoExValidity() override {
+        return fix_.exValidity;
+    }
+    float getAltitudeMeanSeaLevel() override {
+        return fix_.altitudeMeanSeaLevel;
+    }
+    float getPositionDop() override {
+        return fix_.positionDop;
+    }
+    float getHorizontalDop() override {
+        return fix_.horizontalDop;
+    }
+    float getVerticalDop() override {
+        return fix_.verticalDop;
+    }
+    float getGeometricDop() override {
+        return 0;
+    }
+    float getTimeDop() override {
+        return 0;
+    }
+    float getMagneticDeviation() override {
+        return 0;
+    }
+    LocationReliability getHorizontalReliability() override {
+        return LocationReliability::UNKNOWN;
+    }
+    LocationReliability getVerticalReliability() override {
+        return LocationReliability::UNKNOWN;
+    }
+    float getHorizontalUncertaintySemiMajor() override {
+        return fix_.horizontalUncertaintySemiMajor;
+    }
+    float getHorizontalUncertaintySemiMinor() override {
+        return fix_.horizontalUncertaintySemiMinor;
+    }
+    float getHorizontalUncertaintyAzimuth() override {
+        return fix_.horizontalUncertaintyAzimuth;
+    }
+    float getEastStandardDeviation() override {
+        return fix_.eastStandardDeviation;
+    }
+    float getNorthStandardDeviation() override {
+        return fix_.northStandardDeviation;
+    }
+    uint16_t getNumSvUsed() override {
+        return fix_.numSvUsed;
+    }
+    SvUsedInPosition getSvUsedInPosition() override {
+        return fix_.svUsedInPosition;
+    }
+    void getSVIds(std::vector<uint16_t> &idsOfUsedSVs) override {
+        idsOfUsedSVs.clear();
+    }
+    SbasCorrection getSbasCorrection() override {
+        return SbasCorrection();
+    }
+    GnssPositionTech getPositionTechnology() override {
+        return fix_.positionTechnology;
+    }
+    GnssKinematicsData getBodyFrameData() override {
+        return fix_.bodyFrameData;
+    }
+    std::vector<GnssMeasurementInfo> getmeasUsageInfo() override {
+        return std::vector<GnssMeasurementInfo>();
+    }
+    SystemTime getGnssSystemTime() override {
+        return fix_.gnssSystemTime;
+    }
+    float getTimeUncMs() override {
+        return fix_.timeUncMs;
+    }
+    telux::common::Status getLeapSeconds(uint8_t &leapSeconds) override {
+        if (!(fix_.exValidity & HAS_LEAP_SECONDS)) {
+            return telux::common::Status::FAILED;
+        }
+        leapSeconds = fix_.leapSeconds;
+        return telux::common::Status::SUCCESS;
+    }
+    telux::common::Status getVelocityEastNorthUp(std::vector<float> &velocity) override {
+        velocity.assign(fix_.velocityEastNorthUp, fix_.velocityEastNorthUp + 3);
+        return telux::common::Status::SUCCESS;
+    }
+    telux::common::Status getVelocityUncertaintyEastNorthUp(
+        std::vector<float> &uncertainty) override {
+        uncertainty.assign(fix_.velocityUncertaintyEastNorthUp,
+            fix_.velocityUncertaintyEastNorthUp + 3);
+        return telux::common::Status::SUCCESS;
+    }
+    uint8_t getCalibrationConfidencePercent() override {
+        return fix_.calibrationConfidencePercent;
+    }
+    DrCalibrationStatus getCalibrationStatus() override {
+        return fix_.calibrationStatus;
+    }
+    LocationAggregationType getLocOutputEngType() override {
+        return engineType_;
+    }
+    PositioningEngine getLocOutputEngMask() override {
+        return engineMask_;
+    }
+    float getConformityIndex() override {
+        return 0;
+    }
+    LLAInfo getVRPBasedLLA() override {
+        return LLAInfo();
+    }
+    std::vector<float> getVRPBasedENUVelocity() override {
+        return std::vector<float>();
+    }
+    AltitudeType getAltitudeType() override {
+        return AltitudeType::UNKNOWN;
+    }
+    ReportStatus getReportStatus() override {
+        return ReportStatus::UNKNOWN;
+    }
+    uint32_t getIntegrityRiskUsed() override {
+        return 0;
+    }
+    float getProtectionLevelAlongTrack() override {
+        return 0;
+    }
+    float getProtectionLevelCrossTrack() override {
+        return 0;
+    }
+    float getProtectionLevelVertical() override {
+        return 0;
+    }
+
+ private:
+    CompactLocationFix fix_;
+    LocationAggregationType engineType_;
+    PositioningEngine engineMask_;
+};
+
+/**
+ * @brief ISVInfo on a CompactSvInfo.
+ */
+class LoggedSvInfo : public ISVInfo {
+ public:
+    explicit LoggedSvInfo(const CompactSvInfo &sv)
+       : sv_(sv) {
+    }
+
+    GnssConstellationType getConstellation() override {
+        return sv_.constellation;
+    }
+    uint16_t getId() override {
+        return sv_.id;
+    }
+    SVHealthStatus getSVHealthStatus() override {
+        return sv_.health;
+    }
+    SVStatus getStatus() override {
+        return sv_.status;
+    }
+    SVInfoAvailability getHasEphemeris() override {
+        return sv_.hasEphemeris;
+    }
+    SVInfoAvailability getHasAlmanac() override {
+        return sv_.hasAlmanac;
+    }
+    SVInfoAvailability getHasFix() override {
+        return sv_.hasFix;
+    }
+    float getElevation() override {
+        return sv_.elevation;
+    }
+    float getAzimuth() override {
+        return sv_.azimuth;
+    }
+    float getSnr() override {
+        return sv_.snr;
+    }
+    float getCarrierFrequency() override {
+        return sv_.carrierFrequency;
+    }
+    GnssSignal getSignalType() override {
+        return sv_.signalType;
+    }
+    uint16_t getGlonassFcn() override {
+        return sv_.glonassFcn;
+    }
+    double getBasebandCnr() override {
+        return sv_.basebandCnr;
+    }
+
+ private:
+    CompactSvInfo sv_;
+};
+
+/**
+ * @brief IGnssSVInfo on an array of CompactSvInfo.
+ */
+class LoggedGnssSvInfo : public IGnssSVInfo {
+ public:
+    LoggedGnssSvInfo(AltitudeType altitudeType, const CompactSvInfo *svs, uint32_t count)
+       : altitudeType_(altitudeType) {
+        svs_.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            svs_.push_back(std::make_shared<LoggedSvInfo>(svs[i]));
+        }
+    }
+
+    AltitudeType getAltitudeType() override {
+        return altitudeType_;
+    }
+
+    std::vector<std::shared_ptr<ISVInfo>> getSVInfoList() override {
+        return svs_;
+    }
+
+ private:
+    AltitudeType altitudeType_;
+    std::vector<std::shared_ptr<ISVInfo>> svs_;
+};
+
+/**
+ * @brief IGnssSignalInfo on a GnssData.
+ */
+class LoggedSignalInfo : public IGnssSignalInfo {
+ public:
+    explicit LoggedSignalInfo(const GnssData &data)
+       : data_(data) {
+    }
+
+    GnssData getGnssData() override {
+        return data_;
+    }
+
+ private:
+    GnssData data_;
+};
+
+/**
+ * @brief LocationRecorder is an @ref telux::loc::ILocationListener that appends every callback
+ * it receives to a location log, with the time it arrived.
+ *
+ * Register it with a location manager next to the application's listeners. Fixes, satellites
+ * and measurements are stored as plain data (see LocationReport.hpp); fields of
+ * ILocationInfoEx outside CompactLocationFix are not recorded.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationRecorder : public ILocationListener {
+ public:
+    /**
+     * @param [in] writer - open log to append to
+     * @param [in] clock  - monotonic time in nanoseconds, the steady clock if nullptr
+     */
+    explicit LocationRecorder(std::shared_ptr<LocationLogWriter> writer,
+        std::function<uint64_t()> clock = nullptr)
+       : writer_(writer)
+       , clock_(clock ? clock : steadyNs)
+       , start_(clock_()) {
+    }
+
+    void onBasicLocationUpdate(const std::shared_ptr<ILocationInfoBase> &info) override {
+        if (info) {
+            const CompactLocationFix fix = toCompactBaseFix(*info);
+            writer_->append(LOC_LOG_BASIC_FIX, offsetNs(), &fix, sizeof(fix));
+        }
+    }
+
+    void onDetailedLocationUpdate(const std::shared_ptr<ILocationInfoEx> &info) override {
+        if (info) {
+            const CompactLocationFix fix = LocationReportAdapter::toCompactFix(*info);
+            writer_->append(LOC_LOG_DETAILED_FIX, offsetNs(), &fix, sizeof(fix));
+        }
+    }
+
+    void onDetailedEngineLocationUpdate(
+        const std::vector<std::shared_ptr<ILocationInfoEx>> &infos) override {
+        std::vector<LoggedEngineFix> fixes;
+        fixes.reserve(infos.size());
+        for (const auto &info : infos) {
+            if (info) {
+                LoggedEngineFix logged;
+                std::memset(&logged, 0, sizeof(logged));
+                logged.engineType = info->getLocOutputEngType();
+                logged.engineMask = info->getLocOutputEngMask();
+                logged.fix = LocationReportAdapter::toCompactFix(*info);
+                fixes.push_back(logged);
+            }
+        }
+        const uint64_t count = fixes.size();
+        writer_->append(LOC_LOG_ENGINE_FIXES, offsetNs(), &count, sizeof(count), fixes.data(),
+            fixes.size() * sizeof(LoggedEngineFix));
+    }
+
+    void onGnssSVInfo(const std::shared_ptr<IGnssSVInfo> &info) override {
+        if (!info) {
+            return;
+        }
+        const std::vector<std::shared_ptr<ISVInfo>> list = info->getSVInfoList();
+        std::vector<CompactSvInfo> svs;
+        svs.reserve(list.size());
+        for (const auto &sv : list) {
+            svs.push_back(LocationReportAdapter::toCompactSvInfo(*sv));
+        }
+        LoggedSvInfoHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.altitudeType = info->getAltitudeType();
+        header.count = static_cast<uint32_t>(svs.size());
+        writer_->append(LOC_LOG_SV_INFO, offsetNs(), &header, sizeof(header), svs.data(),
+            svs.size() * sizeof(CompactSvInfo));
+    }
+
+    void onGnssSignalInfo(const std::shared_ptr<IGnssSignalInfo> &info) override {
+        if (info) {
+            const GnssData data = info->getGnssData();
+            writer_->append(LOC_LOG_SIGNAL_INFO, offsetNs(), &data, sizeof(data));
+        }
+    }
+
+    void onGnssNmeaInfo(uint64_t timestamp, const std::string &nmea) override {
+        writer_->append(LOC_LOG_NMEA, offsetNs(), &timestamp, sizeof(timestamp), nmea.data(),
+            nmea.size());
+    }
+
+    void onGnssMeasurementsInfo(const GnssMeasurements &info) override {
+        LoggedMeasurementsHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.clock = info.clock;
+        header.isNHz = info.isNHz;
+        header.count = static_cast<uint32_t>(info.measurements.size());
+        writer_->append(LOC_LOG_MEASUREMENTS, offsetNs(), &header, sizeof(header),
+            info.measurements.data(), info.measurements.size() * sizeof(GnssMeasurementsData));
+    }
+
+    void onCapabilitiesInfo(const LocCapability capabilities) override {
+        writer_->append(LOC_LOG_CAPABILITIES, offsetNs(), &capabilities, sizeof(capabilities));
+    }
+
+    static CompactLocationFix toCompactBaseFix(ILocationInfoBase &info) {
+        CompactLocationFix fix;
+        std::memset(&fix, 0, sizeof(fix));
+        fix.timestamp = info.getTimeStamp();
+        fix.elapsedRealTime = info.getElapsedRealTime();
+        fix.latitude = info.getLatitude();
+        fix.longitude = info.getLongitude();
+        fix.altitude = info.getAltitude();
+        fix.speed = info.getSpeed();
+        fix.heading = info.getHeading();
+        fix.horizontalUncertainty = info.getHorizontalUncertainty();
+        fix.verticalUncertainty = info.getVerticalUncertainty();
+        fix.speedUncertainty = info.getSpeedUncertainty();
+        fix.headingUncertainty = info.getHeadingUncertainty();
+        fix.validity = info.getLocationInfoValidity();
+        fix.techMask = info.getTechMask();
+        return fix;
+    }
+
+ private:
+    static uint64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t offsetNs() {
+        return clock_() - start_;
+    }
+
+    std::shared_ptr<LocationLogWriter> writer_;
+    std::function<uint64_t()> clock_;
+    const uint64_t start_;
+};
+
+/**
+ * @brief LocationReplayManager is an @ref telux::loc::ILocationManager that plays a location log
+ * back to its listeners instead of reporting live fixes.
+ *
+ * Starting reports starts the replay from the beginning of the log on a thread of the
+ * manager. Records are delivered at their recorded offsets divided by the speed: 1 for the
+ * recorded pace, N for N times faster, @ref MAX_SPEED for as fast as the listeners consume
+ * them. Reports keep their original timestamps. As with a live manager, the report types are
+ * filtered by the report mask of startDetailedReports and fixes by the requested interval;
+ * starting reports again while the replay runs changes the filters without restarting it.
+ * At the end of the log the replay stops; see @ref waitForCompletion.
+ *
+ * Detailed fixes are delivered as a single fused fix to engine report listeners, engine
+ * fixes only to engine report listeners. Basic report listeners receive the basic or detailed
+ * fixes of the log.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationReplayManager : public ILocationManager {
+ public:
+    /** Replays without waiting between records. */
+    static constexpr double MAX_SPEED = 0;
+
+    /**
+     * Replay counters, reset by each start from the beginning of the log.
+     */
+    struct Stats {
+        uint64_t records;    /**< Records read */
+        uint64_t callbacks;  /**< Listener callbacks made */
+        uint64_t logNs;      /**< Recorded time replayed */
+        uint64_t wallNs;     /**< Time taken */
+        uint64_t maxLateNs;  /**< Largest delay of a record behind its scheduled time */
+        bool completed;      /**< The end of the log was reached */
+    };
+
+    /**
+     * @param [in] path  - location log to replay
+     * @param [in] speed - replay speed factor, MAX_SPEED for no pacing
+     */
+    explicit LocationReplayManager(const std::string &path, double speed = 1.0)
+       : path_(path)
+       , speed_(speed) {
+        LocationLogReader reader;
+        ready_ = (reader.open(path) == telux::common::Status::SUCCESS);
+        LocationLogRecord record;
+        // The last capabilities of the log are reported by getCapabilities()
+        while (ready_ && reader.next(record)) {
+            record.getCapabilities(capabilities_);
+        }
+    }
+
+    ~LocationReplayManager() {
+        stopReplay();
+    }
+
+    /**
+     * Speed of the next start of the replay.
+     */
+    void setSpeed(double speed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        speed_ = speed;
+    }
+
+    /**
+     * Waits until the replay reached the end of the log or stopped.
+     *
+     * @returns false on timeout
+     */
+    bool waitForCompletion(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, timeout, [this]() { return !running_; });
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    bool isSubsystemReady() override {
+        return ready_;
+    }
+
+    telux::common::ServiceStatus getServiceStatus() override {
+        return ready_ ? telux::common::ServiceStatus::SERVICE_AVAILABLE
+                      : telux::common::ServiceStatus::SERVICE_FAILED;
+    }
+
+    std::future<bool> onSubsystemReady() override {
+        std::promise<bool> promise;
+        promise.set_value(ready_);
+        return promise.get_future();
+    }
+
+    telux::common::Status registerListenerEx(std::weak_ptr<ILocationListener> listener) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &registered : listeners_) {
+            if (!registered.owner_before(listener) && !listener.owner_before(registered)) {
+                return telux::common::Status::ALREADY;
+            }
+        }
+        listeners_.push_back(listener);
+        return telux::common::Status::SUCCESS;
+    }
+
+    telux::common::Status deRegisterListenerEx(
+        std::weak_ptr<ILocationListener> listener) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+            if (!it->owner_before(listener) && !listener.owner_before(*it)) {
+                listeners_.erase(it);
+                return telux::common::Status::SUCCESS;
+            }
+        }
+        return telux::common::Status::NOSUCH;
+    }
+
+    telux::common::Status startDetailedReports(uint32_t interval,
+        telux::common::ResponseCallback callback = nullptr,
+        GnssReportTypeMask reportMask = DEFAULT_GNSS_REPORT) override {
+        Session session;
+        session.mode = Mode::DETAILED;
+        session.intervalMs = interval;
+        session.reportMask = reportMask;
+        return start(session, callback);
+    }
+
+    telux::common::Status startDetailedEngineReports(uint32_t interval, LocReqEngine engineType,
+        telux::common::ResponseCallback callback = nullptr,
+        GnssReportTypeMask reportMask = DEFAULT_GNSS_REPORT) override {
+        Session session;
+        session.mode = Mode::ENGINE;
+        session.intervalMs = interval;
+        session.engines = engineType;
+        session.reportMask = reportMask;
+        return start(session, callback);
+    }
+
+    telux::common::Status startBasicReports(uint32_t distanceInMeters, uint32_t intervalInMs,
+        telux::common::ResponseCallback callback = nullptr) override {
+        Session session;
+        session.mode = Mode::BASIC;
+        session.intervalMs = intervalInMs;
+        session.distanceM = distanceInMeters;
+        return start(session, callback);
+    }
+
+    telux::common::Status stopReports(telux::common::ResponseCallback callback = nullptr) override {
+        stopReplay();
+        if (callback) {
+            callback(telux::common::ErrorCode::SUCCESS);
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    telux::common::Status registerForSystemInfoUpdates(
+        std::weak_ptr<ILocationSystemInfoListener> listener,
+        telux::common::ResponseCallback callback = nullptr) override {
+        return telux::common::Status::NOTSUPPORTED;
+    }
+
+    telux::common::Status deRegisterForSystemInfoUpdates(
+        std::weak_ptr<ILocationSystemInfoListener> listener,
+        telux::common::ResponseCallback callback = nullptr) override {
+        return telux::common::Status::NOTSUPPORTED;
+    }
+
+    telux::common::Status requestEnergyConsumedInfo(GetEnergyConsumedCallback cb) override {
+        return telux::common::Status::NOTSUPPORTED;
+    }
+
+    telux::common::Status getYearOfHw(GetYearOfHwCallback cb) override {
+        return telux::common::Status::NOTSUPPORTED;
+    }
+
+    telux::common::Status getTerrestrialPosition(uint32_t timeoutMsec,
+        TerrestrialTechnology techMask, GetTerrestrialInfoCallback cb,
+        telux::common::ResponseCallback callback = nullptr) override {
+        return telux::common::Status::NOTSUPPORTED;
+    }
+
+    telux::common::Status cancelTerrestrialPositionRequest(
+        telux::common::ResponseCallback callback = nullptr) override {
+        return telux::common::Status::NOTSUPPORTED;
+    }
+
+    LocCapability getCapabilities() override {
+        return capabilities_;
+    }
+
+ private:
+    enum class Mode { BASIC, DETAILED, ENGINE };
+
+    struct Session {
+        Mode mode = Mode::DETAILED;
+        uint32_t intervalMs = 0;
+        uint32_t distanceM = 0;
+        LocReqEngine engines = 0;
+        GnssReportTypeMask reportMask = DEFAULT_GNSS_REPORT;
+    };
+
+    telux::common::Status start(const Session &session, telux::common::ResponseCallback callback) {
+        if (!ready_) {
+            return telux::common::Status::NOTREADY;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        session_ = session;
+        pendingCallback_ = callback;
+        if (running_) {
+            // Also the path of listeners calling back from the replay thread
+            return telux::common::Status::SUCCESS;
+        }
+        lock.unlock();
+        std::lock_guard<std::mutex> joinLock(joinMutex_);
+        // A replay that ended on its own is joined here
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        lock.lock();
+        if (!running_) {
+            running_ = true;
+            stopping_ = false;
+            stats_ = Stats();
+            thread_ = std::thread(&LocationReplayManager::run, this);
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    void stopReplay() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        joinReplay();
+    }
+
+    void joinReplay() {
+        std::lock_guard<std::mutex> lock(joinMutex_);
+        // Not from a listener callback on the replay thread, which ends on its own
+        if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+            thread_.join();
+        }
+    }
+
+    static uint64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - since).count();
+    }
+
+    void run() {
+        LocationLogReader reader;
+        LocationLogRecord record;
+        reader.open(path_);
+        double speed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            speed = speed_;
+        }
+        const auto wallStart = std::chrono::steady_clock::now();
+        bool first = true;
+        uint64_t firstOffset = 0;
+        uint64_t records = 0;
+        uint64_t callbacks = 0;
+        uint64_t maxLate = 0;
+        uint64_t lastFixMs = 0;
+        bool haveLastFix = false;
+        CompactLocationFix lastFix = CompactLocationFix();
+        std::vector<std::shared_ptr<ILocationListener>> listeners;
+
+        while (reader.next(record)) {
+            if (first) {
+                firstOffset = record.getOffsetNs();
+                first = false;
+            }
+            const uint64_t offset = record.getOffsetNs() - firstOffset;
+            Session session;
+            telux::common::ResponseCallback callback;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (speed > 0) {
+                    const auto due = wallStart + std::chrono::nanoseconds(
+                        static_cast<uint64_t>(offset / speed));
+                    cv_.wait_until(lock, due, [this]() { return stopping_; });
+                }
+                if (stopping_) {
+                    break;
+                }
+                session = session_;
+                std::swap(callback, pendingCallback_);
+                listeners.clear();
+                for (const auto &weak : listeners_) {
+                    if (auto listener = weak.lock()) {
+                        listeners.push_back(listener);
+                    }
+                }
+            }
+            if (speed > 0) {
+                const uint64_t due = static_cast<uint64_t>(offset / speed);
+                const uint64_t now = elapsedNs(wallStart);
+                maxLate = std::max(maxLate, now > due ? now - due : 0);
+            }
+            if (callback) {
+                callback(telux::common::ErrorCode::SUCCESS);
+            }
+            ++records;
+
+            // Fix interval and distance filters
+            const CompactLocationFix *fix = record.getFix();
+            uint32_t engineFixes = 0;
+            const LoggedEngineFix *engineFix = record.getEngineFixes(engineFixes);
+            if (engineFix && engineFixes) {
+                fix = &engineFix->fix;
+            }
+            if (fix && haveLastFix) {
+                const uint64_t minGap = session.intervalMs - session.intervalMs / 20;
+                if (fix->timestamp < lastFixMs + minGap
+                    || (session.mode == Mode::BASIC && session.distanceM
+                        && distanceM(lastFix, *fix) < session.distanceM)) {
+                    continue;
+                }
+            }
+            const size_t made = deliver(record, session, listeners);
+            if (fix && made) {
+                lastFixMs = fix->timestamp;
+                lastFix = *fix;
+                haveLastFix = true;
+            }
+            callbacks += made;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.records = records;
+            stats_.callbacks = callbacks;
+            stats_.logNs = offset;
+            stats_.maxLateNs = maxLate;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.wallNs = elapsedNs(wallStart);
+        stats_.completed = !stopping_ && !reader.isTruncated();
+        running_ = false;
+        cv_.notify_all();
+    }
+
+    static double distanceM(const CompactLocationFix &a, const CompactLocationFix &b) {
+        const double north = (b.latitude - a.latitude) * 111195.0;
+        const double east = (b.longitude - a.longitude) * 111195.0
+            * std::cos(a.latitude * M_PI / 180);
+        return std::sqrt(north * north + east * east);
+    }
+
+    static bool engineRequested(LocReqEngine engines, LocationAggregationType type) {
+        switch (type) {
+            case LOC_OUTPUT_ENGINE_FUSED:
+                return engines & LOC_REQ_ENGINE_FUSED_BIT;
+            case LOC_OUTPUT_ENGINE_SPE:
+                return engines & LOC_REQ_ENGINE_SPE_BIT;
+            case LOC_OUTPUT_ENGINE_PPE:
+                return engines & LOC_REQ_ENGINE_PPE_BIT;
+            case LOC_OUTPUT_ENGINE_VPE:
+                return engines & LOC_REQ_ENGINE_VPE_BIT;
+            default:
+                return false;
+        }
+    }
+
+    // Makes the callbacks of a record, returns their number
+    size_t deliver(const LocationLogRecord &record, const Session &session,
+        const std::vector<std::shared_ptr<ILocationListener>> &listeners) {
+        const bool detailed = (session.mode != Mode::BASIC);
+        const GnssReportTypeMask mask = session.reportMask;
+        switch (record.getType()) {
+            case LOC_LOG_BASIC_FIX:
+            case LOC_LOG_DETAILED_FIX: {
+                const CompactLocationFix *fix = record.getFix();
+                if (!fix || (detailed && !(mask & GnssReportType::LOCATION))) {
+                    return 0;
+                }
+                if (session.mode == Mode::BASIC) {
+                    std::shared_ptr<ILocationInfoBase> info
+                        = std::make_shared<LoggedLocationInfo>(*fix);
+                    return forEach(listeners,
+                        [&info](ILocationListener &l) { l.onBasicLocationUpdate(info); });
+                }
+                if (record.getType() == LOC_LOG_BASIC_FIX) {
+                    return 0;
+                }
+                if (session.mode == Mode::ENGINE) {
+                    if (!(session.engines & LOC_REQ_ENGINE_FUSED_BIT)) {
+                        return 0;
+                    }
+                    std::vector<std::shared_ptr<ILocationInfoEx>> infos{
+                        std::make_shared<LoggedLocationInfo>(*fix)};
+                    return forEach(listeners, [&infos](ILocationListener &l) {
+                        l.onDetailedEngineLocationUpdate(infos);
+                    });
+                }
+                std::shared_ptr<ILocationInfoEx> info = std::make_shared<LoggedLocationInfo>(*fix);
+                return forEach(listeners,
+                    [&info](ILocationListener &l) { l.onDetailedLocationUpdate(info); });
+            }
+            case LOC_LOG_ENGINE_FIXES: {
+                uint32_t count = 0;
+                const LoggedEngineFix *fixes = record.getEngineFixes(count);
+                if (!fixes || session.mode != Mode::ENGINE
+                    || !(mask & GnssReportType::LOCATION)) {
+                    return 0;
+                }
+                std::vector<std::shared_ptr<ILocationInfoEx>> infos;
+                for (uint32_t i = 0; i < count; ++i) {
+                    if (engineRequested(session.engines, fixes[i].engineType)) {
+                        infos.push_back(std::make_shared<LoggedLocationInfo>(fixes[i].fix,
+                            fixes[i].engineType, fixes[i].engineMask));
+                    }
+                }
+                if (infos.empty()) {
+                    return 0;
+                }
+                return forEach(listeners, [&infos](ILocationListener &l) {
+                    l.onDetailedEngineLocationUpdate(infos);
+                });
+            }
+            case LOC_LOG_SV_INFO: {
+                LoggedSvInfoHeader header;
+                const CompactSvInfo *svs = record.getSvInfo(header);
+                if (!svs || !detailed || !(mask & GnssReportType::SATELLITE_VEHICLE)) {
+                    return 0;
+                }
+                std::shared_ptr<IGnssSVInfo> info
+                    = std::make_shared<LoggedGnssSvInfo>(header.altitudeType, svs, header.count);
+                return forEach(listeners, [&info](ILocationListener &l) { l.onGnssSVInfo(info); });
+            }
+            case LOC_LOG_SIGNAL_INFO: {
+                const GnssData *data = record.getSignalInfo();
+                if (!data || !detailed || !(mask & GnssReportType::DATA)) {
+                    return 0;
+                }
+                std::shared_ptr<IGnssSignalInfo> info = std::make_shared<LoggedSignalInfo>(*data);
+                return forEach(listeners,
+                    [&info](ILocationListener &l) { l.onGnssSignalInfo(info); });
+            }
+            case LOC_LOG_NMEA: {
+                uint64_t timestamp = 0;
+                const char *sentence = nullptr;
+                size_t length = 0;
+                if (!record.getNmea(timestamp, sentence, length) || !detailed
+                    || !(mask & GnssReportType::NMEA)) {
+                    return 0;
+                }
+                const std::string nmea(sentence, length);
+                return forEach(listeners, [timestamp, &nmea](ILocationListener &l) {
+                    l.onGnssNmeaInfo(timestamp, nmea);
+                });
+            }
+            case LOC_LOG_MEASUREMENTS: {
+                LoggedMeasurementsHeader header;
+                const GnssMeasurementsData *data = record.getMeasurements(header);
+                if (!data || !detailed || !(mask & (GnssReportType::MEASUREMENT
+                                                    | GnssReportType::HIGH_RATE_MEASUREMENT))) {
+                    return 0;
+                }
+                GnssMeasurements measurements;
+                measurements.clock = header.clock;
+                measurements.isNHz = (header.isNHz != 0);
+                measurements.measurements.assign(data, data + header.count);
+                return forEach(listeners, [&measurements](ILocationListener &l) {
+                    l.onGnssMeasurementsInfo(measurements);
+                });
+            }
+            case LOC_LOG_CAPABILITIES: {
+                LocCapability capabilities = 0;
+                if (!record.getCapabilities(capabilities)) {
+                    return 0;
+                }
+                return forEach(listeners, [capabilities](ILocationListener &l) {
+                    l.onCapabilitiesInfo(capabilities);
+                });
+            }
+        }
+        return 0;
+    }
+
+    template <typename F>
+    static size_t forEach(const std::vector<std::shared_ptr<ILocationListener>> &listeners, F f) {
+        for (const auto &listener : listeners) {
+            f(*listener);
+        }
+        return listeners.size();
+    }
+
+    const std::string path_;
+    bool ready_ = false;
+    LocCapability capabilities_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    double speed_;
+    Session session_;
+    telux::common::ResponseCallback pendingCallback_;
+    std::vector<std::weak_ptr<ILocationListener>> listeners_;
+    bool running_ = false;
+    bool stopping_ = false;
+    Stats stats_ = Stats();
+
+    std::mutex joinMutex_;
+    std::thread thread_;
+};
+
+constexpr uint32_t LocationLogWriter::VERSION;
+constexpr size_t LocationLogWriter::BUFFER_SIZE;
+constexpr uint32_t LocationLogReader::MAX_RECORD_SIZE;
+constexpr double LocationReplayManager::MAX_SPEED;
+
+/** @} */ /* end_addtogroup telematics_location */
+}  // namespace loc
+}  // namespace telux
+
+#endif  // TELUX_LOC_LOCATIONLOG_HPP
@@ -0,0 +1,1010 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       LocationReport.hpp
+ *
+ * @brief      Compact location reports: plain data copies of the detailed location, satellite,
+ *             signal, NMEA and measurement reports, built once into a shared read-only buffer
+ *             and delivered only to the listeners subscribed to their type.
+ */
+
+#ifndef TELUX_LOC_LOCATIONREPORT_HPP
+#define TELUX_LOC_LOCATIONREPORT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/loc/LocationDefines.hpp>
+#include <telux/loc/LocationListener.hpp>
+
+namespace telux {
+namespace loc {
+
+/** @addtogroup telematics_location
+ * @{ */
+
+/**
+ * Types of compact location reports, one per detailed report callback of
+ * @ref telux::loc::ILocationListener.
+ */
+enum LocationReportType : uint32_t {
+    LOC_REPORT_FIX = (1 << 0),          /**< onDetailedLocationUpdate */
+    LOC_REPORT_SV_INFO = (1 << 1),      /**< onGnssSVInfo */
+    LOC_REPORT_SIGNAL_INFO = (1 << 2),  /**< onGnssSignalInfo */
+    LOC_REPORT_NMEA = (1 << 3),         /**< onGnssNmeaInfo, one sentence per report */
+    LOC_REPORT_MEASUREMENTS = (1 << 4)  /**< onGnssMeasurementsInfo */
+};
+
+/** Bitwise OR of @ref LocationReportType, the report types a listener subscribes to. */
+using LocationReportMask = uint32_t;
+
+/** All report types. */
+constexpr LocationReportMask LOC_REPORT_ALL = 0x1F;
+
+/**
+ * Plain data copy of the commonly used fields of @ref telux::loc::ILocationInfoEx. Fields are
+ * valid as flagged in validity and exValidity, as in ILocationInfoEx.
+ */
+struct CompactLocationFix {
+    uint64_t timestamp;                   /**< UTC time of the fix in milliseconds */
+    uint64_t elapsedRealTime;             /**< Boot time of the fix in nanoseconds */
+    double latitude;                      /**< Degrees */
+    double longitude;                     /**< Degrees */
+    double altitude;                      /**< Meters above the WGS 84 ellipsoid */
+    float altitudeMeanSeaLevel;           /**< Meters above mean sea level */
+    float speed;                          /**< Meters per second */
+    float heading;                        /**< Degrees from true north */
+    float horizontalUncertainty;          /**< Meters */
+    float verticalUncertainty;            /**< Meters */
+    float speedUncertainty;               /**< Meters per second */
+    float headingUncertainty;             /**< Degrees */
+    float horizontalUncertaintySemiMajor; /**< Meters, 39% confidence ellipse */
+    float horizontalUncertaintySemiMinor; /**< Meters */
+    float horizontalUncertaintyAzimuth;   /**< Degrees from true north */
+    float eastStandardDeviation;          /**< Meters */
+    float northStandardDeviation;         /**< Meters */
+    float positionDop;
+    float horizontalDop;
+    float verticalDop;
+    float timeUncMs;
+    float velocityEastNorthUp[3];             /**< Meters per second */
+    float velocityUncertaintyEastNorthUp[3];  /**< Meters per second */
+    LocationInfoValidity validity;
+    LocationInfoExValidity exValidity;
+    LocationTechnology techMask;
+    GnssPositionTech positionTechnology;
+    uint16_t numSvUsed;
+    uint8_t leapSeconds;                  /**< Valid if HAS_LEAP_SECONDS */
+    uint8_t calibrationConfidencePercent;
+    DrCalibrationStatus calibrationStatus;
+    GnssKinematicsData bodyFrameData;
+    SvUsedInPosition svUsedInPosition;
+    SystemTime gnssSystemTime;
+};
+
+/**
+ * Plain data copy of @ref telux::loc::ISVInfo.
+ */
+struct CompactSvInfo {
+    GnssConstellationType constellation;
+    uint16_t id;
+    uint16_t glonassFcn;
+    SVHealthStatus health;
+    SVStatus status;
+    SVInfoAvailability hasEphemeris;
+    SVInfoAvailability hasAlmanac;
+    SVInfoAvailability hasFix;
+    float elevation;
+    float azimuth;
+    float snr;
+    float carrierFrequency;
+    GnssSignal signalType;
+    double basebandCnr;
+};
+
+class LocationReportDispatcher;
+
+/**
+ * @brief A compact location report: a header and the report payload in one buffer.
+ *
+ * Listeners receive the report as a shared pointer to a read-only object, the same one for all
+ * listeners, and may keep it. The dispatcher reuses the buffer for a later report once no
+ * listener holds it anymore.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationReport {
+ public:
+    LocationReportType getType() const {
+        return type_;
+    }
+
+    /**
+     * Sequence number of the report, incremented by one per report published by a dispatcher.
+     */
+    uint64_t getSequence() const {
+        return sequence_;
+    }
+
+    /**
+     * UTC time in milliseconds of the fix or NMEA sentence; 0 for the other types.
+     */
+    uint64_t getTimestamp() const {
+        return timestamp_;
+    }
+
+    /**
+     * Number of satellites of LOC_REPORT_SV_INFO or measurements of LOC_REPORT_MEASUREMENTS,
+     * length of LOC_REPORT_NMEA; 1 otherwise.
+     */
+    uint32_t getCount() const {
+        return count_;
+    }
+
+    /**
+     * @returns the fix, nullptr unless the type is LOC_REPORT_FIX
+     */
+    const CompactLocationFix *getFix() const {
+        return payload<CompactLocationFix>(LOC_REPORT_FIX, 0);
+    }
+
+    /**
+     * @returns getCount() satellites, nullptr unless the type is LOC_REPORT_SV_INFO
+     */
+    const CompactSvInfo *getSvInfo() const {
+        return payload<CompactSvInfo>(LOC_REPORT_SV_INFO, 0);
+    }
+
+    /**
+     * Altitude type of LOC_REPORT_SV_INFO.
+     */
+    AltitudeType getAltitudeType() const {
+        return altitudeType_;
+    }
+
+    /**
+     * @returns the signal info, nullptr unless the type is LOC_REPORT_SIGNAL_INFO
+     */
+    const GnssData *getSignalInfo() const {
+        return payload<GnssData>(LOC_REPORT_SIGNAL_INFO, 0);
+    }
+
+    /**
+     * @returns the NUL terminated sentence of getCount() characters, nullptr unless the type
+     * is LOC_REPORT_NMEA
+     */
+    const char *getNmea() const {
+        return payload<char>(LOC_REPORT_NMEA, 0);
+    }
+
+    /**
+     * @returns the measurement clock, nullptr unless the type is LOC_REPORT_MEASUREMENTS
+     */
+    const GnssMeasurementsClock *getMeasurementsClock() const {
+        return payload<GnssMeasurementsClock>(LOC_REPORT_MEASUREMENTS, 0);
+    }
+
+    /**
+     * @returns getCount() measurements, nullptr unless the type is LOC_REPORT_MEASUREMENTS
+     */
+    const GnssMeasurementsData *getMeasurements() const {
+        return payload<GnssMeasurementsData>(LOC_REPORT_MEASUREMENTS,
+            alignUp(sizeof(GnssMeasurementsClock)));
+    }
+
+    /**
+     * Whether the measurements of LOC_REPORT_MEASUREMENTS are high rate.
+     */
+    bool isNHz() const {
+        return isNHz_;
+    }
+
+ private:
+    friend class LocationReportDispatcher;
+
+    static size_t alignUp(size_t bytes) {
+        return (bytes + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    }
+
+    template <typename T>
+    const T *payload(LocationReportType type, size_t offset) const {
+        if (type_ != type) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T *>(
+            reinterpret_cast<const uint8_t *>(storage_.data()) + offset);
+    }
+
+    uint8_t *prepare(LocationReportType type, size_t bytes) {
+        type_ = type;
+        timestamp_ = 0;
+        count_ = 1;
+        altitudeType_ = AltitudeType::UNKNOWN;
+        isNHz_ = false;
+        // Keeps the capacity of earlier reports, resize() only allocates to grow
+        storage_.resize(alignUp(bytes) / sizeof(uint64_t));
+        return reinterpret_cast<uint8_t *>(storage_.data());
+    }
+
+    LocationReportType type_ = LOC_REPORT_FIX;
+    uint64_t sequence_ = 0;
+    uint64_t timestamp_ = 0;
+    uint32_t count_ = 0;
+    AltitudeType altitudeType_ = AltitudeType::UNKNOWN;
+    bool isNHz_ = false;
+    std::vector<uint64_t> storage_;
+};
+
+/**
+ * @brief Listener of compact location reports.
+ *
+ * onLocationReport can be invoked from multiple threads, like the methods of
+ * @ref telux::loc::ILocationListener.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class ILocationReportListener {
+ public:
+    /**
+     * Called with each report of a type the listener subscribed to.
+     *
+     * @param [in] report - Read-only report shared with the other listeners. It may be kept;
+     *                      its buffer is reused only once no listener holds it.
+     */
+    virtual void onLocationReport(const std::shared_ptr<const LocationReport> &report) {
+    }
+
+    virtual ~ILocationReportListener() {
+    }
+};
+
+/**
+ * @brief LocationReportDispatcher builds each compact report once and delivers it to the
+ * listeners subscribed to its type.
+ *
+ * Reports of a type no listener subscribed to are not built: the publish methods return false
+ * without copying anything, and @ref getSubscribedTypes (mapped with
+ * @ref toGnssReportTypeMask) tells the report source which reports to request at all.
+ *
+ * Delivery does not take a lock: publishers read an immutable list of subscribers, and
+ * registration replaces the list and waits until no publisher reads the old one anymore, as
+ * with read-copy-update. Report buffers are recycled from a pool, so in steady state a report
+ * costs no memory allocation, whatever the number of listeners.
+ *
+ * Listeners are held as weak pointers. Publishing may happen on several threads.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationReportDispatcher {
+ public:
+    /** Report buffers kept for reuse. */
+    static constexpr size_t DEFAULT_POOL_SIZE = 16;
+
+    /**
+     * Delivery counters.
+     */
+    struct Stats {
+        uint64_t published;    /**< Reports built and delivered */
+        uint64_t skipped;      /**< Reports not built, no listener subscribed to their type */
+        uint64_t deliveries;   /**< Calls of onLocationReport */
+        uint64_t allocations;  /**< Report buffers allocated, not reused from the pool */
+    };
+
+    explicit LocationReportDispatcher(size_t poolSize = DEFAULT_POOL_SIZE)
+       : poolSize_(poolSize) {
+        list_.store(new SubscriberList());
+        readers_[0].store(0);
+        readers_[1].store(0);
+    }
+
+    /**
+     * No report may be published while the dispatcher is destroyed.
+     */
+    ~LocationReportDispatcher() {
+        delete list_.load();
+        for (auto list : retired_) {
+            delete list;
+        }
+    }
+
+    LocationReportDispatcher(const LocationReportDispatcher &) = delete;
+    LocationReportDispatcher &operator=(const LocationReportDispatcher &) = delete;
+
+    /**
+     * Subscribes listener to the report types in mask, or changes the types of a registered
+     * listener. Returns once reports published from then on reach the listener as subscribed.
+     *
+     * @returns INVALIDPARAM if listener is expired or mask is empty
+     */
+    telux::common::Status registerListener(std::weak_ptr<ILocationReportListener> listener,
+        LocationReportMask mask) {
+        if (listener.expired() || (mask & LOC_REPORT_ALL) == 0) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        std::lock_guard<std::mutex> lock(updateMutex_);
+        SubscriberList *list = new SubscriberList();
+        bool found = false;
+        for (const auto &subscriber : list_.load()->subscribers) {
+            if (subscriber.listener.expired()) {
+                continue;
+            }
+            list->subscribers.push_back(subscriber);
+            if (sameOwner(subscriber.listener, listener)) {
+                list->subscribers.back().mask = mask & LOC_REPORT_ALL;
+                found = true;
+            }
+        }
+        if (!found) {
+            list->subscribers.push_back(Subscriber{listener, mask & LOC_REPORT_ALL});
+        }
+        replace(list);
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Unsubscribes listener. Returns once no report is being delivered to it anymore, unless
+     * called from onLocationReport, when reports published concurrently on other threads may
+     * still reach it.
+     *
+     * @returns NOSUCH if listener is not registered
+     */
+    telux::common::Status deregisterListener(std::weak_ptr<ILocationReportListener> listener) {
+        std::lock_guard<std::mutex> lock(updateMutex_);
+        SubscriberList *list = new SubscriberList();
+        bool found = false;
+        for (const auto &subscriber : list_.load()->subscribers) {
+            if (sameOwner(subscriber.listener, listener)) {
+                found = true;
+            } else if (!subscriber.listener.expired()) {
+                list->subscribers.push_back(subscriber);
+            }
+        }
+        if (!found) {
+            delete list;
+            return telux::common::Status::NOSUCH;
+        }
+        replace(list);
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Sets a function called with the new union of the subscribed types whenever it changes,
+     * e.g. to restart the detailed reports with the matching @ref toGnssReportTypeMask. It is
+     * called on the thread that registers or deregisters a listener.
+     */
+    void setSubscriptionListener(std::function<void(LocationReportMask)> onChange) {
+        std::lock_guard<std::mutex> lock(updateMutex_);
+        onSubscriptionChange_ = onChange;
+    }
+
+    /**
+     * Union of the report types the listeners subscribed to.
+     */
+    LocationReportMask getSubscribedTypes() const {
+        return subscribed_.load(std::memory_order_acquire);
+    }
+
+    bool isSubscribed(LocationReportType type) const {
+        return (getSubscribedTypes() & type) != 0;
+    }
+
+    /**
+     * The reports to request from @ref telux::loc::ILocationManager::startDetailedReports for
+     * the report types in mask.
+     *
+     * @param [in] highRate - request LOC_REPORT_MEASUREMENTS at high rate
+     */
+    static GnssReportTypeMask toGnssReportTypeMask(LocationReportMask mask,
+        bool highRate = false) {
+        GnssReportTypeMask reports = 0;
+        if (mask & LOC_REPORT_FIX) {
+            reports |= GnssReportType::LOCATION;
+        }
+        if (mask & LOC_REPORT_SV_INFO) {
+            reports |= GnssReportType::SATELLITE_VEHICLE;
+        }
+        if (mask & LOC_REPORT_NMEA) {
+            reports |= GnssReportType::NMEA;
+        }
+        if (mask & LOC_REPORT_SIGNAL_INFO) {
+            reports |= GnssReportType::DATA;
+        }
+        if (mask & LOC_REPORT_MEASUREMENTS) {
+            reports |= highRate ? GnssReportType::HIGH_RATE_MEASUREMENT
+                                : GnssReportType::MEASUREMENT;
+        }
+        return reports;
+    }
+
+    /**
+     * @returns false if no listener subscribed to LOC_REPORT_FIX and nothing was built
+     */
+    bool publishFix(const CompactLocationFix &fix) {
+        return publish(LOC_REPORT_FIX, sizeof(fix), [&fix](LocationReport &report, uint8_t *p) {
+            std::memcpy(p, &fix, sizeof(fix));
+            report.timestamp_ = fix.timestamp;
+        });
+    }
+
+    /**
+     * @returns false if no listener subscribed to LOC_REPORT_SV_INFO and nothing was built
+     */
+    bool publishSvInfo(AltitudeType altitudeType, const CompactSvInfo *svs, uint32_t count) {
+        return publishSvInfoWith(altitudeType, count, [svs, count](CompactSvInfo *out) {
+            std::copy(svs, svs + count, out);
+        });
+    }
+
+    /**
+     * Builds the report in place: fill(CompactSvInfo *out) writes count satellites to out. fill
+     * is not called if no listener subscribed to LOC_REPORT_SV_INFO.
+     */
+    template <typename Fill>
+    bool publishSvInfoWith(AltitudeType altitudeType, uint32_t count, Fill fill) {
+        return publish(LOC_REPORT_SV_INFO, count * sizeof(CompactSvInfo),
+            [&](LocationReport &report, uint8_t *p) {
+                fill(reinterpret_cast<CompactSvInfo *>(p));
+                report.count_ = count;
+                report.altitudeType_ = altitudeType;
+            });
+    }
+
+    bool publishSignalInfo(const GnssData &data) {
+        return publish(LOC_REPORT_SIGNAL_INFO, sizeof(data),
+            [&data](LocationReport &, uint8_t *p) { std::memcpy(p, &data, sizeof(data)); });
+    }
+
+    bool publishNmea(uint64_t timestamp, const char *sentence, size_t length) {
+        return publish(LOC_REPORT_NMEA, length + 1, [&](LocationReport &report, uint8_t *p) {
+            std::memcpy(p, sentence, length);
+            p[length] = '\0';
+            report.count_ = static_cast<uint32_t>(length);
+            report.timestamp_ = timestamp;
+        });
+    }
+
+    bool publishMeasurements(const GnssMeasurementsClock &clock, bool isNHz,
+        const GnssMeasurementsData *measurements, uint32_t count) {
+        return publishMeasurementsWith(clock, isNHz, count,
+            [measurements, count](GnssMeasurementsData *out) {
+                std::copy(measurements, measurements + count, out);
+            });
+    }
+
+    /**
+     * Builds the report in place: fill(GnssMeasurementsData *out) writes count measurements
+     * to out. fill is not called if no listener subscribed to LOC_REPORT_MEASUREMENTS.
+     */
+    template <typename Fill>
+    bool publishMeasurementsWith(const GnssMeasurementsClock &clock, bool isNHz, uint32_t count,
+        Fill fill) {
+        const size_t offset = LocationReport::alignUp(sizeof(clock));
+        return publish(LOC_REPORT_MEASUREMENTS, offset + count * sizeof(GnssMeasurementsData),
+            [&](LocationReport &report, uint8_t *p) {
+                std::memcpy(p, &clock, sizeof(clock));
+                fill(reinterpret_cast<GnssMeasurementsData *>(p + offset));
+                report.count_ = count;
+                report.isNHz_ = isNHz;
+            });
+    }
+
+    Stats getStats() const {
+        Stats stats;
+        stats.published = published_.load(std::memory_order_relaxed);
+        stats.skipped = skipped_.load(std::memory_order_relaxed);
+        stats.deliveries = deliveries_.load(std::memory_order_relaxed);
+        stats.allocations = allocations_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+ private:
+    struct Subscriber {
+        std::weak_ptr<ILocationReportListener> listener;
+        LocationReportMask mask;
+    };
+
+    struct SubscriberList {
+        std::vector<Subscriber> subscribers;
+    };
+
+    // Marks the thread as reading a subscriber list from enter() to leave(). The reader counts
+    // its epoch's parity; a writer that advanced the epoch waits for the old parity to drain.
+    class ReadSection {
+     public:
+        explicit ReadSection(LocationReportDispatcher &dispatcher)
+           : dispatcher_(dispatcher) {
+            for (;;) {
+                epoch_ = dispatcher_.epoch_.load();
+                dispatcher_.readers_[epoch_ & 1].fetch_add(1);
+                if (dispatcher_.epoch_.load() == epoch_) {
+                    break;
+                }
+                dispatcher_.readers_[epoch_ & 1].fetch_sub(1);
+            }
+            ++depth();
+        }
+
+        ~ReadSection() {
+            --depth();
+            dispatcher_.readers_[epoch_ & 1].fetch_sub(1, std::memory_order_release);
+        }
+
+        // Read sections open on the calling thread, in any dispatcher
+        static int &depth() {
+            static thread_local int depth = 0;
+            return depth;
+        }
+
+     private:
+        LocationReportDispatcher &dispatcher_;
+        uint32_t epoch_;
+    };
+
+    static bool sameOwner(const std::weak_ptr<ILocationReportListener> &a,
+        const std::weak_ptr<ILocationReportListener> &b) {
+        return !a.owner_before(b) && !b.owner_before(a);
+    }
+
+    // Called with updateMutex_ held
+    void replace(SubscriberList *list) {
+        LocationReportMask subscribed = 0;
+        for (const auto &subscriber : list->subscribers) {
+            subscribed |= subscriber.mask;
+        }
+        retired_.push_back(list_.exchange(list));
+        const LocationReportMask previous = subscribed_.exchange(subscribed);
+        // A thread that delivers a report cannot wait for itself; the old lists are freed
+        // by a later update
+        if (ReadSection::depth() == 0) {
+            const uint32_t epoch = epoch_.fetch_add(1);
+            while (readers_[epoch & 1].load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+            for (auto old : retired_) {
+                delete old;
+            }
+            retired_.clear();
+        }
+        if (previous != subscribed && onSubscriptionChange_) {
+            onSubscriptionChange_(subscribed);
+        }
+    }
+
+    std::shared_ptr<LocationReport> acquire() {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        for (auto &report : pool_) {
+            if (report.use_count() == 1) {
+                // Pairs with the release of the last listener reference
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return report;
+            }
+        }
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        auto report = std::make_shared<LocationReport>();
+        if (pool_.size() < poolSize_) {
+            pool_.push_back(report);
+        }
+        return report;
+    }
+
+    template <typename Build>
+    bool publish(LocationReportType type, size_t bytes, Build build) {
+        if (!isSubscribed(type)) {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::shared_ptr<LocationReport> report = acquire();
+        build(*report, report->prepare(type, bytes));
+        report->sequence_ = sequence_.fetch_add(1, std::memory_order_relaxed);
+        std::shared_ptr<const LocationReport> shared(std::move(report));
+        published_.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t delivered = 0;
+        {
+            ReadSection section(*this);
+            const SubscriberList *list = list_.load();
+            for (const auto &subscriber : list->subscribers) {
+                if ((subscriber.mask & type) == 0) {
+                    continue;
+                }
+                std::shared_ptr<ILocationReportListener> listener = subscriber.listener.lock();
+                if (listener) {
+                    listener->onLocationReport(shared);
+                    ++delivered;
+                }
+            }
+        }
+        deliveries_.fetch_add(delivered, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::atomic<SubscriberList *> list_;
+    std::atomic<LocationReportMask> subscribed_{0};
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> readers_[2];
+    std::mutex updateMutex_;
+    std::vector<SubscriberList *> retired_;
+    std::function<void(LocationReportMask)> onSubscriptionChange_;
+
+    std::mutex poolMutex_;
+    std::vector<std::shared_ptr<LocationReport>> pool_;
+    const size_t poolSize_;
+
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> deliveries_{0};
+    std::atomic<uint64_t> allocations_{0};
+};
+
+/**
+ * @brief LocationReportAdapter is an @ref telux::loc::ILocationListener that converts the
+ * detailed reports of a location manager into compact reports published on a dispatcher.
+ *
+ * Register it with the location manager and start the detailed reports with
+ * LocationReportDispatcher::toGnssReportTypeMask(dispatcher->getSubscribedTypes()), so that
+ * the location service only produces the reports some listener needs. A report no listener
+ * subscribed to is not converted.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationReportAdapter : public ILocationListener {
+ public:
+    explicit LocationReportAdapter(std::shared_ptr<LocationReportDispatcher> dispatcher)
+       : dispatcher_(dispatcher) {
+    }
+
+    void onDetailedLocationUpdate(const std::shared_ptr<ILocationInfoEx> &info) override {
+        if (info && dispatcher_->isSubscribed(LOC_REPORT_FIX)) {
+            dispatcher_->publishFix(toCompactFix(*info));
+        }
+    }
+
+    void onGnssSVInfo(const std::shared_ptr<IGnssSVInfo> &info) override {
+        if (!info || !dispatcher_->isSubscribed(LOC_REPORT_SV_INFO)) {
+            return;
+        }
+        const std::vector<std::shared_ptr<ISVInfo>> svs = info->getSVInfoList();
+        dispatcher_->publishSvInfoWith(info->getAltitudeType(),
+            static_cast<uint32_t>(svs.size()), [&svs](CompactSvInfo *out) {
+                for (const auto &sv : svs) {
+                    *out++ = toCompactSvInfo(*sv);
+                }
+            });
+    }
+
+    void onGnssSignalInfo(const std::shared_ptr<IGnssSignalInfo> &info) override {
+        if (info && dispatcher_->isSubscribed(LOC_REPORT_SIGNAL_INFO)) {
+            dispatcher_->publishSignalInfo(info->getGnssData());
+        }
+    }
+
+    void onGnssNmeaInfo(uint64_t timestamp, const std::string &nmea) override {
+        dispatcher_->publishNmea(timestamp, nmea.data(), nmea.size());
+    }
+
+    void onGnssMeasurementsInfo(const GnssMeasurements &info) override {
+        dispatcher_->publishMeasurements(info.clock, info.isNHz, info.measurements.data(),
+            static_cast<uint32_t>(info.measurements.size()));
+    }
+
+    static CompactLocationFix toCompactFix(ILocationInfoEx &info) {
+        CompactLocationFix fix;
+        std::memset(&fix, 0, sizeof(fix));
+        fix.timestamp = info.getTimeStamp();
+        fix.elapsedRealTime = info.getElapsedRealTime();
+        fix.latitude = info.getLatitude();
+        fix.longitude = info.getLongitude();
+        fix.altitude = info.getAltitude();
+        fix.altitudeMeanSeaLevel = info.getAltitudeMeanSeaLevel();
+        fix.speed = info.getSpeed();
+        fix.heading = info.getHeading();
+        fix.horizontalUncertainty = info.getHorizontalUncertainty();
+        fix.verticalUncertainty = info.getVerticalUncertainty();
+        fix.speedUncertainty = info.getSpeedUncertainty();
+        fix.headingUncertainty = info.getHeadingUncertainty();
+        fix.horizontalUncertaintySemiMajor = info.getHorizontalUncertaintySemiMajor();
+        fix.horizontalUncertaintySemiMinor = info.getHorizontalUncertaintySemiMinor();
+        fix.horizontalUncertaintyAzimuth = info.getHorizontalUncertaintyAzimuth();
+        fix.eastStandardDeviation = info.getEastStandardDeviation();
+        fix.northStandardDeviation = info.getNorthStandardDeviation();
+        fix.positionDop = info.getPositionDop();
+        fix.horizontalDop = info.getHorizontalDop();
+        fix.verticalDop = info.getVerticalDop();
+        fix.timeUncMs = info.getTimeUncMs();
+        std::vector<float> enu;
+        if (info.getVelocityEastNorthUp(enu) == telux::common::Status::SUCCESS) {
+            std::copy_n(enu.begin(), std::min<size_t>(enu.size(), 3), fix.velocityEastNorthUp);
+        }
+        enu.clear();
+        if (info.getVelocityUncertaintyEastNorthUp(enu) == telux::common::Status::SUCCESS) {
+            std::copy_n(enu.begin(), std::min<size_t>(enu.size(), 3),
+                fix.velocityUncertaintyEastNorthUp);
+        }
+        fix.validity = info.getLocationInfoValidity();
+        fix.exValidity = info.getLocationInfoExValidity();
+        fix.techMask = info.getTechMask();
+        fix.positionTechnology = info.getPositionTechnology();
+        fix.numSvUsed = info.getNumSvUsed();
+        info.getLeapSeconds(fix.leapSeconds);
+        fix.calibrationConfidencePercent = info.getCalibrationConfidencePercent();
+        fix.calibrationStatus = info.getCalibrationStatus();
+        fix.bodyFrameData = info.getBodyFrameData();
+        fix.svUsedInPosition = info.getSvUsedInPosition();
+        fix.gnssSystemTime = info.getGnssSystemTime();
+        return fix;
+    }
+
+    static CompactSvInfo toCompactSvInfo(ISVInfo &sv) {
+        CompactSvInfo info;
+        info.constellation = sv.getConstellation();
+        info.id = sv.getId();
+        info.glonassFcn = sv.getGlonassFcn();
+        info.health = sv.getSVHealthStatus();
+        info.status = sv.getStatus();
+        info.hasEphemeris = sv.getHasEphemeris();
+        info.hasAlmanac = sv.getHasAlmanac();
+        info.hasFix = sv.getHasFix();
+        info.elevation = sv.getElevation();
+        info.azimuth = sv.getAzimuth();
+        info.snr = sv.getSnr();
+        info.carrierFrequency = sv.getCarrierFrequency();
+        info.signalType = sv.getSignalType();
+        info.basebandCnr = sv.getBasebandCnr();
+        return info;
+    }
+
+ private:
+    std::shared_ptr<LocationReportDispatcher> dispatcher_;
+};
+
+/**
+ * @brief LocationReportGenerator makes plausible synthetic reports of every type, for tests
+ * and benchmarks of report consumers without a location service.
+ *
+ * The fixes follow a vehicle driving at 15 m/s on a circle of 500 m radius. Satellites,
+ * signals and measurements carry deterministic pseudo-random values; NMEA sentences alternate
+ * between GGA and RMC with valid checksums.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class LocationReportGenerator {
+ public:
+    explicit LocationReportGenerator(uint32_t seed = 1)
+       : rng_(seed) {
+    }
+
+    CompactLocationFix fix(uint64_t timestamp) {
+        const double radius = 500.0;
+        const double speed = 15.0;
+        const double angle = std::fmod(timestamp / 1000.0 * speed / radius, 2 * M_PI);
+        CompactLocationFix fix;
+        std::memset(&fix, 0, sizeof(fix));
+        fix.timestamp = timestamp;
+        fix.elapsedRealTime = timestamp * 1000000ULL;
+        fix.latitude = LATITUDE + radius * std::cos(angle) / 111195.0;
+        fix.longitude = LONGITUDE
+            + radius * std::sin(angle) / (111195.0 * std::cos(LATITUDE * M_PI / 180));
+        fix.altitude = 30 + uniform(-0.5, 0.5);
+        fix.altitudeMeanSeaLevel = static_cast<float>(fix.altitude) + 32;
+        fix.speed = static_cast<float>(speed + uniform(-0.1, 0.1));
+        fix.heading = static_cast<float>(std::fmod((angle + M_PI / 2) * 180 / M_PI, 360.0));
+        fix.horizontalUncertainty = static_cast<float>(uniform(0.5, 2));
+        fix.verticalUncertainty = static_cast<float>(uniform(1, 3));
+        fix.speedUncertainty = 0.2f;
+        fix.headingUncertainty = 1.5f;
+        fix.horizontalUncertaintySemiMajor = fix.horizontalUncertainty;
+        fix.horizontalUncertaintySemiMinor = fix.horizontalUncertainty * 0.7f;
+        fix.horizontalUncertaintyAzimuth = static_cast<float>(uniform(0, 180));
+        fix.horizontalDop = static_cast<float>(uniform(0.6, 1.5));
+        fix.numSvUsed = static_cast<uint16_t>(8 + rng_() % 12);
+        fix.bodyFrameData.yawRate = static_cast<float>(speed / radius);
+        fix.bodyFrameData.latAccel = static_cast<float>(speed * speed / radius);
+        fix.bodyFrameData.bodyFrameDataMask = HAS_LAT_ACCEL | HAS_YAW_RATE;
+        fix.validity = HAS_LAT_LONG_BIT | HAS_ALTITUDE_BIT | HAS_SPEED_BIT | HAS_HEADING_BIT
+            | HAS_HORIZONTAL_ACCURACY_BIT | HAS_VERTICAL_ACCURACY_BIT | HAS_SPEED_ACCURACY_BIT
+            | HAS_HEADING_ACCURACY_BIT | HAS_TIMESTAMP_BIT;
+        fix.exValidity = HAS_HOR_ACCURACY_ELIP_SEMI_MAJOR | HAS_HOR_ACCURACY_ELIP_SEMI_MINOR
+            | HAS_HOR_ACCURACY_ELIP_AZIMUTH | HAS_POS_DYNAMICS_DATA;
+        fix.techMask = LOC_GNSS;
+        return fix;
+    }
+
+    void svInfo(CompactSvInfo *out, uint32_t count) {
+        static const GnssConstellationType constellations[] = {GnssConstellationType::GPS,
+            GnssConstellationType::GLONASS, GnssConstellationType::GALILEO,
+            GnssConstellationType::BDS};
+        for (uint32_t i = 0; i < count; ++i) {
+            CompactSvInfo &sv = out[i];
+            sv.constellation = constellations[i % 4];
+            sv.id = static_cast<uint16_t>(1 + i);
+            sv.glonassFcn = 0;
+            sv.health = SVHealthStatus::HEALTHY;
+            sv.status = SVStatus::TRACK;
+            sv.hasEphemeris = SVInfoAvailability::YES;
+            sv.hasAlmanac = SVInfoAvailability::YES;
+            sv.hasFix = (i % 3) ? SVInfoAvailability::YES : SVInfoAvailability::NO;
+            sv.elevation = static_cast<float>(uniform(5, 90));
+            sv.azimuth = static_cast<float>(uniform(0, 360));
+            sv.snr = static_cast<float>(uniform(15, 48));
+            sv.carrierFrequency = 1575.42e6f;
+            sv.signalType = GPS_L1CA;
+            sv.basebandCnr = sv.snr - 2.0;
+        }
+    }
+
+    GnssData signalInfo() {
+        GnssData data;
+        for (int i = 0; i < GNSS_DATA_MAX_NUMBER_OF_SIGNAL_TYPES; ++i) {
+            data.gnssDataMask[i] = HAS_JAMMER | HAS_AGC;
+            data.jammerInd[i] = uniform(0, 10);
+            data.agc[i] = uniform(-5, 5);
+        }
+        return data;
+    }
+
+    /**
+     * Writes a sentence of at most size - 1 characters and a NUL to out.
+     *
+     * @returns length of the sentence
+     */
+    size_t nmea(uint64_t timestamp, char *out, size_t size) {
+        const CompactLocationFix f = fix(timestamp);
+        const unsigned seconds = static_cast<unsigned>((timestamp / 1000) % 86400);
+        const unsigned centis = static_cast<unsigned>((timestamp % 1000) / 10);
+        const double lat = std::fabs(f.latitude);
+        const double lon = std::fabs(f.longitude);
+        char body[128];
+        if (nmeaCount_++ % 2 == 0) {
+            std::snprintf(body, sizeof(body),
+                "GPGGA,%02u%02u%02u.%02u,%02d%08.5f,%c,%03d%08.5f,%c,1,%02u,%.1f,%.1f,M,-32.0,M,,",
+                seconds / 3600, seconds / 60 % 60, seconds % 60, centis, int(lat),
+                (lat - int(lat)) * 60, f.latitude < 0 ? 'S' : 'N', int(lon),
+                (lon - int(lon)) * 60, f.longitude < 0 ? 'W' : 'E', f.numSvUsed,
+                f.horizontalDop, f.altitudeMeanSeaLevel);
+        } else {
+            std::snprintf(body, sizeof(body),
+                "GPRMC,%02u%02u%02u.%02u,A,%02d%08.5f,%c,%03d%08.5f,%c,%.1f,%.1f,,,,A",
+                seconds / 3600, seconds / 60 % 60, seconds % 60, centis, int(lat),
+                (lat - int(lat)) * 60, f.latitude < 0 ? 'S' : 'N', int(lon),
+                (lon - int(lon)) * 60, f.longitude < 0 ? 'W' : 'E', f.speed * 1.943844,
+                f.heading);
+        }
+        uint8_t checksum = 0;
+        for (const char *c = body; *c; ++c) {
+            checksum ^= static_cast<uint8_t>(*c);
+        }
+        const int length = std::snprintf(out, size, "$%s*%02X", body, checksum);
+        return std::min(static_cast<size_t>(length), size ? size - 1 : 0);
+    }
+
+    GnssMeasurementsClock clock(uint64_t timestamp) {
+        GnssMeasurementsClock clock;
+        std::memset(&clock, 0, sizeof(clock));
+        clock.valid = 0x3FF;
+        clock.leapSecond = 18;
+        clock.timeNs = static_cast<int64_t>(timestamp) * 1000000;
+        clock.timeUncertaintyNs = 10;
+        clock.fullBiasNs = -1234567890123LL;
+        clock.biasNs = uniform(0, 1);
+        clock.driftNsps = uniform(-20, 20);
+        return clock;
+    }
+
+    void measurements(GnssMeasurementsData *out, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            GnssMeasurementsData &m = out[i];
+            std::memset(&m, 0, sizeof(m));
+            m.valid = 0x7FFF;
+            m.svId = static_cast<int16_t>(1 + i);
+            m.svType = GnssConstellationType::GPS;
+            m.receivedSvTimeNs = static_cast<int64_t>(rng_());
+            m.carrierToNoiseDbHz = uniform(15, 48);
+            m.pseudorangeRateMps = uniform(-800, 800);
+            m.pseudorangeRateUncertaintyMps = uniform(0, 1);
+            m.adrMeters = uniform(0, 1e6);
+            m.carrierFrequencyHz = 1575.42e6f;
+            m.gnssSignalType = GPS_L1CA;
+        }
+    }
+
+    /**
+     * Publishes one epoch: a fix, svCount satellites, the signal info, nmeaSentences sentences
+     * and measurementCount measurements, building only what dispatcher has subscribers for.
+     *
+     * @returns number of reports published
+     */
+    size_t publishEpoch(LocationReportDispatcher &dispatcher, uint64_t timestamp,
+        uint32_t svCount, uint32_t nmeaSentences, uint32_t measurementCount) {
+        size_t published = 0;
+        if (dispatcher.isSubscribed(LOC_REPORT_FIX)) {
+            published += dispatcher.publishFix(fix(timestamp));
+        }
+        published += dispatcher.publishSvInfoWith(AltitudeType::CALCULATED, svCount,
+            [this, svCount](CompactSvInfo *out) { svInfo(out, svCount); });
+        if (dispatcher.isSubscribed(LOC_REPORT_SIGNAL_INFO)) {
+            published += dispatcher.publishSignalInfo(signalInfo());
+        }
+        if (dispatcher.isSubscribed(LOC_REPORT_NMEA)) {
+            char sentence[128];
+            for (uint32_t i = 0; i < nmeaSentences; ++i) {
+                const size_t length = nmea(timestamp, sentence, sizeof(sentence));
+                published += dispatcher.publishNmea(timestamp, sentence, length);
+            }
+        }
+        if (dispatcher.isSubscribed(LOC_REPORT_MEASUREMENTS)) {
+            published += dispatcher.publishMeasurementsWith(clock(timestamp), true,
+                measurementCount,
+                [this, measurementCount](GnssMeasurementsData *out) {
+                    measurements(out, measurementCount);
+                });
+        }
+        return published;
+    }
+
+ private:
+    static constexpr double LATITUDE = 37.3861;
+    static constexpr double LONGITUDE = -122.0839;
+
+    double uniform(double low, double high) {
+        return low + (high - low) * (rng_() / 4294967296.0);
+    }
+
+    std::mt19937 rng_;
+    uint32_t nmeaCount_ = 0;
+};
+
+constexpr size_t LocationReportDispatcher::DEFAULT_POOL_SIZE;
+constexpr double LocationReportGenerator::LATITUDE;
+constexpr double LocationReportGenerator::LONGITUDE;
+
+/** @} */ /* end_addtogroup telematics_location */
+}  // namespace loc
+}  // namespace telux
+
+#endif  // TELUX_LOC_LOCATIONREPORT_HPP
@@ -239,7 +239,15 @@ void ApplicationBase::saveConfiguration(map<string, string> configs) {
 
 
     this->configuration.locationInterval = stoi(configs["LocationInterval"], nullptr, 10);
+    if (configs.find("ExtrapolateLocation") != configs.end()) {
+        istringstream isEl(configs["ExtrapolateLocation"]);
+        isEl >> boolalpha >> this->configuration.extrapolateLocation;
+    }
     this->configuration.bsmJitter = stoi(configs["BsmJitter"], nullptr, 10);
+    if (configs.find("EnableCongestionControl") != configs.end()) {
+        istringstream isCc(configs["EnableCongestionControl"]);
+        isCc >> boolalpha >> this->configuration.enableCongestionControl;
+    }
     istringstream is2(configs["EnableVehicleExt"]);
     is2 >> boolalpha >> this->configuration.enableVehicleExt;
     this->configuration.pathHistoryPoints = stoi(configs["PathHistoryPoints"], nullptr, 10);
@@ -486,6 +494,75 @@ int ApplicationBase::send(uint8_t index, TransmitType txType) {
 
     return encLength;
 }
+CongestionControl::Kinematics ApplicationBase::hostKinematics() {
+    CongestionControl::Kinematics host;
+    host.timeMs = CongestionControl::nowMs();
+    shared_ptr<ILocationInfoEx> locationInfo = kinematicsReceive->getLocation();
+    if (locationInfo != nullptr) {
+        host.latitude = locationInfo->getLatitude();
+        host.longitude = locationInfo->getLongitude();
+        host.speed = locationInfo->getSpeed();
+        host.heading = locationInfo->getHeading();
+    }
+    return host;
+}
+
+void ApplicationBase::updateCongestionControl(uint8_t index,
+        const CongestionControl::Kinematics& host) {
+    const auto& params = this->congestionControl.getParams();
+
+    this->congestionControl.update(host.timeMs);
+    if (this->ldm != nullptr && host.timeMs - this->lastDensityMs >= params.cbrWindowMs) {
+        this->congestionControl.setVehicleDensity(
+                this->ldm->countInRange(host.latitude, host.longitude, params.densityRangeM));
+        this->lastDensityMs = host.timeMs;
+    }
+    if (this->isTxSim) {
+        return;
+    }
+
+    const auto power = this->congestionControl.getTxPowerDbm();
+    if (power != this->appliedPowerDbm && !this->spsTransmits.empty()
+        && this->spsTransmits[0].cv2xRadioManager != nullptr) {
+        auto status = this->spsTransmits[0].cv2xRadioManager->setPeakTxPower(power,
+                [](ErrorCode error) {
+                    if (ErrorCode::SUCCESS != error) {
+                        cerr << "Set peak tx power failed, error " << (int)error << endl;
+                    }
+                });
+        if (Status::SUCCESS == status) {
+            this->appliedPowerDbm = power;
+        }
+    }
+
+    // Reserve SPS resources at the ITT, rounded down to a supported periodicity, so
+    // the flow does not hold reservations the scheduler leaves unused.
+    const auto periodMs = this->congestionControl.getIttMs() / 100 * 100;
+    if (periodMs != this->appliedSpsPeriodMs && index < this->spsTransmits.size()) {
+        SpsFlowInfo spsInfo;
+        spsInfo.periodicityMs = periodMs;
+        if (Status::SUCCESS == this->spsTransmits[index].updateSpsFlowAsync(spsInfo)) {
+            this->appliedSpsPeriodMs = periodMs;
+        }
+    }
+}
+
+int ApplicationBase::sendIfDue(uint8_t index, TransmitType txType) {
+    if (!this->configuration.enableCongestionControl) {
+        return this->send(index, txType);
+    }
+    const auto host = this->hostKinematics();
+    this->updateCongestionControl(index, host);
+    if (CongestionControl::TxReason::NONE == this->congestionControl.txDue(host)) {
+        return 0;
+    }
+    const auto ret = this->send(index, txType);
+    if (ret > 0) {
+        this->congestionControl.onTransmitted(host);
+    }
+    return ret;
+}
+
 void ApplicationBase::closeAllRadio() {
     for (uint8_t i = 0; i<this->eventTransmits.size(); i++)
     {
@@ -520,6 +597,9 @@ int ApplicationBase::receive(const uint8_t index, const uint16_t bufLen) {
         cout << "Something went wrong with reception. \n";
         return -1;
     }
+    if (this->configuration.enableCongestionControl) {
+        this->congestionControl.onPacketReceived(bufLen);
+    }
     if (isRxSim)
     {
         mc = rxSimMsg.get();
@@ -559,6 +639,9 @@ int ApplicationBase::receive(const uint8_t index, const uint16_t bufLen, const u
     int ret;
     msg_contents *mc = nullptr;
 
+    if (this->configuration.enableCongestionControl) {
+        this->congestionControl.onPacketReceived(bufLen);
+    }
     if (isRxSim) {
         mc = rxSimMsg.get();
     }else{
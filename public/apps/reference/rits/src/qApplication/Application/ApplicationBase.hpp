@@ -52,6 +52,7 @@
 #include "RadioTransmit.h"
 #include "Ldm.h"
 #include "VehicleReceive.h"
+#include "CongestionControl.hpp"
 #ifdef SECURITY
 #include "SecurityImpl.hpp"
 #else
@@ -90,7 +91,9 @@ struct Config{
     uint16_t ldmSize = 1;
     uint16_t transmitRate = 100;
     uint16_t locationInterval = 100;
+    bool extrapolateLocation = false;
     uint16_t bsmJitter = 0;
+    bool enableCongestionControl = false;
     bool enableVehicleExt = false;
     uint8_t pathHistoryPoints = 15;
     uint8_t vehicleWidth = 0;
@@ -180,6 +183,16 @@ public:
      */
     virtual void fillMsg(std::shared_ptr<msg_contents> mc) = 0;
 
+    /**
+    * sendIfDue  send V2X message when the congestion control scheduler says the host is
+    * due, to be called every CongestionControl::Params::tickMs. Without
+    * EnableCongestionControl it sends on every call like send().
+    * @param index - message content index.
+    * @param type - The type of flow (event, sps) in which bsm will transmit.
+    * @return encoded length if sent, 0 if not due, negative on failure.
+    */
+    int sendIfDue(uint8_t index, TransmitType txType);
+
     /**
     * Closes all tx and rx flows from Snaptel SDK.
     */
@@ -245,6 +258,12 @@ public:
     */
     Ldm* ldm = nullptr;
 
+    /**
+    * Transmit rate and power scheduler, fed by receive() and the LDM when
+    * EnableCongestionControl is set.
+    */
+    CongestionControl congestionControl;
+
 protected:
     //const uint16_t bufLength = 3000;
     bool isTxSim = false;
@@ -297,6 +316,16 @@ private:
     void simRxSetup(const string ipv4, const uint16_t port);
     static uint16_t delimiterPos(string line, vector<string> delimiters);
     void loadConfiguration(char* file);
+
+    /**
+    * Updates the scheduler inputs (CBR window, LDM density) and applies its outputs:
+    * peak TX power on the radio and the SPS reservation of flow index.
+    */
+    void updateCongestionControl(uint8_t index, const CongestionControl::Kinematics& host);
+    CongestionControl::Kinematics hostKinematics();
+    uint64_t lastDensityMs = 0;
+    int8_t appliedPowerDbm = 0;
+    uint32_t appliedSpsPeriodMs = 0;
     void saveConfiguration(map<string, string> configs);
 
 };
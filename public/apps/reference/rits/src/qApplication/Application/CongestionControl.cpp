@@ -0,0 +1,217 @@
+/*
+ *  Copyright (c) 2019-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: CongestionControl.cpp
+  *
+  * @brief: Implementation of CongestionControl.
+  */
+
+#include <chrono>
+#include <cmath>
+#include "CongestionControl.hpp"
+
+using std::lock_guard;
+using std::mutex;
+
+static const double EARTH_RADIUS_M = 6371000.0;
+static const double DEG_TO_RAD = M_PI / 180.0;
+
+CongestionControl::CongestionControl() : CongestionControl(Params()) {
+}
+
+CongestionControl::CongestionControl(const Params& params) : params(params),
+    rng(std::random_device{}()) {
+    this->ittMs = params.minIttMs;
+    this->powerDbm = params.maxPowerDbm;
+}
+
+void CongestionControl::onPacketReceived(const uint16_t len) {
+    const uint64_t airtimeUs = this->params.packetOverheadUs
+        + (static_cast<uint64_t>(len) * 8 * 1000000) / this->params.channelBitRate;
+    this->windowBusyUs.fetch_add(airtimeUs, std::memory_order_relaxed);
+}
+
+void CongestionControl::setChannelBusyRatio(const double cbr) {
+    lock_guard<mutex> lk(this->sync);
+    this->reportedCbr = cbr;
+}
+
+void CongestionControl::setVehicleDensity(const uint32_t vehicles) {
+    lock_guard<mutex> lk(this->sync);
+    if (!this->densityValid) {
+        this->density = vehicles;
+        this->densityValid = true;
+    } else {
+        this->density = this->params.densityWeight * vehicles
+            + (1 - this->params.densityWeight) * this->density;
+    }
+    this->recompute();
+}
+
+void CongestionControl::update(const uint64_t nowMs) {
+    lock_guard<mutex> lk(this->sync);
+    if (!this->windowStarted) {
+        this->windowStartMs = nowMs;
+        this->windowStarted = true;
+        this->windowBusyUs = 0;
+        return;
+    }
+    const auto elapsedMs = nowMs - this->windowStartMs;
+    if (elapsedMs < this->params.cbrWindowMs) {
+        return;
+    }
+    double measured = this->reportedCbr;
+    const auto busyUs = this->windowBusyUs.exchange(0, std::memory_order_relaxed);
+    if (measured < 0) {
+        measured = static_cast<double>(busyUs) / (elapsedMs * 1000.0);
+    }
+    if (measured > 1) {
+        measured = 1;
+    }
+    this->cbr = this->params.cbrWeight * measured + (1 - this->params.cbrWeight) * this->cbr;
+    this->windowStartMs = nowMs;
+    this->recompute();
+}
+
+// Callers hold sync
+void CongestionControl::recompute() {
+    auto itt = this->params.minIttMs * this->density / this->params.densityCoefficient;
+    if (itt < this->params.minIttMs) {
+        itt = this->params.minIttMs;
+    } else if (itt > this->params.maxIttMs) {
+        itt = this->params.maxIttMs;
+    }
+    this->ittMs = static_cast<uint32_t>(itt);
+
+    if (this->cbr <= this->params.cbrLow) {
+        this->powerDbm = this->params.maxPowerDbm;
+    } else if (this->cbr >= this->params.cbrHigh) {
+        this->powerDbm = this->params.minPowerDbm;
+    } else {
+        const auto slope = (this->params.maxPowerDbm - this->params.minPowerDbm)
+            / (this->params.cbrHigh - this->params.cbrLow);
+        this->powerDbm = static_cast<int8_t>(std::lround(this->params.maxPowerDbm
+            - slope * (this->cbr - this->params.cbrLow)));
+    }
+}
+
+CongestionControl::TxReason CongestionControl::txDue(const Kinematics& host) {
+    lock_guard<mutex> lk(this->sync);
+    if (!this->hasSent) {
+        return TxReason::ITT;
+    }
+    const auto sinceMs = host.timeMs - this->lastSent.timeMs;
+    if (sinceMs >= this->ittMs) {
+        return TxReason::ITT;
+    }
+    if (sinceMs < this->params.minIttMs) {
+        return TxReason::NONE;
+    }
+    // Between teMinM and teMaxM the transmission probability grows linearly
+    const auto te = trackingError(this->lastSent, host);
+    if (te >= this->params.teMaxM) {
+        return TxReason::TRACKING_ERROR;
+    }
+    if (te > this->params.teMinM) {
+        std::uniform_real_distribution<double> draw(this->params.teMinM, this->params.teMaxM);
+        if (draw(this->rng) < te) {
+            return TxReason::TRACKING_ERROR;
+        }
+    }
+    return TxReason::NONE;
+}
+
+void CongestionControl::onTransmitted(const Kinematics& host) {
+    lock_guard<mutex> lk(this->sync);
+    if (this->hasSent && host.timeMs - this->lastSent.timeMs < this->ittMs) {
+        this->teTxCount++;
+    } else {
+        this->ittTxCount++;
+    }
+    this->lastSent = host;
+    this->hasSent = true;
+}
+
+const CongestionControl::Params& CongestionControl::getParams() const {
+    return this->params;
+}
+
+uint32_t CongestionControl::getIttMs() const {
+    lock_guard<mutex> lk(this->sync);
+    return this->ittMs;
+}
+
+double CongestionControl::getChannelBusyRatio() const {
+    lock_guard<mutex> lk(this->sync);
+    return this->cbr;
+}
+
+double CongestionControl::getVehicleDensity() const {
+    lock_guard<mutex> lk(this->sync);
+    return this->density;
+}
+
+int8_t CongestionControl::getTxPowerDbm() const {
+    lock_guard<mutex> lk(this->sync);
+    return this->powerDbm;
+}
+
+uint32_t CongestionControl::getTrackingErrorTxCount() const {
+    lock_guard<mutex> lk(this->sync);
+    return this->teTxCount;
+}
+
+uint32_t CongestionControl::getIttTxCount() const {
+    lock_guard<mutex> lk(this->sync);
+    return this->ittTxCount;
+}
+
+double CongestionControl::trackingError(const Kinematics& sent, const Kinematics& host) {
+    const auto dt = (host.timeMs - sent.timeMs) / 1000.0;
+    const auto heading = sent.heading * DEG_TO_RAD;
+    const auto north = sent.speed * dt * std::cos(heading);
+    const auto east = sent.speed * dt * std::sin(heading);
+    const auto lat = sent.latitude + north / EARTH_RADIUS_M / DEG_TO_RAD;
+    const auto lon = sent.longitude
+        + east / (EARTH_RADIUS_M * std::cos(sent.latitude * DEG_TO_RAD)) / DEG_TO_RAD;
+    return distanceM(lat, lon, host.latitude, host.longitude);
+}
+
+double CongestionControl::distanceM(const double lat1, const double lon1,
+                                    const double lat2, const double lon2) {
+    const auto x = (lon2 - lon1) * DEG_TO_RAD * std::cos((lat1 + lat2) / 2 * DEG_TO_RAD);
+    const auto y = (lat2 - lat1) * DEG_TO_RAD;
+    return EARTH_RADIUS_M * std::sqrt(x * x + y * y);
+}
+
+uint64_t CongestionControl::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
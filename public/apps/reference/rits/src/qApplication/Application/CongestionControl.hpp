@@ -0,0 +1,195 @@
+/*
+ *  Copyright (c) 2019-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: CongestionControl.hpp
+  *
+  * @brief: SAE J2945/1 style transmit rate and power scheduler for the BSM TX path.
+  *
+  * The scheduler keeps three inputs up to date:
+  *  - channel busy ratio (CBR), estimated from the airtime of the packets received in
+  *    each measurement window, or taken from the radio when it reports one,
+  *  - vehicle density, the number of vehicles within densityRangeM (from the LDM),
+  *  - the host kinematics, to compute the tracking error of what the neighbours
+  *    extrapolate from the last transmitted BSM.
+  * From them it derives the inter-transmit time (ITT) and the radiated power, and
+  * txDue() decides whether the host transmits now.
+  */
+#ifndef __CONGESTION_CONTROL_HPP__
+#define __CONGESTION_CONTROL_HPP__
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+class CongestionControl
+{
+public:
+
+    /**
+     * Scheduler parameters, defaults follow SAE J2945/1.
+     */
+    struct Params {
+        /** Minimum and maximum inter-transmit time in ms. */
+        uint32_t minIttMs = 100;
+        uint32_t maxIttMs = 600;
+        /** ITT = minIttMs * density / densityCoefficient, clamped. */
+        double densityCoefficient = 25.0;
+        /** Radius in meters in which neighbours count towards the density. */
+        double densityRangeM = 100.0;
+        /** Weight of a new sample when smoothing density and CBR. */
+        double densityWeight = 0.05;
+        double cbrWeight = 0.5;
+        /** CBR measurement window in ms, also the density update period. */
+        uint32_t cbrWindowMs = 100;
+        /** Period in ms at which the TX path calls txDue(). */
+        uint32_t tickMs = 10;
+        /** Tracking error below teMinM never triggers, above teMaxM always does. */
+        double teMinM = 0.2;
+        double teMaxM = 0.5;
+        /** Power is maxPowerDbm up to cbrLow, minPowerDbm from cbrHigh, linear between. */
+        int8_t maxPowerDbm = 20;
+        int8_t minPowerDbm = 10;
+        double cbrLow = 0.5;
+        double cbrHigh = 0.8;
+        /** Airtime model of a received packet used for the CBR estimate. */
+        uint32_t channelBitRate = 6000000;
+        uint32_t packetOverheadUs = 100;
+    };
+
+    /**
+     * Host kinematics at a point in time.
+     * @param timeMs monotonic time in ms.
+     * @param latitude, longitude in degrees.
+     * @param speed in m/s.
+     * @param heading in degrees clockwise from north.
+     */
+    struct Kinematics {
+        uint64_t timeMs = 0;
+        double latitude = 0;
+        double longitude = 0;
+        double speed = 0;
+        double heading = 0;
+    };
+
+    /**
+     * Reason txDue() returned true, counted in the statistics.
+     */
+    enum class TxReason {
+        NONE,
+        ITT,
+        TRACKING_ERROR
+    };
+
+    CongestionControl();
+    explicit CongestionControl(const Params& params);
+
+    /**
+     * Accounts a received packet in the current CBR window. Called from the receive
+     * threads, does not lock.
+     * @param len received length in bytes.
+     */
+    void onPacketReceived(const uint16_t len);
+
+    /**
+     * Uses a CBR measured by the radio instead of the estimate from received packets
+     * from the next update() on. A negative value returns to the estimate.
+     */
+    void setChannelBusyRatio(const double cbr);
+
+    /**
+     * Feeds the number of vehicles currently within densityRangeM.
+     */
+    void setVehicleDensity(const uint32_t vehicles);
+
+    /**
+     * Closes the CBR window when it has elapsed and recomputes ITT and power.
+     * @param nowMs monotonic time in ms.
+     */
+    void update(const uint64_t nowMs);
+
+    /**
+     * Decides whether the host transmits at host.timeMs: once the ITT has elapsed, or
+     * earlier (but not before minIttMs) when the tracking error of the last
+     * transmitted kinematics exceeds the J2945/1 thresholds.
+     */
+    TxReason txDue(const Kinematics& host);
+
+    /**
+     * Records a transmission of host.
+     */
+    void onTransmitted(const Kinematics& host);
+
+    const Params& getParams() const;
+    uint32_t getIttMs() const;
+    double getChannelBusyRatio() const;
+    double getVehicleDensity() const;
+    int8_t getTxPowerDbm() const;
+    uint32_t getTrackingErrorTxCount() const;
+    uint32_t getIttTxCount() const;
+
+    /**
+     * Tracking error in meters between host and the dead reckoned position of sent,
+     * assuming constant speed and heading since sent.timeMs.
+     */
+    static double trackingError(const Kinematics& sent, const Kinematics& host);
+
+    /**
+     * Distance in meters between two positions, equirectangular approximation which is
+     * accurate well beyond radio range.
+     */
+    static double distanceM(const double lat1, const double lon1,
+                            const double lat2, const double lon2);
+
+    /**
+     * Monotonic clock in ms, the time base of update() and Kinematics::timeMs.
+     */
+    static uint64_t nowMs();
+
+private:
+    void recompute();
+
+    Params params;
+    std::atomic<uint64_t> windowBusyUs{0};
+    uint64_t windowStartMs = 0;
+    bool windowStarted = false;
+    double reportedCbr = -1;
+    double cbr = 0;
+    double density = 0;
+    bool densityValid = false;
+    uint32_t ittMs;
+    int8_t powerDbm;
+    bool hasSent = false;
+    Kinematics lastSent;
+    std::minstd_rand rng;
+    uint32_t teTxCount = 0;
+    uint32_t ittTxCount = 0;
+    mutable std::mutex sync;
+};
+#endif
@@ -109,9 +109,10 @@ void SaeApplication::fillWsmp(wsmp_data_t *wsmp) {
 void SaeApplication::fillBsm(bsm_value_t *bsm) {
     memset(bsm, 0, sizeof(bsm_value_t));
     srand(timestamp_now());
+    // Stamped first, so that the location can be extrapolated to the same time
+    bsm->timestamp_ms = timestamp_now();
     fillBsmCan(bsm);
     fillBsmLocation(bsm);
-    bsm->timestamp_ms = timestamp_now();
 
     if (bsm->id == 0) {
         bsm->id = rand();
@@ -184,6 +185,18 @@ void SaeApplication::fillBsmLocation(bsm_value_t *bsm) {
 
     bsm->Speed = (50 * locationInfo->getSpeed());
 
+    // Position of the host at the time of the message rather than at the last fix
+    LocationCache::Estimate estimate;
+    if (configuration.extrapolateLocation
+            && kinematicsReceive->positionAt(bsm->timestamp_ms, estimate)) {
+        bsm->Latitude = (estimate.latitude * 10000000);
+        bsm->Longitude = (estimate.longitude * 10000000);
+        bsm->SemiMajorAxisAccuracy = (estimate.horizontalUncertainty * 20);
+        bsm->SemiMinorAxisAccuracy = (estimate.semiMinor * 20);
+        bsm->Heading_degrees = (estimate.heading / 0.0125);
+        bsm->Speed = (50 * estimate.speed);
+    }
+
     bsm->AccelLat_cm_per_sec_squared = (100 * locationInfo->getBodyFrameData().latAccel);
 
     bsm->AccelLon_cm_per_sec_squared = (100 * locationInfo->getBodyFrameData().longAccel);
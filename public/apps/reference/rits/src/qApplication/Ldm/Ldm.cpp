@@ -38,6 +38,7 @@
 
 #include "Ldm.h"
 #include "RadioInterface.h"
+#include "CongestionControl.hpp"
 using std::map;
 using std::vector;
 using std::pair;
@@ -240,6 +241,24 @@ list<msg_contents> Ldm::bsmTrustedSnapshot() {
     return snap;
 }
 
+uint32_t Ldm::countInRange(const double latitude, const double longitude, const double rangeM) {
+    lock_guard<mutex> lk(this->sync);
+    uint32_t count = 0;
+    for (pair<uint32_t, int> element : this->bsmIdMap) {
+        if (element.second != NO_DATA && element.second != DIRTY_DATA)
+        {
+            const auto bsmp = reinterpret_cast<bsm_value_t *>(
+                    this->bsmContents[element.second].j2735_msg);
+            if (bsmp != nullptr && CongestionControl::distanceM(latitude, longitude,
+                    bsmp->Latitude / 10000000.0, bsmp->Longitude / 10000000.0) <= rangeM) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
 bool Ldm::validCert(uint32_t id) {
     //TODO Implement security validation of certs.
     return true;
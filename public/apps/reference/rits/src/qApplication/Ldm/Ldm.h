@@ -185,6 +185,15 @@ private:
 
      void bsmTrustedSnapshot(list<msg_contents> trusted);
 
+     /**
+      * Counts the vehicles with a BSM in the LDM within a radius, without copying
+      * the contents like bsmSnapshot().
+      * @param latitude, longitude of the center in degrees.
+      * @param rangeM radius in meters.
+      * @return number of vehicles in range.
+      */
+     uint32_t countInRange(const double latitude, const double longitude, const double rangeM);
+
      /**
       * Once Bsms are decoded, this function should run. This will check that the security
       * is on point and that there is nothing why the bsm shouldn't be disregarded.
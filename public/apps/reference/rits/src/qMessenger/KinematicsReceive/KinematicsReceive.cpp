@@ -42,6 +42,7 @@ shared_ptr<KinematicsReceive> KinematicsReceive::instance = nullptr;
 mutex KinematicsReceive::sync;
 
 void KinematicsReceive::onDetailedLocationUpdate(const shared_ptr<ILocationInfoEx> &locationInfo) {
+    this->cache.update(locationInfo);
     lock_guard<mutex> lk(sync);
       this->locationInfo = locationInfo;
       lk.~lock_guard();
@@ -78,6 +79,15 @@ shared_ptr<ILocationInfoEx> KinematicsReceive::getLocation(){
     return KinematicsReceive::instance->locationInfo;
 }
 
+bool KinematicsReceive::positionAt(uint64_t utcMs, LocationCache::Estimate& estimate){
+    // Fixes are delivered to the singleton
+    auto receiver = KinematicsReceive::instance;
+    if(!receiver){
+        return false;
+    }
+    return receiver->cache.positionAt(utcMs, estimate);
+}
+
 KinematicsReceive::KinematicsReceive(uint16_t interval){
     if(!KinematicsReceive::instance){
         KinematicsReceive::instance = make_shared<KinematicsReceive>();
@@ -45,6 +45,7 @@
 #include <telux/loc/LocationManager.hpp>
 #include <telux/loc/LocationListener.hpp>
 #include <mutex>
+#include "LocationCache.h"
 
 
 using std::cout;
@@ -70,6 +71,11 @@ private:
     */
    shared_ptr<ILocationInfoEx> locationInfo = nullptr;
 
+   /**
+   * Last fix for lock-free reads and extrapolation.
+    */
+   LocationCache cache;
+
    void onDetailedLocationUpdate(const shared_ptr<ILocationInfoEx> &locationInfo);
 
    void startDetailsCallback(ErrorCode eventError);
@@ -103,6 +109,17 @@ public:
    shared_ptr<ILocationInfoEx> getLocation();
 
 
+   /**
+    * Method that estimates the host position at a point in time from the
+    * most up to date location, without locking.
+    * @param utcMs - UTC time in ms, e.g. the time a message is sent.
+    * @param estimate - position extrapolated from the fix to utcMs.
+    * @return false if no location was received yet.
+    * @see LocationCache::positionAt.
+    */
+   bool positionAt(uint64_t utcMs, LocationCache::Estimate& estimate);
+
+
     /**
     * Destructor that closes listener to Location SDK. This method closes
     * the listener for all object singleton owners as well as nulls all 
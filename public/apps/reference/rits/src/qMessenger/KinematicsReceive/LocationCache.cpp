@@ -0,0 +1,305 @@
+/*
+ *  Copyright (c) 2019-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: LocationCache.cpp
+  *
+  * @brief: Implementation of LocationCache.
+  */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "LocationCache.h"
+
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using telux::loc::ILocationInfoEx;
+
+static const double DEG_TO_RAD = M_PI / 180.0;
+static const double RAD_TO_DEG = 180.0 / M_PI;
+// WGS 84
+static const double SEMI_MAJOR_AXIS_M = 6378137.0;
+static const double ECCENTRICITY_SQ = 6.69437999014e-3;
+// Integration step of the extrapolation in seconds
+static const double STEP_S = 0.05;
+
+static double clamp(const double value, const double limit) {
+    if (value > limit) {
+        return limit;
+    }
+    return (value < -limit) ? -limit : value;
+}
+
+// Difference b - a of two headings in degrees, in [-180, 180)
+static double headingDelta(const double a, const double b) {
+    double delta = std::fmod(b - a + 540.0, 360.0);
+    if (delta < 0) {
+        delta += 360.0;
+    }
+    return delta - 180.0;
+}
+
+static double wrapHeading(const double heading) {
+    double wrapped = std::fmod(heading, 360.0);
+    return (wrapped < 0) ? wrapped + 360.0 : wrapped;
+}
+
+static bool usable(const double value) {
+    return !std::isnan(value) && !std::isinf(value);
+}
+
+LocationCache::LocationCache() : LocationCache(Params()) {
+}
+
+LocationCache::LocationCache(const Params& params) : params(params) {
+    for (auto& word : this->slot) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LocationCache::update(const Fix& fix) {
+    lock_guard<mutex> lk(this->writeSync);
+    Fix stored = fix;
+    stored.valid &= ~DERIVED_KINEMATICS;
+    const auto& prev = this->previous;
+    if (this->hasPrevious && stored.timestampMs > prev.timestampMs
+            && stored.timestampMs - prev.timestampMs <= this->params.maxDeriveGapMs) {
+        const double dt = (stored.timestampMs - prev.timestampMs) / 1000.0;
+        const uint32_t both = stored.valid & prev.valid;
+        if (!(stored.valid & HAS_LONG_ACCEL) && (both & HAS_SPEED)) {
+            stored.longAccel = static_cast<float>((stored.speed - prev.speed) / dt);
+            stored.valid |= HAS_LONG_ACCEL | DERIVED_KINEMATICS;
+        }
+        if (!(stored.valid & HAS_HEADING_RATE) && (both & HAS_HEADING) && (both & HAS_SPEED)
+                && stored.speed >= this->params.minSpeed && prev.speed >= this->params.minSpeed) {
+            stored.headingRate = static_cast<float>(headingDelta(prev.heading, stored.heading) / dt);
+            stored.valid |= HAS_HEADING_RATE | DERIVED_KINEMATICS;
+        }
+    }
+    // Derive from what the receiver reported, not from derived values
+    this->previous = fix;
+    this->hasPrevious = true;
+    this->store(stored);
+}
+
+void LocationCache::update(const shared_ptr<ILocationInfoEx>& info) {
+    if (info != nullptr) {
+        this->update(toFix(info));
+    }
+}
+
+// Callers hold writeSync
+void LocationCache::store(const Fix& fix) {
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, &fix, sizeof(fix));
+    const auto seq = this->sequence.load(std::memory_order_relaxed);
+    this->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+        this->slot[i].store(words[i], std::memory_order_relaxed);
+    }
+    this->sequence.store(seq + 2, std::memory_order_release);
+    this->updates.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool LocationCache::latest(Fix& fix) const {
+    uint64_t words[WORDS];
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = this->sequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] = this->slot[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = this->sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    if (before == 0) {
+        return false;
+    }
+    std::memcpy(&fix, words, sizeof(fix));
+    return true;
+}
+
+bool LocationCache::positionAt(const uint64_t utcMs, Estimate& estimate) const {
+    Fix fix;
+    if (!this->latest(fix) || !(fix.valid & HAS_POSITION)) {
+        return false;
+    }
+    estimate = extrapolate(fix, utcMs, this->params);
+    return true;
+}
+
+LocationCache::Estimate LocationCache::extrapolate(const Fix& fix, const uint64_t utcMs,
+        const Params& params) {
+    Estimate estimate;
+    estimate.latitude = fix.latitude;
+    estimate.longitude = fix.longitude;
+    estimate.altitude = fix.altitude;
+    estimate.speed = fix.speed;
+    estimate.heading = fix.heading;
+    estimate.horizontalUncertainty = fix.horizontalUncertainty;
+    estimate.semiMinor = fix.semiMinor;
+    estimate.azimuth = fix.azimuth;
+    estimate.horizonMs = static_cast<int64_t>(utcMs) - static_cast<int64_t>(fix.timestampMs);
+
+    const double horizon = clamp(estimate.horizonMs / 1000.0, params.maxHorizonMs / 1000.0);
+    const double t = std::fabs(horizon);
+    const bool moving = (fix.valid & HAS_SPEED) && (fix.valid & HAS_HEADING)
+        && fix.speed >= params.minSpeed;
+    const double speedUnc = ((fix.valid & HAS_UNCERTAINTY) && fix.speedUncertainty > 0)
+        ? fix.speedUncertainty : params.speedUncertainty;
+    const double headingUnc = ((fix.valid & HAS_UNCERTAINTY) && fix.headingUncertainty > 0)
+        ? fix.headingUncertainty : params.headingUncertainty;
+
+    double distance = 0;
+    if (moving && t > 0) {
+        const double accel = (fix.valid & HAS_LONG_ACCEL) ? clamp(fix.longAccel, params.maxAccel) : 0;
+        const double rate = (fix.valid & HAS_HEADING_RATE)
+            ? clamp(fix.headingRate, params.maxHeadingRate) : 0;
+        const int steps = static_cast<int>(std::ceil(t / STEP_S));
+        const double dt = horizon / steps;
+        double east = 0;
+        double north = 0;
+        double speed = fix.speed;
+        double heading = fix.heading;
+        // Midpoint rule; the speed does not go negative when braking
+        for (int i = 0; i < steps; ++i) {
+            const double midSpeed = std::max(0.0, speed + accel * dt / 2);
+            const double midHeading = (heading + rate * dt / 2) * DEG_TO_RAD;
+            east += midSpeed * std::sin(midHeading) * dt;
+            north += midSpeed * std::cos(midHeading) * dt;
+            speed = std::max(0.0, speed + accel * dt);
+            heading += rate * dt;
+        }
+        const double sinLat = std::sin(fix.latitude * DEG_TO_RAD);
+        const double w = 1 - ECCENTRICITY_SQ * sinLat * sinLat;
+        const double meridianRadius = SEMI_MAJOR_AXIS_M * (1 - ECCENTRICITY_SQ) / (w * std::sqrt(w));
+        const double normalRadius = SEMI_MAJOR_AXIS_M / std::sqrt(w);
+        estimate.latitude = fix.latitude + north / meridianRadius * RAD_TO_DEG;
+        estimate.longitude = fix.longitude
+            + east / (normalRadius * std::cos(fix.latitude * DEG_TO_RAD)) * RAD_TO_DEG;
+        if (estimate.longitude > 180) {
+            estimate.longitude -= 360;
+        } else if (estimate.longitude < -180) {
+            estimate.longitude += 360;
+        }
+        estimate.speed = speed;
+        estimate.heading = wrapHeading(heading);
+        estimate.extrapolated = true;
+        distance = std::sqrt(east * east + north * north);
+    }
+
+    // Along track from the speed and acceleration uncertainty, cross track from the
+    // heading uncertainty
+    if (t > 0) {
+        const double alongTrack = speedUnc * t + 0.5 * params.accelUncertainty * t * t;
+        const double crossTrack = distance * headingUnc * DEG_TO_RAD;
+        const double major = std::max(alongTrack, crossTrack);
+        const double minor = std::min(alongTrack, crossTrack);
+        estimate.horizontalUncertainty = std::sqrt(
+            estimate.horizontalUncertainty * estimate.horizontalUncertainty + major * major);
+        estimate.semiMinor = std::sqrt(estimate.semiMinor * estimate.semiMinor + minor * minor);
+    }
+    return estimate;
+}
+
+LocationCache::Fix LocationCache::toFix(const shared_ptr<ILocationInfoEx>& info) {
+    Fix fix;
+    const auto validity = info->getLocationInfoValidity();
+    const auto validityEx = info->getLocationInfoExValidity();
+    fix.timestampMs = (validity & telux::loc::HAS_TIMESTAMP_BIT) ? info->getTimeStamp() : 0;
+    if (fix.timestampMs == 0) {
+        // Without a fix time, the time it arrived is the best estimate
+        fix.timestampMs = nowUtcMs();
+    }
+    fix.latitude = info->getLatitude();
+    fix.longitude = info->getLongitude();
+    if ((validity & telux::loc::HAS_LAT_LONG_BIT) && usable(fix.latitude)
+            && usable(fix.longitude)) {
+        fix.valid |= HAS_POSITION;
+    }
+    fix.altitude = info->getAltitude();
+    if ((validity & telux::loc::HAS_ALTITUDE_BIT) && usable(fix.altitude)) {
+        fix.valid |= HAS_ALTITUDE;
+    }
+    fix.speed = info->getSpeed();
+    if ((validity & telux::loc::HAS_SPEED_BIT) && usable(fix.speed)) {
+        fix.valid |= HAS_SPEED;
+    }
+    fix.heading = info->getHeading();
+    if ((validity & telux::loc::HAS_HEADING_BIT) && usable(fix.heading)) {
+        fix.valid |= HAS_HEADING;
+    }
+    fix.horizontalUncertainty = info->getHorizontalUncertaintySemiMajor();
+    fix.semiMinor = info->getHorizontalUncertaintySemiMinor();
+    fix.azimuth = info->getHorizontalUncertaintyAzimuth();
+    if (!(validityEx & telux::loc::HAS_HOR_ACCURACY_ELIP_SEMI_MAJOR)
+            || !usable(fix.horizontalUncertainty)) {
+        fix.horizontalUncertainty = info->getHorizontalUncertainty();
+        fix.semiMinor = fix.horizontalUncertainty;
+        fix.azimuth = 0;
+    }
+    fix.speedUncertainty = info->getSpeedUncertainty();
+    fix.headingUncertainty = info->getHeadingUncertainty();
+    if ((validity & telux::loc::HAS_HORIZONTAL_ACCURACY_BIT) && usable(fix.horizontalUncertainty)
+            && usable(fix.semiMinor) && usable(fix.speedUncertainty)
+            && usable(fix.headingUncertainty)) {
+        fix.valid |= HAS_UNCERTAINTY;
+    }
+    if (validityEx & telux::loc::HAS_POS_DYNAMICS_DATA) {
+        const auto body = info->getBodyFrameData();
+        if ((body.bodyFrameDataMask & telux::loc::HAS_LONG_ACCEL) && usable(body.longAccel)) {
+            fix.longAccel = body.longAccel;
+            fix.valid |= HAS_LONG_ACCEL;
+        }
+        // The yaw rate is taken as the rate of change of the heading
+        if ((body.bodyFrameDataMask & telux::loc::HAS_YAW_RATE) && usable(body.yawRate)) {
+            fix.headingRate = static_cast<float>(body.yawRate * RAD_TO_DEG);
+            fix.valid |= HAS_HEADING_RATE;
+        }
+    }
+    return fix;
+}
+
+uint64_t LocationCache::nowUtcMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const LocationCache::Params& LocationCache::getParams() const {
+    return this->params;
+}
+
+uint32_t LocationCache::getUpdateCount() const {
+    return this->updates.load(std::memory_order_relaxed);
+}
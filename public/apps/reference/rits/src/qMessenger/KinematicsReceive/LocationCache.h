@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2019-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: LocationCache.h
+  *
+  * @brief: Last location fix in a seqlocked slot, and the host position extrapolated
+  * from it to any point in time.
+  *
+  * Fixes arrive at 1-10 Hz while messages are built at any time in between, so the fix
+  * is up to a fix interval old when its position goes on air. positionAt() moves the
+  * last fix forward along its speed, heading, acceleration and heading rate (constant
+  * turn rate and acceleration) and grows its horizontal uncertainty with the horizon.
+  * When a fix has no body frame data, the acceleration and heading rate are derived from
+  * the previous fix.
+  *
+  * One thread updates the cache (the location listener); any number of threads read it
+  * without locking and without ever blocking the writer.
+  */
+#ifndef __LOCATION_CACHE_H__
+#define __LOCATION_CACHE_H__
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <telux/loc/LocationDefines.hpp>
+
+class LocationCache
+{
+public:
+
+    /**
+     * A location fix, plain data so that it fits the seqlocked slot.
+     * @param timestampMs UTC time of the fix in ms.
+     * @param latitude, longitude in degrees, altitude in meters.
+     * @param speed in m/s, heading in degrees clockwise from north.
+     * @param longAccel forward acceleration in m/s^2.
+     * @param headingRate in degrees per second, clockwise positive.
+     * @param horizontalUncertainty semi-major axis in meters (68%), semiMinor and
+     *        azimuth (degrees) of the ellipse.
+     * @param speedUncertainty in m/s, headingUncertainty in degrees (68%).
+     * @param valid HAS_* bits of the fields above that are set.
+     */
+    struct Fix {
+        uint64_t timestampMs = 0;
+        double latitude = 0;
+        double longitude = 0;
+        double altitude = 0;
+        float speed = 0;
+        float heading = 0;
+        float longAccel = 0;
+        float headingRate = 0;
+        float horizontalUncertainty = 0;
+        float semiMinor = 0;
+        float azimuth = 0;
+        float speedUncertainty = 0;
+        float headingUncertainty = 0;
+        uint32_t valid = 0;
+    };
+
+    enum : uint32_t {
+        HAS_POSITION = 1 << 0,
+        HAS_ALTITUDE = 1 << 1,
+        HAS_SPEED = 1 << 2,
+        HAS_HEADING = 1 << 3,
+        HAS_LONG_ACCEL = 1 << 4,
+        HAS_HEADING_RATE = 1 << 5,
+        HAS_UNCERTAINTY = 1 << 6,
+        /** longAccel and headingRate come from the previous fix, not the receiver. */
+        DERIVED_KINEMATICS = 1 << 7
+    };
+
+    /**
+     * The host position at a point in time.
+     * @param horizonMs time from the fix to the estimate, negative before the fix.
+     * @param horizontalUncertainty semi-major axis in meters (68%), grown with the
+     *        horizon.
+     */
+    struct Estimate {
+        double latitude = 0;
+        double longitude = 0;
+        double altitude = 0;
+        double speed = 0;
+        double heading = 0;
+        double horizontalUncertainty = 0;
+        double semiMinor = 0;
+        double azimuth = 0;
+        int64_t horizonMs = 0;
+        /** Whether the position was moved from the fix. */
+        bool extrapolated = false;
+    };
+
+    /**
+     * Extrapolation parameters.
+     */
+    struct Params {
+        /** Horizon beyond which the position is held, in ms. */
+        uint32_t maxHorizonMs = 1000;
+        /** Acceleration and heading rate are derived from fixes at most this far apart. */
+        uint32_t maxDeriveGapMs = 2000;
+        /** Below this speed in m/s the heading is unreliable and the position is held. */
+        double minSpeed = 0.5;
+        /** Limits on the acceleration (m/s^2) and heading rate (deg/s) extrapolated. */
+        double maxAccel = 8.0;
+        double maxHeadingRate = 60.0;
+        /** 68% uncertainty of the acceleration in m/s^2, for the uncertainty growth. */
+        double accelUncertainty = 1.0;
+        /** Default 68% uncertainties when the fix has none, in m/s and degrees. */
+        double speedUncertainty = 0.3;
+        double headingUncertainty = 2.0;
+    };
+
+    LocationCache();
+    explicit LocationCache(const Params& params);
+
+    /**
+     * Stores a fix. Derives longAccel and headingRate from the previous fix when the fix
+     * has none. Single writer.
+     */
+    void update(const Fix& fix);
+
+    /**
+     * Stores a fix reported by the location manager.
+     */
+    void update(const std::shared_ptr<telux::loc::ILocationInfoEx>& info);
+
+    /**
+     * Copies the last fix. Lock-free.
+     * @returns false if no fix was stored yet.
+     */
+    bool latest(Fix& fix) const;
+
+    /**
+     * Estimates the host position at utcMs from the last fix. Lock-free.
+     * @returns false if no fix with a position was stored yet.
+     */
+    bool positionAt(const uint64_t utcMs, Estimate& estimate) const;
+
+    /**
+     * Extrapolates fix to utcMs, the computation behind positionAt().
+     */
+    static Estimate extrapolate(const Fix& fix, const uint64_t utcMs, const Params& params);
+
+    /**
+     * Converts a report of the location manager.
+     */
+    static Fix toFix(const std::shared_ptr<telux::loc::ILocationInfoEx>& info);
+
+    /**
+     * UTC time in ms, the time base of the fixes.
+     */
+    static uint64_t nowUtcMs();
+
+    const Params& getParams() const;
+    uint32_t getUpdateCount() const;
+
+private:
+    static constexpr size_t WORDS = (sizeof(Fix) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    void store(const Fix& fix);
+
+    Params params;
+    // Seqlock: odd while the writer copies into the slot. The slot is kept in atomic
+    // words so that a reader racing the writer reads torn words, not undefined data,
+    // and retries.
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint64_t> slot[WORDS];
+    std::atomic<uint32_t> updates{0};
+    // Writer side only
+    std::mutex writeSync;
+    Fix previous;
+    bool hasPrevious = false;
+};
+#endif
@@ -34,38 +34,58 @@
   *
   */
 
+#include <sys/eventfd.h>
 #include "RadioTransmit.h"
 
+RadioTransmit::AsyncFlow::~AsyncFlow() {
+    if (eventFd >= 0) {
+        close(eventFd);
+    }
+}
+
+void RadioTransmit::AsyncFlow::notify(FlowCallback& cb, FlowOp op, ErrorCode error) {
+    uint64_t one = 1;
+
+    if (eventFd >= 0 && write(eventFd, &one, sizeof(one)) < 0) {
+        cerr << "Flow event notification failed, errno " << errno << endl;
+    }
+    if (cb) {
+        cb(op, error);
+    }
+}
+
+ErrorCode RadioTransmit::waitFor(std::function<Status(FlowCallback)> start) {
+    auto done = std::make_shared<promise<ErrorCode>>();
+    auto cb = [done](FlowOp op, ErrorCode error) {
+        done->set_value(error);
+    };
+    if (Status::SUCCESS != start(cb)) {
+        return ErrorCode::GENERIC_FAILURE;
+    }
+    return done->get_future().get();
+}
+
+RadioTransmit::RadioTransmit(const TrafficCategory category) {
+    this->category = category;
+}
+
 RadioTransmit::RadioTransmit(const SpsFlowInfo spsInfo, const TrafficCategory category,
                 const TrafficIpType trafficType, const uint16_t port, const uint32_t serviceId,
                 const bool withEventFlow, const uint16_t eventFlowPort){
 
     if (!ready(category, RadioType::TX)) {
         cout << "Radio Checks on Sps Transmit Event Fail\n";
-        //return static_cast<uint8_t>(Status::FAILED);
-    }
-    auto cv2xRadio = cv2xRadioManager->getCv2xRadio(category);
-    auto respCallback = [&](std::shared_ptr<ICv2xTxFlow> txSpsFlow,
-                            std::shared_ptr<ICv2xTxFlow> txEventFlow,
-                            ErrorCode spsError, ErrorCode eventError){
-                                spsFlowCallbackOnCreate(txSpsFlow,txEventFlow,spsError,eventError);
-                            };
-    if(Status::SUCCESS == cv2xRadio->createTxSpsFlow(trafficType, serviceId, spsInfo,
-                port, withEventFlow, eventFlowPort, respCallback)){
-        if(ErrorCode::SUCCESS == gCallbackPromise.get_future().get()){
-            cout<<"Sps flow created succesfully\n";
-            //return static_cast<uint8_t>(Status::SUCCESS);
-        }
-        else{
-            cout<<"Sps Flow creation fails\n";
-            //return static_cast<uint8_t>(Status::FAILED);
-        }
     }
-    else {
+    this->category = category;
+    auto error = waitFor([&](FlowCallback cb) {
+        return createSpsFlowAsync(spsInfo, trafficType, port, serviceId, withEventFlow,
+                                  eventFlowPort, cb);
+    });
+    if (ErrorCode::SUCCESS == error) {
+        cout << "Sps flow created succesfully\n";
+    } else {
         cout << "Sps Flow creation fails\n";
-        //return static_cast<uint8_t>(Status::FAILED);
     }
-    this->resetCallbackPromise();
 }
 
 RadioTransmit::RadioTransmit(const EventFlowInfo eventInfo, const TrafficCategory category,
@@ -73,29 +93,16 @@ RadioTransmit::RadioTransmit(const EventFlowInfo eventInfo, const TrafficCategor
                             const uint32_t serviceId){
     if (!this->ready(category, RadioType::TX)) {
         cout << "Radio Checks on Transmit Event fail\n";
-        //return static_cast<uint8_t>(Status::FAILED);;
     }
     this->category = category;
-    auto cv2xRadio = this->cv2xRadioManager->getCv2xRadio(category);
-    auto respCallback = [&](std::shared_ptr<ICv2xTxFlow> txEventFlow,
-                            ErrorCode eventError){
-                                eventFlowCallbackOnCreate(txEventFlow,eventError);
-                            };
-    if(Status::SUCCESS == cv2xRadio->createTxEventFlow(trafficType, serviceId, eventInfo,
-                port, respCallback)){
-        if(ErrorCode::SUCCESS == this->gCallbackPromise.get_future().get()){
-            cout<<"Event Flow created succesfully\n";
-            //return static_cast<uint8_t>(Status::SUCCESS);
-        }else{
-            cout<<"Event Flow creation fails, future.get\n";
-            //return static_cast<uint8_t>(Status::FAILED);
-        }
-    }else{
-            cout<<"Event Flow creation fails\n";
-            //return static_cast<uint8_t>(Status::FAILED);
+    auto error = waitFor([&](FlowCallback cb) {
+        return createEventFlowAsync(eventInfo, trafficType, port, serviceId, cb);
+    });
+    if (ErrorCode::SUCCESS == error) {
+        cout << "Event Flow created succesfully\n";
+    } else {
+        cout << "Event Flow creation fails\n";
     }
-    this->resetCallbackPromise();
-
 }
 
 RadioTransmit::RadioTransmit(const RadioOpt radioOpt, const string ipv4_dst, const uint16_t port) {
@@ -165,36 +172,35 @@ uint8_t RadioTransmit::transmit(const char* buf, const uint16_t bufLen) {
         return bytes_sent;
     }
 
-    auto resp = -1;
-    cout << "Sending data in Flow: len=" << bufLen << endl;
-    auto sock = this->flow->getSock();
+    auto sock = this->async->sock.load(std::memory_order_acquire);
+    if (sock < 0) {
+        return this->transmitPending(buf, bufLen);
+    }
+    return sendOnSock(sock, buf, bufLen);
+}
 
-    if (sock == -1) {
-        cout << "Error on transmit, with socket value -1\n";
-        resp = static_cast<uint8_t>(Status::FAILED);
+uint8_t RadioTransmit::transmitPending(const char* buf, const uint16_t bufLen) {
+    std::lock_guard<std::mutex> lock(this->async->mutex);
+
+    // The flow may have become ready while waiting for the lock
+    auto sock = this->async->sock.load(std::memory_order_relaxed);
+    if (sock >= 0) {
+        return sendOnSock(sock, buf, bufLen);
+    }
+    if (this->async->state == FlowState::PENDING
+        && this->async->policy == PendingTxPolicy::QUEUE
+        && this->async->queued.size() < this->async->maxQueued) {
+        this->async->queued.emplace_back(buf, buf + bufLen);
+        return static_cast<uint8_t>(Status::SUCCESS);
     }
+    this->async->dropped++;
+    return static_cast<uint8_t>(Status::FAILED);
+}
+
+uint8_t RadioTransmit::sendOnSock(int sock, const char* buf, const uint16_t bufLen) {
+    auto resp = -1;
+    cout << "Sending data in Flow: len=" << bufLen << endl;
 
-    struct msghdr message = { 0 };
-    struct iovec iov[1] = { 0 };
-    struct cmsghdr* cmsghp = NULL;
-    char control[CMSG_SPACE(sizeof(int))];
-
-    //IPV6_TCLASS internal configuration
-    iov[0].iov_base = (char*)buf;
-    iov[0].iov_len = bufLen;
-    message.msg_name = &this->destSock;
-    message.msg_namelen = sizeof(this->destSock);
-    message.msg_iov = iov;
-    message.msg_iovlen = 1;
-    message.msg_control = control;
-    message.msg_controllen = sizeof(control);
-
-    cmsghp = CMSG_FIRSTHDR(&message);
-    cmsghp->cmsg_level = IPPROTO_IPV6;
-    cmsghp->cmsg_type = IPV6_TCLASS;
-    cmsghp->cmsg_len = CMSG_LEN(sizeof(int));
-
-    //auto bytes_sent = sendmsg(sock, &message, 0);
     auto bytes_sent = send(sock, buf, bufLen, 0);
     if(bytes_sent == bufLen){
         resp = static_cast<uint8_t>(Status::SUCCESS);
@@ -215,58 +221,183 @@ uint8_t RadioTransmit::transmit(const char* buf, const uint16_t bufLen) {
     return resp;
 }
 
+shared_ptr<telux::cv2x::ICv2xRadio> RadioTransmit::readyRadio(TrafficCategory category) {
+    if (this->cv2xRadioManager == nullptr || not this->cv2xRadioManager->isReady()) {
+        return nullptr;
+    }
+    auto cv2xRadio = this->cv2xRadioManager->getCv2xRadio(category);
+    if (cv2xRadio == nullptr || not cv2xRadio->isReady()) {
+        return nullptr;
+    }
+    return cv2xRadio;
+}
 
+Status RadioTransmit::createSpsFlowAsync(const SpsFlowInfo spsInfo,
+        const TrafficIpType trafficType, const uint16_t port, const uint32_t serviceId,
+        const bool withEventFlow, const uint16_t eventFlowPort, FlowCallback cb) {
+    auto cv2xRadio = this->readyRadio(this->category);
+    if (cv2xRadio == nullptr) {
+        return Status::NOTREADY;
+    }
+    auto ctx = this->async;
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        if (ctx->state == FlowState::PENDING || ctx->state == FlowState::READY) {
+            return Status::ALREADY;
+        }
+        ctx->state = FlowState::PENDING;
+    }
 
-void RadioTransmit::spsFlowCallbackOnCreate(shared_ptr<ICv2xTxFlow> txSpsFlow,
-    shared_ptr<ICv2xTxFlow> unusedFlow,ErrorCode spsError,ErrorCode unusedError) {
-    if (ErrorCode::SUCCESS == spsError) {
-        this->flow = txSpsFlow;
+    auto respCallback = [ctx, cb](std::shared_ptr<ICv2xTxFlow> txSpsFlow,
+                                  std::shared_ptr<ICv2xTxFlow> txEventFlow,
+                                  ErrorCode spsError, ErrorCode eventError) mutable {
+        flowCreated(ctx, txSpsFlow, spsError);
+        ctx->notify(cb, FlowOp::CREATE, spsError);
+    };
+    auto status = cv2xRadio->createTxSpsFlow(trafficType, serviceId, spsInfo, port,
+                                             withEventFlow, eventFlowPort, respCallback);
+    if (Status::SUCCESS != status) {
+        flowCreated(ctx, nullptr, ErrorCode::GENERIC_FAILURE);
     }
-    this->gCallbackPromise.set_value(spsError);
+    return status;
 }
 
-void RadioTransmit::eventFlowCallbackOnCreate(
-    shared_ptr<ICv2xTxFlow> txEventFlow,
-    ErrorCode eventError) {
-    if (ErrorCode::SUCCESS == eventError) {
-        this->flow = txEventFlow;
+Status RadioTransmit::createEventFlowAsync(const EventFlowInfo eventInfo,
+        const TrafficIpType trafficType, const uint16_t port, const uint32_t serviceId,
+        FlowCallback cb) {
+    auto cv2xRadio = this->readyRadio(this->category);
+    if (cv2xRadio == nullptr) {
+        return Status::NOTREADY;
     }
-    std::cout << "callback error=" << static_cast<int>(eventError) << std::endl;
-    this->gCallbackPromise.set_value(eventError);
+    auto ctx = this->async;
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        if (ctx->state == FlowState::PENDING || ctx->state == FlowState::READY) {
+            return Status::ALREADY;
+        }
+        ctx->state = FlowState::PENDING;
+    }
+
+    auto respCallback = [ctx, cb](std::shared_ptr<ICv2xTxFlow> txEventFlow,
+                                  ErrorCode eventError) mutable {
+        flowCreated(ctx, txEventFlow, eventError);
+        ctx->notify(cb, FlowOp::CREATE, eventError);
+    };
+    auto status = cv2xRadio->createTxEventFlow(trafficType, serviceId, eventInfo, port,
+                                               respCallback);
+    if (Status::SUCCESS != status) {
+        flowCreated(ctx, nullptr, ErrorCode::GENERIC_FAILURE);
+    }
+    return status;
 }
 
-void RadioTransmit::spsFlowCallbackOnChanges(shared_ptr<ICv2xTxFlow> txEventFlow,
-        ErrorCode eventError) {
-    if (ErrorCode::SUCCESS == eventError) {
-        this->flow = txEventFlow;
+void RadioTransmit::flowCreated(shared_ptr<AsyncFlow> ctx, shared_ptr<ICv2xTxFlow> flow,
+                                ErrorCode error) {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (ErrorCode::SUCCESS != error || flow == nullptr) {
+        ctx->dropped += ctx->queued.size();
+        ctx->queued.clear();
+        ctx->state = FlowState::FAILED;
+        return;
+    }
+    ctx->flow = flow;
+    auto sock = flow->getSock();
+    // Packets queued while pending go out first; transmit() callers wait on the
+    // lock meanwhile, so the order is kept.
+    for (auto& pkt : ctx->queued) {
+        sendOnSock(sock, pkt.data(), static_cast<uint16_t>(pkt.size()));
     }
-    this->gCallbackPromise.set_value(eventError);
+    ctx->queued.clear();
+    ctx->sock.store(sock, std::memory_order_release);
+    ctx->state = FlowState::READY;
 }
 
+Status RadioTransmit::updateSpsFlowAsync(const SpsFlowInfo spsInfo, FlowCallback cb) {
+    auto ctx = this->async;
+    shared_ptr<ICv2xTxFlow> flow;
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        if (ctx->state != FlowState::READY) {
+            return Status::INVALIDSTATE;
+        }
+        if (ctx->modifying) {
+            return Status::ALREADY;
+        }
+        ctx->modifying = true;
+        flow = ctx->flow;
+    }
 
-uint8_t RadioTransmit::updteSpsFlow(const SpsFlowInfo spsInfo) {
-    auto resp = -1;
     auto cv2xRadio = this->cv2xRadioManager->getCv2xRadio(this->category);
-    auto respCallback = [&](std::shared_ptr<ICv2xTxFlow> txSpsFlow,
-                            ErrorCode spsError){
-                                spsFlowCallbackOnChanges(txSpsFlow, spsError);
-                            };
-    if(Status::SUCCESS == cv2xRadio->changeSpsFlowInfo(this->flow, spsInfo, respCallback)){
-        if(ErrorCode::SUCCESS == this->gCallbackPromise.get_future().get()){
-            resp = static_cast<uint8_t>(Status::SUCCESS);
-        }else{
-            resp =  static_cast<uint8_t>(Status::FAILED);
+    auto respCallback = [ctx, cb](std::shared_ptr<ICv2xTxFlow> txSpsFlow,
+                                  ErrorCode spsError) mutable {
+        {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            if (ErrorCode::SUCCESS == spsError && txSpsFlow != nullptr
+                && ctx->state == FlowState::READY) {
+                ctx->flow = txSpsFlow;
+                ctx->sock.store(txSpsFlow->getSock(), std::memory_order_release);
+            }
+            ctx->modifying = false;
         }
-    }else{
-        resp =  static_cast<uint8_t>(Status::FAILED);
+        ctx->notify(cb, FlowOp::MODIFY, spsError);
+    };
+    auto status = cv2xRadio->changeSpsFlowInfo(flow, spsInfo, respCallback);
+    if (Status::SUCCESS != status) {
+        ctx->modifying = false;
     }
-    this->resetCallbackPromise();
-    return resp;
+    return status;
+}
+
+Status RadioTransmit::closeFlowAsync(FlowCallback cb) {
+    auto ctx = this->async;
+    shared_ptr<ICv2xTxFlow> flow;
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        if (ctx->state != FlowState::READY) {
+            return Status::INVALIDSTATE;
+        }
+        flow = ctx->flow;
+        ctx->flow = nullptr;
+        ctx->sock.store(-1, std::memory_order_release);
+        ctx->state = FlowState::IDLE;
+    }
+
+    auto cv2xRadio = this->cv2xRadioManager->getCv2xRadio(this->category);
+    auto respCallback = [ctx, cb](std::shared_ptr<ICv2xTxFlow> flow,
+                                  ErrorCode error) mutable {
+        ctx->notify(cb, FlowOp::CLOSE, error);
+    };
+    return cv2xRadio->closeTxFlow(flow, respCallback);
+}
+
+void RadioTransmit::setPendingTxPolicy(const PendingTxPolicy policy, const size_t maxQueued) {
+    std::lock_guard<std::mutex> lock(this->async->mutex);
+    this->async->policy = policy;
+    this->async->maxQueued = maxQueued;
 }
 
+FlowState RadioTransmit::getFlowState() const {
+    return this->async->state;
+}
 
-void RadioTransmit::closeCallback(shared_ptr<ICv2xTxFlow> flow, ErrorCode error) {
-    this->gCallbackPromise.set_value(error);
+int RadioTransmit::getEventFd() {
+    std::lock_guard<std::mutex> lock(this->async->mutex);
+    if (this->async->eventFd < 0) {
+        this->async->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    return this->async->eventFd;
+}
+
+uint32_t RadioTransmit::getDroppedCount() const {
+    return this->async->dropped;
+}
+
+uint8_t RadioTransmit::updteSpsFlow(const SpsFlowInfo spsInfo) {
+    auto error = waitFor([&](FlowCallback cb) {
+        return updateSpsFlowAsync(spsInfo, cb);
+    });
+    return static_cast<uint8_t>(ErrorCode::SUCCESS == error ? Status::SUCCESS : Status::FAILED);
 }
 
 uint8_t RadioTransmit::closeFlow() {
@@ -284,27 +415,9 @@ uint8_t RadioTransmit::closeFlow() {
             return ans;
         }
     }
-    auto resp = -1;
-    auto cv2xRadio = this->cv2xRadioManager->getCv2xRadio(this->category);
-    auto respCallback = [&](std::shared_ptr<ICv2xTxFlow> flow,
-                            ErrorCode eventError){
-                                closeCallback(flow, eventError);
-                            };
-    if(Status::SUCCESS == cv2xRadio->closeTxFlow(this->flow, respCallback)){
-        if (ErrorCode::SUCCESS == this->gCallbackPromise.get_future().get()){
-            resp = static_cast<uint8_t>(Status::SUCCESS);
-        }
-        else{
-            resp = static_cast<uint8_t>(Status::FAILED);
-        }
-    }else{
-            resp = static_cast<uint8_t>(Status::FAILED);
-    }
-    this->resetCallbackPromise();
-    this->flow = nullptr;
+    auto error = waitFor([&](FlowCallback cb) {
+        return closeFlowAsync(cb);
+    });
     cout << "Flow closed.\n";
-    return resp;
+    return static_cast<uint8_t>(ErrorCode::SUCCESS == error ? Status::SUCCESS : Status::FAILED);
 }
-
-
-
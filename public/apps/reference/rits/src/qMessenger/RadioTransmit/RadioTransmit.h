@@ -37,6 +37,10 @@
 #define __RADIO_TRANSMIT_H__
 
 #include "RadioInterface.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <vector>
 #include <ifaddrs.h>
 #include <unistd.h>
@@ -54,25 +58,87 @@ using telux::cv2x::EventFlowInfo;
 using std::vector;
 using std::string;
 
+/*
+ * Lifecycle state of the flow behind a RadioTransmit.
+ */
+enum class FlowState {
+    IDLE,       /* no flow, or flow closed */
+    PENDING,    /* creation requested, waiting for the radio */
+    READY,      /* flow open, transmit() sends on it */
+    FAILED      /* creation failed */
+};
+
+/*
+ * Flow operation reported to a FlowCallback.
+ */
+enum class FlowOp {
+    CREATE,
+    MODIFY,
+    CLOSE
+};
+
+/*
+ * What transmit() does with a packet while the flow is still being created.
+ * While an SPS modification is pending the current flow keeps sending.
+ */
+enum class PendingTxPolicy {
+    DROP,       /* discard the packet */
+    QUEUE       /* keep up to maxQueued packets, sent in order once the flow is ready */
+};
+
+/*
+ * Completion callback of the asynchronous flow operations, called from the SDK's
+ * callback thread.
+ */
+using FlowCallback = std::function<void (FlowOp op, ErrorCode error)>;
+
 class RadioTransmit: public RadioInterface{
 
 private:
-    shared_ptr<ICv2xTxFlow> flow;
+    /*
+    * Flow state shared with the SDK callbacks, so a pending operation can complete
+    * after the RadioTransmit has been moved (e.g. inside a vector).
+    */
+    struct AsyncFlow {
+        std::mutex mutex;
+        std::atomic<FlowState> state{FlowState::IDLE};
+        std::atomic<bool> modifying{false};
+        std::atomic<int> sock{-1};
+        shared_ptr<ICv2xTxFlow> flow;
+        PendingTxPolicy policy = PendingTxPolicy::DROP;
+        size_t maxQueued = 8;
+        std::deque<vector<char>> queued;
+        std::atomic<uint32_t> dropped{0};
+        int eventFd = -1;
+
+        ~AsyncFlow();
+        void notify(FlowCallback& cb, FlowOp op, ErrorCode error);
+    };
+
+    shared_ptr<AsyncFlow> async = std::make_shared<AsyncFlow>();
     TrafficCategory category;
 
+    /**
+    * Sends a buffer on a flow socket.
+    * @return result value 0 on success and 1 on fail.
+    */
+    static uint8_t sendOnSock(int sock, const char* buf, const uint16_t bufLen);
 
     /**
-    * Function that acts as a callback of the SDK's Sps Flow creation.
-    * @param txSps a ICv2xTxFlow that results from the creation of the flow.
-    * @param unusedFlow a ICv2xTxFlow if Sps was created with event flow.
-    * @param spsError an ErrorCode of the sps creation in the SDK.
-    * @param eventError an ErrorCode of the optional event creation with the sps.
+    * Applies the pending policy to a packet transmitted while no flow socket exists.
     */
-    void spsFlowCallbackOnCreate(
-    shared_ptr<ICv2xTxFlow> txSpsFlow,
-    shared_ptr<ICv2xTxFlow> eventFlow,
-    ErrorCode spsError,
-    ErrorCode eventError);
+    uint8_t transmitPending(const char* buf, const uint16_t bufLen);
+
+    /**
+    * Returns the radio for a non-blocking request, nullptr if the manager or the radio
+    * is not ready yet.
+    */
+    shared_ptr<telux::cv2x::ICv2xRadio> readyRadio(TrafficCategory category);
+
+    /**
+    * Waits for an asynchronous operation started by the blocking API.
+    */
+    static ErrorCode waitFor(std::function<Status(FlowCallback)> start);
 
     struct sockaddr_in6 destSock;
     int simSock = -1;
@@ -83,29 +149,11 @@ private:
     bool enableUdp = false;
     string ipv4_src;
     /**
-    * Function that acts as a callback of the SDK's Event Flow creation.
-    * @param txSps a ICv2xTxFlow that results from the creation of the flow.
-    * @param unusedFlow a ICv2xTxFlow if Sps was created with event flow.
-    * @param spsError an ErrorCode of the sps creation in the SDK.
-    * @param eventError an ErrorCode of the optional event creation with the sps.
-    */
-    void eventFlowCallbackOnCreate(shared_ptr<ICv2xTxFlow> txEventFlow, ErrorCode eventError);
-
-
-    /**
-    * Function that acts as a callback when an Sps flow parameters are updated.
-    * @param txSps a ICv2xTxFlow that results from the creation of the flow.
-    * @param error an ErrorCode of the optional event creation with the sps.
-    */
-    void spsFlowCallbackOnChanges(shared_ptr<ICv2xTxFlow> txSpsFlow, ErrorCode error);
-
-
-    /**
-    * Function that acts as a callback when a Flow is closed.
-    * @param flow a ICv2xTxFlow that results from the closing of the flow.
-    * @param error an ErrorCode of the optional event creation with the sps.
+    * Completes a pending flow creation: on success sends the queued packets and opens
+    * transmit() on the flow, on failure drops them.
     */
-    void closeCallback(shared_ptr<ICv2xTxFlow> flow, ErrorCode error);
+    static void flowCreated(shared_ptr<AsyncFlow> ctx, shared_ptr<ICv2xTxFlow> flow,
+                            ErrorCode error);
 
 public:
 
@@ -187,6 +235,73 @@ public:
     * @see sockaddr_in6
     */
     void configureIpv6(const uint16_t port, const char* destAddress, const char* iface);
+
+    /**
+    * Constructs a RadioTransmit without a flow, for the asynchronous flow API.
+    * @param category a TrafficCategory of the flows created on it.
+    */
+    explicit RadioTransmit(const TrafficCategory category);
+
+    /**
+    * Non-blocking Sps flow creation. Returns once the request is sent to the radio, the
+    * result is reported to cb and on the event fd. Packets transmitted meanwhile are
+    * handled according to the PendingTxPolicy.
+    * @return Status::SUCCESS if the request was sent, Status::ALREADY if a flow exists or
+    * is pending, Status::NOTREADY if the radio is not ready yet.
+    * @see RadioTransmit(const SpsFlowInfo ...) for the other parameters
+    */
+    Status createSpsFlowAsync(const SpsFlowInfo spsInfo,
+                              const TrafficIpType trafficType,
+                              const uint16_t port,
+                              const uint32_t serviceId,
+                              const bool withEventFlow,
+                              const uint16_t eventFlowPort,
+                              FlowCallback cb = nullptr);
+
+    /**
+    * Non-blocking Event flow creation, see createSpsFlowAsync.
+    */
+    Status createEventFlowAsync(const EventFlowInfo eventInfo,
+                                const TrafficIpType trafficType,
+                                const uint16_t port,
+                                const uint32_t serviceId,
+                                FlowCallback cb = nullptr);
+
+    /**
+    * Non-blocking change of the Sps flow parameters. transmit() keeps sending on the
+    * current flow until the radio applies the change.
+    * @return Status::SUCCESS if the request was sent, Status::INVALIDSTATE if no flow is
+    * open, Status::ALREADY if a change is still pending.
+    */
+    Status updateSpsFlowAsync(const SpsFlowInfo spsInfo, FlowCallback cb = nullptr);
+
+    /**
+    * Non-blocking flow close. transmit() stops sending right away.
+    * @return Status::SUCCESS if the request was sent, Status::INVALIDSTATE if no flow is
+    * open or its creation is still pending.
+    */
+    Status closeFlowAsync(FlowCallback cb = nullptr);
+
+    /**
+    * Sets what transmit() does while the flow is being created.
+    * @param policy a PendingTxPolicy.
+    * @param maxQueued max number of packets kept with PendingTxPolicy::QUEUE.
+    */
+    void setPendingTxPolicy(const PendingTxPolicy policy, const size_t maxQueued);
+
+    FlowState getFlowState() const;
+
+    /**
+    * Eventfd signalled on every completed asynchronous flow operation, for poll() based
+    * callers. Created on first use, owned by the RadioTransmit.
+    * @return the file descriptor, or -1 on failure.
+    */
+    int getEventFd();
+
+    /**
+    * Number of packets dropped because no flow was ready.
+    */
+    uint32_t getDroppedCount() const;
 };
 
 #endif
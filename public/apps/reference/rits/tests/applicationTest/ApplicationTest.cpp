@@ -187,7 +187,13 @@ static void transmit(MessageType msgType) {
     uint64_t exp;
     ssize_t s;
     //auto timer = timestamp_now();
-    tx_timer_fd = start_tx_timer(1000000*application->configuration.transmitRate);
+    // With congestion control the scheduler picks the transmit times, it is polled
+    // every tick instead of sending at the fixed rate.
+    long long interval_ms = application->configuration.transmitRate;
+    if (application->configuration.enableCongestionControl) {
+        interval_ms = application->congestionControl.getParams().tickMs;
+    }
+    tx_timer_fd = start_tx_timer(1000000*interval_ms);
     if (tx_timer_fd == -1) {
         cerr << "Failed to start Tx timer" << endl;
         return;
@@ -198,7 +204,7 @@ static void transmit(MessageType msgType) {
     case MessageType::BSM:
         while (true)
         {
-            if (application->send(0, TransmitType::SPS) < 0) {
+            if (application->sendIfDue(0, TransmitType::SPS) < 0) {
                 cerr << "Failed to send message" << endl;
                 return;
             }
@@ -488,7 +494,12 @@ static void simTransmit(MessageType msgType) {
 
         while (true)
         {
-            if (timer + application->configuration.transmitRate < timestamp_now()) {
+            if (application->configuration.enableCongestionControl) {
+                if (timer + application->congestionControl.getParams().tickMs < timestamp_now()) {
+                    application->sendIfDue(0, TransmitType::SPS);
+                    timer = timestamp_now();
+                }
+            } else if (timer + application->configuration.transmitRate < timestamp_now()) {
                 application->send(0, TransmitType::SPS);
                 timer = timestamp_now();
             }
@@ -0,0 +1,505 @@
+/*
+ *  Copyright (c) 2018-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: CongestionControlTest.cpp
+  *
+  * @brief: Unit checks and UDP simulation of the CongestionControl scheduler.
+  *
+  * The simulation runs many virtual senders in one process on a simulated 1 ms clock,
+  * each with its own UDP socket on the loopback. A sender that transmits sends its
+  * packet to every sender within its range, which depends on its TX power. The channel
+  * at a receiver holds 1 ms of airtime per ms: a packet that does not fit is still
+  * sent (the receiver senses it for its CBR estimate) but marked lost. Vehicles drive
+  * on a four lane ring road and count their neighbours from the packets delivered.
+  * The same scenario runs with the fixed 100 ms rate and with the scheduler, and the
+  * test reports channel load, packet delivery ratio and the fairness (Jain's index)
+  * of the transmit and received update rates.
+  *
+  * Usage: congestion_control_test [-n vehicles] [-l ring length m] [-r range m]
+  *                                [-s seconds]
+  */
+
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <memory>
+#include "CongestionControl.hpp"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::unique_ptr;
+
+static unsigned failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            cerr << "CHECK failed line " << __LINE__ << ": " #cond << endl; \
+            ++failures;                                                    \
+        }                                                                  \
+    } while (0)
+
+static const double LAT0 = 37.0;
+static const double M_PER_DEG_LAT = 111195.0;
+static const double LANE_WIDTH_M = 3.5;
+static const unsigned LANES = 4;
+static const unsigned PACKET_LEN = 300;
+static const unsigned NEIGHBOUR_AGE_MS = 1000;
+
+static CongestionControl::Params simParams() {
+    CongestionControl::Params params;
+    // ~700 us per 300 byte packet, so a few hundred senders load the channel
+    params.channelBitRate = 4000000;
+    return params;
+}
+
+static double lonOf(double x) {
+    return x / (M_PER_DEG_LAT * cos(LAT0 * M_PI / 180.0));
+}
+
+static void testScheduler() {
+    CongestionControl::Params params;
+    CongestionControl cc(params);
+    CongestionControl::Kinematics host;
+
+    // ITT follows density, clamped to [100, 600] ms
+    cc.setVehicleDensity(10);
+    CHECK(cc.getIttMs() == 100);
+    CongestionControl dense(params);
+    dense.setVehicleDensity(50);
+    CHECK(dense.getIttMs() == 200);
+    CongestionControl crowded(params);
+    crowded.setVehicleDensity(500);
+    CHECK(crowded.getIttMs() == 600);
+
+    // CBR from received airtime, smoothed, and power from CBR
+    CongestionControl load(params);
+    load.update(1000);
+    const unsigned perWindow = 100000 * 9 / 10 / (params.packetOverheadUs
+                               + PACKET_LEN * 8 * 1000000 / params.channelBitRate);
+    for (uint64_t t = 1100; t <= 2000; t += 100) {
+        for (unsigned i = 0; i < perWindow; i++) {
+            load.onPacketReceived(PACKET_LEN);
+        }
+        load.update(t);
+    }
+    CHECK(fabs(load.getChannelBusyRatio() - 0.9) < 0.02);
+    CHECK(load.getTxPowerDbm() == params.minPowerDbm);
+    load.setChannelBusyRatio(0.65);
+    for (uint64_t t = 2100; t <= 3000; t += 100) {
+        load.update(t);
+    }
+    CHECK(fabs(load.getChannelBusyRatio() - 0.65) < 0.01);
+    CHECK(load.getTxPowerDbm() == 15);
+
+    // Tracking error: none at constant speed, a hard brake triggers before the ITT
+    crowded.setVehicleDensity(500);
+    host.latitude = LAT0;
+    host.speed = 20;
+    host.heading = 90;
+    host.timeMs = 10000;
+    CHECK(crowded.txDue(host) == CongestionControl::TxReason::ITT);
+    crowded.onTransmitted(host);
+    CongestionControl::Kinematics cruise = host;
+    cruise.timeMs += 300;
+    cruise.longitude = lonOf(20 * 0.3);
+    CHECK(CongestionControl::trackingError(host, cruise) < 0.01);
+    CHECK(crowded.txDue(cruise) == CongestionControl::TxReason::NONE);
+    CongestionControl::Kinematics brake = host;
+    brake.timeMs += 300;
+    brake.longitude = lonOf(20 * 0.3 - 0.5 * 8 * 0.3 * 0.3);
+    CHECK(fabs(CongestionControl::trackingError(host, brake) - 0.36) < 0.01);
+    brake.timeMs += 100;
+    brake.longitude = lonOf(20 * 0.4 - 0.5 * 8 * 0.4 * 0.4);
+    CHECK(crowded.txDue(brake) == CongestionControl::TxReason::TRACKING_ERROR);
+    CongestionControl::Kinematics early = brake;
+    early.timeMs = host.timeMs + 50;
+    CHECK(crowded.txDue(early) == CongestionControl::TxReason::NONE);
+    crowded.onTransmitted(brake);
+    CHECK(crowded.getTrackingErrorTxCount() == 1 && crowded.getIttTxCount() == 1);
+}
+
+struct SimPacket {
+    uint32_t id;
+    uint8_t lost;
+    float x;
+    uint8_t pad[PACKET_LEN - 9];
+} __attribute__((packed));
+
+struct Neighbour {
+    float x = 0;
+    uint64_t lastMs = 0;
+    bool heard = false;
+};
+
+struct Vehicle {
+    int sock = -1;
+    struct sockaddr_in addr;
+    unsigned phase = 0;
+    uint64_t startMs = 0;
+    unsigned lane = 0;
+    double x = 0;           // unwrapped distance driven along the road
+    double speed = 0;
+    double accel = 0;
+    unique_ptr<CongestionControl> cc;
+    uint64_t lastTxMs = 0;
+    vector<Neighbour> neighbours;
+    uint32_t txCount = 0;
+    uint32_t txMeasured = 0;
+    uint64_t busyUs = 0;    // airtime in the current 1 ms
+    uint64_t offeredUs = 0; // airtime of every packet in range, over the run
+    uint32_t inRange = 0;
+    uint32_t delivered = 0;
+    double cbrSum = 0;
+    double powerSum = 0;
+    uint32_t samples = 0;
+    vector<uint32_t> updatesFrom;
+
+    ~Vehicle() {
+        if (sock >= 0) {
+            close(sock);
+        }
+    }
+};
+
+struct SimResult {
+    double offeredLoad;
+    double cbr;
+    double pdr;
+    double txRate;
+    double txJain;
+    double updateRate;
+    double updateJain;
+    double power;
+    uint32_t teTx;
+};
+
+static double jain(const vector<double>& v) {
+    double sum = 0, sq = 0;
+    for (auto x : v) {
+        sum += x;
+        sq += x * x;
+    }
+    return sq > 0 ? sum * sum / (v.size() * sq) : 1;
+}
+
+static double ringDistance(double x1, double x2, double length) {
+    double d = fmod(fabs(x1 - x2), length);
+    return d < length - d ? d : length - d;
+}
+
+static SimResult simulate(bool adaptive, unsigned n, double length, double rangeM,
+                          unsigned seconds) {
+    const auto params = simParams();
+    const uint64_t airtimeUs = params.packetOverheadUs
+                               + PACKET_LEN * 8 * 1000000ull / params.channelBitRate;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uni(0, 1);
+    vector<unique_ptr<Vehicle>> vehicles;
+    SimPacket pkt[2];   // delivered and lost copy
+    memset(pkt, 0, sizeof(pkt));
+    pkt[1].lost = 1;
+
+    for (unsigned i = 0; i < n; i++) {
+        unique_ptr<Vehicle> v(new Vehicle);
+        v->sock = socket(AF_INET, SOCK_DGRAM, 0);
+        v->addr.sin_family = AF_INET;
+        v->addr.sin_port = 0;
+        v->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(v->addr);
+        int rcvbuf = 1 << 20;
+        setsockopt(v->sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        if (v->sock < 0 || bind(v->sock, (struct sockaddr*)&v->addr, sizeof(v->addr)) < 0
+            || getsockname(v->sock, (struct sockaddr*)&v->addr, &len) < 0) {
+            cerr << "socket setup failed, errno " << errno << endl;
+            exit(1);
+        }
+        fcntl(v->sock, F_SETFL, O_NONBLOCK);
+        v->phase = rng() % params.tickMs;
+        v->lane = i % LANES;
+        v->x = uni(rng) * length;
+        v->speed = 20 + 10 * uni(rng);
+        v->cc.reset(new CongestionControl(params));
+        // senders start at a random time within the first 100 ms period
+        v->startMs = rng() % params.minIttMs;
+        v->neighbours.resize(n);
+        v->updatesFrom.assign(n, 0);
+        vehicles.push_back(std::move(v));
+    }
+
+    vector<struct mmsghdr> msgs(n);
+    vector<struct iovec> iovs(n);
+    vector<bool> dirty(n, false);
+    vector<SimPacket> rxBufs(64);
+    vector<struct mmsghdr> rxMsgs(64);
+    vector<struct iovec> rxIovs(64);
+    const uint64_t endMs = seconds * 1000ull;
+    const uint64_t warmupMs = 1000;
+
+    for (uint64_t now = 0; now < endMs; now++) {
+        for (auto& v : vehicles) {
+            v->busyUs = 0;
+        }
+        for (uint32_t id = 0; id < n; id++) {
+            auto& v = *vehicles[id];
+            if (now % params.tickMs != v.phase || now < v.startMs) {
+                continue;
+            }
+            // kinematics: 10 ms steps, a new acceleration every second
+            const double dt = params.tickMs / 1000.0;
+            if (now % 1000 == v.phase) {
+                v.accel = (uni(rng) < 0.25) ? 6 * uni(rng) - 3 : 0;
+            }
+            v.x += v.speed * dt + 0.5 * v.accel * dt * dt;
+            v.speed += v.accel * dt;
+            if (v.speed < 10 || v.speed > 35) {
+                v.accel = -v.accel;
+            }
+            CongestionControl::Kinematics host;
+            const bool east = v.lane < LANES / 2;
+            host.timeMs = now;
+            host.latitude = LAT0 + v.lane * LANE_WIDTH_M / M_PER_DEG_LAT;
+            host.longitude = lonOf(east ? v.x : -v.x);
+            host.speed = v.speed;
+            host.heading = east ? 90 : 270;
+            const double ringX = fmod(east ? v.x : length * 1000 - v.x, length);
+
+            v.cc->update(now);
+            if (now % params.cbrWindowMs == v.phase) {
+                uint32_t density = 0;
+                for (uint32_t j = 0; j < n; j++) {
+                    const auto& nb = v.neighbours[j];
+                    if (nb.heard && now - nb.lastMs <= NEIGHBOUR_AGE_MS
+                        && ringDistance(nb.x, ringX, length) <= params.densityRangeM) {
+                        density++;
+                    }
+                }
+                v.cc->setVehicleDensity(density);
+            }
+            if (now >= warmupMs) {
+                v.cbrSum += v.cc->getChannelBusyRatio();
+                v.powerSum += adaptive ? v.cc->getTxPowerDbm() : params.maxPowerDbm;
+                v.samples++;
+            }
+
+            bool due;
+            if (adaptive) {
+                due = v.cc->txDue(host) != CongestionControl::TxReason::NONE;
+            } else {
+                due = v.txCount == 0 || now - v.lastTxMs >= params.minIttMs;
+            }
+            if (!due) {
+                continue;
+            }
+            if (adaptive) {
+                v.cc->onTransmitted(host);
+            }
+            v.lastTxMs = now;
+            v.txCount++;
+            if (now >= warmupMs) {
+                v.txMeasured++;
+            }
+
+            // Range shrinks with power, path loss exponent 2.7
+            const int8_t power = adaptive ? v.cc->getTxPowerDbm() : params.maxPowerDbm;
+            const double range = rangeM * pow(10.0, (power - params.maxPowerDbm) / 27.0);
+            unsigned count = 0;
+            pkt[0].id = pkt[1].id = id;
+            pkt[0].x = pkt[1].x = ringX;
+            for (uint32_t j = 0; j < n; j++) {
+                auto& r = *vehicles[j];
+                if (j == id) {
+                    continue;
+                }
+                const bool rEast = r.lane < LANES / 2;
+                const double rx = fmod(rEast ? r.x : length * 1000 - r.x, length);
+                if (ringDistance(rx, ringX, length) > range) {
+                    continue;
+                }
+                // lost when the receiver's 1 ms of airtime is already used
+                const bool lost = r.busyUs + airtimeUs > 1000;
+                r.busyUs += airtimeUs;
+                if (now >= warmupMs) {
+                    r.offeredUs += airtimeUs;
+                    r.inRange++;
+                }
+                iovs[count].iov_base = &pkt[lost ? 1 : 0];
+                iovs[count].iov_len = sizeof(SimPacket);
+                memset(&msgs[count].msg_hdr, 0, sizeof(msgs[count].msg_hdr));
+                msgs[count].msg_hdr.msg_iov = &iovs[count];
+                msgs[count].msg_hdr.msg_iovlen = 1;
+                msgs[count].msg_hdr.msg_name = &r.addr;
+                msgs[count].msg_hdr.msg_namelen = sizeof(r.addr);
+                dirty[j] = true;
+                count++;
+            }
+            unsigned sent = 0;
+            while (sent < count) {
+                int ret = sendmmsg(v.sock, &msgs[sent], count - sent, 0);
+                if (ret <= 0) {
+                    cerr << "sendmmsg failed, errno " << errno << endl;
+                    exit(1);
+                }
+                sent += ret;
+            }
+        }
+
+        // receivers drain what was sent to them in this ms
+        for (uint32_t j = 0; j < n; j++) {
+            if (!dirty[j]) {
+                continue;
+            }
+            dirty[j] = false;
+            auto& r = *vehicles[j];
+            int ret;
+            do {
+                for (unsigned k = 0; k < rxMsgs.size(); k++) {
+                    rxIovs[k].iov_base = &rxBufs[k];
+                    rxIovs[k].iov_len = sizeof(SimPacket);
+                    memset(&rxMsgs[k].msg_hdr, 0, sizeof(rxMsgs[k].msg_hdr));
+                    rxMsgs[k].msg_hdr.msg_iov = &rxIovs[k];
+                    rxMsgs[k].msg_hdr.msg_iovlen = 1;
+                }
+                ret = recvmmsg(r.sock, rxMsgs.data(), rxMsgs.size(), MSG_DONTWAIT, NULL);
+                for (int k = 0; k < ret; k++) {
+                    const auto& p = rxBufs[k];
+                    r.cc->onPacketReceived(rxMsgs[k].msg_len);
+                    if (p.lost) {
+                        continue;
+                    }
+                    r.neighbours[p.id].x = p.x;
+                    r.neighbours[p.id].lastMs = now;
+                    r.neighbours[p.id].heard = true;
+                    if (now >= warmupMs) {
+                        r.delivered++;
+                        r.updatesFrom[p.id]++;
+                    }
+                }
+            } while (ret == static_cast<int>(rxMsgs.size()));
+        }
+    }
+
+    SimResult res = {};
+    const double secs = (endMs - warmupMs) / 1000.0;
+    vector<double> txRates, updateRates;
+    uint64_t inRange = 0, delivered = 0;
+    for (uint32_t j = 0; j < n; j++) {
+        auto& v = *vehicles[j];
+        res.offeredLoad += v.offeredUs / (secs * 1e6);
+        res.cbr += v.cbrSum / v.samples;
+        res.power += v.powerSum / v.samples;
+        res.teTx += v.cc->getTrackingErrorTxCount();
+        txRates.push_back(v.txMeasured / secs);
+        inRange += v.inRange;
+        delivered += v.delivered;
+        // update rate received from the neighbours within the density range at the end
+        const bool east = v.lane < LANES / 2;
+        const double x = fmod(east ? v.x : length * 1000 - v.x, length);
+        double sum = 0;
+        unsigned close = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            const auto& o = *vehicles[i];
+            const bool oEast = o.lane < LANES / 2;
+            const double ox = fmod(oEast ? o.x : length * 1000 - o.x, length);
+            if (i != j && ringDistance(ox, x, length) <= simParams().densityRangeM) {
+                sum += v.updatesFrom[i] / secs;
+                close++;
+            }
+        }
+        if (close > 0) {
+            updateRates.push_back(sum / close);
+        }
+    }
+    res.offeredLoad /= n;
+    res.cbr /= n;
+    res.power /= n;
+    res.pdr = inRange ? static_cast<double>(delivered) / inRange : 0;
+    for (auto r : txRates) {
+        res.txRate += r;
+    }
+    res.txRate /= n;
+    res.txJain = jain(txRates);
+    for (auto r : updateRates) {
+        res.updateRate += r;
+    }
+    res.updateRate /= updateRates.empty() ? 1 : updateRates.size();
+    res.updateJain = jain(updateRates);
+    return res;
+}
+
+static void printResult(const char* name, const SimResult& r) {
+    fprintf(stderr, "%-9s load %.2f  cbr %.2f  pdr %.2f  tx %.2f Hz (jain %.3f)  "
+            "update %.2f Hz (jain %.3f)  power %.1f dBm  te tx %u\n", name, r.offeredLoad,
+            r.cbr, r.pdr, r.txRate, r.txJain, r.updateRate, r.updateJain, r.power, r.teTx);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned n = 300, seconds = 3;
+    double length = 1000, rangeM = 250;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:l:r:s:")) != -1) {
+        switch (c) {
+            case 'n': n = atoi(optarg); break;
+            case 'l': length = atof(optarg); break;
+            case 'r': rangeM = atof(optarg); break;
+            case 's': seconds = atoi(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-n vehicles] [-l ring length m]"
+                     << " [-r range m] [-s seconds]" << endl;
+                return 1;
+        }
+    }
+
+    testScheduler();
+
+    const auto fixed = simulate(false, n, length, rangeM, seconds);
+    const auto adaptive = simulate(true, n, length, rangeM, seconds);
+    printResult("fixed", fixed);
+    printResult("adaptive", adaptive);
+    CHECK(adaptive.offeredLoad < fixed.offeredLoad);
+    CHECK(adaptive.pdr > fixed.pdr);
+    CHECK(adaptive.txJain > 0.9);
+
+    if (failures) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cerr << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,464 @@
+/*
+ *  Copyright (c) 2018-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: LocationCacheTest.cpp
+  *
+  * @brief: Unit checks of the LocationCache and a replayed drive that compares the
+  * position put in a message from the last fix with the extrapolated one.
+  *
+  * The drive is a 100 Hz ground truth trace (accelerate, curve, brake, roundabout)
+  * sampled into noisy fixes at 10 Hz or 1 Hz that reach the cache a fixed latency after
+  * their time. Messages are built every 100 ms at an offset to the fixes with jitter,
+  * and the test reports the mean and 95th percentile position error at message time,
+  * with and without body frame data from the receiver.
+  *
+  * Usage: location_cache_test [-s seconds]
+  */
+
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "LocationCache.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+static unsigned failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            cerr << "CHECK failed line " << __LINE__ << ": " #cond << endl; \
+            ++failures;                                                    \
+        }                                                                  \
+    } while (0)
+
+static const double LAT0 = 37.0;
+static const double LON0 = -122.0;
+static const double DEG_TO_RAD = M_PI / 180.0;
+static const uint64_t T0_MS = 1600000000000ULL;
+static const unsigned TRUTH_STEP_MS = 10;
+static const unsigned FIX_LATENCY_MS = 60;
+
+// Local east/north meters around LAT0, LON0; exact enough over a few km
+static double mPerDegLat() {
+    const double s = sin(LAT0 * DEG_TO_RAD);
+    const double w = 1 - 6.69437999014e-3 * s * s;
+    return 6378137.0 * (1 - 6.69437999014e-3) / (w * sqrt(w)) * DEG_TO_RAD;
+}
+
+static double mPerDegLon() {
+    const double s = sin(LAT0 * DEG_TO_RAD);
+    return 6378137.0 / sqrt(1 - 6.69437999014e-3 * s * s) * cos(LAT0 * DEG_TO_RAD) * DEG_TO_RAD;
+}
+
+static double distanceM(double lat1, double lon1, double lat2, double lon2) {
+    const double north = (lat2 - lat1) * mPerDegLat();
+    const double east = (lon2 - lon1) * mPerDegLon();
+    return sqrt(north * north + east * east);
+}
+
+static LocationCache::Fix movingFix(uint64_t t, double speed, double heading) {
+    LocationCache::Fix fix;
+    fix.timestampMs = t;
+    fix.latitude = LAT0;
+    fix.longitude = LON0;
+    fix.speed = speed;
+    fix.heading = heading;
+    fix.horizontalUncertainty = 1.0;
+    fix.semiMinor = 1.0;
+    fix.valid = LocationCache::HAS_POSITION | LocationCache::HAS_SPEED
+        | LocationCache::HAS_HEADING;
+    return fix;
+}
+
+static void testExtrapolation() {
+    LocationCache::Params params;
+    LocationCache cache(params);
+    LocationCache::Estimate estimate;
+    LocationCache::Fix fix;
+
+    // Nothing before the first fix
+    CHECK(!cache.latest(fix));
+    CHECK(!cache.positionAt(T0_MS, estimate));
+
+    // Straight north at 10 m/s for 1 s
+    cache.update(movingFix(T0_MS, 10, 0));
+    CHECK(cache.positionAt(T0_MS + 1000, estimate));
+    CHECK(estimate.extrapolated);
+    CHECK(estimate.horizonMs == 1000);
+    CHECK(fabs((estimate.latitude - LAT0) * mPerDegLat() - 10) < 0.01);
+    CHECK(fabs(estimate.longitude - LON0) < 1e-9);
+
+    // East, and back in time
+    LocationCache::Fix east = movingFix(T0_MS, 10, 90);
+    estimate = LocationCache::extrapolate(east, T0_MS + 500, params);
+    CHECK(fabs((estimate.longitude - LON0) * mPerDegLon() - 5) < 0.01);
+    estimate = LocationCache::extrapolate(east, T0_MS - 500, params);
+    CHECK(estimate.horizonMs == -500);
+    CHECK(fabs((estimate.longitude - LON0) * mPerDegLon() + 5) < 0.01);
+
+    // Held beyond the horizon limit
+    const auto atLimit = LocationCache::extrapolate(east, T0_MS + params.maxHorizonMs, params);
+    estimate = LocationCache::extrapolate(east, T0_MS + 5000, params);
+    CHECK(estimate.horizonMs == 5000);
+    CHECK(estimate.longitude == atLimit.longitude);
+
+    // A full circle at constant turn rate ends where it started
+    LocationCache::Params longHorizon;
+    longHorizon.maxHorizonMs = 20000;
+    LocationCache::Fix turning = movingFix(T0_MS, 10, 0);
+    turning.headingRate = 36;
+    turning.valid |= LocationCache::HAS_HEADING_RATE;
+    estimate = LocationCache::extrapolate(turning, T0_MS + 5000, longHorizon);
+    // Half way, 2 r = 2 v / w across to the east
+    CHECK(fabs(distanceM(LAT0, LON0, estimate.latitude, estimate.longitude)
+               - 2 * 10 / (36 * DEG_TO_RAD)) < 0.1);
+    CHECK(fabs(estimate.heading - 180) < 1e-6);
+    estimate = LocationCache::extrapolate(turning, T0_MS + 10000, longHorizon);
+    CHECK(distanceM(LAT0, LON0, estimate.latitude, estimate.longitude) < 0.1);
+
+    // Braking stops, it does not reverse: 5 m/s at -5 m/s^2 stops after 2.5 m
+    LocationCache::Fix braking = movingFix(T0_MS, 5, 0);
+    braking.longAccel = -5;
+    braking.valid |= LocationCache::HAS_LONG_ACCEL;
+    estimate = LocationCache::extrapolate(braking, T0_MS + 3000, longHorizon);
+    CHECK(fabs((estimate.latitude - LAT0) * mPerDegLat() - 2.5) < 0.01);
+    CHECK(estimate.speed == 0);
+
+    // Accelerations beyond the limit are clamped
+    braking.longAccel = 50;
+    estimate = LocationCache::extrapolate(braking, T0_MS + 1000, params);
+    CHECK(fabs(estimate.speed - (5 + params.maxAccel)) < 1e-6);
+
+    // Standing still: held, the uncertainty still grows with the horizon
+    const LocationCache::Fix standing = movingFix(T0_MS, 0.2, 45);
+    estimate = LocationCache::extrapolate(standing, T0_MS + 500, params);
+    CHECK(!estimate.extrapolated);
+    CHECK(estimate.latitude == LAT0 && estimate.longitude == LON0);
+    CHECK(estimate.horizontalUncertainty > standing.horizontalUncertainty);
+
+    // Uncertainty grows with the horizon, the major axis faster than the minor axis at
+    // speed; no growth at the time of the fix
+    double lastMajor = 0;
+    for (uint64_t dt = 0; dt <= 1000; dt += 100) {
+        estimate = LocationCache::extrapolate(east, T0_MS + dt, params);
+        CHECK(estimate.horizontalUncertainty >= lastMajor);
+        CHECK(estimate.horizontalUncertainty >= estimate.semiMinor);
+        lastMajor = estimate.horizontalUncertainty;
+    }
+    estimate = LocationCache::extrapolate(east, T0_MS, params);
+    CHECK(estimate.horizontalUncertainty == east.horizontalUncertainty);
+    CHECK(!estimate.extrapolated);
+}
+
+static void testDerivation() {
+    LocationCache::Params params;
+    LocationCache cache(params);
+    LocationCache::Fix fix;
+
+    // From consecutive fixes, across north
+    cache.update(movingFix(T0_MS, 10, 359));
+    CHECK(cache.latest(fix) && !(fix.valid & LocationCache::HAS_LONG_ACCEL));
+    cache.update(movingFix(T0_MS + 100, 10.5, 1));
+    CHECK(cache.latest(fix));
+    CHECK(fix.valid & LocationCache::DERIVED_KINEMATICS);
+    CHECK(fabs(fix.longAccel - 5) < 1e-3);
+    CHECK(fabs(fix.headingRate - 20) < 1e-3);
+
+    // Reported values are kept
+    auto reported = movingFix(T0_MS + 200, 11, 3);
+    reported.longAccel = 1;
+    reported.headingRate = 2;
+    reported.valid |= LocationCache::HAS_LONG_ACCEL | LocationCache::HAS_HEADING_RATE;
+    cache.update(reported);
+    CHECK(cache.latest(fix));
+    CHECK(!(fix.valid & LocationCache::DERIVED_KINEMATICS));
+    CHECK(fix.longAccel == 1 && fix.headingRate == 2);
+
+    // Not across a gap, nor from headings at walking speed
+    cache.update(movingFix(T0_MS + 200 + params.maxDeriveGapMs + 1, 12, 10));
+    CHECK(cache.latest(fix) && !(fix.valid & LocationCache::DERIVED_KINEMATICS));
+    cache.update(movingFix(T0_MS + 3000, 0.1, 10));
+    cache.update(movingFix(T0_MS + 3100, 0.2, 90));
+    CHECK(cache.latest(fix));
+    CHECK(fix.valid & LocationCache::HAS_LONG_ACCEL);
+    CHECK(!(fix.valid & LocationCache::HAS_HEADING_RATE));
+    CHECK(cache.getUpdateCount() == 6);
+}
+
+// Readers never see a fix that mixes two updates
+static void testConcurrency() {
+    LocationCache cache;
+    std::atomic<bool> done{false};
+    std::atomic<unsigned> reads{0};
+    std::atomic<unsigned> torn{0};
+    vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&]() {
+            LocationCache::Fix fix;
+            while (!done.load()) {
+                if (cache.latest(fix)) {
+                    const double k = static_cast<double>(fix.timestampMs);
+                    if (fix.latitude != k || fix.longitude != -k || fix.speed != float(k)
+                            || fix.valid != LocationCache::HAS_POSITION) {
+                        torn++;
+                    }
+                    reads++;
+                }
+            }
+        });
+    }
+    const unsigned updates = 200000;
+    for (unsigned k = 1; k <= updates; k++) {
+        LocationCache::Fix fix;
+        fix.timestampMs = k;
+        fix.latitude = k;
+        fix.longitude = -double(k);
+        fix.speed = float(k);
+        fix.valid = LocationCache::HAS_POSITION;
+        cache.update(fix);
+        if (k % 1000 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+    CHECK(cache.getUpdateCount() == updates);
+}
+
+struct Truth {
+    double north = 0;
+    double east = 0;
+    double speed = 0;
+    double heading = 0;
+    double accel = 0;
+    double headingRate = 0;
+};
+
+// 100 Hz trace of a drive that keeps changing speed and direction
+static vector<Truth> drive(unsigned seconds) {
+    vector<Truth> trace;
+    Truth now;
+    now.speed = 5;
+    now.heading = 30;
+    const double dt = TRUTH_STEP_MS / 1000.0;
+    for (unsigned i = 0; i <= seconds * 1000 / TRUTH_STEP_MS; i++) {
+        const double t = fmod(i * dt, 40.0);
+        // Accelerate, curve, brake, roundabout, accelerate away
+        if (t < 8) {
+            now.accel = 2.0;
+            now.headingRate = 0;
+        } else if (t < 16) {
+            now.accel = 0;
+            now.headingRate = 6.0;
+        } else if (t < 22) {
+            now.accel = -2.5;
+            now.headingRate = -3.0;
+        } else if (t < 30) {
+            now.accel = 0;
+            now.headingRate = 20.0;
+        } else {
+            now.accel = 1.0;
+            now.headingRate = -4.0;
+        }
+        // A gentle weave on top
+        now.headingRate += 3.0 * sin(i * dt * 1.3);
+        if (now.speed + now.accel * dt < 2) {
+            now.accel = 0;
+        }
+        trace.push_back(now);
+        const double midHeading = (now.heading + now.headingRate * dt / 2) * DEG_TO_RAD;
+        const double midSpeed = now.speed + now.accel * dt / 2;
+        now.north += midSpeed * cos(midHeading) * dt;
+        now.east += midSpeed * sin(midHeading) * dt;
+        now.speed += now.accel * dt;
+        now.heading = fmod(now.heading + now.headingRate * dt + 360.0, 360.0);
+    }
+    return trace;
+}
+
+struct Errors {
+    double heldMean = 0;
+    double heldP95 = 0;
+    double extrapolatedMean = 0;
+    double extrapolatedP95 = 0;
+    unsigned messages = 0;
+};
+
+static double percentile(vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+static Errors replay(const vector<Truth>& trace, unsigned fixIntervalMs, bool bodyFrame) {
+    std::mt19937 rng(1);
+    std::normal_distribution<double> positionNoise(0, 0.3);
+    std::normal_distribution<double> speedNoise(0, 0.05);
+    std::normal_distribution<double> headingNoise(0, 0.3);
+    std::normal_distribution<double> accelNoise(0, 0.1);
+    std::normal_distribution<double> rateNoise(0, 0.5);
+    std::uniform_int_distribution<int> jitter(-10, 10);
+
+    LocationCache cache;
+    vector<double> held;
+    vector<double> extrapolated;
+    const uint64_t durationMs = (trace.size() - 1) * TRUTH_STEP_MS;
+    uint64_t nextFix = 0;
+    // Messages at a 37 ms offset to the fixes, every 100 ms with jitter
+    for (uint64_t msg = 137; msg + 10 < durationMs; msg += 100) {
+        const uint64_t sendMs = msg + jitter(rng);
+        // Deliver the fixes that have arrived by the time of the message
+        while (nextFix + FIX_LATENCY_MS <= sendMs) {
+            const Truth& truth = trace[nextFix / TRUTH_STEP_MS];
+            LocationCache::Fix fix;
+            fix.timestampMs = T0_MS + nextFix;
+            fix.latitude = LAT0 + (truth.north + positionNoise(rng)) / mPerDegLat();
+            fix.longitude = LON0 + (truth.east + positionNoise(rng)) / mPerDegLon();
+            fix.speed = truth.speed + speedNoise(rng);
+            fix.heading = fmod(truth.heading + headingNoise(rng) + 360.0, 360.0);
+            fix.horizontalUncertainty = 0.5;
+            fix.semiMinor = 0.5;
+            fix.valid = LocationCache::HAS_POSITION | LocationCache::HAS_SPEED
+                | LocationCache::HAS_HEADING;
+            if (bodyFrame) {
+                fix.longAccel = truth.accel + accelNoise(rng);
+                fix.headingRate = truth.headingRate + rateNoise(rng);
+                fix.valid |= LocationCache::HAS_LONG_ACCEL | LocationCache::HAS_HEADING_RATE;
+            }
+            cache.update(fix);
+            nextFix += fixIntervalMs;
+        }
+        LocationCache::Fix last;
+        LocationCache::Estimate estimate;
+        if (!cache.latest(last) || !cache.positionAt(T0_MS + sendMs, estimate)) {
+            continue;
+        }
+        const Truth& truth = trace[sendMs / TRUTH_STEP_MS];
+        const double lat = LAT0 + truth.north / mPerDegLat();
+        const double lon = LON0 + truth.east / mPerDegLon();
+        held.push_back(distanceM(lat, lon, last.latitude, last.longitude));
+        extrapolated.push_back(distanceM(lat, lon, estimate.latitude, estimate.longitude));
+    }
+
+    Errors errors;
+    errors.messages = held.size();
+    for (size_t i = 0; i < held.size(); i++) {
+        errors.heldMean += held[i] / held.size();
+        errors.extrapolatedMean += extrapolated[i] / held.size();
+    }
+    errors.heldP95 = percentile(held, 0.95);
+    errors.extrapolatedP95 = percentile(extrapolated, 0.95);
+    return errors;
+}
+
+static void printErrors(const char* name, const Errors& e) {
+    cerr.setf(std::ios::fixed);
+    cerr.precision(2);
+    cerr << name << ": " << e.messages << " messages, position error at send time"
+         << " last fix mean " << e.heldMean << " m p95 " << e.heldP95 << " m,"
+         << " extrapolated mean " << e.extrapolatedMean << " m p95 " << e.extrapolatedP95
+         << " m" << endl;
+}
+
+static void benchmark() {
+    LocationCache cache;
+    auto fix = movingFix(T0_MS, 20, 45);
+    fix.longAccel = 1;
+    fix.headingRate = 5;
+    fix.valid |= LocationCache::HAS_LONG_ACCEL | LocationCache::HAS_HEADING_RATE;
+    cache.update(fix);
+    const unsigned n = 100000;
+    LocationCache::Estimate estimate;
+    double sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < n; i++) {
+        cache.positionAt(T0_MS + i % 200, estimate);
+        sum += estimate.latitude;
+    }
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    CHECK(sum > 0);
+    cerr << "positionAt: " << ns / n << " ns per call" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seconds = 120;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:")) != -1) {
+        switch (c) {
+            case 's': seconds = atoi(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-s seconds]" << endl;
+                return 1;
+        }
+    }
+
+    testExtrapolation();
+    testDerivation();
+    testConcurrency();
+
+    const auto trace = drive(seconds);
+    const auto fast = replay(trace, 100, true);
+    const auto fastDerived = replay(trace, 100, false);
+    const auto slow = replay(trace, 1000, true);
+    const auto slowDerived = replay(trace, 1000, false);
+    printErrors("10 Hz fixes", fast);
+    printErrors("10 Hz fixes, derived kinematics", fastDerived);
+    printErrors("1 Hz fixes", slow);
+    printErrors("1 Hz fixes, derived kinematics", slowDerived);
+    CHECK(fast.extrapolatedMean < fast.heldMean / 2);
+    CHECK(fastDerived.extrapolatedMean < fastDerived.heldMean / 2);
+    CHECK(slow.extrapolatedMean < slow.heldMean / 4);
+    CHECK(slowDerived.extrapolatedMean < slowDerived.heldMean / 2);
+    CHECK(fast.extrapolatedP95 < fast.heldP95);
+    CHECK(slow.extrapolatedP95 < slow.heldP95);
+
+    benchmark();
+
+    if (failures) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cerr << "all checks passed" << endl;
+    return 0;
+}
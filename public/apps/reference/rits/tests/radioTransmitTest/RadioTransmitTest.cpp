@@ -0,0 +1,464 @@
+/*
+ *  Copyright (c) 2018-2020, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+  * @file: RadioTransmitTest.cpp
+  *
+  * @brief: Mock radio test of the RadioTransmit asynchronous flow API.
+  *
+  * Replaces the telux cv2x library with a mock radio that completes flow requests on
+  * its own thread after a configurable delay, like the SDK does after the modem answers.
+  * Checks the pending transmit policies and measures the TX slots missed by a timerfd
+  * driven TX loop when the SPS periodicity is reconfigured with the blocking
+  * updteSpsFlow() and with updateSpsFlowAsync().
+  *
+  * Usage: radio_transmit_test [-d radio delay ms] [-p slot period ms] [-n slots]
+  */
+
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <chrono>
+#include "RadioTransmit.h"
+
+using telux::cv2x::Cv2xFactory;
+using telux::cv2x::Cv2xRadioCapabilities;
+using telux::cv2x::Cv2xStatusEx;
+using telux::cv2x::ICv2xRadio;
+using telux::cv2x::ICv2xRadioListener;
+using telux::cv2x::ICv2xRxSubscription;
+using telux::cv2x::ICv2xTxRxSocket;
+using telux::cv2x::ICv2xListener;
+using telux::cv2x::SocketInfo;
+using telux::cv2x::TrustedUEInfoList;
+using namespace telux::cv2x;
+
+static unsigned failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            cerr << "CHECK failed line " << __LINE__ << ": " #cond << endl; \
+            ++failures;                                                    \
+        }                                                                  \
+    } while (0)
+
+/*
+ * Tx flow backed by a datagram socketpair, the test reads what was sent from peer.
+ */
+class MockTxFlow : public ICv2xTxFlow {
+public:
+    MockTxFlow(uint32_t id, uint16_t port) : id_(id), port_(port) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) == 0) {
+            sock_ = fds[0];
+            peer = fds[1];
+            fcntl(peer, F_SETFL, O_NONBLOCK);
+        }
+    }
+    ~MockTxFlow() {
+        close(sock_);
+        close(peer);
+    }
+    uint32_t getFlowId() const { return id_; }
+    TrafficIpType getIpType() const { return TrafficIpType::TRAFFIC_NON_IP; }
+    uint32_t getServiceId() const { return 1u; }
+    int getSock() const { return sock_; }
+    struct sockaddr_in6 getSockAddr() const { struct sockaddr_in6 a = {0}; return a; }
+    uint16_t getPortNum() const { return port_; }
+
+    int peer = -1;
+
+private:
+    uint32_t id_;
+    uint16_t port_;
+    int sock_ = -1;
+};
+
+/*
+ * Radio that answers flow requests from another thread after delayMs.
+ */
+class MockRadio : public ICv2xRadio {
+public:
+    ~MockRadio() { join(); }
+
+    void join() {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& t : workers) {
+            t.join();
+        }
+        workers.clear();
+    }
+
+    std::atomic<unsigned> delayMs{0};
+    std::atomic<bool> failCreate{false};
+    std::atomic<uint64_t> periodicityMs{100};
+    std::atomic<unsigned> changes{0};
+    shared_ptr<MockTxFlow> lastFlow;
+
+    Cv2xRadioCapabilities getCapabilities() const { return Cv2xRadioCapabilities(); }
+    bool isReady() const { return true; }
+    bool isInitialized() const { return true; }
+    std::future<Status> onReady() {
+        std::promise<Status> p;
+        p.set_value(Status::SUCCESS);
+        return p.get_future();
+    }
+    Status registerListener(std::weak_ptr<ICv2xRadioListener>) { return Status::SUCCESS; }
+    Status deregisterListener(std::weak_ptr<ICv2xRadioListener>) { return Status::SUCCESS; }
+    Status createRxSubscription(TrafficIpType, uint16_t, CreateRxSubscriptionCallback,
+            std::shared_ptr<std::vector<uint32_t>>) { return Status::NOTSUPPORTED; }
+    Status createTxSpsFlow(TrafficIpType, uint32_t, const SpsFlowInfo& spsInfo,
+            uint16_t spsSrcPort, bool, uint16_t, CreateTxSpsFlowCallback cb) {
+        auto flow = std::make_shared<MockTxFlow>(nextId++, spsSrcPort);
+        lastFlow = flow;
+        periodicityMs = spsInfo.periodicityMs;
+        bool fail = failCreate;
+        later([cb, flow, fail]() {
+            cb(fail ? nullptr : flow, nullptr,
+               fail ? ErrorCode::GENERIC_FAILURE : ErrorCode::SUCCESS, ErrorCode::SUCCESS);
+        });
+        return Status::SUCCESS;
+    }
+    Status createTxEventFlow(TrafficIpType, uint32_t, uint16_t, CreateTxEventFlowCallback) {
+        return Status::NOTSUPPORTED;
+    }
+    Status createTxEventFlow(TrafficIpType, uint32_t, const EventFlowInfo&,
+            uint16_t eventSrcPort, CreateTxEventFlowCallback cb) {
+        auto flow = std::make_shared<MockTxFlow>(nextId++, eventSrcPort);
+        lastFlow = flow;
+        later([cb, flow]() { cb(flow, ErrorCode::SUCCESS); });
+        return Status::SUCCESS;
+    }
+    Status closeRxSubscription(std::shared_ptr<ICv2xRxSubscription>,
+            CloseRxSubscriptionCallback) { return Status::NOTSUPPORTED; }
+    Status closeTxFlow(std::shared_ptr<ICv2xTxFlow> txFlow, CloseTxFlowCallback cb) {
+        later([cb, txFlow]() { cb(txFlow, ErrorCode::SUCCESS); });
+        return Status::SUCCESS;
+    }
+    Status changeSpsFlowInfo(std::shared_ptr<ICv2xTxFlow> txFlow, const SpsFlowInfo& spsInfo,
+            ChangeSpsFlowInfoCallback cb) {
+        uint64_t p = spsInfo.periodicityMs;
+        later([this, cb, txFlow, p]() {
+            periodicityMs = p;
+            changes++;
+            cb(txFlow, ErrorCode::SUCCESS);
+        });
+        return Status::SUCCESS;
+    }
+    Status requestSpsFlowInfo(std::shared_ptr<ICv2xTxFlow>, RequestSpsFlowInfoCallback) {
+        return Status::NOTSUPPORTED;
+    }
+    Status changeEventFlowInfo(std::shared_ptr<ICv2xTxFlow>, const EventFlowInfo&,
+            ChangeEventFlowInfoCallback) { return Status::NOTSUPPORTED; }
+    Status requestCapabilities(RequestCapabilitiesCallback) { return Status::NOTSUPPORTED; }
+    Status requestDataSessionSettings(RequestDataSessionSettingsCallback) {
+        return Status::NOTSUPPORTED;
+    }
+    Status updateSrcL2Info(UpdateSrcL2InfoCallback) { return Status::NOTSUPPORTED; }
+    Status updateTrustedUEList(const TrustedUEInfoList&, UpdateTrustedUEListCallback) {
+        return Status::NOTSUPPORTED;
+    }
+    std::string getIfaceNameFromIpType(TrafficIpType) { return "lo"; }
+    Status createCv2xTcpSocket(const EventFlowInfo&, const SocketInfo&,
+            CreateTcpSocketCallback) { return Status::NOTSUPPORTED; }
+    Status closeCv2xTcpSocket(std::shared_ptr<ICv2xTxRxSocket>, CloseTcpSocketCallback) {
+        return Status::NOTSUPPORTED;
+    }
+
+private:
+    void later(std::function<void()> fn) {
+        unsigned ms = delayMs;
+        std::lock_guard<std::mutex> lock(mtx);
+        workers.emplace_back([fn, ms]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+            fn();
+        });
+    }
+
+    std::mutex mtx;
+    vector<thread> workers;
+    uint32_t nextId = 1;
+};
+
+class MockRadioManager : public ICv2xRadioManager {
+public:
+    shared_ptr<MockRadio> radio = std::make_shared<MockRadio>();
+
+    bool isReady() { return true; }
+    std::future<bool> onReady() {
+        std::promise<bool> p;
+        p.set_value(true);
+        return p.get_future();
+    }
+    shared_ptr<ICv2xRadio> getCv2xRadio(TrafficCategory) { return radio; }
+    Status startCv2x(StartCv2xCallback) { return Status::NOTSUPPORTED; }
+    Status stopCv2x(StopCv2xCallback) { return Status::NOTSUPPORTED; }
+    Status requestCv2xStatus(RequestCv2xStatusCallback) { return Status::NOTSUPPORTED; }
+    Status requestCv2xStatus(RequestCv2xStatusCallbackEx cb) {
+        Cv2xStatusEx status = Cv2xStatusEx();
+        status.status.rxStatus = Cv2xStatusType::ACTIVE;
+        status.status.txStatus = Cv2xStatusType::ACTIVE;
+        cb(status, ErrorCode::SUCCESS);
+        return Status::SUCCESS;
+    }
+    Status registerListener(std::weak_ptr<ICv2xListener>) { return Status::SUCCESS; }
+    Status deregisterListener(std::weak_ptr<ICv2xListener>) { return Status::SUCCESS; }
+    Status updateConfiguration(const std::string&, UpdateConfigurationCallback) {
+        return Status::NOTSUPPORTED;
+    }
+    Status setPeakTxPower(int8_t, telux::common::ResponseCallback) {
+        return Status::NOTSUPPORTED;
+    }
+};
+
+static shared_ptr<MockRadioManager> mockManager = std::make_shared<MockRadioManager>();
+
+// The test links these instead of libtelux_cv2x
+namespace telux {
+namespace cv2x {
+Cv2xFactory::Cv2xFactory() {}
+Cv2xFactory& Cv2xFactory::getInstance() {
+    static Cv2xFactory instance;
+    return instance;
+}
+std::shared_ptr<ICv2xRadioManager> Cv2xFactory::getCv2xRadioManager() {
+    return mockManager;
+}
+}
+}
+
+static unsigned readAll(int fd, vector<char>& firstBytes) {
+    char buf[64];
+    unsigned n = 0;
+    while (recv(fd, buf, sizeof(buf), 0) > 0) {
+        firstBytes.push_back(buf[0]);
+        n++;
+    }
+    return n;
+}
+
+static void waitEvents(int efd, uint64_t count) {
+    uint64_t seen = 0, v;
+    struct pollfd pfd = {efd, POLLIN, 0};
+    while (seen < count && poll(&pfd, 1, 2000) > 0) {
+        if (read(efd, &v, sizeof(v)) == sizeof(v)) {
+            seen += v;
+        }
+    }
+    CHECK(seen == count);
+}
+
+// Silences the per packet trace of RadioTransmit::sendOnSock
+class QuietStdout {
+public:
+    QuietStdout() {
+        fflush(stdout);
+        saved = dup(1);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        close(null);
+    }
+    ~QuietStdout() {
+        fflush(stdout);
+        cout.flush();
+        dup2(saved, 1);
+        close(saved);
+    }
+private:
+    int saved;
+};
+
+static void testPendingPolicy(unsigned delayMs) {
+    auto radio = mockManager->radio;
+    SpsFlowInfo spsInfo;
+    radio->delayMs = delayMs;
+
+    for (auto policy : {PendingTxPolicy::QUEUE, PendingTxPolicy::DROP}) {
+        RadioTransmit tx(TrafficCategory::SAFETY_TYPE);
+        int efd = tx.getEventFd();
+        tx.setPendingTxPolicy(policy, 4);
+        auto t0 = std::chrono::steady_clock::now();
+        CHECK(Status::SUCCESS == tx.createSpsFlowAsync(spsInfo, TrafficIpType::TRAFFIC_NON_IP,
+                                                       2500, 1, false, 0));
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+        CHECK(us < 1000 * delayMs / 2);
+        CHECK(tx.getFlowState() == FlowState::PENDING);
+        CHECK(Status::ALREADY == tx.createSpsFlowAsync(spsInfo, TrafficIpType::TRAFFIC_NON_IP,
+                                                       2500, 1, false, 0));
+        auto flow = radio->lastFlow;
+        {
+            QuietStdout quiet;
+            for (char i = 0; i < 6; i++) {
+                tx.transmit(&i, 1);
+            }
+        }
+        waitEvents(efd, 1);
+        CHECK(tx.getFlowState() == FlowState::READY);
+        {
+            QuietStdout quiet;
+            char last = 6;
+            CHECK(static_cast<uint8_t>(Status::SUCCESS) == tx.transmit(&last, 1));
+        }
+        vector<char> got;
+        unsigned n = readAll(flow->peer, got);
+        if (policy == PendingTxPolicy::QUEUE) {
+            // 4 queued, 2 over the limit dropped, then the packet sent on the ready flow
+            CHECK(n == 5 && tx.getDroppedCount() == 2);
+            CHECK(got == vector<char>({0, 1, 2, 3, 6}));
+        } else {
+            CHECK(n == 1 && tx.getDroppedCount() == 6);
+        }
+
+        CHECK(Status::SUCCESS == tx.closeFlowAsync());
+        CHECK(tx.getFlowState() == FlowState::IDLE);
+        char late = 7;
+        CHECK(static_cast<uint8_t>(Status::FAILED) == tx.transmit(&late, 1));
+        waitEvents(efd, 1);
+        radio->join();
+    }
+
+    // failed creation drops what was queued
+    RadioTransmit tx(TrafficCategory::SAFETY_TYPE);
+    tx.setPendingTxPolicy(PendingTxPolicy::QUEUE, 4);
+    radio->failCreate = true;
+    std::promise<ErrorCode> done;
+    CHECK(Status::SUCCESS == tx.createSpsFlowAsync(spsInfo, TrafficIpType::TRAFFIC_NON_IP,
+            2501, 1, false, 0, [&done](FlowOp op, ErrorCode error) { done.set_value(error); }));
+    char c = 0;
+    tx.transmit(&c, 1);
+    CHECK(done.get_future().get() == ErrorCode::GENERIC_FAILURE);
+    CHECK(tx.getFlowState() == FlowState::FAILED);
+    CHECK(tx.getDroppedCount() == 1);
+    radio->failCreate = false;
+    radio->join();
+}
+
+/*
+ * TX loop on a timerfd of periodMs, reconfiguring the periodicity every 50 slots.
+ * A timerfd read returning more than one expiration means slots were missed.
+ */
+static unsigned runTxLoop(RadioTransmit& tx, int peer, bool async, unsigned periodMs,
+                          unsigned slots, unsigned& reconfigs) {
+    int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    struct itimerspec its = {0};
+    its.it_value.tv_nsec = periodMs * 1000000L;
+    its.it_interval = its.it_value;
+    timerfd_settime(tfd, 0, &its, NULL);
+
+    unsigned missed = 0, slot = 0;
+    uint64_t expirations;
+    char payload[200] = {0};
+    vector<char> sent;
+    reconfigs = 0;
+    while (slot < slots && read(tfd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+        missed += expirations - 1;
+        slot += expirations;
+        {
+            QuietStdout quiet;
+            tx.transmit(payload, sizeof(payload));
+        }
+        // Keep the socketpair from filling up, send() would block
+        readAll(peer, sent);
+        if (slot / 50 != (slot - expirations) / 50) {
+            SpsFlowInfo spsInfo;
+            spsInfo.periodicityMs = (reconfigs % 2) ? 100 : 200;
+            if (async) {
+                if (Status::SUCCESS == tx.updateSpsFlowAsync(spsInfo)) {
+                    reconfigs++;
+                }
+            } else if (static_cast<uint8_t>(Status::SUCCESS) == tx.updteSpsFlow(spsInfo)) {
+                reconfigs++;
+            }
+        }
+    }
+    close(tfd);
+    return missed;
+}
+
+static void testReconfigure(unsigned delayMs, unsigned periodMs, unsigned slots) {
+    auto radio = mockManager->radio;
+    SpsFlowInfo spsInfo;
+    unsigned blockingMissed = 0;
+    radio->delayMs = delayMs;
+
+    for (bool async : {false, true}) {
+        RadioTransmit tx(TrafficCategory::SAFETY_TYPE);
+        int efd = tx.getEventFd();
+        CHECK(Status::SUCCESS == tx.createSpsFlowAsync(spsInfo, TrafficIpType::TRAFFIC_NON_IP,
+                                                       2502, 1, false, 0));
+        waitEvents(efd, 1);
+        unsigned before = radio->changes, reconfigs;
+        unsigned missed = runTxLoop(tx, radio->lastFlow->peer, async, periodMs, slots,
+                                    reconfigs);
+        radio->join();
+        CHECK(radio->changes - before == reconfigs);
+        cerr << (async ? "updateSpsFlowAsync" : "updteSpsFlow      ") << ": " << reconfigs
+             << " reconfigurations in " << slots << " slots of " << periodMs
+             << " ms, radio delay " << delayMs << " ms, missed slots " << missed << endl;
+        // A blocking reconfiguration longer than a slot costs slots, the async one should
+        // only lose the odd slot to scheduling jitter.
+        if (!async) {
+            blockingMissed = missed;
+        } else if (delayMs > periodMs) {
+            CHECK(missed < blockingMissed);
+        }
+        tx.closeFlow();
+        radio->join();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned delayMs = 35, periodMs = 10, slots = 500;
+    int c;
+
+    while ((c = getopt(argc, argv, "d:p:n:")) != -1) {
+        switch (c) {
+            case 'd': delayMs = atoi(optarg); break;
+            case 'p': periodMs = atoi(optarg); break;
+            case 'n': slots = atoi(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-d radio delay ms] [-p slot period ms]"
+                     << " [-n slots]" << endl;
+                return 1;
+        }
+    }
+
+    testPendingPolicy(delayMs);
+    testReconfigure(delayMs, periodMs, slots);
+
+    if (failures) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cerr << "all checks passed" << endl;
+    return 0;
+}
@@ -62,7 +62,9 @@ int main(int argc, char* agrv[])
 
     //pthread_create(&apiPthreadSend, NULL, v2x_pthreadSend, NULL);
 
-    while (1);
+    while (1) {
+        pause();
+    }
     
     return 0;
 }
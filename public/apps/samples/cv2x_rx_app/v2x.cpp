@@ -15,8 +15,8 @@
 #include <telux/cv2x/Cv2xRadio.hpp>
 
 #include "v2x.hpp"
+#include "v2x_sock.hpp"
 
-using std::array;
 using std::cerr;
 using std::cout;
 using std::endl;
@@ -37,7 +37,6 @@ using telux::cv2x::SpsFlowInfo;
 
 
 static constexpr uint16_t RX_PORT_NUM = 9000u;
-static constexpr uint32_t GRx_BUF_LEN = 3000u;
 static constexpr uint32_t NUM_TEST_ITERATIONS = 100u;
 
 static Cv2xStatus gCv2xRxStatus;
@@ -48,8 +47,6 @@ static promise<ErrorCode> gRxCallbackPromise;
 static Cv2xStatus gCv2xStatus;
 static promise<ErrorCode> gCallbackPromise;
 static shared_ptr<ICv2xRxSubscription> gRxSub;
-static uint32_t gPacketsReceived = 0u;
-static array<char, GRx_BUF_LEN> gRxBuf;
 
 static constexpr uint32_t SPS_SERVICE_ID = 1u;
 static constexpr uint16_t SPS_SRC_PORT_NUM = 2500u;
@@ -59,7 +56,6 @@ static constexpr int      PRIORITY = 3;
 static constexpr char TEST_VERNO_MAGIC = 'Q';
 static constexpr char UEID = 1;
 static shared_ptr<ICv2xTxFlow> gSpsFlow;
-static array<char, G_BUF_LEN> gBuf;
 
 //add yaxon
 V2xRegisterInfo *g_cb_info;
@@ -126,99 +122,18 @@ static void rxSubCallback(shared_ptr<ICv2xRxSubscription> rxSub, ErrorCode error
 static void closeFlowCallback(shared_ptr<ICv2xTxFlow> flow, ErrorCode error) {
     gCallbackPromise.set_value(error);
 }
-#if 0
-// Function for reading from Rx socket
-static void sampleRx(void) {
-    V2xRxData param;
-    unsigned char *dataSave;
-    int sock = gRxSub->getSock();
-
-    // Attempt to read from socket
-    int RecvByte = recv(sock, gRxBuf.data(), gRxBuf.max_size(), 0);
-
-    dataSave = (unsigned char *)malloc(gRxBuf.max_size());
-    memcpy(dataSave, gRxBuf.data(), gRxBuf.max_size());
-    
-    param.length      = RecvByte;
-    param.data        = dataSave;
-
-    g_cb_info->callback(&param);
-
-    free(dataSave);
-    dataSave = NULL;
-}
-#endif
-
-// Function for reading from Rx socket
-static void sampleRx(void) {
-
-    int sock = gRxSub->getSock();
-
-    cout << "sampleRx(" << sock << ")" << endl;
-
-    // Attempt to read from socket
-    int n = recv(sock, gBuf.data(), gBuf.max_size(), 0);
-    cout << "Rx array values: " << endl;
-    for (auto it = gBuf.begin(); it != gBuf.end(); ++it) {
-          printf("0x%02x ", *it);
-    }
-    if (n < 0) {
-        cerr << "Error occurred reading from socket[" << sock << "]" << endl;
-    }
-    else {
-        cout << __FUNCTION__ << ": Received " << n << " bytes" << endl;
-        ++gPacketsReceived;
-    }
-}
-
 int yx_V2xDataSend(V2xTxData *txInfo)
 {
-    static uint32_t txCount = 0u;
+    return (yx_V2xDataSendBatch(txInfo, 1) == 1) ? 0 : -1;
+}
 
-    int sock = gSpsFlow->getSock();
-    
-    cout << "Tx(" << sock << ")" << endl;
-    
-    struct msghdr message = {0};
-    struct iovec iov[1] = {0};
-    struct cmsghdr * cmsghp = NULL;
-    char control[CMSG_SPACE(sizeof(int))];
-
-    // Send data using sendmsg to provide IPV6_TCLASS per packet
-    iov[0].iov_base = txInfo->data;
-    iov[0].iov_len = txInfo->length;
-    message.msg_iov = iov;
-    message.msg_iovlen = 1;
-    message.msg_control = control;
-    message.msg_controllen = sizeof(control);
-
-    // Fill ancillary data
-    int priority = PRIORITY;
-    cmsghp = CMSG_FIRSTHDR(&message);
-    cmsghp->cmsg_level = IPPROTO_IPV6;
-    cmsghp->cmsg_type = IPV6_TCLASS;
-    cmsghp->cmsg_len = CMSG_LEN(sizeof(int));
-    memcpy(CMSG_DATA(cmsghp), &priority, sizeof(int));
-                                                 
-    // Send data
-    auto bytes_sent = sendmsg(sock, &message, 0);
-    cout << "bytes_sent=" << bytes_sent << endl;
-                                                                                 
-    // Check bytes sent
-    if (bytes_sent < 0) {
-        cerr << "Error sending message: " << bytes_sent << endl;
-        bytes_sent = -1;
-    } else {
-        if (bytes_sent == txInfo->length) {
-            ++txCount;
-        } else {
-            cerr << "Error : " << bytes_sent << " bytes sent." << endl;
-        }
+// Sends num packets with one sendmmsg per V2X_TX_BATCH_MAX packets, returns the number sent
+int yx_V2xDataSendBatch(V2xTxData *txInfo, int num)
+{
+    if (gSpsFlow == nullptr || txInfo == NULL || num < 0) {
+        return -1;
     }
-                                                                                                                                                    
-    cout << "TX count: " << txCount << endl;
-
-    return 0;
+    return v2x_tx_send(gSpsFlow->getSock(), txInfo, num, PRIORITY);
 }
 
 int yx_V2xDataRecvRegister(V2xRegisterInfo *cbInfo)
@@ -226,15 +141,20 @@ int yx_V2xDataRecvRegister(V2xRegisterInfo *cbInfo)
     if (cbInfo == NULL)
         return -1;
     g_cb_info = cbInfo;
+    v2x_rx_set_callback(cbInfo->callback);
 
     return 0;
 }
 
-void* v2x_pthread(void* data)
+// Gives back a buffer kept by a callback that returned V2X_RX_HOLD
+int yx_V2xRxRelease(const unsigned char *data)
 {
-    while (1){
-        sampleRx();
-    }
+    return v2x_rx_release(data);
+}
+
+void yx_V2xGetStat(V2xStat *stat)
+{
+    v2x_get_stat(stat);
 }
 
 static int v2x_rx_init(void)
@@ -364,13 +284,11 @@ static int v2x_tx_init(void)
 
 int yx_V2xSdkRxInit(void)
 {
-    pthread_t apiPthread;
-
-    v2x_rx_init();
+    if (v2x_rx_init() != 0) {
+        return -1;
+    }
 
-    pthread_create(&apiPthread, NULL, v2x_pthread, NULL);
-    
-    return 0;
+    return v2x_rx_start(gRxSub->getSock());
 }
 
 int yx_V2xSdkTxInit(void)
@@ -388,20 +306,20 @@ static uint64_t getCurrentTimestamp(void) {
     return tv.tv_sec * 1000000ull + tv.tv_usec;
 }
 
-// Fills buffer with dummy data
-static void fillBuffer(void) {
+// Fills buf (G_BUF_LEN bytes) with dummy data
+static void fillBuffer(char *buf) {
 
     static uint16_t seq_num = 0u;
     auto timestamp = getCurrentTimestamp();
 
     // Very first payload is test Magic number, this is  where V2X Family ID would normally be.
-    gBuf[0] = TEST_VERNO_MAGIC;
+    buf[0] = TEST_VERNO_MAGIC;
 
     // Next byte is the UE equipment ID
-    gBuf[1] = UEID;
+    buf[1] = UEID;
 
     // Sequence number
-    auto dataPtr = gBuf.data() + 2;
+    auto dataPtr = buf + 2;
     uint16_t tmp = htons(seq_num++);
     memcpy(dataPtr, reinterpret_cast<char *>(&tmp), sizeof(uint16_t));
     dataPtr += sizeof(uint16_t);
@@ -410,61 +328,13 @@ static void fillBuffer(void) {
     dataPtr += snprintf(dataPtr, G_BUF_LEN - (2 + sizeof(uint16_t)),
                         "<%llu> ", static_cast<long long unsigned>(timestamp));
 
-    printf("gBuf[0]=0x%02x, gBuf[1]=0x%02x", gBuf.at(0), gBuf.at(1));
+    printf("buf[0]=0x%02x, buf[1]=0x%02x", buf[0], buf[1]);
     // Dummy payload
     constexpr int NUM_LETTERS = 26;
     auto i = 2 + sizeof(uint16_t) - sizeof(long long unsigned);
     for (; i < G_BUF_LEN; ++i) {
-        gBuf[i] = 'a' + ((seq_num + i) % NUM_LETTERS);
-    }
-}
-
-// Function for transmitting data
-static void sampleSpsTx(void) {
-
-    static uint32_t txCount = 0u;
-    int sock = gSpsFlow->getSock();
-
-    cout << "sampleSpsTx(" << sock << ")" << endl;
-
-    struct msghdr message = {0};
-    struct iovec iov[1] = {0};
-    struct cmsghdr * cmsghp = NULL;
-    char control[CMSG_SPACE(sizeof(int))];
-
-    // Send data using sendmsg to provide IPV6_TCLASS per packet
-    iov[0].iov_base = gBuf.data();
-    iov[0].iov_len = G_BUF_LEN;
-    message.msg_iov = iov;
-    message.msg_iovlen = 1;
-    message.msg_control = control;
-    message.msg_controllen = sizeof(control);
-
-    // Fill ancillary data
-    int priority = PRIORITY;
-    cmsghp = CMSG_FIRSTHDR(&message);
-    cmsghp->cmsg_level = IPPROTO_IPV6;
-    cmsghp->cmsg_type = IPV6_TCLASS;
-    cmsghp->cmsg_len = CMSG_LEN(sizeof(int));
-    memcpy(CMSG_DATA(cmsghp), &priority, sizeof(int));
-
-    // Send data
-    auto bytes_sent = sendmsg(sock, &message, 0);
-    cout << "bytes_sent=" << bytes_sent << endl;
-
-    // Check bytes sent
-    if (bytes_sent < 0) {
-        cerr << "Error sending message: " << bytes_sent << endl;
-        bytes_sent = -1;
-    } else {
-        if (bytes_sent == G_BUF_LEN) {
-           ++txCount;
-        } else {
-            cerr << "Error : " << bytes_sent << " bytes sent." << endl;
-        }
+        buf[i] = 'a' + ((seq_num + i) % NUM_LETTERS);
     }
-
-    cout << "TX count: " << txCount << endl;
 }
 
 
@@ -528,12 +398,12 @@ static int yx_V2xRxTxInit(void)
                                                               RX_PORT_NUM,
                                                               rxSubCallback));
     assert(ErrorCode::SUCCESS == gCallbackPromise.get_future().get());
-#if 1
-    // Read from the RX socket in a loop
-    for (uint32_t i = 0; i < 10; ++i) {
-        sampleRx();
+
+    // Deliver received packets to the registered callback
+    if (v2x_rx_start(gRxSub->getSock()) != 0) {
+        cerr << "C-V2X RX thread start failed" << endl;
+        return EXIT_FAILURE;
     }
-#endif
 
     //tx:
     cout << "Running Sample C-V2X TX app" << endl;
@@ -591,7 +461,7 @@ static int yx_V2xRxTxInit(void)
     spsInfo.autoRetransEnabled = true;
 
     cout << "22222" << endl;
-    resetCallbackPromise();
+    resetTxCallbackPromise();
     cout << "33333" << endl;
     assert(Status::SUCCESS == cv2xRadio->createTxSpsFlow(TrafficIpType::TRAFFIC_NON_IP,
                                                          SPS_SERVICE_ID,
@@ -601,13 +471,17 @@ static int yx_V2xRxTxInit(void)
                                                          0,
                                                          createSpsFlowCallback));
     cout << "44444" << endl;
-    assert(ErrorCode::SUCCESS == gCallbackPromise.get_future().get());
+    assert(ErrorCode::SUCCESS == gTxCallbackPromise.get_future().get());
     cout << "55555" << endl;
 #if 1
     // Send message in a loop
+    char buf[G_BUF_LEN];
+    V2xTxData txInfo = { G_BUF_LEN, reinterpret_cast<unsigned char *>(buf) };
     for (uint16_t i = 0; i < 10; ++i) {
-        fillBuffer();
-        sampleSpsTx();
+        fillBuffer(buf);
+        if (yx_V2xDataSend(&txInfo) != 0) {
+            cerr << "Error sending message" << endl;
+        }
         usleep(100000u);
     }
 #endif
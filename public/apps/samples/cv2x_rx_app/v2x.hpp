@@ -11,17 +11,40 @@ typedef struct {
     unsigned char *data;
 } V2xTxData;
 
+/* Callback return value: keep param->data until yx_V2xRxRelease(param->data).
+ * Any other value releases the buffer when the callback returns. */
+#define V2X_RX_HOLD     1
+
 typedef int (*V2xRecvCallback)(V2xRxData *param);
 
 typedef struct {
     V2xRecvCallback callback;
 } V2xRegisterInfo;
 
+typedef struct {
+    unsigned int rxPackets;
+    unsigned long long rxBytes;
+    unsigned int rxWakeups;     /* poll() returns of the rx thread */
+    unsigned int rxNoBuf;       /* waits because every rx buffer was held */
+    unsigned int rxHeld;        /* buffers currently held by the application */
+    unsigned int txPackets;
+    unsigned int txCalls;       /* sendmmsg system calls */
+    unsigned int txErrors;
+} V2xStat;
+
 
 int yx_V2xSdkInit(void);
 int yx_V2xSdkRxInit(void);
 int yx_V2xSdkTxInit(void);
 int yx_V2xDataRecvRegister(V2xRegisterInfo *cbInfo);
+int yx_V2xRxRelease(const unsigned char *data);
+/* Returns 0 when the packet was sent and -1 when the tx flow is not set up
+ * or the send failed. Callers that relied on it always returning 0 must now
+ * check the result. */
 int yx_V2xDataSend(V2xTxData *txInfo);
+/* Returns the number of packets sent from the front of txInfo, or -1 when
+ * the tx flow is not set up, the arguments are invalid or nothing was sent. */
+int yx_V2xDataSendBatch(V2xTxData *txInfo, int num);
+void yx_V2xGetStat(V2xStat *stat);
 
 #endif
@@ -0,0 +1,394 @@
+/*
+ * Loopback test and benchmark for the V2X shim socket layer (v2x_sock.cpp).
+ * A pair of IPv6 UDP sockets on ::1 stands in for the cv2x rx subscription and
+ * tx flow sockets, so this runs on the host without the radio:
+ *   g++ -O2 -o v2x_loop v2x_loop.c v2x_sock.cpp -lpthread
+ * Usage: v2x_loop [-n packets] [-s size] [-b tx batch]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "v2x.hpp"
+#include "v2x_sock.hpp"
+
+#define LOOP_WINDOW         512                 /* packets in flight, keeps the loopback from dropping */
+#define LOOP_PRIORITY       3
+
+static int gPackets = 200000;
+static int gSize = 200;
+static int gBatch = 16;
+static int gFails = 0;
+
+static int gRxSock = -1;
+static int gTxSock = -1;
+
+static volatile unsigned int gRxCount;
+static volatile unsigned int gRxErrors;
+static volatile int gHoldMode;                  /* 0 none, 1 every third packet, 2 all */
+static const unsigned char *gHeld[4096];
+static volatile unsigned int gHeldNum;
+static pthread_mutex_t gHeldLock = PTHREAD_MUTEX_INITIALIZER;
+
+#define LOOP_CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                          \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);               \
+            gFails++;                                                           \
+        }                                                                       \
+    } while (0)
+
+static double loop_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double loop_cpu(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static int loop_open(void)
+{
+    struct sockaddr_in6 addr;
+    socklen_t len = sizeof(addr);
+    int rcvbuf = 4 * 1024 * 1024;
+
+    gRxSock = socket(AF_INET6, SOCK_DGRAM, 0);
+    gTxSock = socket(AF_INET6, SOCK_DGRAM, 0);
+    if (gRxSock < 0 || gTxSock < 0) {
+        printf("socket error %d\n", errno);
+        return -1;
+    }
+    setsockopt(gRxSock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr   = in6addr_loopback;
+    if (bind(gRxSock, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || getsockname(gRxSock, (struct sockaddr *)&addr, &len) < 0
+        || connect(gTxSock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        printf("loopback setup error %d\n", errno);
+        return -1;
+    }
+    return 0;
+}
+
+static void loop_fill(unsigned char *buf, unsigned int seq, int len)
+{
+    int i;
+
+    memcpy(buf, &seq, sizeof(seq));
+    for (i = sizeof(seq); i < len; i++) {
+        buf[i] = (unsigned char)(seq + i);
+    }
+}
+
+static int loop_size(unsigned int seq)
+{
+    return 8 + (seq * 37) % (gSize - 7);
+}
+
+static int loop_rx_cb(V2xRxData *param)
+{
+    unsigned int seq;
+    int i;
+
+    memcpy(&seq, param->data, sizeof(seq));
+    if (seq != gRxCount || param->length != loop_size(seq)) {
+        gRxErrors++;
+    } else {
+        for (i = sizeof(seq); i < param->length; i++) {
+            if (param->data[i] != (unsigned char)(seq + i)) {
+                gRxErrors++;
+                break;
+            }
+        }
+    }
+    gRxCount++;
+
+    if (gHoldMode == 2 || (gHoldMode == 1 && seq % 3 == 0)) {
+        pthread_mutex_lock(&gHeldLock);
+        gHeld[gHeldNum++] = param->data;
+        pthread_mutex_unlock(&gHeldLock);
+        return V2X_RX_HOLD;
+    }
+    return 0;
+}
+
+static void loop_release_all(void)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&gHeldLock);
+    for (i = 0; i < gHeldNum; i++) {
+        LOOP_CHECK(v2x_rx_release(gHeld[i]) == 0);
+    }
+    gHeldNum = 0;
+    pthread_mutex_unlock(&gHeldLock);
+}
+
+static int loop_wait(volatile unsigned int *counter, unsigned int target, double timeout)
+{
+    double start = loop_now();
+
+    while (*counter < target) {
+        if (loop_now() - start > timeout) {
+            return -1;
+        }
+        usleep(100);
+    }
+    return 0;
+}
+
+static void loop_send(unsigned int first, int num)
+{
+    static unsigned char bufs[V2X_TX_BATCH_MAX][V2X_RX_BUF_LEN];
+    V2xTxData tx[V2X_TX_BATCH_MAX];
+    int i, n;
+
+    while (num > 0) {
+        n = (num < (int)V2X_TX_BATCH_MAX) ? num : V2X_TX_BATCH_MAX;
+        for (i = 0; i < n; i++) {
+            tx[i].length = loop_size(first + i);
+            tx[i].data   = bufs[i];
+            loop_fill(bufs[i], first + i, tx[i].length);
+        }
+        LOOP_CHECK(v2x_tx_send(gTxSock, tx, n, LOOP_PRIORITY) == n);
+        first += n;
+        num   -= n;
+    }
+}
+
+/*******************************************************************************
+** Tests
+******************************************************************************/
+static void loop_test(void)
+{
+    V2xStat stat;
+    unsigned char foreign[8];
+    const unsigned char *again;
+    unsigned int seq = 0, total = V2X_RX_BUF_NUM + 20;
+    int i;
+    double cpu;
+
+    gRxCount = 0;
+    gRxErrors = 0;
+    gHoldMode = 1;
+    v2x_rx_set_callback(loop_rx_cb);
+    LOOP_CHECK(v2x_rx_start(gRxSock) == 0);
+    LOOP_CHECK(v2x_rx_start(gRxSock) == -1);
+
+    // in-order delivery, every third buffer held and released from this thread
+    for (i = 0; i < 20; i++) {
+        loop_send(seq, 50);
+        seq += 50;
+        LOOP_CHECK(loop_wait(&gRxCount, seq, 5) == 0);
+        again = gHeld[0];
+        loop_release_all();
+        if (i == 0) {
+            LOOP_CHECK(v2x_rx_release(again) == -1);          // second release
+        }
+    }
+    LOOP_CHECK(gRxCount == seq && gRxErrors == 0);
+    LOOP_CHECK(v2x_rx_release(foreign) == -1);
+    LOOP_CHECK(v2x_rx_release(NULL) == -1);
+    v2x_get_stat(&stat);
+    LOOP_CHECK(stat.rxHeld == 0);
+    printf("delivery + release : %u packets, %u errors\n", gRxCount, gRxErrors);
+
+    // every buffer held: the rx thread stops reading and resumes after the release
+    gHoldMode = 2;
+    loop_send(seq, total);
+    LOOP_CHECK(loop_wait(&gRxCount, seq + V2X_RX_BUF_NUM, 5) == 0);
+    usleep(100000);
+    v2x_get_stat(&stat);
+    LOOP_CHECK(gRxCount == seq + V2X_RX_BUF_NUM);
+    LOOP_CHECK(stat.rxHeld == V2X_RX_BUF_NUM && stat.rxNoBuf > 0);
+    gHoldMode = 0;
+    loop_release_all();
+    LOOP_CHECK(loop_wait(&gRxCount, seq + total, 5) == 0);
+    seq += total;
+    LOOP_CHECK(gRxErrors == 0);
+    printf("buffer exhaustion  : %u held, %u no-buffer waits, resumed to %u packets\n",
+           V2X_RX_BUF_NUM, stat.rxNoBuf, gRxCount);
+
+    // idle: the rx thread must block rather than spin
+    v2x_get_stat(&stat);
+    cpu = loop_cpu();
+    usleep(500000);
+    cpu = loop_cpu() - cpu;
+    {
+        V2xStat idle;
+        v2x_get_stat(&idle);
+        LOOP_CHECK(idle.rxWakeups == stat.rxWakeups);
+    }
+    LOOP_CHECK(cpu < 0.05);
+    printf("idle 500 ms        : %.1f ms cpu\n", cpu * 1000);
+
+    v2x_rx_stop();
+    v2x_rx_set_callback(NULL);
+    printf("loopback test      : %s\n", gFails == 0 ? "PASS" : "FAIL");
+}
+
+/*******************************************************************************
+** Benchmark: previous shim (blocking recv, malloc + copy of the whole buffer per
+** packet, one sendmsg per packet) against the buffer ring and batched send
+******************************************************************************/
+static volatile int gLegacyStop;
+
+static void* loop_legacy_rx(void* data)
+{
+    static unsigned char rxBuf[V2X_RX_BUF_LEN];
+    V2xRxData param;
+    unsigned char *dataSave;
+    int n;
+
+    while (!gLegacyStop) {
+        n = recv(gRxSock, rxBuf, sizeof(rxBuf), 0);
+        if (n < 0 || gLegacyStop) {
+            continue;
+        }
+        dataSave = (unsigned char *)malloc(sizeof(rxBuf));
+        memcpy(dataSave, rxBuf, sizeof(rxBuf));
+        param.length = n;
+        param.data   = dataSave;
+        loop_rx_cb(&param);
+        free(dataSave);
+    }
+    return NULL;
+}
+
+static void loop_legacy_send(unsigned char *buf, int len)
+{
+    struct msghdr message;
+    struct iovec iov[1];
+    struct cmsghdr *cmsghp;
+    char control[CMSG_SPACE(sizeof(int))];
+    int priority = LOOP_PRIORITY;
+
+    memset(&message, 0, sizeof(message));
+    memset(control, 0, sizeof(control));
+    iov[0].iov_base = buf;
+    iov[0].iov_len  = len;
+    message.msg_iov        = iov;
+    message.msg_iovlen     = 1;
+    message.msg_control    = control;
+    message.msg_controllen = sizeof(control);
+    cmsghp = CMSG_FIRSTHDR(&message);
+    cmsghp->cmsg_level = IPPROTO_IPV6;
+    cmsghp->cmsg_type  = IPV6_TCLASS;
+    cmsghp->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsghp), &priority, sizeof(int));
+    if (sendmsg(gTxSock, &message, 0) != len) {
+        gFails++;
+    }
+}
+
+static void loop_bench(int legacy)
+{
+    static unsigned char bufs[V2X_TX_BATCH_MAX][V2X_RX_BUF_LEN];
+    V2xTxData tx[V2X_TX_BATCH_MAX];
+    V2xStat before, after;
+    pthread_t pid;
+    unsigned int seq;
+    double start, cpu, elapsed;
+    int i, n, batch = legacy ? 1 : gBatch;
+
+    gRxCount  = 0;
+    gRxErrors = 0;
+    gHoldMode = 0;
+    if (legacy) {
+        gLegacyStop = 0;
+        pthread_create(&pid, NULL, loop_legacy_rx, NULL);
+    } else {
+        v2x_rx_set_callback(loop_rx_cb);
+        v2x_rx_start(gRxSock);
+    }
+    v2x_get_stat(&before);
+
+    start = loop_now();
+    cpu   = loop_cpu();
+    for (seq = 0; seq < (unsigned int)gPackets; seq += n) {
+        while (seq - gRxCount > LOOP_WINDOW) {
+            usleep(20);
+        }
+        n = gPackets - seq;
+        n = (n < batch) ? n : batch;
+        for (i = 0; i < n; i++) {
+            tx[i].length = loop_size(seq + i);
+            tx[i].data   = bufs[i];
+            loop_fill(bufs[i], seq + i, tx[i].length);
+            if (legacy) {
+                loop_legacy_send(bufs[i], tx[i].length);
+            }
+        }
+        if (!legacy) {
+            v2x_tx_send(gTxSock, tx, n, LOOP_PRIORITY);
+        }
+    }
+    if (loop_wait(&gRxCount, gPackets, 10) != 0) {
+        printf("lost %u packets\n", gPackets - gRxCount);
+        gFails++;
+    }
+    elapsed = loop_now() - start;
+    cpu     = loop_cpu() - cpu;
+
+    if (legacy) {
+        gLegacyStop = 1;
+        loop_send(0, 1);                                // wakes the blocking recv
+        pthread_join(pid, NULL);
+        printf("%-22s %10.0f pkt/s %8.2f us cpu/pkt  %u errors\n", "legacy recv + malloc",
+               gPackets / elapsed, cpu * 1e6 / gPackets, gRxErrors);
+    } else {
+        v2x_get_stat(&after);
+        v2x_rx_stop();
+        printf("%-22s %10.0f pkt/s %8.2f us cpu/pkt  %u errors, %.1f pkt/sendmmsg, %.1f pkt/wakeup\n",
+               "buffer ring + batch", gPackets / elapsed, cpu * 1e6 / gPackets, gRxErrors,
+               (double)(after.txPackets - before.txPackets) / (after.txCalls - before.txCalls),
+               (double)gPackets / (after.rxWakeups - before.rxWakeups));
+    }
+    if (gRxErrors != 0) {
+        gFails++;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:b:")) != -1) {
+        switch (opt) {
+        case 'n': gPackets = atoi(optarg); break;
+        case 's': gSize    = atoi(optarg); break;
+        case 'b': gBatch   = atoi(optarg); break;
+        default:
+            printf("usage: %s [-n packets] [-s max size] [-b tx batch]\n", argv[0]);
+            return -1;
+        }
+    }
+    gSize  = (gSize < 16) ? 16 : ((gSize > (int)V2X_RX_BUF_LEN) ? (int)V2X_RX_BUF_LEN : gSize);
+    gBatch = (gBatch < 1) ? 1 : ((gBatch > (int)V2X_TX_BATCH_MAX) ? (int)V2X_TX_BATCH_MAX : gBatch);
+
+    if (loop_open() != 0) {
+        return -1;
+    }
+    loop_test();
+
+    printf("\n%d packets of 8..%d bytes, tx batch %d\n", gPackets, gSize, gBatch);
+    loop_bench(1);
+    loop_bench(0);
+    return gFails == 0 ? 0 : 1;
+}
@@ -0,0 +1,281 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include <iostream>
+
+#include "v2x_sock.hpp"
+
+using std::cerr;
+using std::endl;
+
+// Rx buffer ring. Free buffers are owned by the rx thread (a local cache);
+// buffers released from other threads go through sRxFree under sRxLock.
+static unsigned char sRxBuf[V2X_RX_BUF_NUM][V2X_RX_BUF_LEN] __attribute__((aligned(64)));
+static unsigned char sRxHeld[V2X_RX_BUF_NUM];
+static unsigned short sRxFree[V2X_RX_BUF_NUM];
+static unsigned int sRxFreeNum;
+static bool sRxWaiting;
+static pthread_mutex_t sRxLock = PTHREAD_MUTEX_INITIALIZER;
+
+static V2xRecvCallback volatile sRxCallback;
+static int sRxSock = -1;
+static int sWakeFd = -1;
+static volatile bool sRxStop;
+static bool sRxRunning;
+static pthread_t sRxThread;
+
+static V2xStat sStat;
+
+static void v2x_rx_wake(void)
+{
+    uint64_t one = 1;
+
+    if (write(sWakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        cerr << "v2x rx wake error " << errno << endl;
+    }
+}
+
+// Moves buffers released by the application into the rx thread cache.
+// Returns false with sRxWaiting set when there is nothing to take.
+static bool v2x_rx_refill(unsigned short *cache, unsigned int *ncache)
+{
+    bool got;
+
+    pthread_mutex_lock(&sRxLock);
+    while (sRxFreeNum > 0 && *ncache < V2X_RX_BUF_NUM) {
+        cache[(*ncache)++] = sRxFree[--sRxFreeNum];
+    }
+    got = (*ncache > 0);
+    sRxWaiting = !got;
+    pthread_mutex_unlock(&sRxLock);
+    return got;
+}
+
+static void v2x_rx_deliver(unsigned short idx, unsigned int len, unsigned short *cache, unsigned int *ncache)
+{
+    V2xRecvCallback callback = sRxCallback;
+    V2xRxData param;
+
+    sStat.rxPackets++;
+    sStat.rxBytes += len;
+    if (callback == NULL) {
+        cache[(*ncache)++] = idx;
+        return;
+    }
+
+    // Marked held before the call, so a release from another thread racing
+    // with the return of the callback is still accepted.
+    __atomic_store_n(&sRxHeld[idx], 1, __ATOMIC_RELEASE);
+    param.length = len;
+    param.data   = sRxBuf[idx];
+    if (callback(&param) == V2X_RX_HOLD) {
+        __sync_fetch_and_add(&sStat.rxHeld, 1);
+        return;
+    }
+    __atomic_store_n(&sRxHeld[idx], 0, __ATOMIC_RELEASE);
+    cache[(*ncache)++] = idx;
+}
+
+static void* v2x_rx_thread(void* data)
+{
+    struct mmsghdr msgs[V2X_RX_BATCH];
+    struct iovec iov[V2X_RX_BATCH];
+    struct pollfd fds[2];
+    unsigned short cache[V2X_RX_BUF_NUM];
+    unsigned short slot[V2X_RX_BATCH];
+    unsigned int ncache = 0, n, i;
+    uint64_t cnt;
+    int ret;
+
+    for (i = 0; i < V2X_RX_BUF_NUM; i++) {
+        cache[ncache++] = i;
+    }
+
+    while (!sRxStop) {
+        if (ncache < V2X_RX_BATCH && !v2x_rx_refill(cache, &ncache)) {
+            sStat.rxNoBuf++;                                    // every buffer held, wait for a release
+        }
+
+        fds[0].fd      = sWakeFd;
+        fds[0].events  = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd      = sRxSock;
+        fds[1].events  = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, ncache > 0 ? 2 : 1, -1) < 0) {
+            if (errno != EINTR) {
+                cerr << "v2x rx poll error " << errno << endl;
+            }
+            continue;
+        }
+        sStat.rxWakeups++;
+        if (fds[0].revents & POLLIN) {
+            if (read(sWakeFd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+                cerr << "v2x rx wake read error " << errno << endl;
+            }
+        }
+        if (ncache == 0 || !(fds[1].revents & POLLIN)) {
+            continue;
+        }
+
+        n = (ncache < V2X_RX_BATCH) ? ncache : V2X_RX_BATCH;
+        for (i = 0; i < n; i++) {
+            slot[i] = cache[--ncache];
+            iov[i].iov_base = sRxBuf[slot[i]];
+            iov[i].iov_len  = V2X_RX_BUF_LEN;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov    = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        ret = recvmmsg(sRxSock, msgs, n, MSG_DONTWAIT, NULL);
+        if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+            cerr << "Error occurred reading from socket[" << sRxSock << "] " << errno << endl;
+        }
+        for (i = 0; ret > 0 && i < (unsigned int)ret; i++) {
+            v2x_rx_deliver(slot[i], msgs[i].msg_len, cache, &ncache);
+        }
+        for (i = (ret > 0) ? ret : 0; i < n; i++) {             // unused buffers go back to the cache
+            cache[ncache++] = slot[i];
+        }
+    }
+    return NULL;
+}
+
+int v2x_rx_start(int sock)
+{
+    if (sRxRunning) {
+        return -1;
+    }
+
+    sWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sWakeFd < 0) {
+        cerr << "v2x rx eventfd error " << errno << endl;
+        return -1;
+    }
+    memset(sRxHeld, 0, sizeof(sRxHeld));
+    sRxFreeNum = 0;
+    sRxWaiting = false;
+    sStat.rxHeld = 0;
+    sRxSock = sock;
+    sRxStop = false;
+    if (pthread_create(&sRxThread, NULL, v2x_rx_thread, NULL) != 0) {
+        close(sWakeFd);
+        sWakeFd = -1;
+        return -1;
+    }
+    sRxRunning = true;
+    return 0;
+}
+
+void v2x_rx_stop(void)
+{
+    if (!sRxRunning) {
+        return;
+    }
+    sRxStop = true;
+    v2x_rx_wake();
+    pthread_join(sRxThread, NULL);
+    close(sWakeFd);
+    sWakeFd = -1;
+    sRxRunning = false;
+}
+
+void v2x_rx_set_callback(V2xRecvCallback callback)
+{
+    sRxCallback = callback;
+}
+
+int v2x_rx_release(const unsigned char *data)
+{
+    unsigned long offset;
+    unsigned int idx;
+    int ret = -1;
+
+    if (data < sRxBuf[0] || data >= sRxBuf[V2X_RX_BUF_NUM]) {
+        return -1;
+    }
+    offset = data - sRxBuf[0];
+    if (offset % V2X_RX_BUF_LEN != 0) {
+        return -1;
+    }
+    idx = offset / V2X_RX_BUF_LEN;
+
+    pthread_mutex_lock(&sRxLock);
+    if (__atomic_load_n(&sRxHeld[idx], __ATOMIC_ACQUIRE)) {     // a second release of the same buffer fails
+        __atomic_store_n(&sRxHeld[idx], 0, __ATOMIC_RELEASE);
+        sRxFree[sRxFreeNum++] = idx;
+        __sync_fetch_and_sub(&sStat.rxHeld, 1);
+        if (sRxWaiting) {
+            sRxWaiting = false;
+            v2x_rx_wake();
+        }
+        ret = 0;
+    }
+    pthread_mutex_unlock(&sRxLock);
+    return ret;
+}
+
+int v2x_tx_send(int sock, V2xTxData *txInfo, int num, int priority)
+{
+    struct mmsghdr msgs[V2X_TX_BATCH_MAX];
+    struct iovec iov[V2X_TX_BATCH_MAX];
+    char control[V2X_TX_BATCH_MAX][CMSG_SPACE(sizeof(int))];
+    struct cmsghdr *cmsghp;
+    int sent = 0, n, i, ret;
+
+    while (sent < num) {
+        n = num - sent;
+        if (n > (int)V2X_TX_BATCH_MAX) {
+            n = V2X_TX_BATCH_MAX;
+        }
+        memset(msgs, 0, n * sizeof(msgs[0]));
+        memset(control, 0, n * sizeof(control[0]));
+        for (i = 0; i < n; i++) {
+            // Send data using sendmsg to provide IPV6_TCLASS per packet
+            iov[i].iov_base = txInfo[sent + i].data;
+            iov[i].iov_len  = txInfo[sent + i].length;
+            msgs[i].msg_hdr.msg_iov        = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen     = 1;
+            msgs[i].msg_hdr.msg_control    = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+
+            cmsghp = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+            cmsghp->cmsg_level = IPPROTO_IPV6;
+            cmsghp->cmsg_type  = IPV6_TCLASS;
+            cmsghp->cmsg_len   = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsghp), &priority, sizeof(int));
+        }
+
+        ret = sendmmsg(sock, msgs, n, 0);
+        __sync_fetch_and_add(&sStat.txCalls, 1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "Error sending message: " << errno << endl;
+            __sync_fetch_and_add(&sStat.txErrors, 1);
+            break;
+        }
+        for (i = 0; i < ret; i++) {
+            if (msgs[i].msg_len != txInfo[sent + i].length) {
+                cerr << "Error : " << msgs[i].msg_len << " bytes sent." << endl;
+                __sync_fetch_and_add(&sStat.txErrors, 1);
+            }
+        }
+        sent += ret;
+    }
+
+    __sync_fetch_and_add(&sStat.txPackets, sent);
+    return (sent > 0 || num == 0) ? sent : -1;
+}
+
+void v2x_get_stat(V2xStat *stat)
+{
+    *stat = sStat;
+}
@@ -0,0 +1,32 @@
+#ifndef YX_V2X_SOCK_H
+#define YX_V2X_SOCK_H
+
+#include "v2x.hpp"
+
+/*
+ * Socket layer of the yx V2X shim, independent of the telux radio objects.
+ *
+ * Rx: packets are received with recvmmsg straight into a fixed ring of
+ * V2X_RX_BUF_NUM pre-allocated buffers and handed to the callback without
+ * copying. A callback returning V2X_RX_HOLD keeps the buffer until
+ * yx_V2xRxRelease() is called; any other return value gives the buffer back
+ * as soon as the callback returns. The rx thread blocks in poll() and, when
+ * every buffer is held, waits for a release instead of reading the socket.
+ *
+ * Tx: sendmmsg with a per-packet IPV6_TCLASS, up to V2X_TX_BATCH_MAX packets
+ * per system call.
+ */
+
+#define V2X_RX_BUF_NUM      64u
+#define V2X_RX_BUF_LEN      3000u
+#define V2X_RX_BATCH        16u
+#define V2X_TX_BATCH_MAX    32u
+
+int  v2x_rx_start(int sock);
+void v2x_rx_stop(void);
+void v2x_rx_set_callback(V2xRecvCallback callback);
+int  v2x_rx_release(const unsigned char *data);
+int  v2x_tx_send(int sock, V2xTxData *txInfo, int num, int priority);
+void v2x_get_stat(V2xStat *stat);
+
+#endif
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_loop_drv.h"
+#include "yx_chksum.h"
+#include "yx_string.h"
+#include "yx_sl_parser.h"
+#include "bench_peer.h"
+
+#define BENCH_PEER_FRAME_MAX    2048
+
+typedef struct {
+    BOOLEAN used;
+    INT8U   seq;
+    INT16U  cmd;
+    int     len;
+    INT8U   data[BENCH_PEER_FRAME_MAX];
+} bench_peer_slot_t;
+
+static int      sgPeerFd;
+static int      sgPeerWin;
+static INT8U    sgPeerCrcCap = YX_SERIAL_LINK_CRC_CAP;
+static bench_peer_rx_fun pPeerRx;
+static volatile BOOLEAN sgConnected;
+static INT8U    sgWin;                                                          /* Э̽ */
+static INT8U    sgCrc = YX_SL_CRC_XOR;
+static INT32U   sgCrcErr;
+static INT8U    sgRxNext;
+static bench_peer_slot_t sgSlot[YX_SERIAL_LINK_WIN_MAX];
+static pthread_mutex_t sgPeerMutex = PTHREAD_MUTEX_INITIALIZER;
+
+INT32U bench_time_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT32U)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void bench_peer_send_raw(INT16U cmd, const INT8U* pdata, int len)
+{
+    INT8U buf[BENCH_PEER_FRAME_MAX + YX_SL_CRC_LEN_MAX];
+    yx_sl_item_t* pItem = (yx_sl_item_t*)buf;
+
+    pItem->Head.head[0]  = YX_SERIAL_LINK_HEAD_UP_1;
+    pItem->Head.head[1]  = YX_SERIAL_LINK_HEAD_UP_2;
+    pItem->Head.dev_type = 0x18;
+    pItem->Head.cmd_h    = (cmd >> 8) & 0xFF;
+    pItem->Head.cmd_l    = cmd & 0xFF;
+    if (len > 0) {
+        memcpy(pItem->Data, pdata, len);
+    }
+    send(sgPeerFd, buf, yx_sl_frame_seal(buf, len, sgCrc), 0);
+}
+
+static void bench_peer_req(void)
+{
+    INT8U req[4];
+
+    req[0] = 5;
+    req[1] = sgPeerWin;
+    req[2] = 0x5A;
+    req[3] = sgPeerCrcCap;
+    bench_peer_send_raw(YX_SERIAL_LINK_REQ_CMD, req, sgPeerCrcCap != 0 ? 4 : (sgPeerWin != 0 ? 3 : 1));
+}
+
+/* У·㷢֡, Ӧ𲻴 CRC */
+static BOOLEAN bench_peer_check(yx_sl_item_t* pItem, int size, int len, INT16U cmd)
+{
+    INT8U* pCrc = pItem->Data + size;
+    INT8U crc_mode = (cmd == YX_SERIAL_LINK_REQ_CMD) ? YX_SL_CRC_XOR : sgCrc;
+
+    switch (crc_mode) {
+    case YX_SL_CRC_16:
+        return size + (int)sizeof(yx_sl_head_t) + 2 <= len
+               && yx_chksum_crc16(YX_CRC16_INIT, &pItem->Head.dev_type, size + 5) == yx_str_char2short_msb(pCrc);
+    case YX_SL_CRC_32:
+        return size + (int)sizeof(yx_sl_head_t) + 4 <= len
+               && yx_chksum_crc32(0, &pItem->Head.dev_type, size + 5) == yx_str_char2long_msb(pCrc);
+    default:
+        return size + (int)sizeof(yx_sl_head_t) <= len
+               && pItem->Head.crc == yx_chksum_getxor(&pItem->Head.cmd_h, size + 4);
+    }
+}
+
+/* ǰȷϢ: ۼȷ + ѻ֡ SACK λͼ */
+static void bench_peer_win_fill(yx_sl_win_t* pWin)
+{
+    INT16U sack = 0;
+    INT8U i, s;
+
+    for (i = 0; i < YX_SL_SACK_BITS; i++) {
+        s = sgRxNext + 1 + i;
+        if (sgSlot[s % YX_SERIAL_LINK_WIN_MAX].used && sgSlot[s % YX_SERIAL_LINK_WIN_MAX].seq == s) {
+            sack |= (1 << i);
+        }
+    }
+    pWin->flags  = 0;
+    pWin->seq    = 0;
+    pWin->ack    = sgRxNext;
+    pWin->sack_h = (sack >> 8) & 0xFF;
+    pWin->sack_l = sack & 0xFF;
+}
+
+static void bench_peer_ack(void)
+{
+    yx_sl_win_t win;
+
+    pthread_mutex_lock(&sgPeerMutex);
+    bench_peer_win_fill(&win);
+    pthread_mutex_unlock(&sgPeerMutex);
+    bench_peer_send_raw(YX_SERIAL_LINK_WACK_CMD, (INT8U*)&win, sizeof(win));
+}
+
+static void bench_peer_frame(INT8U* buf, int len)
+{
+    yx_sl_item_t* pItem = (yx_sl_item_t*)buf;
+    yx_sl_win_t win;
+    bench_peer_slot_t* pSlot;
+    INT16U cmd;
+    int size;
+    INT8U d;
+
+    if (len < (int)sizeof(yx_sl_head_t)) {
+        return;
+    }
+    cmd  = (pItem->Head.cmd_h << 8) | pItem->Head.cmd_l;
+    size = (pItem->Head.len_h << 8) | pItem->Head.len_l;
+    if (!bench_peer_check(pItem, size, len, cmd)) {
+        sgCrcErr++;
+        return;
+    }
+
+    if (cmd == YX_SERIAL_LINK_REQ_CMD) {
+        if (size >= 1 && pItem->Data[0] == 0x01) {                               /* Ӧ */
+            sgWin = (size >= 4) ? pItem->Data[1] : 0;
+            sgCrc = (size >= 5) ? pItem->Data[4] : YX_SL_CRC_XOR;
+            sgConnected = TRUE;
+        }
+        return;
+    }
+    if (cmd == YX_SERIAL_LINK_BEAT_CMD || cmd == YX_SERIAL_LINK_WACK_CMD) {
+        return;
+    }
+
+    if (sgWin == 0) {                                                           /* Э: ͬȷ */
+        pPeerRx(cmd, pItem->Data, size);
+        bench_peer_send_raw(cmd, NULL, 0);
+        return;
+    }
+
+    if (size < (int)sizeof(yx_sl_win_t)) {
+        return;
+    }
+    memcpy(&win, pItem->Data, sizeof(win));
+    if (!(win.flags & YX_SL_WIN_FLAG_SEQ)) {                                    /* ȷϵֱ֡Ͻ */
+        pPeerRx(cmd, pItem->Data + sizeof(win), size - sizeof(win));
+        return;
+    }
+
+    pthread_mutex_lock(&sgPeerMutex);
+    d = win.seq - sgRxNext;
+    if (d == 0) {
+        sgRxNext++;
+        pthread_mutex_unlock(&sgPeerMutex);
+        pPeerRx(cmd, pItem->Data + sizeof(win), size - sizeof(win));
+        pthread_mutex_lock(&sgPeerMutex);
+        for (;;) {
+            pSlot = &sgSlot[sgRxNext % YX_SERIAL_LINK_WIN_MAX];
+            if (!pSlot->used || pSlot->seq != sgRxNext) {
+                break;
+            }
+            pSlot->used = FALSE;
+            sgRxNext++;
+            pthread_mutex_unlock(&sgPeerMutex);
+            pPeerRx(pSlot->cmd, pSlot->data, pSlot->len);
+            pthread_mutex_lock(&sgPeerMutex);
+        }
+    } else if (d < sgWin) {
+        pSlot = &sgSlot[win.seq % YX_SERIAL_LINK_WIN_MAX];
+        pSlot->used = TRUE;
+        pSlot->seq  = win.seq;
+        pSlot->cmd  = cmd;
+        pSlot->len  = size - sizeof(win);
+        memcpy(pSlot->data, pItem->Data + sizeof(win), pSlot->len);
+    }
+    pthread_mutex_unlock(&sgPeerMutex);
+}
+
+static void* bench_peer_thread(void* arg)
+{
+    INT8U buf[BENCH_PEER_FRAME_MAX + YX_SL_CRC_LEN_MAX];
+    INT32U last_req = 0;
+    BOOLEAN got;
+    int len;
+
+    while (1) {
+        if (!sgConnected && bench_time_ms() - last_req >= 200) {
+            bench_peer_req();
+            last_req = bench_time_ms();
+        }
+
+        got = FALSE;
+        while ((len = recv(sgPeerFd, buf, sizeof(buf), (got || !sgConnected) ? MSG_DONTWAIT : 0)) > 0) {
+            bench_peer_frame(buf, len);
+            got = TRUE;
+        }
+        if (!got && !sgConnected) {
+            usleep(1000);
+        }
+        if (got && sgConnected && sgWin != 0) {
+            bench_peer_ack();
+        }
+    }
+    return NULL;
+}
+
+void bench_peer_start(int win, bench_peer_rx_fun rx)
+{
+    pthread_t pid;
+
+    sgPeerWin = win;
+    pPeerRx   = rx;
+    sgPeerFd  = yx_loop_drv_peer_fd();
+    pthread_create(&pid, NULL, bench_peer_thread, NULL);
+    while (!sgConnected) {
+        usleep(1000);
+    }
+    usleep(20000);
+}
+
+INT8U bench_peer_win(void)
+{
+    return sgWin;
+}
+
+void bench_peer_set_crc_cap(INT8U cap)
+{
+    sgPeerCrcCap = cap;
+}
+
+INT8U bench_peer_crc(void)
+{
+    return sgCrc;
+}
+
+INT32U bench_peer_crc_err(void)
+{
+    return sgCrcErr;
+}
+
+void bench_peer_send(INT16U cmd, const INT8U* pdata, int len)
+{
+    INT8U buf[BENCH_PEER_FRAME_MAX];
+    yx_sl_win_t win;
+
+    if (sgWin == 0) {
+        bench_peer_send_raw(cmd, pdata, len);
+        return;
+    }
+    pthread_mutex_lock(&sgPeerMutex);
+    bench_peer_win_fill(&win);
+    pthread_mutex_unlock(&sgPeerMutex);
+    memcpy(buf, &win, sizeof(win));
+    memcpy(buf + sizeof(win), pdata, len);
+    bench_peer_send_raw(cmd, buf, len + sizeof(win));
+}
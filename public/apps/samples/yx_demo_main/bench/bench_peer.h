@@ -0,0 +1,29 @@
+#ifndef _BENCH_PEER_H_
+#define _BENCH_PEER_H_
+#include "def.h"
+
+/*
+ * ԳõĶԶ(MCU)ģ,  yx_loop_drv ĶԶ socket .
+ * Э̴ڼУ鷽ʽ, Ͻ֡, ÿպϲһȷ; Ϊ 0 ʱЭͬȷ.
+ */
+typedef void (*bench_peer_rx_fun)(INT16U cmd, const INT8U* pdata, int len);
+
+/* win: ԶṩĴ, 0 ΪЭ; ӽ󷵻 */
+void bench_peer_start(int win, bench_peer_rx_fun rx);
+
+/* Э̺Ĵ */
+INT8U bench_peer_win(void);
+
+/* Զֵ֧У鷽ʽλͼ YX_SL_CRC_CAP_xxx, 0 ΪЭֽڵľɰ汾;  bench_peer_start ǰ */
+void bench_peer_set_crc_cap(INT8U cap);
+
+/* Э̺У鷽ʽ, ԶյУ֡ */
+INT8U bench_peer_crc(void);
+INT32U bench_peer_crc_err(void);
+
+/* ·㷢֡, ģʽ²(ȷ), ǰȷϢ */
+void bench_peer_send(INT16U cmd, const INT8U* pdata, int len);
+
+INT32U bench_time_ms(void);
+
+#endif
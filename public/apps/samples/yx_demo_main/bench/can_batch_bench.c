@@ -0,0 +1,209 @@
+/*
+ * CAN ϲͻػ/ʱӲ
+ * ·ʹ yx_loop_drv ػ, Զ bench_peer ģ MCU, յ CAN ֡ԭԽ.
+ * ÿ֡Яźͷʱ, ջصУ ID/ͨ/ݲͳƵ MCU ʱ.
+ * ÷: can_batch_bench [-n ֡] [-r ֡/s, 0 Ϊ] [-k ͻ֡] [-b ϲȴms, 0 ϲ] [-m ϲ֡] [-d ʱms] [-w Զ˴]
+ *                       [-i ֱ֡߳ӷַ]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_loop_drv.h"
+#include "yx_can.h"
+#include "bench_peer.h"
+
+#define BENCH_CAN_SEND_CMD      0x0031                                          /*  yx_can.c һ */
+#define BENCH_CAN_REC_CMD       0x0030
+#define BENCH_URGENT_ID         0x7DF                                           /* , ߽ͨ */
+#define BENCH_URGENT_EVERY      32
+#define BENCH_TIMEOUT_MS        60000
+
+/* MCU ࿴ĵ֡¼ʽ */
+typedef struct {
+    INT8U ch;
+    INT8U id[4];
+    INT8U format;
+    INT8U type;
+    INT8U len;
+    INT8U data[8];
+} bench_can_rec_t;
+
+static int      sgFrames   = 20000;
+static int      sgRate     = 0;
+static int      sgBurst    = 16;
+static int      sgHoldoff  = 0;
+static int      sgMaxFrame = CAN_BATCH_FRAME_MAX;
+static int      sgDelay    = 1;
+static int      sgPeerWin  = YX_SERIAL_LINK_WIN_MAX;
+static BOOLEAN  sgRxDirect = FALSE;
+
+static INT8U*   sgSeen;
+static INT32U*  sgOneWay;                                                       /*  MCU, us */
+static INT32U*  sgRoundTrip;                                                    /* ص, us */
+static INT32U*  sgUrgentRtt;
+static volatile int sgMcuFrames;
+static volatile int sgDelivered;
+static int      sgUrgentNum;
+static int      sgErrors;
+static int      sgLinkMsgs;
+
+static INT32U bench_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT32U)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static INT32U bench_can_id(INT32U index)
+{
+    return (index % BENCH_URGENT_EVERY == BENCH_URGENT_EVERY - 1) ? BENCH_URGENT_ID : 0x100 + index % 64;
+}
+
+/* MCU: ͳƵʱ, ԭ */
+static void bench_mcu_rx(INT16U cmd, const INT8U* pdata, int len)
+{
+    const bench_can_rec_t* pRec = (const bench_can_rec_t*)pdata;
+    INT32U index, stamp;
+    int i, num;
+
+    if (cmd != BENCH_CAN_SEND_CMD) {
+        return;
+    }
+    sgLinkMsgs++;
+    num = len / sizeof(bench_can_rec_t);
+    for (i = 0; i < num; i++) {
+        memcpy(&index, pRec[i].data, 4);
+        memcpy(&stamp, pRec[i].data + 4, 4);
+        if (index < (INT32U)sgFrames && sgMcuFrames < sgFrames) {
+            sgOneWay[sgMcuFrames++] = bench_time_us() - stamp;
+        }
+    }
+    bench_peer_send(BENCH_CAN_REC_CMD, pdata, num * sizeof(bench_can_rec_t));
+}
+
+static void bench_host_rx(YX_CAN_RX_T* pData)
+{
+    INT32U index, stamp, rtt;
+
+    memcpy(&index, pData->Data, 4);
+    memcpy(&stamp, pData->Data + 4, 4);
+    if (index >= (INT32U)sgFrames || sgSeen[index]) {
+        sgErrors++;
+        return;
+    }
+    if (pData->CanId != bench_can_id(index) || pData->ch != CAN_CHANNEL_1 + index % 2
+        || pData->Format != CAN_FORMAT_STD || pData->Len != 8) {
+        sgErrors++;
+        return;
+    }
+    sgSeen[index] = 1;
+    rtt = bench_time_us() - stamp;
+    sgRoundTrip[sgDelivered++] = rtt;
+    if (pData->CanId == BENCH_URGENT_ID) {
+        sgUrgentRtt[sgUrgentNum++] = rtt;
+    }
+}
+
+static int bench_cmp(const void* a, const void* b)
+{
+    INT32U x = *(const INT32U*)a, y = *(const INT32U*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_report(const char* name, INT32U* lat, int num)
+{
+    long long sum = 0;
+    int i;
+
+    if (num == 0) {
+        return;
+    }
+    qsort(lat, num, sizeof(INT32U), bench_cmp);
+    for (i = 0; i < num; i++) {
+        sum += lat[i];
+    }
+    printf("%-12s: avg %.0f p50 %u p99 %u max %u us\n", name, (double)sum / num,
+           lat[num / 2], lat[(num * 99) / 100], lat[num - 1]);
+}
+
+int main(int argc, char** argv)
+{
+    INT8U data[8];
+    yx_sl_cmd_stat_t cmdstat;
+    INT32U start, elapsed, stamp, gap_us;
+    int i, opt;
+
+    while ((opt = getopt(argc, argv, "n:r:k:b:m:d:w:i")) != -1) {
+        switch (opt) {
+        case 'n': sgFrames   = atoi(optarg); break;
+        case 'r': sgRate     = atoi(optarg); break;
+        case 'k': sgBurst    = atoi(optarg); break;
+        case 'b': sgHoldoff  = atoi(optarg); break;
+        case 'm': sgMaxFrame = atoi(optarg); break;
+        case 'd': sgDelay    = atoi(optarg); break;
+        case 'w': sgPeerWin  = atoi(optarg); break;
+        case 'i': sgRxDirect = TRUE; break;
+        default:
+            printf("usage: %s [-n frames] [-r frames/s] [-k burst] [-b holdoff ms] [-m batch frames] [-d delay ms] [-w peer window] [-i]\n", argv[0]);
+            return -1;
+        }
+    }
+    sgBurst = YX_MAX(sgBurst, 1);
+
+    sgSeen      = (INT8U*)calloc(1, sgFrames);
+    sgOneWay    = (INT32U*)calloc(sgFrames, sizeof(INT32U));
+    sgRoundTrip = (INT32U*)calloc(sgFrames, sizeof(INT32U));
+    sgUrgentRtt = (INT32U*)calloc(sgFrames, sizeof(INT32U));
+
+    Yx_Serial_Link_SetRxDirect(sgRxDirect);
+    Yx_Serial_Link_Init();
+    Yx_Can_Init();
+    Yx_Can_RegisterRxCallBack(bench_host_rx);
+    Yx_Serial_Link_Start();
+    yx_loop_drv_set_fault(0, sgDelay);
+    bench_peer_start(sgPeerWin, bench_mcu_rx);
+
+    if (sgHoldoff > 0) {
+        Yx_Can_SetBatch(CAN_CHANNEL_1, sgHoldoff, sgMaxFrame);
+        Yx_Can_SetBatch(CAN_CHANNEL_2, sgHoldoff, sgMaxFrame);
+        Yx_Can_AddUrgentId(CAN_CHANNEL_1, BENCH_URGENT_ID, 0xFFFFFFFF);
+        Yx_Can_AddUrgentId(CAN_CHANNEL_2, BENCH_URGENT_ID, 0xFFFFFFFF);
+    }
+
+    gap_us = sgRate > 0 ? (INT32U)((long long)sgBurst * 1000000 / sgRate) : 0;
+    start = bench_time_ms();
+    for (i = 0; i < sgFrames; i++) {
+        if (gap_us > 0 && i > 0 && i % sgBurst == 0) {
+            usleep(gap_us);
+        }
+        stamp = bench_time_us();
+        memcpy(data, &i, 4);
+        memcpy(data + 4, &stamp, 4);
+        Yx_Can_Send(CAN_CHANNEL_1 + i % 2, CAN_FORMAT_STD, CAN_FRAME_TYPE_DATA, bench_can_id(i), data, 8);
+    }
+    while (sgDelivered < sgFrames && bench_time_ms() - start < BENCH_TIMEOUT_MS) {
+        usleep(1000);
+    }
+    elapsed = YX_MAX(bench_time_ms() - start, 1);
+
+    printf("\nbatch       : %s (holdoff %d ms, %d frames), rate %d frames/s, burst %d, delay %d ms\n",
+           sgHoldoff > 0 ? "on" : "off", sgHoldoff, sgMaxFrame, sgRate, sgBurst, sgDelay);
+    printf("rx dispatch : %s\n", sgRxDirect ? "driver thread" : "link thread via msg queue");
+    printf("delivered   : %d/%d CAN frames in %u ms, %.0f frames/s, %d errors\n",
+           sgDelivered, sgFrames, elapsed, sgDelivered * 1000.0 / elapsed, sgErrors);
+    printf("link msgs   : %d to MCU, %.1f CAN frames per msg\n", sgLinkMsgs, sgLinkMsgs ? (double)sgMcuFrames / sgLinkMsgs : 0.0);
+    bench_report("to MCU", sgOneWay, sgMcuFrames);
+    bench_report("round trip", sgRoundTrip, sgDelivered);
+    bench_report("urgent rtt", sgUrgentRtt, sgUrgentNum);
+    if (Yx_Serial_Link_GetCmdStat(BENCH_CAN_REC_CMD, &cmdstat) && cmdstat.count > 0) {
+        printf("rx handler  : %u frames %llu bytes, avg %.0f max %u ns\n", cmdstat.count, cmdstat.bytes,
+               (double)cmdstat.time_ns / cmdstat.count, cmdstat.time_max_ns);
+    }
+
+    return (sgDelivered == sgFrames && sgErrors == 0) ? 0 : 1;
+}
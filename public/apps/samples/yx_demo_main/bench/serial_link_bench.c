@@ -0,0 +1,138 @@
+/*
+ * ·/ʱӲ
+ * ·ʹ yx_loop_drv ػ, Զ bench_peer ģ MCU.
+ * ÷: serial_link_bench [-n ֡] [-s ݳ] [-l %] [-d ʱms] [-w Զ˴, 0 ΪЭ]
+ *                          [-W ˴ Yx_Serial_Link_SetWindow, 0 ΪЭ]
+ *                          [-c ԶУ YX_SL_CRC_CAP_xxx, 0 ΪУ]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_loop_drv.h"
+#include "bench_peer.h"
+
+#define BENCH_CMD           0x0100
+#define BENCH_TIMEOUT_MS    120000
+
+typedef struct {
+    INT32U  stamp_ms;
+    INT32U  index;
+} bench_payload_t;
+
+static int      sgFrames     = 2000;
+static int      sgSize       = 64;
+static int      sgLoss       = 0;
+static int      sgDelay      = 2;
+static int      sgPeerWin    = YX_SERIAL_LINK_WIN_MAX;
+static int      sgLocalWin   = YX_SERIAL_LINK_WIN_MAX;
+static int      sgPeerCrcCap = YX_SERIAL_LINK_CRC_CAP;
+
+static INT8U*   sgSeen;
+static INT32U*  sgLatency;
+static volatile int sgDelivered;
+static long long sgBytes;
+
+static void bench_deliver(INT16U cmd, const INT8U* pdata, int len)
+{
+    bench_payload_t pl;
+
+    if (cmd != BENCH_CMD || len < (int)sizeof(pl)) {
+        return;
+    }
+    memcpy(&pl, pdata, sizeof(pl));
+    if (pl.index >= (INT32U)sgFrames || sgSeen[pl.index]) {
+        return;
+    }
+    sgSeen[pl.index] = 1;
+    sgLatency[sgDelivered] = bench_time_ms() - pl.stamp_ms;
+    sgBytes += sgSize;
+    sgDelivered++;
+}
+
+static int bench_cmp(const void* a, const void* b)
+{
+    INT32U x = *(const INT32U*)a, y = *(const INT32U*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv)
+{
+    INT8U* payload;
+    bench_payload_t pl;
+    yx_sl_stat_t stat;
+    INT32U start, elapsed;
+    long long sum = 0;
+    int i, opt;
+
+    while ((opt = getopt(argc, argv, "n:s:l:d:w:W:c:")) != -1) {
+        switch (opt) {
+        case 'n': sgFrames  = atoi(optarg); break;
+        case 's': sgSize    = atoi(optarg); break;
+        case 'l': sgLoss    = atoi(optarg); break;
+        case 'd': sgDelay   = atoi(optarg); break;
+        case 'w': sgPeerWin = atoi(optarg); break;
+        case 'W': sgLocalWin = atoi(optarg); break;
+        case 'c': sgPeerCrcCap = atoi(optarg); break;
+        default:
+            printf("usage: %s [-n frames] [-s size] [-l loss%%] [-d delay ms] [-w peer window] [-W local window] [-c peer crc cap]\n", argv[0]);
+            return -1;
+        }
+    }
+    sgSize = YX_MAX(sgSize, (int)sizeof(bench_payload_t));
+    sgSize = YX_MIN(sgSize, YX_SERIAL_LINK_TX_LEN_MAX);
+
+    payload   = (INT8U*)calloc(1, sgSize);
+    sgSeen    = (INT8U*)calloc(1, sgFrames);
+    sgLatency = (INT32U*)calloc(sgFrames, sizeof(INT32U));
+
+    Yx_Serial_Link_SetWindow(sgLocalWin);
+    Yx_Serial_Link_Init();
+    Yx_Serial_Link_Start();
+    yx_loop_drv_set_fault(sgLoss, sgDelay);
+    bench_peer_set_crc_cap(sgPeerCrcCap);
+    bench_peer_start(sgPeerWin, bench_deliver);
+
+    start = bench_time_ms();
+    for (i = 0; i < sgFrames; i++) {
+        pl.stamp_ms = bench_time_ms();
+        pl.index    = i;
+        memcpy(payload, &pl, sizeof(pl));
+        while (Yx_Serial_Link_Send2List(TRUE, BENCH_CMD, payload, sgSize) != SUCC) {
+            if (bench_time_ms() - start > BENCH_TIMEOUT_MS) {
+                break;
+            }
+            usleep(200);
+            pl.stamp_ms = bench_time_ms();
+            memcpy(payload, &pl, sizeof(pl));
+        }
+    }
+    while (sgDelivered < sgFrames && bench_time_ms() - start < BENCH_TIMEOUT_MS) {
+        usleep(1000);
+    }
+    elapsed = YX_MAX(bench_time_ms() - start, 1);
+
+    Yx_Serial_Link_GetStat(&stat);
+    qsort(sgLatency, sgDelivered, sizeof(INT32U), bench_cmp);
+    for (i = 0; i < sgDelivered; i++) {
+        sum += sgLatency[i];
+    }
+
+    printf("\nmode        : %s (window %d), %s\n", stat.win_size ? "sliding window" : "legacy", stat.win_size,
+           stat.crc_mode == YX_SL_CRC_32 ? "crc32" : (stat.crc_mode == YX_SL_CRC_16 ? "crc16" : "xor"));
+    printf("loss/delay  : %d%% / %d ms\n", sgLoss, sgDelay);
+    printf("delivered   : %d/%d frames of %d bytes in %u ms\n", sgDelivered, sgFrames, sgSize, elapsed);
+    printf("throughput  : %.1f frames/s, %.1f KB/s\n",
+           sgDelivered * 1000.0 / elapsed, sgBytes * 1000.0 / 1024 / elapsed);
+    if (sgDelivered > 0) {
+        printf("latency ms  : avg %.1f p50 %u p99 %u max %u\n", (double)sum / sgDelivered,
+               sgLatency[sgDelivered / 2], sgLatency[(sgDelivered * 99) / 100], sgLatency[sgDelivered - 1]);
+    }
+    printf("link        : tx %u retrans %u srtt %u ms rto %u ms\n",
+           stat.tx_frames, stat.retrans, stat.srtt_ms, stat.rto_ms);
+    printf("crc errors  : link %u peer %u\n", stat.rx_crc_err, bench_peer_crc_err());
+
+    return sgDelivered == sgFrames ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+/*
+ * ·շַԼַʱӲ
+ * 1. ܼ: ע/ص//ҳ/ͳ, ʧʱӡ FAIL ط 0;
+ * 2. ַʱ: ע N ַֺ, ԱԭԲֱ(/ʱͳ);
+ * 3. ת: ߳̾ SysV Ϣת·̷ַ߳, ֱ߳ӷַʱӶԱ.
+ * ÷: sl_dispatch_bench [-n ע] [-f ַ֡] [-q ת]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_sl_dispatch.h"
+
+#define BENCH_CHECK(cond) do {                                                  \
+        if (!(cond)) {                                                          \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);               \
+            sgFails++;                                                          \
+        }                                                                       \
+    } while (0)
+
+static int      sgCmds   = 64;
+static int      sgFrames = 4000000;
+static int      sgQueueMsgs = 20000;
+static int      sgFails;
+
+static yx_sl_dispatch_t sgDispatch;
+static volatile INT32U sgSink;
+static INT16U   sgLastCmd;
+static INT32U   sgLastLen;
+
+static INT64U bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT64U)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_make_frame(INT8U* frame, INT16U cmd)
+{
+    memset(frame, 0, sizeof(yx_sl_head_t));
+    frame[0] = YX_SERIAL_LINK_HEAD_UP_1;
+    frame[1] = YX_SERIAL_LINK_HEAD_UP_2;
+    ((yx_sl_head_t*)frame)->cmd_h = cmd >> 8;
+    ((yx_sl_head_t*)frame)->cmd_l = cmd & 0xFF;
+}
+
+static void bench_handler_a(const INT8U* pdata, INT32U len)
+{
+    sgLastCmd = (((yx_sl_head_t*)pdata)->cmd_h << 8) | ((yx_sl_head_t*)pdata)->cmd_l;
+    sgLastLen = len;
+}
+
+static void bench_handler_b(const INT8U* pdata, INT32U len)
+{
+    sgLastCmd = ~((((yx_sl_head_t*)pdata)->cmd_h << 8) | ((yx_sl_head_t*)pdata)->cmd_l);
+    sgLastLen = len;
+}
+
+static void bench_handler_slow(const INT8U* pdata, INT32U len)
+{
+    INT64U start = bench_now_ns();
+
+    while (bench_now_ns() - start < 200000) {
+    }
+}
+
+static void bench_handler_sink(const INT8U* pdata, INT32U len)
+{
+    sgSink += pdata[5] + len;
+}
+
+/*******************************************************************************
+** ܼ
+******************************************************************************/
+static void bench_check(void)
+{
+    yx_sl_dispatch_t* d = &sgDispatch;
+    yx_sl_cmd_stat_t stat;
+    INT64U time_ns;
+    INT8U frame[16];
+    int i;
+
+    yx_sl_dispatch_init(d);
+    bench_make_frame(frame, 0x0100);
+    BENCH_CHECK(!yx_sl_dispatch_frame(d, frame, sizeof(frame)));               /* ձ */
+    BENCH_CHECK(d->miss == 1);
+    BENCH_CHECK(!yx_sl_dispatch_get_stat(d, 0x0100, &stat));
+
+    BENCH_CHECK(yx_sl_dispatch_register(d, 0x0100, 0x0100, bench_handler_a));
+    BENCH_CHECK(yx_sl_dispatch_register(d, 0x01F0, 0x0210, bench_handler_b));  /* ҳΧ */
+    BENCH_CHECK(d->cmds == 1 + 0x21 && d->pages == 2);
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x0100, 0x0100, bench_handler_b)); /* ص */
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x0200, 0x0300, bench_handler_b)); /* ص,  */
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x0310, 0x0300, bench_handler_b)); /* Χߵ */
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x0400, 0x0400, NULL));
+    BENCH_CHECK(d->cmds == 1 + 0x21 && d->pages == 2);
+    BENCH_CHECK(!yx_sl_dispatch_get_stat(d, 0x0211, &stat));
+    BENCH_CHECK(!yx_sl_dispatch_get_stat(d, 0x0300, &stat));
+
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 12));
+    BENCH_CHECK(sgLastCmd == 0x0100 && sgLastLen == 12);
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 20));
+    bench_make_frame(frame, 0x0205);
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 9));
+    BENCH_CHECK(sgLastCmd == (INT16U)~0x0205 && sgLastLen == 9);
+    bench_make_frame(frame, 0x00FF);
+    BENCH_CHECK(!yx_sl_dispatch_frame(d, frame, 9));
+    bench_make_frame(frame, 0x0211);
+    BENCH_CHECK(!yx_sl_dispatch_frame(d, frame, 9));
+    BENCH_CHECK(d->miss == 3);
+
+    BENCH_CHECK(yx_sl_dispatch_get_stat(d, 0x0100, &stat));
+    BENCH_CHECK(stat.count == 2 && stat.bytes == 32);
+    BENCH_CHECK(yx_sl_dispatch_get_stat(d, 0x0205, &stat));
+    BENCH_CHECK(stat.count == 1 && stat.bytes == 9);
+    BENCH_CHECK(yx_sl_dispatch_get_stat(d, 0x0206, &stat));                    /* ͬһΧڸֵͳ */
+    BENCH_CHECK(stat.count == 0 && stat.bytes == 0);
+
+    BENCH_CHECK(yx_sl_dispatch_register(d, 0x0500, 0x0500, bench_handler_slow));
+    bench_make_frame(frame, 0x0500);
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 8));
+    BENCH_CHECK(yx_sl_dispatch_get_stat(d, 0x0500, &stat));
+    BENCH_CHECK(stat.time_ns >= 200000 && stat.time_max_ns >= 200000 && stat.time_max_ns <= stat.time_ns);
+    time_ns = stat.time_ns;
+    yx_sl_dispatch_set_timing(d, FALSE);                                        /* رպֻ֡/ֽ */
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 8));
+    BENCH_CHECK(yx_sl_dispatch_get_stat(d, 0x0500, &stat));
+    BENCH_CHECK(stat.count == 2 && stat.bytes == 16 && stat.time_ns == time_ns);
+
+    yx_sl_dispatch_init(d);                                                     /* ҳ */
+    for (i = 0; i < YX_SL_DISPATCH_PAGE_MAX; i++) {
+        BENCH_CHECK(yx_sl_dispatch_register(d, i << 8, i << 8, bench_handler_a));
+    }
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0xFF00, 0xFF00, bench_handler_a));
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x0001, 0x0101, bench_handler_a));  /* 0x0100 ע */
+    BENCH_CHECK(yx_sl_dispatch_register(d, 0x0001, 0x0010, bench_handler_a));   /* ҳڲռҳ */
+
+    yx_sl_dispatch_init(d);                                                     /*  */
+    BENCH_CHECK(yx_sl_dispatch_register(d, 0x1000, 0x1000 + YX_SL_DISPATCH_CMD_MAX - 2, bench_handler_a));
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x2000, 0x2001, bench_handler_a));
+    BENCH_CHECK(yx_sl_dispatch_register(d, 0x2000, 0x2000, bench_handler_b));
+    BENCH_CHECK(d->cmds == YX_SL_DISPATCH_CMD_MAX);
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x3000, 0x3000, bench_handler_a));
+    BENCH_CHECK(!yx_sl_dispatch_register(d, 0x0000, 0xFFFF, bench_handler_a));
+    bench_make_frame(frame, 0x2000);
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 8) && sgLastCmd == (INT16U)~0x2000);
+    bench_make_frame(frame, 0x1000 + YX_SL_DISPATCH_CMD_MAX - 2);
+    BENCH_CHECK(yx_sl_dispatch_frame(d, frame, 8) && sgLastCmd == 0x1000 + YX_SL_DISPATCH_CMD_MAX - 2);
+
+    printf("dispatch checks : %s\n", sgFails == 0 ? "PASS" : "FAIL");
+}
+
+/*******************************************************************************
+** ַʱ: ԭʵȽַΧ
+******************************************************************************/
+typedef struct {
+    INT16U  b_cmd;
+    INT16U  e_cmd;
+    void  (*handler)(const INT8U *, INT32U);
+} bench_rcb_t;
+
+static bench_rcb_t sgRcb[YX_SL_DISPATCH_CMD_MAX];
+static INT32U   sgRegistered;
+
+static void bench_legacy_dispatch(const INT8U* pdata, INT32U len)
+{
+    INT32U i;
+    INT16U cmd = (((yx_sl_head_t*)pdata)->cmd_h << 8) | ((yx_sl_head_t*)pdata)->cmd_l;
+
+    for (i = 0; i < sgRegistered; i++) {
+        if (cmd >= sgRcb[i].b_cmd && cmd <= sgRcb[i].e_cmd) {
+            if (sgRcb[i].handler != NULL) {
+                sgRcb[i].handler(pdata, len);
+            }
+            break;
+        }
+    }
+}
+
+static double bench_dispatch_run(INT8U* frames, int nframe, int mode)
+{
+    INT64U start;
+    int i, n;
+
+    start = bench_now_ns();
+    for (n = 0; n < sgFrames; n += nframe) {
+        for (i = 0; i < nframe; i++) {
+            if (mode == 0) {
+                bench_legacy_dispatch(&frames[i * 8], 8);
+            } else {
+                yx_sl_dispatch_frame(&sgDispatch, &frames[i * 8], 8);
+            }
+        }
+    }
+    return (double)(bench_now_ns() - start) / n;
+}
+
+static void bench_dispatch(void)
+{
+    INT16U cmds[YX_SL_DISPATCH_CMD_MAX];
+    INT8U *uniform, *last;
+    int i, nframe = 4096;
+
+    yx_sl_dispatch_init(&sgDispatch);
+    sgRegistered = 0;
+    for (i = 0; i < sgCmds; i++) {                                              /* ֲַڶֽҳ */
+        cmds[i] = ((1 + i % 8) << 8) | (i / 8);
+        sgRcb[sgRegistered].b_cmd   = cmds[i];
+        sgRcb[sgRegistered].e_cmd   = cmds[i];
+        sgRcb[sgRegistered].handler = bench_handler_sink;
+        sgRegistered++;
+        yx_sl_dispatch_register(&sgDispatch, cmds[i], cmds[i], bench_handler_sink);
+    }
+
+    uniform = (INT8U*)malloc(nframe * 8);
+    last    = (INT8U*)malloc(nframe * 8);
+    for (i = 0; i < nframe; i++) {
+        bench_make_frame(&uniform[i * 8], cmds[rand() % sgCmds]);
+        bench_make_frame(&last[i * 8], cmds[sgCmds - 1]);                      /* ע */
+    }
+
+    printf("\n%d commands registered, %d frames per case, ns per frame\n", sgCmds, sgFrames);
+    printf("%-22s %10s %12s\n", "", "random", "last cmd");
+    printf("%-22s %10.1f %12.1f\n", "linear (legacy)", bench_dispatch_run(uniform, nframe, 0), bench_dispatch_run(last, nframe, 0));
+    yx_sl_dispatch_set_timing(&sgDispatch, FALSE);
+    printf("%-22s %10.1f %12.1f\n", "table", bench_dispatch_run(uniform, nframe, 1), bench_dispatch_run(last, nframe, 1));
+    yx_sl_dispatch_set_timing(&sgDispatch, TRUE);
+    printf("%-22s %10.1f %12.1f\n", "table + handler time", bench_dispatch_run(uniform, nframe, 1), bench_dispatch_run(last, nframe, 1));
+
+    free(uniform);
+    free(last);
+}
+
+/*******************************************************************************
+** תʱ: ֪ͨӿڱ
+******************************************************************************/
+typedef struct {
+    long    type;
+    INT64U  stamp_ns;
+} bench_msg_t;
+
+static int      sgQueue;
+static volatile INT64U sgHandled;
+static INT8U    sgQueueFrame[8];
+static INT32U*  sgHopNs;
+
+static void bench_handler_stamp(const INT8U* pdata, INT32U len)
+{
+    __sync_synchronize();
+    sgHandled = bench_now_ns();
+}
+
+static void* bench_queue_thread(void* arg)
+{
+    bench_msg_t msg;
+
+    while (msgrcv(sgQueue, &msg, sizeof(msg.stamp_ns), 1, 0) >= 0) {
+        if (msg.stamp_ns == 0) {
+            break;
+        }
+        yx_sl_dispatch_frame(&sgDispatch, sgQueueFrame, sizeof(sgQueueFrame));
+    }
+    return NULL;
+}
+
+static int bench_cmp(const void* a, const void* b)
+{
+    INT32U x = *(const INT32U*)a, y = *(const INT32U*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_hop_report(const char* name)
+{
+    double sum = 0;
+    int i;
+
+    qsort(sgHopNs, sgQueueMsgs, sizeof(INT32U), bench_cmp);
+    for (i = 0; i < sgQueueMsgs; i++) {
+        sum += sgHopNs[i];
+    }
+    printf("%-22s avg %8.0f p50 %8u p99 %8u max %8u ns\n", name, sum / sgQueueMsgs,
+           sgHopNs[sgQueueMsgs / 2], sgHopNs[(sgQueueMsgs * 99) / 100], sgHopNs[sgQueueMsgs - 1]);
+}
+
+static void bench_queue_hop(void)
+{
+    pthread_t pid;
+    bench_msg_t msg;
+    INT64U start;
+    int i;
+
+    yx_sl_dispatch_init(&sgDispatch);
+    yx_sl_dispatch_register(&sgDispatch, 0x0100, 0x0100, bench_handler_stamp);
+    bench_make_frame(sgQueueFrame, 0x0100);
+    sgHopNs = (INT32U*)calloc(sgQueueMsgs, sizeof(INT32U));
+
+    sgQueue = msgget(IPC_PRIVATE, IPC_CREAT | 0600);                            /* ˽ж, ·ͻ */
+    if (sgQueue == -1) {
+        printf("msgget error, skip queue hop test\n");
+        return;
+    }
+    pthread_create(&pid, NULL, bench_queue_thread, NULL);
+
+    printf("\nnotice to handler latency, %d frames one at a time\n", sgQueueMsgs);
+    for (i = 0; i < sgQueueMsgs; i++) {
+        sgHandled    = 0;
+        msg.type     = 1;
+        msg.stamp_ns = start = bench_now_ns();
+        msgsnd(sgQueue, &msg, sizeof(msg.stamp_ns), 0);
+        while (sgHandled == 0) {
+        }
+        sgHopNs[i] = (INT32U)YX_MIN(sgHandled - start, 0xFFFFFFFFULL);
+    }
+    bench_hop_report("SysV queue hop");
+
+    for (i = 0; i < sgQueueMsgs; i++) {
+        sgHandled = 0;
+        start = bench_now_ns();
+        yx_sl_dispatch_frame(&sgDispatch, sgQueueFrame, sizeof(sgQueueFrame));
+        sgHopNs[i] = (INT32U)YX_MIN(sgHandled - start, 0xFFFFFFFFULL);
+    }
+    bench_hop_report("in-thread");
+
+    msg.type     = 1;
+    msg.stamp_ns = 0;
+    msgsnd(sgQueue, &msg, sizeof(msg.stamp_ns), 0);
+    pthread_join(pid, NULL);
+    msgctl(sgQueue, IPC_RMID, NULL);
+    free(sgHopNs);
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:q:")) != -1) {
+        switch (opt) {
+        case 'n': sgCmds      = atoi(optarg); break;
+        case 'f': sgFrames    = atoi(optarg); break;
+        case 'q': sgQueueMsgs = atoi(optarg); break;
+        default:
+            printf("usage: %s [-n commands] [-f frames] [-q queue msgs]\n", argv[0]);
+            return -1;
+        }
+    }
+    sgCmds      = YX_MIN(YX_MAX(sgCmds, 1), YX_SL_DISPATCH_CMD_MAX);
+    sgFrames    = YX_MAX(sgFrames, 4096);
+    sgQueueMsgs = YX_MAX(sgQueueMsgs, 1);
+
+    srand(1);
+    bench_check();
+    bench_dispatch();
+    bench_queue_hop();
+    return sgFails == 0 ? 0 : 1;
+}
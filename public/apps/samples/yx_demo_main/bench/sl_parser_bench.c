@@ -0,0 +1,219 @@
+/*
+ * ·֡² (MB/s)
+ * ɺϷ֡ȡȷֶ, ֱ:
+ *   legacy: ԭԻʵ, ֽڲ֡ͷ, ÿν memmove ʣ;
+ *   xor/crc16/crc32: λУ鷽ʽµ.
+ * ÷: sl_parser_bench [-s , 0 Ϊ] [-c ÿζȡֽ] [-g ֽ֡] [-m MB]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_chksum.h"
+#include "yx_string.h"
+#include "yx_sl_parser.h"
+
+#define BENCH_FRAME_MAX     (sizeof(yx_sl_head_t) + sizeof(yx_sl_win_t) + YX_SERIAL_LINK_RX_LEN_MAX)
+#define BENCH_RING_SIZE     4096
+#define BENCH_STREAM_LEN    (4 * 1024 * 1024)
+
+static int      sgSize  = 256;
+static int      sgChunk = 2048;
+static int      sgGap   = 0;
+static int      sgTotalMB = 256;
+
+static INT8U*   sgStream;
+static int      sgStreamLen;
+static int      sgStreamFrames;
+static volatile INT32U sgSink;                                                  /* ֹŻ */
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_build_stream(INT8U crc_mode)
+{
+    yx_sl_item_t* pItem;
+    int i, size;
+
+    sgStreamLen    = 0;
+    sgStreamFrames = 0;
+    while (sgStreamLen + sgGap + BENCH_FRAME_MAX + YX_SL_CRC_LEN_MAX <= BENCH_STREAM_LEN) {
+        for (i = 0; i < sgGap; i++) {
+            sgStream[sgStreamLen++] = rand() & 0xFF;
+        }
+        size  = (sgSize > 0) ? sgSize : rand() % (BENCH_FRAME_MAX - sizeof(yx_sl_head_t) + 1);
+        pItem = (yx_sl_item_t*)&sgStream[sgStreamLen];
+        pItem->Head.head[0]  = YX_SERIAL_LINK_HEAD_UP_1;
+        pItem->Head.head[1]  = YX_SERIAL_LINK_HEAD_UP_2;
+        pItem->Head.dev_type = 0x18;
+        pItem->Head.cmd_h    = 0x01;
+        pItem->Head.cmd_l    = 0x00;
+        for (i = 0; i < size; i++) {
+            pItem->Data[i] = rand() & 0xFF;
+        }
+        sgStreamLen += yx_sl_frame_seal((INT8U*)pItem, size, crc_mode);
+        sgStreamFrames++;
+    }
+}
+
+/* ԭʵ: Ի, ֽڲ֡ͷ, ʣݰᵽͷ */
+static INT8U    sgLegacyBuf[BENCH_FRAME_MAX];
+static int      sgLegacyLen;
+
+static int bench_legacy_findframehead(INT8U *pdata, int datalen)
+{
+    int offset = 0;
+
+    for (offset = 0; offset < datalen - 1; offset++) {
+        if (pdata[offset] == YX_SERIAL_LINK_HEAD_UP_1 && pdata[offset + 1] == YX_SERIAL_LINK_HEAD_UP_2) {
+            return offset;
+        }
+    }
+    if (offset == datalen - 1 && pdata[datalen - 1] == YX_SERIAL_LINK_HEAD_UP_1) {
+        return datalen - 1;
+    }
+    return datalen;
+}
+
+static int bench_legacy_rxrec(INT8U* pbuf, int datalen, int* frames)
+{
+    yx_sl_head_t* pDlHead;
+    int offset = 0, size;
+
+    while (datalen - offset >= (int)sizeof(yx_sl_head_t)) {
+        offset += bench_legacy_findframehead(pbuf + offset, datalen - offset);
+        if (datalen - offset < (int)sizeof(yx_sl_head_t)) {
+            break;
+        }
+        pDlHead = (yx_sl_head_t*)(pbuf + offset);
+        size = (pDlHead->len_h << 8) + pDlHead->len_l;
+        if (datalen - offset >= size + (int)sizeof(yx_sl_head_t)) {
+            if (pDlHead->crc == yx_chksum_getxor(&pDlHead->cmd_h, size + 4)) {
+                sgSink += pDlHead->cmd_l;
+                (*frames)++;
+                offset += size + sizeof(yx_sl_head_t);
+            } else {
+                offset += 2;
+            }
+        } else if (size + sizeof(yx_sl_head_t) > sizeof(sgLegacyBuf)) {
+            offset += 2;
+        } else {
+            break;
+        }
+    }
+    return offset;
+}
+
+static int bench_legacy_feed(const INT8U* pdata, int len)
+{
+    int frames = 0, n, offset;
+
+    while (len > 0) {
+        n = YX_MIN(len, (int)sizeof(sgLegacyBuf) - sgLegacyLen);
+        memcpy(&sgLegacyBuf[sgLegacyLen], pdata, n);                           /* ȡ */
+        pdata += n;
+        len   -= n;
+        sgLegacyLen += n;
+        offset = bench_legacy_rxrec(sgLegacyBuf, sgLegacyLen, &frames);
+        sgLegacyLen -= offset;
+        if (sgLegacyLen != 0) {
+            memmove(sgLegacyBuf, &sgLegacyBuf[offset], sgLegacyLen);
+        }
+    }
+    return frames;
+}
+
+/* λ */
+static yx_sl_parser_t sgParser;
+static INT8U    sgRing[BENCH_RING_SIZE];
+static INT8U    sgFrameBuf[BENCH_FRAME_MAX + YX_SL_CRC_LEN_MAX];
+
+static int bench_parser_feed(const INT8U* pdata, int len)
+{
+    INT8U *pbuf, *frame;
+    INT16U space;
+    int frames = 0, n, flen;
+
+    while (len > 0) {
+        pbuf = yx_roundbuf_put_ptr(&sgParser.ring, &space);
+        n = YX_MIN(len, space);
+        memcpy(pbuf, pdata, n);                                                 /* ȡ */
+        yx_roundbuf_put_commit(&sgParser.ring, n);
+        pdata += n;
+        len   -= n;
+        while ((flen = yx_sl_parser_next(&sgParser, &frame)) > 0) {
+            sgSink += frame[5];
+            frames++;
+        }
+    }
+    return frames;
+}
+
+static void bench_run(const char* name, INT8U crc_mode, BOOLEAN legacy)
+{
+    long long bytes = 0, frames = 0, target = (long long)sgTotalMB * 1024 * 1024;
+    double start, elapsed;
+    int pos;
+
+    bench_build_stream(crc_mode);
+    sgLegacyLen = 0;
+    yx_sl_parser_init(&sgParser, sgRing, BENCH_RING_SIZE, sgFrameBuf, BENCH_FRAME_MAX);
+    yx_sl_parser_set_crc(&sgParser, crc_mode);
+
+    start = bench_now();
+    while (bytes < target) {
+        for (pos = 0; pos < sgStreamLen; pos += sgChunk) {
+            if (legacy) {
+                frames += bench_legacy_feed(&sgStream[pos], YX_MIN(sgChunk, sgStreamLen - pos));
+            } else {
+                frames += bench_parser_feed(&sgStream[pos], YX_MIN(sgChunk, sgStreamLen - pos));
+            }
+        }
+        bytes += sgStreamLen;
+    }
+    elapsed = bench_now() - start;
+
+    printf("%-7s %9.1f MB/s %11.0f frames/s  %s\n", name, bytes / elapsed / (1024 * 1024), frames / elapsed,
+           frames == (bytes / sgStreamLen) * sgStreamFrames ? "ok" : "FRAMES LOST");
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:c:g:m:")) != -1) {
+        switch (opt) {
+        case 's': sgSize    = atoi(optarg); break;
+        case 'c': sgChunk   = atoi(optarg); break;
+        case 'g': sgGap     = atoi(optarg); break;
+        case 'm': sgTotalMB = atoi(optarg); break;
+        default:
+            printf("usage: %s [-s size, 0 random] [-c read chunk] [-g gap bytes] [-m total MB]\n", argv[0]);
+            return -1;
+        }
+    }
+    sgSize  = YX_MIN(sgSize, (int)(BENCH_FRAME_MAX - sizeof(yx_sl_head_t)));
+    sgChunk = YX_MAX(sgChunk, 1);
+    sgGap   = YX_MAX(sgGap, 0);
+    sgStream = (INT8U*)malloc(BENCH_STREAM_LEN);
+
+    printf("frame data %d bytes%s, read chunk %d, gap %d, %d MB per run\n",
+           sgSize, sgSize > 0 ? "" : " (random)", sgChunk, sgGap, sgTotalMB);
+    srand(1);
+    bench_run("legacy", YX_SL_CRC_XOR, TRUE);
+    srand(1);
+    bench_run("xor", YX_SL_CRC_XOR, FALSE);
+    srand(1);
+    bench_run("crc16", YX_SL_CRC_16, FALSE);
+    srand(1);
+    bench_run("crc32", YX_SL_CRC_32, FALSE);
+    return 0;
+}
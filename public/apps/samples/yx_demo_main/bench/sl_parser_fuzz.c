@@ -0,0 +1,257 @@
+/*
+ * ·֡ģ
+ * ɺϷ֡(//, ֡), ֶд뻷λ:
+ *   1. ֡ݲ֡ͷֽʱ, У鷽ʽ밴ȫ֡;
+ *   2. ֡д 1~4 ֽ, 㳤/֡ͷ/УԼ,
+ *      ͳ©֡(̶ΪУ, ), CRC-32 ©;
+ *   3. (α֡ͷ), Լ, һᱻδɵα֡ռ.
+ * ÷: sl_parser_fuzz [-n ÿ֡] [-r ] [-s ]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_chksum.h"
+#include "yx_string.h"
+#include "yx_sl_parser.h"
+
+#define FUZZ_FRAME_MAX      (sizeof(yx_sl_head_t) + sizeof(yx_sl_win_t) + YX_SERIAL_LINK_RX_LEN_MAX)
+#define FUZZ_RING_SIZE      2048                                                /* ȡСôС, β֡ */
+#define FUZZ_GAP_MAX        64
+#define FUZZ_MATCH_AHEAD    64
+
+typedef struct {
+    int     offset;                                                             /* ֡еƫ */
+    int     len;                                                                /* ֡ͷ */
+} fuzz_frame_t;
+
+static int      sgFrames = 2000;
+static int      sgRounds = 20;
+
+static INT8U*   sgStream;
+static INT8U*   sgOrigin;                                                       /* дǰ֡, ڱȽ */
+static int      sgStreamLen;
+static fuzz_frame_t* sgExpect;
+static int      sgExpectNum;
+
+static yx_sl_parser_t sgParser;
+static INT8U    sgRing[FUZZ_RING_SIZE];
+static INT8U    sgFrameBuf[FUZZ_FRAME_MAX + YX_SL_CRC_LEN_MAX];
+static int      sgFailed;
+
+static const char* fuzz_crc_name(INT8U crc_mode)
+{
+    return crc_mode == YX_SL_CRC_32 ? "crc32" : (crc_mode == YX_SL_CRC_16 ? "crc16" : "xor");
+}
+
+static void fuzz_fail(const char* what, INT8U crc_mode, int round)
+{
+    printf("FAIL: %s (%s, round %d)\n", what, fuzz_crc_name(crc_mode), round);
+    sgFailed++;
+}
+
+/* ֡, gap_any Ϊ FALSE ʱ֡ݲ֡ͷһֽ */
+static void fuzz_build_stream(INT8U crc_mode, BOOLEAN gap_any)
+{
+    yx_sl_item_t* pItem;
+    INT16U cmd;
+    int i, j, gap, size;
+
+    sgStreamLen = 0;
+    sgExpectNum = 0;
+    for (i = 0; i < sgFrames; i++) {
+        gap = rand() % (FUZZ_GAP_MAX + 1);
+        for (j = 0; j < gap; j++) {
+            do {
+                sgStream[sgStreamLen] = rand() & 0xFF;
+            } while (!gap_any && sgStream[sgStreamLen] == YX_SERIAL_LINK_HEAD_UP_1);
+            sgStreamLen++;
+        }
+
+        switch (rand() % 8) {                                                   /* ƫ֡֡ */
+        case 0:
+            size = FUZZ_FRAME_MAX - sizeof(yx_sl_head_t);
+            break;
+        case 1:
+        case 2:
+            size = rand() % (FUZZ_FRAME_MAX - sizeof(yx_sl_head_t) + 1);
+            break;
+        default:
+            size = rand() % 32;
+            break;
+        }
+        cmd = (rand() % 16 == 0) ? YX_SERIAL_LINK_REQ_CMD : (rand() & 0xFFFF);
+
+        pItem = (yx_sl_item_t*)&sgStream[sgStreamLen];
+        pItem->Head.head[0]  = YX_SERIAL_LINK_HEAD_UP_1;
+        pItem->Head.head[1]  = YX_SERIAL_LINK_HEAD_UP_2;
+        pItem->Head.dev_type = 0x18;
+        pItem->Head.cmd_h    = (cmd >> 8) & 0xFF;
+        pItem->Head.cmd_l    = cmd & 0xFF;
+        for (j = 0; j < size; j++) {
+            pItem->Data[j] = rand() & 0xFF;
+        }
+        sgExpect[sgExpectNum].offset = sgStreamLen;
+        sgExpect[sgExpectNum].len    = size + sizeof(yx_sl_head_t);
+        sgExpectNum++;
+        sgStreamLen += yx_sl_frame_seal((INT8U*)pItem, size, crc_mode);
+    }
+    memcpy(sgOrigin, sgStream, sgStreamLen);
+}
+
+/* ĻԼ: ֡ͷȷ, 볤ֶһ, ǰУ鷽ʽУͨ */
+static BOOLEAN fuzz_frame_valid(INT8U* frame, int len, INT8U crc_mode)
+{
+    yx_sl_head_t* pHead = (yx_sl_head_t*)frame;
+    INT8U* pCrc = frame + len;
+    int size = len - sizeof(yx_sl_head_t);
+
+    if (len < (int)sizeof(yx_sl_head_t) || len > (int)FUZZ_FRAME_MAX
+        || pHead->head[0] != YX_SERIAL_LINK_HEAD_UP_1 || pHead->head[1] != YX_SERIAL_LINK_HEAD_UP_2
+        || ((pHead->len_h << 8) | pHead->len_l) != size) {
+        return FALSE;
+    }
+    if (yx_str_char2short_msb(&pHead->cmd_h) == YX_SERIAL_LINK_REQ_CMD) {
+        crc_mode = YX_SL_CRC_XOR;
+    }
+    switch (crc_mode) {
+    case YX_SL_CRC_16:
+        return yx_chksum_crc16(YX_CRC16_INIT, &pHead->dev_type, size + 5) == yx_str_char2short_msb(pCrc);
+    case YX_SL_CRC_32:
+        return yx_chksum_crc32(0, &pHead->dev_type, size + 5) == yx_str_char2long_msb(pCrc);
+    default:
+        return pHead->crc == yx_chksum_getxor(&pHead->cmd_h, size + 4);
+    }
+}
+
+/* ֡Ƚ; CRC ģʽ֡ͷ crc ֽڲУ, ҲȽ */
+static BOOLEAN fuzz_frame_equal(const fuzz_frame_t* pExpect, INT8U* frame, int len)
+{
+    INT8U* pOrigin = &sgOrigin[pExpect->offset];
+
+    return pExpect->len == len && memcmp(pOrigin, frame, 2) == 0
+           && memcmp(pOrigin + 3, frame + 3, len - 3) == 0;
+}
+
+/*
+ * ֶΰ֡д뻷λ, ֡֡ƥ
+ * exact Ϊ TRUE ʱҪ֡һ; ʧ֡, ޷ƥļΪ©
+ */
+static void fuzz_run(INT8U crc_mode, BOOLEAN exact, int round, int* lost, int* undetected)
+{
+    yx_roundbuf_t* pRing = &sgParser.ring;
+    INT8U *pbuf, *frame;
+    INT16U space;
+    int pos = 0, next = 0, matched = 0, chunk, len, i;
+
+    yx_sl_parser_init(&sgParser, sgRing, FUZZ_RING_SIZE, sgFrameBuf, FUZZ_FRAME_MAX);
+    yx_sl_parser_set_crc(&sgParser, crc_mode);
+    *undetected = 0;
+
+    while (pos < sgStreamLen) {
+        pbuf  = yx_roundbuf_put_ptr(pRing, &space);
+        if (space == 0) {
+            fuzz_fail("ring stuck full", crc_mode, round);
+            return;
+        }
+        chunk = 1 + rand() % ((rand() % 4 == 0) ? 8 : FUZZ_RING_SIZE);         /* ̷ֶ */
+        chunk = YX_MIN(chunk, space);
+        chunk = YX_MIN(chunk, sgStreamLen - pos);
+        memcpy(pbuf, &sgStream[pos], chunk);
+        yx_roundbuf_put_commit(pRing, chunk);
+        pos += chunk;
+
+        while ((len = yx_sl_parser_next(&sgParser, &frame)) > 0) {
+            if (!fuzz_frame_valid(frame, len, crc_mode)) {
+                fuzz_fail("invalid frame returned", crc_mode, round);
+                return;
+            }
+            for (i = next; i < sgExpectNum && i < next + (exact ? 1 : FUZZ_MATCH_AHEAD); i++) {
+                if (fuzz_frame_equal(&sgExpect[i], frame, len)) {
+                    break;
+                }
+            }
+            if (i < sgExpectNum && i < next + (exact ? 1 : FUZZ_MATCH_AHEAD)) {
+                next = i + 1;
+                matched++;
+            } else if (exact) {
+                fuzz_fail("frame mismatch", crc_mode, round);
+                return;
+            } else if (yx_str_char2short_msb(&((yx_sl_head_t*)frame)->cmd_h) != YX_SERIAL_LINK_REQ_CMD) {
+                (*undetected)++;                                                /* ֻУ,  */
+            }
+        }
+        if (yx_roundbuf_data_len(pRing) >= FUZZ_FRAME_MAX + YX_SL_CRC_LEN_MAX) {
+            fuzz_fail("parser stalled with a full frame buffered", crc_mode, round);
+            return;
+        }
+    }
+    *lost = sgExpectNum - matched;
+    if (exact && (*lost != 0 || sgParser.stat.crc_err != 0 || sgParser.stat.len_err != 0)) {
+        fuzz_fail("frames lost on a clean stream", crc_mode, round);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const INT8U modes[3] = {YX_SL_CRC_XOR, YX_SL_CRC_16, YX_SL_CRC_32};
+    long long frames[3] = {0}, lost[3] = {0}, undetected[3] = {0}, errors[3] = {0};
+    unsigned int seed = 1;
+    int r, m, i, j, n, pos, l, u, opt;
+
+    while ((opt = getopt(argc, argv, "n:r:s:")) != -1) {
+        switch (opt) {
+        case 'n': sgFrames = atoi(optarg); break;
+        case 'r': sgRounds = atoi(optarg); break;
+        case 's': seed     = strtoul(optarg, NULL, 0); break;
+        default:
+            printf("usage: %s [-n frames per round] [-r rounds] [-s seed]\n", argv[0]);
+            return -1;
+        }
+    }
+    srand(seed);
+    sgStream = (INT8U*)malloc(sgFrames * (FUZZ_GAP_MAX + FUZZ_FRAME_MAX + YX_SL_CRC_LEN_MAX));
+    sgOrigin = (INT8U*)malloc(sgFrames * (FUZZ_GAP_MAX + FUZZ_FRAME_MAX + YX_SL_CRC_LEN_MAX));
+    sgExpect = (fuzz_frame_t*)malloc(sgFrames * sizeof(fuzz_frame_t));
+
+    for (r = 0; r < sgRounds; r++) {
+        for (m = 0; m < 3; m++) {
+            fuzz_build_stream(modes[m], FALSE);                                 /* 1. ɾ֡ */
+            fuzz_run(modes[m], TRUE, r, &l, &u);
+
+            fuzz_build_stream(modes[m], TRUE);                                  /* 2. дֽ */
+            n = 1 + rand() % (sgStreamLen / 512 + 1);
+            for (i = 0; i < n; i++) {
+                pos = rand() % sgStreamLen;
+                for (j = 1 + rand() % 4; j > 0 && pos < sgStreamLen; j--, pos++) {
+                    sgStream[pos] = rand() & 0xFF;
+                }
+            }
+            fuzz_run(modes[m], FALSE, r, &l, &u);
+            frames[m]     += sgExpectNum;
+            lost[m]       += l;
+            undetected[m] += u;
+            errors[m]     += n;
+            if (modes[m] == YX_SL_CRC_32 && u != 0) {
+                fuzz_fail("crc32 accepted a corrupted frame", modes[m], r);
+            }
+
+            for (i = 0; i < sgStreamLen; i++) {                                 /* 3. , Լ 1/8 Ϊα֡ͷ */
+                sgStream[i] = (rand() % 16 == 0) ? YX_SERIAL_LINK_HEAD_UP_1
+                            : ((rand() % 16 == 0) ? YX_SERIAL_LINK_HEAD_UP_2 : (rand() & 0xFF));
+            }
+            sgExpectNum = 0;
+            fuzz_run(modes[m], FALSE, r, &l, &u);
+        }
+    }
+
+    printf("%-6s %10s %8s %8s %10s\n", "crc", "frames", "errors", "lost", "undetected");
+    for (m = 0; m < 3; m++) {
+        printf("%-6s %10lld %8lld %8lld %10lld\n", fuzz_crc_name(modes[m]),
+               frames[m], errors[m], lost[m], undetected[m]);
+    }
+    printf("%s\n", sgFailed == 0 ? "PASS" : "FAIL");
+    return sgFailed == 0 ? 0 : 1;
+}
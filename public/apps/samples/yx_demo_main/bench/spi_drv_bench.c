@@ -0,0 +1,330 @@
+/*
+ * SPI /ʱӲ
+ * ʹ yx_spidev_sim ģӻ, ˫ͬʱͲ֡, ͳЧֽʡ֡ʱӼ.
+ * ÷: spi_drv_bench [-n ÿ֡] [-s ֡] [-i ͼus, 0 Ϊ] [-m ӻ䳤 1/0] [-t]
+ * -t Уģʽ: Ծɴӻ(̶ 64 ֽ)ͱ䳤ӻֱԶ֡ͼ, ÿӽ
+ *    , Ҫ˫֡ȫʹ, 򷵻ʧ.
+ *  BENCH_STALL_MS û֡ʹͻһֱʱжʧ, ȴȫʱ.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "def.h"
+#include "yx_spi_drv.h"
+#include "yx_spidev_sim.h"
+
+#define BENCH_MARK          0x7E
+#define BENCH_HDR_LEN       10                                                  /* mark len_h len_l index(4) stamp_h..  bench_build */
+#define BENCH_FRAME_MAX     1024
+#define BENCH_STALL_MS      2000                                                /* ޽չʱжʧ */
+#define BENCH_RETRY_FAST    20                                                  /* ͻʱȶ̼ԵĴ */
+
+typedef struct {
+    INT8U       buf[BENCH_FRAME_MAX * 2];
+    int         len;
+    INT8U*      seen;
+    INT32U*     latency;                                                        /* us */
+    volatile int delivered;
+    int         broken;                                                         /* ֡ͷͳȷУ, ֡ */
+    long long   bytes;
+} bench_dir_t;
+
+static int      sgFrames   = 2000;
+static int      sgSize     = 16;
+static int      sgInterval = 0;
+static int      sgVarLen   = 1;
+static volatile int sgAbort = 0;
+
+static bench_dir_t sgDown;                                                      /*  -> ӻ */
+static bench_dir_t sgUp;                                                        /* ӻ ->  */
+
+static INT32U bench_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT32U)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/* ֡ʽ: 0x7E len(2) index(4) stamp(4) ... xor, len Ϊ֡ */
+static void bench_build(INT8U* frame, int index)
+{
+    INT32U stamp = bench_time_us();
+    INT8U x = 0;
+    int i;
+
+    frame[0] = BENCH_MARK;
+    frame[1] = (sgSize >> 8) & 0xFF;
+    frame[2] = sgSize & 0xFF;
+    memcpy(frame + 3, &index, 4);
+    memcpy(frame + 7, &stamp, 4);
+    memset(frame + 11, 0x55, sgSize - 12);
+    for (i = 0; i < sgSize - 1; i++) {
+        x ^= frame[i];
+    }
+    frame[sgSize - 1] = x;
+}
+
+/* ֽв֡, ֽں̽⴫ͷ */
+static void bench_parse_buf(bench_dir_t* dir)
+{
+    INT32U index, stamp;
+    INT8U x;
+    int off = 0, flen, i;
+
+    while (dir->len - off >= 3) {
+        if (dir->buf[off] != BENCH_MARK) {
+            off++;
+            continue;
+        }
+        flen = (dir->buf[off + 1] << 8) | dir->buf[off + 2];
+        if (flen != sgSize) {
+            off++;
+            continue;
+        }
+        if (dir->len - off < flen) {
+            break;
+        }
+        for (x = 0, i = 0; i < flen - 1; i++) {
+            x ^= dir->buf[off + i];
+        }
+        if (x != dir->buf[off + flen - 1]) {
+            dir->broken++;
+            off++;
+            continue;
+        }
+        memcpy(&index, dir->buf + off + 3, 4);
+        memcpy(&stamp, dir->buf + off + 7, 4);
+        if (index < (INT32U)sgFrames && !dir->seen[index]) {
+            dir->seen[index] = 1;
+            dir->latency[dir->delivered] = bench_time_us() - stamp;
+            dir->bytes += flen;
+            dir->delivered++;
+        }
+        off += flen;
+    }
+    memmove(dir->buf, dir->buf + off, dir->len - off);
+    dir->len -= off;
+}
+
+/* һδܴڻʣռ, ֶη, δ */
+static void bench_parse(bench_dir_t* dir, const INT8U* pBuf, int len)
+{
+    int n;
+
+    while (len > 0) {
+        if (dir->len == (int)sizeof(dir->buf)) {                                /* ֡, һ */
+            memmove(dir->buf, dir->buf + sizeof(dir->buf) / 2, sizeof(dir->buf) / 2);
+            dir->len = sizeof(dir->buf) / 2;
+        }
+        n = YX_MIN(len, (int)sizeof(dir->buf) - dir->len);
+        memcpy(dir->buf + dir->len, pBuf, n);
+        dir->len += n;
+        pBuf     += n;
+        len      -= n;
+        bench_parse_buf(dir);
+    }
+}
+
+static void bench_host_rx(void* args)
+{
+    INT8U buf[512];
+    int len;
+
+    while ((len = yx_spi_drv_read(buf, sizeof(buf))) > 0) {
+        bench_parse(&sgUp, buf, len);
+    }
+}
+
+static void bench_slave_rx(const INT8U* pBuf, int len)
+{
+    bench_parse(&sgDown, pBuf, len);
+}
+
+/* ͻʱ: ȶ̼, ֮;  BENCH_STALL_MS  FALSE */
+static BOOLEAN bench_retry(INT32U since, int retry, const char* name, int index)
+{
+    if (sgAbort) {
+        return FALSE;
+    }
+    if (bench_time_us() - since > BENCH_STALL_MS * 1000) {
+        printf("%s: tx buffer full for %d ms at frame %d, giving up\n", name, BENCH_STALL_MS, index);
+        sgAbort = 1;
+        return FALSE;
+    }
+    usleep(retry < BENCH_RETRY_FAST ? 50 : 1000);
+    return TRUE;
+}
+
+static void* bench_slave_thread(void* arg)
+{
+    INT8U frame[BENCH_FRAME_MAX];
+    INT32U since;
+    int i, retry;
+
+    for (i = 0; i < sgFrames && !sgAbort; i++) {
+        bench_build(frame, i);
+        since = bench_time_us();
+        for (retry = 0; yx_spidev_sim_send(frame, sgSize) == 0; retry++) {
+            if (!bench_retry(since, retry, "slave", i)) {
+                return NULL;
+            }
+            bench_build(frame, i);
+        }
+        if (sgInterval > 0) {
+            usleep(sgInterval);
+        }
+    }
+    return NULL;
+}
+
+static int bench_cmp(const void* a, const void* b)
+{
+    INT32U x = *(const INT32U*)a, y = *(const INT32U*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_report(const char* name, bench_dir_t* dir, INT32U elapsed_us)
+{
+    long long sum = 0;
+    int i;
+
+    qsort(dir->latency, dir->delivered, sizeof(INT32U), bench_cmp);
+    for (i = 0; i < dir->delivered; i++) {
+        sum += dir->latency[i];
+    }
+    printf("%-5s: %d/%d frames, %.1f KB/s", name, dir->delivered, sgFrames, dir->bytes * 1000000.0 / 1024 / elapsed_us);
+    if (dir->broken > 0) {
+        printf(", %d broken", dir->broken);
+    }
+    if (dir->delivered > 0) {
+        printf(", latency us avg %.0f p50 %u p99 %u max %u", (double)sum / dir->delivered,
+               dir->latency[dir->delivered / 2], dir->latency[(dir->delivered * 99) / 100], dir->latency[dir->delivered - 1]);
+    }
+    printf("\n");
+}
+
+/*  sgFrames/sgSize/sgInterval/sgVarLen һ, ˫ȫʹﷵ 0 */
+static int bench_run(void)
+{
+    INT8U frame[BENCH_FRAME_MAX];
+    yx_spi_stat_t stat;
+    pthread_t pid;
+    INT32U start, elapsed, since, progress_us;
+    int i, retry, progress;
+
+    sgSize = YX_MAX(sgSize, 12);
+    sgSize = YX_MIN(sgSize, BENCH_FRAME_MAX);
+
+    sgDown.seen    = (INT8U*)calloc(1, sgFrames);
+    sgDown.latency = (INT32U*)calloc(sgFrames, sizeof(INT32U));
+    sgUp.seen      = (INT8U*)calloc(1, sgFrames);
+    sgUp.latency   = (INT32U*)calloc(sgFrames, sizeof(INT32U));
+
+    yx_spidev_sim_config(sgVarLen, 4000000);
+    yx_spidev_sim_register_rx(bench_slave_rx);
+    yx_spi_drv_register_rx_notice(bench_host_rx);
+    yx_spi_drv_init();
+    usleep(20000);
+
+    start = bench_time_us();
+    pthread_create(&pid, NULL, bench_slave_thread, NULL);
+    for (i = 0; i < sgFrames && !sgAbort; i++) {
+        bench_build(frame, i);
+        since = bench_time_us();
+        for (retry = 0; yx_spi_drv_send(frame, sgSize) == 0; retry++) {
+            if (!bench_retry(since, retry, "host", i)) {
+                break;
+            }
+            bench_build(frame, i);
+        }
+        if (sgInterval > 0) {
+            usleep(sgInterval);
+        }
+    }
+    progress    = -1;
+    progress_us = bench_time_us();
+    while ((sgDown.delivered < sgFrames || sgUp.delivered < sgFrames) && !sgAbort) {
+        usleep(1000);
+        if (sgDown.delivered + sgUp.delivered != progress) {
+            progress    = sgDown.delivered + sgUp.delivered;
+            progress_us = bench_time_us();
+        } else if (bench_time_us() - progress_us > BENCH_STALL_MS * 1000) {
+            printf("no frame delivered for %d ms, giving up\n", BENCH_STALL_MS);
+            sgAbort = 1;
+        }
+    }
+    elapsed = YX_MAX(bench_time_us() - start, 1);
+
+    yx_spi_drv_get_stat(&stat);
+    printf("\nmode : %s, %d byte frames, interval %d us, %u ms\n", stat.var_len ? "variable length" : "fixed 64",
+           sgSize, sgInterval, elapsed / 1000);
+    bench_report("down", &sgDown, elapsed);
+    bench_report("up", &sgUp, elapsed);
+    printf("bus  : %u transfers, %u bytes clocked, payload %.1f%% of full duplex capacity, tx full %u\n", stat.xfers,
+           stat.clock_bytes, stat.clock_bytes ? (sgDown.bytes + sgUp.bytes) * 50.0 / stat.clock_bytes : 0.0, stat.tx_full);
+
+    return (sgDown.delivered == sgFrames && sgUp.delivered == sgFrames) ? 0 : 1;
+}
+
+/* Уģʽ: ǵ, ÿӽдͷ */
+static int bench_check(void)
+{
+    static const int sizes[]     = {16, 56, 64, 100, 300};
+    static const int intervals[] = {0, 1000};
+    int v, s, t, status, failed = 0, runs = 0;
+    pid_t pid;
+
+    for (v = 0; v <= 1; v++) {
+        for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+            for (t = 0; t < (int)(sizeof(intervals) / sizeof(intervals[0])); t++) {
+                fflush(stdout);
+                pid = fork();
+                if (pid == 0) {
+                    sgVarLen   = v;
+                    sgSize     = sizes[s];
+                    sgInterval = intervals[t];
+                    sgFrames   = 200;
+                    status     = bench_run();
+                    fflush(stdout);                                             /* _exit ˢ */
+                    _exit(status);
+                }
+                runs++;
+                if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    printf("FAIL : %s slave, %d byte frames, interval %d us\n", v ? "var len" : "legacy",
+                           sizes[s], intervals[t]);
+                    failed++;
+                }
+            }
+        }
+    }
+    printf("\ncheck: %d/%d runs delivered every frame intact\n", runs - failed, runs);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    BOOLEAN check = FALSE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:i:m:t")) != -1) {
+        switch (opt) {
+        case 'n': sgFrames   = atoi(optarg); break;
+        case 's': sgSize     = atoi(optarg); break;
+        case 'i': sgInterval = atoi(optarg); break;
+        case 'm': sgVarLen   = atoi(optarg); break;
+        case 't': check      = TRUE;         break;
+        default:
+            printf("usage: %s [-n frames] [-s size] [-i interval us] [-m slave var len 1/0] [-t]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (check) {
+        return bench_check();
+    }
+    return bench_run();
+}
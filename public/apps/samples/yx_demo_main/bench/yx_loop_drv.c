@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "def.h"
+#include "yx_loop_drv.h"
+#include "yx_spi_drv.h"
+#include "yx_roundbuf.h"
+
+
+#define YX_LOOP_DRV_RX_BUF_SIZE  8192
+#define YX_LOOP_DRV_PKT_MAX      2048
+
+typedef struct yx_loop_pkt_t {
+    struct yx_loop_pkt_t* next;
+    INT32U  due_ms;                                                             /* ʱ */
+    int     len;
+    INT8U   data[1];
+} yx_loop_pkt_t;
+
+typedef struct {
+    yx_loop_pkt_t* head;
+    yx_loop_pkt_t* tail;
+} yx_loop_queue_t;
+
+typedef struct {
+	int           sock[2];                                                      /* sock[0] , sock[1] Զ */
+	int           pipe_read;
+	int           pipe_write;
+    int           loss_pct;
+    int           delay_ms;
+    pthread_mutex_t mutex;
+    yx_loop_queue_t TxQueue;                                                    /* · -> Զ */
+    yx_loop_queue_t RxQueue;                                                    /* Զ -> · */
+    yx_roundbuf_t RxRingBuffer;
+    INT8U	RxBuf[YX_LOOP_DRV_RX_BUF_SIZE];
+} yx_loop_drv_para_t;
+
+static yx_loop_drv_para_t sgLoopDevObj;
+static void (*pRxCallBack)(void* args) = NULL;
+
+
+static INT32U _loop_drv_time_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT32U)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/* ʶ, ʱӺŶ */
+static void _loop_drv_queue(yx_loop_queue_t* q, const INT8U* pBuf, int len)
+{
+    yx_loop_pkt_t* pkt;
+
+    if (sgLoopDevObj.loss_pct > 0 && rand() % 100 < sgLoopDevObj.loss_pct) {
+        return;
+    }
+
+    pkt = (yx_loop_pkt_t*)yx_malloc(sizeof(yx_loop_pkt_t) + len);
+    if (pkt == NULL) {
+        printf("\nloop drv ram not enough!!");
+        return;
+    }
+    pkt->next   = NULL;
+    pkt->due_ms = _loop_drv_time_ms() + sgLoopDevObj.delay_ms;
+    pkt->len    = len;
+    memcpy(pkt->data, pBuf, len);
+
+    pthread_mutex_lock(&sgLoopDevObj.mutex);
+    if (q->tail != NULL) {
+        q->tail->next = pkt;
+    } else {
+        q->head = pkt;
+    }
+    q->tail = pkt;
+    pthread_mutex_unlock(&sgLoopDevObj.mutex);
+}
+
+static yx_loop_pkt_t* _loop_drv_peek_due(yx_loop_queue_t* q, INT32U now)
+{
+    yx_loop_pkt_t* pkt = NULL;
+
+    pthread_mutex_lock(&sgLoopDevObj.mutex);
+    if (q->head != NULL && (INT32S)(now - q->head->due_ms) >= 0) {
+        pkt = q->head;
+    }
+    pthread_mutex_unlock(&sgLoopDevObj.mutex);
+    return pkt;
+}
+
+static void _loop_drv_pop(yx_loop_queue_t* q)
+{
+    yx_loop_pkt_t* pkt;
+
+    pthread_mutex_lock(&sgLoopDevObj.mutex);
+    pkt = q->head;
+    q->head = pkt->next;
+    if (q->head == NULL) {
+        q->tail = NULL;
+    }
+    pthread_mutex_unlock(&sgLoopDevObj.mutex);
+    yx_free(pkt);
+}
+
+/* һʱ, ް -1; Ķзֱȴ POLLOUT ·ȡ, ʱ */
+static int _loop_drv_next_due(INT32U now, BOOLEAN tx_blocked, BOOLEAN rx_blocked)
+{
+    int timeout = -1, left;
+    yx_loop_pkt_t* heads[2];
+    int i;
+
+    pthread_mutex_lock(&sgLoopDevObj.mutex);
+    heads[0] = tx_blocked ? NULL : sgLoopDevObj.TxQueue.head;
+    heads[1] = rx_blocked ? NULL : sgLoopDevObj.RxQueue.head;
+    for (i = 0; i < 2; i++) {
+        if (heads[i] != NULL) {
+            left = YX_MAX((INT32S)(heads[i]->due_ms - now), 0);
+            timeout = (timeout < 0) ? left : YX_MIN(timeout, left);
+        }
+    }
+    pthread_mutex_unlock(&sgLoopDevObj.mutex);
+    return timeout;
+}
+
+static void* yx_loop_drv_thread(void* arg)
+{
+    struct pollfd fds[2];
+    yx_loop_pkt_t* pkt;
+    INT8U buf[YX_LOOP_DRV_PKT_MAX];
+    INT32U now;
+    BOOLEAN notify, tx_blocked, rx_blocked;
+    int len;
+
+	pthread_detach(pthread_self());
+	while (1) {
+        now = _loop_drv_time_ms();
+        tx_blocked = FALSE;
+        while ((pkt = _loop_drv_peek_due(&sgLoopDevObj.TxQueue, now)) != NULL) {
+            if (send(sgLoopDevObj.sock[0], pkt->data, pkt->len, MSG_DONTWAIT) < 0 && errno == EAGAIN) {
+                tx_blocked = TRUE;                                              /* Զδʱ, ߳ */
+                break;
+            }
+            _loop_drv_pop(&sgLoopDevObj.TxQueue);
+        }
+
+        notify     = FALSE;
+        rx_blocked = FALSE;
+        while ((pkt = _loop_drv_peek_due(&sgLoopDevObj.RxQueue, now)) != NULL) {
+            if (yx_roundbuf_space_len(&sgLoopDevObj.RxRingBuffer) < pkt->len) {
+                rx_blocked = TRUE;                                              /* ·ȡ */
+                break;
+            }
+            yx_roundbuf_put(&sgLoopDevObj.RxRingBuffer, pkt->data, pkt->len);
+            _loop_drv_pop(&sgLoopDevObj.RxQueue);
+            notify = TRUE;
+        }
+        if (notify && pRxCallBack != NULL) {
+            pRxCallBack(NULL);
+        }
+
+        fds[0].fd      = sgLoopDevObj.sock[0];
+        fds[0].events  = POLLIN | (tx_blocked ? POLLOUT : 0);
+        fds[0].revents = 0;
+        fds[1].fd      = sgLoopDevObj.pipe_read;
+        fds[1].events  = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, _loop_drv_next_due(now, tx_blocked, rx_blocked)) < 0 && errno != EINTR) {
+            printf("\nloop drv poll error %d", errno);
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            len = recv(sgLoopDevObj.sock[0], buf, sizeof(buf), 0);
+            if (len > 0) {
+                _loop_drv_queue(&sgLoopDevObj.RxQueue, buf, len);
+            }
+        }
+        if (fds[1].revents & POLLIN) {                                          /* չܵ */
+            do {
+                len = read(sgLoopDevObj.pipe_read, buf, 16);
+            } while (len >= 16 || (len < 0 && errno == EINTR));
+        }
+	}
+    return NULL;
+}
+
+/* Ϊ yx_spi_drv ӿڵĻػʵ, ·㲻Ҫ */
+int yx_spi_drv_init(void)
+{
+    int ret;
+	int fds[2];
+    pthread_t pid;
+
+    pthread_mutex_init(&sgLoopDevObj.mutex, NULL);
+	yx_roundbuf_init(&sgLoopDevObj.RxRingBuffer, sgLoopDevObj.RxBuf, YX_LOOP_DRV_RX_BUF_SIZE);
+
+    ret = socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sgLoopDevObj.sock);
+    if (ret < 0) {
+        printf("\nError in socketpair(), errno: %d", errno);
+        return -1;
+    }
+
+	ret = pipe(fds);
+	if (ret < 0) {
+		printf("\nError in pipe(), errno: %d", errno);
+        return -1;
+	}
+	sgLoopDevObj.pipe_read  = fds[0];
+	sgLoopDevObj.pipe_write = fds[1];
+    fcntl(sgLoopDevObj.pipe_read, F_SETFL, O_NONBLOCK);                         /* չܵʱ */
+
+    ret = pthread_create(&pid, NULL, yx_loop_drv_thread, NULL);
+    if (ret != 0) {
+        printf("\npthread_create error");
+        return -1;
+    }
+    return 0;
+}
+
+INT32S yx_spi_drv_send(INT8U * pBuf,INT32U len)
+{
+    int ret;
+
+	if (len > YX_LOOP_DRV_PKT_MAX) {
+		printf("loop tx len error!!\n");
+		return 0;
+	}
+    _loop_drv_queue(&sgLoopDevObj.TxQueue, pBuf, len);
+    do {                                                                        /* ܵд*/
+        ret = write(sgLoopDevObj.pipe_write, " ", 1);
+    } while (ret < 0 && errno == EINTR);
+
+	return len;
+}
+
+INT32S yx_spi_drv_read(INT8U * pBuf,INT32U len)
+{
+	INT32S rxlen = 0;
+    int ret;
+
+	if (yx_roundbuf_data_len(&sgLoopDevObj.RxRingBuffer) > 0) {
+		rxlen = yx_roundbuf_get(&sgLoopDevObj.RxRingBuffer, (INT8U*)pBuf, (INT16U)len);
+	}
+    if (rxlen > 0 && sgLoopDevObj.RxQueue.head != NULL) {                      /* ڳռ, ̼߳д */
+        do {
+            ret = write(sgLoopDevObj.pipe_write, " ", 1);
+        } while (ret < 0 && errno == EINTR);
+    }
+	return rxlen;
+}
+
+void yx_spi_drv_register_rx_notice(void (*pRxNotice)(void* args))
+{
+	pRxCallBack  = pRxNotice;
+}
+
+int yx_loop_drv_peer_fd(void)
+{
+    return sgLoopDevObj.sock[1];
+}
+
+void yx_loop_drv_set_fault(int loss_pct, int delay_ms)
+{
+    sgLoopDevObj.loss_pct = loss_pct;
+    sgLoopDevObj.delay_ms = delay_ms;
+}
@@ -0,0 +1,18 @@
+#ifndef _YX_LOOP_DRV_H_
+#define _YX_LOOP_DRV_H_
+#include "def.h"
+
+/*
+ * SPI Ļػ, Ӳʱ·.
+ * ļʵ yx_spi_drv.h е init/send/read/register_rx_notice, ʱ serial_link/yx_spi_drv.c,
+ * ·벻κ޸.
+ * ·ݾ SOCK_SEQPACKET socketpair ͵Զ(ģ MCU), öʼʱ.
+ */
+
+/* Զʹõ socket, ÿ send/recv Ϊһ֡ */
+int yx_loop_drv_peer_fd(void);
+
+/* loss_pct: Ķ(%), delay_ms: Եʱ */
+void yx_loop_drv_set_fault(int loss_pct, int delay_ms);
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "def.h"
+#include "yx_spi_drv.h"
+#include "yx_spidev_sim.h"
+#include "yx_roundbuf.h"
+
+
+#define YX_SPIDEV_SIM_TX_BUF_SIZE     8192
+#define YX_SPIDEV_SIM_XFER_COST_US    50                                        /* ÿδ̶: delay_usecs  ioctl */
+#define YX_SPIDEV_SIM_FILL_BYTE       0x00
+
+typedef struct {
+    BOOLEAN         var_len;
+    INT32U          speed_hz;
+    int             irq_fd;
+    INT16U          grant;                                                      /* ϴͨ next_len */
+    pthread_mutex_t mutex;
+    yx_roundbuf_t   TxRingBuffer;
+    INT8U           TxBuf[YX_SPIDEV_SIM_TX_BUF_SIZE];
+} yx_spidev_sim_t;
+
+static yx_spidev_sim_t sgSimObj = {
+    .var_len  = TRUE,
+    .speed_hz = 4000000,
+    .irq_fd   = -1,
+};
+static void (*pSimRxCallBack)(const INT8U* pBuf, int len) = NULL;
+
+
+/* ʱƵæ, ģ ioctl ʱ */
+static void _spidev_sim_clock(unsigned int len)
+{
+    struct timespec start, now;
+    long long cost_ns, pass_ns;
+
+    cost_ns = (long long)len * 8 * 1000000000LL / sgSimObj.speed_hz + YX_SPIDEV_SIM_XFER_COST_US * 1000LL;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        pass_ns = (now.tv_sec - start.tv_sec) * 1000000000LL + (now.tv_nsec - start.tv_nsec);
+    } while (pass_ns < cost_ns);
+}
+
+static void _spidev_sim_irq(void)
+{
+    uint64_t val = 1;
+    int ret;
+
+    do {
+        ret = write(sgSimObj.irq_fd, &val, sizeof(val));
+    } while (ret < 0 && errno == EINTR);
+}
+
+void yx_spidev_sim_config(BOOLEAN var_len, INT32U speed_hz)
+{
+    sgSimObj.var_len  = var_len;
+    sgSimObj.speed_hz = speed_hz;
+}
+
+int yx_spidev_sim_open(void)
+{
+    pthread_mutex_init(&sgSimObj.mutex, NULL);
+    yx_roundbuf_init(&sgSimObj.TxRingBuffer, sgSimObj.TxBuf, YX_SPIDEV_SIM_TX_BUF_SIZE);
+    sgSimObj.grant  = YX_SPI_FIX_BUF_SIZE - YX_SPI_XFER_HDR_LEN;
+    sgSimObj.irq_fd = eventfd(0, EFD_NONBLOCK);
+    if (sgSimObj.irq_fd < 0) {
+        printf("\nError in eventfd(), errno: %d", errno);
+    }
+    return sgSimObj.irq_fd;
+}
+
+int yx_spidev_sim_transfer(const INT8U* txbuf, INT8U* rxbuf, unsigned int len)
+{
+    INT8U flags;
+    INT16U this_len, next_len, n, left;
+
+    _spidev_sim_clock(len);
+
+    /* ӻ: кϷͷȡЧ, ֡ЭԭϽ */
+    if (pSimRxCallBack != NULL) {
+        if (sgSimObj.var_len && len >= YX_SPI_XFER_HDR_LEN
+            && yx_spi_xfer_hdr_parse(txbuf, &flags, &this_len, &next_len)) {
+            if (this_len > 0) {
+                pSimRxCallBack(txbuf + YX_SPI_XFER_HDR_LEN, YX_MIN(this_len, len - YX_SPI_XFER_HDR_LEN));
+            }
+        } else {
+            pSimRxCallBack(txbuf, len);
+        }
+    }
+
+    /* ӻ: 䳤ģʽϴͨ泤 */
+    pthread_mutex_lock(&sgSimObj.mutex);
+    if (sgSimObj.var_len && len >= YX_SPI_XFER_HDR_LEN) {
+        n = YX_MAX(sgSimObj.grant, YX_SPI_XFER_MIN_LEN - YX_SPI_XFER_HDR_LEN);
+        n = YX_MIN(n, len - YX_SPI_XFER_HDR_LEN);
+        n = yx_roundbuf_get(&sgSimObj.TxRingBuffer, rxbuf + YX_SPI_XFER_HDR_LEN, n);
+        left = YX_MIN(yx_roundbuf_data_len(&sgSimObj.TxRingBuffer), YX_SPI_XFER_MAX_LEN - YX_SPI_XFER_HDR_LEN);
+        yx_spi_xfer_hdr_pack(rxbuf, YX_SPI_XFER_FLAG_VL, n, left);
+        sgSimObj.grant = left;
+        n += YX_SPI_XFER_HDR_LEN;
+    } else {
+        n = yx_roundbuf_get(&sgSimObj.TxRingBuffer, rxbuf, len);
+    }
+    pthread_mutex_unlock(&sgSimObj.mutex);
+    if (n < len) {
+        memset(rxbuf + n, YX_SPIDEV_SIM_FILL_BYTE, len - n);
+    }
+    return len;
+}
+
+int yx_spidev_sim_irq_fd(void)
+{
+    return sgSimObj.irq_fd;
+}
+
+int yx_spidev_sim_ready(void)
+{
+    return yx_roundbuf_data_len(&sgSimObj.TxRingBuffer) > 0 ? 1 : 0;
+}
+
+int yx_spidev_sim_send(const INT8U* pBuf, int len)
+{
+    BOOLEAN idle;
+
+    pthread_mutex_lock(&sgSimObj.mutex);
+    if (len > yx_roundbuf_space_len(&sgSimObj.TxRingBuffer)) {
+        pthread_mutex_unlock(&sgSimObj.mutex);
+        return 0;
+    }
+    idle = (yx_roundbuf_data_len(&sgSimObj.TxRingBuffer) == 0);
+    yx_roundbuf_put(&sgSimObj.TxRingBuffer, pBuf, len);
+    pthread_mutex_unlock(&sgSimObj.mutex);
+    if (idle) {                                                                 /* ƽ */
+        _spidev_sim_irq();
+    }
+    return len;
+}
+
+void yx_spidev_sim_register_rx(void (*pRx)(const INT8U* pBuf, int len))
+{
+    pSimRxCallBack = pRx;
+}
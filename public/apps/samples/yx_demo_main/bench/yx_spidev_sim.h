@@ -0,0 +1,25 @@
+#ifndef _YX_SPIDEV_SIM_H_
+#define _YX_SPIDEV_SIM_H_
+#include "def.h"
+
+/*
+ * spidev , ģ SPI ӻ(MCU), Ӳʱ yx_spi_drv.
+ * ʱʱƵʼӹ̶æģ; ӻݴʱ߾ƽͨ eventfd ֪ͨ.
+ *  yx_spi_drv.c ʱ YX_SPI_DRV_SIM ʹñģ.
+ */
+
+/* var_len: ӻǷֱ֧䳤, speed_hz: ģʱƵ */
+void yx_spidev_sim_config(BOOLEAN var_len, INT32U speed_hz);
+
+int yx_spidev_sim_open(void);
+int yx_spidev_sim_transfer(const INT8U* txbuf, INT8U* rxbuf, unsigned int len);
+
+/* ź: eventfd ɶʾӻ, ready صǰƽ */
+int yx_spidev_sim_irq_fd(void);
+int yx_spidev_sim_ready(void);
+
+/* ӻշ: send ŶӴ, ͨصϲ */
+int yx_spidev_sim_send(const INT8U* pBuf, int len);
+void yx_spidev_sim_register_rx(void (*pRx)(const INT8U* pBuf, int len));
+
+#endif
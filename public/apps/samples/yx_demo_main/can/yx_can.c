@@ -5,6 +5,9 @@
 #include "serial_link/yx_fsm.h"
 #include "serial_link/serial_link.h"
 #include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
@@ -29,7 +32,73 @@ typedef struct {
 	INT8U baud[4];
 }yx_can_baud_set_t;
 
+typedef struct {
+	INT32U id;
+	INT32U mask;
+}yx_can_urgent_t;
+
+/* ͨϲͻ */
+typedef struct {
+	INT16U          holdoff_ms;                                                 /* 0: ϲ */
+	INT8U           max_frames;
+	INT8U           count;
+	INT8U           urgent_num;
+	BOOLEAN         timer_valid;
+	timer_t         timer;
+	yx_can_urgent_t urgent[CAN_URGENT_ID_MAX];
+	yx_can_txrx_t   frames[CAN_BATCH_FRAME_MAX];
+}yx_can_batch_t;
+
 static pCanRxFun p_s_CanRxCallBack = NULL;
+static yx_can_batch_t sgCanBatch[CAN_CHANNEL_MAX];
+static pthread_mutex_t sgCanMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* ֹͣ/ͨϲʱ, ʱѼ */
+static void _yx_can_batch_timer(yx_can_batch_t* pBatch, INT16U ms)
+{
+	struct itimerspec its;
+
+	if (!pBatch->timer_valid) {
+		return;
+	}
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec  = ms / 1000;
+	its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+	timer_settime(pBatch->timer, 0, &its, NULL);
+}
+
+/* ͨ֡, ʱѼ */
+static void _yx_can_batch_flush(CAN_CHANNEL_E ch)
+{
+	yx_can_batch_t* pBatch = &sgCanBatch[ch];
+
+	if (pBatch->count == 0) {
+		return;
+	}
+	_yx_can_batch_timer(pBatch, 0);
+	Yx_Serial_Link_Send(CAN_SEND_CMD, (INT8U*)pBatch->frames, pBatch->count * sizeof(yx_can_txrx_t));
+	pBatch->count = 0;
+}
+
+static void _yx_can_batch_timeout(union sigval sv)
+{
+	pthread_mutex_lock(&sgCanMutex);
+	_yx_can_batch_flush((CAN_CHANNEL_E)sv.sival_int);
+	pthread_mutex_unlock(&sgCanMutex);
+}
+
+static BOOLEAN _yx_can_is_urgent(yx_can_batch_t* pBatch, INT32U Canid)
+{
+	INT8U i;
+
+	for (i = 0; i < pBatch->urgent_num; i++) {
+		if ((Canid & pBatch->urgent[i].mask) == (pBatch->urgent[i].id & pBatch->urgent[i].mask)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
 
 
 static void _yx_can_rx_handle(const INT8U* pbuf, int size)
@@ -38,15 +107,22 @@ static void _yx_can_rx_handle(const INT8U* pbuf, int size)
 	yx_sl_item_t * pSlItem = (yx_sl_item_t *)pbuf;
 	yx_can_txrx_t * pCanData = (yx_can_txrx_t *)pSlItem->Data;
 	INT16U cmd = yx_str_char2short_msb(&pSlItem->Head.cmd_h);
+	INT16U num = yx_str_char2short_msb(&pSlItem->Head.len_h) / sizeof(yx_can_txrx_t);
+	
 	if (cmd == CAN_REC_CMD) {
-		tCanRxMsg.CanId =  yx_str_char2long_lsb(pCanData->id);
-		tCanRxMsg.ch 		= pCanData->ch;
-		tCanRxMsg.Format 	= pCanData->format;
-		tCanRxMsg.Type 		=  pCanData->type;
-		tCanRxMsg.Len 		= pCanData->len;
-		memcpy(tCanRxMsg.Data,pCanData->data,pCanData->len);
-		if (p_s_CanRxCallBack != NULL) {
-			p_s_CanRxCallBack(&tCanRxMsg);
+		if (num == 0) {																/* ݳȲһ¼ľɸʽ */
+			num = 1;
+		}
+		for (; num > 0; num--, pCanData++) {										/* һ֡пɰ¼ */
+			tCanRxMsg.CanId =  yx_str_char2long_lsb(pCanData->id);
+			tCanRxMsg.ch 		= pCanData->ch;
+			tCanRxMsg.Format 	= pCanData->format;
+			tCanRxMsg.Type 		=  pCanData->type;
+			tCanRxMsg.Len 		= YX_MIN(pCanData->len, 8);
+			memcpy(tCanRxMsg.Data,pCanData->data,tCanRxMsg.Len);
+			if (p_s_CanRxCallBack != NULL) {
+				p_s_CanRxCallBack(&tCanRxMsg);
+			}
 		}
 	}
 }
@@ -77,6 +153,7 @@ void Yx_Can_Init(void)
 INT32S Yx_Can_Send(CAN_CHANNEL_E ch, CAN_FORMAT_E format,CAN_FRAME_TYPE_E type,INT32U Canid,INT8U* pdata,INT8U len)
 {
 	yx_can_txrx_t tCanMsg;
+	yx_can_batch_t* pBatch;
 
 	if (ch <= CAN_CHANNEL_NULL || ch >= CAN_CHANNEL_MAX) {
 		return -1;
@@ -96,7 +173,104 @@ INT32S Yx_Can_Send(CAN_CHANNEL_E ch, CAN_FORMAT_E format,CAN_FRAME_TYPE_E type,I
 	tCanMsg.type 	= type;
 	tCanMsg.len 	= 8;
 	memcpy(tCanMsg.data,pdata,len);
-	Yx_Serial_Link_Send(CAN_SEND_CMD, &tCanMsg,sizeof(yx_can_txrx_t));
+
+	pthread_mutex_lock(&sgCanMutex);
+	pBatch = &sgCanBatch[ch];
+	if (pBatch->holdoff_ms == 0) {
+		pthread_mutex_unlock(&sgCanMutex);
+		Yx_Serial_Link_Send(CAN_SEND_CMD, (INT8U*)&tCanMsg,sizeof(yx_can_txrx_t));
+		return 0;
+	}
+	pBatch->frames[pBatch->count++] = tCanMsg;
+	if (pBatch->count >= pBatch->max_frames || _yx_can_is_urgent(pBatch, Canid)) {
+		_yx_can_batch_flush(ch);
+	} else if (pBatch->count == 1) {											/* һ֡ʼʱ */
+		_yx_can_batch_timer(pBatch, pBatch->holdoff_ms);
+	}
+	pthread_mutex_unlock(&sgCanMutex);
+	return 0;
+}
+
+/*******************************************************************************
+** :     Yx_Can_SetBatch
+** :   ͨϲ
+** :  chͨ
+**  		holdoff_ms ʱ, 0 رպϲ
+**  		max_frames ϲ֡
+** ز:-1 : ͨŴ   0ȷ
+******************************************************************************/
+INT32S Yx_Can_SetBatch(CAN_CHANNEL_E ch, INT16U holdoff_ms, INT8U max_frames)
+{
+	yx_can_batch_t* pBatch;
+	struct sigevent sev;
+
+	if (ch <= CAN_CHANNEL_NULL || ch >= CAN_CHANNEL_MAX) {
+		return -1;
+	}
+	pthread_mutex_lock(&sgCanMutex);
+	pBatch = &sgCanBatch[ch];
+	if (!pBatch->timer_valid && holdoff_ms != 0) {
+		memset(&sev, 0, sizeof(sev));
+		sev.sigev_notify          = SIGEV_THREAD;
+		sev.sigev_notify_function = _yx_can_batch_timeout;
+		sev.sigev_value.sival_int = ch;
+		if (timer_create(CLOCK_MONOTONIC, &sev, &pBatch->timer) == 0) {
+			pBatch->timer_valid = TRUE;
+		} else {
+			printf("\ncan batch timer create error!!");
+			holdoff_ms = 0;
+		}
+	}
+	_yx_can_batch_flush(ch);
+	pBatch->holdoff_ms = holdoff_ms;
+	pBatch->max_frames = YX_MAX(YX_MIN(max_frames, CAN_BATCH_FRAME_MAX), 1);
+	pthread_mutex_unlock(&sgCanMutex);
+	return 0;
+}
+
+/*******************************************************************************
+** :     Yx_Can_AddUrgentId
+** :   ӽ ID
+** :  chͨ
+**  		id can id
+**  		mask Ƚ
+** ز:-1 : ͨŴ  -5 ˱  0ȷ
+******************************************************************************/
+INT32S Yx_Can_AddUrgentId(CAN_CHANNEL_E ch, INT32U id, INT32U mask)
+{
+	yx_can_batch_t* pBatch;
+	INT32S ret = 0;
+
+	if (ch <= CAN_CHANNEL_NULL || ch >= CAN_CHANNEL_MAX) {
+		return -1;
+	}
+	pthread_mutex_lock(&sgCanMutex);
+	pBatch = &sgCanBatch[ch];
+	if (pBatch->urgent_num < CAN_URGENT_ID_MAX) {
+		pBatch->urgent[pBatch->urgent_num].id   = id;
+		pBatch->urgent[pBatch->urgent_num].mask = mask;
+		pBatch->urgent_num++;
+	} else {
+		ret = -5;
+	}
+	pthread_mutex_unlock(&sgCanMutex);
+	return ret;
+}
+
+/*******************************************************************************
+** :     Yx_Can_Flush
+** :   ͨѻ֡
+** :  chͨ
+** ز:-1 : ͨŴ   0ȷ
+******************************************************************************/
+INT32S Yx_Can_Flush(CAN_CHANNEL_E ch)
+{
+	if (ch <= CAN_CHANNEL_NULL || ch >= CAN_CHANNEL_MAX) {
+		return -1;
+	}
+	pthread_mutex_lock(&sgCanMutex);
+	_yx_can_batch_flush(ch);
+	pthread_mutex_unlock(&sgCanMutex);
 	return 0;
 }
 
@@ -36,6 +36,9 @@ typedef struct{
 
 typedef void(*pCanRxFun)(YX_CAN_RX_T* pData);
 
+#define CAN_BATCH_FRAME_MAX     64                                              /* ·֡ϲ CAN ֡ */
+#define CAN_URGENT_ID_MAX       8                                               /* ÿͨ ID ˱С */
+
 /*******************************************************************************
 ** :     Yx_Can_Init
 ** :   Can ģʼ
@@ -57,6 +60,36 @@ void Yx_Can_Init(void);
 ******************************************************************************/
 INT32S Yx_Can_Send(CAN_CHANNEL_E ch, CAN_FORMAT_E format,CAN_FRAME_TYPE_E type,INT32U Canid,INT8U* pdata,INT8U len);
 
+/*******************************************************************************
+** :     Yx_Can_SetBatch
+** :   ͨϲ.  Yx_Can_Send Ȼ, һʱϲΪһ·֡:
+**  		ﵽ max_frames ֡, һ֡泬 holdoff_ms, ͽ ID ֡
+**  		ϲ֡Ϊĵ֡¼,  MCU ְ֧Ƚ
+** :  chͨ
+**  		holdoff_ms ʱ, 0 رպϲ()
+**  		max_frames ϲ֡ 1~CAN_BATCH_FRAME_MAX
+** ز:-1 : ͨŴ   0ȷ
+******************************************************************************/
+INT32S Yx_Can_SetBatch(CAN_CHANNEL_E ch, INT16U holdoff_ms, INT8U max_frames);
+
+/*******************************************************************************
+** :     Yx_Can_AddUrgentId
+** :   ӽ ID, (Canid & mask) == (id & mask) ֡ȴϲ, ͬѻ֡
+** :  chͨ
+**  		id can id
+**  		mask Ƚ, 0xFFFFFFFF Ϊȷƥ
+** ز:-1 : ͨŴ  -5 ˱  0ȷ
+******************************************************************************/
+INT32S Yx_Can_AddUrgentId(CAN_CHANNEL_E ch, INT32U id, INT32U mask);
+
+/*******************************************************************************
+** :     Yx_Can_Flush
+** :   ͨѻ֡
+** :  chͨ
+** ز:-1 : ͨŴ   0ȷ
+******************************************************************************/
+INT32S Yx_Can_Flush(CAN_CHANNEL_E ch);
+
 /*******************************************************************************
 ** :     Yx_Can_SetBaud
 ** :   Can 
@@ -17,7 +17,14 @@
 #include "yx_chksum.h"
 #include "yx_string.h"
 #include "yx_fsm.h"
+#include "yx_roundbuf.h"
+#include "yx_sl_parser.h"
+#include "yx_sl_dispatch.h"
 #include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
@@ -68,10 +75,41 @@ typedef struct {
     INT8U       node_attrib     :1;
     INT8U       node_repeat     :3;
     INT8U       node_time       :4;
-    int      	node_len;
-    INT8U*      databuf;
+    INT8U       node_flag;                                                      /* ģʽ NODE_FLAG_xxx */
+    INT8U       node_seq;                                                       /* ģʽ */
+    INT16U      node_cmd;
+    INT32U      node_txtime;                                                    /* һηʱ ms */
+    int      	node_len;                                                       /* ûݳ */
+    INT8U*      databuf;                                                        /* ͻ, ǰԤ֡ͷֶ */
 } serial_item_node_t;
 
+#define NODE_FLAG_SACKED        0x01                                            /* ѱѡȷ */
+#define NODE_FLAG_RETRANS       0x02                                            /* ط,  RTT  */
+#define NODE_FLAG_FASTRTX       0x04                                            /* ѿط */
+
+#define SL_WIN_LEN              sizeof(yx_sl_win_t)
+#define SL_DATA_OFFSET          (sizeof(yx_sl_head_t) + SL_WIN_LEN)             /* û databuf еƫ */
+
+#define SL_NODE_BUF_LEN         (SL_DATA_OFFSET + YX_SERIAL_LINK_TX_LEN_MAX + YX_SL_CRC_LEN_MAX)
+#define SL_RX_FRAME_MAX         (SL_DATA_OFFSET + YX_SERIAL_LINK_RX_LEN_MAX)    /* ֡ͷ,  CRC */
+#define SL_RX_RING_SIZE         4096                                            /* 2 , һ֡ */
+
+#define SL_WIN_RETRY_MAX        7                                               /* node_repeat 3bit */
+#define SL_WIN_RTO_INIT         500
+#define SL_WIN_RTO_MIN          20
+#define SL_WIN_RTO_MAX          3000
+
+#if (YX_SERIAL_LINK_WIN_MAX & (YX_SERIAL_LINK_WIN_MAX - 1)) != 0 || YX_SERIAL_LINK_WIN_MAX > 128
+#error "YX_SERIAL_LINK_WIN_MAX must be a power of 2 no larger than 128"
+#endif
+
+typedef struct {
+    BOOLEAN     used;
+    INT8U       seq;
+    int         len;
+    INT8U       buf[SL_RX_FRAME_MAX];                                           /* ȥֶκ֡ */
+} serial_rx_slot_t;
+
 
 typedef struct {
     yx_list_t       stFreeList;                                                 /*  */
@@ -80,41 +118,41 @@ typedef struct {
     INT32U          LinkReqPeriod;
     INT8U           uConnectFlag;
     INT8U           uMsgFlag;
-    int          	rx_len;
-    INT8U           rx_buf[YX_SERIAL_LINK_RX_LEN_MAX + sizeof(yx_sl_head_t)];
-    INT8U           tx_buf[YX_SERIAL_LINK_TX_LEN_MAX + sizeof(yx_sl_head_t)];
+    yx_sl_parser_t  parser;
+    INT8U           rx_ring[SL_RX_RING_SIZE];                                   /* ֱӶ, ԭؽ */
+    INT8U           rx_frame[SL_RX_FRAME_MAX + YX_SL_CRC_LEN_MAX];              /* 绷β֡ */
+    INT8U           tx_buf[SL_NODE_BUF_LEN];
     pSerialEventFun event_cb;
     pSerialRxFun    rx_ana_cb;
+    INT8U           win_size;                                                   /* Э̴, 0 ΪЭ */
+    INT8U           win_session;                                                /* Զ˻Ự */
+    INT8U           win_local;                                                  /* ˻Ự, ·λʱ仯 */
+    INT8U           tx_seq;                                                     /* һ */
+    INT8U           tx_una;                                                     /* δȷ */
+    INT8U           rx_next;                                                    /*  */
+    INT8U           crc_mode;                                                   /* ЭУ鷽ʽ YX_SL_CRC_xxx */
+    BOOLEAN         ack_pending;
+    INT32S          srtt;                                                       /* ƽ RTT x8 */
+    INT32S          rttvar;                                                     /* RTT ƫ x4 */
+    INT32U          rto;
+    yx_sl_stat_t    stat;
 } yx_serial_t;
 
 
 
-#define MAX_REGISTER                    50      /* ע */
-/*
-********************************************************************************
-* עݽṹ
-********************************************************************************
-*/
-typedef struct {
-    INT16U       b_cmd;      /* 账ʼ */
-    INT16U       e_cmd;      /* 账Ľ */
-    void       (*handler)(const INT8U *, INT32U);
-} rcb_t;
-
-/*
-********************************************************************************
-* ģֲ
-********************************************************************************
-*/
-static INT32U       s_registered = 0;
-static rcb_t        s_rcb[MAX_REGISTER];
-
-
-
+static yx_sl_dispatch_t     sgSerialDispatch;                                   /* ȫ㼴ձ, ·ʼǰע */
+static pthread_mutex_t      sgSerialFsmMutex;                                   /* ֱӷַʱ״̬̺߳·̹߳ͬ */
+static BOOLEAN              sgSerialRxDirect;
 
 static serial_item_node_t   sgSerialItemNode[YX_SERIAL_ITEM_NODE_USED_MAX];
+static INT8U                sgSerialTxPool[YX_SERIAL_ITEM_NODE_USED_MAX][SL_NODE_BUF_LEN];   /* ڵ̶, Ͳٷڴ */
 static yx_serial_t          sgYxSeiralDlObj;
 static serial_fsm_t         sgSerialFsm;
+static serial_rx_slot_t     sgSerialRxSlot[YX_SERIAL_LINK_WIN_MAX];              /* ģʽ򻺴 */
+static INT8U                sgSerialWinCfg = YX_SERIAL_LINK_WIN_MAX;            /* ˴, 0 ΪЭ */
+static pthread_mutex_t      sgSerialMutex;
+static timer_t              sgRepeatTimer;
+static INT32U               sgRepeatTimerMs;
 
 
 
@@ -124,6 +162,11 @@ static int sgYxMsgQueue;
 
 #define  LINK_RX_FLAG    	0x01
 #define  LINK_TX_FLAG    	0x02
+#define  LINK_REPEAT_FLAG  	0x04
+
+/* Ϣ־ɶ߳λ/, ԭӲ, ʧ־յӦϢ */
+#define  LINK_MSG_FLAG_SET(flag)    ((__sync_fetch_and_or(&sgYxSeiralDlObj.uMsgFlag, (flag)) & (flag)) == 0)
+#define  LINK_MSG_FLAG_CLR(flag)    __sync_fetch_and_and(&sgYxSeiralDlObj.uMsgFlag, (INT8U)~(flag))
 
 #define _SERIAL_LINK_CONNECT_TIME           1000
 #define _SERIAL_LINK_CONNECT_ACK_OUT_TIME   500
@@ -136,19 +179,57 @@ static void _yx_serial_link_fsmctor(serial_fsm_t *me);
 static st_fm_msg_t* _yx_serial_link_disconnect_hndlr(st_fm_msg_t*);
 static st_fm_msg_t* _yx_serial_link_connect_hndlr(st_fm_msg_t*);
 static int _yx_serial_send_msg(INT32U MsgId,void* args);
+static void _yx_serial_link_statetrans(SerialFsm_State_t TargetState);
+static void _yx_serial_window_reset(INT8U win, INT8U session);
 
 
 static void _yx_serial_link_lock(void)
 {
+    pthread_mutex_lock(&sgSerialMutex);
 }
 
 static void _yx_serial_link_unlock(void)
 {
+    pthread_mutex_unlock(&sgSerialMutex);
+}
+
+static INT32U _yx_serial_link_time_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT32U)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void _yx_serial_repeat_timer_notify(union sigval sv)
+{
+    if (LINK_MSG_FLAG_SET(LINK_REPEAT_FLAG)) {
+        _yx_serial_send_msg(MSG_SERIAL_TIME_REPEAT_TIMEOUT, NULL);
+    }
 }
 
 static inline void _yx_serial_repeat_timer_ctl(BOOLEAN bOn,INT32U time_ms)
 {
-	
+    struct itimerspec its;
+
+    if (bOn && sgRepeatTimerMs == time_ms) {                                    /* Ѱ */
+        return;
+    }
+
+    memset(&its, 0, sizeof(its));
+    if (bOn) {
+        its.it_value.tv_sec  = time_ms / 1000;
+        its.it_value.tv_nsec = (time_ms % 1000) * 1000000;
+        its.it_interval      = its.it_value;
+    }
+    sgRepeatTimerMs = bOn ? time_ms : 0;
+    timer_settime(sgRepeatTimer, 0, &its, NULL);
+}
+
+/* طʱ: Э鰴 1s ļ, ģʽǰ RTO */
+static inline INT32U _yx_serial_repeat_period(void)
+{
+    return (sgYxSeiralDlObj.win_size != 0) ? sgYxSeiralDlObj.rto : 1000;
 }
 
 static inline void _yx_serial_connect_timer_ctl(BOOLEAN bOn,INT32U time_ms)
@@ -158,8 +239,7 @@ static inline void _yx_serial_connect_timer_ctl(BOOLEAN bOn,INT32U time_ms)
 
 static inline int _yx_serial_send_tx_req_msg(void)
 {
-    if (!(sgYxSeiralDlObj.uMsgFlag & LINK_TX_FLAG)) {
-        sgYxSeiralDlObj.uMsgFlag |= LINK_TX_FLAG;
+    if (LINK_MSG_FLAG_SET(LINK_TX_FLAG)) {
 		_yx_serial_send_msg(MSG_SERIAL_TX_DATA,NULL);
         //Yx_Ps_SendPsMsg2Ps(MSG_ID_S_S_SERIAL_TX_DATA, NULL, 0);                 /* ϲ㷢Ϣ  */
     }
@@ -168,8 +248,11 @@ static inline int _yx_serial_send_tx_req_msg(void)
 
 static void  _yx_serial_link_rx_ind_cb(void* parg)
 {
-    if (!(sgYxSeiralDlObj.uMsgFlag & LINK_RX_FLAG)) {
-        sgYxSeiralDlObj.uMsgFlag |= LINK_RX_FLAG;
+    if (sgSerialRxDirect) {                                                     /* ֱ߳ӽַ */
+        Yx_Serial_Link_Analyse();
+        return;
+    }
+    if (LINK_MSG_FLAG_SET(LINK_RX_FLAG)) {
 		_yx_serial_send_msg(MSG_SERIAL_RX_RCV,NULL);
     }
     return ;
@@ -188,7 +271,9 @@ static inline int _yx_serial_link_hw_senddata(INT8U* pdata, int len)
 	ret = yx_spi_drv_send(pdata,len);
 	if (ret != len) {
 		printf("hw send data err!!\n");
-	}
+	} else {
+        sgYxSeiralDlObj.stat.tx_frames++;
+    }
     return  ret;
 }
 
@@ -216,44 +301,75 @@ static inline void _yx_serial_link_event_cb(YX_SL_EVENT_T eEvent, void* parg)
 
 static inline void _yx_serial_link_rx_ana_cb(INT8U *pdata, int len)
 {
-	INT8U i;
-	yx_sl_item_t * pSlItem = (yx_sl_item_t *)pdata;
-	INT16U cmd = yx_str_char2short_msb(&pSlItem->Head.cmd_h);
-
-	for (i = 0; i < s_registered; i++) {										/* ͲҶӦĴӿ */
-		if (cmd >= s_rcb[i].b_cmd && cmd <= s_rcb[i].e_cmd) {	
-			if (s_rcb[i].handler != NULL) {
-				s_rcb[i].handler(pdata, len);
-			}
-			break;
-		}
-	}
-	
+    yx_sl_dispatch_frame(&sgSerialDispatch, pdata, len);                        /* ֱӿ */
+
     if (sgYxSeiralDlObj.rx_ana_cb != NULL) {
         sgYxSeiralDlObj.rx_ana_cb(pdata, len);
     }
+    sgYxSeiralDlObj.stat.rx_frames++;
 }
 
-static void _yx_serial_list_reset(void)
+/*******************************************************************************
+** :     _yx_serial_build_frame
+** :   ûǰд֡ͷ, ģʽͬʱдֶβӴȷ
+** :  pdata û, ǰԤ SL_DATA_OFFSET ֽ, Ԥ YX_SL_CRC_LEN_MAX ֽ
+**            flags/seq ֶ
+**            framelen ֡
+** ز:  ֡ʼַ
+******************************************************************************/
+static INT8U* _yx_serial_build_frame(INT8U* pdata, int len, INT16U cmd, INT8U flags, INT8U seq, int* framelen)
 {
-    INT8U i;
-    serial_item_node_t* node;
-    yx_list_t *tlist;
-    
-    tlist = sgYxSeiralDlObj.stWaitTxList.next;
-    while (tlist != &(sgYxSeiralDlObj.stWaitTxList)) {
-        node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
-        tlist = tlist->next;
-        yx_free(node->databuf);                                                 /* ͷڴ */
+    yx_sl_head_t* pHead;
+    yx_sl_win_t* pWin;
+    serial_rx_slot_t* pSlot;
+    INT16U sack = 0;
+    INT8U s, i;
+
+    if (sgYxSeiralDlObj.win_size != 0) {
+        for (i = 0; i < YX_SL_SACK_BITS; i++) {
+            s = sgYxSeiralDlObj.rx_next + 1 + i;
+            pSlot = &sgSerialRxSlot[s % YX_SERIAL_LINK_WIN_MAX];
+            if (pSlot->used && pSlot->seq == s) {
+                sack |= (1 << i);
+            }
+        }
+        pWin = (yx_sl_win_t*)(pdata - SL_WIN_LEN);
+        pWin->flags  = flags;
+        pWin->seq    = seq;
+        pWin->ack    = sgYxSeiralDlObj.rx_next;
+        pWin->sack_h = (sack >> 8) & 0xFF;
+        pWin->sack_l = sack & 0xFF;
+        sgYxSeiralDlObj.ack_pending = FALSE;
+        len += SL_WIN_LEN;
+        pHead = (yx_sl_head_t*)((INT8U*)pWin - sizeof(yx_sl_head_t));
+    } else {
+        pHead = (yx_sl_head_t*)(pdata - sizeof(yx_sl_head_t));
     }
 
-    tlist = sgYxSeiralDlObj.stReSendList.next;
+    pHead->head[0]  = YX_SERIAL_LINK_HEAD_DOWN_1;
+    pHead->head[1]  = YX_SERIAL_LINK_HEAD_DOWN_2;
+    pHead->dev_type = YX_SERIAL_LINK_DEVICE_TYPE;
+    pHead->cmd_h    = (cmd >> 8) & 0xFF;
+    pHead->cmd_l    = cmd & 0xFF;
 
-    while (tlist != &(sgYxSeiralDlObj.stReSendList)) {
-        node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
-        tlist = tlist->next;
-        yx_free(node->databuf);                                                 /* ͷڴ */
+    *framelen = yx_sl_frame_seal((INT8U*)pHead, len, sgYxSeiralDlObj.crc_mode);
+    return (INT8U*)pHead;
+}
+
+static inline INT8U* _yx_serial_node_frame(serial_item_node_t* node, int* framelen)
+{
+    INT8U flags = 0;
+
+    if (sgYxSeiralDlObj.win_size != 0 && node->node_attrib == 1) {
+        flags = YX_SL_WIN_FLAG_SEQ;
     }
+    return _yx_serial_build_frame(node->databuf + SL_DATA_OFFSET, node->node_len, node->node_cmd,
+                                  flags, node->node_seq, framelen);
+}
+
+static void _yx_serial_list_reset(void)
+{
+    INT8U i;
 
     yx_list_init(&sgYxSeiralDlObj.stFreeList);
     yx_list_init(&sgYxSeiralDlObj.stWaitTxList);
@@ -263,6 +379,9 @@ static void _yx_serial_list_reset(void)
     for (i = 0; i < YX_SERIAL_ITEM_NODE_USED_MAX; i++) {
         yx_list_add_before(&sgYxSeiralDlObj.stFreeList, &sgSerialItemNode[i].list);/* 뵽β */
     }
+
+    sgYxSeiralDlObj.win_local++;                                                /* ֪ͨԶ¿ʼ */
+    _yx_serial_window_reset(sgYxSeiralDlObj.win_size, sgYxSeiralDlObj.win_session);
 }
 
 static int _yx_serial_send_waittxlistnode(void)
@@ -270,23 +389,38 @@ static int _yx_serial_send_waittxlistnode(void)
     int sta = FAIL;
     serial_item_node_t* node;
     yx_list_t *tlist;
+    INT8U* frame;
+    int framelen;
     
     if (sgYxSeiralDlObj.uConnectFlag != CONNECT_FLAG_CONNECT) {
         return FAIL;
     }
     
-    tlist = sgYxSeiralDlObj.stWaitTxList.next;
     _yx_serial_link_lock();
+    tlist = sgYxSeiralDlObj.stWaitTxList.next;
     while (tlist != &(sgYxSeiralDlObj.stWaitTxList)) {
         node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
         tlist = tlist->next;
-        if (_yx_serial_link_hw_senddata(node->databuf, node->node_len) > 0) {   /* ɹ */
+        if (sgYxSeiralDlObj.win_size != 0 && node->node_attrib == 1) {
+            if ((INT8U)(sgYxSeiralDlObj.tx_seq - sgYxSeiralDlObj.tx_una) >= sgYxSeiralDlObj.win_size) {
+                sta = SUCC;                                                     /* , ȴȷ */
+                break;
+            }
+            node->node_seq    = sgYxSeiralDlObj.tx_seq;
+            node->node_flag   = 0;
+            node->node_repeat = SL_WIN_RETRY_MAX;
+        }
+        frame = _yx_serial_node_frame(node, &framelen);
+        if (_yx_serial_link_hw_senddata(frame, framelen) > 0) {                 /* ɹ */
             yx_list_del(&node->list);                                           /* ȴwaittx list ɾ */
+            node->node_txtime = _yx_serial_link_time_ms();
+            if (sgYxSeiralDlObj.win_size != 0 && node->node_attrib == 1) {
+                sgYxSeiralDlObj.tx_seq++;
+            }
 
             if (node->node_attrib == 1) {
                 yx_list_add_before(&sgYxSeiralDlObj.stReSendList, &node->list); /* ӵresendlist */
             } else {
-                yx_free(node->databuf);                                         /* ͷڴ */
                 yx_list_add_before(&sgYxSeiralDlObj.stFreeList, &node->list);   /* ӵfreelist */
             }
 
@@ -299,10 +433,10 @@ static int _yx_serial_send_waittxlistnode(void)
     _yx_serial_link_unlock();
 
     if (!yx_list_empty(&sgYxSeiralDlObj.stReSendList)) {
-        _yx_serial_repeat_timer_ctl(TRUE,1000);	/* طʱ */
+        _yx_serial_repeat_timer_ctl(TRUE,_yx_serial_repeat_period());	/* طʱ */
     }
 
-    if (!yx_list_empty(&sgYxSeiralDlObj.stWaitTxList)) {
+    if (!yx_list_empty(&sgYxSeiralDlObj.stWaitTxList) && sta != SUCC) {
         _yx_serial_send_tx_req_msg();
     }
     return sta;
@@ -312,26 +446,23 @@ static int _yx_serial_send_waittxlistnode(void)
 static int _yx_serial_del_repeatlistbycmd(int command)
 {
     int sta = FAIL;
-    yx_sl_item_t* pItem;
     serial_item_node_t* node;
     yx_list_t *tlist;
-    int cmd;
     
+    _yx_serial_link_lock();
     tlist = sgYxSeiralDlObj.stReSendList.next;
      
     while (tlist != &(sgYxSeiralDlObj.stReSendList)) {
         node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
         tlist = tlist->next;
-        pItem = (yx_sl_item_t*)node->databuf;
-        cmd = yx_str_char2short_msb(&pItem->Head.cmd_h);
         
-        if (cmd == command) {
+        if (node->node_cmd == command) {
             yx_list_del(&node->list);                                           /* ȴwaittx list ɾ */
-            yx_free(node->databuf);                                             /* ͷڴ */
             yx_list_add_before(&sgYxSeiralDlObj.stFreeList, &node->list);       /* ӵFreelist */
             break;
         }
     }
+    _yx_serial_link_unlock();
 
     if (yx_list_empty(&sgYxSeiralDlObj.stReSendList)) {
         _yx_serial_repeat_timer_ctl(FALSE,0);
@@ -345,13 +476,15 @@ static int _yx_serial_send_repeatlistnode(void)
     int sta = FAIL;
     serial_item_node_t* node;
     yx_list_t *tlist;
+    INT8U* frame;
+    int framelen;
 
     if (sgYxSeiralDlObj.uConnectFlag == CONNECT_FLAG_DISCONNECT) {
         return FAIL;
     }
     
-    tlist = sgYxSeiralDlObj.stReSendList.next;
     _yx_serial_link_lock();
+    tlist = sgYxSeiralDlObj.stReSendList.next;
     while (tlist != &(sgYxSeiralDlObj.stReSendList)) {
         node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
         tlist = tlist->next;
@@ -363,7 +496,9 @@ static int _yx_serial_send_repeatlistnode(void)
         if (node->node_time == 0) {
             node->node_time = 3;
 
-            if (_yx_serial_link_hw_senddata(node->databuf, node->node_len) > 0) {/* ɹ */
+            frame = _yx_serial_node_frame(node, &framelen);
+            if (_yx_serial_link_hw_senddata(frame, framelen) > 0) {             /* ɹ */
+                sgYxSeiralDlObj.stat.retrans++;
                 sta = SUCC;
             }
 
@@ -385,10 +520,348 @@ static int _yx_serial_send_repeatlistnode(void)
     return sta;
 }
 
+/*******************************************************************************
+** :     _yx_serial_window_rtt
+** :    RTT طʱ (RFC 6298)
+** :  rtt ʱ ms
+** ز:  
+******************************************************************************/
+static void _yx_serial_window_rtt(INT32U rtt)
+{
+    yx_serial_t* pObj = &sgYxSeiralDlObj;
+    INT32S err;
+    INT32U rto;
+
+    if (pObj->srtt == 0) {
+        pObj->srtt   = rtt << 3;
+        pObj->rttvar = rtt << 1;
+    } else {
+        err = (INT32S)rtt - (pObj->srtt >> 3);
+        pObj->srtt += err;
+        if (err < 0) {
+            err = -err;
+        }
+        pObj->rttvar += err - (pObj->rttvar >> 2);
+    }
+
+    rto = (pObj->srtt >> 3) + pObj->rttvar;
+    pObj->rto = YX_MIN(YX_MAX(rto, SL_WIN_RTO_MIN), SL_WIN_RTO_MAX);
+}
+
+static void _yx_serial_window_resend(serial_item_node_t* node, INT32U now)
+{
+    INT8U* frame;
+    int framelen;
+
+    frame = _yx_serial_node_frame(node, &framelen);
+    if (_yx_serial_link_hw_senddata(frame, framelen) > 0) {
+        sgYxSeiralDlObj.stat.retrans++;
+    }
+    node->node_flag  |= NODE_FLAG_RETRANS;
+    node->node_txtime = now;
+}
+
+/*******************************************************************************
+** :     _yx_serial_window_ack
+** :   ԶӴۼ/ѡȷ, ͷȷ֡Կնط
+** :  pWin ֶ
+** ز:  
+******************************************************************************/
+static void _yx_serial_window_ack(yx_sl_win_t* pWin)
+{
+    serial_item_node_t* node;
+    serial_item_node_t* last_sacked = NULL;
+    yx_list_t *tlist, *tnext;
+    INT32U now, rtt = 0;
+    BOOLEAN has_rtt = FALSE, freed = FALSE;
+    INT16U sack = (pWin->sack_h << 8) | pWin->sack_l;
+    INT8U acked, d;
+
+    _yx_serial_link_lock();
+    acked = pWin->ack - sgYxSeiralDlObj.tx_una;
+    if (acked > (INT8U)(sgYxSeiralDlObj.tx_seq - sgYxSeiralDlObj.tx_una)) {    /* ڻǷȷ */
+        _yx_serial_link_unlock();
+        return;
+    }
+
+    now = _yx_serial_link_time_ms();
+    YX_LIST_FOR_EACH_SAVE(&sgYxSeiralDlObj.stReSendList, tlist, tnext) {
+        node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
+        d = node->node_seq - pWin->ack;
+        if ((INT8U)(node->node_seq - sgYxSeiralDlObj.tx_una) < acked) {        /* ۼȷ */
+            if (!(node->node_flag & NODE_FLAG_RETRANS)) {
+                rtt = now - node->node_txtime;
+                has_rtt = TRUE;
+            }
+            yx_list_del(&node->list);
+            yx_list_add_before(&sgYxSeiralDlObj.stFreeList, &node->list);
+            freed = TRUE;
+        } else if (d >= 1 && d <= YX_SL_SACK_BITS && (sack & (1 << (d - 1)))) {  /* ѡȷ */
+            if (!(node->node_flag & (NODE_FLAG_SACKED | NODE_FLAG_RETRANS))) {
+                rtt = now - node->node_txtime;
+                has_rtt = TRUE;
+            }
+            node->node_flag |= NODE_FLAG_SACKED;
+            last_sacked = node;
+        }
+    }
+    sgYxSeiralDlObj.tx_una = pWin->ack;
+
+    if (has_rtt) {
+        _yx_serial_window_rtt(rtt);
+    }
+
+    if (last_sacked != NULL) {                                                  /* ֡յ, նطһ */
+        YX_LIST_FOR_EACH(&sgYxSeiralDlObj.stReSendList, tlist) {
+            node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
+            if (node == last_sacked) {
+                break;
+            }
+            if (!(node->node_flag & (NODE_FLAG_SACKED | NODE_FLAG_FASTRTX))) {
+                node->node_flag |= NODE_FLAG_FASTRTX;
+                _yx_serial_window_resend(node, now);
+            }
+        }
+    }
+    _yx_serial_link_unlock();
+
+    if (yx_list_empty(&sgYxSeiralDlObj.stReSendList)) {
+        _yx_serial_repeat_timer_ctl(FALSE,0);
+    } else {
+        _yx_serial_repeat_timer_ctl(TRUE,_yx_serial_repeat_period());
+    }
+
+    if (freed && !yx_list_empty(&sgYxSeiralDlObj.stWaitTxList)) {               /* ڴ */
+        _yx_serial_send_tx_req_msg();
+    }
+}
+
+/*******************************************************************************
+** :     _yx_serial_window_timeout
+** :   ģʽطʱ, ʱ֡ط RTO ӱ
+** :  
+** ز:  
+******************************************************************************/
+static void _yx_serial_window_timeout(void)
+{
+    serial_item_node_t* node;
+    yx_list_t *tlist;
+    INT32U now;
+    BOOLEAN resent = FALSE, failed = FALSE;
+
+    now = _yx_serial_link_time_ms();
+    _yx_serial_link_lock();
+    YX_LIST_FOR_EACH(&sgYxSeiralDlObj.stReSendList, tlist) {
+        node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
+        if ((node->node_flag & NODE_FLAG_SACKED) || now - node->node_txtime < sgYxSeiralDlObj.rto) {
+            continue;
+        }
+        if (node->node_repeat == 0) {
+            node->node_repeat = SL_WIN_RETRY_MAX;                               /* ط */
+            failed = TRUE;
+            break;
+        }
+        node->node_repeat--;
+        _yx_serial_window_resend(node, now);
+        resent = TRUE;
+    }
+    _yx_serial_link_unlock();
+
+    if (failed) {
+        LINK_LOG_ERROR("<Serial Link>: Window Retry Over!!");
+        _yx_serial_link_statetrans(SERIAL_STATE_DISCONNCT);
+        return;
+    }
+
+    if (resent) {
+        sgYxSeiralDlObj.rto = YX_MIN(sgYxSeiralDlObj.rto * 2, SL_WIN_RTO_MAX);
+    }
+
+    if (yx_list_empty(&sgYxSeiralDlObj.stReSendList)) {
+        _yx_serial_repeat_timer_ctl(FALSE,0);
+    } else {
+        _yx_serial_repeat_timer_ctl(TRUE,_yx_serial_repeat_period());
+    }
+}
+
+static int _yx_serial_window_sendack(void)
+{
+    INT8U* frame;
+    int framelen;
+    int sta = FAIL;
+
+    _yx_serial_link_lock();
+    frame = _yx_serial_build_frame(sgYxSeiralDlObj.tx_buf + SL_DATA_OFFSET, 0, YX_SERIAL_LINK_WACK_CMD,
+                                   0, 0, &framelen);
+    if (_yx_serial_link_hw_senddata(frame, framelen) > 0) {
+        sta = SUCC;
+    }
+    _yx_serial_link_unlock();
+
+    return sta;
+}
+
+/*******************************************************************************
+** :     _yx_serial_window_reset
+** :   Э̽仯ʱλ״̬, δȷ֡ԭ˳Żط±
+** :  win , 0 ΪЭ
+**            session Զ˻Ự
+** ز:  
+******************************************************************************/
+static void _yx_serial_window_reset(INT8U win, INT8U session)
+{
+    serial_item_node_t* node;
+    yx_list_t *tlist, *tprev;
+    INT8U i;
+
+    LINK_LOG_INFO("<Serial Link>: Window %d Session %d!!", win, session);
+
+    _yx_serial_link_lock();
+    YX_LIST_FOR_EACH_PREV_SAVE(&sgYxSeiralDlObj.stReSendList, tlist, tprev) {
+        node = YX_LIST_ENTRY(tlist, serial_item_node_t, list);
+        yx_list_del(&node->list);
+        node->node_flag   = 0;
+        node->node_repeat = 3;
+        node->node_time   = 3;
+        yx_list_add_after(&sgYxSeiralDlObj.stWaitTxList, &node->list);         /* 뵽ͷ */
+    }
+
+    for (i = 0; i < YX_SERIAL_LINK_WIN_MAX; i++) {
+        sgSerialRxSlot[i].used = FALSE;
+    }
+
+    sgYxSeiralDlObj.win_size     = win;
+    sgYxSeiralDlObj.win_session  = session;
+    sgYxSeiralDlObj.tx_seq       = 0;
+    sgYxSeiralDlObj.tx_una       = 0;
+    sgYxSeiralDlObj.rx_next      = 0;
+    sgYxSeiralDlObj.ack_pending  = FALSE;
+    sgYxSeiralDlObj.srtt         = 0;
+    sgYxSeiralDlObj.rttvar       = 0;
+    sgYxSeiralDlObj.rto          = SL_WIN_RTO_INIT;
+    _yx_serial_link_unlock();
+
+    _yx_serial_repeat_timer_ctl(FALSE,0);
+    if (!yx_list_empty(&sgYxSeiralDlObj.stWaitTxList)) {
+        _yx_serial_send_tx_req_msg();
+    }
+}
+
+/*  Data[1] ΪԶ˴, Data[2] ΪỰ, ɰ汾Զֻ Data[0] */
+static void _yx_serial_window_negotiate(yx_sl_item_t* pItem, int size)
+{
+    INT8U win = 0, session = 0;
+
+    if (size >= 3 && pItem->Data[1] != 0 && sgSerialWinCfg != 0) {
+        win     = YX_MIN(pItem->Data[1], sgSerialWinCfg);
+        session = pItem->Data[2];
+    }
+
+    if (win != sgYxSeiralDlObj.win_size || session != sgYxSeiralDlObj.win_session) {
+        _yx_serial_window_reset(win, session);
+    }
+}
+
+/*  Data[3] ΪԶֵ֧У鷽ʽ, ȡ˫ֵ֧ǿУ */
+static INT8U _yx_serial_crc_negotiate(yx_sl_item_t* pItem, int size)
+{
+    INT8U cap = 0;
+
+    if (size >= 4) {
+        cap = pItem->Data[3] & YX_SERIAL_LINK_CRC_CAP;
+    }
+    if (cap & YX_SL_CRC_CAP_32) {
+        return YX_SL_CRC_32;
+    } else if (cap & YX_SL_CRC_CAP_16) {
+        return YX_SL_CRC_16;
+    }
+    return YX_SL_CRC_XOR;
+}
+
+static void _yx_serial_crc_set(INT8U crc_mode)
+{
+    if (crc_mode != sgYxSeiralDlObj.crc_mode) {
+        LINK_LOG_INFO("<Serial Link>: Crc Mode %d!!", crc_mode);
+    }
+    _yx_serial_link_lock();
+    sgYxSeiralDlObj.crc_mode = crc_mode;
+    yx_sl_parser_set_crc(&sgYxSeiralDlObj.parser, crc_mode);
+    _yx_serial_link_unlock();
+}
+
+/*******************************************************************************
+** :     _yx_serial_window_rx
+** :   ģʽ: ȷ, ȥֶκϽ, ֡ݴ
+** :  pDlHead ֡ͷ
+**            size (ֶ)
+** ز:  
+******************************************************************************/
+static void _yx_serial_window_rx(yx_sl_head_t* pDlHead, int size)
+{
+    yx_sl_win_t win;
+    yx_sl_head_t* pHead;
+    serial_rx_slot_t* pSlot;
+    int len;
+    INT8U d;
+
+    if (size < SL_WIN_LEN) {
+        LINK_LOG_ERROR("<Serial Link>:Win Len Err!!");
+        return;
+    }
+
+    memcpy(&win, ((yx_sl_item_t*)pDlHead)->Data, SL_WIN_LEN);
+    _yx_serial_window_ack(&win);
+
+    if (yx_str_char2short_msb(&pDlHead->cmd_h) == YX_SERIAL_LINK_WACK_CMD) {
+        return;
+    }
+
+    /* ֡ͷƸǴֶ, ϲ㿴ԭʽ */
+    pHead = (yx_sl_head_t*)((INT8U*)pDlHead + SL_WIN_LEN);
+    memmove(pHead, pDlHead, sizeof(yx_sl_head_t));
+    size -= SL_WIN_LEN;
+    pHead->len_h = (size >> 8) & 0xFF;
+    pHead->len_l = size & 0xFF;
+    pHead->crc   = yx_chksum_getxor(&pHead->cmd_h, size + 4);
+    len = size + sizeof(yx_sl_head_t);
+
+    if (!(win.flags & YX_SL_WIN_FLAG_SEQ)) {
+        _yx_serial_link_rx_ana_cb((INT8U*)pHead, len);
+        return;
+    }
+
+    sgYxSeiralDlObj.ack_pending = TRUE;
+    d = win.seq - sgYxSeiralDlObj.rx_next;
+    if (d == 0) {
+        sgYxSeiralDlObj.rx_next++;
+        _yx_serial_link_rx_ana_cb((INT8U*)pHead, len);
+
+        for (;;) {                                                              /* Ͻѻĺ֡ */
+            pSlot = &sgSerialRxSlot[sgYxSeiralDlObj.rx_next % YX_SERIAL_LINK_WIN_MAX];
+            if (!pSlot->used || pSlot->seq != sgYxSeiralDlObj.rx_next) {
+                break;
+            }
+            pSlot->used = FALSE;
+            sgYxSeiralDlObj.rx_next++;
+            _yx_serial_link_rx_ana_cb(pSlot->buf, pSlot->len);
+        }
+    } else if (d < sgYxSeiralDlObj.win_size) {
+        pSlot = &sgSerialRxSlot[win.seq % YX_SERIAL_LINK_WIN_MAX];
+        if (!pSlot->used) {
+            memcpy(pSlot->buf, pHead, len);
+            pSlot->len  = len;
+            pSlot->seq  = win.seq;
+            pSlot->used = TRUE;
+        }
+    }
+    /* Ϊظ֡򳬳, ֻȷ */
+}
+
 
 static int _yx_serial_link_addlinkreq(void)
 {
     int sta = FAIL;
+    int framelen;
     yx_sl_item_t* pItemCmd;
     
     _yx_serial_link_lock();
@@ -407,12 +880,9 @@ static int _yx_serial_link_addlinkreq(void)
         pItemCmd->Data[0]    = _SERIAL_LINK_CONNECT_TIME / 1000;
     }
     
-    pItemCmd->Head.len_h = 0x00;
-    pItemCmd->Head.len_l = 0x01;
-    pItemCmd->Head.crc = yx_chksum_getxor(&pItemCmd->Head.cmd_h, 5);
-    
+    framelen = yx_sl_frame_seal(sgYxSeiralDlObj.tx_buf, 1, sgYxSeiralDlObj.crc_mode);
     
-    if (_yx_serial_link_hw_senddata(sgYxSeiralDlObj.tx_buf, 1 + sizeof(yx_sl_head_t)) != 0) {
+    if (_yx_serial_link_hw_senddata(sgYxSeiralDlObj.tx_buf, framelen) != 0) {
         sta = SUCC;
     }
     _yx_serial_link_unlock();
@@ -420,9 +890,10 @@ static int _yx_serial_link_addlinkreq(void)
     return sta;
 }
 
-static int _yx_serial_link_addlinkack(INT16U cmd)
+static int _yx_serial_link_addlinkack(INT16U cmd, INT8U* pext, int extlen)
 {
     int sta = FAIL;
+    int framelen;
     yx_sl_item_t* pItemCmd;
     
     _yx_serial_link_lock();
@@ -434,12 +905,13 @@ static int _yx_serial_link_addlinkack(INT16U cmd)
     pItemCmd->Head.cmd_h = (cmd >> 8) & 0xFF;
     pItemCmd->Head.cmd_l = cmd & 0xFF;
     pItemCmd->Data[0]    = 0x01;
+    if (extlen != 0) {
+        memcpy(&pItemCmd->Data[1], pext, extlen);
+    }
     
-    pItemCmd->Head.len_h = 0x00;
-    pItemCmd->Head.len_l = 0x01;
-    pItemCmd->Head.crc = yx_chksum_getxor(&pItemCmd->Head.cmd_h, 5);
+    framelen = yx_sl_frame_seal(sgYxSeiralDlObj.tx_buf, 1 + extlen, sgYxSeiralDlObj.crc_mode);
     
-    if (_yx_serial_link_hw_senddata(sgYxSeiralDlObj.tx_buf, 1 + sizeof(yx_sl_head_t)) != 0) {
+    if (_yx_serial_link_hw_senddata(sgYxSeiralDlObj.tx_buf, framelen) != 0) {
         sta = SUCC;
     }
     _yx_serial_link_unlock();
@@ -449,116 +921,101 @@ static int _yx_serial_link_addlinkack(INT16U cmd)
 
 
 
-static inline int _yx_serial_link_findframehead(INT8U *pdata, int datalen)
-{
-    int offset = 0;
-    
-    for (offset = 0; offset < datalen - 1; offset++) {
-        if (pdata[offset] == YX_SERIAL_LINK_HEAD_UP_1 && pdata[offset + 1] == YX_SERIAL_LINK_HEAD_UP_2) {
-            return offset;
-        }
-    }
-
-    if (offset == datalen - 1 && pdata[datalen - 1] == YX_SERIAL_LINK_HEAD_UP_1) {
-        return datalen - 1;
-    }
-
-    return datalen;
-}
-
-static int _yx_serial_link_rxrec(INT8U* pbuf, int datalen)
+/*******************************************************************************
+** :     _yx_serial_link_rxframe
+** :   һУͨĽ֡
+** :  pframe ֡ʼַ
+**            framelen ֡(֡ͷ)
+** ز:  
+******************************************************************************/
+static void _yx_serial_link_rxframe(INT8U* pframe, int framelen)
 {
     int cmd;
-    INT8U* pTemp = pbuf;
-    int offset = 0;
-    int size = 0;
-    yx_sl_head_t* pDlHead;
-    
-    if (datalen < sizeof(yx_sl_head_t)) {
-        return 0;
+    INT8U ext[4];
+    yx_sl_head_t* pDlHead = (yx_sl_head_t*)pframe;
+    int size = framelen - sizeof(yx_sl_head_t);
+    INT8U crc_mode;
+
+    cmd = yx_str_char2short_msb(&pDlHead->cmd_h);
+    if (sgYxSeiralDlObj.win_size == 0) {
+        _yx_serial_del_repeatlistbycmd(cmd);
     }
-    
-_ANALYSE:
-    pTemp = pbuf + offset;
-    
-    offset += _yx_serial_link_findframehead(pTemp, datalen - offset);
-
-    if ((datalen - offset) < sizeof(yx_sl_head_t)) {
-        return offset;
-    } else {
-        pDlHead = (yx_sl_head_t*)(pbuf + offset);
-        size = ((pDlHead->len_h << 8) + pDlHead->len_l);
-
-        if ((datalen - offset) >= (size + sizeof(yx_sl_head_t))) {
-            if ((pDlHead->crc == yx_chksum_getxor(&pDlHead->cmd_h, size + 4))) {
-                offset += (size + sizeof(yx_sl_head_t));
-                cmd = yx_str_char2short_msb(&pDlHead->cmd_h);
-                _yx_serial_del_repeatlistbycmd(cmd);
-				LINK_LOG_TRACE("<serial Link>: rxcmd  0x%x",cmd);
-                if (cmd == YX_SERIAL_LINK_REQ_CMD ) {
-					sgYxSeiralDlObj.LinkReqPeriod = ((yx_sl_item_t*)pDlHead)->Data[0];
-					sgYxSeiralDlObj.LinkReqPeriod *=1000;
-					_yx_serial_link_addlinkack(cmd);
-                    if (sgYxSeiralDlObj.uConnectFlag != CONNECT_FLAG_CONNECT) {
-                        sgYxSeiralDlObj.uConnectFlag = CONNECT_FLAG_CONNECT;
-                    } else {
-						_yx_serial_connect_timer_ctl(TRUE,5000);
-					}
-                    
-                } else if (cmd == YX_SERIAL_LINK_BEAT_CMD) {
-	                _yx_serial_link_addlinkack(cmd);
-					_yx_serial_connect_timer_ctl(TRUE,5000);
-
-                } else {
-                    _yx_serial_link_rx_ana_cb((INT8U*)pDlHead, size + sizeof(yx_sl_head_t));
-                }
-
-                if (offset < datalen) {
-                    goto _ANALYSE;
-                }
-            } else {
-                LINK_LOG_ERROR("<Serial Link>:Crc Err!!");
-                offset += 2;
-                goto _ANALYSE;
-
-            }
-        } else if (datalen > YX_SERIAL_LINK_RX_LEN_MAX) {
-            LINK_LOG_ERROR("<Serial Link>:Rx Len Over!!");
-            offset += 2;
-            goto _ANALYSE;
+    LINK_LOG_TRACE("<serial Link>: rxcmd  0x%x",cmd);
+    if (cmd == YX_SERIAL_LINK_REQ_CMD ) {
+        sgYxSeiralDlObj.LinkReqPeriod = ((yx_sl_item_t*)pDlHead)->Data[0];
+        sgYxSeiralDlObj.LinkReqPeriod *=1000;
+        _yx_serial_window_negotiate((yx_sl_item_t*)pDlHead, size);
+        crc_mode = _yx_serial_crc_negotiate((yx_sl_item_t*)pDlHead, size);
+        ext[0] = sgYxSeiralDlObj.win_size;                                      /* Э̽ */
+        ext[1] = sgYxSeiralDlObj.win_session;
+        ext[2] = sgYxSeiralDlObj.win_local;
+        ext[3] = crc_mode;
+        if (size >= 4) {
+            _yx_serial_link_addlinkack(cmd, ext, 4);
+        } else if (sgYxSeiralDlObj.win_size != 0) {
+            _yx_serial_link_addlinkack(cmd, ext, 3);
         } else {
-            return offset;
+            _yx_serial_link_addlinkack(cmd, NULL, 0);
         }
+        _yx_serial_crc_set(crc_mode);                                           /* Ӧ𲻴 CRC, л */
+        if (sgYxSeiralDlObj.uConnectFlag != CONNECT_FLAG_CONNECT) {
+            sgYxSeiralDlObj.uConnectFlag = CONNECT_FLAG_CONNECT;
+        } else {
+            _yx_serial_connect_timer_ctl(TRUE,5000);
+        }
+        
+    } else if (cmd == YX_SERIAL_LINK_BEAT_CMD) {
+        _yx_serial_link_addlinkack(cmd, NULL, 0);
+        _yx_serial_connect_timer_ctl(TRUE,5000);
+
+    } else if (sgYxSeiralDlObj.win_size != 0) {
+        _yx_serial_window_rx(pDlHead, size);
+    } else {
+        _yx_serial_link_rx_ana_cb(pframe, framelen);
     }
-    
-    return offset;
 }
 
 
 static void _yx_serial_link_rx_analyse(void)
 {
-    int rx_len = 0;
-    int rx_offset = 0;
+    yx_roundbuf_t* pRing = &sgYxSeiralDlObj.parser.ring;
+    INT8U* pbuf;
+    INT8U* pframe;
+    INT16U space;
+    int rx_len, framelen;
     
-    while ((rx_len =_yx_serial_link_hw_readdata(&sgYxSeiralDlObj.rx_buf[sgYxSeiralDlObj.rx_len],
-                YX_SERIAL_LINK_RX_LEN_MAX - sgYxSeiralDlObj.rx_len)) != 0) {
-        //YX_OS_TimerStop(sgYxSeiralDlObj.LinkRxAnaOutTimer);
-        LINK_LOG_BUF("<Serial Link>: Rx:", &sgYxSeiralDlObj.rx_buf[sgYxSeiralDlObj.rx_len], rx_len);
-        sgYxSeiralDlObj.rx_len += rx_len;
-        rx_offset = _yx_serial_link_rxrec(sgYxSeiralDlObj.rx_buf, sgYxSeiralDlObj.rx_len);
-        sgYxSeiralDlObj.rx_len -= rx_offset;
-        if (sgYxSeiralDlObj.rx_len != 0) {
-            //YX_OS_TimerStartup(sgYxSeiralDlObj.LinkRxAnaOutTimer, 500);       /* ֡ʱ  Ƿճʱʱ */
-            memmove(sgYxSeiralDlObj.rx_buf, &sgYxSeiralDlObj.rx_buf[rx_offset], sgYxSeiralDlObj.rx_len);
+    for (;;) {
+        pbuf = yx_roundbuf_put_ptr(pRing, &space);                              /* ֱӶ뻷λ */
+        if (space == 0) {
+            break;
+        }
+        rx_len = _yx_serial_link_hw_readdata(pbuf, space);
+        if (rx_len <= 0) {
+            break;
+        }
+        LINK_LOG_BUF("<Serial Link>: Rx:", pbuf, rx_len);
+        yx_roundbuf_put_commit(pRing, rx_len);
+        while ((framelen = yx_sl_parser_next(&sgYxSeiralDlObj.parser, &pframe)) > 0) {
+            _yx_serial_link_rxframe(pframe, framelen);
+        }
+    }
+
+    if (sgYxSeiralDlObj.ack_pending) {                                          /* պϲȷ */
+        if (sgYxSeiralDlObj.uConnectFlag == CONNECT_FLAG_CONNECT
+            && !yx_list_empty(&sgYxSeiralDlObj.stWaitTxList)
+            && (INT8U)(sgYxSeiralDlObj.tx_seq - sgYxSeiralDlObj.tx_una) < sgYxSeiralDlObj.win_size) {
+            _yx_serial_send_tx_req_msg();                                       /* Ӵڴ */
+        } else {
+            _yx_serial_window_sendack();
         }
     }
 }
 
 static void _yx_serial_link_rx_reset(void)
 {
-    if (sgYxSeiralDlObj.rx_len != 0) {
-        sgYxSeiralDlObj.rx_len = 0;
-    }
+    yx_roundbuf_t* pRing = &sgYxSeiralDlObj.parser.ring;
+
+    yx_roundbuf_skip(pRing, yx_roundbuf_data_len(pRing));
 }
 
 
@@ -649,7 +1106,7 @@ static st_fm_msg_t* _yx_serial_link_connect_hndlr(st_fm_msg_t* pMsg)
         }
 
         if (!yx_list_empty(&sgYxSeiralDlObj.stReSendList)) {
-			_yx_serial_repeat_timer_ctl(TRUE,1000);
+			_yx_serial_repeat_timer_ctl(TRUE,_yx_serial_repeat_period());
         }
         return 0;
     case MSG_STATE_EXIT:
@@ -679,7 +1136,11 @@ static st_fm_msg_t* _yx_serial_link_connect_hndlr(st_fm_msg_t* pMsg)
         _yx_serial_link_rx_reset();
         return 0;
     case MSG_SERIAL_TIME_REPEAT_TIMEOUT:
-        _yx_serial_send_repeatlistnode();
+        if (sgYxSeiralDlObj.win_size != 0) {
+            _yx_serial_window_timeout();
+        } else {
+            _yx_serial_send_repeatlistnode();
+        }
         return 0;
     case MSG_SERIAL_TX_DATA:
         _yx_serial_send_waittxlistnode();
@@ -703,7 +1164,9 @@ void Yx_Serial_Link_Handle(YX_SERIAL_MSG_E eMsg)
     
     Msg.MsgID = eMsg;
     Msg.PtrMsgSt = NULL;
+    pthread_mutex_lock(&sgSerialFsmMutex);
     FsmOnEvent((Fsm*)&sgSerialFsm, &Msg);
+    pthread_mutex_unlock(&sgSerialFsmMutex);
 }
 
 /*******************************************************************************
@@ -732,7 +1195,7 @@ BOOLEAN Yx_Serial_Link_TimerAnalyse(int timer_id)
 ******************************************************************************/
 void Yx_Serial_Link_Tx_Handle(void)
 {
-    sgYxSeiralDlObj.uMsgFlag &= ~LINK_TX_FLAG;
+    LINK_MSG_FLAG_CLR(LINK_TX_FLAG);
     Yx_Serial_Link_Handle(MSG_SERIAL_TX_DATA);
 }
 
@@ -744,7 +1207,7 @@ void Yx_Serial_Link_Tx_Handle(void)
 ******************************************************************************/
 void Yx_Serial_Link_Analyse(void)
 {
-    sgYxSeiralDlObj.uMsgFlag &= ~LINK_RX_FLAG;
+    LINK_MSG_FLAG_CLR(LINK_RX_FLAG);
     Yx_Serial_Link_Handle(MSG_SERIAL_RX_RCV);
 }
 
@@ -794,6 +1257,10 @@ INT32S Yx_Serial_Link_Process(void* args)
 		case MSG_SERIAL_RX_RCV:
 			Yx_Serial_Link_Analyse();
 			break;
+		case MSG_SERIAL_TIME_REPEAT_TIMEOUT:
+			LINK_MSG_FLAG_CLR(LINK_REPEAT_FLAG);
+			Yx_Serial_Link_Handle(MSG_SERIAL_TIME_REPEAT_TIMEOUT);
+			break;
 		default:
 			break;
 		}
@@ -822,13 +1289,38 @@ INT32S Yx_Serial_Link_Process(void* args)
 ********************************************************************/
 BOOLEAN Yx_Serial_Link_DispatcherRegister(INT32U b_cmd, INT32U e_cmd, void (*handler)(const INT8U *, INT32U))
 {
-    s_rcb[s_registered].b_cmd   = b_cmd;
-    s_rcb[s_registered].e_cmd   = e_cmd;
-    s_rcb[s_registered].handler = handler;
-    s_registered++;
+    if (e_cmd > 0xFFFF) {
+        return FALSE;
+    }
+    if (!yx_sl_dispatch_register(&sgSerialDispatch, b_cmd, e_cmd, handler)) {
+        LINK_LOG_ERROR("<Serial Link>: dispatcher register 0x%x-0x%x fail!!\n", b_cmd, e_cmd);
+        return FALSE;
+    }
     return TRUE;
 }
 
+/*******************************************************************************
+** :     Yx_Serial_Link_GetCmdStat
+** :   ȡעֵķַͳϢ
+** :  cmd , pStat ͳϢ
+** ز:  TRUE ɹ; FALSE δע
+******************************************************************************/
+BOOLEAN Yx_Serial_Link_GetCmdStat(INT16U cmd, yx_sl_cmd_stat_t* pStat)
+{
+    return yx_sl_dispatch_get_stat(&sgSerialDispatch, cmd, pStat);
+}
+
+/*******************************************************************************
+** :     Yx_Serial_Link_SetRxDirect
+** :   ýֱ߳ӽַ
+** :  bDirect TRUE ֱ߳ӷַ; FALSE Ϣ·̷ַ߳
+** ز:  
+******************************************************************************/
+void Yx_Serial_Link_SetRxDirect(BOOLEAN bDirect)
+{
+    sgSerialRxDirect = bDirect;
+}
+
 
 /*******************************************************************************
 ** :     _yx_serial_link_thread
@@ -856,10 +1348,28 @@ void Yx_Serial_Link_Init(void)
     INT8U i;
 	int ret;
     pthread_t pid;
-	sgYxMsgQueue = msgget((key_t)(LINK_QUEUE_MSG_KEY + i), IPC_CREAT);		//Ϣ
+    pthread_mutexattr_t attr;
+    struct sigevent sev;
+
+	sgYxMsgQueue = msgget((key_t)LINK_QUEUE_MSG_KEY, IPC_CREAT | 0666);		//Ϣ
     if (sgYxMsgQueue == -1) {
         LINK_LOG_ERROR("<serial msg get error!!>\n");
     }
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&sgSerialMutex, &attr);
+    pthread_mutex_init(&sgSerialFsmMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    memset(&sev, 0, sizeof(sev));                                               /* طʱ, ·̷߳Ϣ */
+    sev.sigev_notify          = SIGEV_THREAD;
+    sev.sigev_notify_function = _yx_serial_repeat_timer_notify;
+    if (timer_create(CLOCK_MONOTONIC, &sev, &sgRepeatTimer) != 0) {
+        LINK_LOG_ERROR("<serial repeat timer create error!!>\n");
+    }
+    sgYxSeiralDlObj.rto       = SL_WIN_RTO_INIT;
+    sgYxSeiralDlObj.win_local = (INT8U)_yx_serial_link_time_ms();
     /* ʼ״̬ */
     yx_list_init(&sgYxSeiralDlObj.stFreeList);
     yx_list_init(&sgYxSeiralDlObj.stWaitTxList);
@@ -867,8 +1377,11 @@ void Yx_Serial_Link_Init(void)
 
     /* ʼfreelist */
     for (i = 0; i < YX_SERIAL_ITEM_NODE_USED_MAX; i++) {
+        sgSerialItemNode[i].databuf = sgSerialTxPool[i];
         yx_list_add_before(&sgYxSeiralDlObj.stFreeList, &sgSerialItemNode[i].list); /* 뵽β */
     }
+    yx_sl_parser_init(&sgYxSeiralDlObj.parser, sgYxSeiralDlObj.rx_ring, SL_RX_RING_SIZE,
+                      sgYxSeiralDlObj.rx_frame, SL_RX_FRAME_MAX);
     _yx_serial_link_hw_init();
     _yx_serial_link_fsmctor(&sgSerialFsm);
     sgYxSeiralDlObj.uConnectFlag  = CONNECT_FLAG_DISCONNECT;
@@ -917,7 +1430,6 @@ int Yx_Serial_Link_Send2List(BOOLEAN need_ack, int cmd, INT8U* pdata, int len)
 {
     int sta = FAIL;
     serial_item_node_t* node;
-    yx_sl_item_t * pItemCmd;
 
     /* ·δ */
     if (sgYxSeiralDlObj.uConnectFlag != CONNECT_FLAG_CONNECT) {
@@ -928,36 +1440,28 @@ int Yx_Serial_Link_Send2List(BOOLEAN need_ack, int cmd, INT8U* pdata, int len)
         return sta;
     }
 
+    if (len > YX_SERIAL_LINK_TX_LEN_MAX) {
+        LINK_LOG_ERROR("<Serial Link>: Tx Len Over!!");
+        return sta;
+    }
+
     _yx_serial_link_lock();
-    pItemCmd = (yx_sl_item_t*)yx_malloc(len + sizeof(yx_sl_head_t));
-    if (pItemCmd != NULL) {
-        node = YX_LIST_FIRST_ENTRY(&sgYxSeiralDlObj.stFreeList, serial_item_node_t, list);
-        yx_list_del(&node->list);
-        pItemCmd->Head.head[0]  =  YX_SERIAL_LINK_HEAD_DOWN_1;
-        pItemCmd->Head.head[1]  =  YX_SERIAL_LINK_HEAD_DOWN_2;
-        pItemCmd->Head.dev_type =  YX_SERIAL_LINK_DEVICE_TYPE;
-        pItemCmd->Head.cmd_h    =  ((cmd >> 8) & 0xFF);
-        pItemCmd->Head.cmd_l    =  (cmd & 0xFF);
-        pItemCmd->Head.len_h    =  ((len >> 8) & 0xFF);
-        pItemCmd->Head.len_l    =  (len & 0xFF);
-
-        if (len != 0 && len <= YX_SERIAL_LINK_TX_LEN_MAX && pdata != NULL) {
-            memcpy(pItemCmd->Data, pdata, len);
-        }
-        
-        pItemCmd->Head.crc =  yx_chksum_getxor(&pItemCmd->Head.cmd_h, len + 4);
+    node = YX_LIST_FIRST_ENTRY(&sgYxSeiralDlObj.stFreeList, serial_item_node_t, list);
+    yx_list_del(&node->list);
 
-        node->node_attrib = need_ack;
-        node->node_repeat = 3;
-        node->node_time   = 3;
-        node->node_len    = len + sizeof(yx_sl_head_t);
-        node->databuf     = (INT8U*)pItemCmd;
-        yx_list_add_before(&sgYxSeiralDlObj.stWaitTxList, &node->list);
-        _yx_serial_send_tx_req_msg();
-        sta = SUCC;
-    } else {
-        LINK_LOG_ERROR("<Serial Link>: Ram Not Enough!!");
+    if (len != 0 && pdata != NULL) {
+        memcpy(node->databuf + SL_DATA_OFFSET, pdata, len);                     /* ֡ͷڷʱд */
     }
+
+    node->node_attrib = need_ack;
+    node->node_repeat = 3;
+    node->node_time   = 3;
+    node->node_flag   = 0;
+    node->node_cmd    = cmd;
+    node->node_len    = len;
+    yx_list_add_before(&sgYxSeiralDlObj.stWaitTxList, &node->list);
+    _yx_serial_send_tx_req_msg();
+    sta = SUCC;
     
     _yx_serial_link_unlock();
         
@@ -976,28 +1480,23 @@ int Yx_Serial_Link_Send(int cmd, INT8U* pdata, int len)
 {
     int sta = FAIL;
     serial_item_node_t* node;
-    yx_sl_item_t * pItemCmd;
+    INT8U* frame;
+    int framelen;
     
+    if (len > YX_SERIAL_LINK_TX_LEN_MAX) {
+        LINK_LOG_ERROR("<Serial Link>: Tx Len Over!!");
+        return sta;
+    }
+
     /* ·δ */
     _yx_serial_link_lock();
-    pItemCmd = (yx_sl_item_t*)sgYxSeiralDlObj.tx_buf;
-    pItemCmd->Head.head[0]  =  YX_SERIAL_LINK_HEAD_DOWN_1;
-    pItemCmd->Head.head[1]  =  YX_SERIAL_LINK_HEAD_DOWN_2;
-    pItemCmd->Head.dev_type =  YX_SERIAL_LINK_DEVICE_TYPE;
-    pItemCmd->Head.cmd_h    =  ((cmd >> 8) & 0xFF);
-    pItemCmd->Head.cmd_l    =  (cmd & 0xFF);
-    pItemCmd->Head.len_h    =  ((len >> 8) & 0xFF);
-    pItemCmd->Head.len_l    =  (len & 0xFF);
-
-    if (len != 0 && len <= YX_SERIAL_LINK_TX_LEN_MAX && pdata != NULL) {
-        memcpy(pItemCmd->Data, pdata, len);
+    if (len != 0 && pdata != NULL) {
+        memcpy(sgYxSeiralDlObj.tx_buf + SL_DATA_OFFSET, pdata, len);
     }
-    
-    pItemCmd->Head.crc = yx_chksum_getxor(&pItemCmd->Head.cmd_h, len + 4);
-
+    frame = _yx_serial_build_frame(sgYxSeiralDlObj.tx_buf + SL_DATA_OFFSET, len, cmd, 0, 0, &framelen);
 	
 	if (1) {//(sgYxSeiralDlObj.uConnectFlag == CONNECT_FLAG_CONNECT || cmd == 0x21) {
-		if (_yx_serial_link_hw_senddata(sgYxSeiralDlObj.tx_buf, len + sizeof(yx_sl_head_t)) != 0) {
+		if (_yx_serial_link_hw_senddata(frame, framelen) != 0) {
 			sta = SUCC;
 		}
 	} else {
@@ -1008,22 +1507,18 @@ int Yx_Serial_Link_Send(int cmd, INT8U* pdata, int len)
         if (yx_list_empty(&sgYxSeiralDlObj.stFreeList)) {
             LINK_LOG_ERROR("<Serial Link>: FreeList Empty!!");
         } else  {
-            pItemCmd = (yx_sl_item_t*)yx_malloc(len + sizeof(yx_sl_head_t));
-            if (pItemCmd != NULL) {
-                node = YX_LIST_FIRST_ENTRY(&sgYxSeiralDlObj.stFreeList, serial_item_node_t, list);
-                yx_list_del(&node->list);
-                memcpy(pItemCmd,sgYxSeiralDlObj.tx_buf, len + sizeof(yx_sl_head_t));
-                node->node_attrib = 0;
-                node->node_repeat = 1;
-                node->node_time   = 1;
-                node->node_len    = len + sizeof(yx_sl_head_t);
-                node->databuf     = (INT8U*)pItemCmd;
-                yx_list_add_before(&sgYxSeiralDlObj.stWaitTxList, &node->list);
-                _yx_serial_send_tx_req_msg();
-                sta = SUCC;
-            } else {
-                LINK_LOG_ERROR("<Serial Link>: Ram Not Enough!!");
-            }
+            node = YX_LIST_FIRST_ENTRY(&sgYxSeiralDlObj.stFreeList, serial_item_node_t, list);
+            yx_list_del(&node->list);
+            memcpy(node->databuf + SL_DATA_OFFSET, sgYxSeiralDlObj.tx_buf + SL_DATA_OFFSET, len);
+            node->node_attrib = 0;
+            node->node_repeat = 1;
+            node->node_time   = 1;
+            node->node_flag   = 0;
+            node->node_cmd    = cmd;
+            node->node_len    = len;
+            yx_list_add_before(&sgYxSeiralDlObj.stWaitTxList, &node->list);
+            _yx_serial_send_tx_req_msg();
+            sta = SUCC;
         }
     }
     
@@ -1099,4 +1594,31 @@ void Yx_Serial_Link_WakeUp(void)
     Yx_Serial_Link_Start();
 }
 
+/*******************************************************************************
+** :     Yx_Serial_Link_SetWindow
+** :   ñ˴, ´ЭʱЧ
+** :  win , 0 ʹþЭ
+** ز:  
+******************************************************************************/
+void Yx_Serial_Link_SetWindow(INT8U win)
+{
+    sgSerialWinCfg = YX_MIN(win, YX_SERIAL_LINK_WIN_MAX);
+}
 
+/*******************************************************************************
+** :     Yx_Serial_Link_GetStat
+** :   ȡ·ͳϢ
+** :  pStat ͳϢ
+** ز:  
+******************************************************************************/
+void Yx_Serial_Link_GetStat(yx_sl_stat_t* pStat)
+{
+    _yx_serial_link_lock();
+    memcpy(pStat, &sgYxSeiralDlObj.stat, sizeof(yx_sl_stat_t));
+    pStat->srtt_ms  = sgYxSeiralDlObj.srtt >> 3;
+    pStat->rto_ms   = sgYxSeiralDlObj.rto;
+    pStat->win_size = sgYxSeiralDlObj.win_size;
+    pStat->crc_mode = sgYxSeiralDlObj.crc_mode;
+    pStat->rx_crc_err = sgYxSeiralDlObj.parser.stat.crc_err;
+    _yx_serial_link_unlock();
+}
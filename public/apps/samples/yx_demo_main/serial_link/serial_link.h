@@ -31,6 +31,38 @@
 
 #define YX_SERIAL_LINK_REQ_CMD                  0x001
 #define YX_SERIAL_LINK_BEAT_CMD                 0x002
+#define YX_SERIAL_LINK_WACK_CMD                 0x003                           /* ģʽȷ֡ */
+
+/*
+ * ģʽ
+ *  Data[0] Ϊ, ִ֧ڵĶԶ׷ Data[1] ڴС, Data[2] Ự;
+ * Ӧ Data[1] ΪЭ̴, Data[2] Զ˻Ự, Data[3] Ϊ˻Ự;
+ * һ˻Ựű仯ʱ˫Ŵ 0 ʼ. ɰ汾Զֻ Data[0], ·ԭЭ.
+ * ģʽ³/, ÿ֡ǰ yx_sl_win_t:
+ * ack Ϊյһ(ۼȷ), sack  bit i ʾյ ack+1+i ֡(ѡȷ),
+ * ֡Ӵȷ, ݿӴʱ YX_SERIAL_LINK_WACK_CMD.
+ */
+#ifndef YX_SERIAL_LINK_WIN_MAX
+#define YX_SERIAL_LINK_WIN_MAX                  64                              /* ˴, 2 Ҳ 128(8 λ), 򻺴С */
+#endif
+#define YX_SL_SACK_BITS                         16                              /* sack λͼ ack ֮֡ */
+
+#define YX_SL_WIN_FLAG_SEQ                      0x01                            /* seq Ч, ȷ */
+
+/*
+ * У鷽ʽЭ
+ *  Data[3] ΪԶֵ֧У鷽ʽλͼ YX_SL_CRC_CAP_xxx (Data[1]/Data[2] ôʱ 0),
+ * Ӧ Data[4] ѡУ鷽ʽ YX_SL_CRC_xxx, Զδ Data[3] ʱάУ.
+ * CRC ģʽ֡ʽ, 󸽼Ӹֽǰ CRC,  dev_type ĩβ, 볤ֶ;
+ * Ӧʼղ CRC.
+ */
+#define YX_SL_CRC_XOR                           0
+#define YX_SL_CRC_16                            1                               /* CRC-16/CCITT-FALSE */
+#define YX_SL_CRC_32                            2                               /* CRC-32 (IEEE 802.3) */
+#define YX_SL_CRC_CAP_16                        0x01
+#define YX_SL_CRC_CAP_32                        0x02
+#define YX_SL_CRC_LEN_MAX                       4
+#define YX_SERIAL_LINK_CRC_CAP                  (YX_SL_CRC_CAP_16 | YX_SL_CRC_CAP_32)   /* ֵ֧У鷽ʽ */
 
 
 
@@ -49,8 +81,34 @@ typedef struct {
     yx_sl_head_t      Head;
     INT8U             Data[1];
 } yx_sl_item_t;
+
+typedef struct {
+    INT8U  flags;
+    INT8U  seq;
+    INT8U  ack;
+    INT8U  sack_h;
+    INT8U  sack_l;
+} yx_sl_win_t;
 #pragma pack()
 
+typedef struct {
+    INT32U  tx_frames;                                                          /* ֡(ط) */
+    INT32U  retrans;                                                            /* ط֡ */
+    INT32U  rx_frames;                                                          /* Ͻ֡ */
+    INT32U  srtt_ms;                                                            /* ƽʱ */
+    INT32U  rto_ms;                                                             /* ǰطʱ */
+    INT32U  rx_crc_err;                                                         /* У */
+    INT8U   win_size;                                                           /* Э̴, 0 ΪЭ */
+    INT8U   crc_mode;                                                           /* ЭУ鷽ʽ */
+} yx_sl_stat_t;
+
+typedef struct {
+    INT32U  count;                                                              /* ַ֡ */
+    INT64U  bytes;                                                              /* ַֽ(֡ͷ) */
+    INT64U  time_ns;                                                            /* ӿۼƺʱ */
+    INT32U  time_max_ns;                                                        /* ӿڵʱ */
+} yx_sl_cmd_stat_t;
+
 
 typedef enum {
     YX_SL_EVENT_NONE,
@@ -127,7 +185,8 @@ void Yx_Serial_Link_Init(void);
 **                                  2β: ûָ
 **                                  3β: ûݳ
 ** :       TRUE:  עɹ
-**           FALSE: עʧ, ֮ǰעӿ֡ͷΧϳص
+**           FALSE: עʧ, ֮ǰעӿ֡ͷΧϳص,
+**                   YX_SL_DISPATCH_CMD_MAX
 ********************************************************************/
 BOOLEAN Yx_Serial_Link_DispatcherRegister(INT32U b_cmd, INT32U e_cmd, void (*handler)(const INT8U *, INT32U));
 
@@ -211,6 +270,42 @@ void Yx_Serial_Link_Sleep(void);
 ******************************************************************************/
 void Yx_Serial_Link_WakeUp(void);
 
+/*******************************************************************************
+** :     Yx_Serial_Link_GetCmdStat
+** :   ȡעֵķַͳϢ
+** :  cmd , pStat ͳϢ
+** ز:  TRUE ɹ; FALSE δע
+******************************************************************************/
+BOOLEAN Yx_Serial_Link_GetCmdStat(INT16U cmd, yx_sl_cmd_stat_t* pStat);
+
+/*******************************************************************************
+** :     Yx_Serial_Link_SetRxDirect
+** :   ýֱ߳ӽַ, Ϣת·߳.
+**            ӿִ߳, ʱƳһշ, ӿӦ췵
+** :  bDirect TRUE ֱ߳ӷַ; FALSE Ϣ·̷ַ߳(Ĭ)
+** ز:  
+******************************************************************************/
+void Yx_Serial_Link_SetRxDirect(BOOLEAN bDirect);
+
+/*******************************************************************************
+** :     Yx_Serial_Link_GetStat
+** :   ȡ·ͳϢ
+** :  pStat ͳϢ
+** ز:  
+******************************************************************************/
+void Yx_Serial_Link_GetStat(yx_sl_stat_t* pStat);
+
+/*******************************************************************************
+** :     Yx_Serial_Link_SetWindow
+** :   ñ˴, ´ЭʱЧ, Э̽ȡ˫Сֵ.
+**            ӦǴʱӻ,  ֡ x RTT, Сʱ·µھЭ;
+**            ;֡ͬʱܷͽڵ YX_SERIAL_ITEM_NODE_USED_MAX 
+** :  win ,  YX_SERIAL_LINK_WIN_MAX ʱȡ; 0 ʹþЭ
+**            Ĭ YX_SERIAL_LINK_WIN_MAX
+** ز:  
+******************************************************************************/
+void Yx_Serial_Link_SetWindow(INT8U win);
+
 #endif
 
 
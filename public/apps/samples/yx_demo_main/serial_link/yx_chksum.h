@@ -80,6 +80,28 @@ INT8U yx_chksum_getsum_c(INT8U *dptr, INT16U len);
 ********************************************************************/
 INT8U yx_chksum_getxor(INT8U *Ptr, INT32U Len);
 
+#define YX_CRC16_INIT       0xFFFF
+
+/*******************************************************************
+** :     yx_chksum_crc16
+** :    CRC-16/CCITT-FALSE, ɷֶ
+** :       [in]  crc:           ֵ, ׶δ YX_CRC16_INIT, δһν
+**             [in]  ptr:           ַ
+**             [in]  len:           
+** :       CRC-16 У
+********************************************************************/
+INT16U yx_chksum_crc16(INT16U crc, INT8U *ptr, INT32U len);
+
+/*******************************************************************
+** :     yx_chksum_crc32
+** :    CRC-32 (IEEE 802.3), ɷֶ
+** :       [in]  crc:           ֵ, ׶δ 0, δһν
+**             [in]  ptr:           ַ
+**             [in]  len:           
+** :       CRC-32 У
+********************************************************************/
+INT32U yx_chksum_crc32(INT32U crc, INT8U *ptr, INT32U len);
+
 #endif
 
 
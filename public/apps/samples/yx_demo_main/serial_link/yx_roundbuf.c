@@ -217,3 +217,87 @@ INT16U yx_roundbuf_space_len(yx_roundbuf_t *rb)
     return (INT16U)(rb->buffer_size -rb->write_index + rb->read_index);
 }
 
+
+/*******************************************************************
+** :     yx_roundbuf_peek
+** :   ӻλָƫƴ, ƶָ
+** :       [in]  rb:            λ
+**             [in]  offset:        Զָƫ
+**             [out] ptr:           ָ
+**             [in]  length:        ݳ
+** :       ʵʸݳ
+********************************************************************/
+INT32S yx_roundbuf_peek(yx_roundbuf_t *rb, INT16U offset, INT8U *ptr, INT16U length)
+{
+	INT16U l, datalen;
+	INT32U index;
+
+	datalen = (INT16U)(rb->write_index - rb->read_index);
+	if (offset >= datalen) {
+		return 0;
+	}
+	length = MIN(length, datalen - offset);
+	index  = (rb->read_index + offset) & (rb->buffer_size - 1);
+	l = MIN(length, rb->buffer_size - index);
+	memcpy(ptr, rb->buffer_ptr + index, l);
+	if (l < length) {
+		memcpy(ptr + l, rb->buffer_ptr, length - l);
+	}
+	return length;
+}
+
+/*******************************************************************
+** :     yx_roundbuf_get_ptr
+** :   ȡָ봦ɶ, ȡ yx_roundbuf_skip
+** :       [in]  rb:            λ
+**             [out] length:        ݳ
+** :       ַ
+********************************************************************/
+INT8U* yx_roundbuf_get_ptr(yx_roundbuf_t *rb, INT16U *length)
+{
+	INT32U index = rb->read_index & (rb->buffer_size - 1);
+
+	*length = MIN(rb->write_index - rb->read_index, rb->buffer_size - index);
+	return rb->buffer_ptr + index;
+}
+
+/*******************************************************************
+** :     yx_roundbuf_skip
+** :   λͷ
+** :       [in]  rb:            λ
+**             [in]  length:        
+** :       ʵʶ
+********************************************************************/
+INT16U yx_roundbuf_skip(yx_roundbuf_t *rb, INT16U length)
+{
+	length = MIN(length, rb->write_index - rb->read_index);
+	rb->read_index += length;
+	return length;
+}
+
+/*******************************************************************
+** :     yx_roundbuf_put_ptr
+** :   ȡдָ봦дĿռ, д yx_roundbuf_put_commit
+** :       [in]  rb:            λ
+**             [out] length:        ռ䳤
+** :       ռַ
+********************************************************************/
+INT8U* yx_roundbuf_put_ptr(yx_roundbuf_t *rb, INT16U *length)
+{
+	INT32U index = rb->write_index & (rb->buffer_size - 1);
+
+	*length = MIN(rb->buffer_size - rb->write_index + rb->read_index, rb->buffer_size - index);
+	return rb->buffer_ptr + index;
+}
+
+/*******************************************************************
+** :     yx_roundbuf_put_commit
+** :   ύֱд yx_roundbuf_put_ptr ռ
+** :       [in]  rb:            λ
+**             [in]  length:        д볤
+** :       
+********************************************************************/
+void yx_roundbuf_put_commit(yx_roundbuf_t *rb, INT16U length)
+{
+	rb->write_index += length;
+}
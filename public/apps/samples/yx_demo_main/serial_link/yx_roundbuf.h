@@ -128,6 +128,53 @@ INT16U yx_roundbuf_data_len(yx_roundbuf_t *rb);
 ********************************************************************/
 INT16U yx_roundbuf_space_len(yx_roundbuf_t *rb); 
 
+/*******************************************************************
+** :     yx_roundbuf_peek
+** :   ӻλָƫƴ, ƶָ
+** :       [in]  rb:            λ
+**             [in]  offset:        Զָƫ
+**             [out] ptr:           ָ
+**             [in]  length:        ݳ
+** :       ʵʸݳ
+********************************************************************/
+INT32S yx_roundbuf_peek(yx_roundbuf_t *rb, INT16U offset, INT8U *ptr, INT16U length);
+
+/*******************************************************************
+** :     yx_roundbuf_get_ptr
+** :   ȡָ봦ɶ, ȡ yx_roundbuf_skip
+** :       [in]  rb:            λ
+**             [out] length:        ݳ
+** :       ַ
+********************************************************************/
+INT8U* yx_roundbuf_get_ptr(yx_roundbuf_t *rb, INT16U *length);
+
+/*******************************************************************
+** :     yx_roundbuf_skip
+** :   λͷ
+** :       [in]  rb:            λ
+**             [in]  length:        
+** :       ʵʶ
+********************************************************************/
+INT16U yx_roundbuf_skip(yx_roundbuf_t *rb, INT16U length);
+
+/*******************************************************************
+** :     yx_roundbuf_put_ptr
+** :   ȡдָ봦дĿռ, д yx_roundbuf_put_commit
+** :       [in]  rb:            λ
+**             [out] length:        ռ䳤
+** :       ռַ
+********************************************************************/
+INT8U* yx_roundbuf_put_ptr(yx_roundbuf_t *rb, INT16U *length);
+
+/*******************************************************************
+** :     yx_roundbuf_put_commit
+** :   ύֱд yx_roundbuf_put_ptr ռ
+** :       [in]  rb:            λ
+**             [in]  length:        д볤
+** :       
+********************************************************************/
+void yx_roundbuf_put_commit(yx_roundbuf_t *rb, INT16U length);
+
 
 #endif
 
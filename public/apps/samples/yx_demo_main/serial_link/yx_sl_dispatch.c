@@ -0,0 +1,109 @@
+#include <string.h>
+#include <time.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_sl_dispatch.h"
+
+
+static inline INT8U _yx_sl_dispatch_index(yx_sl_dispatch_t* d, INT16U cmd)
+{
+    return d->slot[d->page[cmd >> 8]][cmd & 0xFF];
+}
+
+static inline INT64U _yx_sl_dispatch_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT64U)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void yx_sl_dispatch_init(yx_sl_dispatch_t* d)
+{
+    memset(d, 0, sizeof(yx_sl_dispatch_t));
+}
+
+BOOLEAN yx_sl_dispatch_register(yx_sl_dispatch_t* d, INT16U b_cmd, INT16U e_cmd, yx_sl_handler_t handler)
+{
+    INT32U cmd;
+    INT8U  hi, newpages = 0;
+    BOOLEAN used[256];
+
+    if (handler == NULL || b_cmd > e_cmd || (INT32U)(e_cmd - b_cmd) + 1 > (INT32U)(YX_SL_DISPATCH_CMD_MAX - d->cmds)) {
+        return FALSE;
+    }
+
+    memset(used, 0, sizeof(used));
+    for (cmd = b_cmd; cmd <= e_cmd; cmd++) {                                    /* ȼ, ʧʱĶַ */
+        hi = cmd >> 8;
+        if (_yx_sl_dispatch_index(d, cmd) != 0) {
+            return FALSE;
+        }
+        if (d->page[hi] == 0 && !used[hi]) {
+            used[hi] = TRUE;
+            newpages++;
+        }
+    }
+    if (d->pages + newpages > YX_SL_DISPATCH_PAGE_MAX) {
+        return FALSE;
+    }
+
+    for (cmd = b_cmd; cmd <= e_cmd; cmd++) {
+        hi = cmd >> 8;
+        if (d->page[hi] == 0) {
+            d->page[hi] = ++d->pages;
+        }
+        d->cmds++;
+        memset(&d->ent[d->cmds], 0, sizeof(yx_sl_dispatch_ent_t));
+        d->ent[d->cmds].handler = handler;
+        d->slot[d->page[hi]][cmd & 0xFF] = d->cmds;
+    }
+    return TRUE;
+}
+
+BOOLEAN yx_sl_dispatch_frame(yx_sl_dispatch_t* d, const INT8U* pframe, INT32U len)
+{
+    const yx_sl_head_t* pHead = (const yx_sl_head_t*)pframe;
+    yx_sl_dispatch_ent_t* pEnt;
+    INT64U start, cost;
+    INT8U index;
+
+    index = _yx_sl_dispatch_index(d, (pHead->cmd_h << 8) | pHead->cmd_l);
+    if (index == 0) {
+        d->miss++;
+        return FALSE;
+    }
+
+    pEnt = &d->ent[index];
+    pEnt->stat.count++;
+    pEnt->stat.bytes += len;
+    if (d->no_timing) {
+        pEnt->handler(pframe, len);
+        return TRUE;
+    }
+
+    start = _yx_sl_dispatch_time_ns();
+    pEnt->handler(pframe, len);
+    cost  = _yx_sl_dispatch_time_ns() - start;
+    pEnt->stat.time_ns += cost;
+    if (cost > pEnt->stat.time_max_ns) {
+        pEnt->stat.time_max_ns = (INT32U)YX_MIN(cost, 0xFFFFFFFFULL);
+    }
+    return TRUE;
+}
+
+BOOLEAN yx_sl_dispatch_get_stat(yx_sl_dispatch_t* d, INT16U cmd, yx_sl_cmd_stat_t* pStat)
+{
+    INT8U index = _yx_sl_dispatch_index(d, cmd);
+
+    if (index == 0) {
+        return FALSE;
+    }
+    *pStat = d->ent[index].stat;
+    return TRUE;
+}
+
+void yx_sl_dispatch_set_timing(yx_sl_dispatch_t* d, BOOLEAN bOn)
+{
+    d->no_timing = !bOn;
+}
@@ -0,0 +1,72 @@
+#ifndef _YX_SL_DISPATCH_H_
+#define _YX_SL_DISPATCH_H_
+#include "def.h"
+#include "serial_link.h"
+
+/*
+ * ·ַ֡, ֱ, ע޹.
+ * ָֽҳ, ֽҳڲۺ, ۺ 0 ҳ 0 ʾδע, ȫ㼴Ϊձ,
+ * ˾̬ķַʼע. ÿֵռһ۲¼ͳϢ.
+ * עڿʼַǰ; ַͳɵһ߳̽.
+ */
+#define YX_SL_DISPATCH_CMD_MAX                  255                             /* ע */
+#define YX_SL_DISPATCH_PAGE_MAX                 16                              /* ʹõָֽڸ */
+
+typedef void (*yx_sl_handler_t)(const INT8U *, INT32U);
+
+typedef struct {
+    yx_sl_handler_t     handler;
+    yx_sl_cmd_stat_t    stat;
+} yx_sl_dispatch_ent_t;
+
+typedef struct {
+    INT8U               page[256];                                              /* ָֽ -> ҳ */
+    INT8U               slot[YX_SL_DISPATCH_PAGE_MAX + 1][256];                 /* ҳڵֽ -> ۺ,  0 ҳΪ */
+    yx_sl_dispatch_ent_t ent[YX_SL_DISPATCH_CMD_MAX + 1];                      /*  0 Ϊδע */
+    INT8U               pages;
+    INT8U               cmds;
+    BOOLEAN             no_timing;                                              /* ͳƴʱ */
+    INT32U              miss;                                                   /* δע֡ */
+} yx_sl_dispatch_t;
+
+/*******************************************************************************
+** :     yx_sl_dispatch_init
+** :   շַ
+** :  d ַ
+** ز:  
+******************************************************************************/
+void yx_sl_dispatch_init(yx_sl_dispatch_t* d);
+
+/*******************************************************************************
+** :     yx_sl_dispatch_register
+** :   עַΧ [b_cmd, e_cmd] Ĵӿ, Χÿռһ
+** :  d ַ, b_cmd/e_cmd ʼ/, handler ӿ
+** ز:  TRUE ɹ; FALSE ΧǷ, עص/ҳ, ʱַ
+******************************************************************************/
+BOOLEAN yx_sl_dispatch_register(yx_sl_dispatch_t* d, INT16U b_cmd, INT16U e_cmd, yx_sl_handler_t handler);
+
+/*******************************************************************************
+** :     yx_sl_dispatch_frame
+** :   ֡ͷֵôӿڲͳ
+** :  d ַ, pframe ֡(֡ͷ), len ֡
+** ز:  TRUE Ѵ; FALSE δע
+******************************************************************************/
+BOOLEAN yx_sl_dispatch_frame(yx_sl_dispatch_t* d, const INT8U* pframe, INT32U len);
+
+/*******************************************************************************
+** :     yx_sl_dispatch_get_stat
+** :   ȡͳϢ
+** :  d ַ, cmd , pStat ͳϢ
+** ز:  TRUE ɹ; FALSE δע
+******************************************************************************/
+BOOLEAN yx_sl_dispatch_get_stat(yx_sl_dispatch_t* d, INT16U cmd, yx_sl_cmd_stat_t* pStat);
+
+/*******************************************************************************
+** :     yx_sl_dispatch_set_timing
+** :   شʱͳ, ĬϿ
+** :  d ַ, bOn TRUE 
+** ز:  
+******************************************************************************/
+void yx_sl_dispatch_set_timing(yx_sl_dispatch_t* d, BOOLEAN bOn);
+
+#endif
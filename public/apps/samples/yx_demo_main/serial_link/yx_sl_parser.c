@@ -0,0 +1,149 @@
+#include <string.h>
+#include "def.h"
+#include "serial_link.h"
+#include "yx_chksum.h"
+#include "yx_string.h"
+#include "yx_sl_parser.h"
+
+
+/* Ӧʼղ CRC, һ˸λЭ */
+static inline INT8U _yx_sl_crc_len(INT8U crc_mode, INT16U cmd)
+{
+    if (cmd == YX_SERIAL_LINK_REQ_CMD) {
+        return 0;
+    }
+    switch (crc_mode) {
+    case YX_SL_CRC_16:
+        return 2;
+    case YX_SL_CRC_32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+/* CRC  dev_type ĩβ(Уา dev_type); CRC ģʽ²ظ֡ͷУ */
+static BOOLEAN _yx_sl_frame_check(INT8U* frame, int size, INT8U crc_len)
+{
+    yx_sl_head_t* pHead = (yx_sl_head_t*)frame;
+    INT8U* pCrc = frame + sizeof(yx_sl_head_t) + size;
+
+    switch (crc_len) {
+    case 2:
+        return yx_chksum_crc16(YX_CRC16_INIT, &pHead->dev_type, size + 5) == yx_str_char2short_msb(pCrc);
+    case 4:
+        return yx_chksum_crc32(0, &pHead->dev_type, size + 5) == yx_str_char2long_msb(pCrc);
+    default:
+        return pHead->crc == yx_chksum_getxor(&pHead->cmd_h, size + 4);
+    }
+}
+
+void yx_sl_parser_init(yx_sl_parser_t* p, INT8U* pool, INT16U size, INT8U* frame, INT16U frame_max)
+{
+    memset(p, 0, sizeof(yx_sl_parser_t));
+    yx_roundbuf_init(&p->ring, pool, size);
+    p->frame     = frame;
+    p->frame_max = frame_max;
+    p->crc_mode  = YX_SL_CRC_XOR;
+}
+
+void yx_sl_parser_set_crc(yx_sl_parser_t* p, INT8U crc_mode)
+{
+    p->crc_mode = crc_mode;
+}
+
+/* λдָΪļ, ±ȡλ; ·ֱӲ, ٺ */
+int yx_sl_parser_next(yx_sl_parser_t* p, INT8U** frame)
+{
+    yx_roundbuf_t* rb = &p->ring;
+    yx_sl_head_t head;
+    yx_sl_head_t* pHead;
+    INT8U *pdata, *phit, *pframe;
+    INT32U index, datalen, seglen, size, total;
+    INT8U crc_len;
+
+    for (;;) {
+        datalen = rb->write_index - rb->read_index;
+        if (datalen == 0) {
+            return 0;
+        }
+        index  = rb->read_index & (rb->buffer_size - 1);
+        pdata  = rb->buffer_ptr + index;
+        seglen = YX_MIN(datalen, rb->buffer_size - index);                      /* β */
+
+        if (*pdata != YX_SERIAL_LINK_HEAD_UP_1) {                               /* λ֡ͷ, ÿβΪֹ */
+            phit = (INT8U*)memchr(pdata, YX_SERIAL_LINK_HEAD_UP_1, seglen);
+            if (phit != NULL) {
+                seglen = phit - pdata;
+            }
+            rb->read_index     += seglen;
+            p->stat.skip_bytes += seglen;
+            continue;
+        }
+
+        if (datalen < sizeof(yx_sl_head_t)) {
+            return 0;
+        }
+        if (seglen >= sizeof(yx_sl_head_t)) {                                   /* ֡ͷڻʱֱӶȡ */
+            pHead = (yx_sl_head_t*)pdata;
+        } else {
+            yx_roundbuf_peek(rb, 0, (INT8U*)&head, sizeof(yx_sl_head_t));
+            pHead = &head;
+        }
+        if (pHead->head[1] != YX_SERIAL_LINK_HEAD_UP_2) {
+            rb->read_index++;
+            p->stat.skip_bytes++;
+            continue;
+        }
+
+        size = (pHead->len_h << 8) | pHead->len_l;
+        if (size + sizeof(yx_sl_head_t) > p->frame_max) {
+            p->stat.len_err++;
+            rb->read_index     += 2;
+            p->stat.skip_bytes += 2;
+            continue;
+        }
+        crc_len = _yx_sl_crc_len(p->crc_mode, (pHead->cmd_h << 8) | pHead->cmd_l);
+        total   = sizeof(yx_sl_head_t) + size + crc_len;
+        if (datalen < total) {                                                  /* ֡, ȴ */
+            return 0;
+        }
+
+        if (seglen >= total) {                                                  /* , ԭУ */
+            pframe = pdata;
+        } else {
+            yx_roundbuf_peek(rb, 0, p->frame, total);
+            pframe = p->frame;
+        }
+        if (!_yx_sl_frame_check(pframe, size, crc_len)) {
+            p->stat.crc_err++;
+            rb->read_index     += 2;
+            p->stat.skip_bytes += 2;
+            continue;
+        }
+
+        rb->read_index += total;
+        p->stat.frames++;
+        *frame = pframe;
+        return sizeof(yx_sl_head_t) + size;
+    }
+}
+
+int yx_sl_frame_seal(INT8U* frame, int size, INT8U crc_mode)
+{
+    yx_sl_head_t* pHead = (yx_sl_head_t*)frame;
+    INT8U* pCrc = frame + sizeof(yx_sl_head_t) + size;
+    INT8U crc_len;
+
+    pHead->len_h = (size >> 8) & 0xFF;
+    pHead->len_l = size & 0xFF;
+    pHead->crc   = yx_chksum_getxor(&pHead->cmd_h, size + 4);
+
+    crc_len = _yx_sl_crc_len(crc_mode, yx_str_char2short_msb(&pHead->cmd_h));
+    if (crc_len == 2) {
+        yx_str_short2char_msb(pCrc, yx_chksum_crc16(YX_CRC16_INIT, &pHead->dev_type, size + 5));
+    } else if (crc_len == 4) {
+        yx_str_long2char_msb(pCrc, yx_chksum_crc32(0, &pHead->dev_type, size + 5));
+    }
+    return sizeof(yx_sl_head_t) + size + crc_len;
+}
@@ -0,0 +1,63 @@
+#ifndef _YX_SL_PARSER_H_
+#define _YX_SL_PARSER_H_
+#include "def.h"
+#include "yx_roundbuf.h"
+
+/*
+ * ·֡, ֱ 2 ݴС yx_roundbuf λϽ.
+ * ݾ yx_roundbuf_put_ptr/yx_roundbuf_put_commit ֱд뻷,  memchr λ֡ͷ,
+ * Уֻͨƶָ, ʣ. ֡ԭط, Խβ֡Ƶ frame 󷵻.
+ * ص֡һλдǰЧ.
+ */
+typedef struct {
+    INT32U  frames;                                                             /* ֡ */
+    INT32U  crc_err;                                                            /* У */
+    INT32U  len_err;                                                            /* ȳ */
+    INT32U  skip_bytes;                                                         /* ķ֡ */
+} yx_sl_parser_stat_t;
+
+typedef struct {
+    yx_roundbuf_t   ring;
+    INT8U*          frame;                                                      /* β֡ƴӻ */
+    INT16U          frame_max;                                                  /* ֡ͷ󳤶,  CRC */
+    INT8U           crc_mode;                                                   /* YX_SL_CRC_xxx */
+    yx_sl_parser_stat_t stat;
+} yx_sl_parser_t;
+
+/*******************************************************************************
+** :     yx_sl_parser_init
+** :   ʼ
+** :  pool λ, size Ϊ 2 Ҵ frame_max + YX_SL_CRC_LEN_MAX
+**            frame ƴӻ, С frame_max + YX_SL_CRC_LEN_MAX
+**            frame_max ֡ͷ󳤶
+** ز:  
+******************************************************************************/
+void yx_sl_parser_init(yx_sl_parser_t* p, INT8U* pool, INT16U size, INT8U* frame, INT16U frame_max);
+
+/*******************************************************************************
+** :     yx_sl_parser_set_crc
+** :   ýУ鷽ʽ
+** :  crc_mode YX_SL_CRC_xxx
+** ز:  
+******************************************************************************/
+void yx_sl_parser_set_crc(yx_sl_parser_t* p, INT8U crc_mode);
+
+/*******************************************************************************
+** :     yx_sl_parser_next
+** :   ӻλȡһУͨ֡
+** :  frame ֡ʼַ(֡ͷ)
+** ز:  ֡(֡ͷ,  CRC), ݲһ֡ʱ 0
+******************************************************************************/
+int yx_sl_parser_next(yx_sl_parser_t* p, INT8U** frame);
+
+/*******************************************************************************
+** :     yx_sl_frame_seal
+** :   ǰд֡ȼУ: ֡ͷ crc ΪУ, CRC ģʽ׷ CRC
+** :  frame ֡ʼַ, ֡ͷд, Ԥ YX_SL_CRC_LEN_MAX ֽ
+**            size 
+**            crc_mode YX_SL_CRC_xxx
+** ز:  ͳ
+******************************************************************************/
+int yx_sl_frame_seal(INT8U* frame, int size, INT8U crc_mode);
+
+#endif
@@ -2,15 +2,23 @@
 #include <fcntl.h>
 #include <linux/ioctl.h>
 #include <linux/spi/spidev.h>
-#include <sys/select.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <string.h>
 #include "def.h"
 #include "yx_drv_gpio.h"
 #include "yx_spi_drv.h"
 #include "yx_roundbuf.h"
+#include "yx_chksum.h"
 #include <pthread.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <time.h>
+#ifdef YX_SPI_DRV_SIM
+#include "yx_spidev_sim.h"
+#endif
 
 
 
@@ -27,17 +35,27 @@
 #define YX_SPI_DRV_TX_BUF_SIZE   2048
 #define YX_SPI_DRV_RX_BUF_SIZE   2048
 
-#define YX_SPI_FIX_BUF_SIZE      64
 #define YX_SPI_FILL_BYTE         0x00
+#define YX_SPI_IDLE_POLL_MS      500                                            /* ޾жʱĿѯ */
+#define YX_SPI_VL_BAD_MAX        8                                              /* յǷͷ, ˻ع̶ */
+#define YX_SPI_RX_WAIT_MAX       20                                             /* ջʱȴ ms */
+#define YX_SPI_TX_FULL_LOG_S     1                                              /* ͻĴӡ, ϲˢ */
 
 typedef struct {
 	int           spifd;
-	int           spi_pipe_read;
-	int           spi_pipe_write;
+	int           spi_evfd;                                                     /* ͻ */
+	BOOLEAN       var_len;                                                      /* Э̱䳤ģʽ */
+	INT8U         bad_hdr_cnt;
+	INT16U        peer_next;                                                    /* ӻͨ´ηͳ */
+	INT32U        tx_full_logged;                                               /* ϴδӡʱ stat.tx_full */
+	time_t        tx_full_log_time;
+	yx_spi_stat_t stat;
     yx_roundbuf_t       TxRingBuffer;
     yx_roundbuf_t       RxRingBuffer;
     INT8U	TxBuf[YX_SPI_DRV_TX_BUF_SIZE];
     INT8U	RxBuf[YX_SPI_DRV_RX_BUF_SIZE];
+    INT8U	XferTx[YX_SPI_XFER_MAX_LEN];                                        /* δ仺, ߳ջ */
+    INT8U	XferRx[YX_SPI_XFER_MAX_LEN];
 } yx_spi_drv_para_t;
 
 static yx_spi_drv_para_t sgSpiDevObj;
@@ -56,9 +74,22 @@ static int sgSpiLevelIcFd = -1;
 
 #define YX_SPI_SLAVE_VALID_LEVEL   1        // spi valid level
 
+#ifdef YX_SPI_DRV_SIM
+#define YX_SPI_IRQ_EVENTS          POLLIN
+#define _spi_drv_slave_level()     yx_spidev_sim_ready()
+#else
+#define YX_SPI_IRQ_EVENTS          (POLLPRI | POLLERR)                          /* sysfs gpio ж */
+#define _spi_drv_slave_level()     yx_drv_gpio_get_value_byfd(sgSpiSlaveFd)
+#endif
+
 
 static int _spi_drv_config(void)
 {
+#ifdef YX_SPI_DRV_SIM
+    sgSpiDevObj.spifd = yx_spidev_sim_open();
+    sgSpiSlaveFd = yx_spidev_sim_irq_fd();
+    return sgSpiDevObj.spifd;
+#else
     int ret;
     unsigned int mode = SPI_MODE_0;
     unsigned int lsb = 0;
@@ -99,6 +130,7 @@ static int _spi_drv_config(void)
 end:
     close(sgSpiDevObj.spifd);
     return ret;
+#endif
 }
 
 
@@ -110,6 +142,10 @@ static int _spi_drv_transfer(char *txbuf,char *rxbuf, unsigned int len)
     if (sgSpiDevObj.spifd == -1)
         return -1;
 
+#ifdef YX_SPI_DRV_SIM
+    return yx_spidev_sim_transfer((INT8U*)txbuf, (INT8U*)rxbuf, len);
+#endif
+    memset(&trans, 0, sizeof(trans));
     trans.len = len;
     trans.speed_hz = YX_SPI_SPEED_HZ;
     trans.bits_per_word = 8;
@@ -130,85 +166,203 @@ static int _spi_drv_transfer(char *txbuf,char *rxbuf, unsigned int len)
 
 
 
+/* Ѵ߳ */
+static void _spi_drv_wake(void)
+{
+    uint64_t val = 1;
+    int ret;
+
+    do {
+        ret = write(sgSpiDevObj.spi_evfd, &val, sizeof(val));
+    } while (ret < 0 && errno == EINTR);
+}
+
+/* ¼ */
+static void _spi_drv_wake_clear(void)
+{
+    uint64_t val;
+
+    if (read(sgSpiDevObj.spi_evfd, &val, sizeof(val)) < 0 && errno != EAGAIN) {
+        printf("\nspi eventfd read error %d", errno);
+    }
+#ifdef YX_SPI_DRV_SIM
+    if (read(sgSpiSlaveFd, &val, sizeof(val)) < 0 && errno != EAGAIN) {
+        printf("\nspi irq read error %d", errno);
+    }
+#endif
+}
+
+/*******************************************************************
+** :     _spi_drv_xfer_once
+** :   ִһ SPI 
+**             ̶ģʽ: 64 ֽ, 㲿; ͻΪʱֻͷ̽ӻ,
+**                       ͷ·ݻͬһδ, ɴӻյ֡
+**             䳤ģʽ:  = ͷ + MAX(, ӻϴͨ), С YX_SPI_XFER_MIN_LEN,
+**                       һδͻеĶ֡
+** :       
+** :       
+********************************************************************/
+static void _spi_drv_xfer_once(void)
+{
+    INT8U   *txbuf = sgSpiDevObj.XferTx;
+    INT8U   *rxbuf = sgSpiDevObj.XferRx;
+    INT16U  xlen, txlen, rxlen, next, this_len, next_len;
+    INT8U   flags, wait;
+
+    if (sgSpiDevObj.var_len) {
+        txlen = yx_roundbuf_get(&sgSpiDevObj.TxRingBuffer, txbuf + YX_SPI_XFER_HDR_LEN,
+                                YX_SPI_XFER_MAX_LEN - YX_SPI_XFER_HDR_LEN);
+        next  = YX_MIN(yx_roundbuf_data_len(&sgSpiDevObj.TxRingBuffer), YX_SPI_XFER_MAX_LEN - YX_SPI_XFER_HDR_LEN);
+        yx_spi_xfer_hdr_pack(txbuf, YX_SPI_XFER_FLAG_VL, txlen, next);
+        xlen  = YX_SPI_XFER_HDR_LEN + txlen;
+    } else if (yx_roundbuf_data_len(&sgSpiDevObj.TxRingBuffer) == 0) {         /* д: ֻͷ̽ӻ */
+        txlen = 0;
+        yx_spi_xfer_hdr_pack(txbuf, YX_SPI_XFER_FLAG_VL, 0, 0);
+        xlen  = YX_SPI_XFER_HDR_LEN;
+    } else {
+        txlen = yx_roundbuf_get(&sgSpiDevObj.TxRingBuffer, txbuf, YX_SPI_FIX_BUF_SIZE);
+        xlen  = txlen;
+    }
+
+    if (sgSpiDevObj.var_len) {                                                  /* β, Զֻȡ this_len */
+        xlen = YX_MAX(xlen, YX_SPI_XFER_HDR_LEN + sgSpiDevObj.peer_next);
+        xlen = YX_MAX(xlen, YX_SPI_XFER_MIN_LEN);
+    } else {
+        memset(txbuf + xlen, YX_SPI_FILL_BYTE, YX_SPI_FIX_BUF_SIZE - xlen);
+        xlen = YX_SPI_FIX_BUF_SIZE;
+    }
+
+    for (wait = 0; yx_roundbuf_space_len(&sgSpiDevObj.RxRingBuffer) < xlen && wait < YX_SPI_RX_WAIT_MAX; wait++) {
+        if (pRxCallBack != NULL) {                                              /* ȴϲȡ */
+            pRxCallBack(NULL);
+        }
+        usleep(1000);
+    }
+
+    _spi_drv_transfer((char*)txbuf, (char*)rxbuf, xlen);
+    sgSpiDevObj.stat.xfers++;
+    sgSpiDevObj.stat.clock_bytes += xlen;
+    sgSpiDevObj.stat.tx_bytes += txlen;
+    //YX_LOG_BUF("\n---Snd Data:\n",txbuf,xlen);
+
+    rxlen = 0;
+    if (yx_spi_xfer_hdr_parse(rxbuf, &flags, &this_len, &next_len) && (flags & YX_SPI_XFER_FLAG_VL)) {
+        if (!sgSpiDevObj.var_len) {
+            printf("\nspi var len mode");
+            sgSpiDevObj.var_len = TRUE;
+        }
+        sgSpiDevObj.bad_hdr_cnt = 0;
+        sgSpiDevObj.peer_next   = next_len;
+        rxlen = YX_MIN(this_len, xlen - YX_SPI_XFER_HDR_LEN);
+        if (rxlen > 0 && yx_roundbuf_put(&sgSpiDevObj.RxRingBuffer, rxbuf + YX_SPI_XFER_HDR_LEN, rxlen) != rxlen) {
+            printf("\nrx roundbuf error!!\n");
+        }
+    } else if (!sgSpiDevObj.var_len) {                                          /* Э: ֡· */
+        rxlen = xlen;
+        if (yx_roundbuf_put(&sgSpiDevObj.RxRingBuffer, rxbuf, xlen) != xlen) {
+            printf("\nrx roundbuf error!!\n");
+        }
+    } else if (++sgSpiDevObj.bad_hdr_cnt >= YX_SPI_VL_BAD_MAX) {               /* ӻӦͷ, ˻ع̶ */
+        printf("\nspi fix len mode");
+        sgSpiDevObj.var_len   = FALSE;
+        sgSpiDevObj.peer_next = 0;
+    }
+    sgSpiDevObj.stat.rx_bytes += rxlen;
+
+    if (rxlen > 0 && pRxCallBack != NULL) {
+        pRxCallBack(NULL);
+    }
+}
+
 static void* yx_spi_drv_thread(void)
 {
-	fd_set			wait_fds; 
-	fd_set 			exceptfd;
-	int             max_fd,s,len,ret ;
-	INT8U     txbuf[YX_SPI_FIX_BUF_SIZE];
-	INT8U     rxbuf[YX_SPI_FIX_BUF_SIZE];
-	INT16U    real_tx_len = 0;
-	INT16U    real_rx_len = 0; 
+    struct pollfd   fds[2];
+	int             nfds, s;
 	INT8U     invalid_level_cnt = 0; 
-    struct timeval tv;
 	pthread_detach(pthread_self());
-	yx_drv_gpio_get_value_byfd(sgSpiSlaveFd);
+	_spi_drv_slave_level();
 	while (1) {
-		tv.tv_sec =  0;
-        tv.tv_usec = 500000;	// 500 ms ʱ
-		max_fd = -1;
-		FD_ZERO(&wait_fds);
-		FD_ZERO(&exceptfd);
-		FD_SET(sgSpiDevObj.spi_pipe_read,&wait_fds);
-		FD_SET(sgSpiSlaveFd,&exceptfd);
-		max_fd = YX_MAX(sgSpiDevObj.spi_pipe_read,sgSpiSlaveFd);
-		
-		s = select(max_fd + 1, &wait_fds, NULL, &exceptfd, &tv);				 /* selectӿ, ǷԷ */
-
-		if (s != -1) {
-
-			if (s == 0) {
-				//printf("\nspi thread timer out !!");
-			}
-	        if (sgSpiDevObj.spi_pipe_read != -1&& FD_ISSET(sgSpiDevObj.spi_pipe_read, &wait_fds)) {  
-			 	//printf("\nclear pipe read");
-	            char    buf[16];                                                  
-	            do {                                                                /* չܵ */
-	                len = read(sgSpiDevObj.spi_pipe_read, buf, 16);
-	            } while (len >= 16 || (len < 0 && errno == EINTR));
-	        } else if (sgSpiSlaveFd != -1  && FD_ISSET(sgSpiSlaveFd, &exceptfd)) { /* ڹܵյ, ˵ */
-				//printf(" \ngpio int %d",yx_drv_gpio_get_value_byfd(sgSpiSlaveFd));
+		nfds = 0;
+		fds[nfds].fd      = sgSpiDevObj.spi_evfd;
+		fds[nfds].events  = POLLIN;
+		fds[nfds].revents = 0;
+		nfds++;
+		if (sgSpiSlaveFd != -1) {                                               /* ӻж */
+			fds[nfds].fd      = sgSpiSlaveFd;
+			fds[nfds].events  = YX_SPI_IRQ_EVENTS;
+			fds[nfds].revents = 0;
+			nfds++;
+		}
+
+		s = poll(fds, nfds, YX_SPI_IDLE_POLL_MS);                             /* ͻӻʱ */
+		if (s < 0) {
+			if (errno != EINTR) {
+				printf("\nspi poll error %d", errno);
 			}
-			 /*
-				TODO 
-			 */
-			if (yx_drv_gpio_get_value_byfd(sgSpiSlaveFd) == YX_SPI_SLAVE_VALID_LEVEL) {
+			continue;
+		}
+		_spi_drv_wake_clear();
+
+		if (s == 0 && sgSpiDevObj.var_len && sgSpiSlaveFd == -1) {              /* ޾ж, ̴ѯӻ */
+			_spi_drv_xfer_once();
+		}
+			
+		if (_spi_drv_slave_level() == YX_SPI_SLAVE_VALID_LEVEL) {
+			invalid_level_cnt = 0;
+		} else if (invalid_level_cnt == 0) {
+			invalid_level_cnt++;
+		}
+		
+		while (yx_roundbuf_data_len(&sgSpiDevObj.TxRingBuffer) > 0 || (sgSpiDevObj.var_len && sgSpiDevObj.peer_next > 0)
+			   || (_spi_drv_slave_level() == YX_SPI_SLAVE_VALID_LEVEL)
+			   || (!sgSpiDevObj.var_len && invalid_level_cnt < 1)) {                 /* 䳤ģʽ next_len ж, Ҫһδ */
+			 if (_spi_drv_slave_level() == YX_SPI_SLAVE_VALID_LEVEL) {
 				invalid_level_cnt = 0;
-			} else if (invalid_level_cnt == 0) {
+			 } else if (invalid_level_cnt == 0) {
 				invalid_level_cnt++;
-			}
-			
-			while (yx_roundbuf_data_len(&sgSpiDevObj.TxRingBuffer) > 0  || (yx_drv_gpio_get_value_byfd(sgSpiSlaveFd) == YX_SPI_SLAVE_VALID_LEVEL) || (invalid_level_cnt < 1)){
-				 if (yx_drv_gpio_get_value_byfd(sgSpiSlaveFd) == YX_SPI_SLAVE_VALID_LEVEL) {
-					invalid_level_cnt = 0;
-				 } else if (invalid_level_cnt == 0) {
-					invalid_level_cnt++;
-				 }
-				 memset(txbuf,YX_SPI_FILL_BYTE,sizeof(txbuf));
-				 memset(rxbuf,YX_SPI_FILL_BYTE,sizeof(rxbuf));
-				 real_tx_len = yx_roundbuf_get(&sgSpiDevObj.TxRingBuffer,txbuf,YX_SPI_FIX_BUF_SIZE);
-				 _spi_drv_transfer(txbuf, rxbuf, YX_SPI_FIX_BUF_SIZE);
-				 //YX_LOG_BUF("\n---Snd Data:\n",txbuf,YX_SPI_FIX_BUF_SIZE);
-				 if (yx_roundbuf_put(&sgSpiDevObj.RxRingBuffer, rxbuf, YX_SPI_FIX_BUF_SIZE)  != YX_SPI_FIX_BUF_SIZE) {
-					printf("\nrx roundbuf error!!\n");
-				 }
-				 if (pRxCallBack != NULL) {
-					pRxCallBack (NULL);
-				 }
 			 }
-		}	
+			 _spi_drv_xfer_once();
+		 }
 	}
 }
 
+void yx_spi_xfer_hdr_pack(INT8U* pHdr, INT8U flags, INT16U this_len, INT16U next_len)
+{
+    pHdr[0] = YX_SPI_XFER_MAGIC_1;
+    pHdr[1] = YX_SPI_XFER_MAGIC_2;
+    pHdr[2] = flags;
+    pHdr[3] = (this_len >> 8) & 0xFF;
+    pHdr[4] = this_len & 0xFF;
+    pHdr[5] = (next_len >> 8) & 0xFF;
+    pHdr[6] = next_len & 0xFF;
+    pHdr[7] = yx_chksum_getxor(pHdr, YX_SPI_XFER_HDR_LEN - 1);
+}
 
+BOOLEAN yx_spi_xfer_hdr_parse(const INT8U* pHdr, INT8U* pFlags, INT16U* pThisLen, INT16U* pNextLen)
+{
+    INT16U this_len, next_len;
+
+    if (pHdr[0] != YX_SPI_XFER_MAGIC_1 || pHdr[1] != YX_SPI_XFER_MAGIC_2
+        || pHdr[7] != yx_chksum_getxor((INT8U*)pHdr, YX_SPI_XFER_HDR_LEN - 1)) {
+        return FALSE;
+    }
+    this_len = (pHdr[3] << 8) | pHdr[4];
+    next_len = (pHdr[5] << 8) | pHdr[6];
+    if (this_len > YX_SPI_XFER_MAX_LEN - YX_SPI_XFER_HDR_LEN || next_len > YX_SPI_XFER_MAX_LEN - YX_SPI_XFER_HDR_LEN) {
+        return FALSE;
+    }
+    *pFlags   = pHdr[2];
+    *pThisLen = this_len;
+    *pNextLen = next_len;
+    return TRUE;
+}
 
 
 int yx_spi_drv_init(void)
 {
     int ret;
-	int 	fds[2];
     pthread_t pid;
-	char value;
+#ifndef YX_SPI_DRV_SIM
 #if 0    
 	sgSpiSlaveFd = yx_drv_gpio_init(YX_SPI_SLAVE_GPIO_ID, GPIO_DIR_IN);
 	if (sgSpiSlaveFd == -1 ) {
@@ -226,31 +380,26 @@ int yx_spi_drv_init(void)
 #else
     yx_drv_gpio_edge_set(YX_SPI_SLAVE_GPIO_ID, GPIO_EDGE_FALLING);
 #endif
+#endif
 #endif
 	printf("\nspi drv config!!");
 	_spi_drv_config();
 	yx_roundbuf_init(&sgSpiDevObj.RxRingBuffer, sgSpiDevObj.RxBuf, YX_SPI_DRV_RX_BUF_SIZE);
 	yx_roundbuf_init(&sgSpiDevObj.TxRingBuffer, sgSpiDevObj.TxBuf, YX_SPI_DRV_TX_BUF_SIZE);
+
+	sgSpiDevObj.spi_evfd = eventfd(0, EFD_NONBLOCK);                            /* ߳ǰ, ̻߳ȴЧ */
+	if (sgSpiDevObj.spi_evfd < 0) {
+		printf("\nError in eventfd(), errno: %d", errno);
+		return -1;
+	}
 	
     ret = pthread_create(&pid, NULL, yx_spi_drv_thread, NULL);
-    if (ret == -1) {
+    if (ret != 0) {
         printf("\npthread_create error");
         return -1;
     }
-	ret = pipe(fds);
-	if (ret < 0) {
-		printf("\nError in pipe(), errno: %d", errno);
-	}
-	sgSpiDevObj.spi_pipe_read  = fds[0];
-	sgSpiDevObj.spi_pipe_write = fds[1];
-
-	if (sgSpiDevObj.spi_pipe_read == -1 || sgSpiDevObj.spi_pipe_write == -1) {
-		printf("\npipe error !!");
-	}
-//    fcntl(sgSpiDevObj.spi_pipe_read,  F_SETFL,O_NONBLOCK );							/* ܵóģʽ */
-//    fcntl(sgSpiDevObj.spi_pipe_write, F_SETFL, O_NONBLOCK);
-    if (yx_drv_gpio_get_value_byfd(sgSpiSlaveFd) == YX_SPI_SLAVE_VALID_LEVEL) {
-		ret = write (sgSpiDevObj.spi_pipe_write, " ", 1);
+    if (_spi_drv_slave_level() == YX_SPI_SLAVE_VALID_LEVEL) {
+		_spi_drv_wake();
 	}
     return 0;
 }
@@ -258,18 +407,23 @@ int yx_spi_drv_init(void)
 INT32S yx_spi_drv_send(INT8U * pBuf,INT32U len)
 {
 	int ret;
+	struct timespec ts;
+
 	if (len > yx_roundbuf_space_len(&sgSpiDevObj.TxRingBuffer)) {
-		printf("spi tx space error!!\n");
+		sgSpiDevObj.stat.tx_full++;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		if (sgSpiDevObj.tx_full_logged == 0 || ts.tv_sec - sgSpiDevObj.tx_full_log_time >= YX_SPI_TX_FULL_LOG_S) {
+			printf("spi tx space error!! (%u times)\n", sgSpiDevObj.stat.tx_full - sgSpiDevObj.tx_full_logged);
+			sgSpiDevObj.tx_full_logged   = sgSpiDevObj.stat.tx_full;
+			sgSpiDevObj.tx_full_log_time = ts.tv_sec;
+		}
 		return 0;
 	}
 	ret = yx_roundbuf_put(&sgSpiDevObj.TxRingBuffer, pBuf, len);
 	if (ret != len) {
 		printf("spi roundbuf put error!!  ret = %d, len = %d\n",ret,len);
 	}
-    do {                                                                        /* ܵд*/
-        ret = write (sgSpiDevObj.spi_pipe_write, " ", 1);
-    } while (ret < 0 && errno == EINTR);
-
+    _spi_drv_wake();
 	return len;
 }
 
@@ -286,3 +440,9 @@ void yx_spi_drv_register_rx_notice(void (*pRxNotice)(void* args))
 {
 	pRxCallBack  = pRxNotice;
 }
+
+void yx_spi_drv_get_stat(yx_spi_stat_t* pStat)
+{
+	*pStat = sgSpiDevObj.stat;
+	pStat->var_len = sgSpiDevObj.var_len;
+}
@@ -2,10 +2,40 @@
 #define _YX_SPI_DRV_H_
 #include "def.h"
 
+/*
+ * 䳤ģʽ
+ * ÿδ 8 ֽڴͷʼ: magic(2) flags(1) this_len(2) next_len(2) xor(1), ȸֽǰ.
+ * this_len Ϊδдͷ֮Чݳ, next_len Ϊͷһδݳ.
+ * ֤һδ䳤 >= MAX(YX_SPI_XFER_MIN_LEN, ͷ + ӻϴͨ next_len),
+ * ӻÿηͲ MAX(ϴͨĳ, YX_SPI_XFER_MIN_LEN - ͷ), ֡ͨȡ.
+ * ڷͻΪʱֻͷĹ̶ 64 ֽڴ̽, յӻϷͷ
+ * л䳤ģʽ; ·ݵĹ̶ȴ䲻Ӵͷ, ӻ֧ʱάԭ 64 ֽ䴫.
+ */
+#define YX_SPI_XFER_MAGIC_1      0xA5
+#define YX_SPI_XFER_MAGIC_2      0x3C
+#define YX_SPI_XFER_FLAG_VL      0x01                                           /* ֱ֧䳤 */
+#define YX_SPI_XFER_HDR_LEN      8
+#define YX_SPI_XFER_MIN_LEN      32
+#define YX_SPI_XFER_MAX_LEN      2048                                           /* շһ */
+#define YX_SPI_FIX_BUF_SIZE      64
+
+typedef struct {
+    INT32U  xfers;                                                              /*  */
+    INT32U  clock_bytes;                                                        /* ʱֽ */
+    INT32U  tx_bytes;                                                           /* Ч */
+    INT32U  rx_bytes;                                                           /* Ч */
+    INT32U  tx_full;                                                            /* ͻܾĴ */
+    BOOLEAN var_len;                                                            /* ǰǷ䳤ģʽ */
+} yx_spi_stat_t;
+
 int yx_spi_drv_init(void);
 INT32S yx_spi_drv_send(INT8U * pBuf,INT32U len);
 INT32S yx_spi_drv_read(INT8U * pBuf,INT32U len);
 void yx_spi_drv_register_rx_notice(void (*pRxNotice)(void* args));
+void yx_spi_drv_get_stat(yx_spi_stat_t* pStat);
 
-#endif
+/* ͷ/, ๲ */
+void yx_spi_xfer_hdr_pack(INT8U* pHdr, INT8U flags, INT16U this_len, INT16U next_len);
+BOOLEAN yx_spi_xfer_hdr_parse(const INT8U* pHdr, INT8U* pFlags, INT16U* pThisLen, INT16U* pNextLen);
 
+#endif
@@ -0,0 +1,503 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: AdaptiveBatchingTestApp.cpp
+ *
+ * @brief: Simulated sensor test of AdaptiveBatchingSensor
+ *
+ * A simulated accelerometer framework steps in 1 ms ticks and hands out any number of
+ * clients, each sampling on the rate grid and delivering a batch once it holds batch count
+ * events, with the configuration rules of ISensor::configure. A drive profile alternates
+ * driving (noisy acceleration) and parking (still), with the TCU suspended during part of the
+ * parked period. The same profile runs with a static configuration that meets the driving
+ * latency budget, a static configuration batching for the parked case, and the adaptive
+ * sensor. For each, the app reports the wake-ups per second (batches delivered by the
+ * framework) and the delivery latency per phase, and checks that the adaptive sensor delivers
+ * strictly increasing timestamps without gaps across its switches.
+ *
+ * Usage: adaptive_batching_test_app [-v]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> AdaptiveBatchingTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <telux/sensor/AdaptiveBatchingSensor.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::vector;
+using telux::common::Status;
+using telux::power::TcuActivityState;
+using namespace telux::sensor;
+
+static int gFailures = 0;
+static bool gVerbose = false;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const uint64_t MS = 1000000ull;
+static const uint64_t SEC = 1000 * MS;
+static const uint64_t LATENCY_BUDGET_NS = 100 * MS;
+
+// Drive profile, in simulated time
+static const uint64_t PARK_NS = 60 * SEC;
+static const uint64_t SUSPEND_NS = 120 * SEC;
+static const uint64_t RESUME_NS = 170 * SEC;
+static const uint64_t DRIVE_NS = 180 * SEC;
+static const uint64_t END_NS = 240 * SEC;
+
+// Seeded LCG so the data is the same on every host
+class Lcg {
+public:
+    explicit Lcg(uint32_t seed) : state_(seed) {}
+    // Uniform in [-1, 1]
+    double next() {
+        state_ = state_ * 1664525u + 1013904223u;
+        return (state_ >> 8) / double(1u << 24) * 2.0 - 1.0;
+    }
+private:
+    uint32_t state_;
+};
+
+static bool driving(uint64_t t) {
+    return t < PARK_NS || t >= DRIVE_NS;
+}
+
+class SimClient;
+
+/**
+ * Simulated sensor framework: time, the acceleration signal and the wake-up count
+ */
+class SimHub {
+public:
+    SimHub() {
+        info_.id = 1;
+        info_.type = SensorType::ACCELEROMETER;
+        info_.name = "sim_accel";
+        info_.samplingRates = {25.0f, 50.0f, 100.0f, 200.0f};
+        info_.maxSamplingRate = 200.0f;
+        info_.maxBatchCountSupported = 500;
+        info_.minBatchCountSupported = 2;
+    }
+
+    shared_ptr<SimClient> createClient();
+    void step();
+
+    // The same sample for every client sampling at t
+    MotionSensorData sample(uint64_t t) const {
+        Lcg lcg(static_cast<uint32_t>(t / MS) * 2654435761u);
+        const double noise = driving(t) ? 0.6 : 0.005;
+        MotionSensorData data;
+        data.x = static_cast<float>(noise * lcg.next());
+        data.y = static_cast<float>(noise * lcg.next());
+        data.z = static_cast<float>(9.81 + noise * lcg.next());
+        return data;
+    }
+
+    uint64_t now() const { return now_; }
+    const SensorInfo &info() const { return info_; }
+
+    uint64_t wakeups = 0;
+    uint32_t activeClients = 0;
+    uint32_t maxActiveClients = 0;
+
+private:
+    SensorInfo info_;
+    uint64_t now_ = 0;
+    vector<std::weak_ptr<SimClient>> clients_;
+};
+
+/**
+ * One client of the simulated framework
+ */
+class SimClient : public ISensor {
+public:
+    explicit SimClient(SimHub &hub) : hub_(hub) {
+        config_.samplingRate = hub.info().samplingRates.front();
+        config_.batchCount = hub.info().minBatchCountSupported;
+    }
+
+    SensorInfo getSensorInfo() override { return hub_.info(); }
+
+    // The configuration rules of ISensor::configure
+    Status configure(SensorConfiguration configuration) override {
+        if (active_) {
+            return Status::INVALIDSTATE;
+        }
+        const SensorInfo &info = hub_.info();
+        if (configuration.validityMask.test(SensorConfigParams::SAMPLING_RATE)) {
+            float rate = info.samplingRates.front();
+            for (float supported : info.samplingRates) {
+                if (supported <= configuration.samplingRate) {
+                    rate = supported;
+                }
+            }
+            config_.samplingRate = rate;
+        }
+        if (configuration.validityMask.test(SensorConfigParams::BATCH_COUNT)) {
+            uint32_t minBatch = info.minBatchCountSupported;
+            uint32_t batch = configuration.batchCount / minBatch * minBatch;
+            config_.batchCount = std::min(std::max(batch, minBatch), info.maxBatchCountSupported);
+        }
+        config_.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+        config_.validityMask.set(SensorConfigParams::BATCH_COUNT);
+        return Status::SUCCESS;
+    }
+
+    SensorConfiguration getConfiguration() override { return config_; }
+
+    Status activate() override {
+        if (!active_) {
+            active_ = true;
+            period_ = static_cast<uint64_t>(1e9 / config_.samplingRate);
+            // Sampling starts on the next point of the rate grid
+            next_ = (hub_.now() / period_ + 1) * period_;
+            buffer_.clear();
+            ++hub_.activeClients;
+            hub_.maxActiveClients = std::max(hub_.maxActiveClients, hub_.activeClients);
+        }
+        return Status::SUCCESS;
+    }
+
+    Status deactivate() override {
+        if (active_) {
+            active_ = false;
+            --hub_.activeClients;
+        }
+        return Status::SUCCESS;
+    }
+
+    Status enableLowPowerMode() override { return Status::NOTSUPPORTED; }
+    Status disableLowPowerMode() override { return Status::NOTSUPPORTED; }
+    Status selfTest(SelfTestType selfTestType, SelfTestResultCallback cb) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status registerListener(std::weak_ptr<ISensorEventListener> listener) override {
+        listeners_.push_back(listener);
+        return Status::SUCCESS;
+    }
+    Status deregisterListener(std::weak_ptr<ISensorEventListener> listener) override {
+        auto target = listener.lock();
+        for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+            if (it->lock() == target) {
+                listeners_.erase(it);
+                return Status::SUCCESS;
+            }
+        }
+        return Status::NOSUCH;
+    }
+
+    void step(uint64_t now) {
+        if (!active_) {
+            return;
+        }
+        for (; next_ <= now; next_ += period_) {
+            SensorEvent event;
+            event.timestamp = next_;
+            event.calibrated = hub_.sample(next_);
+            buffer_.push_back(event);
+        }
+        if (buffer_.size() >= config_.batchCount) {
+            ++hub_.wakeups;
+            auto events = std::make_shared<vector<SensorEvent>>();
+            events->swap(buffer_);
+            // Copy, a listener may deregister while being called
+            auto listeners = listeners_;
+            for (auto &weak : listeners) {
+                auto listener = weak.lock();
+                if (listener) {
+                    listener->onEvent(events);
+                }
+            }
+        }
+    }
+
+private:
+    SimHub &hub_;
+    SensorConfiguration config_;
+    bool active_ = false;
+    uint64_t period_ = 0;
+    uint64_t next_ = 0;
+    vector<SensorEvent> buffer_;
+    vector<std::weak_ptr<ISensorEventListener>> listeners_;
+};
+
+shared_ptr<SimClient> SimHub::createClient() {
+    auto client = std::make_shared<SimClient>(*this);
+    clients_.push_back(client);
+    return client;
+}
+
+void SimHub::step() {
+    now_ += MS;
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        auto client = clients_[i].lock();
+        if (client) {
+            client->step(now_);
+        }
+    }
+}
+
+/**
+ * Latency and continuity of the events an application receives, per phase of the profile
+ */
+class AppListener : public ISensorEventListener {
+public:
+    enum Phase { DRIVING, PARKED, SUSPENDED, PHASE_COUNT };
+
+    struct PhaseStats {
+        uint64_t events = 0;
+        double latencySumNs = 0;
+        uint64_t maxLatencyNs = 0;
+    };
+
+    explicit AppListener(const SimHub &hub) : hub_(hub) {}
+
+    void onEvent(shared_ptr<vector<SensorEvent>> events) override {
+        for (auto &event : *events) {
+            if (lastTs_ != 0) {
+                if (event.timestamp <= lastTs_) {
+                    ++disorders;
+                }
+                maxGapNs = std::max(maxGapNs, event.timestamp - lastTs_);
+            }
+            lastTs_ = event.timestamp;
+            const uint64_t latency = hub_.now() - event.timestamp;
+            PhaseStats &stats = phases[phaseOf(event.timestamp)];
+            ++stats.events;
+            stats.latencySumNs += latency;
+            stats.maxLatencyNs = std::max(stats.maxLatencyNs, latency);
+            // Steady driving, away from the transitions
+            if ((event.timestamp >= 5 * SEC && event.timestamp < PARK_NS)
+                || event.timestamp >= DRIVE_NS + 5 * SEC) {
+                steadyDrivingMaxLatencyNs = std::max(steadyDrivingMaxLatencyNs, latency);
+            }
+        }
+    }
+
+    void onConfigurationUpdate(SensorConfiguration configuration) override {
+        ++configurationUpdates;
+        if (gVerbose) {
+            cout << "  t=" << std::fixed << std::setprecision(3) << hub_.now() * 1e-9
+                 << " s: " << configuration.samplingRate << " Hz, batch "
+                 << configuration.batchCount << endl;
+        }
+    }
+
+    static Phase phaseOf(uint64_t t) {
+        if (driving(t)) {
+            return DRIVING;
+        }
+        return (t >= SUSPEND_NS && t < RESUME_NS) ? SUSPENDED : PARKED;
+    }
+
+    PhaseStats phases[PHASE_COUNT];
+    uint64_t steadyDrivingMaxLatencyNs = 0;
+    uint64_t maxGapNs = 0;
+    uint64_t disorders = 0;
+    uint32_t configurationUpdates = 0;
+
+private:
+    const SimHub &hub_;
+    uint64_t lastTs_ = 0;
+};
+
+struct Result {
+    // Wake-ups per second in each phase
+    double wakeupRate[AppListener::PHASE_COUNT] = {0, 0, 0};
+    shared_ptr<AppListener> app;
+    AdaptiveBatchingStats stats;
+    uint32_t maxActiveClients = 0;
+};
+
+static const char *phaseName(int phase) {
+    static const char *names[] = {"driving", "parked", "suspended"};
+    return names[phase];
+}
+
+static double phaseSeconds(int phase) {
+    switch (phase) {
+        case AppListener::DRIVING: return (PARK_NS + END_NS - DRIVE_NS) * 1e-9;
+        case AppListener::PARKED: return (DRIVE_NS - PARK_NS - (RESUME_NS - SUSPEND_NS)) * 1e-9;
+        default: return (RESUME_NS - SUSPEND_NS) * 1e-9;
+    }
+}
+
+// Runs the profile on a sensor; adaptive is set when sensor is the AdaptiveBatchingSensor
+static void runProfile(SimHub &hub, shared_ptr<ISensor> sensor, AdaptiveBatchingSensor *adaptive,
+                       std::deque<std::function<void()>> &tasks, Result &result) {
+    uint64_t wakeups[AppListener::PHASE_COUNT] = {0, 0, 0};
+    sensor->activate();
+    while (hub.now() < END_NS) {
+        const uint64_t before = hub.wakeups;
+        hub.step();
+        wakeups[AppListener::phaseOf(hub.now())] += hub.wakeups - before;
+        if (adaptive && hub.now() == SUSPEND_NS) {
+            adaptive->onTcuActivityStateUpdate(TcuActivityState::SUSPEND);
+        }
+        if (adaptive && hub.now() == RESUME_NS) {
+            adaptive->onTcuActivityStateUpdate(TcuActivityState::RESUME);
+        }
+        // The executor of the adaptive sensor, run between framework deliveries
+        while (!tasks.empty()) {
+            auto task = tasks.front();
+            tasks.pop_front();
+            task();
+        }
+    }
+    sensor->deactivate();
+    for (int phase = 0; phase < AppListener::PHASE_COUNT; ++phase) {
+        result.wakeupRate[phase] = wakeups[phase] / phaseSeconds(phase);
+    }
+    result.maxActiveClients = hub.maxActiveClients;
+    if (adaptive) {
+        result.stats = adaptive->getStats();
+    }
+}
+
+static Result runStatic(uint32_t batchCount) {
+    SimHub hub;
+    std::deque<std::function<void()>> tasks;
+    Result result;
+    result.app = std::make_shared<AppListener>(hub);
+    auto sensor = hub.createClient();
+    SensorConfiguration config;
+    config.samplingRate = 100.0f;
+    config.batchCount = batchCount;
+    config.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+    config.validityMask.set(SensorConfigParams::BATCH_COUNT);
+    sensor->configure(config);
+    sensor->registerListener(result.app);
+    runProfile(hub, sensor, nullptr, tasks, result);
+    return result;
+}
+
+static Result runAdaptive() {
+    SimHub hub;
+    std::deque<std::function<void()>> tasks;
+    Result result;
+    result.app = std::make_shared<AppListener>(hub);
+
+    AdaptiveBatchingConfig policy;
+    policy.movingRate = 100.0f;
+    policy.parkedRate = 25.0f;
+    policy.parkedLatencyNs = 2 * SEC;
+    auto adaptive = std::make_shared<AdaptiveBatchingSensor>(
+        [&hub]() -> shared_ptr<ISensor> { return hub.createClient(); }, policy,
+        [&tasks](std::function<void()> task) { tasks.push_back(task); });
+    SensorConfiguration config;
+    config.samplingRate = 100.0f;
+    config.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+    CHECK(adaptive->configure(config) == Status::SUCCESS);
+    CHECK(adaptive->registerListener(result.app, LATENCY_BUDGET_NS) == Status::SUCCESS);
+    runProfile(hub, adaptive, adaptive.get(), tasks, result);
+    CHECK(adaptive->deregisterListener(result.app) == Status::SUCCESS);
+    CHECK(adaptive->deregisterListener(result.app) == Status::NOSUCH);
+    return result;
+}
+
+static void report(const char *name, const Result &result) {
+    cout << name << endl;
+    for (int phase = 0; phase < AppListener::PHASE_COUNT; ++phase) {
+        const AppListener::PhaseStats &stats = result.app->phases[phase];
+        cout << "  " << std::setw(9) << phaseName(phase) << ": " << std::fixed
+             << std::setprecision(2) << std::setw(6) << result.wakeupRate[phase]
+             << " wake-ups/s, latency mean " << std::setprecision(0) << std::setw(5)
+             << (stats.events ? stats.latencySumNs / stats.events / MS : 0) << " ms, max "
+             << std::setw(5) << stats.maxLatencyNs / MS << " ms" << endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    int c;
+
+    while ((c = getopt(argc, argv, "vh")) != -1) {
+        switch (c) {
+            case 'v': gVerbose = true; break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-v]" << endl;
+                return 1;
+        }
+    }
+
+    Result fast = runStatic(10);
+    Result slow = runStatic(200);
+    report("static 100 Hz, batch 10", fast);
+    report("static 100 Hz, batch 200", slow);
+    Result adaptive = runAdaptive();
+    report("adaptive", adaptive);
+    cout << "  " << adaptive.stats.switches << " switches (" << adaptive.stats.gapSwitches
+         << " with gap), " << adaptive.stats.overlapDropped << " overlapping events dropped, "
+         << "max gap " << adaptive.app->maxGapNs / MS << " ms" << endl;
+
+    // The static configuration meeting the budget wakes up as often when parked
+    CHECK(fast.app->steadyDrivingMaxLatencyNs <= LATENCY_BUDGET_NS);
+    CHECK(slow.app->steadyDrivingMaxLatencyNs > LATENCY_BUDGET_NS);
+
+    // The adaptive sensor meets the budget while driving, and wakes up far less when parked
+    CHECK(adaptive.app->steadyDrivingMaxLatencyNs <= LATENCY_BUDGET_NS);
+    CHECK(adaptive.wakeupRate[AppListener::DRIVING] < fast.wakeupRate[AppListener::DRIVING] * 1.1);
+    CHECK(adaptive.wakeupRate[AppListener::PARKED] < fast.wakeupRate[AppListener::PARKED] / 5);
+    CHECK(adaptive.wakeupRate[AppListener::SUSPENDED]
+        < adaptive.wakeupRate[AppListener::PARKED] / 5);
+
+    // Glitch-free switches: no duplicate, reordered or missing events
+    CHECK(adaptive.app->disorders == 0);
+    CHECK(adaptive.app->maxGapNs <= 40 * MS + MS);
+    CHECK(adaptive.stats.switches >= 3);
+    CHECK(adaptive.stats.gapSwitches == 0);
+    CHECK(adaptive.app->configurationUpdates == adaptive.stats.switches);
+    CHECK(adaptive.maxActiveClients <= 2);
+    CHECK(adaptive.stats.moving);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,631 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: AudioBufferPoolTestApp.cpp
+ *
+ * @brief: File to file transcoding test and benchmark of AudioBufferPool and TranscodeSession
+ *
+ * A software ITranscoder stands in for the audio service: it encodes 16 bit PCM into 8 bit
+ * G.711 mu-law (2:1, like an encoder to a compressed format) on its own thread, accepts writes
+ * into a bounded input FIFO, completes writes the FIFO cannot hold in full with the bytes it
+ * accepted and raises onReadyForWrite() once it has room again. Like the service, it returns a
+ * newly allocated buffer from each getWriteBuffer()/getReadBuffer() call.
+ *
+ * The test transcodes a generated PCM file to a file and compares it with the reference
+ * encoding, with separate pools, with partial writes and with one pool shared by both
+ * directions. The benchmark compares the throughput and allocation count of TranscodeSession
+ * with pooled buffers against a loop that gets a new buffer for each operation and waits for
+ * each one to complete, as the transcoder samples do.
+ *
+ * Usage: audio_buffer_pool_test_app [-m megabytes for the benchmark]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> AudioBufferPoolTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <telux/audio/AudioBufferPool.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::vector;
+using telux::common::ErrorCode;
+using telux::common::Status;
+using namespace telux::audio;
+
+static std::atomic<uint64_t> gAllocations{0};
+
+// Out of line, so that the compiler does not pair malloc() and free() with new and delete
+__attribute__((noinline)) void *operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const size_t BUFFER_SIZE = 4096;
+
+static uint8_t muLaw(int16_t pcm) {
+    const int BIAS = 0x84;
+    int sign = (pcm < 0) ? 0x80 : 0;
+    int magnitude = (pcm < 0) ? -static_cast<int>(pcm) : pcm;
+    magnitude = (magnitude > 32635) ? 32635 : magnitude;
+    magnitude += BIAS;
+    int exponent = 7;
+    for (int mask = 0x4000; (magnitude & mask) == 0 && exponent > 0; mask >>= 1) {
+        --exponent;
+    }
+    int mantissa = (magnitude >> (exponent + 3)) & 0x0F;
+    return static_cast<uint8_t>(~(sign | (exponent << 4) | mantissa));
+}
+
+/**
+ * Buffer as handed out by the audio service, allocated per call
+ */
+class SoftBuffer : public IAudioBuffer {
+public:
+    explicit SoftBuffer(size_t size) : data_(size) {}
+    size_t getMinSize() override { return data_.size(); }
+    size_t getMaxSize() override { return data_.size(); }
+    uint8_t *getRawBuffer() override { return data_.data(); }
+    uint32_t getDataSize() override { return dataSize_; }
+    void setDataSize(uint32_t size) override { dataSize_ = size; }
+    Status reset() override { dataSize_ = 0; return Status::SUCCESS; }
+private:
+    vector<uint8_t> data_;
+    uint32_t dataSize_ = 0;
+};
+
+/**
+ * Software PCM16 to mu-law transcoder
+ */
+class SoftTranscoder : public ITranscoder {
+public:
+    explicit SoftTranscoder(size_t fifoSize) : fifoSize_(fifoSize) {
+        input_.reserve(fifoSize);
+        output_.reserve(fifoSize);
+        worker_ = std::thread(&SoftTranscoder::run, this);
+    }
+
+    ~SoftTranscoder() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        worker_.join();
+    }
+
+    shared_ptr<IAudioBuffer> getWriteBuffer() override {
+        return std::make_shared<SoftBuffer>(BUFFER_SIZE);
+    }
+
+    shared_ptr<IAudioBuffer> getReadBuffer() override {
+        return std::make_shared<SoftBuffer>(BUFFER_SIZE);
+    }
+
+    Status write(shared_ptr<IAudioBuffer> buffer, uint32_t isLastBuffer,
+            TranscoderWriteResponseCb callback) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (inputEnded_) {
+            return Status::INVALIDSTATE;
+        }
+        size_t size = buffer->getDataSize();
+        size_t accepted = std::min(size, fifoSize_ - input_.size()) & ~static_cast<size_t>(1);
+        const uint8_t *data = buffer->getRawBuffer();
+        input_.insert(input_.end(), data, data + accepted);
+        if (accepted < size) {
+            readyPending_ = true;
+        } else if (isLastBuffer) {
+            inputEnded_ = true;
+        }
+        writes_.push_back(WriteOp{buffer, static_cast<uint32_t>(accepted), callback});
+        cv_.notify_one();
+        return Status::SUCCESS;
+    }
+
+    Status read(shared_ptr<IAudioBuffer> buffer, uint32_t bytesToRead,
+            TranscoderReadResponseCb callback) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bytesToRead == 0 || bytesToRead > buffer->getMaxSize()) {
+            return Status::INVALIDPARAM;
+        }
+        reads_.push_back(ReadOp{buffer, bytesToRead, callback});
+        cv_.notify_one();
+        return Status::SUCCESS;
+    }
+
+    // Cancels the reads still pending
+    Status tearDown(telux::common::ResponseCallback callback) override {
+        std::deque<ReadOp> reads;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reads.swap(reads_);
+        }
+        for (auto &op : reads) {
+            if (op.callback) {
+                op.callback(op.buffer, 1, ErrorCode::CANCELLED);
+            }
+        }
+        if (callback) {
+            callback(ErrorCode::SUCCESS);
+        }
+        return Status::SUCCESS;
+    }
+
+    Status registerListener(std::weak_ptr<ITranscodeListener> listener) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        listener_ = listener;
+        return Status::SUCCESS;
+    }
+
+    Status deRegisterListener(std::weak_ptr<ITranscodeListener> listener) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        listener_.reset();
+        return Status::SUCCESS;
+    }
+
+private:
+    struct WriteOp {
+        shared_ptr<IAudioBuffer> buffer;
+        uint32_t accepted;
+        TranscoderWriteResponseCb callback;
+    };
+
+    struct ReadOp {
+        shared_ptr<IAudioBuffer> buffer;
+        uint32_t bytesToRead;
+        TranscoderReadResponseCb callback;
+    };
+
+    // Completes operations from this thread, outside the lock, like the service callbacks
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this] {
+                return stop_ || !writes_.empty() || encodable()
+                    || (!reads_.empty() && readable());
+            });
+            if (stop_) {
+                return;
+            }
+            while (!writes_.empty()) {
+                WriteOp op = writes_.front();
+                writes_.pop_front();
+                lock.unlock();
+                if (op.callback) {
+                    op.callback(op.buffer, op.accepted, ErrorCode::SUCCESS);
+                }
+                lock.lock();
+            }
+            // Encode
+            const size_t samples = std::min(input_.size() / 2, fifoSize_ - output_.size());
+            for (size_t i = 0; i < samples; ++i) {
+                int16_t pcm = static_cast<int16_t>(input_[2 * i] | (input_[2 * i + 1] << 8));
+                output_.push_back(muLaw(pcm));
+            }
+            input_.erase(input_.begin(), input_.begin() + 2 * samples);
+            if (readyPending_ && input_.size() <= fifoSize_ / 2) {
+                readyPending_ = false;
+                auto listener = listener_.lock();
+                lock.unlock();
+                if (listener) {
+                    listener->onReadyForWrite();
+                }
+                lock.lock();
+            }
+            while (!reads_.empty() && readable()) {
+                ReadOp op = reads_.front();
+                reads_.pop_front();
+                const size_t size = std::min<size_t>(op.bytesToRead, output_.size());
+                std::memcpy(op.buffer->getRawBuffer(), output_.data(), size);
+                output_.erase(output_.begin(), output_.begin() + size);
+                op.buffer->setDataSize(static_cast<uint32_t>(size));
+                const uint32_t isLast = (inputEnded_ && input_.empty() && output_.empty()) ? 1 : 0;
+                lock.unlock();
+                if (op.callback) {
+                    op.callback(op.buffer, isLast, ErrorCode::SUCCESS);
+                }
+                lock.lock();
+            }
+        }
+    }
+
+    // Whether input is waiting for room in the output
+    bool encodable() const {
+        return input_.size() >= 2 && output_.size() < fifoSize_;
+    }
+
+    // Whether the first read can complete: full, or with the end of the output
+    bool readable() const {
+        return output_.size() >= reads_.front().bytesToRead
+            || (inputEnded_ && input_.empty());
+    }
+
+    const size_t fifoSize_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    vector<uint8_t> input_;
+    vector<uint8_t> output_;
+    std::deque<WriteOp> writes_;
+    std::deque<ReadOp> reads_;
+    std::weak_ptr<ITranscodeListener> listener_;
+    bool readyPending_ = false;
+    bool inputEnded_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+// PCM file of a sweep with noise, and its reference encoding
+static void makeInput(const char *path, size_t bytes, vector<uint8_t> &reference) {
+    FILE *file = fopen(path, "wb");
+    uint32_t lcg = 12345;
+    vector<uint8_t> chunk;
+    reference.clear();
+    for (size_t i = 0; i < bytes / 2; ++i) {
+        lcg = lcg * 1664525u + 1013904223u;
+        double t = i / 16000.0;
+        double v = 12000.0 * std::sin(2 * 3.14159265358979 * (200 + 50 * t) * t)
+            + static_cast<int>(lcg >> 20) - 2048;
+        int16_t pcm = static_cast<int16_t>(v);
+        chunk.push_back(static_cast<uint8_t>(pcm & 0xff));
+        chunk.push_back(static_cast<uint8_t>((pcm >> 8) & 0xff));
+        reference.push_back(muLaw(pcm));
+        if (chunk.size() >= 65536) {
+            fwrite(chunk.data(), 1, chunk.size(), file);
+            chunk.clear();
+        }
+    }
+    fwrite(chunk.data(), 1, chunk.size(), file);
+    fclose(file);
+}
+
+static vector<uint8_t> readFile(const char *path) {
+    vector<uint8_t> data;
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return data;
+    }
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return data;
+}
+
+struct RunResult {
+    bool ok = false;
+    double seconds = 0;
+    uint64_t allocations = 0;
+    TranscodeSessionStats stats;
+};
+
+// File to file with TranscodeSession; readPool may be writePool
+static RunResult runSession(const char *inPath, const char *outPath, size_t fifoSize,
+        shared_ptr<TranscodeBufferPool> writePool, shared_ptr<TranscodeBufferPool> readPool) {
+    RunResult result;
+    auto transcoder = std::make_shared<SoftTranscoder>(fifoSize);
+    FILE *in = fopen(inPath, "rb");
+    FILE *out = fopen(outPath, "wb");
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool finished = false;
+    ErrorCode outcome = ErrorCode::GENERIC_FAILURE;
+
+    const uint64_t allocBefore = gAllocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    auto session = TranscodeSession::create(transcoder, writePool, readPool,
+        [in](uint8_t *data, size_t maxBytes) { return fread(data, 1, maxBytes, in); },
+        [out](const uint8_t *data, size_t size, bool isLast) { fwrite(data, 1, size, out); });
+    CHECK(session != nullptr);
+    CHECK(session->start([&](ErrorCode error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        outcome = error;
+        finished = true;
+        cv.notify_all();
+    }) == Status::SUCCESS);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return finished; });
+    }
+    const auto end = std::chrono::steady_clock::now();
+    result.allocations = gAllocations.load() - allocBefore;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.stats = session->getStats();
+    // The session is released once the callbacks in flight have returned
+    transcoder->tearDown(nullptr);
+    std::weak_ptr<TranscodeSession> released = session;
+    session.reset();
+    for (int i = 0; i < 1000 && !released.expired(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(released.expired());
+    result.ok = (outcome == ErrorCode::SUCCESS);
+    fclose(in);
+    fclose(out);
+    return result;
+}
+
+// File to file getting a new buffer per operation and waiting for each, as the samples do
+static RunResult runPerOperation(const char *inPath, const char *outPath, size_t fifoSize) {
+    RunResult result;
+    auto transcoder = std::make_shared<SoftTranscoder>(fifoSize);
+    FILE *in = fopen(inPath, "rb");
+    FILE *out = fopen(outPath, "wb");
+
+    struct ReadyListener : ITranscodeListener {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool ready = true;
+        void onReadyForWrite() override {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready = true;
+            cv.notify_all();
+        }
+    };
+    auto listener = std::make_shared<ReadyListener>();
+    transcoder->registerListener(listener);
+
+    const uint64_t allocBefore = gAllocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    std::thread reader([&] {
+        for (;;) {
+            auto buffer = transcoder->getReadBuffer();
+            std::promise<uint32_t> done;
+            transcoder->read(buffer, static_cast<uint32_t>(buffer->getMaxSize()),
+                [&done](shared_ptr<IAudioBuffer> b, uint32_t isLast, ErrorCode error) {
+                    done.set_value(isLast);
+                });
+            uint32_t isLast = done.get_future().get();
+            fwrite(buffer->getRawBuffer(), 1, buffer->getDataSize(), out);
+            result.stats.bytesRead += buffer->getDataSize();
+            if (isLast) {
+                return;
+            }
+        }
+    });
+    bool last = false;
+    while (!last) {
+        auto buffer = transcoder->getWriteBuffer();
+        size_t size = fread(buffer->getRawBuffer(), 1, buffer->getMaxSize(), in);
+        last = (size < buffer->getMaxSize());
+        buffer->setDataSize(static_cast<uint32_t>(size));
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(listener->mutex);
+                listener->cv.wait(lock, [&] { return listener->ready; });
+            }
+            std::promise<uint32_t> done;
+            transcoder->write(buffer, last ? 1 : 0,
+                [&done, &listener](shared_ptr<IAudioBuffer> b, uint32_t bytes, ErrorCode error) {
+                    // Before onReadyForWrite can follow
+                    if (bytes < b->getDataSize()) {
+                        std::lock_guard<std::mutex> lock(listener->mutex);
+                        listener->ready = false;
+                    }
+                    done.set_value(bytes);
+                });
+            uint32_t bytes = done.get_future().get();
+            if (bytes == buffer->getDataSize()) {
+                break;
+            }
+            uint8_t *data = buffer->getRawBuffer();
+            std::memmove(data, data + bytes, buffer->getDataSize() - bytes);
+            buffer->setDataSize(buffer->getDataSize() - bytes);
+            ++result.stats.partialWrites;
+        }
+    }
+    reader.join();
+    const auto end = std::chrono::steady_clock::now();
+    result.allocations = gAllocations.load() - allocBefore;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.ok = true;
+    fclose(in);
+    fclose(out);
+    return result;
+}
+
+static void testPool() {
+    auto pool = StreamBufferPool::create(3, 1000, 320);
+    CHECK(pool != nullptr && pool->getCount() == 3);
+    CHECK(StreamBufferPool::create(0, 1000) == nullptr);
+    auto a = pool->acquire();
+    auto b = pool->acquire();
+    auto c = pool->acquire();
+    CHECK(a && b && c && a != b && b != c && a != c);
+    CHECK(pool->acquire() == nullptr);
+    CHECK(pool->getFreeCount() == 0 && pool->getExhaustedCount() == 1);
+    CHECK(a->getMinSize() == 320 && a->getMaxSize() == 1000);
+    CHECK(reinterpret_cast<uintptr_t>(b->getRawBuffer()) % 64 == 0);
+    CHECK(b->getRawBuffer() + 1024 == c->getRawBuffer());
+
+    // A buffer returns when released, reset, and serves transcoder operations as well
+    b->setDataSize(77);
+    uint8_t *raw = b->getRawBuffer();
+    shared_ptr<IAudioBuffer> transcodeView = b;
+    b.reset();
+    CHECK(pool->acquire() == nullptr);
+    transcodeView.reset();
+    CHECK(pool->getFreeCount() == 1);
+    const uint64_t allocBefore = gAllocations.load();
+    auto again = pool->acquire();
+    CHECK(gAllocations.load() == allocBefore);
+    CHECK(again && again->getRawBuffer() == raw && again->getDataSize() == 0);
+
+    // Buffers from a factory are obtained once
+    int made = 0;
+    auto transcoderPool = TranscodeBufferPool::create(2, [&made]() -> shared_ptr<IAudioBuffer> {
+        ++made;
+        return std::make_shared<SoftBuffer>(BUFFER_SIZE);
+    });
+    CHECK(transcoderPool && made == 2);
+    for (int i = 0; i < 10; ++i) {
+        auto buffer = transcoderPool->acquire();
+        CHECK(buffer != nullptr);
+    }
+    CHECK(made == 2 && transcoderPool->getAcquireCount() == 10);
+    CHECK(TranscodeBufferPool::create(2, []() { return shared_ptr<IAudioBuffer>(); }) == nullptr);
+}
+
+static void testTranscode(const char *inPath, const char *outPath,
+        const vector<uint8_t> &reference) {
+    FormatInfo pcm{16000, 1, AudioFormat::PCM_16BIT_SIGNED, nullptr};
+    FormatInfo amr{16000, 1, AudioFormat::AMRWB, nullptr};
+    CHECK(TranscodeSession::canShareBuffers(pcm, amr));
+    CHECK(!TranscodeSession::canShareBuffers(amr, pcm));
+
+    // Separate pools
+    {
+        auto writePool = TranscodeBufferPool::create(3, BUFFER_SIZE);
+        auto readPool = TranscodeBufferPool::create(3, BUFFER_SIZE);
+        RunResult result = runSession(inPath, outPath, 64 * 1024, writePool, readPool);
+        CHECK(result.ok);
+        CHECK(readFile(outPath) == reference);
+        CHECK(result.stats.bytesWritten == 2 * reference.size());
+        CHECK(result.stats.bytesRead == reference.size());
+        CHECK(writePool->getFreeCount() == 3 && readPool->getFreeCount() == 3);
+    }
+    // Input FIFO smaller than a buffer: every write is partial at first
+    {
+        auto writePool = TranscodeBufferPool::create(2, BUFFER_SIZE);
+        auto readPool = TranscodeBufferPool::create(2, 1000);
+        RunResult result = runSession(inPath, outPath, 3000, writePool, readPool);
+        CHECK(result.ok);
+        CHECK(result.stats.partialWrites > 0);
+        CHECK(readFile(outPath) == reference);
+    }
+    // One pool for both directions
+    {
+        auto pool = TranscodeBufferPool::create(4, BUFFER_SIZE);
+        RunResult result = runSession(inPath, outPath, 64 * 1024, pool, pool);
+        CHECK(result.ok);
+        CHECK(readFile(outPath) == reference);
+        CHECK(pool->getFreeCount() == 4);
+    }
+    // Source ending on a buffer boundary
+    {
+        const char *alignedPath = "/tmp/audio_buffer_pool_aligned.pcm";
+        vector<uint8_t> aligned;
+        makeInput(alignedPath, 4 * BUFFER_SIZE, aligned);
+        auto pool = TranscodeBufferPool::create(4, BUFFER_SIZE);
+        RunResult result = runSession(alignedPath, outPath, 64 * 1024, pool, pool);
+        CHECK(result.ok);
+        CHECK(readFile(outPath) == aligned);
+        unlink(alignedPath);
+    }
+}
+
+static void bench(const char *inPath, const char *outPath, size_t bytes) {
+    const double mb = bytes / 1e6;
+    RunResult perOp = runPerOperation(inPath, outPath, 64 * 1024);
+    CHECK(perOp.ok && perOp.stats.bytesRead == bytes / 2);
+    auto writePool = TranscodeBufferPool::create(4, BUFFER_SIZE);
+    auto readPool = TranscodeBufferPool::create(4, BUFFER_SIZE);
+    TranscodeSessionConfig config;
+    RunResult pooled = runSession(inPath, outPath, 64 * 1024, writePool, readPool);
+    CHECK(pooled.ok && pooled.stats.bytesRead == bytes / 2);
+
+    cout << std::fixed << std::setprecision(1);
+    cout << "per operation buffers: " << std::setw(7) << mb / perOp.seconds << " MB/s, "
+         << perOp.allocations << " allocations" << endl;
+    cout << "pooled session:        " << std::setw(7) << mb / pooled.seconds << " MB/s, "
+         << pooled.allocations << " allocations, " << pooled.stats.bufferStalls
+         << " buffer stalls" << endl;
+    CHECK(pooled.allocations * 10 < perOp.allocations);
+}
+
+int main(int argc, char **argv) {
+    size_t megabytes = 64;
+    int c;
+
+    while ((c = getopt(argc, argv, "m:h")) != -1) {
+        switch (c) {
+            case 'm': megabytes = static_cast<size_t>(atoi(optarg)); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-m megabytes]" << endl;
+                return 1;
+        }
+    }
+
+    const char *inPath = "/tmp/audio_buffer_pool_in.pcm";
+    const char *outPath = "/tmp/audio_buffer_pool_out.ulaw";
+    vector<uint8_t> reference;
+
+    testPool();
+    makeInput(inPath, 1000001, reference);
+    testTranscode(inPath, outPath, reference);
+    makeInput(inPath, megabytes * 1000000, reference);
+    bench(inPath, outPath, megabytes * 1000000);
+    unlink(inPath);
+    unlink(outPath);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
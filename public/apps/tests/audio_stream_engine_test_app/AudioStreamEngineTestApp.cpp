@@ -0,0 +1,668 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: AudioStreamEngineTestApp.cpp
+ *
+ * @brief: Loopback test of AudioStreamEngine over software capture and playback streams
+ *
+ * The software streams stand in for the audio service and run on their own clocks: every
+ * period the capture stream completes the oldest pending read, and the playback stream
+ * completes the write it was playing and starts the next one queued, or runs dry. The capture
+ * stream stamps a sequence number into each period and both record when each number was
+ * captured and started playing, which gives the actual glass to glass delay to compare with the
+ * estimate of the engine. A software IAudioManager creates the streams for
+ * AudioStreamEngine::open().
+ *
+ * The test runs the loopback with double buffering, then with a processor that stalls for a
+ * period once, with double buffering, whose playback queue holds half a period and underruns,
+ * and with triple buffering, which holds one and a half, and finally capture only and playback
+ * only.
+ *
+ * Usage: audio_stream_engine_test_app [-p period in ms, 20 by default] [-s seconds per run]
+ *                                     [-r SCHED_FIFO priority of the worker]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> AudioStreamEngineTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <telux/audio/AudioStreamEngine.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::vector;
+using telux::common::ErrorCode;
+using telux::common::Status;
+using namespace telux::audio;
+
+using Clock = std::chrono::steady_clock;
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "FAILED line " << __LINE__ << ": " #cond << endl;               \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const uint32_t SAMPLE_RATE = 16000;
+static const uint32_t BYTES_PER_SECOND = SAMPLE_RATE * 2;
+
+// Voice frames are 20 ms
+static uint32_t gPeriodMs = 20;
+static double gSeconds = 2.0;
+static int gPriority = 0;
+
+static uint32_t periodBytes() {
+    return BYTES_PER_SECOND * gPeriodMs / 1000;
+}
+
+/**
+ * When each sequence number was captured and started playing
+ */
+struct Timeline {
+    std::mutex mutex;
+    vector<Clock::time_point> captured;
+    vector<Clock::time_point> played;
+    vector<uint32_t> playOrder;
+
+    void capture(uint32_t seq, Clock::time_point t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (captured.size() <= seq) {
+            captured.resize(seq + 1);
+        }
+        captured[seq] = t;
+    }
+
+    void play(uint32_t seq, Clock::time_point t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (played.size() <= seq) {
+            played.resize(seq + 1);
+        }
+        played[seq] = t;
+        playOrder.push_back(seq);
+    }
+};
+
+class SoftBuffer : public IStreamBuffer {
+public:
+    explicit SoftBuffer(size_t size) : data_(size) {}
+    size_t getMinSize() override { return periodBytes(); }
+    size_t getMaxSize() override { return data_.size(); }
+    uint8_t *getRawBuffer() override { return data_.data(); }
+    uint32_t getDataSize() override { return dataSize_; }
+    void setDataSize(uint32_t size) override { dataSize_ = size; }
+    Status reset() override { dataSize_ = 0; return Status::SUCCESS; }
+private:
+    vector<uint8_t> data_;
+    uint32_t dataSize_ = 0;
+};
+
+/**
+ * Stream controls the engine does not use
+ */
+class SoftStream : virtual public IAudioStream {
+public:
+    Status setDevice(std::vector<DeviceType> devices,
+            telux::common::ResponseCallback callback) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status getDevice(GetStreamDeviceResponseCb callback) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status setVolume(StreamVolume volume, telux::common::ResponseCallback callback) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status getVolume(StreamDirection dir, GetStreamVolumeResponseCb callback) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status setMute(StreamMute mute, telux::common::ResponseCallback callback) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status getMute(StreamDirection dir, GetStreamMuteResponseCb callback) override {
+        return Status::NOTSUPPORTED;
+    }
+};
+
+/**
+ * Runs tick() once per period on its own thread, starting phase after construction
+ */
+class DeviceClock {
+public:
+    virtual ~DeviceClock() {
+        shutdown();
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(clockMutex_);
+            stop_ = true;
+        }
+        clockCv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+protected:
+    void startClock(Clock::duration phase) {
+        thread_ = std::thread([this, phase] {
+            Clock::time_point next = Clock::now() + phase;
+            std::unique_lock<std::mutex> lock(clockMutex_);
+            while (!clockCv_.wait_until(lock, next, [this] { return stop_; })) {
+                lock.unlock();
+                tick(next);
+                lock.lock();
+                next += std::chrono::milliseconds(gPeriodMs);
+            }
+        });
+    }
+
+    virtual void tick(Clock::time_point now) = 0;
+
+private:
+    std::mutex clockMutex_;
+    std::condition_variable clockCv_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+class SoftCaptureStream : public SoftStream, public IAudioCaptureStream, public DeviceClock {
+public:
+    explicit SoftCaptureStream(shared_ptr<Timeline> timeline) : timeline_(timeline) {
+        startClock(std::chrono::milliseconds(gPeriodMs));
+    }
+
+    ~SoftCaptureStream() {
+        shutdown();
+    }
+
+    StreamType getType() override { return StreamType::CAPTURE; }
+
+    shared_ptr<IStreamBuffer> getStreamBuffer() override {
+        return std::make_shared<SoftBuffer>(4 * periodBytes());
+    }
+
+    Status read(shared_ptr<IStreamBuffer> buffer, uint32_t bytesToRead,
+            ReadResponseCb callback) override {
+        if (bytesToRead > buffer->getMaxSize()) {
+            return Status::INVALIDPARAM;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        reads_.push_back(Read{buffer, bytesToRead, callback});
+        return Status::SUCCESS;
+    }
+
+    uint32_t getOverruns() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return overruns_;
+    }
+
+private:
+    struct Read {
+        shared_ptr<IStreamBuffer> buffer;
+        uint32_t bytes;
+        ReadResponseCb callback;
+    };
+
+    // The period from now - period to now has been captured
+    void tick(Clock::time_point now) override {
+        Read read;
+        uint32_t seq;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            seq = ++seq_;
+            if (reads_.empty()) {
+                ++overruns_;
+                return;
+            }
+            read = reads_.front();
+            reads_.pop_front();
+        }
+        timeline_->capture(seq, now - std::chrono::milliseconds(gPeriodMs));
+        uint8_t *data = read.buffer->getRawBuffer();
+        std::memset(data, 0, read.bytes);
+        std::memcpy(data, &seq, sizeof(seq));
+        read.buffer->setDataSize(read.bytes);
+        if (read.callback) {
+            read.callback(read.buffer, ErrorCode::SUCCESS);
+        }
+    }
+
+    shared_ptr<Timeline> timeline_;
+    std::mutex mutex_;
+    std::deque<Read> reads_;
+    uint32_t seq_ = 0;
+    uint32_t overruns_ = 0;
+};
+
+class SoftPlayStream : public SoftStream, public IAudioPlayStream, public DeviceClock {
+public:
+    explicit SoftPlayStream(shared_ptr<Timeline> timeline) : timeline_(timeline) {
+        // Half a period out of phase with the capture clock
+        startClock(std::chrono::milliseconds(gPeriodMs) / 2);
+    }
+
+    ~SoftPlayStream() {
+        shutdown();
+    }
+
+    StreamType getType() override { return StreamType::PLAY; }
+
+    shared_ptr<IStreamBuffer> getStreamBuffer() override {
+        return std::make_shared<SoftBuffer>(4 * periodBytes());
+    }
+
+    Status write(shared_ptr<IStreamBuffer> buffer, WriteResponseCb callback) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(Write{buffer, callback});
+        return Status::SUCCESS;
+    }
+
+    Status stopAudio(StopType stopType, telux::common::ResponseCallback callback) override {
+        return Status::NOTSUPPORTED;
+    }
+
+    Status registerListener(std::weak_ptr<IPlayListener> listener) override {
+        return Status::SUCCESS;
+    }
+
+    Status deRegisterListener(std::weak_ptr<IPlayListener> listener) override {
+        return Status::SUCCESS;
+    }
+
+    uint32_t getUnderruns() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return underruns_;
+    }
+
+private:
+    struct Write {
+        shared_ptr<IStreamBuffer> buffer;
+        WriteResponseCb callback;
+    };
+
+    // The buffer playing is done; the next one queued starts playing
+    void tick(Clock::time_point now) override {
+        Write done;
+        bool hadPlaying;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            hadPlaying = playing_;
+            done = current_;
+            playing_ = !queue_.empty();
+            if (playing_) {
+                current_ = queue_.front();
+                queue_.pop_front();
+                uint32_t seq;
+                std::memcpy(&seq, current_.buffer->getRawBuffer(), sizeof(seq));
+                if (seq != 0) {
+                    timeline_->play(seq, now);
+                }
+            } else {
+                current_ = Write();
+                if (hadPlaying) {
+                    ++underruns_;
+                }
+            }
+        }
+        if (hadPlaying && done.callback) {
+            done.callback(done.buffer, done.buffer->getDataSize(), ErrorCode::SUCCESS);
+        }
+    }
+
+    shared_ptr<Timeline> timeline_;
+    std::mutex mutex_;
+    std::deque<Write> queue_;
+    Write current_;
+    bool playing_ = false;
+    uint32_t underruns_ = 0;
+};
+
+/**
+ * Creates the software streams
+ */
+class SoftAudioManager : public IAudioManager {
+public:
+    explicit SoftAudioManager(shared_ptr<Timeline> timeline) : timeline_(timeline) {}
+
+    bool isSubsystemReady() override { return true; }
+
+    telux::common::ServiceStatus getServiceStatus() override {
+        return telux::common::ServiceStatus::SERVICE_AVAILABLE;
+    }
+
+    std::future<bool> onSubsystemReady() override {
+        std::promise<bool> ready;
+        ready.set_value(true);
+        return ready.get_future();
+    }
+
+    Status getDevices(GetDevicesResponseCb callback) override { return Status::NOTSUPPORTED; }
+
+    Status getStreamTypes(GetStreamTypesResponseCb callback) override {
+        return Status::NOTSUPPORTED;
+    }
+
+    Status createStream(StreamConfig streamConfig, CreateStreamResponseCb callback) override {
+        shared_ptr<IAudioStream> stream;
+        if (streamConfig.type == StreamType::CAPTURE) {
+            capture = std::make_shared<SoftCaptureStream>(timeline_);
+            stream = capture;
+        } else if (streamConfig.type == StreamType::PLAY) {
+            play = std::make_shared<SoftPlayStream>(timeline_);
+            stream = play;
+        } else {
+            return Status::NOTSUPPORTED;
+        }
+        if (callback) {
+            callback(stream, ErrorCode::SUCCESS);
+        }
+        return Status::SUCCESS;
+    }
+
+    Status createTranscoder(FormatInfo input, FormatInfo output,
+            CreateTranscoderResponseCb callback) override {
+        return Status::NOTSUPPORTED;
+    }
+
+    Status deleteStream(shared_ptr<IAudioStream> stream,
+            DeleteStreamResponseCb callback) override {
+        return Status::SUCCESS;
+    }
+
+    Status registerListener(std::weak_ptr<IAudioListener> listener) override {
+        return Status::SUCCESS;
+    }
+
+    Status deRegisterListener(std::weak_ptr<IAudioListener> listener) override {
+        return Status::SUCCESS;
+    }
+
+    Status getCalibrationInitStatus(GetCalInitStatusResponseCb callback) override {
+        return Status::NOTSUPPORTED;
+    }
+
+    shared_ptr<SoftCaptureStream> capture;
+    shared_ptr<SoftPlayStream> play;
+
+private:
+    shared_ptr<Timeline> timeline_;
+};
+
+static StreamConfig streamConfig(StreamType type) {
+    StreamConfig config{};
+    config.type = type;
+    config.sampleRate = SAMPLE_RATE;
+    config.channelTypeMask = ChannelType::LEFT;
+    config.format = AudioFormat::PCM_16BIT_SIGNED;
+    config.formatParams = nullptr;
+    return config;
+}
+
+static void printStats(const char *name, const AudioEngineStats &stats) {
+    cout << std::setw(22) << std::left << name << std::right
+         << " periods " << std::setw(4) << stats.playedPeriods
+         << "  underruns " << stats.underruns
+         << "  overruns " << stats.overruns
+         << "  callback p50/p99/max " << stats.callbackLatency.percentileUs(0.5) << "/"
+         << stats.callbackLatency.percentileUs(0.99) << "/" << stats.callbackLatency.maxUs
+         << " us  jitter p99 " << stats.periodJitter.percentileUs(0.99)
+         << " us  glass to glass " << stats.glassToGlassUs / 1000.0 << " ms"
+         << (stats.realTimeWorker ? "  (SCHED_FIFO)" : "") << endl;
+}
+
+struct LoopbackResult {
+    AudioEngineStats stats;
+    uint32_t deviceUnderruns = 0;
+    uint32_t deviceOverruns = 0;
+    double measuredDelayMs = 0;
+    bool inOrder = true;
+};
+
+// Capture to playback through open(), with a processor that stalls once if stallMs is set
+static LoopbackResult runLoopback(uint32_t depth, uint32_t preroll, uint32_t stallMs) {
+    LoopbackResult result;
+    auto timeline = std::make_shared<Timeline>();
+    auto manager = std::make_shared<SoftAudioManager>(timeline);
+    AudioEngineConfig config;
+    config.depth = depth;
+    config.prerollPeriods = preroll;
+    config.realTimePriority = gPriority;
+    auto processed = std::make_shared<std::atomic<uint32_t>>(0);
+    auto processor = [processed, stallMs](const uint8_t *in, uint8_t *out, size_t bytes) {
+        if (stallMs && ++*processed == 50) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(stallMs));
+        }
+        std::memcpy(out, in, bytes);
+    };
+
+    std::promise<shared_ptr<AudioStreamEngine>> opened;
+    CHECK(AudioStreamEngine::open(manager, streamConfig(StreamType::CAPTURE),
+        streamConfig(StreamType::PLAY), config, processor,
+        [&opened](shared_ptr<AudioStreamEngine> engine, ErrorCode error) {
+            opened.set_value(error == ErrorCode::SUCCESS ? engine : nullptr);
+        }) == Status::SUCCESS);
+    auto engine = opened.get_future().get();
+    CHECK(engine != nullptr);
+    if (!engine) {
+        return result;
+    }
+    CHECK(engine->start() == Status::SUCCESS);
+    CHECK(engine->start() == Status::ALREADY);
+    CHECK(engine->getPeriodBytes() == periodBytes());
+    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(gSeconds * 1000)));
+    CHECK(engine->stop() == Status::SUCCESS);
+    result.stats = engine->getStats();
+    manager->capture->shutdown();
+    manager->play->shutdown();
+    result.deviceUnderruns = manager->play->getUnderruns();
+    result.deviceOverruns = manager->capture->getOverruns();
+
+    // Actual delay over the second half of the run
+    std::lock_guard<std::mutex> lock(timeline->mutex);
+    double totalMs = 0;
+    int count = 0;
+    for (size_t i = 0; i < timeline->playOrder.size(); ++i) {
+        const uint32_t seq = timeline->playOrder[i];
+        if (i > 0 && seq != timeline->playOrder[i - 1] + 1) {
+            result.inOrder = false;
+        }
+        if (i >= timeline->playOrder.size() / 2 && seq < timeline->captured.size()) {
+            totalMs += std::chrono::duration<double, std::milli>(
+                timeline->played[seq] - timeline->captured[seq]).count();
+            ++count;
+        }
+    }
+    result.measuredDelayMs = count ? totalMs / count : 0;
+    return result;
+}
+
+static void testHistogram() {
+    AudioLatencyHistogram histogram;
+    CHECK(histogram.percentileUs(0.5) == 0);
+    for (uint32_t us = 0; us < 100; ++us) {
+        histogram.add(us < 90 ? 10 : 1000);
+    }
+    CHECK(histogram.samples == 100);
+    CHECK(histogram.counts[0] == 90);
+    CHECK(histogram.percentileUs(0.5) == 64);
+    CHECK(histogram.percentileUs(0.99) == 1000);
+    CHECK(histogram.maxUs == 1000);
+    CHECK(histogram.meanUs() == (90 * 10 + 10 * 1000) / 100);
+    histogram.add(100000000);
+    CHECK(histogram.counts[AudioLatencyHistogram::BUCKETS - 1] == 1);
+    CHECK(histogram.percentileUs(1.0) == 100000000);
+}
+
+static void testCreate() {
+    auto timeline = std::make_shared<Timeline>();
+    auto play = std::make_shared<SoftPlayStream>(timeline);
+    AudioEngineConfig config;
+    CHECK(AudioStreamEngine::create(nullptr, nullptr) == nullptr);
+    // A single stream needs a processor
+    CHECK(AudioStreamEngine::create(nullptr, play) == nullptr);
+    config.depth = 0;
+    CHECK(AudioStreamEngine::create(nullptr, play, config,
+        [](const uint8_t *, uint8_t *, size_t) {}) == nullptr);
+    config.depth = 2;
+    config.periodBytes = 8 * periodBytes();
+    auto engine = AudioStreamEngine::create(nullptr, play, config,
+        [](const uint8_t *, uint8_t *, size_t) {});
+    CHECK(engine != nullptr);
+    CHECK(engine->start() == Status::INVALIDPARAM);
+    CHECK(engine->stop() == Status::INVALIDSTATE);
+}
+
+static void testLoopback() {
+    const double periodMs = gPeriodMs;
+
+    LoopbackResult steady = runLoopback(2, 1, 0);
+    printStats("double buffering", steady.stats);
+    cout << std::setw(22) << "" << " measured glass to glass " << steady.measuredDelayMs
+         << " ms" << endl;
+    CHECK(steady.inOrder || steady.deviceOverruns > 0);
+    CHECK(steady.stats.playedPeriods + 10 >= gSeconds * 1000 / periodMs);
+    CHECK(steady.stats.errors == 0 && steady.stats.shortWrites == 0);
+    CHECK(steady.stats.underruns == steady.deviceUnderruns);
+    CHECK(steady.stats.callbackLatency.samples <= steady.stats.capturedPeriods);
+    CHECK(steady.stats.periodJitter.samples + 1 == steady.stats.capturedPeriods);
+    // The estimate follows the delay of the stand-in streams to within a period
+    CHECK(steady.stats.glassToGlassUs > 0);
+    CHECK(std::abs(steady.stats.glassToGlassUs / 1000.0 - steady.measuredDelayMs) < periodMs);
+
+    LoopbackResult stallDouble = runLoopback(2, 1, gPeriodMs);
+    printStats("double, one stall", stallDouble.stats);
+    cout << std::setw(22) << "" << " stand-in underruns " << stallDouble.deviceUnderruns
+         << " overruns " << stallDouble.deviceOverruns << endl;
+    CHECK(stallDouble.stats.underruns > 0);
+    CHECK(stallDouble.stats.underruns == stallDouble.deviceUnderruns);
+
+    LoopbackResult stallTriple = runLoopback(3, 2, gPeriodMs);
+    printStats("triple, one stall", stallTriple.stats);
+    cout << std::setw(22) << "" << " stand-in underruns " << stallTriple.deviceUnderruns
+         << " overruns " << stallTriple.deviceOverruns << endl;
+    CHECK(stallTriple.stats.underruns == 0 && stallTriple.deviceUnderruns == 0);
+    CHECK(stallTriple.stats.overruns == 0 && stallTriple.deviceOverruns == 0);
+    CHECK(stallTriple.inOrder);
+    // A period to capture, half a period to the playback clock and a period of preroll more
+    CHECK(stallTriple.measuredDelayMs > 2 * periodMs);
+}
+
+static void testSingleStream() {
+    auto timeline = std::make_shared<Timeline>();
+    AudioEngineConfig config;
+    config.bytesPerSecond = BYTES_PER_SECOND;
+
+    auto capture = std::make_shared<SoftCaptureStream>(timeline);
+    std::atomic<uint32_t> capturedBytes{0};
+    auto recorder = AudioStreamEngine::create(capture, nullptr, config,
+        [&capturedBytes](const uint8_t *in, uint8_t *out, size_t bytes) {
+            if (in && !out) {
+                capturedBytes += static_cast<uint32_t>(bytes);
+            }
+        });
+    auto play = std::make_shared<SoftPlayStream>(timeline);
+    std::atomic<uint32_t> filled{0};
+    auto player = AudioStreamEngine::create(nullptr, play, config,
+        [&filled](const uint8_t *in, uint8_t *out, size_t bytes) {
+            if (!in && out) {
+                std::memset(out, 0, bytes);
+                ++filled;
+            }
+        });
+    CHECK(recorder->start() == Status::SUCCESS);
+    CHECK(player->start() == Status::SUCCESS);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30 * gPeriodMs));
+    CHECK(recorder->stop() == Status::SUCCESS);
+    CHECK(player->stop() == Status::SUCCESS);
+    capture->shutdown();
+    play->shutdown();
+
+    AudioEngineStats recorded = recorder->getStats();
+    AudioEngineStats played = player->getStats();
+    CHECK(recorded.capturedPeriods >= 20);
+    // Less the periods still queued for the worker when it stopped
+    CHECK(capturedBytes <= recorded.capturedPeriods * periodBytes());
+    CHECK(capturedBytes / periodBytes() + config.depth >= recorded.capturedPeriods);
+    CHECK(played.playedPeriods >= 20);
+    CHECK(played.underruns == 0);
+    CHECK(filled >= played.playedPeriods);
+}
+
+int main(int argc, char **argv) {
+    int c;
+
+    while ((c = getopt(argc, argv, "p:s:r:h")) != -1) {
+        switch (c) {
+            case 'p': gPeriodMs = static_cast<uint32_t>(atoi(optarg)); break;
+            case 's': gSeconds = atof(optarg); break;
+            case 'r': gPriority = atoi(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-p period ms] [-s seconds] [-r priority]"
+                     << endl;
+                return 1;
+        }
+    }
+    if (gPeriodMs < 4 || gSeconds < 1) {
+        cerr << "period must be at least 4 ms and runs at least 1 s" << endl;
+        return 1;
+    }
+
+    testHistogram();
+    testCreate();
+    testLoopback();
+    testSingleStream();
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,541 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: Cv2xRxMetaDataTestApp.cpp
+ *
+ * @brief: Checks and benchmarks the Rx meta data parsers of Cv2xRxMetaDataHelper.hpp
+ *
+ * Round trips random reports through the caller array and streaming parsers, checks that
+ * they give the same reports and meta data length as the shared_ptr<vector> helper, fuzzes
+ * both with mutated and truncated meta data (every result must stay inside the payload and
+ * both parsers must agree), then times them against the shared_ptr<vector> helper per packet.
+ *
+ * Usage: cv2x_rx_meta_data_test_app [-n fuzz iterations] [-b bench packets] [-s seed]
+ *
+ * The shared_ptr<vector> helper lives in libtelux_cv2x. For a host build without it, define
+ * CV2X_RX_META_DATA_HOST_BUILD to use a stand-in that follows the library's parsing step by
+ * step, allocations included:
+ *     g++ -std=c++11 -O2 -DCV2X_RX_META_DATA_HOST_BUILD -I<telux headers> \
+ *         Cv2xRxMetaDataTestApp.cpp -o cv2x_rx_meta_data_test_app
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <telux/cv2x/Cv2xRxMetaDataHelper.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+using telux::common::Status;
+using namespace telux::cv2x;
+
+static constexpr size_t MAX_REPORTS = 8u;
+static constexpr size_t MAX_PACKET = 512u;
+
+#ifdef CV2X_RX_META_DATA_HOST_BUILD
+telux::common::Status Cv2xRxMetaDataHelper::getRxMetaDataInfo(const uint8_t* payload,
+    uint32_t payloadLength, size_t& metaDataLen,
+    std::shared_ptr<std::vector<RxPacketMetaDataReport>> metaDatas) {
+    RxPacketMetaDataReport report;
+    const uint8_t* p = payload;
+    uint32_t left = payloadLength;
+
+    memset(&report, 0, sizeof(report));
+    metaDataLen = 0;
+    if (payload == nullptr || metaDatas == nullptr) {
+        return Status::INVALIDPARAM;
+    }
+    for (;;) {
+        size_t header = 0;
+        if (left > RX_META_DATA_HEADER_LEN
+            && Cv2xRxMetaDataHelper::hasRxMetaDataReport(p, left, 0)) {
+            report.metaDataMask |= RX_SUBFRAME_NUMBER | RX_SUBCHANNEL_INDEX;
+            report.sfn = static_cast<uint16_t>(p[3] | (p[4] << 8));
+            report.subChannelIndex = p[7];
+            header = RX_META_DATA_HEADER_LEN;
+            p += header;
+            left -= header;
+        } else if ((report.metaDataMask & (RX_SUBFRAME_NUMBER | RX_SUBCHANNEL_INDEX))
+            != (RX_SUBFRAME_NUMBER | RX_SUBCHANNEL_INDEX)) {
+            return Status::SUCCESS;
+        }
+        // TLVs up to END, the report is dropped on anything else
+        const uint8_t* cur = p;
+        const uint8_t* last = p + left - 1;
+        bool end = false;
+        if (header > 0 && p[0] == RX_META_DATA_END) {
+            last = cur;
+            end = true;
+        } else if (left <= 2) {
+            return Status::SUCCESS;
+        }
+        while (!end && cur <= last) {
+            uint8_t type = cur[0];
+            if (type == RX_META_DATA_END) {
+                last = cur;
+                end = true;
+                break;
+            }
+            if (type == RX_META_DATA_PADDING) {
+                ++cur;
+                continue;
+            }
+            uint8_t size = (type == RX_META_DATA_TLV_SUBCHANNEL_NUMBER) ? 1 :
+                (type == RX_META_DATA_TLV_RSSI) ? 2 :
+                (type == RX_META_DATA_TLV_L2_DEST_ID || type == RX_META_DATA_TLV_SCI_FORMAT1
+                    || type == RX_META_DATA_TLV_DELAY_ESTIMATION) ? 4 : 0;
+            if (size == 0 || last < cur + 2 + size || cur[1] != size) {
+                break;
+            }
+            switch (type) {
+                case RX_META_DATA_TLV_SUBCHANNEL_NUMBER:
+                    report.subChannelNum = cur[2];
+                    report.metaDataMask |= RX_SUBCHANNEL_NUMBER;
+                    break;
+                case RX_META_DATA_TLV_RSSI:
+                    report.prxRssi = static_cast<int8_t>(cur[2]);
+                    report.drxRssi = static_cast<int8_t>(cur[3]);
+                    report.metaDataMask |= RX_PRX_RSSI | RX_DRX_RSSI;
+                    break;
+                case RX_META_DATA_TLV_L2_DEST_ID:
+                    memcpy(&report.l2DestinationId, cur + 2, 4);
+                    report.metaDataMask |= RX_L2_DEST_ID;
+                    break;
+                case RX_META_DATA_TLV_SCI_FORMAT1:
+                    memcpy(&report.sciFormat1Info, cur + 2, 4);
+                    report.metaDataMask |= RX_SCI_FORMAT1;
+                    break;
+                default:
+                    memcpy(&report.delayEstimation, cur + 2, 4);
+                    report.metaDataMask |= RX_DELAY_ESTIMATION;
+                    break;
+            }
+            cur += 2 + size;
+        }
+        if (!end) {
+            return Status::SUCCESS;
+        }
+
+        uint32_t consumed = static_cast<uint32_t>(last - p) + 1;
+        p += consumed;
+        left -= consumed;
+        metaDataLen += header + consumed;
+        metaDatas->push_back(report);
+        if (left <= RX_META_DATA_HEADER_LEN + 1) {
+            return Status::SUCCESS;
+        }
+    }
+}
+#endif
+
+static std::mt19937 gRand;
+static unsigned gFailures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            cerr << "CHECK failed line " << __LINE__ << ": " #cond << endl; \
+            ++gFailures;                                                   \
+        }                                                                  \
+    } while (0)
+
+static void putTlv(vector<uint8_t>& buf, uint8_t type, uint32_t v, uint8_t len) {
+    buf.push_back(type);
+    buf.push_back(len);
+    for (uint8_t i = 0; i < len; ++i) {
+        buf.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+// sfn and subchannel index are always there, PRx and DRx RSSI come in one TLV
+static RxMetaDataValidity randomMask() {
+    RxMetaDataValidity mask = RX_SUBFRAME_NUMBER | RX_SUBCHANNEL_INDEX;
+    const RxMetaDataValidity optional[] = {RX_SUBCHANNEL_NUMBER, RX_PRX_RSSI | RX_DRX_RSSI,
+        RX_L2_DEST_ID, RX_SCI_FORMAT1, RX_DELAY_ESTIMATION};
+
+    for (auto bits : optional) {
+        if (gRand() & 1) {
+            mask |= bits;
+        }
+    }
+    return mask;
+}
+
+static RxPacketMetaDataReport randomReport(RxMetaDataValidity mask) {
+    RxPacketMetaDataReport r;
+
+    memset(&r, 0, sizeof(r));
+    r.metaDataMask = mask;
+    r.sfn = gRand() % 10240;
+    r.subChannelIndex = gRand() % 20;
+    r.subChannelNum = 1 + gRand() % 20;
+    r.prxRssi = static_cast<int8_t>(-(gRand() % 110));
+    r.drxRssi = static_cast<int8_t>(-(gRand() % 110));
+    r.l2DestinationId = gRand() & 0xFFFFFF;
+    r.sciFormat1Info = gRand();
+    r.delayEstimation = static_cast<int32_t>(gRand() % 4096) - 2048;
+    return r;
+}
+
+// Optional TLVs go in random order with the odd padding byte in between.
+static void encodeReport(vector<uint8_t>& buf, const RxPacketMetaDataReport& r) {
+    vector<uint8_t> tlvs[5];
+    size_t n = 0;
+
+    buf.push_back(RX_META_DATA_START);
+    putTlv(buf, RX_META_DATA_TLV_SUBFRAME_NUMBER, r.sfn, 2);
+    putTlv(buf, RX_META_DATA_TLV_SUBCHANNEL_INDEX, r.subChannelIndex, 1);
+    if (r.metaDataMask & RX_SUBCHANNEL_NUMBER) {
+        putTlv(tlvs[n++], RX_META_DATA_TLV_SUBCHANNEL_NUMBER, r.subChannelNum, 1);
+    }
+    if (r.metaDataMask & RX_PRX_RSSI) {
+        putTlv(tlvs[n++], RX_META_DATA_TLV_RSSI, static_cast<uint8_t>(r.prxRssi)
+            | (static_cast<uint8_t>(r.drxRssi) << 8), 2);
+    }
+    if (r.metaDataMask & RX_L2_DEST_ID) {
+        putTlv(tlvs[n++], RX_META_DATA_TLV_L2_DEST_ID, r.l2DestinationId, 4);
+    }
+    if (r.metaDataMask & RX_SCI_FORMAT1) {
+        putTlv(tlvs[n++], RX_META_DATA_TLV_SCI_FORMAT1, r.sciFormat1Info, 4);
+    }
+    if (r.metaDataMask & RX_DELAY_ESTIMATION) {
+        putTlv(tlvs[n++], RX_META_DATA_TLV_DELAY_ESTIMATION,
+            static_cast<uint32_t>(r.delayEstimation), 4);
+    }
+    std::shuffle(tlvs, tlvs + n, gRand);
+    for (size_t i = 0; i < n; ++i) {
+        if (gRand() % 8 == 0) {
+            buf.push_back(RX_META_DATA_PADDING);
+        }
+        buf.insert(buf.end(), tlvs[i].begin(), tlvs[i].end());
+    }
+    buf.push_back(RX_META_DATA_END);
+}
+
+static bool sameReport(const RxPacketMetaDataReport& a, const RxPacketMetaDataReport& b) {
+    uint32_t m = a.metaDataMask;
+
+    return m == b.metaDataMask
+        && (!(m & RX_SUBFRAME_NUMBER) || a.sfn == b.sfn)
+        && (!(m & RX_SUBCHANNEL_INDEX) || a.subChannelIndex == b.subChannelIndex)
+        && (!(m & RX_SUBCHANNEL_NUMBER) || a.subChannelNum == b.subChannelNum)
+        && (!(m & RX_PRX_RSSI) || a.prxRssi == b.prxRssi)
+        && (!(m & RX_DRX_RSSI) || a.drxRssi == b.drxRssi)
+        && (!(m & RX_L2_DEST_ID) || a.l2DestinationId == b.l2DestinationId)
+        && (!(m & RX_SCI_FORMAT1) || a.sciFormat1Info == b.sciFormat1Info)
+        && (!(m & RX_DELAY_ESTIMATION) || a.delayEstimation == b.delayEstimation);
+}
+
+// Random packet: nReports meta data reports followed by a non empty payload that does not
+// start with a meta data byte. With sameMask all reports carry the same TLVs, the
+// shared_ptr<vector> helper keeps the fields of one report in the next one when missing.
+static vector<uint8_t> randomPacket(vector<RxPacketMetaDataReport>& reports, size_t& metaLen,
+    bool sameMask = false) {
+    vector<uint8_t> buf;
+    size_t n = gRand() % (MAX_REPORTS + 1);
+    RxMetaDataValidity mask = randomMask();
+
+    reports.clear();
+    for (size_t i = 0; i < n; ++i) {
+        reports.push_back(randomReport(sameMask ? mask : randomMask()));
+        encodeReport(buf, reports.back());
+    }
+    metaLen = buf.size();
+    size_t payload = 1 + gRand() % 300;
+    for (size_t i = 0; i < payload; ++i) {
+        buf.push_back(static_cast<uint8_t>(gRand()));
+    }
+    if (buf[metaLen] <= RX_META_DATA_TLV_SUBCHANNEL_NUMBER
+        || buf[metaLen] == RX_META_DATA_START) {
+        buf[metaLen] = 0x20;
+    }
+    return buf;
+}
+
+static void testRoundTrip(unsigned iterations) {
+    RxPacketMetaDataReport out[MAX_REPORTS];
+    RxPacketMetaDataReport r;
+
+    for (unsigned it = 0; it < iterations; ++it) {
+        vector<RxPacketMetaDataReport> reports;
+        size_t metaLen;
+        vector<uint8_t> buf = randomPacket(reports, metaLen);
+        size_t len = 0, num = MAX_REPORTS;
+
+        CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(buf.data(), buf.size(), len, out, num)
+            == Status::SUCCESS);
+        CHECK(len == metaLen);
+        CHECK(num == reports.size());
+        for (size_t i = 0; i < num && i < reports.size(); ++i) {
+            CHECK(sameReport(reports[i], out[i]));
+        }
+
+        Cv2xRxMetaDataReader reader(buf.data(), buf.size());
+        size_t i = 0;
+        while (reader.next(r)) {
+            CHECK(i < reports.size() && sameReport(reports[i], r));
+            ++i;
+        }
+        CHECK(reader.status() == Status::SUCCESS);
+        CHECK(reader.metaDataLen() == metaLen);
+        CHECK(i == reports.size());
+
+        // short array: all meta data skipped, extra reports dropped
+        if (reports.size() > 1) {
+            num = 1;
+            CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(buf.data(), buf.size(), len, out, num)
+                == Status::NOMEMORY);
+            CHECK(num == 1 && len == metaLen && sameReport(reports[0], out[0]));
+        }
+    }
+
+    size_t len = 1, num = MAX_REPORTS;
+    CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(nullptr, 0, len, out, num) == Status::SUCCESS);
+    CHECK(len == 0 && num == 0);
+    num = MAX_REPORTS;
+    CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(nullptr, 4, len, out, num)
+        == Status::INVALIDPARAM);
+    num = 1;
+    uint8_t one[] = {RX_META_DATA_START, RX_META_DATA_TLV_SUBFRAME_NUMBER, 2, 0, 0,
+        RX_META_DATA_TLV_SUBCHANNEL_INDEX, 1, 0, RX_META_DATA_END};
+    CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(one, sizeof(one), len, nullptr, num)
+        == Status::INVALIDPARAM);
+}
+
+// The caller array and streaming parsers against the shared_ptr<vector> helper.
+static void testLibraryEquivalence(unsigned iterations) {
+    RxPacketMetaDataReport out[MAX_REPORTS];
+    RxPacketMetaDataReport r;
+
+    for (unsigned it = 0; it < iterations; ++it) {
+        vector<RxPacketMetaDataReport> reports;
+        size_t metaLen;
+        vector<uint8_t> buf = randomPacket(reports, metaLen, true);
+        auto expected = make_shared<vector<RxPacketMetaDataReport>>();
+        size_t expectedLen = ~0u, len = ~0u, num = MAX_REPORTS;
+
+        CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(buf.data(), buf.size(), expectedLen,
+            expected) == Status::SUCCESS);
+        CHECK(Cv2xRxMetaDataHelper::getRxMetaDataInfo(buf.data(), buf.size(), len, out, num)
+            == Status::SUCCESS);
+        CHECK(expectedLen == metaLen && len == expectedLen);
+        CHECK(expected->size() == reports.size() && num == expected->size());
+        for (size_t i = 0; i < num && i < expected->size(); ++i) {
+            CHECK(sameReport((*expected)[i], out[i]));
+        }
+
+        Cv2xRxMetaDataReader reader(buf.data(), buf.size());
+        size_t i = 0;
+        while (reader.next(r)) {
+            CHECK(i < expected->size() && sameReport((*expected)[i], r));
+            ++i;
+        }
+        CHECK(reader.status() == Status::SUCCESS);
+        CHECK(reader.metaDataLen() == expectedLen && i == expected->size());
+    }
+}
+
+static void mutate(vector<uint8_t>& buf) {
+    unsigned edits = 1 + gRand() % 4;
+
+    for (unsigned e = 0; e < edits && !buf.empty(); ++e) {
+        size_t pos = gRand() % buf.size();
+        switch (gRand() % 5) {
+            case 0: buf[pos] = static_cast<uint8_t>(gRand()); break;
+            case 1: buf[pos] ^= 1u << (gRand() % 8); break;
+            case 2: buf.resize(pos); break;
+            case 3: buf[pos] = (gRand() & 1) ? RX_META_DATA_START : RX_META_DATA_END; break;
+            default: buf.insert(buf.begin() + pos, static_cast<uint8_t>(gRand() % 16)); break;
+        }
+    }
+}
+
+static void testFuzz(unsigned iterations) {
+    RxPacketMetaDataReport out[MAX_REPORTS];
+    RxPacketMetaDataReport r;
+    unsigned failed = 0, full = 0;
+
+    for (unsigned it = 0; it < iterations; ++it) {
+        vector<RxPacketMetaDataReport> reports;
+        size_t metaLen;
+        vector<uint8_t> buf = randomPacket(reports, metaLen);
+
+        if (it % 8 == 0) {
+            buf.resize(gRand() % 64);
+            for (auto& b : buf) {
+                b = (gRand() % 3 == 0) ? RX_META_DATA_START : static_cast<uint8_t>(gRand() % 12);
+            }
+            if (buf.size() > RX_META_DATA_HEADER_LEN && gRand() % 2) {
+                // valid header so the TLVs after it get exercised
+                const uint8_t header[] = {RX_META_DATA_START, RX_META_DATA_TLV_SUBFRAME_NUMBER, 2,
+                    0x12, 0x34, RX_META_DATA_TLV_SUBCHANNEL_INDEX, 1, 0x05};
+                memcpy(buf.data(), header, sizeof(header));
+            }
+        } else {
+            mutate(buf);
+        }
+        // exact sized heap copy so an overread is caught by ASan or valgrind
+        size_t size = buf.size();
+        std::unique_ptr<uint8_t[]> pkt(new uint8_t[size ? size : 1]);
+        if (size > 0) {
+            memcpy(pkt.get(), buf.data(), size);
+        }
+
+        size_t len = ~0u, num = MAX_REPORTS;
+        Status st = Cv2xRxMetaDataHelper::getRxMetaDataInfo(pkt.get(), size, len, out, num);
+        CHECK(st == Status::SUCCESS || st == Status::FAILED || st == Status::NOMEMORY);
+        CHECK(len <= size && num <= MAX_REPORTS);
+        if (st == Status::SUCCESS) {
+            CHECK(!Cv2xRxMetaDataHelper::hasRxMetaDataReport(pkt.get(), size, len));
+        } else {
+            failed += (st == Status::FAILED);
+            full += (st == Status::NOMEMORY);
+        }
+
+        Cv2xRxMetaDataReader reader(pkt.get(), size);
+        size_t i = 0;
+        while (reader.next(r)) {
+            CHECK(i >= MAX_REPORTS || sameReport(out[i], r));
+            ++i;
+        }
+        CHECK(reader.metaDataLen() <= size);
+        if (st == Status::FAILED) {
+            CHECK(reader.status() == Status::FAILED);
+        } else {
+            CHECK(reader.status() == Status::SUCCESS);
+            CHECK(reader.metaDataLen() == len);
+            CHECK(i >= num);
+        }
+    }
+    cout << "fuzz: " << iterations << " packets, " << failed << " malformed, " << full
+         << " with more than " << MAX_REPORTS << " reports" << endl;
+}
+
+static double nsPerPacket(std::chrono::steady_clock::time_point t0, size_t packets) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    return static_cast<double>(ns) / packets;
+}
+
+static void bench(size_t packets) {
+    const size_t distinct = 1024;
+    vector<vector<uint8_t>> pkts;
+    RxPacketMetaDataReport out[MAX_REPORTS];
+    RxPacketMetaDataReport r;
+    uint64_t sink = 0;
+
+    // one report per packet, as when only the packet's own meta data is attached
+    for (size_t i = 0; i < distinct; ++i) {
+        RxPacketMetaDataReport rep = randomReport(0xFF);
+        vector<uint8_t> buf;
+        encodeReport(buf, rep);
+        buf.resize(buf.size() + 100, 0x20);
+        pkts.push_back(buf);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; ++i) {
+        const vector<uint8_t>& p = pkts[i % distinct];
+        size_t len = 0;
+        auto reports = make_shared<vector<RxPacketMetaDataReport>>();
+        Cv2xRxMetaDataHelper::getRxMetaDataInfo(p.data(), p.size(), len, reports);
+        sink += len + (reports->empty() ? 0 : reports->front().sfn);
+    }
+    double vec = nsPerPacket(t0, packets);
+
+    t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; ++i) {
+        const vector<uint8_t>& p = pkts[i % distinct];
+        size_t len = 0, num = MAX_REPORTS;
+        Cv2xRxMetaDataHelper::getRxMetaDataInfo(p.data(), p.size(), len, out, num);
+        sink += len + (num ? out[0].sfn : 0);
+    }
+    double arr = nsPerPacket(t0, packets);
+
+    t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; ++i) {
+        const vector<uint8_t>& p = pkts[i % distinct];
+        Cv2xRxMetaDataReader reader(p.data(), p.size());
+        while (reader.next(r)) {
+            sink += r.sfn;
+        }
+        sink += reader.metaDataLen();
+    }
+    double rd = nsPerPacket(t0, packets);
+
+    cout << "bench: " << packets << " packets, 1 report of 7 TLVs each (sink " << (sink & 0xF)
+         << ")" << endl;
+    cout << "  shared_ptr<vector> : " << vec << " ns/packet" << endl;
+    cout << "  caller array       : " << arr << " ns/packet" << endl;
+    cout << "  reader             : " << rd << " ns/packet" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned iterations = 200000;
+    size_t packets = 2000000;
+    unsigned seed = 1;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:b:s:")) != -1) {
+        switch (c) {
+            case 'n': iterations = strtoul(optarg, nullptr, 0); break;
+            case 'b': packets = strtoul(optarg, nullptr, 0); break;
+            case 's': seed = strtoul(optarg, nullptr, 0); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-n fuzz iterations] [-b bench packets]"
+                     << " [-s seed]" << endl;
+                return EXIT_FAILURE;
+        }
+    }
+
+    gRand.seed(seed);
+    testRoundTrip(iterations / 10);
+    testLibraryEquivalence(iterations / 10);
+    testFuzz(iterations);
+    if (packets > 0) {
+        bench(packets);
+    }
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "all checks passed" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,692 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: FirewallTransactionTestApp.cpp
+ *
+ * @brief: Tests and provisioning benchmark of FirewallRuleCache
+ *
+ * A mock IFirewallManager stands in for the modem: requests are answered in order on a
+ * worker thread after a fixed transport latency plus a per-request service time, and adds
+ * or removes can be made to fail. The tests check that sync() sends only the difference
+ * between the requested rules and the cache, that a failed add or remove rolls the profile
+ * back to its rules before the transaction, that batches with unknown handles are rejected
+ * without changes, that one transaction runs at a time and that rules changed behind the
+ * cache are picked up by refresh().
+ *
+ * The benchmark provisions 10, 100 and 500 rules one request at a time, as applications do
+ * with addFirewallEntry, and as one transaction, and re-provisions the set with a tenth of
+ * the rules changed.
+ *
+ * Usage: firewall_transaction_test_app [-l latency us] [-s service time us]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> FirewallTransactionTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <telux/data/net/FirewallTransaction.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using telux::common::ErrorCode;
+using telux::common::Status;
+using namespace telux::data;
+using namespace telux::data::net;
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const int PROFILE = 1;
+static const IpProtocol PROTO_TCP = 6;
+static const IpProtocol PROTO_UDP = 17;
+
+// Filters and entries as DataFactory creates them
+
+class TcpFilter : public ITcpFilter {
+ public:
+    IPv4Info getIPv4Info() override { return v4_; }
+    Status setIPv4Info(const IPv4Info &info) override { v4_ = info; return Status::SUCCESS; }
+    IPv6Info getIPv6Info() override { return IPv6Info(); }
+    Status setIPv6Info(const IPv6Info &) override { return Status::NOTSUPPORTED; }
+    IpProtocol getIpProtocol() override { return PROTO_TCP; }
+    IpFamilyType getIpFamily() override { return IpFamilyType::IPV4; }
+    TcpInfo getTcpInfo() override { return tcp_; }
+    Status setTcpInfo(const TcpInfo &info) override { tcp_ = info; return Status::SUCCESS; }
+
+ private:
+    IPv4Info v4_;
+    TcpInfo tcp_;
+};
+
+class UdpFilter : public IUdpFilter {
+ public:
+    IPv4Info getIPv4Info() override { return v4_; }
+    Status setIPv4Info(const IPv4Info &info) override { v4_ = info; return Status::SUCCESS; }
+    IPv6Info getIPv6Info() override { return IPv6Info(); }
+    Status setIPv6Info(const IPv6Info &) override { return Status::NOTSUPPORTED; }
+    IpProtocol getIpProtocol() override { return PROTO_UDP; }
+    IpFamilyType getIpFamily() override { return IpFamilyType::IPV4; }
+    UdpInfo getUdpInfo() override { return udp_; }
+    Status setUdpInfo(const UdpInfo &info) override { udp_ = info; return Status::SUCCESS; }
+
+ private:
+    IPv4Info v4_;
+    UdpInfo udp_;
+};
+
+class TestEntry : public IFirewallEntry {
+ public:
+    TestEntry(shared_ptr<IIpFilter> filter, Direction direction, uint32_t handle = INVALID_HANDLE)
+       : filter_(filter)
+       , direction_(direction)
+       , handle_(handle) {
+    }
+    shared_ptr<IIpFilter> getIProtocolFilter() override { return filter_; }
+    Direction getDirection() override { return direction_; }
+    IpFamilyType getIpFamilyType() override { return IpFamilyType::IPV4; }
+    uint32_t getHandle() override { return handle_; }
+
+ private:
+    shared_ptr<IIpFilter> filter_;
+    Direction direction_;
+    uint32_t handle_;
+};
+
+// Rule i of a provisioning set: TCP or UDP to 10.x.y.z and port 1000 + i
+static shared_ptr<IFirewallEntry> makeRule(uint32_t i, uint32_t variant = 0) {
+    IPv4Info v4;
+    v4.destAddr = "10." + std::to_string(variant) + "." + std::to_string(i / 256) + "."
+        + std::to_string(i % 256);
+    v4.destSubnetMask = "255.255.255.255";
+    PortInfo port;
+    port.port = static_cast<uint16_t>(1000 + i);
+    shared_ptr<IIpFilter> filter;
+    if (i % 2) {
+        auto tcp = make_shared<TcpFilter>();
+        tcp->setIPv4Info(v4);
+        tcp->setTcpInfo(TcpInfo{PortInfo(), port});
+        filter = tcp;
+    } else {
+        auto udp = make_shared<UdpFilter>();
+        udp->setIPv4Info(v4);
+        udp->setUdpInfo(UdpInfo{PortInfo(), port});
+        filter = udp;
+    }
+    return make_shared<TestEntry>(filter, (i % 3) ? Direction::DOWNLINK : Direction::UPLINK);
+}
+
+static vector<shared_ptr<IFirewallEntry>> makeRules(uint32_t count, uint32_t changed = 0) {
+    vector<shared_ptr<IFirewallEntry>> rules;
+    for (uint32_t i = 0; i < count; ++i) {
+        rules.push_back(makeRule(i, i < changed ? 1 : 0));
+    }
+    return rules;
+}
+
+static vector<string> keysOf(const vector<shared_ptr<IFirewallEntry>> &entries) {
+    vector<string> keys;
+    for (const auto &entry : entries) {
+        keys.push_back(FirewallRuleCache::getRuleKey(*entry));
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+/**
+ * Firewall of one profile behind a modem link: each request is answered on a worker thread,
+ * in order, latencyUs after it was sent and serviceUs after the previous answer.
+ */
+class MockFirewallManager : public IFirewallManager {
+ public:
+    MockFirewallManager(uint32_t latencyUs, uint32_t serviceUs)
+       : latency_(latencyUs)
+       , service_(serviceUs)
+       , worker_(&MockFirewallManager::run, this) {
+    }
+
+    ~MockFirewallManager() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            exit_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    // The n-th add or remove from now fails, 0 for none
+    void failAdd(uint32_t n) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        failAdd_ = n;
+    }
+
+    void failRemove(uint32_t n) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        failRemove_ = n;
+    }
+
+    // Changes the rules directly, as another client would
+    void insert(shared_ptr<IFirewallEntry> entry) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        store(entry);
+    }
+
+    vector<shared_ptr<IFirewallEntry>> rules() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        vector<shared_ptr<IFirewallEntry>> entries;
+        for (const auto &rule : rules_) {
+            entries.push_back(rule.second);
+        }
+        return entries;
+    }
+
+    struct Counts {
+        uint32_t adds = 0;
+        uint32_t removes = 0;
+        uint32_t lists = 0;
+    };
+
+    Counts counts() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return counts_;
+    }
+
+    Status addFirewallEntry(int profileId, shared_ptr<IFirewallEntry> entry,
+        telux::common::ResponseCallback callback = nullptr,
+        SlotId slotId = DEFAULT_SLOT_ID) override {
+        if (!entry) {
+            return Status::INVALIDPARAM;
+        }
+        submit([this, entry, callback]() {
+            ErrorCode error = ErrorCode::SUCCESS;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                ++counts_.adds;
+                if (failAdd_ && --failAdd_ == 0) {
+                    error = ErrorCode::NO_RESOURCES;
+                } else {
+                    store(entry);
+                }
+            }
+            if (callback) {
+                callback(error);
+            }
+        });
+        return Status::SUCCESS;
+    }
+
+    Status removeFirewallEntry(int profileId, uint32_t handle,
+        telux::common::ResponseCallback callback = nullptr,
+        SlotId slotId = DEFAULT_SLOT_ID) override {
+        submit([this, handle, callback]() {
+            ErrorCode error = ErrorCode::SUCCESS;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                ++counts_.removes;
+                if (failRemove_ && --failRemove_ == 0) {
+                    error = ErrorCode::GENERIC_FAILURE;
+                } else if (!rules_.erase(handle)) {
+                    error = ErrorCode::INVALID_ARG;
+                }
+            }
+            if (callback) {
+                callback(error);
+            }
+        });
+        return Status::SUCCESS;
+    }
+
+    Status requestFirewallEntries(int profileId, FirewallEntriesCb callback,
+        SlotId slotId = DEFAULT_SLOT_ID) override {
+        submit([this, callback]() {
+            vector<shared_ptr<IFirewallEntry>> entries;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                ++counts_.lists;
+                for (const auto &rule : rules_) {
+                    entries.push_back(rule.second);
+                }
+            }
+            callback(entries, ErrorCode::SUCCESS);
+        });
+        return Status::SUCCESS;
+    }
+
+    telux::common::ServiceStatus getServiceStatus() override {
+        return telux::common::ServiceStatus::SERVICE_AVAILABLE;
+    }
+    bool isSubsystemReady() override {
+        return true;
+    }
+    std::future<bool> onSubsystemReady() override {
+        std::promise<bool> ready;
+        ready.set_value(true);
+        return ready.get_future();
+    }
+    Status setFirewall(int, bool, bool, telux::common::ResponseCallback = nullptr,
+        SlotId = DEFAULT_SLOT_ID) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status requestFirewallStatus(int, FirewallStatusCb, SlotId = DEFAULT_SLOT_ID) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status enableDmz(int, const string, telux::common::ResponseCallback = nullptr,
+        SlotId = DEFAULT_SLOT_ID) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status disableDmz(int, const IpFamilyType, telux::common::ResponseCallback = nullptr,
+        SlotId = DEFAULT_SLOT_ID) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status requestDmzEntry(int, DmzEntriesCb, SlotId = DEFAULT_SLOT_ID) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status registerListener(std::weak_ptr<IFirewallListener>) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status deregisterListener(std::weak_ptr<IFirewallListener>) override {
+        return Status::NOTSUPPORTED;
+    }
+    OperationType getOperationType() override {
+        return OperationType::DATA_LOCAL;
+    }
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    void store(shared_ptr<IFirewallEntry> entry) {
+        const uint32_t handle = nextHandle_++;
+        rules_[handle] = make_shared<TestEntry>(entry->getIProtocolFilter(),
+            entry->getDirection(), handle);
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            tasks_.push_back(Task{Clock::now() + std::chrono::microseconds(latency_), task});
+        }
+        cv_.notify_all();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        for (;;) {
+            cv_.wait(lock, [this]() { return exit_ || !tasks_.empty(); });
+            if (exit_) {
+                return;
+            }
+            Task task = tasks_.front();
+            tasks_.pop_front();
+            lock.unlock();
+            std::this_thread::sleep_until(task.due);
+            std::this_thread::sleep_for(std::chrono::microseconds(service_));
+            task.run();
+            lock.lock();
+        }
+    }
+
+    struct Task {
+        Clock::time_point due;
+        std::function<void()> run;
+    };
+
+    const uint32_t latency_;
+    const uint32_t service_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    std::map<uint32_t, shared_ptr<IFirewallEntry>> rules_;
+    uint32_t nextHandle_ = 1;
+    uint32_t failAdd_ = 0;
+    uint32_t failRemove_ = 0;
+    Counts counts_;
+    bool exit_ = false;
+    std::thread worker_;
+};
+
+struct Outcome {
+    FirewallTransactionResult result;
+    ErrorCode error = ErrorCode::CANCELLED;
+};
+
+// Runs a transaction to completion
+template <typename F>
+static Outcome transact(F start) {
+    std::promise<Outcome> done;
+    const Status status = start([&done](const FirewallTransactionResult &result,
+                                     ErrorCode error) {
+        Outcome outcome;
+        outcome.result = result;
+        outcome.error = error;
+        done.set_value(outcome);
+    });
+    CHECK(status == Status::SUCCESS);
+    if (status != Status::SUCCESS) {
+        return Outcome();
+    }
+    return done.get_future().get();
+}
+
+static Outcome sync(FirewallRuleCache &cache, const vector<shared_ptr<IFirewallEntry>> &rules) {
+    return transact([&](FirewallTransactionCb cb) { return cache.sync(rules, cb); });
+}
+
+static Outcome apply(FirewallRuleCache &cache, const FirewallBatch &batch) {
+    return transact([&](FirewallTransactionCb cb) { return cache.apply(batch, cb); });
+}
+
+static void testRuleKeys() {
+    CHECK(FirewallRuleCache::getRuleKey(*makeRule(5))
+        == FirewallRuleCache::getRuleKey(*makeRule(5)));
+    CHECK(FirewallRuleCache::getRuleKey(*makeRule(5))
+        != FirewallRuleCache::getRuleKey(*makeRule(5, 1)));
+    CHECK(keysOf(makeRules(300)).size() == 300);
+    auto keys = keysOf(makeRules(300));
+    CHECK(std::unique(keys.begin(), keys.end()) == keys.end());
+    // Same addresses and ports, other protocol
+    auto tcp = make_shared<TcpFilter>();
+    auto udp = make_shared<UdpFilter>();
+    TestEntry tcpEntry(tcp, Direction::UPLINK, 7);
+    TestEntry udpEntry(udp, Direction::UPLINK, 7);
+    CHECK(FirewallRuleCache::getRuleKey(tcpEntry) != FirewallRuleCache::getRuleKey(udpEntry));
+    // The handle is not part of the key
+    TestEntry otherHandle(tcp, Direction::UPLINK, 9);
+    CHECK(FirewallRuleCache::getRuleKey(tcpEntry)
+        == FirewallRuleCache::getRuleKey(otherHandle));
+}
+
+static void testSyncSendsDifference() {
+    auto manager = make_shared<MockFirewallManager>(200, 10);
+    FirewallRuleCache cache(manager, PROFILE);
+    CHECK(!cache.isValid());
+
+    Outcome outcome = sync(cache, makeRules(100));
+    CHECK(outcome.error == ErrorCode::SUCCESS);
+    CHECK(outcome.result.added == 100 && outcome.result.removed == 0);
+    CHECK(!outcome.result.rolledBack);
+    // Initial load, the adds and the final load
+    CHECK(outcome.result.requests == 102);
+    CHECK(cache.isValid());
+    CHECK(keysOf(manager->rules()) == keysOf(makeRules(100)));
+    CHECK(keysOf(cache.getEntries()) == keysOf(makeRules(100)));
+
+    // Nothing to do
+    auto before = manager->counts();
+    outcome = sync(cache, makeRules(100));
+    CHECK(outcome.error == ErrorCode::SUCCESS);
+    CHECK(outcome.result.unchanged == 100 && outcome.result.added == 0);
+    CHECK(outcome.result.requests == 0);
+    CHECK(manager->counts().adds == before.adds && manager->counts().lists == before.lists);
+
+    // 10 rules changed, 5 added, and a repeated rule
+    vector<shared_ptr<IFirewallEntry>> rules = makeRules(105, 10);
+    rules.push_back(makeRule(50));
+    before = manager->counts();
+    outcome = sync(cache, rules);
+    CHECK(outcome.error == ErrorCode::SUCCESS);
+    CHECK(outcome.result.removed == 10 && outcome.result.added == 15);
+    CHECK(outcome.result.unchanged == 90);
+    CHECK(manager->counts().adds - before.adds == 15);
+    CHECK(manager->counts().removes - before.removes == 10);
+    CHECK(keysOf(manager->rules()) == keysOf(makeRules(105, 10)));
+
+    // Back to none
+    outcome = sync(cache, {});
+    CHECK(outcome.error == ErrorCode::SUCCESS && outcome.result.removed == 105);
+    CHECK(manager->rules().empty() && cache.getEntries().empty());
+}
+
+static void testRollback() {
+    auto manager = make_shared<MockFirewallManager>(200, 10);
+    FirewallRuleCache cache(manager, PROFILE, DEFAULT_SLOT_ID, 4);
+    CHECK(sync(cache, makeRules(50)).error == ErrorCode::SUCCESS);
+    const vector<string> original = keysOf(manager->rules());
+
+    // The 7th add fails after all 20 removes went through
+    manager->failAdd(7);
+    Outcome outcome = sync(cache, makeRules(60, 20));
+    CHECK(outcome.error == ErrorCode::NO_RESOURCES);
+    CHECK(outcome.result.rolledBack && !outcome.result.rollbackFailed);
+    CHECK(outcome.result.added == 0 && outcome.result.removed == 0);
+    CHECK(keysOf(manager->rules()) == original);
+    CHECK(cache.isValid());
+    CHECK(keysOf(cache.getEntries()) == original);
+
+    // The 3rd remove fails
+    manager->failRemove(3);
+    outcome = sync(cache, makeRules(50, 20));
+    CHECK(outcome.error == ErrorCode::GENERIC_FAILURE);
+    CHECK(outcome.result.rolledBack && !outcome.result.rollbackFailed);
+    CHECK(keysOf(manager->rules()) == original);
+    CHECK(keysOf(cache.getEntries()) == original);
+
+    // The second add fails; the rollback removes the first and adds back the removed rule
+    manager->failAdd(2);
+    FirewallBatch batch;
+    batch.addEntry(makeRule(500));
+    batch.addEntry(makeRule(501));
+    batch.removeEntry(cache.getEntries()[0]->getHandle());
+    outcome = apply(cache, batch);
+    CHECK(outcome.error == ErrorCode::NO_RESOURCES);
+    CHECK(outcome.result.rolledBack);
+    CHECK(keysOf(manager->rules()) == original);
+    CHECK(!outcome.result.rollbackFailed);
+    // Rolled back: the removed rule is back with a new handle. Now the removal of the added
+    // rule fails during the rollback.
+    FirewallBatch second;
+    second.addEntry(makeRule(500));
+    second.addEntry(makeRule(501));
+    second.removeEntry(cache.getEntries()[0]->getHandle());
+    manager->failAdd(2);
+    manager->failRemove(2);
+    outcome = apply(cache, second);
+    CHECK(outcome.error == ErrorCode::NO_RESOURCES);
+    CHECK(outcome.result.rolledBack && outcome.result.rollbackFailed);
+    CHECK(manager->rules().size() == original.size() + 1);
+    CHECK(keysOf(cache.getEntries()) == keysOf(manager->rules()));
+
+    // Succeeds once the modem does, and cleans up the rule left over
+    outcome = sync(cache, makeRules(60, 20));
+    CHECK(outcome.error == ErrorCode::SUCCESS);
+    CHECK(keysOf(manager->rules()) == keysOf(makeRules(60, 20)));
+}
+
+static void testBatches() {
+    auto manager = make_shared<MockFirewallManager>(200, 10);
+    FirewallRuleCache cache(manager, PROFILE);
+    FirewallBatch batch;
+    for (uint32_t i = 0; i < 10; ++i) {
+        batch.addEntry(makeRule(i));
+    }
+    Outcome outcome = apply(cache, batch);
+    CHECK(outcome.error == ErrorCode::SUCCESS && outcome.result.added == 10);
+    const auto entries = cache.getEntries();
+    CHECK(entries.size() == 10);
+
+    // Unknown handles reject the batch before any change
+    FirewallBatch unknown;
+    unknown.removeEntry(entries[0]->getHandle());
+    unknown.removeEntry(12345);
+    const auto before = manager->counts();
+    outcome = apply(cache, unknown);
+    CHECK(outcome.error == ErrorCode::INVALID_ARG);
+    CHECK(manager->counts().removes == before.removes);
+    CHECK(manager->rules().size() == 10);
+
+    FirewallBatch invalid;
+    invalid.addEntry(nullptr);
+    CHECK(cache.apply(invalid) == Status::INVALIDPARAM);
+    CHECK(cache.sync({nullptr}) == Status::INVALIDPARAM);
+
+    // Remove and add in one batch
+    FirewallBatch swap;
+    swap.removeEntry(entries[0]->getHandle());
+    swap.removeEntry(entries[1]->getHandle());
+    swap.addEntry(makeRule(20));
+    outcome = apply(cache, swap);
+    CHECK(outcome.error == ErrorCode::SUCCESS);
+    CHECK(outcome.result.removed == 2 && outcome.result.added == 1);
+    CHECK(manager->rules().size() == 9);
+
+    // One transaction at a time
+    std::promise<void> first;
+    CHECK(cache.sync(makeRules(40), [&first](const FirewallTransactionResult &, ErrorCode) {
+        first.set_value();
+    }) == Status::SUCCESS);
+    CHECK(cache.isBusy());
+    CHECK(cache.sync(makeRules(40)) == Status::INVALIDSTATE);
+    CHECK(cache.refresh() == Status::INVALIDSTATE);
+    first.get_future().wait();
+    CHECK(!cache.isBusy());
+
+    // Rules added behind the cache are seen after a refresh, and removed by the next sync
+    manager->insert(makeRule(99, 3));
+    std::promise<ErrorCode> refreshed;
+    CHECK(cache.refresh([&refreshed](ErrorCode error) { refreshed.set_value(error); })
+        == Status::SUCCESS);
+    CHECK(refreshed.get_future().get() == ErrorCode::SUCCESS);
+    CHECK(cache.getEntries().size() == 41);
+    outcome = sync(cache, makeRules(40));
+    CHECK(outcome.result.removed == 1 && outcome.result.added == 0);
+    CHECK(keysOf(manager->rules()) == keysOf(makeRules(40)));
+}
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// One request at a time, each sent when the previous one was answered
+static double provisionOneByOne(uint32_t latencyUs, uint32_t serviceUs, uint32_t count) {
+    auto manager = make_shared<MockFirewallManager>(latencyUs, serviceUs);
+    const auto rules = makeRules(count);
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &rule : rules) {
+        std::promise<ErrorCode> done;
+        manager->addFirewallEntry(PROFILE, rule, [&done](ErrorCode error) {
+            done.set_value(error);
+        });
+        CHECK(done.get_future().get() == ErrorCode::SUCCESS);
+    }
+    const double ms = msSince(start);
+    CHECK(manager->rules().size() == count);
+    return ms;
+}
+
+static void benchmark(uint32_t latencyUs, uint32_t serviceUs) {
+    cout << "Provisioning with " << latencyUs << " us latency and " << serviceUs
+         << " us service time per request:" << endl;
+    cout << std::fixed << std::setprecision(1);
+    for (const uint32_t count : {10u, 100u, 500u}) {
+        const double oneByOne = provisionOneByOne(latencyUs, serviceUs, count);
+
+        auto manager = make_shared<MockFirewallManager>(latencyUs, serviceUs);
+        FirewallRuleCache cache(manager, PROFILE);
+        auto start = std::chrono::steady_clock::now();
+        Outcome outcome = sync(cache, makeRules(count));
+        const double transaction = msSince(start);
+        CHECK(outcome.error == ErrorCode::SUCCESS && outcome.result.added == count);
+
+        start = std::chrono::steady_clock::now();
+        outcome = sync(cache, makeRules(count, count / 10));
+        const double resync = msSince(start);
+        CHECK(outcome.error == ErrorCode::SUCCESS);
+        const uint32_t changes = outcome.result.added + outcome.result.removed;
+        CHECK(changes == 2 * (count / 10));
+
+        start = std::chrono::steady_clock::now();
+        outcome = sync(cache, makeRules(count, count / 10));
+        const double unchanged = msSince(start);
+        CHECK(outcome.result.requests == 0);
+
+        cout << std::setw(4) << count << " rules: one by one " << std::setw(7) << oneByOne
+             << " ms, transaction " << std::setw(6) << transaction << " ms ("
+             << std::setprecision(1) << oneByOne / transaction << "x), 10% changed "
+             << std::setw(5) << resync << " ms (" << changes << " changes + 1 list), unchanged "
+             << std::setprecision(3) << unchanged << " ms" << std::setprecision(1) << endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t latencyUs = 2000;
+    uint32_t serviceUs = 100;
+    int c;
+
+    while ((c = getopt(argc, argv, "l:s:")) != -1) {
+        switch (c) {
+            case 'l':
+                latencyUs = static_cast<uint32_t>(atoi(optarg));
+                break;
+            case 's':
+                serviceUs = static_cast<uint32_t>(atoi(optarg));
+                break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-l latency us] [-s service time us]" << endl;
+                return 1;
+        }
+    }
+
+    testRuleKeys();
+    testSyncSendsDifference();
+    testRollback();
+    testBatches();
+    benchmark(latencyUs, serviceUs);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,548 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: GeofenceTestApp.cpp
+ *
+ * @brief: Tests and per-fix benchmark of the geofence engine
+ *
+ * The tests drive a noisy 10 Hz random walk through 10,000 synthetic circular and polygonal
+ * fences, adding and removing fences in batches along the way, and check that the engine
+ * reports exactly the events of a reference that evaluates every fence on every fix. Further
+ * tests cover the exit hysteresis and its widening by the fix uncertainty, dwell events,
+ * event masks, invalid batches, fences too large for the grid and fences across the
+ * antimeridian, and feeding the engine through ILocationListener.
+ *
+ * The benchmark compares the cost per fix of the grid engine with a linear scan over the
+ * bounding boxes of all fences and with the reference.
+ *
+ * Usage: geofence_test_app [-f fences for the benchmark] [-n fixes for the benchmark]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> GeofenceTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+#include <telux/loc/GeofenceEngine.hpp>
+#include <telux/loc/LocationLog.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+using telux::common::Status;
+using namespace telux::loc;
+
+static std::atomic<uint64_t> gAllocations{0};
+
+// Out of line, so that the compiler does not pair malloc() and free() with new and delete
+__attribute__((noinline)) void *operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const GeofencePoint CENTER = {37.3861, -122.0839};
+static const double AREA_LAT = 0.2;
+static const double AREA_LON = 0.25;
+static const uint64_t T0 = 1700000000000ULL;
+
+static GeofencePoint offset(GeofencePoint p, double north, double east) {
+    return GeofencePoint{p.latitude + north / GeofenceEngine::METERS_PER_DEGREE,
+        p.longitude + east / (GeofenceEngine::METERS_PER_DEGREE
+                                 * std::cos(p.latitude * M_PI / 180))};
+}
+
+// Circles of 30 to 400 m and star shaped polygons of 3 to 10 corners up to 500 m across,
+// a third of them with a dwell time
+static vector<Geofence> makeFences(std::mt19937 &rng, uint32_t firstId, uint32_t count,
+    double scale = 1) {
+    std::uniform_real_distribution<double> lat(-AREA_LAT * scale, AREA_LAT * scale);
+    std::uniform_real_distribution<double> lon(-AREA_LON * scale, AREA_LON * scale);
+    std::uniform_real_distribution<double> unit(0, 1);
+    vector<Geofence> fences;
+    fences.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const GeofencePoint center{CENTER.latitude + lat(rng), CENTER.longitude + lon(rng)};
+        const uint32_t dwell = (rng() % 3 == 0) ? 5000 + rng() % 25000 : 0;
+        if (unit(rng) < 0.6) {
+            fences.push_back(Geofence::circle(firstId + i, center, 30 + 370 * unit(rng), dwell));
+        } else {
+            const uint32_t corners = 3 + rng() % 8;
+            vector<GeofencePoint> vertices;
+            for (uint32_t k = 0; k < corners; ++k) {
+                const double angle = 2 * M_PI * (k + 0.8 * unit(rng)) / corners;
+                const double radius = 50 + 200 * unit(rng);
+                vertices.push_back(offset(center, radius * std::cos(angle),
+                    radius * std::sin(angle)));
+            }
+            fences.push_back(Geofence::polygon(firstId + i, vertices, dwell));
+        }
+    }
+    return fences;
+}
+
+// 15 m/s random walk at 10 Hz inside the area, with up to 4 m of noise on each fix
+class Drive {
+ public:
+    explicit Drive(uint32_t seed, double scale = 1)
+       : rng_(seed)
+       , position_(CENTER)
+       , scale_(scale) {
+    }
+
+    GeofencePoint next() {
+        std::uniform_real_distribution<double> turn(-0.05, 0.05);
+        std::uniform_real_distribution<double> noise(-4, 4);
+        heading_ += turn(rng_);
+        position_ = offset(position_, 1.5 * std::cos(heading_), 1.5 * std::sin(heading_));
+        if (std::fabs(position_.latitude - CENTER.latitude) > AREA_LAT * scale_
+            || std::fabs(position_.longitude - CENTER.longitude) > AREA_LON * scale_) {
+            heading_ += M_PI;
+            position_ = offset(position_, 3 * std::cos(heading_), 3 * std::sin(heading_));
+        }
+        return offset(position_, noise(rng_), noise(rng_));
+    }
+
+ private:
+    std::mt19937 rng_;
+    GeofencePoint position_;
+    double scale_;
+    double heading_ = 0.3;
+};
+
+// Evaluates every fence on every fix with the rules of the engine
+class Reference {
+ public:
+    explicit Reference(double hysteresis)
+       : hysteresis_(hysteresis) {
+    }
+
+    void add(const vector<Geofence> &fences) {
+        for (const auto &fence : fences) {
+            fences_.push_back(State{fence, false, false, 0});
+        }
+    }
+
+    void remove(const vector<uint32_t> &ids) {
+        for (const uint32_t id : ids) {
+            fences_.erase(std::remove_if(fences_.begin(), fences_.end(),
+                              [id](const State &s) { return s.fence.id == id; }),
+                fences_.end());
+        }
+    }
+
+    void evaluate(uint64_t timestamp, GeofencePoint position, vector<GeofenceEvent> &events) {
+        events.clear();
+        for (auto &s : fences_) {
+            const double distance = GeofenceEngine::signedDistance(s.fence, position);
+            if (!s.inside && distance <= 0) {
+                s.inside = true;
+                s.dwellReported = false;
+                s.enteredAt = timestamp;
+                events.push_back(GeofenceEvent{s.fence.id, GEOFENCE_ENTER, timestamp, position});
+            } else if (s.inside && distance >= hysteresis_) {
+                s.inside = false;
+                events.push_back(GeofenceEvent{s.fence.id, GEOFENCE_EXIT, timestamp, position});
+            }
+            if (s.inside && s.fence.dwellTimeMs && !s.dwellReported
+                && timestamp >= s.enteredAt + s.fence.dwellTimeMs) {
+                s.dwellReported = true;
+                events.push_back(GeofenceEvent{s.fence.id, GEOFENCE_DWELL, timestamp, position});
+            }
+        }
+    }
+
+ private:
+    struct State {
+        Geofence fence;
+        bool inside;
+        bool dwellReported;
+        uint64_t enteredAt;
+    };
+
+    double hysteresis_;
+    vector<State> fences_;
+};
+
+static void sortEvents(vector<GeofenceEvent> &events) {
+    std::sort(events.begin(), events.end(), [](const GeofenceEvent &a, const GeofenceEvent &b) {
+        return a.id != b.id ? a.id < b.id : a.type < b.type;
+    });
+}
+
+static bool sameEvents(vector<GeofenceEvent> a, vector<GeofenceEvent> b) {
+    sortEvents(a);
+    sortEvents(b);
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].id != b[i].id || a[i].type != b[i].type || a[i].timestamp != b[i].timestamp) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testAgainstReference() {
+    std::mt19937 rng(11);
+    GeofenceEngine engine;
+    Reference reference(GeofenceEngine::Config().hysteresis);
+    // A quarter of the benchmark area, for more events
+    vector<Geofence> fences = makeFences(rng, 1, 10000, 0.5);
+    CHECK(engine.addGeofences(fences) == Status::SUCCESS);
+    reference.add(fences);
+
+    Drive drive(5, 0.5);
+    vector<GeofenceEvent> events, expected;
+    uint64_t counts[8] = {};
+    uint32_t mismatches = 0;
+    const uint32_t fixes = 10000;
+    for (uint32_t i = 0; i < fixes; ++i) {
+        if (i == fixes / 2) {
+            // Replace a tenth of the fences in two batches
+            vector<uint32_t> removed;
+            for (uint32_t id = 1; id <= 10000; id += 10) {
+                removed.push_back(id);
+            }
+            CHECK(engine.removeGeofences(removed) == Status::SUCCESS);
+            reference.remove(removed);
+            vector<Geofence> added = makeFences(rng, 20001, 1000, 0.5);
+            CHECK(engine.addGeofences(added) == Status::SUCCESS);
+            reference.add(added);
+        }
+        const uint64_t timestamp = T0 + i * 100;
+        const GeofencePoint position = drive.next();
+        engine.updatePosition(timestamp, position, 0, &events);
+        reference.evaluate(timestamp, position, expected);
+        mismatches += !sameEvents(events, expected);
+        for (const auto &event : events) {
+            ++counts[event.type];
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(counts[GEOFENCE_ENTER] > 100);
+    CHECK(counts[GEOFENCE_EXIT] > 100);
+    CHECK(counts[GEOFENCE_DWELL] > 10);
+    const GeofenceEngine::Stats stats = engine.getStats();
+    CHECK(stats.fixes == fixes);
+    CHECK(stats.fences == 10000);
+    CHECK(stats.unindexed == 0);
+    // The grid looks at well under 1% of the fences
+    CHECK(stats.candidates < fixes * 100ULL);
+    cout << "Reference drive: " << counts[GEOFENCE_ENTER] << " enter, " << counts[GEOFENCE_EXIT]
+         << " exit, " << counts[GEOFENCE_DWELL] << " dwell events over " << fixes << " fixes"
+         << endl;
+}
+
+static void testHysteresis() {
+    GeofenceEngine engine;
+    engine.addGeofences({Geofence::circle(1, CENTER, 100)});
+    vector<GeofenceEvent> events;
+    uint64_t t = T0;
+    uint32_t enters = 0, exits = 0;
+
+    // Jitter across the boundary
+    for (int i = 0; i < 50; ++i) {
+        engine.updatePosition(t += 100, offset(CENTER, 0, (i % 2) ? 97 : 103), 0, &events);
+        for (const auto &event : events) {
+            enters += (event.type == GEOFENCE_ENTER);
+            exits += (event.type == GEOFENCE_EXIT);
+        }
+    }
+    CHECK(enters == 1 && exits == 0);
+    CHECK(engine.isInside(1));
+    CHECK(engine.updatePosition(t += 100, offset(CENTER, 0, 109), 0, &events) == 0);
+    CHECK(engine.updatePosition(t += 100, offset(CENTER, 0, 111), 0, &events) == 1);
+    CHECK(events[0].type == GEOFENCE_EXIT && events[0].id == 1 && events[0].timestamp == t);
+    CHECK(!engine.isInside(1));
+    CHECK(engine.updatePosition(t += 100, offset(CENTER, 0, 103), 0, &events) == 0);
+
+    // The exit distance widens with the uncertainty of the fix
+    GeofenceEngine::Config config;
+    config.uncertaintyFactor = 1.0;
+    GeofenceEngine uncertain(config);
+    uncertain.addGeofences({Geofence::circle(1, CENTER, 100)});
+    CHECK(uncertain.updatePosition(t += 100, CENTER, 0) == 1);
+    CHECK(uncertain.updatePosition(t += 100, offset(CENTER, 0, 125), 20) == 0);
+    CHECK(uncertain.updatePosition(t += 100, offset(CENTER, 0, 131), 20) == 1);
+
+    // Polygon: a 200 m square
+    GeofenceEngine square;
+    square.addGeofences({Geofence::polygon(7, {offset(CENTER, -100, -100),
+        offset(CENTER, -100, 100), offset(CENTER, 100, 100), offset(CENTER, 100, -100)})});
+    CHECK(square.updatePosition(t += 100, offset(CENTER, 0, 95), 0) == 1);
+    CHECK(square.updatePosition(t += 100, offset(CENTER, 50, 108), 0) == 0);
+    CHECK(square.updatePosition(t += 100, offset(CENTER, 50, 112), 0) == 1);
+    CHECK(std::fabs(GeofenceEngine::signedDistance(Geofence::polygon(7, {offset(CENTER, -100,
+        -100), offset(CENTER, -100, 100), offset(CENTER, 100, 100), offset(CENTER, 100, -100)}),
+        CENTER) + 100) < 0.01);
+}
+
+static void testDwellAndMasks() {
+    GeofenceEngine engine;
+    Geofence exitOnly = Geofence::circle(2, CENTER, 300, 1000);
+    exitOnly.events = GEOFENCE_EXIT;
+    engine.addGeofences({Geofence::circle(1, CENTER, 200, 5000), exitOnly});
+    vector<GeofenceEvent> events;
+    vector<GeofenceEvent> all;
+    uint64_t t = T0;
+    for (int visit = 0; visit < 2; ++visit) {
+        for (int i = 0; i < 8; ++i) {
+            engine.updatePosition(t += 1000, offset(CENTER, 10 * i, 0), 0, &events);
+            all.insert(all.end(), events.begin(), events.end());
+        }
+        engine.updatePosition(t += 1000, offset(CENTER, 0, 1000), 0, &events);
+        all.insert(all.end(), events.begin(), events.end());
+    }
+    // Per visit: enter 1, dwell 1 after 5 s, exit 2, exit 1 in the order of the fences
+    CHECK(all.size() == 8);
+    for (int visit = 0; visit < 2; ++visit) {
+        const GeofenceEvent *e = &all[visit * 4];
+        const uint64_t start = T0 + visit * 9000 + 1000;
+        CHECK(e[0].id == 1 && e[0].type == GEOFENCE_ENTER && e[0].timestamp == start);
+        CHECK(e[1].id == 1 && e[1].type == GEOFENCE_DWELL && e[1].timestamp == start + 5000);
+        CHECK(e[2].type == GEOFENCE_EXIT && e[3].type == GEOFENCE_EXIT);
+        CHECK(e[2].id + e[3].id == 3);
+    }
+}
+
+static void testUpdates() {
+    GeofenceEngine engine;
+    CHECK(engine.addGeofences({Geofence::circle(1, CENTER, 100)}) == Status::SUCCESS);
+    // All or nothing
+    CHECK(engine.addGeofences({Geofence::circle(2, CENTER, 100), Geofence::circle(1, CENTER, 50)})
+        == Status::INVALIDPARAM);
+    CHECK(engine.addGeofences({Geofence::circle(2, CENTER, 100), Geofence::circle(2, CENTER, 50)})
+        == Status::INVALIDPARAM);
+    CHECK(engine.addGeofences({Geofence::polygon(3, {CENTER, offset(CENTER, 10, 10)})})
+        == Status::INVALIDPARAM);
+    CHECK(engine.getStats().fences == 1);
+
+    CHECK(engine.updatePosition(T0, CENTER) == 1);
+    CHECK(engine.isInside(1));
+    CHECK(engine.removeGeofences({1, 99}) == Status::NOSUCH);
+    CHECK(!engine.isInside(1));
+    CHECK(engine.getStats().fences == 0 && engine.getStats().cells == 0);
+    CHECK(engine.updatePosition(T0 + 100, offset(CENTER, 0, 1000)) == 0);
+
+    // A fence too large for the grid, and one across the antimeridian
+    CHECK(engine.addGeofences({Geofence::polygon(10, {offset(CENTER, -60000, -60000),
+        offset(CENTER, -60000, 60000), offset(CENTER, 60000, 60000),
+        offset(CENTER, 60000, -60000)}), Geofence::circle(11, {10, 179.999}, 1000)})
+        == Status::SUCCESS);
+    CHECK(engine.getStats().unindexed == 2);
+    CHECK(engine.updatePosition(T0 + 200, offset(CENTER, 30000, -40000)) == 1);
+    CHECK(engine.isInside(10));
+    CHECK(engine.updatePosition(T0 + 300, {10, -179.999}) == 2);
+    CHECK(engine.isInside(11) && !engine.isInside(10));
+    CHECK(engine.removeGeofences({10, 11}) == Status::SUCCESS);
+    CHECK(engine.getStats().unindexed == 0);
+}
+
+class EventListener : public IGeofenceListener {
+ public:
+    void onGeofenceEvents(const vector<GeofenceEvent> &events) override {
+        ++calls;
+        received.insert(received.end(), events.begin(), events.end());
+    }
+    uint32_t calls = 0;
+    vector<GeofenceEvent> received;
+};
+
+static shared_ptr<ILocationInfoEx> makeInfo(GeofencePoint position, uint64_t timestamp,
+    LocationInfoValidity validity = HAS_LAT_LONG_BIT | HAS_TIMESTAMP_BIT) {
+    CompactLocationFix fix;
+    std::memset(&fix, 0, sizeof(fix));
+    fix.latitude = position.latitude;
+    fix.longitude = position.longitude;
+    fix.timestamp = timestamp;
+    fix.validity = validity;
+    return make_shared<LoggedLocationInfo>(fix);
+}
+
+static void testLocationListener() {
+    auto engine = make_shared<GeofenceEngine>();
+    engine->addGeofences({Geofence::circle(1, CENTER, 100), Geofence::circle(2, CENTER, 200)});
+    auto listener = make_shared<EventListener>();
+    CHECK(engine->registerListener(listener) == Status::SUCCESS);
+    CHECK(engine->registerListener(listener) == Status::ALREADY);
+    shared_ptr<ILocationListener> asListener = engine;
+
+    // No position, no evaluation
+    asListener->onDetailedLocationUpdate(makeInfo(CENTER, T0, HAS_TIMESTAMP_BIT));
+    CHECK(listener->calls == 0);
+    // Both enters in one call
+    asListener->onDetailedLocationUpdate(makeInfo(CENTER, T0 + 100));
+    CHECK(listener->calls == 1 && listener->received.size() == 2);
+    // Only fused engine fixes
+    CompactLocationFix far;
+    std::memset(&far, 0, sizeof(far));
+    const GeofencePoint outside = offset(CENTER, 0, 1000);
+    far.latitude = outside.latitude;
+    far.longitude = outside.longitude;
+    far.validity = HAS_LAT_LONG_BIT;
+    far.timestamp = T0 + 200;
+    asListener->onDetailedEngineLocationUpdate(
+        {make_shared<LoggedLocationInfo>(far, LOC_OUTPUT_ENGINE_SPE)});
+    CHECK(listener->calls == 1);
+    asListener->onDetailedEngineLocationUpdate(
+        {make_shared<LoggedLocationInfo>(far, LOC_OUTPUT_ENGINE_FUSED)});
+    CHECK(listener->calls == 2 && listener->received.size() == 4);
+    CHECK(listener->received[3].timestamp == T0 + 200);
+    asListener->onBasicLocationUpdate(makeInfo(CENTER, T0 + 300));
+    CHECK(listener->calls == 3);
+    CHECK(engine->deregisterListener(listener) == Status::SUCCESS);
+    CHECK(engine->deregisterListener(listener) == Status::NOSUCH);
+}
+
+template <typename F>
+static double nsPerFix(uint32_t fixes, F evaluate) {
+    Drive drive(9);
+    vector<GeofencePoint> positions(fixes);
+    for (auto &p : positions) {
+        p = drive.next();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < fixes; ++i) {
+        evaluate(T0 + i * 100ULL, positions[i]);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+        .count() / fixes;
+}
+
+static void benchmark(uint32_t fenceCount, uint32_t fixes) {
+    std::mt19937 rng(3);
+    const vector<Geofence> fences = makeFences(rng, 1, fenceCount);
+    vector<GeofenceEvent> events;
+    events.reserve(64);
+
+    GeofenceEngine grid;
+    auto start = std::chrono::steady_clock::now();
+    grid.addGeofences(fences);
+    const double addMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    const uint64_t allocationsBefore = gAllocations.load();
+    const double gridNs = nsPerFix(fixes,
+        [&](uint64_t t, GeofencePoint p) { grid.updatePosition(t, p, 0, &events); });
+    const double allocations = static_cast<double>(gAllocations.load() - allocationsBefore)
+        / fixes;
+    const GeofenceEngine::Stats stats = grid.getStats();
+
+    GeofenceEngine::Config config;
+    config.maxCellsPerFence = 0;
+    GeofenceEngine scan(config);
+    scan.addGeofences(fences);
+    // The slower evaluations on fewer fixes
+    const uint32_t fewerFixes = std::max(1u, fixes / 20);
+    const double scanNs = nsPerFix(fewerFixes,
+        [&](uint64_t t, GeofencePoint p) { scan.updatePosition(t, p, 0, &events); });
+
+    Reference reference(config.hysteresis);
+    reference.add(fences);
+    const double referenceNs = nsPerFix(fewerFixes,
+        [&](uint64_t t, GeofencePoint p) { reference.evaluate(t, p, events); });
+
+    cout << std::fixed << std::setprecision(2);
+    cout << fenceCount << " fences, " << stats.cells << " grid cells, indexed in " << addMs
+         << " ms" << endl;
+    cout << "Grid:        " << std::setw(10) << gridNs / 1e3 << " us/fix, "
+         << static_cast<double>(stats.candidates) / stats.fixes << " candidates and "
+         << static_cast<double>(stats.tests) / stats.fixes << " exact tests per fix, "
+         << allocations << " allocations/fix" << endl;
+    cout << "Box scan:    " << std::setw(10) << scanNs / 1e3 << " us/fix (" << std::setprecision(0)
+         << scanNs / gridNs << "x)" << std::setprecision(2) << endl;
+    cout << "Every fence: " << std::setw(10) << referenceNs / 1e3 << " us/fix ("
+         << std::setprecision(0) << referenceNs / gridNs << "x)" << endl;
+}
+
+int main(int argc, char **argv) {
+    uint32_t fences = 10000;
+    uint32_t fixes = 20000;
+    int c;
+
+    while ((c = getopt(argc, argv, "f:n:")) != -1) {
+        switch (c) {
+            case 'f':
+                fences = static_cast<uint32_t>(atoi(optarg));
+                break;
+            case 'n':
+                fixes = static_cast<uint32_t>(atoi(optarg));
+                break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-f fences] [-n fixes]" << endl;
+                return 1;
+        }
+    }
+
+    testAgainstReference();
+    testHysteresis();
+    testDwellAndMasks();
+    testUpdates();
+    testLocationListener();
+    benchmark(fences, fixes);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
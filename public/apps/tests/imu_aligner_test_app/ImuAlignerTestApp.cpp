@@ -0,0 +1,461 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: ImuAlignerTestApp.cpp
+ *
+ * @brief: Deterministic synthetic data test and benchmark of ImuAligner
+ *
+ * An accelerometer (400 Hz, batches of 8) and an uncalibrated gyroscope with a constant bias
+ * (833 Hz, batches of 16) sample known smooth signals with seeded timestamp jitter. Batches
+ * are delivered in the order a sensor framework would deliver them, i.e. by the timestamp of
+ * their last event. The test checks the frame grid, the interpolation error of each
+ * interpolator against the true signals, bias compensation, the latency bound across a gyro
+ * outage, the input jitter statistics and the attach path through a mock ISensor (vector
+ * delivery, and ring delivery through a SensorEventRingAdapter). The benchmark reports the alignment cost per frame.
+ *
+ * Usage: imu_aligner_test_app [-s simulated seconds for the benchmark]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> ImuAlignerTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <telux/sensor/ImuAligner.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::vector;
+using telux::common::Status;
+using namespace telux::sensor;
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const double PI = 3.14159265358979323846;
+static const uint64_t START_NS = 5000123456ull;
+static const float GYRO_BIAS[3] = {0.02f, -0.01f, 0.005f};
+
+// True signals, t in ns
+static void accelAt(uint64_t t, float *v) {
+    double s = t * 1e-9;
+    v[0] = static_cast<float>(2.0 * std::sin(2 * PI * 1.3 * s));
+    v[1] = static_cast<float>(0.5 * std::cos(2 * PI * 0.4 * s));
+    v[2] = static_cast<float>(9.81 + 0.2 * std::sin(2 * PI * 2.1 * s));
+}
+
+static void gyroAt(uint64_t t, float *v) {
+    double s = t * 1e-9;
+    v[0] = static_cast<float>(0.3 * std::sin(2 * PI * 0.7 * s));
+    v[1] = static_cast<float>(0.1 * std::cos(2 * PI * 1.1 * s));
+    v[2] = static_cast<float>(0.5 * std::sin(2 * PI * 0.25 * s + 1.0));
+}
+
+struct Batch {
+    ImuChannel channel;
+    vector<SensorEvent> events;
+};
+
+// Seeded LCG so the data is the same on every host
+class Lcg {
+public:
+    explicit Lcg(uint32_t seed) : state_(seed) {}
+    // Uniform in [-1, 1]
+    double next() {
+        state_ = state_ * 1664525u + 1013904223u;
+        return (state_ >> 8) / double(1u << 24) * 2.0 - 1.0;
+    }
+private:
+    uint32_t state_;
+};
+
+struct StreamSpec {
+    ImuChannel channel;
+    double rateHz;
+    uint32_t batchCount;
+    uint64_t offsetNs;
+    double jitterNs;
+};
+
+/**
+ * Generates the batches of both streams over seconds, ordered by delivery (timestamp of the
+ * last event of the batch). Gyro samples in [gapStartNs, gapEndNs) are not produced.
+ */
+static vector<Batch> generate(double seconds, uint64_t gapStartNs = 0, uint64_t gapEndNs = 0) {
+    const StreamSpec specs[] = {
+        {IMU_ACCELEROMETER, 400.0, 8, 0, 300000.0},
+        {IMU_GYROSCOPE, 833.0, 16, 700000, 150000.0},
+    };
+    vector<Batch> batches;
+    Lcg lcg(42);
+
+    for (auto &spec : specs) {
+        const uint64_t count = static_cast<uint64_t>(seconds * spec.rateHz);
+        Batch batch;
+        batch.channel = spec.channel;
+        for (uint64_t n = 0; n < count; ++n) {
+            uint64_t t = START_NS + spec.offsetNs
+                + static_cast<uint64_t>(n * 1e9 / spec.rateHz + spec.jitterNs * lcg.next());
+            SensorEvent event;
+            event.timestamp = t;
+            float v[3];
+            if (spec.channel == IMU_ACCELEROMETER) {
+                accelAt(t, v);
+                event.calibrated.x = v[0];
+                event.calibrated.y = v[1];
+                event.calibrated.z = v[2];
+            } else {
+                if (t >= gapStartNs && t < gapEndNs) {
+                    continue;
+                }
+                gyroAt(t, v);
+                event.uncalibrated.data.x = v[0] + GYRO_BIAS[0];
+                event.uncalibrated.data.y = v[1] + GYRO_BIAS[1];
+                event.uncalibrated.data.z = v[2] + GYRO_BIAS[2];
+                event.uncalibrated.bias.x = GYRO_BIAS[0];
+                event.uncalibrated.bias.y = GYRO_BIAS[1];
+                event.uncalibrated.bias.z = GYRO_BIAS[2];
+            }
+            batch.events.push_back(event);
+            if (batch.events.size() == spec.batchCount) {
+                batches.push_back(batch);
+                batch.events.clear();
+            }
+        }
+    }
+    std::stable_sort(batches.begin(), batches.end(), [](const Batch &a, const Batch &b) {
+        return a.events.back().timestamp < b.events.back().timestamp;
+    });
+    return batches;
+}
+
+struct RunResult {
+    vector<ImuFrame> frames;
+    ImuAlignerStats stats;
+    double maxAccelError = 0;
+    double maxGyroError = 0;
+};
+
+static RunResult run(const vector<Batch> &batches, ImuAlignerConfig config) {
+    RunResult result;
+    ImuAligner aligner(config, [&result](const ImuFrame &frame) {
+        result.frames.push_back(frame);
+    });
+    CHECK(aligner.enableChannel(IMU_ACCELEROMETER, SensorType::ACCELEROMETER)
+        == Status::SUCCESS);
+    CHECK(aligner.enableChannel(IMU_GYROSCOPE, SensorType::GYROSCOPE_UNCALIBRATED)
+        == Status::SUCCESS);
+    for (auto &batch : batches) {
+        aligner.addEvents(batch.channel, batch.events.data(), batch.events.size());
+    }
+    result.stats = aligner.getStats();
+
+    for (auto &frame : result.frames) {
+        if (frame.late) {
+            continue;
+        }
+        float a[3], g[3];
+        accelAt(frame.timestamp, a);
+        gyroAt(frame.timestamp, g);
+        const float fa[3] = {frame.acceleration.x, frame.acceleration.y, frame.acceleration.z};
+        const float fg[3] = {frame.angularRate.x, frame.angularRate.y, frame.angularRate.z};
+        for (int k = 0; k < 3; ++k) {
+            result.maxAccelError = std::max(result.maxAccelError,
+                static_cast<double>(std::fabs(fa[k] - a[k])));
+            result.maxGyroError = std::max(result.maxGyroError,
+                static_cast<double>(std::fabs(fg[k] - g[k])));
+        }
+    }
+    return result;
+}
+
+static const char *name(ImuInterpolation interpolation) {
+    switch (interpolation) {
+        case ImuInterpolation::NEAREST: return "nearest";
+        case ImuInterpolation::LINEAR: return "linear";
+        case ImuInterpolation::CUBIC: return "cubic";
+    }
+    return "";
+}
+
+// Frame grid, interpolation error and latency on 10 s of jittered input
+static void testAlignment() {
+    const auto batches = generate(10.0);
+    double error[3];
+    int i = 0;
+
+    for (auto interpolation : {ImuInterpolation::NEAREST, ImuInterpolation::LINEAR,
+                               ImuInterpolation::CUBIC}) {
+        ImuAlignerConfig config;
+        config.outputRate = 100.0f;
+        config.interpolation = interpolation;
+        auto result = run(batches, config);
+
+        cout << std::setw(8) << name(interpolation) << ": " << result.frames.size()
+             << " frames, max error accel " << result.maxAccelError << " gyro "
+             << result.maxGyroError << ", latency " << result.stats.minLatencyNs / 1000
+             << "-" << result.stats.maxLatencyNs / 1000 << " us (mean "
+             << static_cast<uint64_t>(result.stats.meanLatencyNs / 1000) << ")" << endl;
+
+        // Frames on the 10 ms grid from the first instant both sensors have data, to the last
+        // instant both have data after it
+        CHECK(result.frames.size() >= 995 && result.frames.size() <= 1000);
+        CHECK(result.frames[0].timestamp % 10000000 == 0);
+        CHECK(result.frames[0].timestamp >= START_NS + 700000);
+        CHECK(result.frames[0].timestamp < START_NS + 700000 + 10000000 + 300000);
+        bool grid = true;
+        for (size_t k = 1; k < result.frames.size(); ++k) {
+            grid = grid && (result.frames[k].timestamp - result.frames[k - 1].timestamp
+                == 10000000);
+        }
+        CHECK(grid);
+        CHECK(result.stats.lateFrames == 0);
+        CHECK(result.stats.frames == result.frames.size());
+        // The gyro batch spans 19 ms and is the slowest channel; the cubic interpolator needs
+        // one more sample
+        CHECK(result.stats.maxLatencyNs <= 21000000 + 2500000);
+
+        error[i++] = std::max(result.maxAccelError, result.maxGyroError);
+    }
+    CHECK(error[0] > error[1]);
+    CHECK(error[1] > error[2]);
+    // Sampling at 400 Hz, the linear error of 2 sin(2 pi 1.3 t) is below A w^2 h^2 / 8,
+    // plus the timestamp jitter
+    CHECK(error[1] < 1e-3);
+    CHECK(error[2] < 1e-4);
+}
+
+// A gyro outage: frames keep coming on the latency bound, holding the last gyro value
+static void testOutage() {
+    const uint64_t gapStart = START_NS + 3000000000ull;
+    const uint64_t gapEnd = START_NS + 3500000000ull;
+    const auto batches = generate(6.0, gapStart, gapEnd);
+    ImuAlignerConfig config;
+    config.outputRate = 100.0f;
+    config.maxLatencyNs = 40000000;
+    auto result = run(batches, config);
+
+    uint64_t late = 0;
+    uint64_t lastLate = 0;
+    for (auto &frame : result.frames) {
+        if (frame.late) {
+            ++late;
+            lastLate = frame.timestamp;
+        }
+    }
+    cout << "outage: " << result.frames.size() << " frames, " << late << " late, latency max "
+         << result.stats.maxLatencyNs / 1000 << " us" << endl;
+    CHECK(late > 40 && late <= 50);
+    CHECK(lastLate < gapEnd);
+    CHECK(result.stats.lateFrames == late);
+    // Bounded by maxLatencyNs plus one accelerometer batch (8 samples at 400 Hz)
+    CHECK(result.stats.maxLatencyNs <= 40000000 + 20000000 + 300000);
+    CHECK(result.maxAccelError < 1e-3);
+    CHECK(result.frames.size() >= 595 && result.frames.size() <= 600);
+}
+
+// Input jitter statistics, and out of order samples are dropped
+static void testStats() {
+    const auto batches = generate(10.0);
+    ImuAlignerConfig config;
+    auto result = run(batches, config);
+    const ImuChannelStats &accel = result.stats.channels[IMU_ACCELEROMETER];
+    const ImuChannelStats &gyro = result.stats.channels[IMU_GYROSCOPE];
+
+    cout << "accel: " << accel.samples << " samples, period " << accel.meanPeriodNs / 1000
+         << " us, jitter " << accel.jitterNs / 1000 << " us (max " << accel.maxJitterNs / 1000
+         << ")" << endl;
+    cout << "gyro:  " << gyro.samples << " samples, period " << gyro.meanPeriodNs / 1000
+         << " us, jitter " << gyro.jitterNs / 1000 << " us (max " << gyro.maxJitterNs / 1000
+         << ")" << endl;
+    CHECK(accel.samples == 4000 && accel.dropped == 0);
+    CHECK(std::fabs(accel.meanPeriodNs - 2500000) < 1000);
+    // Uniform +-300 us on each timestamp: interval stddev 300 / sqrt(1.5) us, at most 600 us
+    CHECK(accel.jitterNs > 200000 && accel.jitterNs < 290000);
+    CHECK(accel.maxJitterNs <= 600000 + 1000);
+    CHECK(std::fabs(gyro.meanPeriodNs - 1e9 / 833) < 1000);
+
+    ImuAligner aligner(config, nullptr);
+    aligner.enableChannel(IMU_ACCELEROMETER, SensorType::ACCELEROMETER);
+    SensorEvent events[3];
+    events[0].timestamp = 100;
+    events[1].timestamp = 100;
+    events[2].timestamp = 50;
+    aligner.addEvents(IMU_ACCELEROMETER, events, 3);
+    CHECK(aligner.getStats().channels[IMU_ACCELEROMETER].samples == 1);
+    CHECK(aligner.getStats().channels[IMU_ACCELEROMETER].dropped == 2);
+    CHECK(aligner.enableChannel(IMU_GYROSCOPE, SensorType::ACCELEROMETER)
+        == Status::INVALIDPARAM);
+    CHECK(aligner.enableChannel(IMU_ACCELEROMETER, SensorType::ACCELEROMETER)
+        == Status::ALREADY);
+}
+
+/**
+ * Sensor delivering the batches it is given to its listener through onEvent.
+ */
+class MockSensor : public ISensor {
+public:
+    explicit MockSensor(SensorType type) {
+        info_.type = type;
+    }
+    SensorInfo getSensorInfo() override { return info_; }
+    Status configure(SensorConfiguration configuration) override { return Status::SUCCESS; }
+    SensorConfiguration getConfiguration() override { return SensorConfiguration(); }
+    Status activate() override { return Status::SUCCESS; }
+    Status deactivate() override { return Status::SUCCESS; }
+    Status enableLowPowerMode() override { return Status::NOTSUPPORTED; }
+    Status disableLowPowerMode() override { return Status::NOTSUPPORTED; }
+    Status selfTest(SelfTestType selfTestType, SelfTestResultCallback cb) override {
+        return Status::NOTSUPPORTED;
+    }
+    Status registerListener(std::weak_ptr<ISensorEventListener> listener) override {
+        listener_ = listener;
+        return Status::SUCCESS;
+    }
+    Status deregisterListener(std::weak_ptr<ISensorEventListener> listener) override {
+        listener_.reset();
+        return Status::SUCCESS;
+    }
+
+    void deliver(const vector<SensorEvent> &events) {
+        auto listener = listener_.lock();
+        if (listener) {
+            listener->onEvent(std::make_shared<vector<SensorEvent>>(events));
+        }
+    }
+
+    bool hasListener() const { return !listener_.expired(); }
+
+private:
+    SensorInfo info_;
+    std::weak_ptr<ISensorEventListener> listener_;
+};
+
+// The attach path gives the same frames as addEvents, through either delivery mode
+static void testAttach() {
+    const auto batches = generate(2.0);
+    ImuAlignerConfig config;
+    auto expected = run(batches, config);
+    auto accel = std::make_shared<MockSensor>(SensorType::ACCELEROMETER);
+    auto gyro = std::make_shared<MockSensor>(SensorType::GYROSCOPE_UNCALIBRATED);
+    auto gyroRing = std::make_shared<SensorEventRingAdapter>(gyro, 64);
+    {
+        vector<ImuFrame> frames;
+        ImuAligner aligner(config, [&frames](const ImuFrame &frame) { frames.push_back(frame); });
+        CHECK(aligner.attach(IMU_GYROSCOPE, accel) == Status::INVALIDPARAM);
+        CHECK(aligner.attach(IMU_ACCELEROMETER, accel) == Status::SUCCESS);
+        CHECK(aligner.attach(IMU_GYROSCOPE, gyroRing) == Status::SUCCESS);
+        for (auto &batch : batches) {
+            (batch.channel == IMU_ACCELEROMETER ? accel : gyro)->deliver(batch.events);
+        }
+        CHECK(frames.size() == expected.frames.size());
+        bool same = (frames.size() == expected.frames.size());
+        for (size_t i = 0; same && i < frames.size(); ++i) {
+            same = frames[i].timestamp == expected.frames[i].timestamp
+                && frames[i].acceleration.x == expected.frames[i].acceleration.x
+                && frames[i].angularRate.z == expected.frames[i].angularRate.z;
+        }
+        CHECK(same);
+    }
+    CHECK(!accel->hasListener() && gyro->hasListener());
+    gyroRing.reset();
+    CHECK(!gyro->hasListener());
+}
+
+// Alignment cost per frame, input delivery included
+static void bench(double seconds) {
+    const auto batches = generate(seconds);
+    size_t samples = 0;
+    for (auto &batch : batches) {
+        samples += batch.events.size();
+    }
+    for (auto interpolation : {ImuInterpolation::NEAREST, ImuInterpolation::LINEAR,
+                               ImuInterpolation::CUBIC}) {
+        ImuAlignerConfig config;
+        config.outputRate = 200.0f;
+        config.interpolation = interpolation;
+        uint64_t frames = 0;
+        ImuAligner aligner(config, [&frames](const ImuFrame &frame) { ++frames; });
+        aligner.enableChannel(IMU_ACCELEROMETER, SensorType::ACCELEROMETER);
+        aligner.enableChannel(IMU_GYROSCOPE, SensorType::GYROSCOPE_UNCALIBRATED);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto &batch : batches) {
+            aligner.addEvents(batch.channel, batch.events.data(), batch.events.size());
+        }
+        const auto end = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        cout << std::setw(8) << name(interpolation) << ": " << frames << " frames from "
+             << samples << " samples, " << static_cast<uint64_t>(ns / frames) << " ns/frame ("
+             << std::setprecision(3) << ns / samples << " ns/sample)" << endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    double seconds = 600;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:h")) != -1) {
+        switch (c) {
+            case 's': seconds = atof(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-s simulated seconds]" << endl;
+                return 1;
+        }
+    }
+
+    testAlignment();
+    testOutage();
+    testStats();
+    testAttach();
+    bench(seconds);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,642 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: LocationLogTestApp.cpp
+ *
+ * @brief: Tests and throughput benchmark of location logs and their replay
+ *
+ * A LocationReportGenerator drives a simulated 10 Hz drive (capabilities, then per epoch a
+ * fix, satellites, signal info, NMEA sentences and measurements) into a LocationRecorder on a
+ * simulated clock. The tests replay the log through a LocationReplayManager and check that
+ * listeners receive the same callbacks with the same contents, timestamps and order as the
+ * recorder did, that the report mask, interval and engine filters apply, that replay is paced
+ * at 1x and 10x and can be stopped, and that truncated and foreign files are handled.
+ *
+ * The benchmark records a drive of the given number of epochs and replays it at maximum
+ * speed, and reports records and megabytes per second, the speedup over the recorded pace and
+ * the log size per minute of drive.
+ *
+ * Usage: location_log_test_app [-e epochs for the benchmark] [-d directory for the logs]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> LocationLogTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <telux/loc/LocationLog.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using telux::common::Status;
+using namespace telux::loc;
+
+static std::atomic<uint64_t> gAllocations{0};
+
+// Out of line, so that the compiler does not pair malloc() and free() with new and delete
+__attribute__((noinline)) void *operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const uint32_t SV_COUNT = 48;
+static const uint32_t NMEA_SENTENCES = 6;
+static const uint32_t MEASUREMENT_COUNT = 48;
+static const uint64_t T0 = 1700000000000ULL;
+static const uint64_t EPOCH_NS = 100000000ULL;
+static const LocCapability CAPABILITIES = 0x1FF;
+
+static string gDirectory = "/tmp";
+
+static string logPath(const char *name) {
+    return gDirectory + "/location_log_test_" + std::to_string(getpid()) + "_" + name + ".bin";
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Flattens every callback into a string, so that two sequences of callbacks compare with ==.
+// Callbacks come from one thread at a time; events is read after the replay completed.
+class Capture : public ILocationListener {
+ public:
+    vector<string> events;
+    uint32_t fixes = 0;
+    uint32_t engineFixes = 0;
+
+    void onBasicLocationUpdate(const shared_ptr<ILocationInfoBase> &info) override {
+        const CompactLocationFix fix = LocationRecorder::toCompactBaseFix(*info);
+        add('B', &fix, sizeof(fix));
+        ++fixes;
+    }
+
+    void onDetailedLocationUpdate(const shared_ptr<ILocationInfoEx> &info) override {
+        const CompactLocationFix fix = LocationReportAdapter::toCompactFix(*info);
+        add('D', &fix, sizeof(fix));
+        ++fixes;
+    }
+
+    void onDetailedEngineLocationUpdate(
+        const vector<shared_ptr<ILocationInfoEx>> &infos) override {
+        string event(1, 'E');
+        for (const auto &info : infos) {
+            LoggedEngineFix logged;
+            std::memset(&logged, 0, sizeof(logged));
+            logged.engineType = info->getLocOutputEngType();
+            logged.engineMask = info->getLocOutputEngMask();
+            logged.fix = LocationReportAdapter::toCompactFix(*info);
+            event.append(reinterpret_cast<const char *>(&logged), sizeof(logged));
+        }
+        events.push_back(event);
+        engineFixes += static_cast<uint32_t>(infos.size());
+    }
+
+    void onGnssSVInfo(const shared_ptr<IGnssSVInfo> &info) override {
+        const AltitudeType altitudeType = info->getAltitudeType();
+        string event(1, 'S');
+        event.append(reinterpret_cast<const char *>(&altitudeType), sizeof(altitudeType));
+        for (const auto &sv : info->getSVInfoList()) {
+            const CompactSvInfo compact = LocationReportAdapter::toCompactSvInfo(*sv);
+            event.append(reinterpret_cast<const char *>(&compact), sizeof(compact));
+        }
+        events.push_back(event);
+    }
+
+    void onGnssSignalInfo(const shared_ptr<IGnssSignalInfo> &info) override {
+        const GnssData data = info->getGnssData();
+        add('G', &data, sizeof(data));
+    }
+
+    void onGnssNmeaInfo(uint64_t timestamp, const string &nmea) override {
+        add('N', &timestamp, sizeof(timestamp), nmea.data(), nmea.size());
+    }
+
+    void onGnssMeasurementsInfo(const GnssMeasurements &info) override {
+        LoggedMeasurementsHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.clock = info.clock;
+        header.isNHz = info.isNHz;
+        header.count = static_cast<uint32_t>(info.measurements.size());
+        add('M', &header, sizeof(header), info.measurements.data(),
+            info.measurements.size() * sizeof(GnssMeasurementsData));
+    }
+
+    void onCapabilitiesInfo(const LocCapability capabilities) override {
+        add('C', &capabilities, sizeof(capabilities));
+    }
+
+    uint32_t count(char type) const {
+        uint32_t n = 0;
+        for (const auto &event : events) {
+            n += (event[0] == type);
+        }
+        return n;
+    }
+
+ private:
+    void add(char type, const void *head, size_t headSize, const void *tail = nullptr,
+        size_t tailSize = 0) {
+        string event(1, type);
+        event.append(static_cast<const char *>(head), headSize);
+        if (tailSize) {
+            event.append(static_cast<const char *>(tail), tailSize);
+        }
+        events.push_back(event);
+    }
+};
+
+// Counts callbacks only, the cheapest consumer for the benchmark
+class Counter : public ILocationListener {
+ public:
+    uint64_t callbacks = 0;
+    uint64_t bytes = 0;
+
+    void onDetailedLocationUpdate(const shared_ptr<ILocationInfoEx> &info) override {
+        ++callbacks;
+    }
+    void onGnssSVInfo(const shared_ptr<IGnssSVInfo> &info) override {
+        ++callbacks;
+    }
+    void onGnssSignalInfo(const shared_ptr<IGnssSignalInfo> &info) override {
+        ++callbacks;
+    }
+    void onGnssNmeaInfo(uint64_t timestamp, const string &nmea) override {
+        ++callbacks;
+        bytes += nmea.size();
+    }
+    void onGnssMeasurementsInfo(const GnssMeasurements &info) override {
+        ++callbacks;
+    }
+};
+
+enum class FixKind { DETAILED, ENGINE, BASIC };
+
+/**
+ * Records a drive of the given number of 10 Hz epochs into path on a simulated clock, and
+ * makes the same callbacks on expected if given. Returns the number of records.
+ */
+static uint64_t recordDrive(const string &path, uint32_t epochs, FixKind kind,
+    ILocationListener *expected = nullptr) {
+    auto writer = make_shared<LocationLogWriter>();
+    CHECK(writer->open(path) == Status::SUCCESS);
+    const uint64_t start = 5000000000ULL;
+    uint64_t now = start;
+    auto recorder = make_shared<LocationRecorder>(writer, [&now]() { return now; });
+    vector<ILocationListener *> listeners{recorder.get()};
+    if (expected) {
+        listeners.push_back(expected);
+    }
+
+    LocationReportGenerator generator(7);
+    vector<CompactSvInfo> svs(SV_COUNT);
+    vector<char> sentence(128);
+    GnssMeasurements measurements;
+    measurements.measurements.resize(MEASUREMENT_COUNT);
+
+    for (auto listener : listeners) {
+        listener->onCapabilitiesInfo(CAPABILITIES);
+    }
+    for (uint32_t epoch = 0; epoch < epochs; ++epoch) {
+        const uint64_t timestamp = T0 + epoch * 100;
+        now = start + (epoch + 1) * EPOCH_NS;
+        const CompactLocationFix fix = generator.fix(timestamp);
+        if (kind == FixKind::ENGINE) {
+            CompactLocationFix spe = fix;
+            spe.latitude += 1e-5;
+            CompactLocationFix ppe = fix;
+            ppe.longitude -= 1e-5;
+            const vector<shared_ptr<ILocationInfoEx>> infos{
+                make_shared<LoggedLocationInfo>(fix, LOC_OUTPUT_ENGINE_FUSED,
+                    STANDARD_POSITIONING_ENGINE | PRECISE_POSITIONING_ENGINE),
+                make_shared<LoggedLocationInfo>(spe, LOC_OUTPUT_ENGINE_SPE,
+                    STANDARD_POSITIONING_ENGINE),
+                make_shared<LoggedLocationInfo>(ppe, LOC_OUTPUT_ENGINE_PPE,
+                    PRECISE_POSITIONING_ENGINE)};
+            for (auto listener : listeners) {
+                listener->onDetailedEngineLocationUpdate(infos);
+            }
+        } else if (kind == FixKind::BASIC) {
+            const shared_ptr<ILocationInfoBase> info = make_shared<LoggedLocationInfo>(fix);
+            for (auto listener : listeners) {
+                listener->onBasicLocationUpdate(info);
+            }
+        } else {
+            const shared_ptr<ILocationInfoEx> info = make_shared<LoggedLocationInfo>(fix);
+            for (auto listener : listeners) {
+                listener->onDetailedLocationUpdate(info);
+            }
+        }
+        now += 1000000;
+        generator.svInfo(svs.data(), SV_COUNT);
+        const shared_ptr<IGnssSVInfo> svInfo
+            = make_shared<LoggedGnssSvInfo>(AltitudeType::ASSUMED, svs.data(), SV_COUNT);
+        for (auto listener : listeners) {
+            listener->onGnssSVInfo(svInfo);
+        }
+        now += 1000000;
+        const shared_ptr<IGnssSignalInfo> signal
+            = make_shared<LoggedSignalInfo>(generator.signalInfo());
+        for (auto listener : listeners) {
+            listener->onGnssSignalInfo(signal);
+        }
+        for (uint32_t i = 0; i < NMEA_SENTENCES; ++i) {
+            now += 200000;
+            const size_t length = generator.nmea(timestamp, sentence.data(), sentence.size());
+            const string nmea(sentence.data(), length);
+            for (auto listener : listeners) {
+                listener->onGnssNmeaInfo(timestamp, nmea);
+            }
+        }
+        now += 1000000;
+        measurements.clock = generator.clock(timestamp);
+        measurements.isNHz = (epoch % 2 == 0);
+        generator.measurements(measurements.measurements.data(), MEASUREMENT_COUNT);
+        for (auto listener : listeners) {
+            listener->onGnssMeasurementsInfo(measurements);
+        }
+    }
+    writer->close();
+    return writer->getRecordCount();
+}
+
+static vector<string> withoutType(const vector<string> &events, char type) {
+    vector<string> result;
+    for (const auto &event : events) {
+        if (event[0] != type) {
+            result.push_back(event);
+        }
+    }
+    return result;
+}
+
+static void testLogFormat() {
+    const string path = logPath("format");
+    const uint32_t epochs = 20;
+    const uint64_t records = recordDrive(path, epochs, FixKind::DETAILED);
+    CHECK(records == 1 + epochs * (4 + NMEA_SENTENCES));
+
+    LocationLogReader reader;
+    CHECK(reader.open(path) == Status::SUCCESS);
+    LocationLogRecord record;
+    uint64_t count = 0;
+    uint64_t lastOffset = 0;
+    uint32_t fixes = 0;
+    while (reader.next(record)) {
+        CHECK(record.getOffsetNs() >= lastOffset);
+        lastOffset = record.getOffsetNs();
+        if (record.getType() == LOC_LOG_DETAILED_FIX) {
+            const CompactLocationFix *fix = record.getFix();
+            CHECK(fix && fix->timestamp == T0 + fixes * 100);
+            // The simulated clock is at the epoch when the fix is recorded
+            CHECK(record.getOffsetNs() == (fixes + 1) * EPOCH_NS);
+            ++fixes;
+        }
+        ++count;
+    }
+    CHECK(!reader.isTruncated());
+    CHECK(count == records);
+    CHECK(fixes == epochs);
+
+    reader.rewind();
+    CHECK(reader.next(record));
+    LocCapability capabilities = 0;
+    CHECK(record.getCapabilities(capabilities) && capabilities == CAPABILITIES);
+    CHECK(record.getFix() == nullptr);
+    unlink(path.c_str());
+}
+
+static void testRoundTrip() {
+    const string path = logPath("roundtrip");
+    const uint32_t epochs = 300;
+    Capture expected;
+    recordDrive(path, epochs, FixKind::DETAILED, &expected);
+
+    LocationReplayManager manager(path, LocationReplayManager::MAX_SPEED);
+    CHECK(manager.isSubsystemReady());
+    CHECK(manager.getCapabilities() == CAPABILITIES);
+    auto capture = make_shared<Capture>();
+    CHECK(manager.registerListenerEx(capture) == Status::SUCCESS);
+    CHECK(manager.registerListenerEx(capture) == Status::ALREADY);
+    std::atomic<int> responses{0};
+    CHECK(manager.startDetailedReports(100, [&responses](telux::common::ErrorCode error) {
+        responses += (error == telux::common::ErrorCode::SUCCESS);
+    }) == Status::SUCCESS);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(responses == 1);
+    const LocationReplayManager::Stats stats = manager.getStats();
+    CHECK(stats.completed);
+    CHECK(stats.records == expected.events.size());
+    CHECK(stats.callbacks == expected.events.size());
+    CHECK(stats.logNs > (epochs - 1) * EPOCH_NS);
+    CHECK(capture->events.size() == expected.events.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < capture->events.size() && i < expected.events.size(); ++i) {
+        mismatches += (capture->events[i] != expected.events[i]);
+    }
+    CHECK(mismatches == 0);
+    CHECK(capture->count('D') == epochs);
+    CHECK(capture->count('N') == epochs * NMEA_SENTENCES);
+
+    // A second start replays from the beginning; a deregistered listener receives nothing
+    auto second = make_shared<Capture>();
+    CHECK(manager.registerListenerEx(second) == Status::SUCCESS);
+    CHECK(manager.deRegisterListenerEx(capture) == Status::SUCCESS);
+    CHECK(manager.deRegisterListenerEx(capture) == Status::NOSUCH);
+    CHECK(manager.startDetailedReports(100) == Status::SUCCESS);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(second->events == expected.events);
+    CHECK(capture->events.size() == expected.events.size());
+    CHECK(manager.stopReports() == Status::SUCCESS);
+    unlink(path.c_str());
+}
+
+static void testFilters() {
+    const string path = logPath("filters");
+    const uint32_t epochs = 100;
+    Capture expected;
+    recordDrive(path, epochs, FixKind::DETAILED, &expected);
+    LocationReplayManager manager(path, LocationReplayManager::MAX_SPEED);
+    auto capture = make_shared<Capture>();
+    manager.registerListenerEx(capture);
+
+    // Report mask
+    manager.startDetailedReports(100, nullptr, GnssReportType::LOCATION | GnssReportType::NMEA);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(capture->count('D') == epochs);
+    CHECK(capture->count('N') == epochs * NMEA_SENTENCES);
+    CHECK(capture->count('S') == 0 && capture->count('G') == 0 && capture->count('M') == 0);
+    CHECK(capture->count('C') == 1);
+    CHECK(capture->events
+        == withoutType(withoutType(withoutType(expected.events, 'S'), 'G'), 'M'));
+
+    // Fix interval: 1 s of a 10 Hz drive
+    capture->events.clear();
+    manager.startDetailedReports(1000, nullptr, GnssReportType::LOCATION);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(capture->count('D') == epochs / 10);
+
+    // Basic reports of a detailed log, by distance: 1.5 m per fix, so every 10th fix for 14 m
+    capture->events.clear();
+    manager.startBasicReports(14, 100);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(capture->count('B') == epochs / 10);
+    CHECK(capture->count('D') == 0 && capture->count('N') == 0);
+    unlink(path.c_str());
+
+    // Engine reports: only the requested engines, in one callback per epoch
+    const string enginePath = logPath("engines");
+    Capture engineExpected;
+    recordDrive(enginePath, epochs, FixKind::ENGINE, &engineExpected);
+    LocationReplayManager engines(enginePath, LocationReplayManager::MAX_SPEED);
+    auto engineCapture = make_shared<Capture>();
+    engines.registerListenerEx(engineCapture);
+    engines.startDetailedEngineReports(100, LOC_REQ_ENGINE_FUSED_BIT | LOC_REQ_ENGINE_SPE_BIT
+        | LOC_REQ_ENGINE_PPE_BIT);
+    CHECK(engines.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(engineCapture->events == engineExpected.events);
+    engineCapture->events.clear();
+    engineCapture->engineFixes = 0;
+    engines.startDetailedEngineReports(100, LOC_REQ_ENGINE_SPE_BIT | LOC_REQ_ENGINE_PPE_BIT,
+        nullptr, GnssReportType::LOCATION);
+    CHECK(engines.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(engineCapture->count('E') == epochs);
+    CHECK(engineCapture->engineFixes == 2 * epochs);
+    // Detailed reports have no engine fixes
+    engineCapture->events.clear();
+    engines.startDetailedReports(100, nullptr, GnssReportType::LOCATION);
+    CHECK(engines.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(engineCapture->count('E') == 0 && engineCapture->count('D') == 0);
+    unlink(enginePath.c_str());
+
+    // Basic log
+    const string basicPath = logPath("basic");
+    Capture basicExpected;
+    recordDrive(basicPath, epochs, FixKind::BASIC, &basicExpected);
+    LocationReplayManager basic(basicPath, LocationReplayManager::MAX_SPEED);
+    auto basicCapture = make_shared<Capture>();
+    basic.registerListenerEx(basicCapture);
+    basic.startBasicReports(0, 100);
+    CHECK(basic.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(basicCapture->events == withoutType(withoutType(withoutType(withoutType(withoutType(
+        basicExpected.events, 'S'), 'G'), 'N'), 'M'), 'Z'));
+    CHECK(basicCapture->count('B') == epochs);
+    unlink(basicPath.c_str());
+}
+
+static void testPacing() {
+    const string path = logPath("pacing");
+    // 20 epochs, about 1.9 s of log
+    recordDrive(path, 20, FixKind::DETAILED);
+    LocationReplayManager manager(path, 10);
+    auto capture = make_shared<Capture>();
+    manager.registerListenerEx(capture);
+
+    auto start = std::chrono::steady_clock::now();
+    manager.startDetailedReports(100);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    double seconds = secondsSince(start);
+    LocationReplayManager::Stats stats = manager.getStats();
+    const double span = stats.logNs / 1e9;
+    CHECK(stats.completed);
+    CHECK(seconds >= span / 10 * 0.95);
+    CHECK(seconds < span / 10 + 1.0);
+    cout << "10x replay: " << std::fixed << std::setprecision(3) << span << " s of log in "
+         << seconds << " s, max lateness " << stats.maxLateNs / 1e6 << " ms" << endl;
+
+    // 1x, stopped after a third of the log
+    manager.setSpeed(1);
+    capture->events.clear();
+    start = std::chrono::steady_clock::now();
+    manager.startDetailedReports(100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(650));
+    CHECK(manager.stopReports() == Status::SUCCESS);
+    seconds = secondsSince(start);
+    stats = manager.getStats();
+    CHECK(!stats.completed);
+    CHECK(seconds < 1.5);
+    CHECK(capture->count('D') >= 5 && capture->count('D') <= 9);
+    CHECK(stats.logNs <= 1.5e9);
+    unlink(path.c_str());
+}
+
+static void testDamagedLogs() {
+    const string path = logPath("damaged");
+    const uint32_t epochs = 10;
+    Capture expected;
+    recordDrive(path, epochs, FixKind::DETAILED, &expected);
+
+    // Cut into the last record
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fclose(file);
+    CHECK(truncate(path.c_str(), size - 10) == 0);
+
+    LocationLogReader reader;
+    CHECK(reader.open(path) == Status::SUCCESS);
+    LocationLogRecord record;
+    uint64_t count = 0;
+    while (reader.next(record)) {
+        ++count;
+    }
+    CHECK(reader.isTruncated());
+    CHECK(count == expected.events.size() - 1);
+
+    LocationReplayManager manager(path, LocationReplayManager::MAX_SPEED);
+    auto capture = make_shared<Capture>();
+    manager.registerListenerEx(capture);
+    manager.startDetailedReports(100);
+    CHECK(manager.waitForCompletion(std::chrono::seconds(30)));
+    CHECK(!manager.getStats().completed);
+    expected.events.pop_back();
+    CHECK(capture->events == expected.events);
+
+    // Not a location log
+    file = std::fopen(path.c_str(), "wb");
+    std::fputs("$GPGGA,not a location log", file);
+    std::fclose(file);
+    CHECK(reader.open(path) == Status::INVALIDPARAM);
+    CHECK(reader.open(path + ".missing") == Status::FAILED);
+    LocationReplayManager invalid(path);
+    CHECK(!invalid.isSubsystemReady());
+    CHECK(invalid.getServiceStatus() == telux::common::ServiceStatus::SERVICE_FAILED);
+    CHECK(invalid.startDetailedReports(100) == Status::NOTREADY);
+    CHECK(invalid.getYearOfHw(nullptr) == Status::NOTSUPPORTED);
+
+    LocationLogWriter writer;
+    CHECK(writer.append(LOC_LOG_CAPABILITIES, 0, &CAPABILITIES, sizeof(CAPABILITIES))
+        == Status::INVALIDSTATE);
+    CHECK(writer.open(gDirectory + "/missing/directory/log.bin") == Status::FAILED);
+    unlink(path.c_str());
+}
+
+static void benchmark(uint32_t epochs) {
+    const string path = logPath("benchmark");
+    auto start = std::chrono::steady_clock::now();
+    const uint64_t records = recordDrive(path, epochs, FixKind::DETAILED);
+    const double recordSeconds = secondsSince(start);
+
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    const double megabytes = std::ftell(file) / 1e6;
+    std::fclose(file);
+
+    LocationReplayManager manager(path, LocationReplayManager::MAX_SPEED);
+    auto counter = make_shared<Counter>();
+    manager.registerListenerEx(counter);
+    const uint64_t allocationsBefore = gAllocations.load();
+    manager.startDetailedReports(100);
+    CHECK(manager.waitForCompletion(std::chrono::minutes(10)));
+    const uint64_t allocations = gAllocations.load() - allocationsBefore;
+    const LocationReplayManager::Stats stats = manager.getStats();
+    CHECK(stats.completed);
+    CHECK(stats.records == records);
+    CHECK(counter->callbacks == records - 1);
+    const double replaySeconds = stats.wallNs / 1e9;
+    const double driveMinutes = stats.logNs / 60e9;
+    unlink(path.c_str());
+
+    cout << std::fixed << std::setprecision(1);
+    cout << "Drive: " << epochs << " epochs at 10 Hz (" << driveMinutes << " min), " << records
+         << " records, " << megabytes << " MB, " << megabytes / driveMinutes << " MB/min" << endl;
+    cout << "Record: " << records / recordSeconds / 1e3 << " k records/s, "
+         << megabytes / recordSeconds << " MB/s (including the generator)" << endl;
+    cout << "Replay at max speed: " << replaySeconds * 1e3 << " ms, "
+         << records / replaySeconds / 1e3 << " k records/s, " << megabytes / replaySeconds
+         << " MB/s, " << std::setprecision(0) << driveMinutes * 60 / replaySeconds
+         << "x the recorded pace, " << std::setprecision(1)
+         << static_cast<double>(allocations) / records << " allocations/record" << endl;
+}
+
+int main(int argc, char **argv) {
+    uint32_t epochs = 6000;
+    int c;
+
+    while ((c = getopt(argc, argv, "e:d:")) != -1) {
+        switch (c) {
+            case 'e':
+                epochs = static_cast<uint32_t>(atoi(optarg));
+                break;
+            case 'd':
+                gDirectory = optarg;
+                break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-e epochs] [-d directory]" << endl;
+                return 1;
+        }
+    }
+
+    testLogFormat();
+    testRoundTrip();
+    testFilters();
+    testPacing();
+    testDamagedLogs();
+    benchmark(epochs);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,837 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: LocationReportTestApp.cpp
+ *
+ * @brief: Tests and fan-out benchmark of compact location reports
+ *
+ * A LocationReportGenerator stands in for the location service. The tests check that
+ * listeners receive exactly the report types they subscribed to, that reports of other types
+ * are not built, that the payloads match the generated data, that report buffers are recycled
+ * without overwriting a report a listener still holds, that LocationReportAdapter converts the
+ * ILocationListener callbacks faithfully and that listeners can subscribe and unsubscribe
+ * while reports are published on other threads.
+ *
+ * The benchmark publishes 10 Hz epochs (a fix, satellites, signal info, NMEA sentences and
+ * measurements) to 1, 4 and 8 listeners with a mix of subscriptions, once through
+ * ILocationListener with a report object per callback, as the location service does, and once
+ * through a LocationReportDispatcher, and compares time and allocations per epoch.
+ *
+ * Usage: location_report_test_app [-e epochs for the benchmark]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> LocationReportTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <telux/loc/LocationReport.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using telux::common::Status;
+using namespace telux::loc;
+
+static std::atomic<uint64_t> gAllocations{0};
+
+// Out of line, so that the compiler does not pair malloc() and free() with new and delete
+__attribute__((noinline)) void *operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static const uint32_t SV_COUNT = 48;
+static const uint32_t NMEA_SENTENCES = 6;
+static const uint32_t MEASUREMENT_COUNT = 48;
+static const uint64_t T0 = 1700000000000ULL;
+
+// Report objects as the location service builds them for ILocationListener
+
+class FixInfo : public ILocationInfoEx {
+ public:
+    explicit FixInfo(const CompactLocationFix &fix)
+       : f_(fix) {
+    }
+    LocationInfoValidity getLocationInfoValidity() override { return f_.validity; }
+    LocationTechnology getTechMask() override { return f_.techMask; }
+    float getSpeed() override { return f_.speed; }
+    double getLatitude() override { return f_.latitude; }
+    double getLongitude() override { return f_.longitude; }
+    double getAltitude() override { return f_.altitude; }
+    float getHeading() override { return f_.heading; }
+    float getHorizontalUncertainty() override { return f_.horizontalUncertainty; }
+    float getVerticalUncertainty() override { return f_.verticalUncertainty; }
+    uint64_t getTimeStamp() override { return f_.timestamp; }
+    float getSpeedUncertainty() override { return f_.speedUncertainty; }
+    float getHeadingUncertainty() override { return f_.headingUncertainty; }
+    uint64_t getElapsedRealTime() override { return f_.elapsedRealTime; }
+    uint64_t getElapsedRealTimeUncertainty() override { return 0; }
+    LocationInfoExValidity getLocationInfoExValidity() override { return f_.exValidity; }
+    float getAltitudeMeanSeaLevel() override { return f_.altitudeMeanSeaLevel; }
+    float getPositionDop() override { return f_.positionDop; }
+    float getHorizontalDop() override { return f_.horizontalDop; }
+    float getVerticalDop() override { return f_.verticalDop; }
+    float getGeometricDop() override { return 0; }
+    float getTimeDop() override { return 0; }
+    float getMagneticDeviation() override { return 0; }
+    LocationReliability getHorizontalReliability() override {
+        return static_cast<LocationReliability>(0);
+    }
+    LocationReliability getVerticalReliability() override {
+        return static_cast<LocationReliability>(0);
+    }
+    float getHorizontalUncertaintySemiMajor() override {
+        return f_.horizontalUncertaintySemiMajor;
+    }
+    float getHorizontalUncertaintySemiMinor() override {
+        return f_.horizontalUncertaintySemiMinor;
+    }
+    float getHorizontalUncertaintyAzimuth() override { return f_.horizontalUncertaintyAzimuth; }
+    float getEastStandardDeviation() override { return f_.eastStandardDeviation; }
+    float getNorthStandardDeviation() override { return f_.northStandardDeviation; }
+    uint16_t getNumSvUsed() override { return f_.numSvUsed; }
+    SvUsedInPosition getSvUsedInPosition() override { return f_.svUsedInPosition; }
+    void getSVIds(std::vector<uint16_t> &ids) override { ids.clear(); }
+    SbasCorrection getSbasCorrection() override { return SbasCorrection(); }
+    GnssPositionTech getPositionTechnology() override { return f_.positionTechnology; }
+    GnssKinematicsData getBodyFrameData() override { return f_.bodyFrameData; }
+    std::vector<GnssMeasurementInfo> getmeasUsageInfo() override {
+        return std::vector<GnssMeasurementInfo>();
+    }
+    SystemTime getGnssSystemTime() override { return f_.gnssSystemTime; }
+    float getTimeUncMs() override { return f_.timeUncMs; }
+    Status getLeapSeconds(uint8_t &leapSeconds) override {
+        leapSeconds = f_.leapSeconds;
+        return Status::SUCCESS;
+    }
+    Status getVelocityEastNorthUp(std::vector<float> &v) override {
+        v.assign(f_.velocityEastNorthUp, f_.velocityEastNorthUp + 3);
+        return Status::SUCCESS;
+    }
+    Status getVelocityUncertaintyEastNorthUp(std::vector<float> &v) override {
+        v.assign(f_.velocityUncertaintyEastNorthUp, f_.velocityUncertaintyEastNorthUp + 3);
+        return Status::SUCCESS;
+    }
+    uint8_t getCalibrationConfidencePercent() override { return f_.calibrationConfidencePercent; }
+    DrCalibrationStatus getCalibrationStatus() override { return f_.calibrationStatus; }
+    LocationAggregationType getLocOutputEngType() override {
+        return static_cast<LocationAggregationType>(0);
+    }
+    PositioningEngine getLocOutputEngMask() override { return 0; }
+    float getConformityIndex() override { return 0; }
+    LLAInfo getVRPBasedLLA() override { return LLAInfo(); }
+    std::vector<float> getVRPBasedENUVelocity() override { return std::vector<float>(); }
+    AltitudeType getAltitudeType() override { return AltitudeType::CALCULATED; }
+    ReportStatus getReportStatus() override { return static_cast<ReportStatus>(0); }
+    uint32_t getIntegrityRiskUsed() override { return 0; }
+    float getProtectionLevelAlongTrack() override { return 0; }
+    float getProtectionLevelCrossTrack() override { return 0; }
+    float getProtectionLevelVertical() override { return 0; }
+
+ private:
+    CompactLocationFix f_;
+};
+
+class SvInfo : public ISVInfo {
+ public:
+    explicit SvInfo(const CompactSvInfo &sv)
+       : s_(sv) {
+    }
+    GnssConstellationType getConstellation() override { return s_.constellation; }
+    uint16_t getId() override { return s_.id; }
+    SVHealthStatus getSVHealthStatus() override { return s_.health; }
+    SVStatus getStatus() override { return s_.status; }
+    SVInfoAvailability getHasEphemeris() override { return s_.hasEphemeris; }
+    SVInfoAvailability getHasAlmanac() override { return s_.hasAlmanac; }
+    SVInfoAvailability getHasFix() override { return s_.hasFix; }
+    float getElevation() override { return s_.elevation; }
+    float getAzimuth() override { return s_.azimuth; }
+    float getSnr() override { return s_.snr; }
+    float getCarrierFrequency() override { return s_.carrierFrequency; }
+    GnssSignal getSignalType() override { return s_.signalType; }
+    uint16_t getGlonassFcn() override { return s_.glonassFcn; }
+    double getBasebandCnr() override { return s_.basebandCnr; }
+
+ private:
+    CompactSvInfo s_;
+};
+
+class GnssSvInfo : public IGnssSVInfo {
+ public:
+    GnssSvInfo(const CompactSvInfo *svs, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            svs_.push_back(make_shared<SvInfo>(svs[i]));
+        }
+    }
+    AltitudeType getAltitudeType() override { return AltitudeType::CALCULATED; }
+    std::vector<std::shared_ptr<ISVInfo>> getSVInfoList() override { return svs_; }
+
+ private:
+    std::vector<std::shared_ptr<ISVInfo>> svs_;
+};
+
+class SignalInfo : public IGnssSignalInfo {
+ public:
+    explicit SignalInfo(const GnssData &data)
+       : data_(data) {
+    }
+    GnssData getGnssData() override { return data_; }
+
+ private:
+    GnssData data_;
+};
+
+// One epoch of generated report data
+struct RawEpoch {
+    uint64_t timestamp;
+    CompactLocationFix fix;
+    CompactSvInfo svs[SV_COUNT];
+    GnssData signal;
+    char nmea[NMEA_SENTENCES][128];
+    size_t nmeaLength[NMEA_SENTENCES];
+    GnssMeasurementsClock clock;
+    GnssMeasurementsData measurements[MEASUREMENT_COUNT];
+};
+
+static void makeRawEpoch(LocationReportGenerator &generator, uint64_t timestamp,
+    RawEpoch &epoch) {
+    epoch.timestamp = timestamp;
+    epoch.fix = generator.fix(timestamp);
+    generator.svInfo(epoch.svs, SV_COUNT);
+    epoch.signal = generator.signalInfo();
+    for (uint32_t i = 0; i < NMEA_SENTENCES; ++i) {
+        epoch.nmeaLength[i] = generator.nmea(timestamp, epoch.nmea[i], sizeof(epoch.nmea[i]));
+    }
+    epoch.clock = generator.clock(timestamp);
+    generator.measurements(epoch.measurements, MEASUREMENT_COUNT);
+}
+
+// The same epoch in the form of the ILocationListener callbacks
+struct LegacyEpoch {
+    shared_ptr<ILocationInfoEx> fix;
+    shared_ptr<IGnssSVInfo> svInfo;
+    shared_ptr<IGnssSignalInfo> signalInfo;
+    vector<string> nmea;
+    GnssMeasurements measurements;
+};
+
+static LegacyEpoch makeLegacyEpoch(const RawEpoch &raw) {
+    LegacyEpoch epoch;
+    epoch.fix = make_shared<FixInfo>(raw.fix);
+    epoch.svInfo = make_shared<GnssSvInfo>(raw.svs, SV_COUNT);
+    epoch.signalInfo = make_shared<SignalInfo>(raw.signal);
+    for (uint32_t i = 0; i < NMEA_SENTENCES; ++i) {
+        epoch.nmea.push_back(string(raw.nmea[i], raw.nmeaLength[i]));
+    }
+    epoch.measurements.clock = raw.clock;
+    epoch.measurements.isNHz = true;
+    epoch.measurements.measurements.assign(raw.measurements,
+        raw.measurements + MEASUREMENT_COUNT);
+    return epoch;
+}
+
+static void publishCompact(const RawEpoch &raw, LocationReportDispatcher &dispatcher) {
+    dispatcher.publishFix(raw.fix);
+    dispatcher.publishSvInfo(AltitudeType::CALCULATED, raw.svs, SV_COUNT);
+    dispatcher.publishSignalInfo(raw.signal);
+    for (uint32_t i = 0; i < NMEA_SENTENCES; ++i) {
+        dispatcher.publishNmea(raw.timestamp, raw.nmea[i], raw.nmeaLength[i]);
+    }
+    dispatcher.publishMeasurements(raw.clock, true, raw.measurements, MEASUREMENT_COUNT);
+}
+
+static void deliverLegacy(const LegacyEpoch &epoch, uint64_t timestamp,
+    const vector<shared_ptr<ILocationListener>> &listeners) {
+    for (auto &listener : listeners) {
+        listener->onDetailedLocationUpdate(epoch.fix);
+        listener->onGnssSVInfo(epoch.svInfo);
+        listener->onGnssSignalInfo(epoch.signalInfo);
+        for (auto &sentence : epoch.nmea) {
+            listener->onGnssNmeaInfo(timestamp, sentence);
+        }
+        listener->onGnssMeasurementsInfo(epoch.measurements);
+    }
+}
+
+// Reads what an application typically reads from each report type and counts reports
+struct Consumer {
+    LocationReportMask mask;
+    uint64_t reports[5] = {};
+    double checksum = 0;
+
+    explicit Consumer(LocationReportMask mask)
+       : mask(mask) {
+    }
+
+    static int index(LocationReportType type) {
+        int i = 0;
+        while (!((1u << i) & type)) {
+            ++i;
+        }
+        return i;
+    }
+
+    void consume(const LocationReport &report) {
+        ++reports[index(report.getType())];
+        switch (report.getType()) {
+            case LOC_REPORT_FIX:
+                checksum += report.getFix()->latitude + report.getFix()->speed;
+                break;
+            case LOC_REPORT_SV_INFO:
+                for (uint32_t i = 0; i < report.getCount(); ++i) {
+                    checksum += report.getSvInfo()[i].snr;
+                }
+                break;
+            case LOC_REPORT_SIGNAL_INFO:
+                checksum += report.getSignalInfo()->agc[0];
+                break;
+            case LOC_REPORT_NMEA:
+                checksum += report.getCount();
+                break;
+            case LOC_REPORT_MEASUREMENTS:
+                for (uint32_t i = 0; i < report.getCount(); ++i) {
+                    checksum += report.getMeasurements()[i].carrierToNoiseDbHz;
+                }
+                break;
+        }
+    }
+};
+
+class CompactListener : public ILocationReportListener {
+ public:
+    explicit CompactListener(LocationReportMask mask)
+       : consumer(mask) {
+    }
+
+    void onLocationReport(const shared_ptr<const LocationReport> &report) override {
+        consumer.consume(*report);
+        if (keep) {
+            kept.push_back(report);
+        }
+    }
+
+    Consumer consumer;
+    bool keep = false;
+    vector<shared_ptr<const LocationReport>> kept;
+};
+
+// The same consumer behind ILocationListener: it is called for every report and ignores
+// the types it does not use
+class LegacyListener : public ILocationListener {
+ public:
+    explicit LegacyListener(LocationReportMask mask)
+       : consumer(mask) {
+    }
+
+    void onDetailedLocationUpdate(const shared_ptr<ILocationInfoEx> &info) override {
+        if (consumer.mask & LOC_REPORT_FIX) {
+            ++consumer.reports[0];
+            consumer.checksum += info->getLatitude() + info->getSpeed();
+        }
+    }
+
+    void onGnssSVInfo(const shared_ptr<IGnssSVInfo> &info) override {
+        if (consumer.mask & LOC_REPORT_SV_INFO) {
+            ++consumer.reports[1];
+            for (auto &sv : info->getSVInfoList()) {
+                consumer.checksum += sv->getSnr();
+            }
+        }
+    }
+
+    void onGnssSignalInfo(const shared_ptr<IGnssSignalInfo> &info) override {
+        if (consumer.mask & LOC_REPORT_SIGNAL_INFO) {
+            ++consumer.reports[2];
+            consumer.checksum += info->getGnssData().agc[0];
+        }
+    }
+
+    void onGnssNmeaInfo(uint64_t timestamp, const string &nmea) override {
+        if (consumer.mask & LOC_REPORT_NMEA) {
+            ++consumer.reports[3];
+            consumer.checksum += nmea.size();
+        }
+    }
+
+    void onGnssMeasurementsInfo(const GnssMeasurements &info) override {
+        if (consumer.mask & LOC_REPORT_MEASUREMENTS) {
+            ++consumer.reports[4];
+            for (auto &m : info.measurements) {
+                consumer.checksum += m.carrierToNoiseDbHz;
+            }
+        }
+    }
+
+    Consumer consumer;
+};
+
+static bool validChecksum(const char *sentence) {
+    const char *star = strchr(sentence, '*');
+    if (sentence[0] != '$' || star == nullptr) {
+        return false;
+    }
+    uint8_t checksum = 0;
+    for (const char *c = sentence + 1; c < star; ++c) {
+        checksum ^= static_cast<uint8_t>(*c);
+    }
+    return strtoul(star + 1, nullptr, 16) == checksum;
+}
+
+static void testSubscriptions() {
+    LocationReportDispatcher dispatcher;
+    auto fixOnly = make_shared<CompactListener>(LOC_REPORT_FIX);
+    auto nmeaSv = make_shared<CompactListener>(LOC_REPORT_NMEA | LOC_REPORT_SV_INFO);
+    auto all = make_shared<CompactListener>(LOC_REPORT_ALL);
+    LocationReportMask notified = 0;
+    int notifications = 0;
+    dispatcher.setSubscriptionListener([&](LocationReportMask mask) {
+        notified = mask;
+        ++notifications;
+    });
+
+    CHECK(dispatcher.getSubscribedTypes() == 0);
+    CHECK(dispatcher.registerListener(fixOnly, 0) == Status::INVALIDPARAM);
+    CHECK(dispatcher.registerListener(shared_ptr<CompactListener>(), LOC_REPORT_FIX)
+          == Status::INVALIDPARAM);
+    CHECK(dispatcher.registerListener(fixOnly, fixOnly->consumer.mask) == Status::SUCCESS);
+    CHECK(dispatcher.registerListener(nmeaSv, nmeaSv->consumer.mask) == Status::SUCCESS);
+    CHECK(dispatcher.getSubscribedTypes() == (LOC_REPORT_FIX | LOC_REPORT_NMEA
+                                              | LOC_REPORT_SV_INFO));
+    CHECK(notifications == 2 && notified == dispatcher.getSubscribedTypes());
+    CHECK(LocationReportDispatcher::toGnssReportTypeMask(dispatcher.getSubscribedTypes())
+          == (GnssReportType::LOCATION | GnssReportType::NMEA
+              | GnssReportType::SATELLITE_VEHICLE));
+    CHECK(LocationReportDispatcher::toGnssReportTypeMask(LOC_REPORT_MEASUREMENTS, true)
+          == GnssReportType::HIGH_RATE_MEASUREMENT);
+    CHECK(LocationReportDispatcher::toGnssReportTypeMask(LOC_REPORT_SIGNAL_INFO)
+          == GnssReportType::DATA);
+
+    // Nothing subscribed to signal info and measurements: not built
+    LocationReportGenerator generator;
+    bool filled = false;
+    CHECK(!dispatcher.publishSignalInfo(generator.signalInfo()));
+    CHECK(!dispatcher.publishMeasurementsWith(generator.clock(T0), false, 4,
+        [&filled](GnssMeasurementsData *) { filled = true; }));
+    CHECK(!filled);
+    CHECK(dispatcher.getStats().skipped == 2);
+    CHECK(dispatcher.getStats().allocations == 0);
+
+    const size_t published = generator.publishEpoch(dispatcher, T0, SV_COUNT, NMEA_SENTENCES,
+        MEASUREMENT_COUNT);
+    CHECK(published == 1 + 1 + NMEA_SENTENCES);
+    CHECK(fixOnly->consumer.reports[0] == 1);
+    CHECK(fixOnly->consumer.reports[1] == 0 && fixOnly->consumer.reports[3] == 0);
+    CHECK(nmeaSv->consumer.reports[0] == 0);
+    CHECK(nmeaSv->consumer.reports[1] == 1 && nmeaSv->consumer.reports[3] == NMEA_SENTENCES);
+    CHECK(dispatcher.getStats().deliveries == 1 + 1 + NMEA_SENTENCES);
+
+    // Re-registering changes the subscription, adding a listener widens it
+    CHECK(dispatcher.registerListener(nmeaSv, LOC_REPORT_NMEA) == Status::SUCCESS);
+    CHECK(dispatcher.registerListener(all, all->consumer.mask) == Status::SUCCESS);
+    CHECK(dispatcher.getSubscribedTypes() == LOC_REPORT_ALL);
+    CHECK(notified == LOC_REPORT_ALL);
+    generator.publishEpoch(dispatcher, T0 + 100, SV_COUNT, NMEA_SENTENCES, MEASUREMENT_COUNT);
+    CHECK(nmeaSv->consumer.reports[1] == 1);
+    CHECK(nmeaSv->consumer.reports[3] == 2 * NMEA_SENTENCES);
+    for (int i = 0; i < 5; ++i) {
+        CHECK(all->consumer.reports[i] == ((i == 3) ? NMEA_SENTENCES : 1u));
+    }
+
+    // Deregistered and expired listeners receive nothing
+    CHECK(dispatcher.deregisterListener(all) == Status::SUCCESS);
+    CHECK(dispatcher.deregisterListener(all) == Status::NOSUCH);
+    const int before = notifications;
+    nmeaSv.reset();
+    generator.publishEpoch(dispatcher, T0 + 200, SV_COUNT, NMEA_SENTENCES, MEASUREMENT_COUNT);
+    CHECK(all->consumer.reports[0] == 1);
+    CHECK(fixOnly->consumer.reports[0] == 3);
+    CHECK(notifications == before);
+    // The expired listener is dropped with the next update
+    CHECK(dispatcher.deregisterListener(fixOnly) == Status::SUCCESS);
+    CHECK(dispatcher.getSubscribedTypes() == 0);
+    CHECK(notified == 0);
+}
+
+static void testPayloads() {
+    LocationReportDispatcher dispatcher;
+    auto listener = make_shared<CompactListener>(LOC_REPORT_ALL);
+    listener->keep = true;
+    dispatcher.registerListener(listener, LOC_REPORT_ALL);
+
+    // Same seed, same data
+    LocationReportGenerator generator(7);
+    LocationReportGenerator expected(7);
+    generator.publishEpoch(dispatcher, T0, SV_COUNT, 2, MEASUREMENT_COUNT);
+    CHECK(listener->kept.size() == 6);
+    if (listener->kept.size() != 6) {
+        return;
+    }
+
+    const CompactLocationFix fix = expected.fix(T0);
+    CompactSvInfo svs[SV_COUNT];
+    expected.svInfo(svs, SV_COUNT);
+    const GnssData signal = expected.signalInfo();
+    char nmea[2][128];
+    expected.nmea(T0, nmea[0], sizeof(nmea[0]));
+    expected.nmea(T0, nmea[1], sizeof(nmea[1]));
+    const GnssMeasurementsClock clock = expected.clock(T0);
+    vector<GnssMeasurementsData> measurements(MEASUREMENT_COUNT);
+    expected.measurements(measurements.data(), MEASUREMENT_COUNT);
+
+    auto &kept = listener->kept;
+    CHECK(kept[0]->getType() == LOC_REPORT_FIX);
+    CHECK(kept[0]->getTimestamp() == T0);
+    CHECK(memcmp(kept[0]->getFix(), &fix, sizeof(fix)) == 0);
+    CHECK(kept[0]->getSvInfo() == nullptr && kept[0]->getNmea() == nullptr);
+    CHECK(kept[1]->getType() == LOC_REPORT_SV_INFO);
+    CHECK(kept[1]->getCount() == SV_COUNT);
+    CHECK(kept[1]->getAltitudeType() == AltitudeType::CALCULATED);
+    CHECK(memcmp(kept[1]->getSvInfo(), svs, sizeof(svs)) == 0);
+    CHECK(kept[2]->getType() == LOC_REPORT_SIGNAL_INFO);
+    CHECK(memcmp(kept[2]->getSignalInfo(), &signal, sizeof(signal)) == 0);
+    for (int i = 0; i < 2; ++i) {
+        CHECK(kept[3 + i]->getType() == LOC_REPORT_NMEA);
+        CHECK(strcmp(kept[3 + i]->getNmea(), nmea[i]) == 0);
+        CHECK(kept[3 + i]->getCount() == strlen(nmea[i]));
+        CHECK(validChecksum(kept[3 + i]->getNmea()));
+    }
+    CHECK(strncmp(kept[3]->getNmea(), "$GPGGA,", 7) == 0);
+    CHECK(strncmp(kept[4]->getNmea(), "$GPRMC,", 7) == 0);
+    CHECK(kept[5]->getType() == LOC_REPORT_MEASUREMENTS);
+    CHECK(kept[5]->isNHz());
+    CHECK(kept[5]->getCount() == MEASUREMENT_COUNT);
+    CHECK(memcmp(kept[5]->getMeasurementsClock(), &clock, sizeof(clock)) == 0);
+    CHECK(memcmp(kept[5]->getMeasurements(), measurements.data(),
+                 MEASUREMENT_COUNT * sizeof(GnssMeasurementsData)) == 0);
+    for (size_t i = 1; i < kept.size(); ++i) {
+        CHECK(kept[i]->getSequence() == kept[i - 1]->getSequence() + 1);
+    }
+}
+
+static void testRecycling() {
+    LocationReportDispatcher dispatcher(4);
+    auto listener = make_shared<CompactListener>(LOC_REPORT_ALL);
+    dispatcher.registerListener(listener, LOC_REPORT_ALL);
+    LocationReportGenerator generator;
+
+    // One report is kept across many publishes and must not change
+    listener->keep = true;
+    generator.publishEpoch(dispatcher, T0, SV_COUNT, 0, 0);
+    listener->keep = false;
+    shared_ptr<const LocationReport> held = listener->kept[0];
+    listener->kept.clear();
+    const CompactLocationFix heldFix = *held->getFix();
+    const uint64_t heldSequence = held->getSequence();
+
+    for (uint64_t i = 1; i <= 10; ++i) {
+        generator.publishEpoch(dispatcher, T0 + i * 100, SV_COUNT, NMEA_SENTENCES,
+            MEASUREMENT_COUNT);
+    }
+    const uint64_t warm = gAllocations.load();
+    const auto warmStats = dispatcher.getStats();
+    for (uint64_t i = 11; i <= 1000; ++i) {
+        generator.publishEpoch(dispatcher, T0 + i * 100, SV_COUNT, NMEA_SENTENCES,
+            MEASUREMENT_COUNT);
+    }
+    CHECK(dispatcher.getStats().allocations == warmStats.allocations);
+    CHECK(gAllocations.load() == warm);
+    CHECK(held->getType() == LOC_REPORT_FIX);
+    CHECK(held->getSequence() == heldSequence);
+    CHECK(memcmp(held->getFix(), &heldFix, sizeof(heldFix)) == 0);
+    // Pool of 4 with one held: at most 4 buffers ever allocated
+    CHECK(dispatcher.getStats().allocations <= 4);
+}
+
+static void testAdapter() {
+    auto dispatcher = make_shared<LocationReportDispatcher>();
+    auto listener = make_shared<CompactListener>(LOC_REPORT_ALL);
+    listener->keep = true;
+    dispatcher->registerListener(listener, LOC_REPORT_ALL);
+    LocationReportAdapter adapter(dispatcher);
+    ILocationListener &legacy = adapter;
+
+    LocationReportGenerator generator(3);
+    LocationReportGenerator expected(3);
+    std::unique_ptr<RawEpoch> raw(new RawEpoch);
+    makeRawEpoch(generator, T0, *raw);
+    const LegacyEpoch epoch = makeLegacyEpoch(*raw);
+    legacy.onDetailedLocationUpdate(epoch.fix);
+    legacy.onGnssSVInfo(epoch.svInfo);
+    legacy.onGnssSignalInfo(epoch.signalInfo);
+    legacy.onGnssNmeaInfo(T0, epoch.nmea[0]);
+    legacy.onGnssMeasurementsInfo(epoch.measurements);
+    CHECK(listener->kept.size() == 5);
+    if (listener->kept.size() != 5) {
+        return;
+    }
+
+    const CompactLocationFix fix = expected.fix(T0);
+    CHECK(memcmp(listener->kept[0]->getFix(), &fix, sizeof(fix)) == 0);
+    CompactSvInfo svs[SV_COUNT];
+    expected.svInfo(svs, SV_COUNT);
+    const CompactSvInfo *converted = listener->kept[1]->getSvInfo();
+    CHECK(listener->kept[1]->getCount() == SV_COUNT);
+    for (uint32_t i = 0; i < SV_COUNT; ++i) {
+        CHECK(converted[i].id == svs[i].id && converted[i].snr == svs[i].snr
+              && converted[i].constellation == svs[i].constellation
+              && converted[i].hasFix == svs[i].hasFix);
+    }
+    const GnssData signal = expected.signalInfo();
+    CHECK(memcmp(listener->kept[2]->getSignalInfo(), &signal, sizeof(signal)) == 0);
+    CHECK(listener->kept[3]->getNmea() == epoch.nmea[0]);
+    CHECK(listener->kept[4]->getCount() == MEASUREMENT_COUNT);
+    CHECK(memcmp(listener->kept[4]->getMeasurements(), epoch.measurements.measurements.data(),
+                 MEASUREMENT_COUNT * sizeof(GnssMeasurementsData)) == 0);
+
+    // Unsubscribed callbacks are not converted
+    dispatcher->registerListener(listener, LOC_REPORT_FIX);
+    const auto stats = dispatcher->getStats();
+    legacy.onGnssSVInfo(epoch.svInfo);
+    legacy.onGnssSignalInfo(epoch.signalInfo);
+    CHECK(dispatcher->getStats().published == stats.published);
+    CHECK(listener->kept.size() == 5);
+}
+
+// Deregisters itself from its callback
+class OneShotListener : public ILocationReportListener {
+ public:
+    explicit OneShotListener(LocationReportDispatcher &dispatcher)
+       : dispatcher_(dispatcher) {
+    }
+
+    void onLocationReport(const shared_ptr<const LocationReport> &report) override {
+        ++calls;
+        result = dispatcher_.deregisterListener(self);
+    }
+
+    std::weak_ptr<ILocationReportListener> self;
+    int calls = 0;
+    Status result = Status::FAILED;
+
+ private:
+    LocationReportDispatcher &dispatcher_;
+};
+
+// Counts callbacks in progress
+class BusyListener : public ILocationReportListener {
+ public:
+    void onLocationReport(const shared_ptr<const LocationReport> &report) override {
+        inside.fetch_add(1);
+        calls.fetch_add(1);
+        std::this_thread::yield();
+        inside.fetch_sub(1);
+    }
+
+    std::atomic<int> inside{0};
+    std::atomic<uint64_t> calls{0};
+};
+
+static void testConcurrency() {
+    LocationReportDispatcher dispatcher;
+    auto oneShot = make_shared<OneShotListener>(dispatcher);
+    oneShot->self = oneShot;
+    dispatcher.registerListener(oneShot, LOC_REPORT_FIX);
+    LocationReportGenerator generator;
+    generator.publishEpoch(dispatcher, T0, 0, 0, 0);
+    generator.publishEpoch(dispatcher, T0 + 100, 0, 0, 0);
+    CHECK(oneShot->calls == 1);
+    CHECK(oneShot->result == Status::SUCCESS);
+
+    // Two publishers while listeners come and go; a deregistered listener is never called
+    // after deregisterListener() returns
+    auto stable = make_shared<BusyListener>();
+    dispatcher.registerListener(stable, LOC_REPORT_ALL);
+    std::atomic<bool> stop{false};
+    vector<std::thread> publishers;
+    for (int t = 0; t < 2; ++t) {
+        publishers.emplace_back([&dispatcher, &stop, t]() {
+            LocationReportGenerator local(t + 10);
+            uint64_t timestamp = T0;
+            while (!stop.load()) {
+                local.publishEpoch(dispatcher, timestamp += 100, 8, 2, 8);
+            }
+        });
+    }
+    int lateCalls = 0;
+    for (int i = 0; i < 300; ++i) {
+        auto transient = make_shared<BusyListener>();
+        dispatcher.registerListener(transient, (i % 2) ? LOC_REPORT_ALL : LOC_REPORT_NMEA);
+        std::this_thread::yield();
+        dispatcher.deregisterListener(transient);
+        const uint64_t calls = transient->calls.load();
+        if (transient->inside.load() != 0) {
+            ++lateCalls;
+        }
+        std::this_thread::yield();
+        if (transient->calls.load() != calls) {
+            ++lateCalls;
+        }
+    }
+    stop = true;
+    for (auto &publisher : publishers) {
+        publisher.join();
+    }
+    CHECK(lateCalls == 0);
+    CHECK(stable->calls.load() > 0);
+    const auto stats = dispatcher.getStats();
+    CHECK(stats.deliveries >= stats.published);
+}
+
+static void bench(uint32_t epochs) {
+    static const LocationReportMask mix[] = {LOC_REPORT_FIX, LOC_REPORT_ALL, LOC_REPORT_NMEA,
+                                             LOC_REPORT_FIX | LOC_REPORT_SV_INFO};
+    static const size_t RAW_EPOCHS = 64;
+    cout << "epoch: 1 fix, " << SV_COUNT << " satellites, signal info, " << NMEA_SENTENCES
+         << " NMEA sentences, " << MEASUREMENT_COUNT << " measurements" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    // Generated up front, so that only building and delivering the reports is timed
+    vector<RawEpoch> raw(RAW_EPOCHS);
+    LocationReportGenerator generator;
+    for (size_t e = 0; e < RAW_EPOCHS; ++e) {
+        makeRawEpoch(generator, T0 + e * 100, raw[e]);
+    }
+
+    for (size_t count : {1, 4, 8}) {
+        vector<shared_ptr<LegacyListener>> legacy;
+        vector<shared_ptr<ILocationListener>> legacyBase;
+        LocationReportDispatcher dispatcher;
+        vector<shared_ptr<CompactListener>> compact;
+        for (size_t i = 0; i < count; ++i) {
+            legacy.push_back(make_shared<LegacyListener>(mix[i % 4]));
+            legacyBase.push_back(legacy.back());
+            compact.push_back(make_shared<CompactListener>(mix[i % 4]));
+            dispatcher.registerListener(compact.back(), mix[i % 4]);
+        }
+
+        // Warm up the report pool, then count
+        publishCompact(raw[0], dispatcher);
+        for (auto &listener : compact) {
+            listener->consumer = Consumer(listener->consumer.mask);
+        }
+
+        uint64_t allocations = gAllocations.load();
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t e = 0; e < epochs; ++e) {
+            const RawEpoch &epoch = raw[e % RAW_EPOCHS];
+            deliverLegacy(makeLegacyEpoch(epoch), epoch.timestamp, legacyBase);
+        }
+        const double legacyUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / epochs;
+        const double legacyAllocations = double(gAllocations.load() - allocations) / epochs;
+
+        allocations = gAllocations.load();
+        start = std::chrono::steady_clock::now();
+        for (uint32_t e = 0; e < epochs; ++e) {
+            publishCompact(raw[e % RAW_EPOCHS], dispatcher);
+        }
+        const double compactUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / epochs;
+        const double compactAllocations = double(gAllocations.load() - allocations) / epochs;
+
+        // Both paths hand the consumers the same reports
+        for (size_t i = 0; i < count; ++i) {
+            for (int t = 0; t < 5; ++t) {
+                CHECK(legacy[i]->consumer.reports[t] == compact[i]->consumer.reports[t]);
+            }
+            CHECK(legacy[i]->consumer.checksum == compact[i]->consumer.checksum);
+        }
+        CHECK(compactAllocations < 0.01);
+        CHECK(compactUs < legacyUs);
+
+        cout << count << " listeners: ILocationListener " << legacyUs << " us, "
+             << legacyAllocations << " allocations per epoch; LocationReportDispatcher "
+             << compactUs << " us, " << compactAllocations << " allocations per epoch ("
+             << dispatcher.getStats().published / epochs << " of "
+             << 3 + NMEA_SENTENCES + 1 << " reports built)" << endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t epochs = 20000;
+    int c;
+
+    while ((c = getopt(argc, argv, "e:")) != -1) {
+        switch (c) {
+            case 'e':
+                epochs = static_cast<uint32_t>(atoi(optarg));
+                break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-e epochs]" << endl;
+                return 1;
+        }
+    }
+
+    testSubscriptions();
+    testPayloads();
+    testRecycling();
+    testAdapter();
+    testConcurrency();
+    bench(epochs);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
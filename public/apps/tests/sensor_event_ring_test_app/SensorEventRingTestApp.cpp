@@ -0,0 +1,574 @@
+/*
+ *  Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file: SensorEventRingTestApp.cpp
+ *
+ * @brief: Host test of SensorEventRing and SensorEventRingAdapter, and benchmark of ring versus
+ *         vector per batch delivery
+ *
+ * A synthetic accelerometer implements ISensor and produces events from its own thread,
+ * either paced at the configured sampling rate or as fast as possible. Each event carries its
+ * sequence number so readers can verify order and content.
+ *
+ *  - Concurrent readers poll the ring from their own threads while the sensor writes; every
+ *    event is either read intact and in order or counted as an overrun.
+ *  - A reader that stalls longer than the ring capacity loses exactly the overwritten events.
+ *  - The benchmark delivers the same events to several listeners through onEvent (one vector
+ *    allocated per batch and listener) and through a SensorEventRingAdapter (one vector per
+ *    batch for the adapter, whatever the number of listeners), and reports events/s and heap
+ *    allocations per mode.
+ *
+ * Usage: sensor_event_ring_test_app [-l listeners] [-b batch count] [-n events]
+ *                                   [-c ring capacity]
+ *
+ * Host build: g++ -std=c++11 -O2 -pthread -I<sdk headers> SensorEventRingTestApp.cpp
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <telux/sensor/Sensor.hpp>
+#include <telux/sensor/SensorEventRing.hpp>
+#include <telux/sensor/SensorEventRingAdapter.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::vector;
+using telux::common::Status;
+using namespace telux::sensor;
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<uint64_t> gAllocations{0};
+
+// Out of line, so that the compiler does not pair malloc() and free() with new and delete
+__attribute__((noinline)) void *operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            cerr << "CHECK failed: " #cond " (line " << __LINE__ << ")" << endl;    \
+            ++gFailures;                                                            \
+        }                                                                           \
+    } while (0)
+
+static SensorEvent makeEvent(uint64_t sequence) {
+    SensorEvent event;
+    event.timestamp = sequence;
+    event.calibrated.x = static_cast<float>(sequence & 0x3FF);
+    event.calibrated.y = -event.calibrated.x;
+    event.calibrated.z = 9.81f;
+    return event;
+}
+
+static bool isEvent(const SensorEvent &event, uint64_t sequence) {
+    return event.timestamp == sequence && event.calibrated.x == (sequence & 0x3FF)
+        && event.calibrated.y == -event.calibrated.x && event.calibrated.z == 9.81f;
+}
+
+/**
+ * Synthetic accelerometer. Produces events sequence 0, 1, ... in batches of the configured
+ * batch count, paced at the configured sampling rate, until deactivated or maxEvents have
+ * been produced. Unlike a real sensor any rate is accepted, 0 meaning as fast as possible.
+ */
+class SyntheticSensor : public ISensor {
+public:
+    explicit SyntheticSensor(uint64_t maxEvents) : maxEvents_(maxEvents) {
+        info_.id = 1;
+        info_.type = SensorType::ACCELEROMETER;
+        info_.name = "synthetic_accel";
+        info_.vendor = "host";
+        info_.samplingRates = {100.0f, 200.0f, 500.0f, 1000.0f};
+        info_.maxSamplingRate = 1000.0f;
+        info_.maxBatchCountSupported = 1024;
+        info_.minBatchCountSupported = 1;
+        info_.range = 2;
+        info_.version = 1;
+        info_.resolution = 0.001f;
+        info_.maxRange = 19.6f;
+        config_.samplingRate = 0.0f;
+        config_.batchCount = 16;
+        config_.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+        config_.validityMask.set(SensorConfigParams::BATCH_COUNT);
+    }
+
+    ~SyntheticSensor() {
+        deactivate();
+    }
+
+    SensorInfo getSensorInfo() override {
+        return info_;
+    }
+
+    Status configure(SensorConfiguration configuration) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            return Status::INVALIDSTATE;
+        }
+        if (configuration.validityMask.test(SensorConfigParams::SAMPLING_RATE)) {
+            config_.samplingRate = configuration.samplingRate;
+        }
+        if (configuration.validityMask.test(SensorConfigParams::BATCH_COUNT)) {
+            if (configuration.batchCount == 0
+                || configuration.batchCount > info_.maxBatchCountSupported) {
+                return Status::INVALIDPARAM;
+            }
+            config_.batchCount = configuration.batchCount;
+        }
+        return Status::SUCCESS;
+    }
+
+    SensorConfiguration getConfiguration() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return config_;
+    }
+
+    Status activate() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            return Status::SUCCESS;
+        }
+        running_ = true;
+        stop_ = false;
+        thread_ = std::thread(&SyntheticSensor::produce, this);
+        return Status::SUCCESS;
+    }
+
+    Status deactivate() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_) {
+            return Status::SUCCESS;
+        }
+        stop_ = true;
+        lock.unlock();
+        thread_.join();
+        lock.lock();
+        running_ = false;
+        return Status::SUCCESS;
+    }
+
+    Status enableLowPowerMode() override {
+        return Status::NOTSUPPORTED;
+    }
+
+    Status disableLowPowerMode() override {
+        return Status::NOTSUPPORTED;
+    }
+
+    Status selfTest(SelfTestType selfTestType, SelfTestResultCallback cb) override {
+        return Status::NOTSUPPORTED;
+    }
+
+    Status registerListener(std::weak_ptr<ISensorEventListener> listener) override {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        listeners_.push_back(listener);
+        return Status::SUCCESS;
+    }
+
+    Status deregisterListener(std::weak_ptr<ISensorEventListener> listener) override {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        auto target = listener.lock();
+        for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+            if (it->lock() == target) {
+                listeners_.erase(it);
+                return Status::SUCCESS;
+            }
+        }
+        return Status::NOSUCH;
+    }
+
+    /**
+     * Blocks until maxEvents have been produced.
+     */
+    void waitDone() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCv_.wait(lock, [this] { return done_; });
+        done_ = false;
+    }
+
+    uint64_t getProduced() const {
+        return produced_.load();
+    }
+
+private:
+    void produce() {
+        uint32_t batchCount;
+        float rate;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batchCount = config_.batchCount;
+            rate = config_.samplingRate;
+        }
+        vector<SensorEvent> batch(batchCount);
+        auto next = Clock::now();
+        const auto batchPeriod = std::chrono::nanoseconds(
+            (rate > 0) ? static_cast<int64_t>(1e9 * batchCount / rate) : 0);
+        uint64_t sequence = produced_.load();
+
+        while (!stop_.load(std::memory_order_relaxed) && sequence < maxEvents_) {
+            size_t count = 0;
+            for (; count < batchCount && sequence < maxEvents_; ++count, ++sequence) {
+                batch[count] = makeEvent(sequence);
+            }
+            notify(batch, count);
+            produced_.store(sequence, std::memory_order_release);
+            if (batchPeriod.count() > 0) {
+                next += batchPeriod;
+                std::this_thread::sleep_until(next);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+        doneCv_.notify_all();
+    }
+
+    // Each listener gets its own copy of the batch
+    void notify(const vector<SensorEvent> &batch, size_t count) {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        for (auto &weak : listeners_) {
+            auto listener = weak.lock();
+            if (listener) {
+                listener->onEvent(std::make_shared<vector<SensorEvent>>(
+                    batch.begin(), batch.begin() + count));
+            }
+        }
+    }
+
+    SensorInfo info_;
+    SensorConfiguration config_;
+    const uint64_t maxEvents_;
+    std::mutex mutex_;
+    std::condition_variable doneCv_;
+    bool running_ = false;
+    bool done_ = false;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> produced_{0};
+    std::thread thread_;
+    std::mutex listenerMutex_;
+    vector<std::weak_ptr<ISensorEventListener>> listeners_;
+};
+
+/**
+ * Listener consuming both delivery modes. Verifies the sequence of the events it receives.
+ */
+class CountingListener : public ISensorEventListener, public ISensorEventRingListener {
+public:
+    explicit CountingListener(shared_ptr<SensorEventRing> ring) : ring_(ring) {
+        if (ring_) {
+            cursor_.reset(new SensorEventRing::Cursor(*ring_));
+        }
+    }
+
+    void onEvent(shared_ptr<vector<SensorEvent>> events) override {
+        for (auto &event : *events) {
+            check(event);
+        }
+    }
+
+    void onEventRingUpdate(uint64_t head) override {
+        cursor_->forEach([this](const SensorEvent &event) { check(event); });
+    }
+
+    uint64_t received = 0;
+    uint64_t errors = 0;
+
+private:
+    void check(const SensorEvent &event) {
+        if (event.timestamp != received) {
+            ++errors;
+        }
+        sum += event.calibrated.x;
+        ++received;
+    }
+
+    float sum = 0;
+
+    shared_ptr<SensorEventRing> ring_;
+    std::unique_ptr<SensorEventRing::Cursor> cursor_;
+};
+
+// Readers poll the ring from their own threads while the sensor writes into it
+static void testConcurrentReaders(uint32_t readers, uint32_t capacity) {
+    const uint64_t total = 400000;
+    auto sensor = std::make_shared<SyntheticSensor>(total);
+    SensorEventRingAdapter adapter(sensor, capacity);
+    auto ring = adapter.getEventRing();
+    CHECK(ring != nullptr && ring->getCapacity() == capacity);
+
+    vector<std::thread> threads;
+    vector<uint64_t> read(readers, 0), lost(readers, 0), errors(readers, 0);
+    std::atomic<uint32_t> ready{0};
+
+    for (uint32_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r]() {
+            SensorEventRing::Cursor cursor(*ring);
+            SensorEvent events[64];
+            uint64_t expected = 0;
+            ready.fetch_add(1);
+            while (cursor.getPosition() < total) {
+                size_t count = cursor.read(events, 64);
+                if (count == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // Events are in order, gaps are exactly the counted overruns
+                for (size_t i = 0; i < count; ++i) {
+                    if (events[i].timestamp < expected
+                        || !isEvent(events[i], events[i].timestamp)) {
+                        ++errors[r];
+                    }
+                    expected = events[i].timestamp + 1;
+                }
+                read[r] += count;
+            }
+            lost[r] = cursor.getOverruns();
+        });
+    }
+    while (ready.load() < readers) {
+        std::this_thread::yield();
+    }
+    // 400 kHz in batches of 8, one batch every 20 us
+    SensorConfiguration config;
+    config.samplingRate = 400000.0f;
+    config.batchCount = 8;
+    config.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+    config.validityMask.set(SensorConfigParams::BATCH_COUNT);
+    CHECK(sensor->configure(config) == Status::SUCCESS);
+    CHECK(sensor->activate() == Status::SUCCESS);
+    sensor->waitDone();
+    for (auto &t : threads) {
+        t.join();
+    }
+    CHECK(sensor->deactivate() == Status::SUCCESS);
+
+    for (uint32_t r = 0; r < readers; ++r) {
+        cout << "reader " << r << ": read " << read[r] << " overruns " << lost[r] << endl;
+        CHECK(errors[r] == 0);
+        CHECK(read[r] + lost[r] == total);
+    }
+}
+
+// A reader that stalls loses exactly the events overwritten meanwhile
+static void testOverrun() {
+    auto ring = SensorEventRing::create(100);
+    CHECK(ring->getCapacity() == 128);
+
+    SensorEventRing::Cursor cursor(*ring);
+    SensorEvent events[300];
+    for (uint64_t i = 0; i < 300; ++i) {
+        events[i] = makeEvent(i);
+    }
+    ring->publish(events, 10);
+    SensorEvent out[300];
+    CHECK(cursor.read(out, 300) == 10);
+    CHECK(isEvent(out[0], 0) && isEvent(out[9], 9));
+    CHECK(cursor.getOverruns() == 0);
+
+    // 290 more events into 128 slots: the cursor resumes at the oldest one still held
+    ring->publish(events + 10, 290);
+    CHECK(cursor.available() == 290);
+    size_t count = cursor.read(out, 300);
+    CHECK(count == 128);
+    CHECK(cursor.getOverruns() == 290 - 128);
+    CHECK(isEvent(out[0], 300 - 128) && isEvent(out[127], 299));
+    CHECK(cursor.read(out, 300) == 0);
+
+    SensorEventRing::Cursor late(*ring);
+    late.seekOldest();
+    CHECK(late.getPosition() == 300 - 128);
+}
+
+// A ring created in caller provided memory can be attached from that memory
+static void testAttach() {
+    vector<uint64_t> memory(SensorEventRing::requiredSize(16) / sizeof(uint64_t) + 1);
+    SensorEventRing *ring = SensorEventRing::create(memory.data(), 16);
+    SensorEvent event = makeEvent(0);
+    ring->publish(&event, 1);
+
+    SensorEventRing *attached = SensorEventRing::attach(memory.data());
+    CHECK(attached == ring);
+    SensorEventRing::Cursor cursor(*attached);
+    cursor.seekOldest();
+    SensorEvent out;
+    CHECK(cursor.read(&out, 1) == 1 && isEvent(out, 0));
+
+    vector<uint64_t> other(memory.size(), 0);
+    CHECK(SensorEventRing::attach(other.data()) == nullptr);
+}
+
+// Ring listeners are registered once, and only the registered ones are notified
+static void testAdapterListeners() {
+    auto sensor = std::make_shared<SyntheticSensor>(64);
+    SensorEventRingAdapter adapter(sensor, 64);
+    auto first = std::make_shared<CountingListener>(adapter.getEventRing());
+    auto second = std::make_shared<CountingListener>(adapter.getEventRing());
+
+    CHECK(adapter.getSensor() == sensor);
+    CHECK(adapter.registerListener(first) == Status::SUCCESS);
+    CHECK(adapter.registerListener(first) == Status::ALREADY);
+    CHECK(adapter.registerListener(second) == Status::SUCCESS);
+    CHECK(adapter.deregisterListener(second) == Status::SUCCESS);
+    CHECK(adapter.deregisterListener(second) == Status::NOSUCH);
+    CHECK(adapter.registerListener(std::weak_ptr<ISensorEventRingListener>())
+        == Status::INVALIDPARAM);
+
+    CHECK(sensor->activate() == Status::SUCCESS);
+    sensor->waitDone();
+    CHECK(sensor->deactivate() == Status::SUCCESS);
+    CHECK(first->received == 64 && first->errors == 0);
+    CHECK(second->received == 0);
+}
+
+struct BenchResult {
+    double eventsPerSec;
+    uint64_t allocations;
+    uint64_t errors;
+};
+
+static BenchResult bench(bool useRing, uint32_t listeners, uint32_t batchCount, uint64_t total,
+                         uint32_t capacity) {
+    auto sensor = std::make_shared<SyntheticSensor>(total);
+    SensorConfiguration config;
+    config.batchCount = batchCount;
+    config.validityMask.set(SensorConfigParams::BATCH_COUNT);
+    CHECK(sensor->configure(config) == Status::SUCCESS);
+    std::unique_ptr<SensorEventRingAdapter> adapter;
+    if (useRing) {
+        adapter.reset(new SensorEventRingAdapter(sensor, capacity));
+    }
+
+    vector<shared_ptr<CountingListener>> counting;
+    for (uint32_t i = 0; i < listeners; ++i) {
+        if (adapter) {
+            counting.push_back(std::make_shared<CountingListener>(adapter->getEventRing()));
+            CHECK(adapter->registerListener(counting.back()) == Status::SUCCESS);
+        } else {
+            counting.push_back(std::make_shared<CountingListener>(nullptr));
+            CHECK(sensor->registerListener(counting.back()) == Status::SUCCESS);
+        }
+    }
+
+    // Allocations of the producer thread itself are counted too, they are the same in both modes
+    const uint64_t allocBefore = gAllocations.load();
+    const auto start = Clock::now();
+    CHECK(sensor->activate() == Status::SUCCESS);
+    sensor->waitDone();
+    const auto end = Clock::now();
+    const uint64_t allocations = gAllocations.load() - allocBefore;
+    CHECK(sensor->deactivate() == Status::SUCCESS);
+
+    BenchResult result;
+    result.eventsPerSec = total / std::chrono::duration<double>(end - start).count();
+    result.allocations = allocations;
+    result.errors = 0;
+    for (auto &listener : counting) {
+        result.errors += listener->errors;
+        CHECK(listener->received == total);
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    uint32_t listeners = 3;
+    uint32_t batchCount = 16;
+    uint64_t total = 4000000;
+    uint32_t capacity = 1024;
+    int c;
+
+    while ((c = getopt(argc, argv, "l:b:n:c:h")) != -1) {
+        switch (c) {
+            case 'l': listeners = atoi(optarg); break;
+            case 'b': batchCount = atoi(optarg); break;
+            case 'n': total = strtoull(optarg, nullptr, 10); break;
+            case 'c': capacity = atoi(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-l listeners] [-b batch count] [-n events]"
+                     << " [-c ring capacity]" << endl;
+                return 1;
+        }
+    }
+    if (listeners == 0 || batchCount == 0 || capacity < batchCount) {
+        cerr << "listeners and batch count must be > 0, capacity >= batch count" << endl;
+        return 1;
+    }
+
+    testOverrun();
+    testAttach();
+    testAdapterListeners();
+    testConcurrentReaders(4, 256);
+
+    const auto vec = bench(false, listeners, batchCount, total, capacity);
+    const auto ring = bench(true, listeners, batchCount, total, capacity);
+    const uint64_t batches = (total + batchCount - 1) / batchCount;
+
+    cout << listeners << " listeners, batch " << batchCount << ", " << total << " events" << endl;
+    cout << "vector: " << static_cast<uint64_t>(vec.eventsPerSec) << " events/s, "
+         << vec.allocations << " allocations" << endl;
+    cout << "ring:   " << static_cast<uint64_t>(ring.eventsPerSec) << " events/s, "
+         << ring.allocations << " allocations" << endl;
+
+    CHECK(vec.errors == 0);
+    CHECK(ring.errors == 0);
+    // make_shared of a vector allocates twice, the shared object and the vector buffer
+    CHECK(vec.allocations >= 2 * batches * listeners);
+    // In ring mode the listeners add nothing to the adapter's vector per batch, besides the
+    // producer thread and its batch buffer
+    CHECK(ring.allocations <= 2 * batches + 2);
+
+    if (gFailures) {
+        cerr << gFailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,686 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       AdaptiveBatchingSensor.hpp
+ *
+ * @brief      AdaptiveBatchingSensor is an ISensor that adjusts the batch count, and optionally
+ *             the sampling rate, of an underlying sensor at runtime from the latency budgets of
+ *             its listeners, the motion it measures and the TCU activity state.
+ */
+
+#ifndef TELUX_SENSOR_ADAPTIVEBATCHINGSENSOR_HPP
+#define TELUX_SENSOR_ADAPTIVEBATCHINGSENSOR_HPP
+
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/power/TcuActivityListener.hpp>
+#include <telux/sensor/Sensor.hpp>
+#include <telux/sensor/SensorDefines.hpp>
+
+namespace telux {
+namespace sensor {
+
+/** @addtogroup telematics_sensor_control
+ * @{ */
+
+/**
+ * Policy of an @ref telux::sensor::AdaptiveBatchingSensor
+ */
+struct AdaptiveBatchingConfig {
+    /** Sampling rate in Hz while moving, 0 keeps the configured rate */
+    float movingRate = 0.0f;
+    /** Sampling rate in Hz while stationary or suspended, 0 keeps the configured rate */
+    float parkedRate = 0.0f;
+    /** Latency budget of listeners registered without one */
+    uint64_t defaultLatencyNs = 100000000;
+    /** Latency allowed while stationary, if larger than the listener budgets */
+    uint64_t parkedLatencyNs = 2000000000;
+    /**
+     * Motion is detected over windows of motionWindowNs: for an accelerometer from the
+     * standard deviation of the acceleration magnitude (m/s^2), for a gyroscope from the mean
+     * angular rate magnitude (rad/s). A window above motionEnterThreshold starts motion, motion
+     * ends after stationaryHoldNs of windows below motionExitThreshold.
+     */
+    uint64_t motionWindowNs = 500000000;
+    float motionEnterThreshold = 0.1f;
+    float motionExitThreshold = 0.05f;
+    uint64_t stationaryHoldNs = 5000000000;
+    /** Minimum time between two switches that increase latency */
+    uint64_t minSwitchIntervalNs = 1000000000;
+};
+
+/**
+ * Counters of an @ref telux::sensor::AdaptiveBatchingSensor
+ */
+struct AdaptiveBatchingStats {
+    /** Configuration switches completed */
+    uint32_t switches = 0;
+    /** Batches delivered to the listeners */
+    uint64_t deliveries = 0;
+    /** Events delivered to the listeners */
+    uint64_t events = 0;
+    /** Events of the outgoing configuration dropped at switches, covered by the new one */
+    uint64_t overlapDropped = 0;
+    /**
+     * Switches completed without the outgoing client catching up with the new one, which may
+     * leave a gap in the events
+     */
+    uint32_t gapSwitches = 0;
+    bool moving = false;
+};
+
+/**
+ * @brief AdaptiveBatchingSensor wraps sensor clients obtained from a factory, typically
+ * @ref telux::sensor::ISensorManager::getSensor, and chooses their configuration:
+ *
+ *  - while moving, the largest batch count that keeps every listener within its latency
+ *    budget (@ref registerListener),
+ *  - while stationary, the largest within @ref AdaptiveBatchingConfig::parkedLatencyNs,
+ *  - while the TCU is suspended or shutting down, the largest batch count supported.
+ *
+ * Batch counts and rates follow the rules of @ref telux::sensor::ISensor::configure.
+ *
+ * A sensor must be deactivated to be reconfigured, so a switch is made before break: a second
+ * client is activated with the new configuration, and once the outgoing client has delivered
+ * up to the first event of the new one, listeners receive
+ * @ref telux::sensor::ISensorEventListener::onConfigurationUpdate followed by the events of the
+ * new client. Timestamps keep increasing without gap or duplicate; the events of the new client
+ * are held back until then. The outgoing client is deactivated afterwards.
+ *
+ * Sensor APIs are not invoked from the event delivery threads: switches run on the executor
+ * given at construction, or on an internal thread. An external executor must have run or
+ * dropped all tasks before the AdaptiveBatchingSensor is destroyed.
+ *
+ * Listeners receive @ref telux::sensor::ISensorEventListener::onEvent; for ring delivery, wrap
+ * the AdaptiveBatchingSensor in a @ref telux::sensor::SensorEventRingAdapter.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class AdaptiveBatchingSensor : public ISensor, public telux::power::ITcuActivityListener {
+ public:
+    using SensorFactory = std::function<std::shared_ptr<ISensor>()>;
+    using Executor = std::function<void(std::function<void()>)>;
+
+    /**
+     * @param [in] factory   Returns a new client of the same sensor on each call
+     * @param [in] config    Adaptation policy
+     * @param [in] executor  Runs the switch tasks, nullptr to use an internal thread
+     */
+    AdaptiveBatchingSensor(SensorFactory factory, const AdaptiveBatchingConfig &config,
+                           Executor executor = nullptr)
+       : factory_(factory)
+       , config_(config)
+       , executor_(executor) {
+        if (!executor_) {
+            worker_ = std::thread(&AdaptiveBatchingSensor::runWorker, this);
+            executor_ = [this](std::function<void()> task) {
+                std::lock_guard<std::mutex> lock(workerMutex_);
+                tasks_.push_back(task);
+                workerCv_.notify_one();
+            };
+        }
+        current_.sensor = factory_();
+        if (current_.sensor) {
+            info_ = current_.sensor->getSensorInfo();
+            current_.proxy = std::make_shared<ClientListener>(*this, 0);
+            current_.sensor->registerListener(current_.proxy);
+            requested_ = current_.sensor->getConfiguration();
+            applied_ = requested_;
+        }
+    }
+
+    ~AdaptiveBatchingSensor() {
+        deactivate();
+        if (current_.sensor) {
+            current_.sensor->deregisterListener(current_.proxy);
+        }
+        if (worker_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(workerMutex_);
+                stopWorker_ = true;
+                workerCv_.notify_one();
+            }
+            worker_.join();
+        }
+    }
+
+    AdaptiveBatchingSensor(const AdaptiveBatchingSensor &) = delete;
+    AdaptiveBatchingSensor &operator=(const AdaptiveBatchingSensor &) = delete;
+
+    SensorInfo getSensorInfo() override {
+        return info_;
+    }
+
+    /**
+     * Sets the sampling rate used when @ref AdaptiveBatchingConfig does not override it. The
+     * batch count is chosen by the policy.
+     */
+    telux::common::Status configure(SensorConfiguration configuration) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (active_) {
+            return telux::common::Status::INVALIDSTATE;
+        }
+        if (configuration.validityMask.test(SensorConfigParams::SAMPLING_RATE)) {
+            requested_.samplingRate = configuration.samplingRate;
+            requested_.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+        }
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * The configuration of the client currently delivering events
+     */
+    SensorConfiguration getConfiguration() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return applied_;
+    }
+
+    telux::common::Status activate() override {
+        std::shared_ptr<ISensor> sensor;
+        SensorConfiguration target;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!current_.sensor) {
+                return telux::common::Status::NOTREADY;
+            }
+            if (active_) {
+                return telux::common::Status::SUCCESS;
+            }
+            sensor = current_.sensor;
+            target = computeTarget();
+        }
+        telux::common::Status status = sensor->configure(target);
+        if (status != telux::common::Status::SUCCESS) {
+            return status;
+        }
+        SensorConfiguration applied = sensor->getConfiguration();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            applied_ = applied;
+            active_ = true;
+        }
+        return sensor->activate();
+    }
+
+    telux::common::Status deactivate() override {
+        Client current, next;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!active_) {
+                return telux::common::Status::SUCCESS;
+            }
+            active_ = false;
+            current = current_;
+            next = next_;
+            next_ = Client();
+            switching_ = false;
+            pending_.clear();
+        }
+        if (next.sensor) {
+            next.sensor->deactivate();
+            next.sensor->deregisterListener(next.proxy);
+        }
+        return current.sensor->deactivate();
+    }
+
+    telux::common::Status enableLowPowerMode() override {
+        return currentSensor() ? currentSensor()->enableLowPowerMode()
+                               : telux::common::Status::NOTREADY;
+    }
+
+    telux::common::Status disableLowPowerMode() override {
+        return currentSensor() ? currentSensor()->disableLowPowerMode()
+                               : telux::common::Status::NOTREADY;
+    }
+
+    telux::common::Status selfTest(SelfTestType selfTestType, SelfTestResultCallback cb) override {
+        return currentSensor() ? currentSensor()->selfTest(selfTestType, cb)
+                               : telux::common::Status::NOTREADY;
+    }
+
+    telux::common::Status registerListener(std::weak_ptr<ISensorEventListener> listener) override {
+        return registerListener(listener, config_.defaultLatencyNs);
+    }
+
+    /**
+     * Register a listener that needs its events within latencyNs of their timestamp while the
+     * device is moving
+     */
+    telux::common::Status registerListener(std::weak_ptr<ISensorEventListener> listener,
+                                           uint64_t latencyNs) {
+        auto target = listener.lock();
+        if (!target || latencyNs == 0) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &entry : listeners_) {
+            if (entry.listener.lock() == target) {
+                entry.latencyNs = latencyNs;
+                evaluate();
+                return telux::common::Status::SUCCESS;
+            }
+        }
+        listeners_.push_back(ListenerEntry{listener, latencyNs});
+        evaluate();
+        return telux::common::Status::SUCCESS;
+    }
+
+    telux::common::Status deregisterListener(std::weak_ptr<ISensorEventListener> listener)
+        override {
+        auto target = listener.lock();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+            if (it->listener.lock() == target) {
+                listeners_.erase(it);
+                evaluate();
+                return telux::common::Status::SUCCESS;
+            }
+        }
+        return telux::common::Status::NOSUCH;
+    }
+
+    /**
+     * Register with @ref telux::power::ITcuActivityManager to receive the TCU activity state
+     */
+    void onTcuActivityStateUpdate(telux::power::TcuActivityState state) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tcuState_ = state;
+        evaluate();
+    }
+
+    AdaptiveBatchingStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        AdaptiveBatchingStats stats = stats_;
+        stats.moving = moving_;
+        return stats;
+    }
+
+ private:
+    struct ListenerEntry {
+        std::weak_ptr<ISensorEventListener> listener;
+        uint64_t latencyNs;
+    };
+
+    class ClientListener : public ISensorEventListener {
+     public:
+        ClientListener(AdaptiveBatchingSensor &owner, uint32_t id) : owner_(owner), id_(id) {
+        }
+
+        void onEvent(std::shared_ptr<std::vector<SensorEvent>> events) override {
+            owner_.onClientEvents(id_, events);
+        }
+
+     private:
+        AdaptiveBatchingSensor &owner_;
+        uint32_t id_;
+    };
+
+    struct Client {
+        std::shared_ptr<ISensor> sensor;
+        std::shared_ptr<ClientListener> proxy;
+        uint32_t id = 0;
+    };
+
+    std::shared_ptr<ISensor> currentSensor() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_.sensor;
+    }
+
+    void onClientEvents(uint32_t id, std::shared_ptr<std::vector<SensorEvent>> events) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!active_ || events->empty()) {
+            return;
+        }
+        if (switching_ && next_.sensor && id == next_.id) {
+            // Held back until the outgoing client has covered the same time, minus the events
+            // it already delivered. If there were any, it has.
+            bool overlap = false;
+            for (auto &event : *events) {
+                if (event.timestamp > lastDeliveredNs_) {
+                    pending_.push_back(event);
+                } else {
+                    ++stats_.overlapDropped;
+                    overlap = true;
+                }
+            }
+            if (overlap || (!pending_.empty() && caughtUp())) {
+                completeSwitch();
+            } else if (!pending_.empty() && pending_.back().timestamp - pending_.front().timestamp
+                       > switchTimeoutNs()) {
+                ++stats_.gapSwitches;
+                completeSwitch();
+            }
+            return;
+        }
+        if (id != current_.id) {
+            return;  // Outgoing client already replaced
+        }
+        if (pending_.empty()) {
+            deliver(events);
+            return;
+        }
+        const uint64_t cutoff = pending_.front().timestamp;
+        size_t keep = 0;
+        while (keep < events->size() && (*events)[keep].timestamp < cutoff) {
+            ++keep;
+        }
+        stats_.overlapDropped += events->size() - keep;
+        if (keep == events->size()) {
+            deliver(events);
+        } else if (keep > 0) {
+            deliver(std::make_shared<std::vector<SensorEvent>>(
+                events->begin(), events->begin() + keep));
+        }
+        if (keep < events->size() || caughtUp()) {
+            completeSwitch();
+        }
+    }
+
+    // Callers hold mutex_. Whether the next event of the outgoing client would not precede the
+    // events held back from the new one.
+    bool caughtUp() const {
+        const uint64_t periodNs = static_cast<uint64_t>(1e9 / applied_.samplingRate);
+        return lastDeliveredNs_ + periodNs >= pending_.front().timestamp;
+    }
+
+    // Callers hold mutex_
+    void deliver(std::shared_ptr<std::vector<SensorEvent>> events) {
+        ++stats_.deliveries;
+        stats_.events += events->size();
+        detectMotion(*events);
+        lastDeliveredNs_ = events->back().timestamp;
+        for (auto &entry : listeners_) {
+            auto listener = entry.listener.lock();
+            if (listener) {
+                listener->onEvent(events);
+            }
+        }
+        evaluate();
+    }
+
+    // Callers hold mutex_. The new client has delivered and the outgoing one has caught up.
+    void completeSwitch() {
+        Client old = current_;
+        current_ = next_;
+        next_ = Client();
+        applied_ = nextConfig_;
+        switching_ = false;
+        ++stats_.switches;
+        lastSwitchNs_ = pending_.empty() ? lastDeliveredNs_ : pending_.front().timestamp;
+        for (auto &entry : listeners_) {
+            auto listener = entry.listener.lock();
+            if (listener) {
+                listener->onConfigurationUpdate(applied_);
+            }
+        }
+        if (!pending_.empty()) {
+            auto events = std::make_shared<std::vector<SensorEvent>>();
+            events->swap(pending_);
+            deliver(events);
+        }
+        executor_([old]() {
+            old.sensor->deactivate();
+            old.sensor->deregisterListener(old.proxy);
+        });
+    }
+
+    // Callers hold mutex_. How long the new client's events are held back for the outgoing
+    // client to deliver its last batch.
+    uint64_t switchTimeoutNs() const {
+        double batchNs = 1e9 * applied_.batchCount / applied_.samplingRate;
+        return 2 * static_cast<uint64_t>(batchNs) + 100000000;
+    }
+
+    // Callers hold mutex_
+    void detectMotion(const std::vector<SensorEvent> &events) {
+        const bool gyro = (info_.type == SensorType::GYROSCOPE
+            || info_.type == SensorType::GYROSCOPE_UNCALIBRATED);
+        const bool uncalibrated = (info_.type == SensorType::ACCELEROMETER_UNCALIBRATED
+            || info_.type == SensorType::GYROSCOPE_UNCALIBRATED);
+
+        for (auto &event : events) {
+            MotionSensorData v = uncalibrated ? event.uncalibrated.data : event.calibrated;
+            if (uncalibrated) {
+                v.x -= event.uncalibrated.bias.x;
+                v.y -= event.uncalibrated.bias.y;
+                v.z -= event.uncalibrated.bias.z;
+            }
+            double magnitude = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            if (windowCount_ == 0) {
+                windowStartNs_ = event.timestamp;
+            }
+            if (lastMotionNs_ == 0) {
+                lastMotionNs_ = event.timestamp;
+            }
+            ++windowCount_;
+            windowSum_ += magnitude;
+            windowSumSq_ += magnitude * magnitude;
+            lastEventNs_ = event.timestamp;
+            if (event.timestamp - windowStartNs_ < config_.motionWindowNs) {
+                continue;
+            }
+            double mean = windowSum_ / windowCount_;
+            double variance = windowSumSq_ / windowCount_ - mean * mean;
+            double metric = gyro ? mean : std::sqrt(variance > 0 ? variance : 0);
+            windowCount_ = 0;
+            windowSum_ = 0;
+            windowSumSq_ = 0;
+
+            if (metric > config_.motionEnterThreshold
+                || (moving_ && metric >= config_.motionExitThreshold)) {
+                moving_ = true;
+                lastMotionNs_ = event.timestamp;
+            } else if (moving_ && event.timestamp - lastMotionNs_ >= config_.stationaryHoldNs) {
+                moving_ = false;
+            }
+        }
+    }
+
+    // Callers hold mutex_
+    SensorConfiguration computeTarget() const {
+        const bool suspended = (tcuState_ == telux::power::TcuActivityState::SUSPEND
+            || tcuState_ == telux::power::TcuActivityState::SHUTDOWN);
+        float rate = requested_.validityMask.test(SensorConfigParams::SAMPLING_RATE)
+            ? requested_.samplingRate : 0.0f;
+        if (moving_ && !suspended && config_.movingRate > 0) {
+            rate = config_.movingRate;
+        } else if ((!moving_ || suspended) && config_.parkedRate > 0) {
+            rate = config_.parkedRate;
+        }
+        rate = supportedRate(rate);
+
+        uint64_t latencyNs = config_.defaultLatencyNs;
+        if (!listeners_.empty()) {
+            latencyNs = UINT64_MAX;
+            for (auto &entry : listeners_) {
+                latencyNs = (entry.latencyNs < latencyNs) ? entry.latencyNs : latencyNs;
+            }
+        }
+        if (!moving_ && config_.parkedLatencyNs > latencyNs) {
+            latencyNs = config_.parkedLatencyNs;
+        }
+        uint32_t maxBatch = info_.maxBatchCountSupported;
+        uint32_t minBatch = (info_.minBatchCountSupported > 0) ? info_.minBatchCountSupported : 1;
+        uint32_t batch = maxBatch;
+        if (!suspended && rate > 0) {
+            double samples = std::floor(latencyNs * 1e-9 * rate);
+            batch = (samples < maxBatch) ? static_cast<uint32_t>(samples) : maxBatch;
+        }
+        batch = (batch / minBatch) * minBatch;
+        if (batch < minBatch) {
+            batch = minBatch;
+        }
+
+        SensorConfiguration target;
+        target.samplingRate = rate;
+        target.batchCount = batch;
+        target.validityMask.set(SensorConfigParams::SAMPLING_RATE);
+        target.validityMask.set(SensorConfigParams::BATCH_COUNT);
+        return target;
+    }
+
+    // Floors rate to a supported sampling rate, as the sensor framework does
+    float supportedRate(float rate) const {
+        float best = 0.0f;
+        float lowest = 0.0f;
+        for (float supported : info_.samplingRates) {
+            if (lowest == 0.0f || supported < lowest) {
+                lowest = supported;
+            }
+            if (supported <= rate && supported > best) {
+                best = supported;
+            }
+        }
+        return (best > 0.0f) ? best : lowest;
+    }
+
+    // Callers hold mutex_. Starts a switch when the target differs from the applied
+    // configuration; switches that increase latency are rate limited.
+    void evaluate() {
+        if (!active_ || switching_) {
+            return;
+        }
+        SensorConfiguration target = computeTarget();
+        if (target.samplingRate == applied_.samplingRate
+            && target.batchCount == applied_.batchCount) {
+            return;
+        }
+        double appliedLatency = applied_.batchCount / applied_.samplingRate;
+        double targetLatency = target.batchCount / target.samplingRate;
+        if (targetLatency > appliedLatency && stats_.switches > 0
+            && lastEventNs_ - lastSwitchNs_ < config_.minSwitchIntervalNs) {
+            return;
+        }
+        switching_ = true;
+        const uint32_t id = ++lastClientId_;
+        executor_([this, target, id]() { startSwitch(target, id); });
+    }
+
+    void startSwitch(SensorConfiguration target, uint32_t id) {
+        Client next;
+        next.sensor = factory_();
+        if (!next.sensor) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            switching_ = false;
+            return;
+        }
+        next.proxy = std::make_shared<ClientListener>(*this, id);
+        next.id = id;
+        next.sensor->configure(target);
+        SensorConfiguration applied = next.sensor->getConfiguration();
+        next.sensor->registerListener(next.proxy);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!active_ || !switching_) {
+                next.sensor->deregisterListener(next.proxy);
+                return;
+            }
+            next_ = next;
+            nextConfig_ = applied;
+            pending_.clear();
+        }
+        next.sensor->activate();
+        {
+            // Deactivated meanwhile
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (next_.id == id || current_.id == id) {
+                return;
+            }
+        }
+        next.sensor->deactivate();
+        next.sensor->deregisterListener(next.proxy);
+    }
+
+    void runWorker() {
+        std::unique_lock<std::mutex> lock(workerMutex_);
+        for (;;) {
+            workerCv_.wait(lock, [this] { return stopWorker_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            auto task = tasks_.front();
+            tasks_.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    const SensorFactory factory_;
+    const AdaptiveBatchingConfig config_;
+    Executor executor_;
+    SensorInfo info_;
+
+    mutable std::mutex mutex_;
+    bool active_ = false;
+    SensorConfiguration requested_;
+    SensorConfiguration applied_;
+    std::vector<ListenerEntry> listeners_;
+    Client current_;
+    Client next_;
+    SensorConfiguration nextConfig_;
+    bool switching_ = false;
+    uint32_t lastClientId_ = 0;
+    std::vector<SensorEvent> pending_;
+    telux::power::TcuActivityState tcuState_ = telux::power::TcuActivityState::UNKNOWN;
+    // Considered moving until the first stationaryHoldNs of events show otherwise
+    bool moving_ = true;
+    uint64_t lastMotionNs_ = 0;
+    uint64_t lastEventNs_ = 0;
+    uint64_t lastDeliveredNs_ = 0;
+    uint64_t lastSwitchNs_ = 0;
+    uint64_t windowStartNs_ = 0;
+    uint64_t windowCount_ = 0;
+    double windowSum_ = 0;
+    double windowSumSq_ = 0;
+    AdaptiveBatchingStats stats_;
+
+    std::thread worker_;
+    std::mutex workerMutex_;
+    std::condition_variable workerCv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopWorker_ = false;
+};
+
+/** @} */ /* end_addtogroup telematics_sensor_control */
+}  // namespace sensor
+}  // namespace telux
+
+#endif  // TELUX_SENSOR_ADAPTIVEBATCHINGSENSOR_HPP
@@ -0,0 +1,575 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       ImuAligner.hpp
+ *
+ * @brief      ImuAligner combines the event streams of an accelerometer and a gyroscope, each
+ *             with its own sampling rate, batch count and timestamps, into time aligned IMU
+ *             frames at a fixed rate.
+ */
+
+#ifndef TELUX_SENSOR_IMUALIGNER_HPP
+#define TELUX_SENSOR_IMUALIGNER_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/sensor/Sensor.hpp>
+#include <telux/sensor/SensorDefines.hpp>
+#include <telux/sensor/SensorEventRing.hpp>
+#include <telux/sensor/SensorEventRingAdapter.hpp>
+
+namespace telux {
+namespace sensor {
+
+/** @addtogroup telematics_sensor_control
+ * @{ */
+
+/**
+ * Input streams of an @ref telux::sensor::ImuAligner
+ */
+enum ImuChannel {
+    IMU_ACCELEROMETER,  /**< @ref SensorType::ACCELEROMETER or ACCELEROMETER_UNCALIBRATED */
+    IMU_GYROSCOPE,      /**< @ref SensorType::GYROSCOPE or GYROSCOPE_UNCALIBRATED */
+    IMU_CHANNEL_COUNT
+};
+
+/**
+ * How a channel value is computed at a frame timestamp from the samples around it
+ */
+enum class ImuInterpolation {
+    NEAREST,  /**< Value of the closest sample */
+    LINEAR,   /**< Linear between the samples before and after */
+    CUBIC,    /**< Cubic Hermite over two samples on each side, one more sample of latency */
+};
+
+/**
+ * Time aligned IMU sample
+ */
+struct ImuFrame {
+    /** Frame time on the output grid, nanosecond since boot-up */
+    uint64_t timestamp;
+    /** Acceleration, bias compensated for an uncalibrated accelerometer */
+    MotionSensorData acceleration;
+    /** Angular rate, bias compensated for an uncalibrated gyroscope */
+    MotionSensorData angularRate;
+    /**
+     * True if the frame was emitted on the latency bound before every channel had a sample
+     * after it; such channels hold their last value.
+     */
+    bool late;
+};
+
+/**
+ * Configuration of an @ref telux::sensor::ImuAligner
+ */
+struct ImuAlignerConfig {
+    /** Frame rate in Hz. Frame timestamps are multiples of the frame period. */
+    float outputRate = 100.0f;
+    /** Interpolation used for every channel */
+    ImuInterpolation interpolation = ImuInterpolation::LINEAR;
+    /**
+     * A frame is emitted at the latest when the newest input sample is maxLatencyNs past it,
+     * even if a channel has not caught up
+     */
+    uint64_t maxLatencyNs = 50000000;
+    /** Samples buffered per channel, the oldest are dropped when full */
+    uint32_t bufferSize = 256;
+};
+
+/**
+ * Input statistics of one channel
+ */
+struct ImuChannelStats {
+    /** Samples accepted */
+    uint64_t samples = 0;
+    /** Samples dropped, not newer than the previous one or the buffer was full */
+    uint64_t dropped = 0;
+    /** Mean interval between samples */
+    double meanPeriodNs = 0;
+    /** Standard deviation of the interval between samples */
+    double jitterNs = 0;
+    /** Largest deviation of an interval from the mean at that time */
+    double maxJitterNs = 0;
+};
+
+/**
+ * Statistics of an @ref telux::sensor::ImuAligner. The latency of a frame is how far the newest
+ * input sample was past the frame timestamp when the frame was emitted.
+ */
+struct ImuAlignerStats {
+    uint64_t frames = 0;
+    /** Frames emitted on the latency bound, see @ref ImuFrame::late */
+    uint64_t lateFrames = 0;
+    uint64_t minLatencyNs = 0;
+    uint64_t maxLatencyNs = 0;
+    double meanLatencyNs = 0;
+    ImuChannelStats channels[IMU_CHANNEL_COUNT];
+};
+
+/**
+ * @brief ImuAligner subscribes to an accelerometer and a gyroscope and emits IMU frames at a
+ * fixed rate, interpolating each channel at the frame timestamps.
+ *
+ * A frame is emitted once every channel has samples around its timestamp, so the latency is
+ * set by the slowest channel (its sample period and batching), and bounded by
+ * @ref ImuAlignerConfig::maxLatencyNs plus one input batch.
+ *
+ * Channels are fed by @ref attach, which registers a listener on a sensor or on the
+ * @ref telux::sensor::SensorEventRingAdapter of a sensor, or directly with @ref addEvents. The
+ * frame callback is invoked on the thread that delivered the input completing the frame, with
+ * the aligner locked; it has the same constraints as
+ * @ref telux::sensor::ISensorEventListener::onEvent.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class ImuAligner {
+ public:
+    using FrameCallback = std::function<void(const ImuFrame &frame)>;
+
+    ImuAligner(const ImuAlignerConfig &config, FrameCallback callback)
+       : config_(config)
+       , callback_(callback)
+       , periodNs_(1e9 / config.outputRate) {
+        uint32_t size = 4u;
+        while (size < config_.bufferSize) {
+            size <<= 1;
+        }
+        for (auto &channel : channels_) {
+            channel.samples.resize(size);
+            channel.mask = size - 1;
+        }
+    }
+
+    /**
+     * Deregisters the listeners added by @ref attach. Sensors attached should be deactivated
+     * before the aligner is destroyed.
+     */
+    ~ImuAligner() {
+        for (auto &channel : channels_) {
+            if (channel.sensor && channel.listener) {
+                channel.sensor->deregisterListener(channel.listener);
+            }
+            if (channel.adapter && channel.listener) {
+                channel.adapter->deregisterListener(channel.listener);
+            }
+        }
+    }
+
+    ImuAligner(const ImuAligner &) = delete;
+    ImuAligner &operator=(const ImuAligner &) = delete;
+
+    /**
+     * Feeds channel from the event vectors of sensor. The sensor type must match the channel.
+     * Attach before activating the sensor.
+     *
+     * @returns status of the request - @ref telux::common::Status
+     */
+    telux::common::Status attach(ImuChannel channel, std::shared_ptr<ISensor> sensor) {
+        if (channel >= IMU_CHANNEL_COUNT || sensor == nullptr) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        telux::common::Status status = enableChannel(channel, sensor->getSensorInfo().type);
+        if (status != telux::common::Status::SUCCESS) {
+            return status;
+        }
+        auto listener = std::make_shared<ChannelListener>(*this, channel, nullptr);
+        status = sensor->registerListener(listener);
+        if (status != telux::common::Status::SUCCESS) {
+            return status;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        channels_[channel].sensor = sensor;
+        channels_[channel].listener = listener;
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Feeds channel from the ring of adapter. The type of the adapted sensor must match the
+     * channel. Attach before activating the sensor.
+     *
+     * @returns status of the request - @ref telux::common::Status
+     */
+    telux::common::Status attach(ImuChannel channel,
+                                 std::shared_ptr<SensorEventRingAdapter> adapter) {
+        if (channel >= IMU_CHANNEL_COUNT || adapter == nullptr || adapter->getSensor() == nullptr) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        telux::common::Status status = enableChannel(channel,
+            adapter->getSensor()->getSensorInfo().type);
+        if (status != telux::common::Status::SUCCESS) {
+            return status;
+        }
+        auto listener = std::make_shared<ChannelListener>(*this, channel, adapter->getEventRing());
+        status = adapter->registerListener(listener);
+        if (status != telux::common::Status::SUCCESS) {
+            return status;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        channels_[channel].adapter = adapter;
+        channels_[channel].listener = listener;
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Declares that events of type will be fed to channel with @ref addEvents. Frames are only
+     * emitted once every enabled channel has samples.
+     *
+     * @returns status of the request - @ref telux::common::Status
+     */
+    telux::common::Status enableChannel(ImuChannel channel, SensorType type) {
+        bool accel = (type == SensorType::ACCELEROMETER
+            || type == SensorType::ACCELEROMETER_UNCALIBRATED);
+        bool gyro = (type == SensorType::GYROSCOPE || type == SensorType::GYROSCOPE_UNCALIBRATED);
+        if ((channel == IMU_ACCELEROMETER && !accel) || (channel == IMU_GYROSCOPE && !gyro)) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (channels_[channel].enabled) {
+            return telux::common::Status::ALREADY;
+        }
+        channels_[channel].enabled = true;
+        channels_[channel].uncalibrated = (type == SensorType::ACCELEROMETER_UNCALIBRATED
+            || type == SensorType::GYROSCOPE_UNCALIBRATED);
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Adds samples of channel, in timestamp order, and emits the frames they complete.
+     */
+    void addEvents(ImuChannel channel, const SensorEvent *events, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Channel &ch = channels_[channel];
+        if (!ch.enabled) {
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            ch.add(events[i], stats_.channels[channel]);
+        }
+        process();
+    }
+
+    ImuAlignerStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+ private:
+    class ChannelListener;
+
+    struct Sample {
+        uint64_t timestamp;
+        float value[3];
+    };
+
+    struct Channel {
+        bool enabled = false;
+        bool uncalibrated = false;
+        std::vector<Sample> samples;
+        uint32_t mask = 0;
+        uint64_t first = 0;  // Index of the oldest sample held
+        uint64_t end = 0;    // Index past the newest sample
+        std::shared_ptr<ISensor> sensor;
+        std::shared_ptr<SensorEventRingAdapter> adapter;
+        std::shared_ptr<ChannelListener> listener;
+
+        size_t size() const {
+            return static_cast<size_t>(end - first);
+        }
+
+        const Sample &at(size_t i) const {
+            return samples[(first + i) & mask];
+        }
+
+        const Sample &newest() const {
+            return samples[(end - 1) & mask];
+        }
+
+        void add(const SensorEvent &event, ImuChannelStats &stats) {
+            if (size() > 0 && event.timestamp <= newest().timestamp) {
+                ++stats.dropped;
+                return;
+            }
+            if (size() > 0) {
+                updateJitter(event.timestamp - newest().timestamp, stats);
+            }
+            if (size() == samples.size()) {
+                ++first;
+                ++stats.dropped;
+            }
+            Sample &sample = samples[end & mask];
+            const MotionSensorData &data = uncalibrated ? event.uncalibrated.data
+                                                        : event.calibrated;
+            sample.timestamp = event.timestamp;
+            sample.value[0] = data.x;
+            sample.value[1] = data.y;
+            sample.value[2] = data.z;
+            if (uncalibrated) {
+                sample.value[0] -= event.uncalibrated.bias.x;
+                sample.value[1] -= event.uncalibrated.bias.y;
+                sample.value[2] -= event.uncalibrated.bias.z;
+            }
+            ++end;
+            ++stats.samples;
+        }
+
+        // Welford's running mean and variance of the sample interval
+        static void updateJitter(uint64_t periodNs, ImuChannelStats &stats) {
+            uint64_t n = stats.samples;  // Intervals so far, including this one
+            double period = static_cast<double>(periodNs);
+            if (n >= 2) {
+                double deviation = std::fabs(period - stats.meanPeriodNs);
+                if (deviation > stats.maxJitterNs) {
+                    stats.maxJitterNs = deviation;
+                }
+            }
+            double delta = period - stats.meanPeriodNs;
+            stats.meanPeriodNs += delta / n;
+            double m2 = stats.jitterNs * stats.jitterNs * (n - 1) + delta
+                * (period - stats.meanPeriodNs);
+            stats.jitterNs = std::sqrt(m2 / n);
+        }
+
+        // Drops samples no longer needed for frames at or after t, keeping two before t
+        void trim(uint64_t t) {
+            while (size() > 3 && at(2).timestamp <= t) {
+                ++first;
+            }
+        }
+
+        // Index of the first sample at or after t, size() if none
+        size_t after(uint64_t t) const {
+            size_t i = 0;
+            while (i < size() && at(i).timestamp < t) {
+                ++i;
+            }
+            return i;
+        }
+    };
+
+    // Reads a sensor into one channel, from the event vectors or the ring of an adapter
+    class ChannelListener : public ISensorEventListener, public ISensorEventRingListener {
+     public:
+        ChannelListener(ImuAligner &aligner, ImuChannel channel,
+                        std::shared_ptr<SensorEventRing> ring)
+           : aligner_(aligner)
+           , channel_(channel)
+           , ring_(ring) {
+            if (ring_) {
+                cursor_.reset(new SensorEventRing::Cursor(*ring_));
+            }
+        }
+
+        void onEvent(std::shared_ptr<std::vector<SensorEvent>> events) override {
+            aligner_.addEvents(channel_, events->data(), events->size());
+        }
+
+        void onEventRingUpdate(uint64_t head) override {
+            SensorEvent events[64];
+            size_t count;
+            if (!cursor_) {
+                return;
+            }
+            while ((count = cursor_->read(events, 64)) > 0) {
+                aligner_.addEvents(channel_, events, count);
+            }
+        }
+
+     private:
+        ImuAligner &aligner_;
+        ImuChannel channel_;
+        std::shared_ptr<SensorEventRing> ring_;
+        std::unique_ptr<SensorEventRing::Cursor> cursor_;
+    };
+
+    uint64_t frameTime(uint64_t k) const {
+        return start_ + static_cast<uint64_t>(std::llround(k * periodNs_));
+    }
+
+    // Callers hold mutex_
+    void process() {
+        uint64_t newest = 0;
+        uint64_t oldest = 0;
+        for (auto &ch : channels_) {
+            if (!ch.enabled) {
+                continue;
+            }
+            if (ch.size() == 0) {
+                return;
+            }
+            if (ch.newest().timestamp > newest) {
+                newest = ch.newest().timestamp;
+            }
+            if (ch.at(0).timestamp > oldest) {
+                oldest = ch.at(0).timestamp;
+            }
+        }
+        if (!started_) {
+            // First frame on the grid after every channel has started
+            start_ = static_cast<uint64_t>(
+                std::llround(std::ceil(oldest / periodNs_) * periodNs_));
+            next_ = 0;
+            started_ = true;
+        }
+        const size_t lookahead = (config_.interpolation == ImuInterpolation::CUBIC) ? 2 : 1;
+
+        for (;;) {
+            uint64_t t = frameTime(next_);
+            bool ready = true;
+            for (auto &ch : channels_) {
+                if (ch.enabled) {
+                    ch.trim(t);
+                    size_t i = ch.after(t);
+                    // An exact hit needs no later sample
+                    if (!(i < ch.size() && ch.at(i).timestamp == t) && i + lookahead > ch.size()) {
+                        ready = false;
+                    }
+                }
+            }
+            if (!ready && (newest <= t || newest - t <= config_.maxLatencyNs)) {
+                return;
+            }
+
+            ImuFrame frame;
+            frame.timestamp = t;
+            frame.late = !ready;
+            interpolate(channels_[IMU_ACCELEROMETER], t, frame.acceleration);
+            interpolate(channels_[IMU_GYROSCOPE], t, frame.angularRate);
+            record(newest - t, frame.late);
+            if (callback_) {
+                callback_(frame);
+            }
+            ++next_;
+        }
+    }
+
+    void interpolate(const Channel &ch, uint64_t t, MotionSensorData &out) const {
+        float value[3] = {0.0f, 0.0f, 0.0f};
+
+        if (ch.enabled && ch.size() > 0) {
+            size_t i = ch.after(t);
+            if (i == ch.size()) {
+                // Late frame, hold the last value
+                copy(ch.newest().value, value);
+            } else if (ch.at(i).timestamp == t || i == 0) {
+                copy(ch.at(i).value, value);
+            } else {
+                const Sample &s1 = ch.at(i - 1);
+                const Sample &s2 = ch.at(i);
+                double h = static_cast<double>(s2.timestamp - s1.timestamp);
+                double s = (t - s1.timestamp) / h;
+                switch (config_.interpolation) {
+                    case ImuInterpolation::NEAREST:
+                        copy((s < 0.5) ? s1.value : s2.value, value);
+                        break;
+                    case ImuInterpolation::LINEAR:
+                        for (int k = 0; k < 3; ++k) {
+                            value[k] = static_cast<float>(s1.value[k]
+                                + s * (s2.value[k] - s1.value[k]));
+                        }
+                        break;
+                    case ImuInterpolation::CUBIC:
+                        hermite(ch, i, s, h, value);
+                        break;
+                }
+            }
+        }
+        out.x = value[0];
+        out.y = value[1];
+        out.z = value[2];
+    }
+
+    // Cubic Hermite between samples i - 1 and i with finite difference tangents, which suit
+    // the uneven sample spacing; the tangent falls back to the chord at the buffer edges.
+    static void hermite(const Channel &ch, size_t i, double s, double h, float *value) {
+        const Sample &s1 = ch.at(i - 1);
+        const Sample &s2 = ch.at(i);
+        const Sample *s0 = (i >= 2) ? &ch.at(i - 2) : nullptr;
+        const Sample *s3 = (i + 1 < ch.size()) ? &ch.at(i + 1) : nullptr;
+        double s2s = s * s;
+        double s3s = s2s * s;
+        double h00 = 2 * s3s - 3 * s2s + 1;
+        double h10 = s3s - 2 * s2s + s;
+        double h01 = -2 * s3s + 3 * s2s;
+        double h11 = s3s - s2s;
+
+        for (int k = 0; k < 3; ++k) {
+            double chord = s2.value[k] - s1.value[k];
+            double m1 = s0 ? (s2.value[k] - s0->value[k]) * h
+                / static_cast<double>(s2.timestamp - s0->timestamp) : chord;
+            double m2 = s3 ? (s3->value[k] - s1.value[k]) * h
+                / static_cast<double>(s3->timestamp - s1.timestamp) : chord;
+            value[k] = static_cast<float>(h00 * s1.value[k] + h10 * m1 + h01 * s2.value[k]
+                + h11 * m2);
+        }
+    }
+
+    static void copy(const float *from, float *to) {
+        to[0] = from[0];
+        to[1] = from[1];
+        to[2] = from[2];
+    }
+
+    void record(uint64_t latencyNs, bool late) {
+        if (stats_.frames == 0 || latencyNs < stats_.minLatencyNs) {
+            stats_.minLatencyNs = latencyNs;
+        }
+        if (latencyNs > stats_.maxLatencyNs) {
+            stats_.maxLatencyNs = latencyNs;
+        }
+        ++stats_.frames;
+        stats_.meanLatencyNs += (latencyNs - stats_.meanLatencyNs) / stats_.frames;
+        if (late) {
+            ++stats_.lateFrames;
+        }
+    }
+
+    const ImuAlignerConfig config_;
+    const FrameCallback callback_;
+    const double periodNs_;
+    mutable std::mutex mutex_;
+    Channel channels_[IMU_CHANNEL_COUNT];
+    bool started_ = false;
+    uint64_t start_ = 0;
+    uint64_t next_ = 0;
+    ImuAlignerStats stats_;
+};
+
+/** @} */ /* end_addtogroup telematics_sensor_control */
+}  // namespace sensor
+}  // namespace telux
+
+#endif  // TELUX_SENSOR_IMUALIGNER_HPP
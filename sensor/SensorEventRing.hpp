@@ -0,0 +1,337 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       SensorEventRing.hpp
+ *
+ * @brief      SensorEventRing is a lock-free single producer, multi consumer ring of sensor
+ *             events, used to deliver the events of a sensor through a ring instead of a
+ *             vector per batch (see @ref telux::sensor::SensorEventRingAdapter).
+ */
+
+#ifndef TELUX_SENSOR_SENSOREVENTRING_HPP
+#define TELUX_SENSOR_SENSOREVENTRING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include <telux/sensor/SensorDefines.hpp>
+
+namespace telux {
+namespace sensor {
+
+/** @addtogroup telematics_sensor_control
+ * @{ */
+
+/**
+ * @brief SensorEventRing holds the most recent sensor events of a sensor, each identified by a
+ * sequence number that increments by one per event.
+ *
+ * The sensor framework is the only writer. Any number of readers each keep their own
+ * @ref telux::sensor::SensorEventRing::Cursor and copy events out without taking a lock or
+ * allocating memory; readers do not slow down the writer or each other. When a reader falls
+ * more than the capacity behind, the oldest events are overwritten and the cursor counts them
+ * as overruns.
+ *
+ * Readers copy events out while the writer may be overwriting them and discard the copies
+ * the writer may have touched, as with a sequence lock, so the writer never waits.
+ *
+ * The ring occupies one contiguous block of memory (@ref requiredSize) of plain data and
+ * lock-free atomic counters, so it can be placed in memory shared between processes.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class SensorEventRing {
+ public:
+    /**
+     * Reads events of a ring in sequence order. A cursor is used by one thread at a time.
+     */
+    class Cursor {
+     public:
+        /**
+         * Creates a cursor positioned at the current head of ring, the first event read is the
+         * next one written.
+         */
+        explicit Cursor(const SensorEventRing &ring)
+           : ring_(&ring)
+           , next_(ring.getHead()) {
+        }
+
+        /**
+         * Copies up to maxEvents unread events to events.
+         *
+         * @returns number of events copied
+         */
+        size_t read(SensorEvent *events, size_t maxEvents) {
+            size_t count = 0;
+
+            while (count < maxEvents) {
+                uint64_t position = next_;
+                count += ring_->load(next_, events + count, maxEvents - count, overruns_);
+                if (next_ == position) {
+                    break;
+                }
+            }
+            return count;
+        }
+
+        /**
+         * Calls fn(const SensorEvent &) for each unread event, up to maxEvents.
+         *
+         * @returns number of events passed to fn
+         */
+        template <typename F>
+        size_t forEach(F fn, size_t maxEvents = SIZE_MAX) {
+            SensorEvent events[CHUNK];
+            size_t count = 0;
+
+            while (count < maxEvents) {
+                size_t max = (maxEvents - count < CHUNK) ? maxEvents - count : CHUNK;
+                uint64_t position = next_;
+                size_t copied = ring_->load(next_, events, max, overruns_);
+                if (next_ == position) {
+                    break;
+                }
+                for (size_t i = 0; i < copied; ++i) {
+                    fn(events[i]);
+                }
+                count += copied;
+            }
+            return count;
+        }
+
+        /**
+         * Number of events written but not read yet, including those already overwritten.
+         */
+        uint64_t available() const {
+            return ring_->getHead() - next_;
+        }
+
+        /**
+         * Sequence number of the next event to read.
+         */
+        uint64_t getPosition() const {
+            return next_;
+        }
+
+        /**
+         * Number of events this cursor lost because they were overwritten before being read.
+         */
+        uint64_t getOverruns() const {
+            return overruns_;
+        }
+
+        /**
+         * Moves to the oldest event still held by the ring.
+         */
+        void seekOldest() {
+            uint64_t head = ring_->getHead();
+            next_ = (head > ring_->capacity_) ? head - ring_->capacity_ : 0;
+        }
+
+        /**
+         * Moves to the head, dropping all unread events without counting them as overruns.
+         */
+        void seekHead() {
+            next_ = ring_->getHead();
+        }
+
+     private:
+        static constexpr size_t CHUNK = 32;
+
+        const SensorEventRing *ring_;
+        uint64_t next_;
+        uint64_t overruns_ = 0;
+    };
+
+    /**
+     * Number of bytes needed for a ring of capacity events, capacity is rounded up to a power
+     * of two.
+     */
+    static size_t requiredSize(uint32_t capacity) {
+        return sizeof(SensorEventRing) + roundCapacity(capacity) * sizeof(SensorEvent);
+    }
+
+    /**
+     * Creates an empty ring in memory, which must be at least @ref requiredSize bytes and
+     * 8 byte aligned. The memory is owned by the caller and must outlive the ring.
+     */
+    static SensorEventRing *create(void *memory, uint32_t capacity) {
+        SensorEventRing *ring = new (memory) SensorEventRing(roundCapacity(capacity));
+        std::memset(ring->slots(), 0, ring->capacity_ * sizeof(SensorEvent));
+        return ring;
+    }
+
+    /**
+     * Returns the ring created with @ref create in memory, e.g. after mapping it in another
+     * process, or nullptr if memory does not hold a ring.
+     */
+    static SensorEventRing *attach(void *memory) {
+        SensorEventRing *ring = static_cast<SensorEventRing *>(memory);
+        return (ring->magic_ == MAGIC) ? ring : nullptr;
+    }
+
+    /**
+     * Creates a ring in memory allocated from the heap.
+     */
+    static std::shared_ptr<SensorEventRing> create(uint32_t capacity) {
+        void *memory = ::operator new(requiredSize(capacity));
+        return std::shared_ptr<SensorEventRing>(
+            create(memory, capacity), [](SensorEventRing *ring) { ::operator delete(ring); });
+    }
+
+    SensorEventRing(const SensorEventRing &) = delete;
+    SensorEventRing &operator=(const SensorEventRing &) = delete;
+
+    /**
+     * Number of events the ring holds.
+     */
+    uint32_t getCapacity() const {
+        return capacity_;
+    }
+
+    /**
+     * Sequence number of the next event to be written, i.e. the number of events written so
+     * far.
+     */
+    uint64_t getHead() const {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Appends count events. Only one thread may write to a ring. The events become visible to
+     * readers together once publish returns.
+     */
+    void publish(const SensorEvent *events, size_t count) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+
+        // Readers that copied a slot this batch rewrites see writing_ past it, see load()
+        writing_.store(head + count, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        if (count > capacity_) {
+            events += count - capacity_;
+            head += count - capacity_;
+            count = capacity_;
+        }
+        copy(head, count, [this, events](size_t slot, size_t offset, size_t n) {
+            std::memcpy(slots() + slot, events + offset, n * sizeof(SensorEvent));
+        });
+        head_.store(head + count, std::memory_order_release);
+    }
+
+ private:
+    static constexpr uint32_t MAGIC = 0x53455652u;
+
+    explicit SensorEventRing(uint32_t capacity)
+       : magic_(MAGIC)
+       , capacity_(capacity)
+       , mask_(capacity - 1) {
+    }
+
+    static uint32_t roundCapacity(uint32_t capacity) {
+        uint32_t size = 2u;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    SensorEvent *slots() {
+        return reinterpret_cast<SensorEvent *>(this + 1);
+    }
+
+    const SensorEvent *slots() const {
+        return reinterpret_cast<const SensorEvent *>(this + 1);
+    }
+
+    // Calls fn(slot, offset, n) for the at most two contiguous runs of slots holding count
+    // events from sequence first on
+    template <typename F>
+    void copy(uint64_t first, size_t count, F fn) const {
+        size_t slot = static_cast<size_t>(first & mask_);
+        size_t run = (count < capacity_ - slot) ? count : capacity_ - slot;
+        fn(slot, 0, run);
+        if (run < count) {
+            fn(0, run, count - run);
+        }
+    }
+
+    // Copies up to maxEvents events from sequence next on, advances next past the events
+    // copied and the ones overwritten before they could be copied, and returns the number of
+    // events copied. The copy may race with publish(); rather than checking each event, the
+    // events below writing_ - capacity_ after the copy are the ones that may have been
+    // rewritten meanwhile and are dropped.
+    size_t load(uint64_t &next, SensorEvent *events, size_t maxEvents, uint64_t &overruns) const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+
+        if (head - next > capacity_) {
+            overruns += head - capacity_ - next;
+            next = head - capacity_;
+        }
+        size_t count = (head - next < maxEvents) ? static_cast<size_t>(head - next) : maxEvents;
+        copy(next, count, [this, events](size_t slot, size_t offset, size_t n) {
+            std::memcpy(events + offset, slots() + slot, n * sizeof(SensorEvent));
+        });
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t writing = writing_.load(std::memory_order_relaxed);
+
+        size_t lost = 0;
+        if (writing > capacity_ && writing - capacity_ > next) {
+            lost = (writing - capacity_ - next < count)
+                ? static_cast<size_t>(writing - capacity_ - next) : count;
+            std::memmove(events, events + lost, (count - lost) * sizeof(SensorEvent));
+        }
+        overruns += lost;
+        next += count;
+        return count - lost;
+    }
+
+    // The layout fields and the counters written per batch are kept on separate cache lines
+    uint32_t magic_;
+    uint32_t capacity_;
+    uint32_t mask_;
+    char pad0_[52];
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> writing_{0};
+    char pad1_[48];
+};
+
+constexpr uint32_t SensorEventRing::MAGIC;
+constexpr size_t SensorEventRing::Cursor::CHUNK;
+
+/** @} */ /* end_addtogroup telematics_sensor_control */
+}  // namespace sensor
+}  // namespace telux
+
+#endif  // TELUX_SENSOR_SENSOREVENTRING_HPP
@@ -0,0 +1,229 @@
+/*
+ *  Copyright (c) 2021 The Linux Foundation. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *    * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *  WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *  OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file       SensorEventRingAdapter.hpp
+ *
+ * @brief      SensorEventRingAdapter delivers the events of a sensor to its listeners through a
+ *             SensorEventRing instead of a vector per batch and listener.
+ */
+
+#ifndef TELUX_SENSOR_SENSOREVENTRINGADAPTER_HPP
+#define TELUX_SENSOR_SENSOREVENTRINGADAPTER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <telux/common/CommonDefines.hpp>
+#include <telux/sensor/Sensor.hpp>
+#include <telux/sensor/SensorDefines.hpp>
+#include <telux/sensor/SensorEventRing.hpp>
+
+namespace telux {
+namespace sensor {
+
+/** @addtogroup telematics_sensor_control
+ * @{ */
+
+/**
+ * @brief Listener of a @ref telux::sensor::SensorEventRingAdapter
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class ISensorEventRingListener {
+ public:
+    /**
+     * This function is called when new events have been written to the ring of the adapter,
+     * up to the sequence number head (excluded). The listener reads them with its own
+     * @ref telux::sensor::SensorEventRing::Cursor. The same constraints as for
+     * @ref telux::sensor::ISensorEventListener::onEvent apply, and the listener must not
+     * register or deregister ring listeners from this function.
+     *
+     * @param [in] head - Sequence number of the next event to be written to the ring
+     */
+    virtual void onEventRingUpdate(uint64_t head) {
+    }
+
+    /**
+     * Destructor of ISensorEventRingListener
+     */
+    virtual ~ISensorEventRingListener() {
+    }
+};
+
+/**
+ * @brief SensorEventRingAdapter registers a single listener on a sensor, appends each batch
+ * the sensor delivers to a @ref telux::sensor::SensorEventRing and notifies its own listeners
+ * with @ref telux::sensor::ISensorEventRingListener::onEventRingUpdate, on the sensor's event
+ * delivery thread.
+ *
+ * The sensor builds one event vector per batch for the adapter, whatever the number of ring
+ * listeners, and the listeners copy the events out of the ring without allocating. Any
+ * @ref telux::sensor::ISensor can be adapted, e.g. one obtained from
+ * @ref telux::sensor::ISensorManager::getSensor or an
+ * @ref telux::sensor::AdaptiveBatchingSensor; the sensor itself is used as before to
+ * configure and activate it. Configuration updates are not relayed, listeners interested in
+ * them register an @ref telux::sensor::ISensorEventListener on the sensor.
+ *
+ * The capacity should cover the events produced while the slowest listener is not reading,
+ * e.g. a few batches. Events overwritten before a listener reads them are reported by
+ * @ref telux::sensor::SensorEventRing::Cursor::getOverruns.
+ *
+ * @note Eval: This is a new API and is being evaluated. It is subject to change and
+ *             could break backwards compatibility.
+ */
+class SensorEventRingAdapter {
+ public:
+    /**
+     * @param [in] sensor    Sensor whose events are delivered through the ring
+     * @param [in] capacity  Number of events the ring holds, rounded up to a power of two
+     */
+    SensorEventRingAdapter(std::shared_ptr<ISensor> sensor, uint32_t capacity)
+       : sensor_(sensor)
+       , ring_(SensorEventRing::create(capacity)) {
+        if (sensor_) {
+            proxy_ = std::make_shared<SensorListener>(*this);
+            sensor_->registerListener(proxy_);
+        }
+    }
+
+    /**
+     * Deregisters from the sensor, which should be deactivated before the adapter is
+     * destroyed.
+     */
+    ~SensorEventRingAdapter() {
+        if (sensor_) {
+            sensor_->deregisterListener(proxy_);
+        }
+    }
+
+    SensorEventRingAdapter(const SensorEventRingAdapter &) = delete;
+    SensorEventRingAdapter &operator=(const SensorEventRingAdapter &) = delete;
+
+    /**
+     * The adapted sensor
+     */
+    std::shared_ptr<ISensor> getSensor() const {
+        return sensor_;
+    }
+
+    /**
+     * The ring the sensor events are delivered through
+     */
+    std::shared_ptr<SensorEventRing> getEventRing() const {
+        return ring_;
+    }
+
+    /**
+     * Register a listener notified when events are written to the ring
+     *
+     * @param [in] listener - Pointer of ISensorEventRingListener object
+     *
+     * @returns status of the request - @ref telux::common::Status
+     */
+    telux::common::Status registerListener(std::weak_ptr<ISensorEventRingListener> listener) {
+        auto target = listener.lock();
+        if (target == nullptr) {
+            return telux::common::Status::INVALIDPARAM;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &weak : listeners_) {
+            if (weak.lock() == target) {
+                return telux::common::Status::ALREADY;
+            }
+        }
+        listeners_.push_back(listener);
+        return telux::common::Status::SUCCESS;
+    }
+
+    /**
+     * Deregister a listener registered with @ref registerListener
+     *
+     * @param [in] listener - Pointer of ISensorEventRingListener object
+     *
+     * @returns status of the request - @ref telux::common::Status
+     */
+    telux::common::Status deregisterListener(std::weak_ptr<ISensorEventRingListener> listener) {
+        auto target = listener.lock();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+            if (it->lock() == target) {
+                listeners_.erase(it);
+                return telux::common::Status::SUCCESS;
+            }
+        }
+        return telux::common::Status::NOSUCH;
+    }
+
+ private:
+    class SensorListener : public ISensorEventListener {
+     public:
+        explicit SensorListener(SensorEventRingAdapter &owner) : owner_(owner) {
+        }
+
+        void onEvent(std::shared_ptr<std::vector<SensorEvent>> events) override {
+            owner_.onSensorEvents(*events);
+        }
+
+     private:
+        SensorEventRingAdapter &owner_;
+    };
+
+    // The ring has a single writer; the lock also serializes a sensor that delivers batches
+    // from more than one thread
+    void onSensorEvents(const std::vector<SensorEvent> &events) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (events.empty()) {
+            return;
+        }
+        ring_->publish(events.data(), events.size());
+        uint64_t head = ring_->getHead();
+        for (auto &weak : listeners_) {
+            auto listener = weak.lock();
+            if (listener) {
+                listener->onEventRingUpdate(head);
+            }
+        }
+    }
+
+    std::shared_ptr<ISensor> sensor_;
+    std::shared_ptr<SensorEventRing> ring_;
+    std::shared_ptr<SensorListener> proxy_;
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<ISensorEventRingListener>> listeners_;
+};
+
+/** @} */ /* end_addtogroup telematics_sensor_control */
+}  // namespace sensor
+}  // namespace telux
+
+#endif  // TELUX_SENSOR_SENSOREVENTRINGADAPTER_HPP
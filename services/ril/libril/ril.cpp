@@ -55,6 +55,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <assert.h>
 #include <netinet/in.h>
 #include <ril_event.h>
@@ -96,6 +97,9 @@ namespace android {
 
 #define PROPERTY_RIL_IMPL "gsm.version.ril-impl"
 
+// Coalesce unsolicited responses into a single write when the client is slow
+#define PROPERTY_RIL_COALESCE_UNSOL "persist.vendor.radio.coalesce_unsol"
+
 // match with constant in RIL.java
 #define MAX_COMMAND_BYTES (8 * 1024)
 
@@ -175,8 +179,11 @@ typedef struct RequestInfo {
     char local;         // responses to local commands do not go back to command process
     RIL_SOCKET_ID socket_id;
     int wasAckSent;    // Indicates whether an ack was sent earlier
+    int64_t dispatchTimeNs; // CLOCK_MONOTONIC time the request was dispatched
 } RequestInfo;
 
+#include "ril_pending_requests.h"
+
 typedef struct UserCallbackInfo {
     RIL_TimedCallback p_callback;
     void *userParam;
@@ -217,7 +224,7 @@ static SocketListenParam s_ril_param_socket;
 static pthread_mutex_t s_pendingRequestsMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t s_writeMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t s_wakeLockCountMutex = PTHREAD_MUTEX_INITIALIZER;
-static RequestInfo *s_pendingRequests = NULL;
+static PendingRequests s_pendingRequests = {NULL, 0, 0};
 
 #if (SIM_COUNT >= 2)
 static struct ril_event s_commands_event_socket2;
@@ -226,7 +233,7 @@ static SocketListenParam s_ril_param_socket2;
 
 static pthread_mutex_t s_pendingRequestsMutex_socket2  = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t s_writeMutex_socket2            = PTHREAD_MUTEX_INITIALIZER;
-static RequestInfo *s_pendingRequests_socket2          = NULL;
+static PendingRequests s_pendingRequests_socket2       = {NULL, 0, 0};
 #endif
 
 #if (SIM_COUNT >= 3)
@@ -236,7 +243,7 @@ static SocketListenParam s_ril_param_socket3;
 
 static pthread_mutex_t s_pendingRequestsMutex_socket3  = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t s_writeMutex_socket3            = PTHREAD_MUTEX_INITIALIZER;
-static RequestInfo *s_pendingRequests_socket3          = NULL;
+static PendingRequests s_pendingRequests_socket3       = {NULL, 0, 0};
 #endif
 
 #if (SIM_COUNT >= 4)
@@ -246,7 +253,7 @@ static SocketListenParam s_ril_param_socket4;
 
 static pthread_mutex_t s_pendingRequestsMutex_socket4  = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t s_writeMutex_socket4            = PTHREAD_MUTEX_INITIALIZER;
-static RequestInfo *s_pendingRequests_socket4          = NULL;
+static PendingRequests s_pendingRequests_socket4       = {NULL, 0, 0};
 #endif
 
 static struct ril_event s_wake_timeout_event;
@@ -270,6 +277,14 @@ static UserCallbackInfo *s_last_wake_timeout_info = NULL;
 static void *s_lastNITZTimeData = NULL;
 static size_t s_lastNITZTimeDataSize;
 
+// Set from PROPERTY_RIL_COALESCE_UNSOL in RIL_register
+static bool s_coalesceUnsol = false;
+
+// Per-thread Parcel reused for unsolicited responses to avoid reallocating
+// its buffer for every indication.
+static thread_local Parcel s_unsolParcel;
+static thread_local bool s_unsolParcelInUse = false;
+
 #if RILC_LOG
     static char printBuf[PRINTBUF_SIZE];
 #endif
@@ -389,6 +404,25 @@ static UnsolResponseInfo s_unsolResponses[] = {
 #include "ril_unsol_commands.h"
 };
 
+/** Index == requestNumber */
+static RequestStats s_requestStats[NUM_ELEMS(s_commands)];
+
+static void
+dumpRequestStats() {
+    pthread_mutex_lock(&s_requestStatsMutex);
+    for (size_t i = 0; i < NUM_ELEMS(s_requestStats); i++) {
+        RequestStats *stats = &s_requestStats[i];
+        if (stats->completed == 0 && stats->cancelled == 0) {
+            continue;
+        }
+        RLOGI("%s: completed %u cancelled %u avg %lldus max %lldus",
+                requestToString(i), stats->completed, stats->cancelled,
+                (long long)(stats->completed ? stats->totalNs / stats->completed / 1000 : 0),
+                (long long)(stats->maxNs / 1000));
+    }
+    pthread_mutex_unlock(&s_requestStatsMutex);
+}
+
 /* For older RILs that do not support new commands RIL_REQUEST_VOICE_RADIO_TECH and
    RIL_UNSOL_VOICE_RADIO_TECH_CHANGED messages, decode the voice radio tech from
    radio state message and store it. Every time there is a change in Radio State
@@ -493,7 +527,7 @@ issueLocalRequest(int request, void *data, int len, RIL_SOCKET_ID socket_id) {
     /* pendingRequestsMutextHook refer to &s_pendingRequestsMutex */
     pthread_mutex_t* pendingRequestsMutexHook = &s_pendingRequestsMutex;
     /* pendingRequestsHook refer to &s_pendingRequests */
-    RequestInfo**    pendingRequestsHook = &s_pendingRequests;
+    PendingRequests* pendingRequestsHook = &s_pendingRequests;
 
 #if (SIM_COUNT == 2)
     if (socket_id == RIL_SOCKET_2) {
@@ -502,7 +536,7 @@ issueLocalRequest(int request, void *data, int len, RIL_SOCKET_ID socket_id) {
     }
 #endif
 
-    pRI = (RequestInfo *)calloc(1, sizeof(RequestInfo));
+    pRI = allocRequestInfo();
     if (pRI == NULL) {
         RLOGE("Memory allocation failed for request %s", requestToString(request));
         return;
@@ -512,12 +546,17 @@ issueLocalRequest(int request, void *data, int len, RIL_SOCKET_ID socket_id) {
     pRI->token = 0xffffffff;        // token is not used in this context
     pRI->pCI = &(s_commands[request]);
     pRI->socket_id = socket_id;
+    pRI->dispatchTimeNs = monotonicTimeNs();
 
     ret = pthread_mutex_lock(pendingRequestsMutexHook);
     assert (ret == 0);
 
-    pRI->p_next = *pendingRequestsHook;
-    *pendingRequestsHook = pRI;
+    if (!addPendingRequest(pendingRequestsHook, pRI)) {
+        pthread_mutex_unlock(pendingRequestsMutexHook);
+        RLOGE("Memory allocation failed for request %s", requestToString(request));
+        releaseRequestInfo(pRI);
+        return;
+    }
 
     ret = pthread_mutex_unlock(pendingRequestsMutexHook);
     assert (ret == 0);
@@ -541,7 +580,7 @@ processCommandBuffer(void *buffer, size_t buflen, RIL_SOCKET_ID socket_id) {
     /* pendingRequestsMutextHook refer to &s_pendingRequestsMutex */
     pthread_mutex_t* pendingRequestsMutexHook = &s_pendingRequestsMutex;
     /* pendingRequestsHook refer to &s_pendingRequests */
-    RequestInfo**    pendingRequestsHook = &s_pendingRequests;
+    PendingRequests* pendingRequestsHook = &s_pendingRequests;
 
     p.setData((uint8_t *) buffer, buflen);
 
@@ -592,7 +631,7 @@ processCommandBuffer(void *buffer, size_t buflen, RIL_SOCKET_ID socket_id) {
         return 0;
     }
 
-    pRI = (RequestInfo *)calloc(1, sizeof(RequestInfo));
+    pRI = allocRequestInfo();
     if (pRI == NULL) {
         RLOGE("Memory allocation failed for request %s", requestToString(request));
         return 0;
@@ -601,12 +640,17 @@ processCommandBuffer(void *buffer, size_t buflen, RIL_SOCKET_ID socket_id) {
     pRI->token = token;
     pRI->pCI = &(s_commands[request]);
     pRI->socket_id = socket_id;
+    pRI->dispatchTimeNs = monotonicTimeNs();
 
     ret = pthread_mutex_lock(pendingRequestsMutexHook);
     assert (ret == 0);
 
-    pRI->p_next = *pendingRequestsHook;
-    *pendingRequestsHook = pRI;
+    if (!addPendingRequest(pendingRequestsHook, pRI)) {
+        pthread_mutex_unlock(pendingRequestsMutexHook);
+        RLOGE("Memory allocation failed for request %s", requestToString(request));
+        releaseRequestInfo(pRI);
+        return 0;
+    }
 
     ret = pthread_mutex_unlock(pendingRequestsMutexHook);
     assert (ret == 0);
@@ -2442,10 +2486,43 @@ blockingWrite(int fd, const void *buffer, size_t len) {
 }
 
 static int
-sendResponseRaw (const void *data, size_t dataSize, RIL_SOCKET_ID socket_id) {
+blockingWritev(int fd, struct iovec *iov, int iovcnt) {
+    size_t totalWritten = 0;
+
+    while (iovcnt > 0) {
+        ssize_t written;
+        do {
+            written = writev (fd, iov, iovcnt);
+        } while (written < 0 && ((errno == EINTR) || (errno == EAGAIN)));
+
+        if (written < 0) {
+            RLOGE ("RIL Response: unexpected error on writev errno:%d", errno);
+            close(fd);
+            return -1;
+        }
+        totalWritten += written;
+
+        // drop the vectors written completely, then advance into a partial one
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+#if VDBG
+    RLOGE("RIL Response bytes written:%zu", totalWritten);
+#endif
+    return 0;
+}
+
+static int
+writeResponseRaw (struct iovec *iov, int iovcnt, RIL_SOCKET_ID socket_id) {
     int fd = s_ril_param_socket.fdCommand;
     int ret;
-    uint32_t header;
     pthread_mutex_t * writeMutexHook = &s_writeMutex;
 
 #if VDBG
@@ -2474,6 +2551,24 @@ sendResponseRaw (const void *data, size_t dataSize, RIL_SOCKET_ID socket_id) {
         return -1;
     }
 
+    pthread_mutex_lock(writeMutexHook);
+
+    ret = blockingWritev(fd, iov, iovcnt);
+
+    pthread_mutex_unlock(writeMutexHook);
+
+    return ret;
+}
+
+#include "ril_response_queue.h"
+
+static UnsolResponseQueue s_unsolResponseQueue[SIM_COUNT];
+
+static int
+sendResponseRaw (const void *data, size_t dataSize, RIL_SOCKET_ID socket_id) {
+    uint32_t header;
+    struct iovec iov[2];
+
     if (dataSize > MAX_COMMAND_BYTES) {
         RLOGE("RIL: packet larger than %u (%u)",
                 MAX_COMMAND_BYTES, (unsigned int )dataSize);
@@ -2481,33 +2576,46 @@ sendResponseRaw (const void *data, size_t dataSize, RIL_SOCKET_ID socket_id) {
         return -1;
     }
 
-    pthread_mutex_lock(writeMutexHook);
-
+    // length header and payload go out in a single syscall
     header = htonl(dataSize);
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<void *>(data);
+    iov[1].iov_len = dataSize;
 
-    ret = blockingWrite(fd, (void *)&header, sizeof(header));
-
-    if (ret < 0) {
-        pthread_mutex_unlock(writeMutexHook);
-        return ret;
+    if (s_coalesceUnsol && socket_id >= 0 && socket_id < SIM_COUNT) {
+        // must not overtake unsolicited responses still in the queue
+        return writeResponseOrdered(&s_unsolResponseQueue[socket_id], iov, 2, socket_id);
     }
+    return writeResponseRaw(iov, 2, socket_id);
+}
 
-    ret = blockingWrite(fd, data, dataSize);
+static int
+sendResponse (Parcel &p, RIL_SOCKET_ID socket_id) {
+    printResponse;
+    return sendResponseRaw(p.data(), p.dataSize(), socket_id);
+}
 
-    if (ret < 0) {
-        pthread_mutex_unlock(writeMutexHook);
-        return ret;
+/**
+ * Returns SEND_QUEUED if coalescing handed the response to another thread's
+ * write; use sendResponse() when the send status matters.
+ */
+static int
+sendUnsolResponse (Parcel &p, RIL_SOCKET_ID socket_id) {
+    if (!s_coalesceUnsol || socket_id < 0 || socket_id >= SIM_COUNT) {
+        return sendResponse(p, socket_id);
     }
 
-    pthread_mutex_unlock(writeMutexHook);
+    if (p.dataSize() > MAX_COMMAND_BYTES) {
+        RLOGE("RIL: packet larger than %u (%u)",
+                MAX_COMMAND_BYTES, (unsigned int )p.dataSize());
 
-    return 0;
-}
+        return -1;
+    }
 
-static int
-sendResponse (Parcel &p, RIL_SOCKET_ID socket_id) {
     printResponse;
-    return sendResponseRaw(p.data(), p.dataSize(), socket_id);
+    return queueResponseRaw(&s_unsolResponseQueue[socket_id], p.data(), p.dataSize(),
+            socket_id);
 }
 
 /** response is an int* pointing to an array of ints */
@@ -4389,7 +4497,7 @@ static void onCommandsSocketClosed(RIL_SOCKET_ID socket_id) {
        pendingRequestsMutextHook refer to &s_pendingRequestsMutex */
     pthread_mutex_t * pendingRequestsMutexHook = &s_pendingRequestsMutex;
     /* pendingRequestsHook refer to &s_pendingRequests */
-    RequestInfo **    pendingRequestsHook = &s_pendingRequests;
+    PendingRequests * pendingRequestsHook = &s_pendingRequests;
 
 #if (SIM_COUNT >= 2)
     if (socket_id == RIL_SOCKET_2) {
@@ -4413,13 +4521,13 @@ static void onCommandsSocketClosed(RIL_SOCKET_ID socket_id) {
     ret = pthread_mutex_lock(pendingRequestsMutexHook);
     assert (ret == 0);
 
-    p_cur = *pendingRequestsHook;
-
-    for (p_cur = *pendingRequestsHook
-            ; p_cur != NULL
-            ; p_cur  = p_cur->p_next
-    ) {
-        p_cur->cancelled = 1;
+    for (size_t i = 0; i < pendingRequestsHook->numBuckets; i++) {
+        for (p_cur = pendingRequestsHook->buckets[i]
+                ; p_cur != NULL
+                ; p_cur  = p_cur->p_next
+        ) {
+            p_cur->cancelled = 1;
+        }
     }
 
     ret = pthread_mutex_unlock(pendingRequestsMutexHook);
@@ -4832,6 +4940,10 @@ static void debugCallback (int fd, short flags, void *param) {
             issueLocalRequest(RIL_REQUEST_HANGUP, &hangupData,
                               sizeof(hangupData), socket_id);
             break;
+        case 11:
+            RLOGI("Debug port: Dump request timing stats");
+            dumpRequestStats();
+            break;
         default:
             RLOGE ("Invalid request");
             break;
@@ -5017,6 +5129,11 @@ RIL_register (const RIL_RadioFunctions *callbacks) {
 
     memcpy(&s_callbacks, callbacks, sizeof (RIL_RadioFunctions));
 
+    s_coalesceUnsol = property_get_bool(PROPERTY_RIL_COALESCE_UNSOL, 0);
+    for (int i = 0; i < SIM_COUNT; i++) {
+        initResponseQueue(&s_unsolResponseQueue[i]);
+    }
+
     /* Initialize socket1 parameters */
     s_ril_param_socket = {
                         RIL_SOCKET_1,             /* socket_id */
@@ -5194,7 +5311,7 @@ checkAndDequeueRequestInfoIfAck(struct RequestInfo *pRI, bool isAck) {
        pendingRequestsMutextHook refer to &s_pendingRequestsMutex */
     pthread_mutex_t* pendingRequestsMutexHook = &s_pendingRequestsMutex;
     /* pendingRequestsHook refer to &s_pendingRequests */
-    RequestInfo ** pendingRequestsHook = &s_pendingRequests;
+    PendingRequests * pendingRequestsHook = &s_pendingRequests;
 
     if (pRI == NULL) {
         return 0;
@@ -5220,22 +5337,17 @@ checkAndDequeueRequestInfoIfAck(struct RequestInfo *pRI, bool isAck) {
 #endif
     pthread_mutex_lock(pendingRequestsMutexHook);
 
-    for(RequestInfo **ppCur = pendingRequestsHook
-        ; *ppCur != NULL
-        ; ppCur = &((*ppCur)->p_next)
-    ) {
-        if (pRI == *ppCur) {
-            ret = 1;
-            if (isAck) { // Async ack
-                if (pRI->wasAckSent == 1) {
-                    RLOGD("Ack was already sent for %s", requestToString(pRI->pCI->requestNumber));
-                } else {
-                    pRI->wasAckSent = 1;
-                }
+    RequestInfo **ppCur = findPendingRequest(pendingRequestsHook, pRI);
+    if (ppCur != NULL) {
+        ret = 1;
+        if (isAck) { // Async ack
+            if (pRI->wasAckSent == 1) {
+                RLOGD("Ack was already sent for %s", requestToString(pRI->pCI->requestNumber));
             } else {
-                *ppCur = (*ppCur)->p_next;
+                pRI->wasAckSent = 1;
             }
-            break;
+        } else {
+            removePendingRequest(pendingRequestsHook, ppCur);
         }
     }
 
@@ -5317,6 +5429,8 @@ RIL_onRequestComplete(RIL_Token t, RIL_Errno e, void *response, size_t responsel
         return;
     }
 
+    recordRequestStats(s_requestStats, NUM_ELEMS(s_requestStats), pRI);
+
     socket_id = pRI->socket_id;
     fd = findFd(socket_id);
 
@@ -5374,7 +5488,7 @@ RIL_onRequestComplete(RIL_Token t, RIL_Errno e, void *response, size_t responsel
     }
 
 done:
-    free(pRI);
+    releaseRequestInfo(pRI);
 }
 
 static void
@@ -5642,7 +5756,17 @@ void RIL_onUnsolicitedResponse(int unsolResponse, const void *data,
 
     appendPrintBuf("[UNSL]< %s", requestToString(unsolResponse));
 
-    Parcel p;
+    // processRadioState() below may issue nested unsolicited responses on
+    // this thread; only the outermost call gets the reusable Parcel.
+    Parcel localParcel;
+    bool reuseParcel = !s_unsolParcelInUse;
+    Parcel &p = reuseParcel ? s_unsolParcel : localParcel;
+    if (reuseParcel) {
+        s_unsolParcelInUse = true;
+        p.setDataSize(0);
+        p.setDataPosition(0);
+    }
+
     if (s_callbacks.version >= 13
                 && s_unsolResponses[unsolResponseIndex].wakeType == WAKE_PARTIAL) {
         p.writeInt32 (RESPONSE_UNSOLICITED_ACK_EXP);
@@ -5698,7 +5822,12 @@ void RIL_onUnsolicitedResponse(int unsolResponse, const void *data,
 #if VDBG
     RLOGI("%s UNSOLICITED: %s length:%d", rilSocketIdToString(soc_id), requestToString(unsolResponse), p.dataSize());
 #endif
-    ret = sendResponse(p, soc_id);
+    if (unsolResponse == RIL_UNSOL_NITZ_TIME_RECEIVED) {
+        // needs the real send status to know whether to keep a copy
+        ret = sendResponse(p, soc_id);
+    } else {
+        ret = sendUnsolResponse(p, soc_id);
+    }
     if (ret != 0 && unsolResponse == RIL_UNSOL_NITZ_TIME_RECEIVED) {
 
         // Unfortunately, NITZ time is not poll/update like everything
@@ -5721,9 +5850,15 @@ void RIL_onUnsolicitedResponse(int unsolResponse, const void *data,
     }
 
     // Normal exit
+    if (reuseParcel) {
+        s_unsolParcelInUse = false;
+    }
     return;
 
 error_exit:
+    if (reuseParcel) {
+        s_unsolParcelInUse = false;
+    }
     if (shouldScheduleTimeout) {
         releaseWakeLock();
     }
@@ -5759,7 +5894,11 @@ internalRequestTimedCallback (RIL_TimedCallback callback, void *param,
 
     ril_event_set(&(p_info->event), -1, false, userTimerCallback, p_info);
 
-    ril_timer_add(&(p_info->event), &myRelativeTime);
+    if (!ril_timer_add(&(p_info->event), &myRelativeTime)) {
+        RLOGE("Unable to arm timer in internalRequestTimedCallback");
+        free(p_info);
+        return NULL;
+    }
 
     triggerEvLoop();
     return p_info;
@@ -24,6 +24,7 @@
 #include <utils/Log2.h>
 #include <ril_event.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
 #include <time.h>
 
@@ -65,11 +66,31 @@ static pthread_mutex_t listMutex;
     } while(0);
 #endif
 
-static fd_set readFds;
-static int nfds = 0;
+// Number of ready fds collected per epoll_wait() call. Watches are level
+// triggered, so anything beyond this is simply reported on the next pass.
+#define EPOLL_BATCH_SIZE 32
+
+// Initial capacity of the timer heap; grown by doubling as needed.
+#define TIMER_HEAP_INIT_SIZE 16
+
+// Initial size of the fd-indexed watch table; grown by doubling as needed.
+#define WATCH_TABLE_INIT_SIZE 32
+
+static int epollFd = -1;
+static int watchCount = 0;
+
+// Registered watches indexed by fd. epoll only carries the fd, and the
+// ril_event is looked up here under the lock, so a watch removed (and
+// possibly freed) by another thread after epoll_wait() returns is never
+// dereferenced.
+static struct ril_event ** watch_table = NULL;
+static int watch_table_size = 0;
+
+// Binary min-heap of armed timers, keyed on ril_event::timeout.
+static struct ril_event ** timer_heap = NULL;
+static int timer_count = 0;
+static int timer_capacity = 0;
 
-static struct ril_event * watch_table[MAX_FD_EVENTS];
-static struct ril_event timer_list;
 static struct ril_event pending_list;
 
 #define DEBUG 0
@@ -78,14 +99,15 @@ static struct ril_event pending_list;
 #define dlog(x...) RLOGD( x )
 static void dump_event(struct ril_event * ev)
 {
-    dlog("~~~~ Event %x ~~~~", (unsigned int)ev);
-    dlog("     next    = %x", (unsigned int)ev->next);
-    dlog("     prev    = %x", (unsigned int)ev->prev);
+    dlog("~~~~ Event %p ~~~~", ev);
+    dlog("     next    = %p", ev->next);
+    dlog("     prev    = %p", ev->prev);
     dlog("     fd      = %d", ev->fd);
     dlog("     pers    = %d", ev->persist);
+    dlog("     heap    = %d", ev->heap_index);
     dlog("     timeout = %ds + %dus", (int)ev->timeout.tv_sec, (int)ev->timeout.tv_usec);
-    dlog("     func    = %x", (unsigned int)ev->func);
-    dlog("     param   = %x", (unsigned int)ev->param);
+    dlog("     func    = %p", ev->func);
+    dlog("     param   = %p", ev->param);
     dlog("~~~~~~~~~~~~~~~~~~");
 }
 #else
@@ -107,6 +129,8 @@ static void init_list(struct ril_event * list)
     list->next = list;
     list->prev = list;
     list->fd = -1;
+    list->index = -1;
+    list->heap_index = -1;
 }
 
 static void addToList(struct ril_event * ev, struct ril_event * list)
@@ -130,28 +154,114 @@ static void removeFromList(struct ril_event * ev)
     dlog("~~~~ -removeFromList ~~~~");
 }
 
-
-static void removeWatch(struct ril_event * ev, int index)
+static void heapSwap(int a, int b)
 {
-    dlog("~~~~ +removeWatch ~~~~");
-    watch_table[index] = NULL;
-    ev->index = -1;
+    struct ril_event * tmp = timer_heap[a];
+    timer_heap[a] = timer_heap[b];
+    timer_heap[b] = tmp;
+    timer_heap[a]->heap_index = a;
+    timer_heap[b]->heap_index = b;
+}
 
-    FD_CLR(ev->fd, &readFds);
+static void heapSiftUp(int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!timercmp(&timer_heap[i]->timeout, &timer_heap[parent]->timeout, <)) {
+            break;
+        }
+        heapSwap(i, parent);
+        i = parent;
+    }
+}
 
-    if (ev->fd+1 == nfds) {
-        int n = 0;
+static void heapSiftDown(int i)
+{
+    for (;;) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
 
-        for (int i = 0; i < MAX_FD_EVENTS; i++) {
-            struct ril_event * rev = watch_table[i];
+        if (left < timer_count
+                && timercmp(&timer_heap[left]->timeout, &timer_heap[smallest]->timeout, <)) {
+            smallest = left;
+        }
+        if (right < timer_count
+                && timercmp(&timer_heap[right]->timeout, &timer_heap[smallest]->timeout, <)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        heapSwap(i, smallest);
+        i = smallest;
+    }
+}
 
-            if ((rev != NULL) && (rev->fd > n)) {
-                n = rev->fd;
-            }
+static bool heapInsert(struct ril_event * ev)
+{
+    if (timer_count == timer_capacity) {
+        int capacity = timer_capacity ? timer_capacity * 2 : TIMER_HEAP_INIT_SIZE;
+        struct ril_event ** heap = (struct ril_event **) realloc(timer_heap,
+                capacity * sizeof(struct ril_event *));
+        if (heap == NULL) {
+            RLOGE("ril_event: unable to grow timer heap to %d", capacity);
+            return false;
         }
-        nfds = n + 1;
-        dlog("~~~~ nfds = %d ~~~~", nfds);
+        timer_heap = heap;
+        timer_capacity = capacity;
+    }
+
+    ev->heap_index = timer_count;
+    timer_heap[timer_count++] = ev;
+    heapSiftUp(ev->heap_index);
+    return true;
+}
+
+static void heapRemove(struct ril_event * ev)
+{
+    int i = ev->heap_index;
+    int last = --timer_count;
+
+    ev->heap_index = -1;
+    if (i != last) {
+        timer_heap[i] = timer_heap[last];
+        timer_heap[i]->heap_index = i;
+        heapSiftUp(i);
+        heapSiftDown(timer_heap[i]->heap_index);
+    }
+    timer_heap[last] = NULL;
+}
+
+static bool growWatchTable(int fd)
+{
+    int size = watch_table_size ? watch_table_size : WATCH_TABLE_INIT_SIZE;
+    while (size <= fd) {
+        size *= 2;
+    }
+    struct ril_event ** table = (struct ril_event **) realloc(watch_table,
+            size * sizeof(struct ril_event *));
+    if (table == NULL) {
+        RLOGE("ril_event: unable to grow watch table to %d", size);
+        return false;
     }
+    memset(table + watch_table_size, 0,
+            (size - watch_table_size) * sizeof(struct ril_event *));
+    watch_table = table;
+    watch_table_size = size;
+    return true;
+}
+
+static void removeWatch(struct ril_event * ev)
+{
+    dlog("~~~~ +removeWatch ~~~~");
+    if (epoll_ctl(epollFd, EPOLL_CTL_DEL, ev->fd, NULL) < 0 && errno != EBADF) {
+        RLOGE("ril_event: epoll_ctl(DEL, %d) error (%d)", ev->fd, errno);
+    }
+    watch_table[ev->index] = NULL;
+    ev->index = -1;
+    watchCount--;
+    dlog("~~~~ watchCount = %d ~~~~", watchCount);
     dlog("~~~~ -removeWatch ~~~~");
 }
 
@@ -160,38 +270,41 @@ static void processTimeouts()
     dlog("~~~~ +processTimeouts ~~~~");
     MUTEX_ACQUIRE();
     struct timeval now;
-    struct ril_event * tev = timer_list.next;
-    struct ril_event * next;
 
     getNow(&now);
-    // walk list, see if now >= ev->timeout for any events
+    // pop the heap while now >= ev->timeout for the earliest event
 
     dlog("~~~~ Looking for timers <= %ds + %dus ~~~~", (int)now.tv_sec, (int)now.tv_usec);
-    while ((tev != &timer_list) && (timercmp(&now, &tev->timeout, >))) {
+    while ((timer_count > 0) && (timercmp(&now, &timer_heap[0]->timeout, >))) {
         // Timer expired
         dlog("~~~~ firing timer ~~~~");
-        next = tev->next;
-        removeFromList(tev);
+        struct ril_event * tev = timer_heap[0];
+        heapRemove(tev);
         addToList(tev, &pending_list);
-        tev = next;
     }
     MUTEX_RELEASE();
     dlog("~~~~ -processTimeouts ~~~~");
 }
 
-static void processReadReadies(fd_set * rfds, int n)
+static void processReadReadies(struct epoll_event * events, int n)
 {
     dlog("~~~~ +processReadReadies (%d) ~~~~", n);
     MUTEX_ACQUIRE();
 
-    for (int i = 0; (i < MAX_FD_EVENTS) && (n > 0); i++) {
-        struct ril_event * rev = watch_table[i];
-        if (rev != NULL && FD_ISSET(rev->fd, rfds)) {
-            addToList(rev, &pending_list);
-            if (rev->persist == false) {
-                removeWatch(rev, i);
-            }
-            n--;
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        // The watch may have been removed by another thread after
+        // epoll_wait() returned; only fire events that are still registered.
+        if (fd < 0 || fd >= watch_table_size) {
+            continue;
+        }
+        struct ril_event * rev = watch_table[fd];
+        if (rev == NULL || rev->next != NULL) {
+            continue;
+        }
+        addToList(rev, &pending_list);
+        if (rev->persist == false) {
+            removeWatch(rev);
         }
     }
 
@@ -212,29 +325,35 @@ static void firePending()
     dlog("~~~~ -firePending ~~~~");
 }
 
-static int calcNextTimeout(struct timeval * tv)
+// Returns the epoll_wait() timeout in ms, or -1 if no timer is armed
+static int calcNextTimeout()
 {
-    struct ril_event * tev = timer_list.next;
     struct timeval now;
+    struct timeval tv;
+    int ms = -1;
 
-    getNow(&now);
+    MUTEX_ACQUIRE();
 
-    // Sorted list, so calc based on first node
-    if (tev == &timer_list) {
-        // no pending timers
-        return -1;
-    }
+    // Heap root is always the earliest deadline
+    if (timer_count > 0) {
+        struct ril_event * tev = timer_heap[0];
 
-    dlog("~~~~ now = %ds + %dus ~~~~", (int)now.tv_sec, (int)now.tv_usec);
-    dlog("~~~~ next = %ds + %dus ~~~~",
-            (int)tev->timeout.tv_sec, (int)tev->timeout.tv_usec);
-    if (timercmp(&tev->timeout, &now, >)) {
-        timersub(&tev->timeout, &now, tv);
-    } else {
-        // timer already expired.
-        tv->tv_sec = tv->tv_usec = 0;
+        getNow(&now);
+        dlog("~~~~ now = %ds + %dus ~~~~", (int)now.tv_sec, (int)now.tv_usec);
+        dlog("~~~~ next = %ds + %dus ~~~~",
+                (int)tev->timeout.tv_sec, (int)tev->timeout.tv_usec);
+        if (timercmp(&tev->timeout, &now, >)) {
+            timersub(&tev->timeout, &now, &tv);
+            // round up so we never wake before the timer is due
+            ms = tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+        } else {
+            // timer already expired.
+            ms = 0;
+        }
     }
-    return 0;
+
+    MUTEX_RELEASE();
+    return ms;
 }
 
 // Initialize internal data structs
@@ -242,19 +361,23 @@ void ril_event_init()
 {
     MUTEX_INIT();
 
-    FD_ZERO(&readFds);
-    init_list(&timer_list);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        RLOGE("ril_event: epoll_create1 error (%d)", errno);
+    }
+    watchCount = 0;
+    timer_count = 0;
     init_list(&pending_list);
-    memset(watch_table, 0, sizeof(watch_table));
 }
 
 // Initialize an event
 void ril_event_set(struct ril_event * ev, int fd, bool persist, ril_event_cb func, void * param)
 {
-    dlog("~~~~ ril_event_set %x ~~~~", (unsigned int)ev);
+    dlog("~~~~ ril_event_set %p ~~~~", ev);
     memset(ev, 0, sizeof(struct ril_event));
     ev->fd = fd;
     ev->index = -1;
+    ev->heap_index = -1;
     ev->persist = persist;
     ev->func = func;
     ev->param = param;
@@ -266,110 +389,101 @@ void ril_event_add(struct ril_event * ev)
 {
     dlog("~~~~ +ril_event_add ~~~~");
     MUTEX_ACQUIRE();
-    for (int i = 0; i < MAX_FD_EVENTS; i++) {
-        if (watch_table[i] == NULL) {
-            watch_table[i] = ev;
-            ev->index = i;
-            dlog("~~~~ added at %d ~~~~", i);
+    if (ev->index < 0 && ev->fd >= 0
+            && (ev->fd < watch_table_size || growWatchTable(ev->fd))) {
+        struct epoll_event eev;
+
+        memset(&eev, 0, sizeof(eev));
+        eev.events = EPOLLIN;
+        eev.data.fd = ev->fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, ev->fd, &eev) == 0) {
+            ev->index = ev->fd;
+            watch_table[ev->fd] = ev;
+            watchCount++;
+            dlog("~~~~ added fd %d ~~~~", ev->fd);
             dump_event(ev);
-            FD_SET(ev->fd, &readFds);
-            if (ev->fd >= nfds) nfds = ev->fd+1;
-            dlog("~~~~ nfds = %d ~~~~", nfds);
-            break;
+        } else {
+            RLOGE("ril_event: epoll_ctl(ADD, %d) error (%d)", ev->fd, errno);
         }
+        dlog("~~~~ watchCount = %d ~~~~", watchCount);
     }
     MUTEX_RELEASE();
     dlog("~~~~ -ril_event_add ~~~~");
 }
 
 // Add timer event
-void ril_timer_add(struct ril_event * ev, struct timeval * tv)
+bool ril_timer_add(struct ril_event * ev, struct timeval * tv)
 {
+    bool armed = false;
+
     dlog("~~~~ +ril_timer_add ~~~~");
     MUTEX_ACQUIRE();
 
-    struct ril_event * list;
     if (tv != NULL) {
-        // add to timer list
-        list = timer_list.next;
         ev->fd = -1; // make sure fd is invalid
 
         struct timeval now;
         getNow(&now);
         timeradd(&now, tv, &ev->timeout);
 
-        // keep list sorted
-        while (timercmp(&list->timeout, &ev->timeout, < )
-                && (list != &timer_list)) {
-            list = list->next;
+        if (ev->heap_index >= 0) {
+            // re-arming a pending timer moves its deadline in place, so it
+            // never needs to grow the heap
+            int i = ev->heap_index;
+            heapSiftUp(i);
+            heapSiftDown(ev->heap_index);
+            armed = true;
+        } else {
+            armed = heapInsert(ev);
+            if (!armed) {
+                RLOGE("ril_event: timer %p dropped", ev);
+            }
         }
-        // list now points to the first event older than ev
-        addToList(ev, list);
     }
 
     MUTEX_RELEASE();
     dlog("~~~~ -ril_timer_add ~~~~");
+    return armed;
 }
 
-// Remove event from watch or timer list
+// Remove event from watch list
 void ril_event_del(struct ril_event * ev)
 {
     dlog("~~~~ +ril_event_del ~~~~");
     MUTEX_ACQUIRE();
 
-    if (ev->index < 0 || ev->index >= MAX_FD_EVENTS) {
+    if (ev->index < 0) {
         MUTEX_RELEASE();
         return;
     }
 
-    removeWatch(ev, ev->index);
+    removeWatch(ev);
 
     MUTEX_RELEASE();
     dlog("~~~~ -ril_event_del ~~~~");
 }
 
-#if DEBUG
-static void printReadies(fd_set * rfds)
-{
-    for (int i = 0; (i < MAX_FD_EVENTS); i++) {
-        struct ril_event * rev = watch_table[i];
-        if (rev != NULL && FD_ISSET(rev->fd, rfds)) {
-          dlog("DON: fd=%d is ready", rev->fd);
-        }
-    }
-}
-#else
-#define printReadies(rfds) do {} while(0)
-#endif
-
 void ril_event_loop()
 {
     int n;
-    fd_set rfds;
-    struct timeval tv;
-    struct timeval * ptv;
-
+    int timeout;
+    struct epoll_event events[EPOLL_BATCH_SIZE];
 
     for (;;) {
 
-        // make local copy of read fd_set
-        memcpy(&rfds, &readFds, sizeof(fd_set));
-        if (-1 == calcNextTimeout(&tv)) {
+        timeout = calcNextTimeout();
+        if (-1 == timeout) {
             // no pending timers; block indefinitely
             dlog("~~~~ no timers; blocking indefinitely ~~~~");
-            ptv = NULL;
         } else {
-            dlog("~~~~ blocking for %ds + %dus ~~~~", (int)tv.tv_sec, (int)tv.tv_usec);
-            ptv = &tv;
+            dlog("~~~~ blocking for %dms ~~~~", timeout);
         }
-        printReadies(&rfds);
-        n = select(nfds, &rfds, NULL, NULL, ptv);
-        printReadies(&rfds);
+        n = epoll_wait(epollFd, events, EPOLL_BATCH_SIZE, timeout);
         dlog("~~~~ %d events fired ~~~~", n);
         if (n < 0) {
             if (errno == EINTR) continue;
 
-            RLOGE("ril_event: select error (%d)", errno);
+            RLOGE("ril_event: epoll_wait error (%d)", errno);
             // bail?
             return;
         }
@@ -377,7 +491,7 @@ void ril_event_loop()
         // Check for timeouts
         processTimeouts();
         // Check for read-ready
-        processReadReadies(&rfds, n);
+        processReadReadies(events, n);
         // Fire away
         firePending();
     }
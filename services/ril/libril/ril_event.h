@@ -18,9 +18,6 @@
 #ifndef RIL_EVENT_H_INCLUDED
 #define RIL_EVENT_H_INCLUDED
 
-// Max number of fd's we watch at any one time.  Increase if necessary.
-#define MAX_FD_EVENTS 8
-
 typedef void (*ril_event_cb)(int fd, short events, void *userdata);
 
 struct ril_event {
@@ -28,7 +25,8 @@ struct ril_event {
     struct ril_event *prev;
 
     int fd;
-    int index;
+    int index;      // >= 0 while registered with the epoll set
+    int heap_index; // position in the timer heap, -1 if not armed
     bool persist;
     struct timeval timeout;
     ril_event_cb func;
@@ -44,8 +42,9 @@ void ril_event_set(struct ril_event * ev, int fd, bool persist, ril_event_cb fun
 // Add event to watch list
 void ril_event_add(struct ril_event * ev);
 
-// Add timer event
-void ril_timer_add(struct ril_event * ev, struct timeval * tv);
+// Add timer event. Returns false, leaving the event unarmed (heap_index -1),
+// if tv is NULL or the timer heap could not grow.
+bool ril_timer_add(struct ril_event * ev, struct timeval * tv);
 
 // Remove event from watch list
 void ril_event_del(struct ril_event * ev);
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Pending request table, RequestInfo pool and completion stats of libril.
+ *
+ * Like ril_commands.h this is included into ril.cpp rather than compiled on
+ * its own: the includer declares RequestInfo first (with p_next, cancelled,
+ * dispatchTimeNs and pCI->requestNumber). The host tests include it the same
+ * way to exercise the table without the rest of ril.cpp.
+ */
+
+// Initial bucket count of each pending request table; doubled when full
+#define PENDING_REQUESTS_INIT_BUCKETS 64
+
+// Number of RequestInfo entries the pool allocates at once
+#define REQUEST_INFO_POOL_CHUNK 32
+
+// Released RequestInfo entries that queue ahead of one before it is reused.
+// The RIL_Token is the entry's address, so a late or duplicate
+// RIL_onRequestComplete() only matches a newer request once this many other
+// requests have completed since.
+#define REQUEST_INFO_REUSE_DELAY 64
+
+/* Outstanding RequestInfos of one socket, hashed on their RIL_Token address */
+typedef struct PendingRequests {
+    RequestInfo **buckets;
+    size_t numBuckets;  // always a power of two
+    size_t count;
+} PendingRequests;
+
+/*
+ * Outcome of one request code. Latency, from dispatch to onRequestComplete,
+ * only covers requests whose response was delivered; requests cancelled by
+ * a socket close are counted separately.
+ */
+typedef struct RequestStats {
+    uint32_t completed;
+    uint32_t cancelled;
+    int64_t totalNs;
+    int64_t maxNs;
+} RequestStats;
+
+/*
+ * FIFO of recycled RequestInfo entries, released ones at the tail and never
+ * used ones at the head. Chunks are never released.
+ */
+static pthread_mutex_t s_requestInfoPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static RequestInfo *s_requestInfoFreeHead = NULL;
+static RequestInfo *s_requestInfoFreeTail = NULL;
+static size_t s_requestInfoFreeCount = 0;
+
+static pthread_mutex_t s_requestStatsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t
+monotonicTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static RequestInfo *
+allocRequestInfo() {
+    RequestInfo *pRI;
+
+    pthread_mutex_lock(&s_requestInfoPoolMutex);
+    // Grow rather than reuse an entry with fewer than REQUEST_INFO_REUSE_DELAY
+    // released after it
+    if (s_requestInfoFreeCount <= REQUEST_INFO_REUSE_DELAY) {
+        RequestInfo *chunk = (RequestInfo *)calloc(REQUEST_INFO_POOL_CHUNK,
+                sizeof(RequestInfo));
+        if (chunk != NULL) {
+            for (int i = 0; i < REQUEST_INFO_POOL_CHUNK; i++) {
+                chunk[i].p_next = s_requestInfoFreeHead;
+                s_requestInfoFreeHead = &chunk[i];
+            }
+            if (s_requestInfoFreeTail == NULL) {
+                s_requestInfoFreeTail = &chunk[0];
+            }
+            s_requestInfoFreeCount += REQUEST_INFO_POOL_CHUNK;
+        } else if (s_requestInfoFreeHead == NULL) {
+            pthread_mutex_unlock(&s_requestInfoPoolMutex);
+            return NULL;
+        }
+    }
+    pRI = s_requestInfoFreeHead;
+    s_requestInfoFreeHead = pRI->p_next;
+    if (s_requestInfoFreeHead == NULL) {
+        s_requestInfoFreeTail = NULL;
+    }
+    s_requestInfoFreeCount--;
+    pthread_mutex_unlock(&s_requestInfoPoolMutex);
+
+    memset(pRI, 0, sizeof(RequestInfo));
+    return pRI;
+}
+
+static void
+releaseRequestInfo(RequestInfo *pRI) {
+    pRI->p_next = NULL;
+    pthread_mutex_lock(&s_requestInfoPoolMutex);
+    if (s_requestInfoFreeTail != NULL) {
+        s_requestInfoFreeTail->p_next = pRI;
+    } else {
+        s_requestInfoFreeHead = pRI;
+    }
+    s_requestInfoFreeTail = pRI;
+    s_requestInfoFreeCount++;
+    pthread_mutex_unlock(&s_requestInfoPoolMutex);
+}
+
+static size_t
+pendingRequestBucket(const RequestInfo *pRI, size_t numBuckets) {
+    uint64_t key = (uint64_t)(uintptr_t)pRI;
+
+    // 64-bit finalizer from MurmurHash3; pool entries are adjacent in memory
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key & (numBuckets - 1);
+}
+
+static void
+growPendingRequests(PendingRequests *pending) {
+    size_t numBuckets = pending->numBuckets * 2;
+    RequestInfo **buckets = (RequestInfo **)calloc(numBuckets, sizeof(RequestInfo *));
+
+    if (buckets == NULL) {
+        // Keep the current table; chains just get longer
+        RLOGE("Unable to grow pending request table to %zu buckets", numBuckets);
+        return;
+    }
+
+    for (size_t i = 0; i < pending->numBuckets; i++) {
+        RequestInfo *p_cur = pending->buckets[i];
+        while (p_cur != NULL) {
+            RequestInfo *p_next = p_cur->p_next;
+            size_t bucket = pendingRequestBucket(p_cur, numBuckets);
+            p_cur->p_next = buckets[bucket];
+            buckets[bucket] = p_cur;
+            p_cur = p_next;
+        }
+    }
+
+    free(pending->buckets);
+    pending->buckets = buckets;
+    pending->numBuckets = numBuckets;
+}
+
+/* Caller must hold the pending requests mutex of the socket */
+static bool
+addPendingRequest(PendingRequests *pending, RequestInfo *pRI) {
+    if (pending->buckets == NULL) {
+        pending->buckets = (RequestInfo **)calloc(PENDING_REQUESTS_INIT_BUCKETS,
+                sizeof(RequestInfo *));
+        if (pending->buckets == NULL) {
+            return false;
+        }
+        pending->numBuckets = PENDING_REQUESTS_INIT_BUCKETS;
+    } else if (pending->count >= pending->numBuckets) {
+        growPendingRequests(pending);
+    }
+
+    size_t bucket = pendingRequestBucket(pRI, pending->numBuckets);
+    pRI->p_next = pending->buckets[bucket];
+    pending->buckets[bucket] = pRI;
+    pending->count++;
+    return true;
+}
+
+/* Caller must hold the pending requests mutex of the socket */
+static RequestInfo **
+findPendingRequest(PendingRequests *pending, RequestInfo *pRI) {
+    if (pending->buckets == NULL) {
+        return NULL;
+    }
+
+    for (RequestInfo **ppCur = &pending->buckets[pendingRequestBucket(pRI, pending->numBuckets)]
+        ; *ppCur != NULL
+        ; ppCur = &((*ppCur)->p_next)
+    ) {
+        if (*ppCur == pRI) {
+            return ppCur;
+        }
+    }
+    return NULL;
+}
+
+/* Caller must hold the pending requests mutex of the socket */
+static void
+removePendingRequest(PendingRequests *pending, RequestInfo **ppCur) {
+    *ppCur = (*ppCur)->p_next;
+    pending->count--;
+}
+
+/* statsTable is indexed by request number */
+static void
+recordRequestStats(RequestStats *statsTable, size_t numStats, RequestInfo *pRI) {
+    int request = pRI->pCI->requestNumber;
+    int64_t elapsedNs = monotonicTimeNs() - pRI->dispatchTimeNs;
+
+    if (request < 0 || request >= (int)numStats) {
+        return;
+    }
+
+    pthread_mutex_lock(&s_requestStatsMutex);
+    RequestStats *stats = &statsTable[request];
+    if (pRI->cancelled) {
+        stats->cancelled++;
+        pthread_mutex_unlock(&s_requestStatsMutex);
+        return;
+    }
+    stats->completed++;
+    stats->totalNs += elapsedNs;
+    if (elapsedNs > stats->maxNs) {
+        stats->maxNs = elapsedNs;
+    }
+    pthread_mutex_unlock(&s_requestStatsMutex);
+}
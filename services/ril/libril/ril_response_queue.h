@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Per-socket queue that coalesces unsolicited responses, and the ordered
+ * direct send every other response goes through while coalescing is on.
+ *
+ * Like ril_commands.h this is included into ril.cpp rather than compiled on
+ * its own: the includer first defines MAX_COMMAND_BYTES and
+ *     static int writeResponseRaw(struct iovec *iov, int iovcnt,
+ *                                 RIL_SOCKET_ID socket_id);
+ * which writes a fully framed buffer to the socket's client.
+ */
+
+// queueResponseRaw() result when another thread will write the response
+#define SEND_QUEUED 1
+
+/* Framed (length header + payload) responses waiting to be written */
+typedef struct ResponseBuffer {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} ResponseBuffer;
+
+/*
+ * While one thread is writing to a slow client, other threads append their
+ * unsolicited responses to the active buffer and return; the writer then
+ * flushes everything queued with a single write. Responses that need their
+ * send status wait for the writer instead, so nothing overtakes a response
+ * that was queued before it.
+ */
+typedef struct UnsolResponseQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t writerDone;
+    bool writing;
+    int active;
+    ResponseBuffer buffers[2];
+} UnsolResponseQueue;
+
+static void
+initResponseQueue(UnsolResponseQueue *queue) {
+    memset(queue, 0, sizeof(UnsolResponseQueue));
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->writerDone, NULL);
+}
+
+static int
+appendResponseBuffer(ResponseBuffer *buffer, const void *data, size_t dataSize) {
+    uint32_t header = htonl(dataSize);
+    size_t needed = buffer->size + sizeof(header) + dataSize;
+
+    if (needed > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : MAX_COMMAND_BYTES;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        uint8_t *grown = (uint8_t *)realloc(buffer->data, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->size, &header, sizeof(header));
+    memcpy(buffer->data + buffer->size + sizeof(header), data, dataSize);
+    buffer->size = needed;
+    return 0;
+}
+
+/**
+ * Write out everything queued until the queue stays empty. Called with the
+ * queue mutex held by the thread that set queue->writing; the mutex is
+ * dropped around each write.
+ */
+static int
+flushResponseQueueLocked(UnsolResponseQueue *queue, RIL_SOCKET_ID socket_id) {
+    int ret = 0;
+
+    while (queue->buffers[queue->active].size > 0) {
+        ResponseBuffer *flush = &queue->buffers[queue->active];
+        struct iovec iov;
+
+        queue->active ^= 1;
+        pthread_mutex_unlock(&queue->mutex);
+
+        iov.iov_base = flush->data;
+        iov.iov_len = flush->size;
+        ret = writeResponseRaw(&iov, 1, socket_id);
+        flush->size = 0;
+
+        pthread_mutex_lock(&queue->mutex);
+        if (ret < 0) {
+            // client is gone, anything queued behind us is undeliverable
+            queue->buffers[queue->active].size = 0;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Queue a framed response. The first caller to find the queue idle becomes
+ * the writer and keeps flushing until no more responses were queued behind
+ * it, returning the write status; everyone else returns SEND_QUEUED at once.
+ */
+static int
+queueResponseRaw (UnsolResponseQueue *queue, const void *data, size_t dataSize,
+        RIL_SOCKET_ID socket_id) {
+    int ret;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    if (appendResponseBuffer(&queue->buffers[queue->active], data, dataSize) < 0) {
+        pthread_mutex_unlock(&queue->mutex);
+        RLOGE("Memory allocation failed queueing response");
+        return -1;
+    }
+
+    if (queue->writing) {
+        // the current writer will pick this up
+        pthread_mutex_unlock(&queue->mutex);
+        return SEND_QUEUED;
+    }
+    queue->writing = true;
+
+    ret = flushResponseQueueLocked(queue, socket_id);
+
+    queue->writing = false;
+    pthread_cond_broadcast(&queue->writerDone);
+    pthread_mutex_unlock(&queue->mutex);
+
+    return ret;
+}
+
+/**
+ * Write a framed response directly, after everything already queued, and
+ * return its own write status. Waits for an active writer to finish first.
+ */
+static int
+writeResponseOrdered (UnsolResponseQueue *queue, struct iovec *iov, int iovcnt,
+        RIL_SOCKET_ID socket_id) {
+    int ret;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->writing) {
+        pthread_cond_wait(&queue->writerDone, &queue->mutex);
+    }
+    queue->writing = true;
+
+    flushResponseQueueLocked(queue, socket_id);
+
+    pthread_mutex_unlock(&queue->mutex);
+    ret = writeResponseRaw(iov, iovcnt, socket_id);
+    pthread_mutex_lock(&queue->mutex);
+
+    // responses queued while we were writing follow ours
+    flushResponseQueueLocked(queue, socket_id);
+
+    queue->writing = false;
+    pthread_cond_broadcast(&queue->writerDone);
+    pthread_mutex_unlock(&queue->mutex);
+
+    return ret;
+}
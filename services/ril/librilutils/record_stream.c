@@ -79,6 +79,7 @@ extern void record_stream_free(RecordStream *rs)
 static unsigned char * getEndOfRecord (unsigned char *p_begin,
                                             unsigned char *p_end)
 {
+    uint32_t header;
     size_t len;
     unsigned char * p_ret;
 
@@ -86,8 +87,9 @@ static unsigned char * getEndOfRecord (unsigned char *p_begin,
         return NULL;
     }
 
-    //First four bytes are length
-    len = ntohl(*((uint32_t *)p_begin));
+    //First four bytes are length; records are packed, so it may be unaligned
+    memcpy(&header, p_begin, HEADER_SIZE);
+    len = ntohl(header);
 
     p_ret = p_begin + HEADER_SIZE + len;
 
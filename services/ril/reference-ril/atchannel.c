@@ -26,6 +26,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -38,7 +39,8 @@
 
 #define NUM_ELEMS(x) (sizeof(x)/sizeof(x[0]))
 
-#define MAX_AT_RESPONSE (8 * 1024)
+#define MAX_AT_RESPONSE (8 * 1024)    /* must be a power of two */
+#define AT_RING_MASK (MAX_AT_RESPONSE - 1)
 #define HANDSHAKE_RETRY_COUNT 8
 #define HANDSHAKE_TIMEOUT_MSEC 250
 
@@ -46,10 +48,17 @@ static pthread_t s_tid_reader;
 static int s_fd = -1;    /* fd of the AT channel */
 static ATUnsolHandler s_unsolHandler;
 
-/* for input buffering */
+/*
+ * for input buffering
+ * s_ATRing is filled by read() and consumed by readline() without moving
+ * partial lines around; indices are free running and masked on access.
+ */
 
-static char s_ATBuffer[MAX_AT_RESPONSE+1];
-static char *s_ATBufferCur = s_ATBuffer;
+static char s_ATRing[MAX_AT_RESPONSE];
+static size_t s_ATRingHead = 0;  /* first unconsumed byte */
+static size_t s_ATRingScan = 0;  /* bytes before this have no EOL in them */
+static size_t s_ATRingTail = 0;  /* next byte read() will fill */
+static char s_ATLine[MAX_AT_RESPONSE+1];  /* line handed out by readline */
 
 #if AT_DEBUG
 void  AT_DUMP(const char*  prefix, const char*  buff, int  len)
@@ -68,10 +77,31 @@ void  AT_DUMP(const char*  prefix, const char*  buff, int  len)
 static pthread_mutex_t s_commandmutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t s_commandcond = PTHREAD_COND_INITIALIZER;
 
-static ATCommandType s_type;
-static const char *s_responsePrefix = NULL;
-static const char *s_smsPDU = NULL;
-static ATResponse *sp_response = NULL;
+/** a command written to the channel and awaiting its final response */
+typedef struct ATCommand {
+    struct ATCommand *p_next;
+    ATCommandType type;
+    const char *responsePrefix;
+    const char *smsPDU;
+    int exclusive;            /* nothing else may be in flight with it */
+    int timedOut;             /* issuer gave up; reader frees it */
+    ATResponse *p_response;
+} ATCommand;
+
+/*
+ * Commands in the order they were written. Response lines are matched to
+ * s_pendingHead, which assumes the modem answers in that order; with a
+ * pipeline depth above 1 that only holds on modems that queue input (see
+ * at_set_pipeline_depth).
+ *
+ * A command whose issuer timed out stays queued as a tombstone until its
+ * final response arrives, so a late response is swallowed instead of being
+ * matched to the next command. Tombstones still hold a pipeline slot.
+ */
+static ATCommand *s_pendingHead = NULL;
+static ATCommand *s_pendingTail = NULL;
+static int s_pendingCount = 0;
+static int s_pipelineDepth = 1;
 
 static void (*s_onTimeout)(void) = NULL;
 static void (*s_onReaderClosed)(void) = NULL;
@@ -112,8 +142,8 @@ static void sleepMsec(long long msec)
 
 
 
-/** add an intermediate response to sp_response*/
-static void addIntermediate(const char *line)
+/** add an intermediate response to p_response */
+static void addIntermediate(ATResponse *p_response, const char *line)
 {
     ATLine *p_new;
 
@@ -124,8 +154,8 @@ static void addIntermediate(const char *line)
     /* note: this adds to the head of the list, so the list
        will be in reverse order of lines received. the order is flipped
        again before passing on to the command issuer */
-    p_new->p_next = sp_response->p_intermediates;
-    sp_response->p_intermediates = p_new;
+    p_new->p_next = p_response->p_intermediates;
+    p_response->p_intermediates = p_new;
 }
 
 
@@ -211,12 +241,64 @@ static int isSMSUnsolicited(const char *line)
 }
 
 
+/** assumes s_commandmutex is held */
+static void unlinkCommand(ATCommand *p_cmd)
+{
+    ATCommand **pp_cur;
+    ATCommand *p_prev = NULL;
+
+    for (pp_cur = &s_pendingHead; *pp_cur != NULL; pp_cur = &(*pp_cur)->p_next) {
+        if (*pp_cur == p_cmd) {
+            *pp_cur = p_cmd->p_next;
+            if (s_pendingTail == p_cmd) {
+                s_pendingTail = p_prev;
+            }
+            p_cmd->p_next = NULL;
+            s_pendingCount--;
+            return;
+        }
+        p_prev = *pp_cur;
+    }
+}
+
+static void freeCommand(ATCommand *p_cmd)
+{
+    at_response_free(p_cmd->p_response);
+    free(p_cmd);
+}
+
+/** assumes s_commandmutex is held */
+static void dropTimedOutCommands()
+{
+    ATCommand *p_cmd = s_pendingHead;
+
+    while (p_cmd != NULL) {
+        ATCommand *p_next = p_cmd->p_next;
+        if (p_cmd->timedOut) {
+            unlinkCommand(p_cmd);
+            freeCommand(p_cmd);
+        }
+        p_cmd = p_next;
+    }
+}
+
 /** assumes s_commandmutex is held */
 static void handleFinalResponse(const char *line)
 {
-    sp_response->finalResponse = strdup(line);
+    ATCommand *p_cmd = s_pendingHead;
+
+    unlinkCommand(p_cmd);
 
-    pthread_cond_signal(&s_commandcond);
+    if (p_cmd->timedOut) {
+        /* late response to a command nobody waits for any more */
+        RLOGD("AT: dropping late final response %s\n", line);
+        freeCommand(p_cmd);
+    } else {
+        p_cmd->p_response->finalResponse = strdup(line);
+    }
+
+    /* wakes the issuer as well as anyone waiting for a pipeline slot */
+    pthread_cond_broadcast(&s_commandcond);
 }
 
 static void handleUnsolicited(const char *line)
@@ -228,31 +310,35 @@ static void handleUnsolicited(const char *line)
 
 static void processLine(const char *line)
 {
+    ATCommand *p_cmd;
+
     pthread_mutex_lock(&s_commandmutex);
 
-    if (sp_response == NULL) {
+    p_cmd = s_pendingHead;
+
+    if (p_cmd == NULL) {
         /* no command pending */
         handleUnsolicited(line);
     } else if (isFinalResponseSuccess(line)) {
-        sp_response->success = 1;
+        p_cmd->p_response->success = 1;
         handleFinalResponse(line);
     } else if (isFinalResponseError(line)) {
-        sp_response->success = 0;
+        p_cmd->p_response->success = 0;
         handleFinalResponse(line);
-    } else if (s_smsPDU != NULL && 0 == strcmp(line, "> ")) {
+    } else if (p_cmd->smsPDU != NULL && 0 == strcmp(line, "> ")) {
         // See eg. TS 27.005 4.3
         // Commands like AT+CMGS have a "> " prompt
-        writeCtrlZ(s_smsPDU);
-        s_smsPDU = NULL;
-    } else switch (s_type) {
+        writeCtrlZ(p_cmd->smsPDU);
+        p_cmd->smsPDU = NULL;
+    } else switch (p_cmd->type) {
         case NO_RESULT:
             handleUnsolicited(line);
             break;
         case NUMERIC:
-            if (sp_response->p_intermediates == NULL
+            if (p_cmd->p_response->p_intermediates == NULL
                 && isdigit(line[0])
             ) {
-                addIntermediate(line);
+                addIntermediate(p_cmd->p_response, line);
             } else {
                 /* either we already have an intermediate response or
                    the line doesn't begin with a digit */
@@ -260,25 +346,25 @@ static void processLine(const char *line)
             }
             break;
         case SINGLELINE:
-            if (sp_response->p_intermediates == NULL
-                && strStartsWith (line, s_responsePrefix)
+            if (p_cmd->p_response->p_intermediates == NULL
+                && strStartsWith (line, p_cmd->responsePrefix)
             ) {
-                addIntermediate(line);
+                addIntermediate(p_cmd->p_response, line);
             } else {
                 /* we already have an intermediate response */
                 handleUnsolicited(line);
             }
             break;
         case MULTILINE:
-            if (strStartsWith (line, s_responsePrefix)) {
-                addIntermediate(line);
+            if (strStartsWith (line, p_cmd->responsePrefix)) {
+                addIntermediate(p_cmd->p_response, line);
             } else {
                 handleUnsolicited(line);
             }
         break;
 
         default: /* this should never be reached */
-            RLOGE("Unsupported AT command type %d\n", s_type);
+            RLOGE("Unsupported AT command type %d\n", p_cmd->type);
             handleUnsolicited(line);
         break;
     }
@@ -288,22 +374,22 @@ static void processLine(const char *line)
 
 
 /**
- * Returns a pointer to the end of the next line
- * special-cases the "> " SMS prompt
- *
- * returns NULL if there is no complete line
+ * Copies "len" bytes starting at ring index "start" into s_ATLine
+ * and NUL terminates it. Handles lines that wrap around the ring end.
  */
-static char * findNextEOL(char *cur)
+static const char *copyLineOut(size_t start, size_t len)
 {
-    if (cur[0] == '>' && cur[1] == ' ' && cur[2] == '\0') {
-        /* SMS prompt character...not \r terminated */
-        return cur+2;
-    }
+    size_t offset = start & AT_RING_MASK;
+    size_t first = MAX_AT_RESPONSE - offset;
 
-    // Find next newline
-    while (*cur != '\0' && *cur != '\r' && *cur != '\n') cur++;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(s_ATLine, s_ATRing + offset, first);
+    memcpy(s_ATLine + first, s_ATRing, len - first);
+    s_ATLine[len] = '\0';
 
-    return *cur == '\0' ? NULL : cur;
+    return s_ATLine;
 }
 
 
@@ -320,69 +406,70 @@ static char * findNextEOL(char *cur)
 static const char *readline()
 {
     ssize_t count;
+    const char *ret;
 
-    char *p_read = NULL;
-    char *p_eol = NULL;
-    char *ret;
-
-    /* this is a little odd. I use *s_ATBufferCur == 0 to
-     * mean "buffer consumed completely". If it points to a character, than
-     * the buffer continues until a \0
-     */
-    if (*s_ATBufferCur == '\0') {
-        /* empty buffer */
-        s_ATBufferCur = s_ATBuffer;
-        *s_ATBufferCur = '\0';
-        p_read = s_ATBuffer;
-    } else {   /* *s_ATBufferCur != '\0' */
-        /* there's data in the buffer from the last read */
-
+    for (;;) {
         // skip over leading newlines
-        while (*s_ATBufferCur == '\r' || *s_ATBufferCur == '\n')
-            s_ATBufferCur++;
-
-        p_eol = findNextEOL(s_ATBufferCur);
+        while (s_ATRingHead != s_ATRingTail) {
+            char c = s_ATRing[s_ATRingHead & AT_RING_MASK];
+            if (c != '\r' && c != '\n') {
+                break;
+            }
+            s_ATRingHead++;
+        }
+        if (s_ATRingScan < s_ATRingHead) {
+            s_ATRingScan = s_ATRingHead;
+        }
 
-        if (p_eol == NULL) {
-            /* a partial line. move it up and prepare to read more */
-            size_t len;
+        // Find next newline, resuming where the last scan stopped
+        while (s_ATRingScan != s_ATRingTail) {
+            char c = s_ATRing[s_ATRingScan & AT_RING_MASK];
+            if (c == '\r' || c == '\n') {
+                break;
+            }
+            s_ATRingScan++;
+        }
 
-            len = strlen(s_ATBufferCur);
+        if (s_ATRingScan != s_ATRingTail) {
+            /* a full line in the buffer */
+            ret = copyLineOut(s_ATRingHead, s_ATRingScan - s_ATRingHead);
+            s_ATRingHead = s_ATRingScan + 1;
+            s_ATRingScan = s_ATRingHead;
+            break;
+        }
 
-            memmove(s_ATBuffer, s_ATBufferCur, len + 1);
-            p_read = s_ATBuffer + len;
-            s_ATBufferCur = s_ATBuffer;
+        if (s_ATRingTail - s_ATRingHead == 2
+            && s_ATRing[s_ATRingHead & AT_RING_MASK] == '>'
+            && s_ATRing[(s_ATRingHead + 1) & AT_RING_MASK] == ' '
+        ) {
+            /* SMS prompt character...not \r terminated */
+            ret = copyLineOut(s_ATRingHead, 2);
+            s_ATRingHead = s_ATRingScan = s_ATRingTail;
+            break;
         }
-        /* Otherwise, (p_eol !- NULL) there is a complete line  */
-        /* that will be returned the while () loop below        */
-    }
 
-    while (p_eol == NULL) {
-        if (0 == MAX_AT_RESPONSE - (p_read - s_ATBuffer)) {
+        if (s_ATRingTail - s_ATRingHead == MAX_AT_RESPONSE) {
             RLOGE("ERROR: Input line exceeded buffer\n");
             /* ditch buffer and start over again */
-            s_ATBufferCur = s_ATBuffer;
-            *s_ATBufferCur = '\0';
-            p_read = s_ATBuffer;
+            s_ATRingHead = s_ATRingScan = s_ATRingTail;
+        }
+
+        /* read into the free space up to the physical end of the ring */
+        size_t offset = s_ATRingTail & AT_RING_MASK;
+        size_t space = MAX_AT_RESPONSE - (s_ATRingTail - s_ATRingHead);
+        if (space > MAX_AT_RESPONSE - offset) {
+            space = MAX_AT_RESPONSE - offset;
         }
 
         do {
-            count = read(s_fd, p_read,
-                            MAX_AT_RESPONSE - (p_read - s_ATBuffer));
+            count = read(s_fd, s_ATRing + offset, space);
         } while (count < 0 && errno == EINTR);
 
         if (count > 0) {
-            AT_DUMP( "<< ", p_read, count );
-
-            p_read[count] = '\0';
-
-            // skip over leading newlines
-            while (*s_ATBufferCur == '\r' || *s_ATBufferCur == '\n')
-                s_ATBufferCur++;
+            AT_DUMP( "<< ", s_ATRing + offset, count );
 
-            p_eol = findNextEOL(s_ATBufferCur);
-            p_read += count;
-        } else if (count <= 0) {
+            s_ATRingTail += count;
+        } else {
             /* read error encountered or EOF reached */
             if(count == 0) {
                 RLOGD("atchannel: EOF reached");
@@ -393,13 +480,6 @@ static const char *readline()
         }
     }
 
-    /* a full line in the buffer. Place a \0 over the \r and return */
-
-    ret = s_ATBufferCur;
-    *p_eol = '\0';
-    s_ATBufferCur = p_eol + 1; /* this will always be <= p_read,    */
-                              /* and there will be a \0 at *p_read */
-
     RLOGD("AT< %s\n", ret);
     return ret;
 }
@@ -407,16 +487,20 @@ static const char *readline()
 
 static void onReaderClosed()
 {
-    if (s_onReaderClosed != NULL && s_readerClosed == 0) {
+    int wasClosed;
 
-        pthread_mutex_lock(&s_commandmutex);
+    pthread_mutex_lock(&s_commandmutex);
 
-        s_readerClosed = 1;
+    wasClosed = s_readerClosed;
+    s_readerClosed = 1;
+    dropTimedOutCommands();
 
-        pthread_cond_signal(&s_commandcond);
+    /* every issuer and slot waiter has to see the close */
+    pthread_cond_broadcast(&s_commandcond);
 
-        pthread_mutex_unlock(&s_commandmutex);
+    pthread_mutex_unlock(&s_commandmutex);
 
+    if (s_onReaderClosed != NULL && wasClosed == 0) {
         s_onReaderClosed();
     }
 }
@@ -463,102 +547,78 @@ static void *readerLoop(void *arg __unused)
 }
 
 /**
- * Sends string s to the radio with a \r appended.
+ * Sends string s followed by the single character terminator in one
+ * write where possible.
  * Returns AT_ERROR_* on error, 0 on success
- *
- * This function exists because as of writing, android libc does not
- * have buffered stdio.
  */
-static int writeline (const char *s)
+static int writeTerminated (const char *s, const char *terminator)
 {
-    size_t cur = 0;
-    size_t len = strlen(s);
+    struct iovec iov[2];
+    struct iovec *p_iov = iov;
+    int iovcnt = 2;
     ssize_t written;
 
     if (s_fd < 0 || s_readerClosed > 0) {
         return AT_ERROR_CHANNEL_CLOSED;
     }
 
-    RLOGD("AT> %s\n", s);
-
-    AT_DUMP( ">> ", s, strlen(s) );
+    iov[0].iov_base = (void *) s;
+    iov[0].iov_len = strlen(s);
+    iov[1].iov_base = (void *) terminator;
+    iov[1].iov_len = 1;
 
-    /* the main string */
-    while (cur < len) {
+    while (iovcnt > 0) {
         do {
-            written = write (s_fd, s + cur, len - cur);
-        } while (written < 0 && errno == EINTR);
+            written = writev (s_fd, p_iov, iovcnt);
+        } while ((written < 0 && errno == EINTR) || (written == 0));
 
         if (written < 0) {
             return AT_ERROR_GENERIC;
         }
 
-        cur += written;
-    }
-
-    /* the \r  */
-
-    do {
-        written = write (s_fd, "\r" , 1);
-    } while ((written < 0 && errno == EINTR) || (written == 0));
-
-    if (written < 0) {
-        return AT_ERROR_GENERIC;
+        while (iovcnt > 0 && (size_t) written >= p_iov->iov_len) {
+            written -= p_iov->iov_len;
+            p_iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            p_iov->iov_base = (char *) p_iov->iov_base + written;
+            p_iov->iov_len -= written;
+        }
     }
 
     return 0;
 }
-static int writeCtrlZ (const char *s)
-{
-    size_t cur = 0;
-    size_t len = strlen(s);
-    ssize_t written;
 
+/**
+ * Sends string s to the radio with a \r appended.
+ * Returns AT_ERROR_* on error, 0 on success
+ */
+static int writeline (const char *s)
+{
     if (s_fd < 0 || s_readerClosed > 0) {
         return AT_ERROR_CHANNEL_CLOSED;
     }
 
-    RLOGD("AT> %s^Z\n", s);
-
-    AT_DUMP( ">* ", s, strlen(s) );
-
-    /* the main string */
-    while (cur < len) {
-        do {
-            written = write (s_fd, s + cur, len - cur);
-        } while (written < 0 && errno == EINTR);
-
-        if (written < 0) {
-            return AT_ERROR_GENERIC;
-        }
-
-        cur += written;
-    }
-
-    /* the ^Z  */
-
-    do {
-        written = write (s_fd, "\032" , 1);
-    } while ((written < 0 && errno == EINTR) || (written == 0));
+    RLOGD("AT> %s\n", s);
 
-    if (written < 0) {
-        return AT_ERROR_GENERIC;
-    }
+    AT_DUMP( ">> ", s, strlen(s) );
 
-    return 0;
+    return writeTerminated(s, "\r");
 }
 
-static void clearPendingCommand()
+static int writeCtrlZ (const char *s)
 {
-    if (sp_response != NULL) {
-        at_response_free(sp_response);
+    if (s_fd < 0 || s_readerClosed > 0) {
+        return AT_ERROR_CHANNEL_CLOSED;
     }
 
-    sp_response = NULL;
-    s_responsePrefix = NULL;
-    s_smsPDU = NULL;
-}
+    RLOGD("AT> %s^Z\n", s);
+
+    AT_DUMP( ">* ", s, strlen(s) );
 
+    return writeTerminated(s, "\032");
+}
 
 /**
  * Starts AT handler on stream "fd'
@@ -574,9 +634,11 @@ int at_open(int fd, ATUnsolHandler h)
     s_unsolHandler = h;
     s_readerClosed = 0;
 
-    s_responsePrefix = NULL;
-    s_smsPDU = NULL;
-    sp_response = NULL;
+    s_pendingHead = NULL;
+    s_pendingTail = NULL;
+    s_pendingCount = 0;
+
+    s_ATRingHead = s_ATRingScan = s_ATRingTail = 0;
 
     pthread_attr_init (&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
@@ -595,16 +657,18 @@ int at_open(int fd, ATUnsolHandler h)
 /* FIXME is it ok to call this from the reader and the command thread? */
 void at_close()
 {
+    pthread_mutex_lock(&s_commandmutex);
+
     if (s_fd >= 0) {
         close(s_fd);
     }
     s_fd = -1;
 
-    pthread_mutex_lock(&s_commandmutex);
-
     s_readerClosed = 1;
+    dropTimedOutCommands();
 
-    pthread_cond_signal(&s_commandcond);
+    /* every issuer and slot waiter has to see the close */
+    pthread_cond_broadcast(&s_commandcond);
 
     pthread_mutex_unlock(&s_commandmutex);
 
@@ -658,72 +722,152 @@ static void reverseIntermediates(ATResponse *p_response)
 }
 
 /**
- * Internal send_command implementation
- * Doesn't lock or call the timeout callback
+ * Writes a command and queues it for response matching, first waiting
+ * for a free pipeline slot. Commands carrying an SMS PDU wait for the "> "
+ * prompt, so they are only ever in flight on their own.
+ * On success *pp_cmd is the queued command, to be passed to waitCommand.
+ * Assumes s_commandmutex is held
  *
- * timeoutMsec == 0 means infinite timeout
+ * p_ts == NULL means infinite timeout
  */
-
-static int at_send_command_full_nolock (const char *command, ATCommandType type,
-                    const char *responsePrefix, const char *smspdu,
-                    long long timeoutMsec, ATResponse **pp_outResponse)
+static int startCommand (ATCommand **pp_cmd, const char *command,
+                    ATCommandType type, const char *responsePrefix,
+                    const char *smspdu, const struct timespec *p_ts)
 {
-    int err = 0;
-    struct timespec ts;
+    int err;
+    ATCommand *p_cmd;
+
+    *pp_cmd = NULL;
+
+    while (s_readerClosed == 0
+        && (s_pendingCount >= s_pipelineDepth
+            || (s_pendingHead != NULL
+                && (smspdu != NULL || s_pendingHead->exclusive)))
+    ) {
+        if (p_ts != NULL) {
+            err = pthread_cond_timedwait(&s_commandcond, &s_commandmutex, p_ts);
+        } else {
+            err = pthread_cond_wait(&s_commandcond, &s_commandmutex);
+        }
+
+        if (err == ETIMEDOUT) {
+            return AT_ERROR_TIMEOUT;
+        }
+    }
+
+    if (s_readerClosed > 0) {
+        return AT_ERROR_CHANNEL_CLOSED;
+    }
 
-    if(sp_response != NULL) {
-        err = AT_ERROR_COMMAND_PENDING;
-        goto error;
+    p_cmd = (ATCommand *) calloc(1, sizeof(ATCommand));
+    if (p_cmd == NULL) {
+        return AT_ERROR_GENERIC;
     }
 
     err = writeline (command);
 
     if (err < 0) {
-        goto error;
+        free(p_cmd);
+        return err;
     }
 
-    s_type = type;
-    s_responsePrefix = responsePrefix;
-    s_smsPDU = smspdu;
-    sp_response = at_response_new();
+    p_cmd->type = type;
+    p_cmd->responsePrefix = responsePrefix;
+    p_cmd->smsPDU = smspdu;
+    p_cmd->exclusive = (smspdu != NULL);
+    p_cmd->p_response = at_response_new();
 
-    if (timeoutMsec != 0) {
-        setTimespecRelative(&ts, timeoutMsec);
+    if (s_pendingTail != NULL) {
+        s_pendingTail->p_next = p_cmd;
+    } else {
+        s_pendingHead = p_cmd;
     }
+    s_pendingTail = p_cmd;
+    s_pendingCount++;
+
+    *pp_cmd = p_cmd;
+    return 0;
+}
+
+/**
+ * Waits for the final response of a command issued with startCommand,
+ * which it then frees. On timeout the command is left queued as a
+ * tombstone for the reader to free when its response finally arrives.
+ * Assumes s_commandmutex is held
+ *
+ * p_ts == NULL means infinite timeout
+ */
+static int waitCommand (ATCommand *p_cmd, const struct timespec *p_ts,
+                    ATResponse **pp_outResponse)
+{
+    int err;
 
-    while (sp_response->finalResponse == NULL && s_readerClosed == 0) {
-        if (timeoutMsec != 0) {
-            err = pthread_cond_timedwait(&s_commandcond, &s_commandmutex, &ts);
+    while (p_cmd->p_response->finalResponse == NULL && s_readerClosed == 0) {
+        if (p_ts != NULL) {
+            err = pthread_cond_timedwait(&s_commandcond, &s_commandmutex, p_ts);
         } else {
             err = pthread_cond_wait(&s_commandcond, &s_commandmutex);
         }
 
-        if (err == ETIMEDOUT) {
-            err = AT_ERROR_TIMEOUT;
-            goto error;
+        if (err == ETIMEDOUT && p_cmd->p_response->finalResponse == NULL
+            && s_readerClosed == 0
+        ) {
+            /* the PDU belongs to the caller; the prompt can't be answered */
+            p_cmd->timedOut = 1;
+            p_cmd->smsPDU = NULL;
+            return AT_ERROR_TIMEOUT;
         }
     }
 
+    /* still queued if the channel closed under us */
+    unlinkCommand(p_cmd);
+
     if (pp_outResponse == NULL) {
-        at_response_free(sp_response);
+        at_response_free(p_cmd->p_response);
     } else {
         /* line reader stores intermediate responses in reverse order */
-        reverseIntermediates(sp_response);
-        *pp_outResponse = sp_response;
+        reverseIntermediates(p_cmd->p_response);
+        *pp_outResponse = p_cmd->p_response;
     }
 
-    sp_response = NULL;
+    p_cmd->p_response = NULL;
+    free(p_cmd);
 
     if(s_readerClosed > 0) {
-        err = AT_ERROR_CHANNEL_CLOSED;
-        goto error;
+        return AT_ERROR_CHANNEL_CLOSED;
     }
 
-    err = 0;
-error:
-    clearPendingCommand();
+    return 0;
+}
 
-    return err;
+/**
+ * Internal send_command implementation
+ * Doesn't lock or call the timeout callback
+ *
+ * timeoutMsec == 0 means infinite timeout
+ */
+
+static int at_send_command_full_nolock (const char *command, ATCommandType type,
+                    const char *responsePrefix, const char *smspdu,
+                    long long timeoutMsec, ATResponse **pp_outResponse)
+{
+    int err;
+    ATCommand *p_cmd;
+    struct timespec ts;
+    struct timespec *p_ts = NULL;
+
+    if (timeoutMsec != 0) {
+        setTimespecRelative(&ts, timeoutMsec);
+        p_ts = &ts;
+    }
+
+    err = startCommand(&p_cmd, command, type, responsePrefix, smspdu, p_ts);
+
+    if (err < 0) {
+        return err;
+    }
+
+    return waitCommand(p_cmd, p_ts, pp_outResponse);
 }
 
 /**
@@ -860,6 +1004,95 @@ int at_send_command_multiline (const char *command,
 }
 
 
+/**
+ * Issue several independent commands, keeping up to the pipeline depth
+ * (see at_set_pipeline_depth) of them in flight at once. Each entry gets
+ * its own response and error code, exactly as if it had been sent with
+ * the matching at_send_command_* call.
+ *
+ * Returns 0 if every command succeeded, otherwise the first error seen
+ */
+int at_send_command_batch (ATBatchCommand *p_commands, int count)
+{
+    int i;
+    int err = 0;
+    ATCommand **cmds;
+
+    if (0 != pthread_equal(s_tid_reader, pthread_self())) {
+        /* cannot be called from reader thread */
+        return AT_ERROR_INVALID_THREAD;
+    }
+
+    cmds = (ATCommand **) calloc(count, sizeof(ATCommand *));
+    if (cmds == NULL) {
+        return AT_ERROR_GENERIC;
+    }
+
+    pthread_mutex_lock(&s_commandmutex);
+
+    for (i = 0 ; i < count ; i++) {
+        p_commands[i].p_response = NULL;
+        p_commands[i].err = startCommand(&cmds[i], p_commands[i].command,
+                    p_commands[i].type, p_commands[i].responsePrefix,
+                    NULL, NULL);
+    }
+
+    for (i = 0 ; i < count ; i++) {
+        if (p_commands[i].err < 0) {
+            continue;
+        }
+
+        p_commands[i].err = waitCommand(cmds[i], NULL,
+                    &p_commands[i].p_response);
+
+        if (p_commands[i].err == 0
+            && (p_commands[i].type == SINGLELINE
+                || p_commands[i].type == NUMERIC)
+            && p_commands[i].p_response->success > 0
+            && p_commands[i].p_response->p_intermediates == NULL
+        ) {
+            /* successful command must have an intermediate response */
+            at_response_free(p_commands[i].p_response);
+            p_commands[i].p_response = NULL;
+            p_commands[i].err = AT_ERROR_INVALID_RESPONSE;
+        }
+    }
+
+    pthread_mutex_unlock(&s_commandmutex);
+
+    free(cmds);
+
+    for (i = 0 ; i < count ; i++) {
+        if (p_commands[i].err < 0) {
+            err = p_commands[i].err;
+            break;
+        }
+    }
+
+    return err;
+}
+
+
+/**
+ * Sets how many commands may be written before the final response of the
+ * oldest one arrives. 1 (the default) keeps the channel strictly serial.
+ *
+ * Only raise it for modems known to queue input while a command runs.
+ * V.250 lets a DCE abort the command in progress when further characters
+ * arrive, and such a modem would drop or misanswer pipelined commands.
+ */
+void at_set_pipeline_depth(int depth)
+{
+    pthread_mutex_lock(&s_commandmutex);
+
+    s_pipelineDepth = depth < 1 ? 1 : depth;
+
+    pthread_cond_broadcast(&s_commandcond);
+
+    pthread_mutex_unlock(&s_commandmutex);
+}
+
+
 /** This callback is invoked on the command thread */
 void at_set_on_timeout(void (*onTimeout)(void))
 {
@@ -904,6 +1137,10 @@ int at_handshake()
         if (err == 0) {
             break;
         }
+
+        /* a modem that is still starting up may never answer; don't let
+           the unanswered attempts hold the slot the retry needs */
+        dropTimedOutCommands();
     }
 
     if (err == 0) {
@@ -32,6 +32,8 @@ extern void  AT_DUMP(const char* prefix, const char*  buff, int  len);
 #endif
 
 #define AT_ERROR_GENERIC -1
+/* No longer returned: a command issued while others are in flight waits
+   for a pipeline slot (see at_set_pipeline_depth) instead of failing */
 #define AT_ERROR_COMMAND_PENDING -2
 #define AT_ERROR_CHANNEL_CLOSED -3
 #define AT_ERROR_TIMEOUT -4
@@ -101,6 +103,26 @@ int at_send_command_multiline (const char *command,
 
 int at_handshake();
 
+/** one command of an at_send_command_batch() call */
+typedef struct {
+    const char *command;         /* in: command, without \r */
+    ATCommandType type;          /* in: NO_RESULT, NUMERIC, ... */
+    const char *responsePrefix;  /* in: for SINGLELINE and MULTILINE */
+    ATResponse *p_response;      /* out: free with at_response_free() */
+    int err;                     /* out: 0 or AT_ERROR_* */
+} ATBatchCommand;
+
+int at_send_command_batch (ATBatchCommand *p_commands, int count);
+
+/* Maximum number of commands in flight at once; 1 (default) is serial.
+   Only use more than 1 on modems known to queue input: V.250 allows a
+   modem to abort the running command when new characters arrive.
+   Callers beyond the limit block until an earlier command completes, and
+   a command that timed out keeps its slot until its late final response
+   arrives (or the channel closes) so that response is not handed to the
+   next command. */
+void at_set_pipeline_depth(int depth);
+
 int at_send_command (const char *command, ATResponse **pp_outResponse);
 
 int at_send_command_sms (const char *command, const char *pdu,
@@ -35,6 +35,7 @@
 #include <sys/socket.h>
 #include <cutils/sockets2.h>
 #include <termios.h>
+#include <time.h>
 #include <sys/system_properties.h>
 #ifndef ANDROID
 #include <limits.h>
@@ -216,6 +217,14 @@ static int s_port = -1;
 static const char * s_device_path = NULL;
 static int          s_device_socket = 0;
 
+/* max AT commands in flight, see at_set_pipeline_depth(); keep 1 unless
+   the modem is known to queue input */
+static int s_at_pipeline_depth = 1;
+
+/* AT+CLCC fallback poll back-off bounds, see setCallPollBackoff() */
+static int s_call_poll_min_ms = 500;
+static int s_call_poll_max_ms = 8000;
+
 /* trigger change to this with s_state_cond */
 static int s_closed = 0;
 
@@ -224,7 +233,6 @@ static char sATBuffer[MAX_AT_RESPONSE+1];
 static char *sATBufferCur = NULL;
 
 static const struct timeval TIMEVAL_SIMPOLL = {1,0};
-static const struct timeval TIMEVAL_CALLSTATEPOLL = {0,500000};
 static const struct timeval TIMEVAL_0 = {0,0};
 
 static int s_ims_registered  = 0;        // 0==unregistered
@@ -446,17 +454,28 @@ static void requestOrSendDataCallList(RIL_Token *t)
     int err;
     int n = 0;
     char *out;
+    /* the two queries are independent, so let them share the pipeline */
+    ATBatchCommand queries[] = {
+        { "AT+CGACT?", MULTILINE, "+CGACT:", NULL, 0 },
+        { "AT+CGDCONT?", MULTILINE, "+CGDCONT:", NULL, 0 },
+    };
 
-    err = at_send_command_multiline ("AT+CGACT?", "+CGACT:", &p_response);
-    if (err != 0 || p_response->success == 0) {
+    at_send_command_batch(queries, 2);
+
+    if (queries[0].err != 0 || queries[0].p_response->success == 0
+        || queries[1].err != 0 || queries[1].p_response->success == 0) {
         if (t != NULL)
             RIL_onRequestComplete(*t, RIL_E_GENERIC_FAILURE, NULL, 0);
         else
             RIL_onUnsolicitedResponse(RIL_UNSOL_DATA_CALL_LIST_CHANGED,
                                       NULL, 0);
+        at_response_free(queries[0].p_response);
+        at_response_free(queries[1].p_response);
         return;
     }
 
+    p_response = queries[0].p_response;
+
     for (p_cur = p_response->p_intermediates; p_cur != NULL;
          p_cur = p_cur->p_next)
         n++;
@@ -501,15 +520,7 @@ static void requestOrSendDataCallList(RIL_Token *t)
 
     at_response_free(p_response);
 
-    err = at_send_command_multiline ("AT+CGDCONT?", "+CGDCONT:", &p_response);
-    if (err != 0 || p_response->success == 0) {
-        if (t != NULL)
-            RIL_onRequestComplete(*t, RIL_E_GENERIC_FAILURE, NULL, 0);
-        else
-            RIL_onUnsolicitedResponse(RIL_UNSOL_DATA_CALL_LIST_CHANGED,
-                                      NULL, 0);
-        return;
-    }
+    p_response = queries[1].p_response;
 
     for (p_cur = p_response->p_intermediates; p_cur != NULL;
          p_cur = p_cur->p_next) {
@@ -632,6 +643,8 @@ error:
                                   NULL, 0);
 
     at_response_free(p_response);
+    if (p_response != queries[1].p_response)
+        at_response_free(queries[1].p_response);
 }
 
 static void requestQueryNetworkSelectionMode(
@@ -678,6 +691,231 @@ static void sendCallStateChanged(void *param __unused)
         NULL, 0);
 }
 
+/*
+ * Call, registration and signal state tracked from unsolicited result codes.
+ *
+ * RING, +CRING, NO CARRIER and +CCWA report call list changes on their own,
+ * so AT+CLCC is only re-polled while a call sits in a transitional state
+ * the modem may not announce. A transitional call is always polled every
+ * s_call_poll_min_ms. Only when every call is stable (the POLL_CALL_STATE
+ * build polls those too) does the interval double up to s_call_poll_max_ms
+ * for as long as the call list stays the same; any call URC cancels the
+ * poll and restarts the back-off.
+ *
+ * +CREG/+CGREG URCs only reach the framework when stat, lac or cid actually
+ * changed, and a recent +CSQ URC answers RIL_REQUEST_SIGNAL_STRENGTH without
+ * going to the modem.
+ */
+
+/* how long a +CSQ URC stands in for AT+CSQ */
+#define SIGNAL_URC_MAX_AGE_MS 10000
+
+#define SIGNAL_STRENGTH_LEN (sizeof(RIL_SignalStrength_v6)/sizeof(int))
+
+static pthread_mutex_t s_urc_state_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int s_call_poll_interval_ms = 0;     // 0 when no poll is armed
+static intptr_t s_call_poll_generation = 0; // stale polls carry an older one
+static unsigned s_call_list_signature = 0;
+
+/* last known stat, lac, cid; -1 when unknown */
+static int s_creg_state[3] = { -1, -1, -1 };
+static int s_cgreg_state[3] = { -1, -1, -1 };
+
+static int s_signal_urc[SIGNAL_STRENGTH_LEN];
+static int64_t s_signal_urc_time_ms = 0;    // 0 when no +CSQ URC is cached
+
+static int64_t monotonicTimeMs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Parses "-b <min ms>[:<max ms>]". A single value polls at a fixed
+ * interval, which is the behaviour before back-off was added. Only the
+ * POLL_CALL_STATE build polls stable calls, so elsewhere <max ms> is unused
+ * and transitional calls are polled every <min ms>.
+ */
+static int setCallPollBackoff(const char *arg)
+{
+    char *end;
+    long min, max;
+
+    min = strtol(arg, &end, 10);
+    max = min;
+    if (*end == ':') {
+        max = strtol(end + 1, &end, 10);
+    }
+
+    if (*end != '\0' || min <= 0 || max < min || max > INT_MAX / 2) {
+        RLOGE("invalid call poll back-off %s\n", arg);
+        return -1;
+    }
+
+    s_call_poll_min_ms = (int)min;
+    s_call_poll_max_ms = (int)max;
+    return 0;
+}
+
+static void pollCallState(void *param)
+{
+    int current;
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+    current = ((intptr_t)param == s_call_poll_generation);
+    pthread_mutex_unlock(&s_urc_state_mutex);
+
+    if (current) {
+        sendCallStateChanged(NULL);
+    }
+}
+
+/**
+ * Arms the AT+CLCC fallback poll. signature identifies the call list just
+ * read; the interval doubles while it stays unchanged between polls and
+ * no call in it is transitional.
+ */
+static void scheduleCallStatePoll(unsigned signature, int transitional)
+{
+    struct timeval tv;
+    void *param;
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+
+    if (transitional || s_call_poll_interval_ms == 0
+            || signature != s_call_list_signature) {
+        s_call_poll_interval_ms = s_call_poll_min_ms;
+    } else if (s_call_poll_interval_ms < s_call_poll_max_ms) {
+        s_call_poll_interval_ms *= 2;
+        if (s_call_poll_interval_ms > s_call_poll_max_ms) {
+            s_call_poll_interval_ms = s_call_poll_max_ms;
+        }
+    }
+    s_call_list_signature = signature;
+    param = (void *)++s_call_poll_generation;
+
+    tv.tv_sec = s_call_poll_interval_ms / 1000;
+    tv.tv_usec = (s_call_poll_interval_ms % 1000) * 1000;
+
+    pthread_mutex_unlock(&s_urc_state_mutex);
+
+    RIL_requestTimedCallback (pollCallState, param, &tv);
+}
+
+/** Drops any armed fallback poll; the next one starts from the minimum */
+static void cancelCallStatePoll()
+{
+    pthread_mutex_lock(&s_urc_state_mutex);
+    s_call_poll_generation++;
+    s_call_poll_interval_ms = 0;
+    pthread_mutex_unlock(&s_urc_state_mutex);
+}
+
+/** Forgets everything learnt from URCs, e.g. across radio power changes */
+static void resetUrcState()
+{
+    cancelCallStatePoll();
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+    memset(s_creg_state, -1, sizeof(s_creg_state));
+    memset(s_cgreg_state, -1, sizeof(s_cgreg_state));
+    s_signal_urc_time_ms = 0;
+    pthread_mutex_unlock(&s_urc_state_mutex);
+}
+
+/**
+ * Stores stat, lac and cid from a parsed registration response.
+ * Returns 1 if they differ from what was stored before.
+ */
+static int rememberRegistrationState(int *cached, const int *registration)
+{
+    int changed;
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+    changed = memcmp(cached, registration, 3 * sizeof(int)) != 0;
+    memcpy(cached, registration, 3 * sizeof(int));
+    pthread_mutex_unlock(&s_urc_state_mutex);
+
+    return changed;
+}
+
+/**
+ * Reads up to count integers from a +CSQ line; missing trailing fields are
+ * set to -1. Returns the number of fields present or -1 on error.
+ */
+static int parseSignalStrength(char *line, int *response, int count)
+{
+    int i, parsed;
+
+    if (at_tok_start(&line) < 0) {
+        return -1;
+    }
+
+    for (parsed = 0; parsed < count; parsed++) {
+        if (at_tok_nextint(&line, &response[parsed]) < 0) {
+            break;
+        }
+    }
+
+    for (i = parsed; i < count; i++) {
+        response[i] = -1;
+    }
+
+    return parsed;
+}
+
+/** Called on the reader thread for a +CSQ URC */
+static void onSignalStrengthUrc(const char *s)
+{
+    char *line;
+    int response[SIGNAL_STRENGTH_LEN];
+    int changed;
+
+    line = strdup(s);
+    if (!line) {
+        RLOGE("+CSQ: Unable to allocate memory");
+        return;
+    }
+
+    if (parseSignalStrength(line, response, SIGNAL_STRENGTH_LEN) < 2) {
+        RLOGE("invalid +CSQ URC: %s", s);
+        free(line);
+        return;
+    }
+    free(line);
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+    changed = s_signal_urc_time_ms == 0
+            || memcmp(s_signal_urc, response, sizeof(response)) != 0;
+    memcpy(s_signal_urc, response, sizeof(response));
+    s_signal_urc_time_ms = monotonicTimeMs();
+    pthread_mutex_unlock(&s_urc_state_mutex);
+
+    if (changed) {
+        RIL_onUnsolicitedResponse(RIL_UNSOL_SIGNAL_STRENGTH,
+                response, sizeof(response));
+    }
+}
+
+/** Copies the last +CSQ URC into response if it is recent enough */
+static int getCachedSignalStrength(int *response)
+{
+    int fresh;
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+    fresh = s_signal_urc_time_ms != 0
+            && monotonicTimeMs() - s_signal_urc_time_ms < SIGNAL_URC_MAX_AGE_MS;
+    if (fresh) {
+        memcpy(response, s_signal_urc, sizeof(s_signal_urc));
+    }
+    pthread_mutex_unlock(&s_urc_state_mutex);
+
+    return fresh;
+}
+
 static void requestGetCurrentCalls(void *data __unused, size_t datalen __unused, RIL_Token t)
 {
     int err;
@@ -689,6 +927,7 @@ static void requestGetCurrentCalls(void *data __unused, size_t datalen __unused,
     RIL_Call **pp_calls;
     int i;
     int needRepoll = 0;
+    unsigned signature = 0;
 
 #ifdef WORKAROUND_ERRONEOUS_ANSWER
     int prevIncomingOrWaitingLine;
@@ -747,6 +986,10 @@ static void requestGetCurrentCalls(void *data __unused, size_t datalen __unused,
             needRepoll = 1;
         }
 
+        signature = signature * 31
+                + p_calls[countValidCalls].index * 8
+                + p_calls[countValidCalls].state;
+
         countValidCalls++;
     }
 
@@ -792,7 +1035,9 @@ static void requestGetCurrentCalls(void *data __unused, size_t datalen __unused,
 #else
     if (needRepoll) {
 #endif
-        RIL_requestTimedCallback (sendCallStateChanged, NULL, &TIMEVAL_CALLSTATEPOLL);
+        scheduleCallStatePoll(signature, needRepoll);
+    } else {
+        cancelCallStatePoll();
     }
 
     return;
@@ -885,6 +1130,11 @@ static void requestSignalStrength(void *data __unused, size_t datalen __unused,
     int numofElements=sizeof(RIL_SignalStrength_v6)/sizeof(int);
     int response[numofElements];
 
+    if (getCachedSignalStrength(response)) {
+        RIL_onRequestComplete(t, RIL_E_SUCCESS, response, sizeof(response));
+        return;
+    }
+
     err = at_send_command_singleline("AT+CSQ", "+CSQ:", &p_response);
 
     if (err < 0 || p_response->success == 0) {
@@ -894,13 +1144,8 @@ static void requestSignalStrength(void *data __unused, size_t datalen __unused,
 
     line = p_response->p_intermediates->line;
 
-    err = at_tok_start(&line);
-    if (err < 0) goto error;
-
-    for (count =0; count < numofElements; count ++) {
-        err = at_tok_nextint(&line, &(response[count]));
-        if (err < 0) goto error;
-    }
+    count = parseSignalStrength(line, response, numofElements);
+    if (count < numofElements) goto error;
 
     RIL_onRequestComplete(t, RIL_E_SUCCESS, response, sizeof(response));
 
@@ -1259,7 +1504,8 @@ static int parseRegistrationState(char *str, int *type, int *items, int **respon
         if (*p == ',') commas++;
     }
 
-    resp = (int *)calloc(commas + 1, sizeof(int));
+    /* stat, lac and cid are always filled in, even when not reported */
+    resp = (int *)calloc(commas < 3 ? 3 : commas + 1, sizeof(int));
     if (!resp) goto error;
     switch (commas) {
         case 0: /* +CREG: <stat> */
@@ -1316,8 +1562,11 @@ static int parseRegistrationState(char *str, int *type, int *items, int **respon
         default:
             goto error;
     }
+    /* also runs on the reader thread for +CREG/+CGREG URCs */
+    pthread_mutex_lock(&s_urc_state_mutex);
     s_lac = resp[1];
     s_cid = resp[2];
+    pthread_mutex_unlock(&s_urc_state_mutex);
     if (response)
         *response = resp;
     if (items)
@@ -1368,6 +1617,9 @@ static void requestRegistrationState(int request, void *data __unused,
 
     if (parseRegistrationState(line, &type, &count, &registration)) goto error;
 
+    rememberRegistrationState(request == RIL_REQUEST_VOICE_REGISTRATION_STATE
+            ? s_creg_state : s_cgreg_state, registration);
+
     responseStr = malloc(numElements * sizeof(char *));
     if (!responseStr) goto error;
     memset(responseStr, 0, numElements * sizeof(char *));
@@ -1940,6 +2192,13 @@ static int techFromModemType(int mdmtype)
 static void requestGetCellInfoList(void *data __unused, size_t datalen __unused, RIL_Token t)
 {
     uint64_t curTime = ril_nano_time();
+    int lac, cid;
+
+    pthread_mutex_lock(&s_urc_state_mutex);
+    lac = s_lac;
+    cid = s_cid;
+    pthread_mutex_unlock(&s_urc_state_mutex);
+
     RIL_CellInfo ci[1] =
     {
         { // ci[0]
@@ -1952,8 +2211,8 @@ static void requestGetCellInfoList(void *data __unused, size_t datalen __unused,
                     {  // gsm.cellIdneityGsm
                         s_mcc, // mcc
                         s_mnc, // mnc
-                        s_lac, // lac
-                        s_cid, // cid
+                        lac, // lac
+                        cid, // cid
                     },
                     {  // gsm.signalStrengthGsm
                         10, // signalStrength
@@ -2489,6 +2748,8 @@ setRadioState(RIL_RadioState newState)
 
     /* do these outside of the mutex */
     if (sState != oldState) {
+        resetUrcState();
+
         RIL_onUnsolicitedResponse (RIL_UNSOL_RESPONSE_RADIO_STATE_CHANGED,
                                     NULL, 0);
         // Sim state can change as result of radio state change
@@ -3136,6 +3397,8 @@ static void onUnsolicited (const char *s, const char *sms_pdu)
                 || strStartsWith(s,"NO CARRIER")
                 || strStartsWith(s,"+CCWA")
     ) {
+        /* the framework re-reads the call list now, no need to poll */
+        cancelCallStatePoll();
         RIL_onUnsolicitedResponse (
             RIL_UNSOL_RESPONSE_CALL_STATE_CHANGED,
             NULL, 0);
@@ -3145,12 +3408,30 @@ static void onUnsolicited (const char *s, const char *sms_pdu)
     } else if (strStartsWith(s,"+CREG:")
                 || strStartsWith(s,"+CGREG:")
     ) {
+        int *registration = NULL;
+        int changed = 1;
+
+        line = strdup(s);
+        if (line != NULL
+                && parseRegistrationState(line, NULL, NULL, &registration) == 0) {
+            changed = rememberRegistrationState(strStartsWith(s, "+CREG:")
+                    ? s_creg_state : s_cgreg_state, registration);
+        }
+        free(registration);
+        free(line);
+
+        if (!changed) {
+            return;
+        }
+
         RIL_onUnsolicitedResponse (
             RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED,
             NULL, 0);
 #ifdef WORKAROUND_FAKE_CGEV
         RIL_requestTimedCallback (onDataCallListChanged, NULL, NULL);
 #endif /* WORKAROUND_FAKE_CGEV */
+    } else if (strStartsWith(s, "+CSQ:")) {
+        onSignalStrengthUrc(s);
     } else if (strStartsWith(s, "+CMT:")) {
         RIL_onUnsolicitedResponse (
             RIL_UNSOL_RESPONSE_NEW_SMS,
@@ -3289,9 +3570,19 @@ static void setHardwareConfiguration(int num, RIL_HardwareConfig *cfg)
 static void usage(char *s __unused)
 {
 #ifdef RIL_SHLIB
-    fprintf(stderr, "reference-ril requires: -p <tcp port> or -d /dev/tty_device\n");
+    fprintf(stderr, "reference-ril requires: -p <tcp port> or -d /dev/tty_device"
+                    " [-P <AT pipeline depth>] [-b <min ms>[:<max ms>]]\n");
+    fprintf(stderr, "  -P: AT commands in flight, default 1; only raise it for"
+                    " modems known to queue input\n");
+    fprintf(stderr, "  -b: AT+CLCC poll interval; <max ms> only applies to"
+                    " POLL_CALL_STATE builds, others poll every <min ms>\n");
 #else
-    fprintf(stderr, "usage: %s [-p <tcp port>] [-d /dev/tty_device]\n", s);
+    fprintf(stderr, "usage: %s [-p <tcp port>] [-d /dev/tty_device]"
+                    " [-P <AT pipeline depth>] [-b <min ms>[:<max ms>]]\n", s);
+    fprintf(stderr, "  -P: AT commands in flight, default 1; only raise it for"
+                    " modems known to queue input\n");
+    fprintf(stderr, "  -b: AT+CLCC poll interval; <max ms> only applies to"
+                    " POLL_CALL_STATE builds, others poll every <min ms>\n");
     exit(-1);
 #endif
 }
@@ -3305,6 +3596,7 @@ mainLoop(void *param __unused)
     AT_DUMP("== ", "entering mainLoop()", -1 );
     at_set_on_reader_closed(onATReaderClosed);
     at_set_on_timeout(onATTimeout);
+    at_set_pipeline_depth(s_at_pipeline_depth);
 
     for (;;) {
         fd = -1;
@@ -3386,7 +3678,7 @@ const RIL_RadioFunctions *RIL_Init(const struct RIL_Env *env, int argc, char **a
 
     s_rilenv = env;
 
-    while ( -1 != (opt = getopt(argc, argv, "p:d:s:c:"))) {
+    while ( -1 != (opt = getopt(argc, argv, "p:d:s:c:P:b:"))) {
         switch (opt) {
             case 'p':
                 s_port = atoi(optarg);
@@ -3412,6 +3704,20 @@ const RIL_RadioFunctions *RIL_Init(const struct RIL_Env *env, int argc, char **a
                 RLOGI("Client id received %s\n", optarg);
             break;
 
+            case 'P':
+                s_at_pipeline_depth = atoi(optarg);
+                RLOGI("AT pipeline depth %d\n", s_at_pipeline_depth);
+            break;
+
+            case 'b':
+                if (setCallPollBackoff(optarg) < 0) {
+                    usage(argv[0]);
+                    return NULL;
+                }
+                RLOGI("Call poll back-off %d..%d ms\n",
+                        s_call_poll_min_ms, s_call_poll_max_ms);
+            break;
+
             default:
                 usage(argv[0]);
                 return NULL;
@@ -3441,7 +3747,7 @@ int main (int argc, char **argv)
     int fd = -1;
     int opt;
 
-    while ( -1 != (opt = getopt(argc, argv, "p:d:"))) {
+    while ( -1 != (opt = getopt(argc, argv, "p:d:P:b:"))) {
         switch (opt) {
             case 'p':
                 s_port = atoi(optarg);
@@ -3462,6 +3768,19 @@ int main (int argc, char **argv)
                 RLOGI("Opening socket %s\n", s_device_path);
             break;
 
+            case 'P':
+                s_at_pipeline_depth = atoi(optarg);
+                RLOGI("AT pipeline depth %d\n", s_at_pipeline_depth);
+            break;
+
+            case 'b':
+                if (setCallPollBackoff(optarg) < 0) {
+                    usage(argv[0]);
+                }
+                RLOGI("Call poll back-off %d..%d ms\n",
+                        s_call_poll_min_ms, s_call_poll_max_ms);
+            break;
+
             default:
                 usage(argv[0]);
         }
@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * atchannel against a fake modem on a pty: response matching with
+ * pipelining, concurrent callers, timed-out commands and channel close,
+ * plus a pipelining benchmark.
+ *
+ *   atchannel_test        run the unit tests
+ *   atchannel_test -b     run the pipelining benchmark
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "atchannel.h"
+#include "fake_modem.h"
+
+extern "C" {
+int at_test_send_command_timeout (const char *command, ATCommandType type,
+                    const char *responsePrefix, long long timeoutMsec,
+                    ATResponse **pp_outResponse);
+int at_test_pending_count ();
+}
+
+static int gFailures = 0;
+static pthread_mutex_t s_failMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            pthread_mutex_lock(&s_failMutex); \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++; \
+            pthread_mutex_unlock(&s_failMutex); \
+        } \
+    } while (0)
+
+/* ---------------------------------------------------------------------- */
+
+struct ModemConfig {
+    int slowMs;        // extra delay for AT+SLOW
+    int dropCommands;  // commands ignored at start-up
+    int seen;
+};
+
+static FakeModem::Reply modemHandler(const std::string &command, void *ctx) {
+    ModemConfig *config = static_cast<ModemConfig *>(ctx);
+    FakeModem::Reply reply;
+
+    if (config->seen++ < config->dropCommands) {
+        reply.drop = true;
+    } else if (command == "ATE0Q0V1") {
+        reply.lines.push_back("OK");
+    } else if (command == "AT+CSQ") {
+        reply.lines.push_back("+CSQ: 20,99");
+        reply.lines.push_back("OK");
+    } else if (command.compare(0, 8, "AT+ECHO=") == 0) {
+        reply.lines.push_back("+ECHO: " + command.substr(8));
+        reply.lines.push_back("OK");
+    } else if (command == "AT+SLOW") {
+        reply.lines.push_back("+SLOW: 1");
+        reply.lines.push_back("OK");
+        reply.extraDelayMs = config->slowMs;
+    } else if (command == "AT+CLIST") {
+        reply.lines.push_back("+CLIST: 1");
+        reply.lines.push_back("+CLIST: 2");
+        reply.lines.push_back("+CLIST: 3");
+        reply.lines.push_back("OK");
+    } else if (command == "AT+CGSN") {
+        reply.lines.push_back("123456789012345");
+        reply.lines.push_back("OK");
+    } else if (command == "AT+FAIL") {
+        reply.lines.push_back("+CME ERROR: 10");
+    } else {
+        reply.lines.push_back("ERROR");
+    }
+    return reply;
+}
+
+static pthread_mutex_t s_eventMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_eventCond = PTHREAD_COND_INITIALIZER;
+static std::vector<std::string> s_unsolicited;
+static bool s_readerClosed = false;
+
+static void onUnsolicited(const char *s, const char *) {
+    pthread_mutex_lock(&s_eventMutex);
+    s_unsolicited.push_back(s);
+    pthread_cond_broadcast(&s_eventCond);
+    pthread_mutex_unlock(&s_eventMutex);
+}
+
+static void onReaderClosed() {
+    pthread_mutex_lock(&s_eventMutex);
+    s_readerClosed = true;
+    pthread_cond_broadcast(&s_eventCond);
+    pthread_mutex_unlock(&s_eventMutex);
+}
+
+static bool waitReaderClosed(int timeoutMs) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000 + 1;
+
+    pthread_mutex_lock(&s_eventMutex);
+    while (!s_readerClosed) {
+        if (pthread_cond_timedwait(&s_eventCond, &s_eventMutex, &deadline) != 0) {
+            break;
+        }
+    }
+    bool closed = s_readerClosed;
+    pthread_mutex_unlock(&s_eventMutex);
+    return closed;
+}
+
+/* One at_open() session against a fresh fake modem */
+class Session {
+public:
+    Session(int depth, int latencyUs, int serviceUs, int slowMs = 0, int dropCommands = 0)
+        : modem_(modemHandler, &config_, latencyUs, serviceUs) {
+        config_.slowMs = slowMs;
+        config_.dropCommands = dropCommands;
+        config_.seen = 0;
+
+        pthread_mutex_lock(&s_eventMutex);
+        s_unsolicited.clear();
+        s_readerClosed = false;
+        pthread_mutex_unlock(&s_eventMutex);
+
+        int fd = modem_.start();
+        if (fd < 0 || at_open(fd, onUnsolicited) < 0) {
+            fprintf(stderr, "unable to open fake modem\n");
+            exit(1);
+        }
+        at_set_pipeline_depth(depth);
+    }
+
+    /* Hang up and wait for the reader thread to notice before at_close() */
+    ~Session() {
+        hangUp();
+        at_close();
+    }
+
+    void hangUp() {
+        modem_.stop();
+        waitReaderClosed(2000);
+    }
+
+    FakeModem &modem() { return modem_; }
+
+private:
+    ModemConfig config_;
+    FakeModem modem_;
+};
+
+static std::string intermediate(ATResponse *p_response, int index) {
+    ATLine *p_line = p_response->p_intermediates;
+    while (p_line != NULL && index-- > 0) {
+        p_line = p_line->p_next;
+    }
+    return p_line != NULL ? p_line->line : "";
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void testCommandTypes() {
+    Session session(1, 200, 50);
+    ATResponse *p_response = NULL;
+
+    CHECK(at_handshake() == 0);
+
+    CHECK(at_send_command_singleline("AT+CSQ", "+CSQ:", &p_response) == 0);
+    CHECK(p_response != NULL && p_response->success == 1);
+    CHECK(p_response != NULL && intermediate(p_response, 0) == "+CSQ: 20,99");
+    at_response_free(p_response);
+
+    CHECK(at_send_command_multiline("AT+CLIST", "+CLIST:", &p_response) == 0);
+    CHECK(p_response != NULL && intermediate(p_response, 0) == "+CLIST: 1");
+    CHECK(p_response != NULL && intermediate(p_response, 2) == "+CLIST: 3");
+    at_response_free(p_response);
+
+    CHECK(at_send_command_numeric("AT+CGSN", &p_response) == 0);
+    CHECK(p_response != NULL && intermediate(p_response, 0) == "123456789012345");
+    at_response_free(p_response);
+
+    CHECK(at_send_command("AT+FAIL", &p_response) == 0);
+    CHECK(p_response != NULL && p_response->success == 0);
+    CHECK(p_response != NULL && at_get_cme_error(p_response) == CME_SIM_NOT_INSERTED);
+    at_response_free(p_response);
+
+    // A URC between commands goes to the unsolicited handler
+    session.modem().sendUnsolicited("RING");
+    CHECK(at_send_command_singleline("AT+CSQ", "+CSQ:", NULL) == 0);
+    usleep(20 * 1000);
+    pthread_mutex_lock(&s_eventMutex);
+    CHECK(s_unsolicited.size() == 1 && s_unsolicited[0] == "RING");
+    pthread_mutex_unlock(&s_eventMutex);
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct CallerArgs {
+    int id;
+    int count;
+    int mismatches;
+    int errors;
+};
+
+static void *callerMain(void *arg) {
+    CallerArgs *a = static_cast<CallerArgs *>(arg);
+
+    for (int i = 0; i < a->count; i++) {
+        char command[32];
+        char expected[32];
+        ATResponse *p_response = NULL;
+
+        snprintf(command, sizeof(command), "AT+ECHO=%d", a->id * 1000 + i);
+        snprintf(expected, sizeof(expected), "+ECHO: %d", a->id * 1000 + i);
+        if (at_send_command_singleline(command, "+ECHO:", &p_response) != 0) {
+            a->errors++;
+            continue;
+        }
+        if (intermediate(p_response, 0) != expected) {
+            a->mismatches++;
+        }
+        at_response_free(p_response);
+    }
+    return NULL;
+}
+
+/*
+ * Callers beyond the pipeline depth block for a slot rather than failing
+ * with AT_ERROR_COMMAND_PENDING, and every caller gets its own response.
+ */
+static void testConcurrentCallers(int depth) {
+    const int callers = 4;
+    Session session(depth, 500, 50);
+    pthread_t threads[callers];
+    CallerArgs args[callers];
+
+    for (int i = 0; i < callers; i++) {
+        args[i].id = i + 1;
+        args[i].count = 50;
+        args[i].mismatches = 0;
+        args[i].errors = 0;
+        pthread_create(&threads[i], NULL, callerMain, &args[i]);
+    }
+    for (int i = 0; i < callers; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(args[i].errors == 0);
+        CHECK(args[i].mismatches == 0);
+    }
+    CHECK(session.modem().commandCount() == callers * 50);
+}
+
+static void testBatch() {
+    Session session(4, 500, 50);
+    ATBatchCommand cmds[16];
+    char commands[16][32];
+
+    for (int i = 0; i < 16; i++) {
+        snprintf(commands[i], sizeof(commands[i]), "AT+ECHO=%d", i);
+        cmds[i].command = commands[i];
+        cmds[i].type = SINGLELINE;
+        cmds[i].responsePrefix = "+ECHO:";
+    }
+    cmds[5].command = "AT+FAIL";
+    cmds[5].type = NO_RESULT;
+
+    CHECK(at_send_command_batch(cmds, 16) == 0);
+    for (int i = 0; i < 16; i++) {
+        CHECK(cmds[i].err == 0 && cmds[i].p_response != NULL);
+        if (cmds[i].p_response == NULL) {
+            continue;
+        }
+        if (i == 5) {
+            CHECK(cmds[i].p_response->success == 0);
+        } else {
+            char expected[32];
+            snprintf(expected, sizeof(expected), "+ECHO: %d", i);
+            CHECK(intermediate(cmds[i].p_response, 0) == expected);
+        }
+        at_response_free(cmds[i].p_response);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+/*
+ * A command that timed out stays queued as a tombstone; its late response
+ * must not be handed to the command issued after it.
+ */
+static void testTimedOutCommand(int depth) {
+    Session session(depth, 200, 50, 150);
+    ATResponse *p_response = NULL;
+
+    CHECK(at_test_send_command_timeout("AT+SLOW", SINGLELINE, "+SLOW:", 30, &p_response)
+            == AT_ERROR_TIMEOUT);
+    CHECK(p_response == NULL);
+    CHECK(at_test_pending_count() == 1);
+
+    CHECK(at_send_command_singleline("AT+ECHO=7", "+ECHO:", &p_response) == 0);
+    CHECK(p_response != NULL && intermediate(p_response, 0) == "+ECHO: 7");
+    at_response_free(p_response);
+
+    // The tombstone went away with the late response
+    CHECK(at_test_pending_count() == 0);
+    pthread_mutex_lock(&s_eventMutex);
+    CHECK(s_unsolicited.size() == 0);
+    pthread_mutex_unlock(&s_eventMutex);
+}
+
+/* A modem that ignores its first commands still completes the handshake */
+static void testHandshakeRetry() {
+    Session session(1, 200, 50, 0, 2);
+
+    CHECK(at_handshake() == 0);
+    CHECK(session.modem().commandCount() == 3);
+    CHECK(at_send_command_singleline("AT+CSQ", "+CSQ:", NULL) == 0);
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct WaiterArgs {
+    const char *command;
+    int err;
+    bool done;
+};
+
+static void *waiterMain(void *arg) {
+    WaiterArgs *a = static_cast<WaiterArgs *>(arg);
+    a->err = at_send_command(a->command, NULL);
+    pthread_mutex_lock(&s_eventMutex);
+    a->done = true;
+    pthread_cond_broadcast(&s_eventCond);
+    pthread_mutex_unlock(&s_eventMutex);
+    return NULL;
+}
+
+static bool waitWaiters(WaiterArgs *args, int count, int timeoutMs) {
+    long long deadline = FakeModem::nowNs() + timeoutMs * 1000000LL;
+    for (;;) {
+        bool all = true;
+        pthread_mutex_lock(&s_eventMutex);
+        for (int i = 0; i < count; i++) {
+            all = all && args[i].done;
+        }
+        pthread_mutex_unlock(&s_eventMutex);
+        if (all) {
+            return true;
+        }
+        if (FakeModem::nowNs() > deadline) {
+            return false;
+        }
+        usleep(1000);
+    }
+}
+
+/*
+ * One command in flight and two more blocked for a pipeline slot: closing
+ * the channel has to wake all three, whichever side closes it.
+ */
+static void testCloseWakesAllWaiters(bool readerSide) {
+    const int count = 3;
+    Session session(1, 200, 50, 10000);
+    pthread_t threads[count];
+    WaiterArgs args[count];
+
+    for (int i = 0; i < count; i++) {
+        args[i].command = "AT+SLOW";
+        args[i].err = 0;
+        args[i].done = false;
+        pthread_create(&threads[i], NULL, waiterMain, &args[i]);
+    }
+    usleep(50 * 1000);
+    CHECK(session.modem().commandCount() == 1);
+
+    if (readerSide) {
+        session.hangUp();
+    } else {
+        at_close();
+    }
+
+    bool woke = waitWaiters(args, count, 2000);
+    CHECK(woke);
+    if (!woke) {
+        // the waiters are stuck on s_commandcond; nothing left to test
+        fprintf(stderr, "%d check(s) failed\n", gFailures);
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(args[i].err == AT_ERROR_CHANNEL_CLOSED);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void benchPipelining(int depth, int latencyUs, int serviceUs) {
+    const int count = 200;
+    Session session(depth, latencyUs, serviceUs);
+    std::vector<ATBatchCommand> cmds(count);
+    std::vector<std::string> commands(count);
+
+    for (int i = 0; i < count; i++) {
+        commands[i] = "AT+ECHO=" + std::to_string(i);
+        cmds[i].command = commands[i].c_str();
+        cmds[i].type = SINGLELINE;
+        cmds[i].responsePrefix = "+ECHO:";
+    }
+
+    long long start = FakeModem::nowNs();
+    int err = at_send_command_batch(cmds.data(), count);
+    double ms = (FakeModem::nowNs() - start) / 1e6;
+
+    for (int i = 0; i < count; i++) {
+        at_response_free(cmds[i].p_response);
+    }
+
+    printf("latency %5d us  service %4d us  depth %d: %d commands in %7.1f ms"
+            "  %8.0f commands/min%s\n",
+            latencyUs, serviceUs, depth, count, ms, count * 60000.0 / ms,
+            err == 0 ? "" : "  (errors)");
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    bool bench = false;
+
+    while ((opt = getopt(argc, argv, "b")) != -1) {
+        switch (opt) {
+            case 'b':
+                bench = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    at_set_on_reader_closed(onReaderClosed);
+
+    if (bench) {
+        const int latencies[] = { 2000, 10000 };
+        const int depths[] = { 1, 2, 4, 8 };
+        for (size_t l = 0; l < sizeof(latencies) / sizeof(latencies[0]); l++) {
+            for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+                benchPipelining(depths[d], latencies[l], 500);
+            }
+        }
+        return 0;
+    }
+
+    testCommandTypes();
+    testConcurrentCallers(1);
+    testConcurrentCallers(4);
+    testBatch();
+    testTimedOutCommand(1);
+    testTimedOutCommand(4);
+    testHandshakeRetry();
+    testCloseWakesAllWaiters(true);
+    testCloseWakesAllWaiters(false);
+
+    if (gFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * In-process fake modem on a pseudo terminal for the reference-ril tests.
+ *
+ * The slave side is handed to at_open(); a thread on the master side reads
+ * '\r' terminated commands, asks a handler for the reply and writes it back
+ * after a simulated round-trip latency. Like a V.250 modem it answers
+ * strictly in order and takes at least serviceUs per command, so several
+ * commands written back to back overlap only their link latency.
+ */
+
+#ifndef RIL_TESTS_FAKE_MODEM_H
+#define RIL_TESTS_FAKE_MODEM_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class FakeModem {
+public:
+    struct Reply {
+        std::vector<std::string> lines;  // sent as "\r\n<line>\r\n"
+        int extraDelayMs;                // on top of the link latency
+        bool drop;                       // never answer this command
+
+        Reply() : extraDelayMs(0), drop(false) {}
+    };
+
+    typedef Reply (*Handler)(const std::string &command, void *ctx);
+
+    FakeModem(Handler handler, void *ctx, int latencyUs, int serviceUs)
+        : handler_(handler)
+        , ctx_(ctx)
+        , latencyUs_(latencyUs)
+        , serviceUs_(serviceUs)
+        , master_(-1)
+        , slave_(-1)
+        , started_(false)
+        , stop_(false)
+        , lastDueNs_(0)
+        , commandCount_(0) {
+        pthread_mutex_init(&mutex_, NULL);
+        wake_[0] = wake_[1] = -1;
+    }
+
+    ~FakeModem() {
+        stop();
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    /* Returns the slave fd for at_open(), or -1 */
+    int start() {
+        master_ = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master_ < 0 || grantpt(master_) < 0 || unlockpt(master_) < 0) {
+            perror("posix_openpt");
+            return -1;
+        }
+        slave_ = open(ptsname(master_), O_RDWR | O_NOCTTY);
+        if (slave_ < 0) {
+            perror("open pty slave");
+            return -1;
+        }
+
+        // no echo, no CR/NL translation: bytes pass through untouched
+        struct termios tio;
+        tcgetattr(slave_, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave_, TCSANOW, &tio);
+
+        if (pipe(wake_) < 0) {
+            perror("pipe");
+            return -1;
+        }
+        stop_ = false;
+        if (pthread_create(&thread_, NULL, threadMain, this) != 0) {
+            return -1;
+        }
+        started_ = true;
+        return slave_;
+    }
+
+    /* Hangs up: the AT reader sees EOF / EIO on the slave */
+    void stop() {
+        if (!started_) {
+            return;
+        }
+        pthread_mutex_lock(&mutex_);
+        stop_ = true;
+        pthread_mutex_unlock(&mutex_);
+        wake();
+        pthread_join(thread_, NULL);
+        started_ = false;
+        close(master_);
+        close(wake_[0]);
+        close(wake_[1]);
+        master_ = wake_[0] = wake_[1] = -1;
+    }
+
+    /* Sends an unsolicited line right away, between any replies */
+    void sendUnsolicited(const std::string &line) {
+        pthread_mutex_lock(&mutex_);
+        urcs_.push_back("\r\n" + line + "\r\n");
+        pthread_mutex_unlock(&mutex_);
+        wake();
+    }
+
+    int commandCount() {
+        pthread_mutex_lock(&mutex_);
+        int count = commandCount_;
+        pthread_mutex_unlock(&mutex_);
+        return count;
+    }
+
+    std::vector<std::string> commands() {
+        pthread_mutex_lock(&mutex_);
+        std::vector<std::string> copy = commands_;
+        pthread_mutex_unlock(&mutex_);
+        return copy;
+    }
+
+    static long long nowNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+private:
+    struct Pending {
+        long long dueNs;
+        std::string bytes;
+    };
+
+    static void *threadMain(void *arg) {
+        static_cast<FakeModem *>(arg)->run();
+        return NULL;
+    }
+
+    void wake() {
+        char c = 'w';
+        if (write(wake_[1], &c, 1) < 0) {
+            perror("wake");
+        }
+    }
+
+    bool writeAll(const std::string &bytes) {
+        size_t done = 0;
+        while (done < bytes.size()) {
+            ssize_t n = write(master_, bytes.data() + done, bytes.size() - done);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    continue;
+                }
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    void onCommand(const std::string &command) {
+        Reply reply = handler_(command, ctx_);
+        long long now = nowNs();
+
+        pthread_mutex_lock(&mutex_);
+        commandCount_++;
+        commands_.push_back(command);
+        pthread_mutex_unlock(&mutex_);
+
+        if (reply.drop) {
+            return;
+        }
+
+        Pending p;
+        p.dueNs = now + latencyUs_ * 1000LL + reply.extraDelayMs * 1000000LL;
+        if (p.dueNs < lastDueNs_ + serviceUs_ * 1000LL) {
+            p.dueNs = lastDueNs_ + serviceUs_ * 1000LL;
+        }
+        lastDueNs_ = p.dueNs;
+        for (size_t i = 0; i < reply.lines.size(); i++) {
+            p.bytes += "\r\n" + reply.lines[i] + "\r\n";
+        }
+        replies_.push_back(p);
+    }
+
+    void run() {
+        std::string input;
+
+        for (;;) {
+            pthread_mutex_lock(&mutex_);
+            bool stop = stop_;
+            std::deque<std::string> urcs;
+            urcs.swap(urcs_);
+            pthread_mutex_unlock(&mutex_);
+            if (stop) {
+                return;
+            }
+
+            for (size_t i = 0; i < urcs.size(); i++) {
+                writeAll(urcs[i]);
+            }
+
+            long long now = nowNs();
+            while (!replies_.empty() && replies_.front().dueNs <= now) {
+                writeAll(replies_.front().bytes);
+                replies_.pop_front();
+            }
+
+            int timeoutMs = -1;
+            if (!replies_.empty()) {
+                timeoutMs = (int)((replies_.front().dueNs - now + 999999) / 1000000);
+            }
+
+            struct pollfd fds[2];
+            fds[0].fd = master_;
+            fds[0].events = POLLIN;
+            fds[1].fd = wake_[0];
+            fds[1].events = POLLIN;
+            if (poll(fds, 2, timeoutMs) < 0 && errno != EINTR) {
+                return;
+            }
+
+            if (fds[1].revents & POLLIN) {
+                char buf[64];
+                if (read(wake_[0], buf, sizeof(buf)) < 0) {
+                    return;
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                char buf[512];
+                ssize_t n = read(master_, buf, sizeof(buf));
+                if (n <= 0) {
+                    continue;
+                }
+                input.append(buf, n);
+                size_t eol;
+                while ((eol = input.find('\r')) != std::string::npos) {
+                    std::string command = input.substr(0, eol);
+                    input.erase(0, eol + 1);
+                    if (!command.empty()) {
+                        onCommand(command);
+                    }
+                }
+            }
+        }
+    }
+
+    Handler handler_;
+    void *ctx_;
+    int latencyUs_;
+    int serviceUs_;
+    int master_;
+    int slave_;
+    int wake_[2];
+    bool started_;
+    pthread_t thread_;
+    pthread_mutex_t mutex_;
+    bool stop_;
+    std::deque<std::string> urcs_;
+    std::deque<Pending> replies_;
+    long long lastDueNs_;
+    int commandCount_;
+    std::vector<std::string> commands_;
+};
+
+#endif  // RIL_TESTS_FAKE_MODEM_H
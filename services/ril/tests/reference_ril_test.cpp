@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * reference-ril against a fake modem on a pty: how quickly call state
+ * changes the modem doesn't announce are noticed, how many AT commands a
+ * minute the call and registration tracking costs, and that URC state is
+ * deduplicated and cached.
+ *
+ *   reference_ril_test        run the unit tests
+ *   reference_ril_test -b     report latency and AT commands per minute
+ *                             with the default call poll back-off
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ril.h"
+#include "fake_modem.h"
+
+static int gFailures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+/* ---------------------------------------------------------------------- */
+
+/* The modem side: a call list that changes silently unless a test says so */
+struct ModemState {
+    pthread_mutex_t mutex;
+    std::vector<std::pair<int, int> > calls;    // index, +CLCC stat
+    int clcc;
+    int csq;
+};
+
+static ModemState s_modem = { PTHREAD_MUTEX_INITIALIZER, {}, 0, 0 };
+
+static FakeModem::Reply modemHandler(const std::string &command, void *) {
+    FakeModem::Reply reply;
+
+    pthread_mutex_lock(&s_modem.mutex);
+    if (command == "AT+CLCC") {
+        s_modem.clcc++;
+        for (size_t i = 0; i < s_modem.calls.size(); i++) {
+            char line[64];
+            snprintf(line, sizeof(line), "+CLCC: %d,1,%d,0,0,\"5551234\",129",
+                    s_modem.calls[i].first, s_modem.calls[i].second);
+            reply.lines.push_back(line);
+        }
+    } else if (command == "AT+CFUN?") {
+        reply.lines.push_back("+CFUN: 1");
+    } else if (command == "AT+CPIN?") {
+        reply.lines.push_back("+CPIN: READY");
+    } else if (command == "AT+CSQ") {
+        s_modem.csq++;
+        reply.lines.push_back("+CSQ: 20,99");
+    }
+    pthread_mutex_unlock(&s_modem.mutex);
+
+    reply.lines.push_back("OK");
+    return reply;
+}
+
+static void setModemCalls(int index, int stat) {
+    pthread_mutex_lock(&s_modem.mutex);
+    s_modem.calls.clear();
+    if (index > 0) {
+        s_modem.calls.push_back(std::make_pair(index, stat));
+    }
+    pthread_mutex_unlock(&s_modem.mutex);
+}
+
+static int modemCount(int ModemState::*counter) {
+    pthread_mutex_lock(&s_modem.mutex);
+    int count = s_modem.*counter;
+    pthread_mutex_unlock(&s_modem.mutex);
+    return count;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/*
+ * The libril side: one thread runs requests and timed callbacks in due
+ * order, like ril_event's loop, and a call state change makes the
+ * "framework" read the call list just like RIL.java does.
+ */
+
+static const RIL_RadioFunctions *s_funcs;
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static std::multimap<long long, std::pair<RIL_TimedCallback, void *> > s_timers;
+
+struct Request {
+    int request;
+    bool detached;              // nobody waits; freed on completion
+    bool done;
+    RIL_Errno e;
+    std::vector<int> words;     // int responses, flattened
+};
+
+/* the last call list the framework read, and when */
+static std::vector<int> s_callStates;
+static long long s_callListNs = 0;
+static int s_callListReads = 0;
+
+static std::map<int, int> s_unsolCounts;
+
+static void postTimer(RIL_TimedCallback callback, void *param, long long delayNs) {
+    pthread_mutex_lock(&s_mutex);
+    s_timers.insert(std::make_pair(FakeModem::nowNs() + delayNs,
+            std::make_pair(callback, param)));
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static void *loopMain(void *) {
+    pthread_mutex_lock(&s_mutex);
+    for (;;) {
+        if (s_timers.empty()) {
+            pthread_cond_wait(&s_cond, &s_mutex);
+            continue;
+        }
+        long long dueNs = s_timers.begin()->first;
+        long long now = FakeModem::nowNs();
+        if (dueNs > now) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            long long abs = ts.tv_sec * 1000000000LL + ts.tv_nsec + (dueNs - now);
+            ts.tv_sec = abs / 1000000000LL;
+            ts.tv_nsec = abs % 1000000000LL;
+            pthread_cond_timedwait(&s_cond, &s_mutex, &ts);
+            continue;
+        }
+        std::pair<RIL_TimedCallback, void *> timer = s_timers.begin()->second;
+        s_timers.erase(s_timers.begin());
+        pthread_mutex_unlock(&s_mutex);
+
+        timer.first(timer.second);
+
+        pthread_mutex_lock(&s_mutex);
+    }
+    return NULL;
+}
+
+static void runRequest(void *param) {
+    Request *r = static_cast<Request *>(param);
+    s_funcs->onRequest(r->request, NULL, 0, r);
+}
+
+static void onRequestComplete(RIL_Token t, RIL_Errno e, void *response, size_t responselen) {
+    Request *r = static_cast<Request *>(t);
+    bool detached = r->detached;    // a waiter may return as soon as done is set
+
+    pthread_mutex_lock(&s_mutex);
+    r->e = e;
+    if (e == RIL_E_SUCCESS && r->request == RIL_REQUEST_GET_CURRENT_CALLS) {
+        RIL_Call **pp_calls = static_cast<RIL_Call **>(response);
+        s_callStates.clear();
+        for (size_t i = 0; i < responselen / sizeof(RIL_Call *); i++) {
+            s_callStates.push_back(pp_calls[i]->state);
+        }
+        s_callListNs = FakeModem::nowNs();
+        s_callListReads++;
+    } else if (e == RIL_E_SUCCESS && r->request == RIL_REQUEST_GET_CELL_INFO_LIST) {
+        RIL_CellInfo *p_info = static_cast<RIL_CellInfo *>(response);
+        r->words.push_back(p_info->CellInfo.gsm.cellIdentityGsm.lac);
+        r->words.push_back(p_info->CellInfo.gsm.cellIdentityGsm.cid);
+    } else if (e == RIL_E_SUCCESS && response != NULL) {
+        const int *words = static_cast<const int *>(response);
+        r->words.assign(words, words + responselen / sizeof(int));
+    }
+    r->done = true;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+
+    if (detached) {
+        delete r;
+    }
+}
+
+static void onUnsolicitedResponse(int unsolResponse, const void *, size_t) {
+    pthread_mutex_lock(&s_mutex);
+    s_unsolCounts[unsolResponse]++;
+    pthread_mutex_unlock(&s_mutex);
+
+    if (unsolResponse == RIL_UNSOL_RESPONSE_CALL_STATE_CHANGED) {
+        Request *r = new Request();
+        r->request = RIL_REQUEST_GET_CURRENT_CALLS;
+        r->detached = true;
+        r->done = false;
+        postTimer(runRequest, r, 0);
+    }
+}
+
+static void requestTimedCallback(RIL_TimedCallback callback, void *param,
+        const struct timeval *relativeTime) {
+    long long delayNs = 0;
+    if (relativeTime != NULL) {
+        delayNs = relativeTime->tv_sec * 1000000000LL + relativeTime->tv_usec * 1000LL;
+    }
+    postTimer(callback, param, delayNs);
+}
+
+static void onRequestAck(RIL_Token) {
+}
+
+static const struct RIL_Env s_env = {
+    onRequestComplete,
+    onUnsolicitedResponse,
+    requestTimedCallback,
+    onRequestAck,
+};
+
+/* Runs a request on the loop and waits for its completion */
+static RIL_Errno request(int code, std::vector<int> *words = NULL) {
+    Request r;
+    r.request = code;
+    r.detached = false;
+    r.done = false;
+    r.e = RIL_E_GENERIC_FAILURE;
+
+    postTimer(runRequest, &r, 0);
+
+    pthread_mutex_lock(&s_mutex);
+    while (!r.done) {
+        pthread_cond_wait(&s_cond, &s_mutex);
+    }
+    pthread_mutex_unlock(&s_mutex);
+
+    if (words != NULL) {
+        *words = r.words;
+    }
+    return r.e;
+}
+
+struct RadioStateQuery {
+    bool done;
+    RIL_RadioState state;
+};
+
+static void readRadioState(void *param) {
+    RadioStateQuery *q = static_cast<RadioStateQuery *>(param);
+    RIL_RadioState state = s_funcs->onStateRequest();
+
+    pthread_mutex_lock(&s_mutex);
+    q->state = state;
+    q->done = true;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+/* Reads the radio state on the loop, which is where libril asks for it */
+static RIL_RadioState radioState() {
+    RadioStateQuery q;
+    q.done = false;
+    q.state = RADIO_STATE_UNAVAILABLE;
+
+    postTimer(readRadioState, &q, 0);
+
+    pthread_mutex_lock(&s_mutex);
+    while (!q.done) {
+        pthread_cond_wait(&s_cond, &s_mutex);
+    }
+    pthread_mutex_unlock(&s_mutex);
+
+    return q.state;
+}
+
+static int unsolCount(int code) {
+    pthread_mutex_lock(&s_mutex);
+    int count = s_unsolCounts[code];
+    pthread_mutex_unlock(&s_mutex);
+    return count;
+}
+
+/* Waits up to timeoutMs for the framework to read a call list whose first
+   call is in state; returns when it did, or 0 */
+static long long waitCallState(int state, int timeoutMs) {
+    long long deadline = FakeModem::nowNs() + timeoutMs * 1000000LL;
+    for (;;) {
+        pthread_mutex_lock(&s_mutex);
+        bool seen = state < 0 ? s_callStates.empty()
+                : (!s_callStates.empty() && s_callStates[0] == state);
+        long long when = s_callListNs;
+        pthread_mutex_unlock(&s_mutex);
+        if (seen) {
+            return when;
+        }
+        if (FakeModem::nowNs() > deadline) {
+            return 0;
+        }
+        usleep(1000);
+    }
+}
+
+static void sleepMs(int ms) {
+    usleep(ms * 1000);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static FakeModem *s_fakeModem;
+
+static void startRil(const char *backoff) {
+    static char device[32];
+    static char backoffArg[32];
+
+    s_fakeModem = new FakeModem(modemHandler, NULL, 5000, 200);
+    int fd = s_fakeModem->start();
+    if (fd < 0) {
+        exit(1);
+    }
+    snprintf(device, sizeof(device), "/proc/self/fd/%d", fd);
+    snprintf(backoffArg, sizeof(backoffArg), "%s", backoff);
+
+    char *argv[] = {
+        (char *)"reference-ril", (char *)"-d", device, (char *)"-b", backoffArg, NULL
+    };
+    optind = 1;
+
+    pthread_t loop;
+    pthread_create(&loop, NULL, loopMain, NULL);
+
+    s_funcs = RIL_Init(&s_env, 5, argv);
+    if (s_funcs == NULL) {
+        fprintf(stderr, "RIL_Init failed\n");
+        exit(1);
+    }
+
+    long long deadline = FakeModem::nowNs() + 5000000000LL;
+    while (radioState() != RADIO_STATE_ON) {
+        if (FakeModem::nowNs() > deadline) {
+            fprintf(stderr, "radio never came on\n");
+            exit(1);
+        }
+        sleepMs(10);
+    }
+    // let SIM polling and the rest of the power-on chatter finish
+    sleepMs(1500);
+}
+
+struct Window {
+    long long startNs;
+    int commands;
+    int clcc;
+
+    Window() : startNs(FakeModem::nowNs()),
+            commands(s_fakeModem->commandCount()),
+            clcc(modemCount(&ModemState::clcc)) {}
+
+    double minutes() const { return (FakeModem::nowNs() - startNs) / 60e9; }
+    double commandsPerMinute() const {
+        return (s_fakeModem->commandCount() - commands) / minutes();
+    }
+    int clccSince() const { return modemCount(&ModemState::clcc) - clcc; }
+};
+
+/*
+ * An incoming call the modem never reports again: it keeps being polled
+ * at the minimum interval however long it rings, so answering it on the
+ * far side is noticed within one interval. Returns that latency in ms.
+ */
+static double incomingCallLatency(int ringMs, int *clccDuringRing) {
+    setModemCalls(1, 4 /* incoming */);
+    s_fakeModem->sendUnsolicited("RING");
+    CHECK(waitCallState(RIL_CALL_INCOMING, 2000) != 0);
+
+    Window ringing;
+    sleepMs(ringMs);
+    *clccDuringRing = ringing.clccSince();
+
+    long long changedNs = FakeModem::nowNs();
+    setModemCalls(1, 0 /* active */);
+    long long seenNs = waitCallState(RIL_CALL_ACTIVE, 20000);
+    CHECK(seenNs != 0);
+
+    return seenNs != 0 ? (seenNs - changedNs) / 1e6 : -1;
+}
+
+static void hangUp() {
+    setModemCalls(0, 0);
+    s_fakeModem->sendUnsolicited("NO CARRIER");
+    CHECK(waitCallState(-1, 2000) != 0);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void testIdleIsQuiet() {
+    Window idle;
+    sleepMs(1000);
+    CHECK(idle.clccSince() == 0);
+}
+
+static void testTransitionalCallIsNotBackedOff() {
+    int clcc = 0;
+
+    // with a 100..800 ms back-off an unchanged ringing call used to be
+    // polled at 100, 300, 700, 1500 and 2300 ms
+    double latencyMs = incomingCallLatency(1600, &clcc);
+    CHECK(latencyMs >= 0 && latencyMs < 250);
+    CHECK(clcc >= 10);
+
+    // an active call is stable; nothing polls it
+    Window active;
+    sleepMs(1000);
+    CHECK(active.clccSince() == 0);
+
+    hangUp();
+}
+
+static void testRegistrationUrcs() {
+    std::vector<int> cell;
+    int before = unsolCount(RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED);
+
+    s_fakeModem->sendUnsolicited("+CREG: 1,\"00C3\",\"0000A1B2\"");
+    s_fakeModem->sendUnsolicited("+CREG: 1,\"00C3\",\"0000A1B2\"");
+    s_fakeModem->sendUnsolicited("+CREG: 1,\"00C3\",\"0000A1B3\"");
+    sleepMs(100);
+    CHECK(unsolCount(RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED) == before + 2);
+
+    // lac and cid come from the URC, written on the reader thread
+    CHECK(request(RIL_REQUEST_GET_CELL_INFO_LIST, &cell) == RIL_E_SUCCESS);
+    CHECK(cell.size() == 2 && cell[0] == 0xc3 && cell[1] == 0xa1b3);
+}
+
+static void testSignalStrengthUrc() {
+    std::vector<int> signal;
+    int before = unsolCount(RIL_UNSOL_SIGNAL_STRENGTH);
+
+    s_fakeModem->sendUnsolicited("+CSQ: 15,99");
+    s_fakeModem->sendUnsolicited("+CSQ: 15,99");
+    sleepMs(100);
+    CHECK(unsolCount(RIL_UNSOL_SIGNAL_STRENGTH) == before + 1);
+
+    int csq = modemCount(&ModemState::csq);
+    CHECK(request(RIL_REQUEST_SIGNAL_STRENGTH, &signal) == RIL_E_SUCCESS);
+    CHECK(signal.size() >= 2 && signal[0] == 15 && signal[1] == 99);
+    CHECK(modemCount(&ModemState::csq) == csq);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void bench() {
+    int clcc = 0;
+
+    Window idle;
+    sleepMs(5000);
+    printf("idle:               %6.0f AT commands/min\n", idle.commandsPerMinute());
+
+    Window ringing;
+    double latencyMs = incomingCallLatency(10000, &clcc);
+    printf("ringing 10 s:       %6.0f AT commands/min  %d AT+CLCC  answer seen after %.0f ms\n",
+            ringing.commandsPerMinute(), clcc, latencyMs);
+
+    Window active;
+    sleepMs(5000);
+    printf("active call:        %6.0f AT commands/min\n", active.commandsPerMinute());
+    hangUp();
+
+    Window urcs;
+    for (int i = 0; i < 100; i++) {
+        s_fakeModem->sendUnsolicited("+CREG: 1,\"00C3\",\"0000A1B2\"");
+        s_fakeModem->sendUnsolicited("+CSQ: 20,99");
+        request(RIL_REQUEST_SIGNAL_STRENGTH);
+        sleepMs(10);
+    }
+    printf("100 repeated URCs:  %d AT commands, %d network state changes\n",
+            s_fakeModem->commandCount() - urcs.commands,
+            unsolCount(RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED));
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    bool benchmark = false;
+
+    while ((opt = getopt(argc, argv, "b")) != -1) {
+        switch (opt) {
+            case 'b':
+                benchmark = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (benchmark) {
+        startRil("500:8000");
+        bench();
+        return 0;
+    }
+
+    startRil("100:800");
+    testIdleIsQuiet();
+    testTransitionalCallIsNotBackedOff();
+    testRegistrationUrcs();
+    testSignalStrengthUrc();
+
+    if (gFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
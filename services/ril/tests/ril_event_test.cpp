@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Unit test and dispatch-latency benchmark for the ril_event loop.
+ *
+ * ril_event.cpp is compiled straight into this binary, which is linked
+ * with -Wl,--wrap=epoll_wait so a test can run code on the loop thread
+ * between epoll_wait() returning and the ready list being processed.
+ *
+ *   ril_event_test        run the unit tests
+ *   ril_event_test -b     run the dispatch-latency benchmark
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <ril_event.h>
+
+extern "C" int __real_epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+        int timeout);
+
+static int gFailures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+
+// Runs once on the loop thread right after the next epoll_wait() returns
+static void (*s_afterWaitHook)(void) = NULL;
+
+extern "C" int __wrap_epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+        int timeout)
+{
+    int n = __real_epoll_wait(epfd, events, maxevents, timeout);
+    void (*hook)(void);
+
+    pthread_mutex_lock(&s_mutex);
+    hook = (n > 0) ? s_afterWaitHook : NULL;
+    if (hook != NULL) {
+        s_afterWaitHook = NULL;
+    }
+    pthread_mutex_unlock(&s_mutex);
+
+    if (hook != NULL) {
+        hook();
+    }
+    return n;
+}
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *loopThread(void *)
+{
+    ril_event_loop();
+    return NULL;
+}
+
+// Waits until *counter reaches target or timeoutMs passes
+static bool waitFor(const int *counter, int target, int timeoutMs)
+{
+    struct timespec deadline;
+    bool ok;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&s_mutex);
+    while (*counter < target) {
+        if (pthread_cond_timedwait(&s_cond, &s_mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    ok = *counter >= target;
+    pthread_mutex_unlock(&s_mutex);
+    return ok;
+}
+
+static void bump(int *counter)
+{
+    pthread_mutex_lock(&s_mutex);
+    (*counter)++;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static int readCount(const int *counter)
+{
+    pthread_mutex_lock(&s_mutex);
+    int value = *counter;
+    pthread_mutex_unlock(&s_mutex);
+    return value;
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct Watch {
+    struct ril_event ev;
+    int fds[2];
+    int fired;
+};
+
+static void drainCb(int fd, short, void *param)
+{
+    Watch *w = (Watch *)param;
+    char buf[64];
+
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+    bump(&w->fired);
+}
+
+static void openWatch(Watch *w, bool persist)
+{
+    memset(w, 0, sizeof(*w));
+    if (pipe(w->fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    ril_event_set(&w->ev, w->fds[0], persist, drainCb, w);
+}
+
+static void closeWatch(Watch *w)
+{
+    close(w->fds[0]);
+    close(w->fds[1]);
+}
+
+static void poke(Watch *w)
+{
+    char c = 'x';
+    if (write(w->fds[1], &c, 1) != 1) {
+        perror("write");
+    }
+}
+
+static void testWatches()
+{
+    Watch persistent;
+    Watch oneShot;
+
+    openWatch(&persistent, true);
+    openWatch(&oneShot, false);
+    ril_event_add(&persistent.ev);
+    ril_event_add(&oneShot.ev);
+
+    for (int i = 1; i <= 3; i++) {
+        poke(&persistent);
+        CHECK(waitFor(&persistent.fired, i, 1000));
+    }
+
+    poke(&oneShot);
+    CHECK(waitFor(&oneShot.fired, 1, 1000));
+    // A non-persistent watch is removed after firing once
+    CHECK(oneShot.ev.index < 0);
+    poke(&oneShot);
+    poke(&persistent);
+    CHECK(waitFor(&persistent.fired, 4, 1000));
+    CHECK(readCount(&oneShot.fired) == 1);
+
+    // Deleted watches stay silent
+    ril_event_del(&persistent.ev);
+    poke(&persistent);
+    usleep(50 * 1000);
+    CHECK(readCount(&persistent.fired) == 4);
+
+    closeWatch(&persistent);
+    closeWatch(&oneShot);
+}
+
+// More fds than the old select() watch table (MAX_FD_EVENTS) could hold
+static void testManyWatches()
+{
+    const int count = 200;
+    std::vector<Watch> watches(count);
+
+    for (int i = 0; i < count; i++) {
+        openWatch(&watches[i], true);
+        ril_event_add(&watches[i].ev);
+    }
+    for (int i = 0; i < count; i++) {
+        poke(&watches[i]);
+    }
+    for (int i = 0; i < count; i++) {
+        CHECK(waitFor(&watches[i].fired, 1, 2000));
+    }
+    for (int i = 0; i < count; i++) {
+        ril_event_del(&watches[i].ev);
+        closeWatch(&watches[i]);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int s_timerOrder[8];
+static int s_timerFired = 0;
+
+static void timerCb(int, short, void *param)
+{
+    pthread_mutex_lock(&s_mutex);
+    if (s_timerFired < 8) {
+        s_timerOrder[s_timerFired] = (int)(long)param;
+    }
+    s_timerFired++;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static void testTimers()
+{
+    // Like ril.cpp's triggerEvLoop(): the loop only recomputes its timeout
+    // when it wakes up, so poke it after arming timers from this thread
+    Watch wakeup;
+    struct ril_event timers[4];
+    const int delaysMs[4] = { 40, 10, 30, 20 };
+
+    for (int i = 0; i < 4; i++) {
+        struct timeval tv = { 0, delaysMs[i] * 1000 };
+        ril_event_set(&timers[i], -1, false, timerCb, (void *)(long)i);
+        CHECK(ril_timer_add(&timers[i], &tv));
+    }
+    // Re-arming moves the deadline instead of adding a second entry
+    struct timeval later = { 0, 50 * 1000 };
+    CHECK(ril_timer_add(&timers[1], &later));
+
+    // A timer that was not armed reports it and stays out of the heap
+    struct ril_event unarmed;
+    ril_event_set(&unarmed, -1, false, timerCb, (void *)(long)4);
+    CHECK(!ril_timer_add(&unarmed, NULL));
+    CHECK(unarmed.heap_index == -1);
+
+    openWatch(&wakeup, true);
+    ril_event_add(&wakeup.ev);
+    poke(&wakeup);
+
+    CHECK(waitFor(&s_timerFired, 4, 1000));
+    usleep(20 * 1000);
+    pthread_mutex_lock(&s_mutex);
+    CHECK(s_timerFired == 4);
+    CHECK(s_timerOrder[0] == 3);
+    CHECK(s_timerOrder[1] == 2);
+    CHECK(s_timerOrder[2] == 0);
+    CHECK(s_timerOrder[3] == 1);
+    pthread_mutex_unlock(&s_mutex);
+
+    ril_event_del(&wakeup.ev);
+    closeWatch(&wakeup);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static Watch s_victim;
+static int s_strayFired = 0;
+
+static void strayCb(int, short, void *)
+{
+    bump(&s_strayFired);
+}
+
+// Runs between epoll_wait() and processReadReadies(): deletes the watch
+// epoll just reported and recycles its storage the way a caller that frees
+// and reallocates it would, with fields that look like a live registration.
+static void removeVictimHook()
+{
+    ril_event_del(&s_victim.ev);
+    memset(&s_victim.ev, 0, sizeof(s_victim.ev));
+    s_victim.ev.fd = -1;
+    s_victim.ev.index = 1;
+    s_victim.ev.heap_index = -1;
+    s_victim.ev.persist = true;
+    s_victim.ev.func = strayCb;
+}
+
+static void testRemovedAfterWait()
+{
+    Watch witness;
+
+    openWatch(&s_victim, true);
+    openWatch(&witness, true);
+    ril_event_add(&s_victim.ev);
+    ril_event_add(&witness.ev);
+
+    pthread_mutex_lock(&s_mutex);
+    s_afterWaitHook = removeVictimHook;
+    pthread_mutex_unlock(&s_mutex);
+
+    // Both become ready in the same epoll_wait() batch
+    poke(&s_victim);
+    poke(&witness);
+    CHECK(waitFor(&witness.fired, 1, 1000));
+    usleep(20 * 1000);
+    CHECK(readCount(&s_victim.fired) == 0);
+    CHECK(readCount(&s_strayFired) == 0);
+
+    ril_event_del(&witness.ev);
+    closeWatch(&witness);
+    closeWatch(&s_victim);
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct Probe {
+    struct ril_event ev;
+    int fds[2];
+    long long sentNs;
+    std::vector<long long> samples;
+    int received;
+};
+
+static void probeCb(int fd, short, void *param)
+{
+    Probe *p = (Probe *)param;
+    char c;
+    long long now = nowNs();
+
+    if (read(fd, &c, 1) == 1) {
+        pthread_mutex_lock(&s_mutex);
+        p->samples.push_back(now - p->sentNs);
+        p->received++;
+        pthread_cond_broadcast(&s_cond);
+        pthread_mutex_unlock(&s_mutex);
+    }
+}
+
+#define BENCH_MAX_TIMERS 1024
+
+static void benchDispatch(int idleWatches, int armedTimers, int rounds)
+{
+    std::vector<Watch> idle(idleWatches);
+    Probe probe;
+
+    for (int i = 0; i < idleWatches; i++) {
+        openWatch(&idle[i], true);
+        ril_event_add(&idle[i].ev);
+    }
+
+    // Timers cannot be cancelled, so they are parked an hour out in a pool
+    // that outlives each run (armedTimers must not decrease between runs);
+    // every wakeup still has to compute its timeout from the heap.
+    static struct ril_event timers[BENCH_MAX_TIMERS];
+    static int parked = 0;
+    for (; parked < armedTimers; parked++) {
+        struct timeval tv = { 3600 + parked, 0 };
+        ril_event_set(&timers[parked], -1, false, timerCb, NULL);
+        ril_timer_add(&timers[parked], &tv);
+    }
+
+    probe.received = 0;
+    probe.samples.reserve(rounds);
+    if (pipe(probe.fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    ril_event_set(&probe.ev, probe.fds[0], true, probeCb, &probe);
+    ril_event_add(&probe.ev);
+
+    for (int i = 0; i < rounds; i++) {
+        char c = 'p';
+        if (armedTimers > 0) {
+            // keep the heap moving the way re-armed wake timeouts do
+            struct timeval tv = { 3600 + (i * 7919) % armedTimers, 0 };
+            ril_timer_add(&timers[i % armedTimers], &tv);
+        }
+        pthread_mutex_lock(&s_mutex);
+        probe.sentNs = nowNs();
+        pthread_mutex_unlock(&s_mutex);
+        if (write(probe.fds[1], &c, 1) != 1) {
+            perror("write");
+            break;
+        }
+        waitFor(&probe.received, i + 1, 1000);
+    }
+
+    ril_event_del(&probe.ev);
+    close(probe.fds[0]);
+    close(probe.fds[1]);
+    for (int i = 0; i < idleWatches; i++) {
+        ril_event_del(&idle[i].ev);
+        closeWatch(&idle[i]);
+    }
+
+    std::vector<long long> &s = probe.samples;
+    if (s.empty()) {
+        printf("%6d idle fds %6d timers: no samples\n", idleWatches, armedTimers);
+        return;
+    }
+    std::sort(s.begin(), s.end());
+    printf("%6d idle fds %6d timers: %zu wakeups  p50 %6.1f us  p99 %7.1f us  max %8.1f us\n",
+            idleWatches, armedTimers, s.size(), s[s.size() / 2] / 1000.0,
+            s[s.size() * 99 / 100] / 1000.0, s.back() / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    bool bench = false;
+    int opt;
+    pthread_t loop;
+
+    while ((opt = getopt(argc, argv, "b")) != -1) {
+        switch (opt) {
+            case 'b':
+                bench = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    ril_event_init();
+    if (pthread_create(&loop, NULL, loopThread, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+    pthread_detach(loop);
+
+    if (bench) {
+        const int idle[] = { 0, 16, 128, 480 };
+        const int timers[] = { 0, 64, 1024 };
+        for (size_t t = 0; t < sizeof(timers) / sizeof(timers[0]); t++) {
+            for (size_t i = 0; i < sizeof(idle) / sizeof(idle[0]); i++) {
+                benchDispatch(idle[i], timers[t], 5000);
+            }
+        }
+        return 0;
+    }
+
+    testWatches();
+    testManyWatches();
+    testTimers();
+    testRemovedAfterWait();
+
+    if (gFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
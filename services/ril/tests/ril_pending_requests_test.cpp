@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Stress test for libril's pending request table and RequestInfo pool.
+ *
+ * Several threads keep thousands of tokens outstanding at once against one
+ * shared table, completing them in random order, while checking that every
+ * live token is found exactly once, completed tokens are rejected, cancelled
+ * requests are counted apart from completed ones and the pool recycles
+ * entries instead of growing, but not so soon that a stale token matches a
+ * newer request.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <set>
+#include <vector>
+
+#include <telephony/ril.h>
+#include <utils/Log2.h>
+
+namespace android {
+
+class Parcel;
+
+// Mirrors the fields of ril.cpp's CommandInfo/RequestInfo the table uses
+typedef struct {
+    int requestNumber;
+} CommandInfo;
+
+typedef struct RequestInfo {
+    int32_t token;
+    CommandInfo *pCI;
+    struct RequestInfo *p_next;
+    char cancelled;
+    int64_t dispatchTimeNs;
+} RequestInfo;
+
+#include "ril_pending_requests.h"
+
+}  // namespace android
+
+using namespace android;
+
+#define NUM_REQUEST_CODES 8
+#define NUM_THREADS 8
+#define OUTSTANDING_PER_THREAD 1024
+#define REQUESTS_PER_THREAD 50000
+
+static int gFailures = 0;
+static pthread_mutex_t s_failMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            pthread_mutex_lock(&s_failMutex); \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++; \
+            pthread_mutex_unlock(&s_failMutex); \
+        } \
+    } while (0)
+
+static CommandInfo s_commands[NUM_REQUEST_CODES];
+static RequestStats s_stats[NUM_REQUEST_CODES];
+
+static pthread_mutex_t s_pendingMutex = PTHREAD_MUTEX_INITIALIZER;
+static PendingRequests s_pending = {NULL, 0, 0};
+
+static pthread_mutex_t s_seenMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::set<RequestInfo *> s_seen;
+
+static RequestInfo *dispatch(int request, int32_t token) {
+    RequestInfo *pRI = allocRequestInfo();
+    if (pRI == NULL) {
+        return NULL;
+    }
+    pRI->token = token;
+    pRI->pCI = &s_commands[request];
+    pRI->dispatchTimeNs = monotonicTimeNs();
+
+    pthread_mutex_lock(&s_pendingMutex);
+    bool added = addPendingRequest(&s_pending, pRI);
+    pthread_mutex_unlock(&s_pendingMutex);
+    if (!added) {
+        releaseRequestInfo(pRI);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&s_seenMutex);
+    s_seen.insert(pRI);
+    pthread_mutex_unlock(&s_seenMutex);
+    return pRI;
+}
+
+// Same sequence as checkAndDequeueRequestInfoIfAck() + RIL_onRequestComplete()
+static bool complete(RequestInfo *pRI) {
+    pthread_mutex_lock(&s_pendingMutex);
+    RequestInfo **ppCur = findPendingRequest(&s_pending, pRI);
+    if (ppCur != NULL) {
+        removePendingRequest(&s_pending, ppCur);
+    }
+    pthread_mutex_unlock(&s_pendingMutex);
+    if (ppCur == NULL) {
+        return false;
+    }
+
+    recordRequestStats(s_stats, NUM_REQUEST_CODES, pRI);
+    releaseRequestInfo(pRI);
+    return true;
+}
+
+struct Worker {
+    pthread_t thread;
+    unsigned seed;
+    int index;
+    int completed;
+};
+
+static void *workerMain(void *arg) {
+    Worker *w = (Worker *)arg;
+    std::vector<RequestInfo *> live;
+    std::vector<int32_t> tokens;
+    int32_t nextToken = w->index << 24;
+
+    live.reserve(OUTSTANDING_PER_THREAD);
+    for (int issued = 0; issued < REQUESTS_PER_THREAD || !live.empty(); ) {
+        bool issue = issued < REQUESTS_PER_THREAD
+                && (live.size() < OUTSTANDING_PER_THREAD / 2
+                    || (live.size() < OUTSTANDING_PER_THREAD && rand_r(&w->seed) % 2 == 0));
+        if (issue) {
+            RequestInfo *pRI = dispatch(rand_r(&w->seed) % NUM_REQUEST_CODES, nextToken);
+            CHECK(pRI != NULL);
+            if (pRI != NULL) {
+                live.push_back(pRI);
+                tokens.push_back(nextToken);
+            }
+            nextToken++;
+            issued++;
+            continue;
+        }
+
+        // Complete a random outstanding request, then check it is gone
+        size_t pick = rand_r(&w->seed) % live.size();
+        RequestInfo *pRI = live[pick];
+        CHECK(pRI->token == tokens[pick]);
+        live[pick] = live.back();
+        live.pop_back();
+        tokens[pick] = tokens.back();
+        tokens.pop_back();
+
+        CHECK(complete(pRI));
+        w->completed++;
+    }
+    return NULL;
+}
+
+static void testConcurrentTokens() {
+    Worker workers[NUM_THREADS];
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        workers[i].seed = 0x5eed + i;
+        workers[i].index = i + 1;
+        workers[i].completed = 0;
+        pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]);
+    }
+
+    uint32_t total = 0;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(workers[i].thread, NULL);
+        total += workers[i].completed;
+    }
+
+    CHECK(total == NUM_THREADS * REQUESTS_PER_THREAD);
+    CHECK(s_pending.count == 0);
+    for (size_t i = 0; i < s_pending.numBuckets; i++) {
+        CHECK(s_pending.buckets[i] == NULL);
+    }
+    // Grown to hold every outstanding token with a load factor <= 1
+    CHECK(s_pending.numBuckets >= NUM_THREADS * OUTSTANDING_PER_THREAD / 2);
+
+    uint32_t completed = 0;
+    for (int i = 0; i < NUM_REQUEST_CODES; i++) {
+        completed += s_stats[i].completed;
+        CHECK(s_stats[i].cancelled == 0);
+    }
+    CHECK(completed == total);
+
+    // Entries are recycled: the pool never holds much more than the peak
+    // number of outstanding requests, far fewer than were dispatched
+    size_t distinct = s_seen.size();
+    printf("%u requests through %zu pooled RequestInfos, %zu buckets\n",
+            total, distinct, s_pending.numBuckets);
+    CHECK(distinct <= (size_t)NUM_THREADS * (OUTSTANDING_PER_THREAD + REQUEST_INFO_POOL_CHUNK));
+}
+
+static void testInvalidTokens() {
+    RequestInfo *pRI = dispatch(1, 1);
+    CHECK(pRI != NULL);
+    CHECK(complete(pRI));
+
+    // Stale token: its RequestInfo is back in the pool, not in the table
+    pthread_mutex_lock(&s_pendingMutex);
+    CHECK(findPendingRequest(&s_pending, pRI) == NULL);
+    pthread_mutex_unlock(&s_pendingMutex);
+
+    RequestInfo bogus;
+    memset(&bogus, 0, sizeof(bogus));
+    pthread_mutex_lock(&s_pendingMutex);
+    CHECK(findPendingRequest(&s_pending, &bogus) == NULL);
+    pthread_mutex_unlock(&s_pendingMutex);
+}
+
+// A duplicate or late completion of a finished request, issued while newer
+// requests are dispatched and completed one at a time, matches none of them
+static void testStaleTokenNotReused() {
+    RequestInfo *stale = dispatch(3, 100);
+    CHECK(stale != NULL);
+    CHECK(complete(stale));
+
+    for (int i = 0; i < REQUEST_INFO_REUSE_DELAY; i++) {
+        RequestInfo *pRI = dispatch(3, 101 + i);
+        CHECK(pRI != NULL && pRI != stale);
+        CHECK(!complete(stale));
+        CHECK(pRI->token == 101 + i);
+        CHECK(complete(pRI));
+    }
+}
+
+static void testCancelledCountedSeparately() {
+    const int count = 3000;
+    std::vector<RequestInfo *> reqs;
+    RequestStats before = s_stats[2];
+
+    for (int i = 0; i < count; i++) {
+        reqs.push_back(dispatch(2, i));
+    }
+
+    // What onCommandsSocketClosed() does for the first half
+    pthread_mutex_lock(&s_pendingMutex);
+    for (int i = 0; i < count / 2; i++) {
+        reqs[i]->cancelled = 1;
+    }
+    pthread_mutex_unlock(&s_pendingMutex);
+
+    for (int i = count - 1; i >= 0; i--) {
+        CHECK(complete(reqs[i]));
+    }
+
+    CHECK(s_stats[2].cancelled - before.cancelled == (uint32_t)count / 2);
+    CHECK(s_stats[2].completed - before.completed == (uint32_t)(count - count / 2));
+}
+
+int main() {
+    for (int i = 0; i < NUM_REQUEST_CODES; i++) {
+        s_commands[i].requestNumber = i;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    testConcurrentTokens();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("concurrent tokens: %.1f ms\n",
+            (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    testInvalidTokens();
+    testStaleTokenNotReused();
+    testCancelledCountedSeparately();
+
+    if (gFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following
+ *   disclaimer in the documentation and/or other materials provided
+ *   with the distribution.
+ * * Neither the name of The Linux Foundation nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ *   WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ *   ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *   BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ *   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ *   OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ *   IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Socketpair tests and benchmark for libril's response framing: the
+ * unsolicited response coalescing queue and ordered direct sends from
+ * ril_response_queue.h, read back through librilutils' record_stream.
+ *
+ *   ril_response_queue_test        run the unit tests
+ *   ril_response_queue_test -b     run the socketpair benchmark
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <telephony/ril.h>
+#include <telephony/record_stream.h>
+#include <utils/Log2.h>
+
+// match with ril.cpp
+#define MAX_COMMAND_BYTES (8 * 1024)
+
+static int gFailures = 0;
+static pthread_mutex_t s_failMutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            pthread_mutex_lock(&s_failMutex); \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++; \
+            pthread_mutex_unlock(&s_failMutex); \
+        } \
+    } while (0)
+
+/* Stand-in for the per-socket command fd and write mutex of ril.cpp */
+static int s_fdCommand = -1;
+static pthread_mutex_t s_writeMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Lets a test hold the next write until it is released */
+static pthread_mutex_t s_gateMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_gateCond = PTHREAD_COND_INITIALIZER;
+static bool s_gateArmed = false;
+static bool s_gateEntered = false;
+static int s_writeCalls = 0;
+
+static void waitAtGate() {
+    pthread_mutex_lock(&s_gateMutex);
+    s_writeCalls++;
+    if (s_gateArmed) {
+        s_gateEntered = true;
+        pthread_cond_broadcast(&s_gateCond);
+        while (s_gateArmed) {
+            pthread_cond_wait(&s_gateCond, &s_gateMutex);
+        }
+    }
+    pthread_mutex_unlock(&s_gateMutex);
+}
+
+static int
+writeResponseRaw (struct iovec *iov, int iovcnt, RIL_SOCKET_ID) {
+    int ret = 0;
+
+    waitAtGate();
+
+    pthread_mutex_lock(&s_writeMutex);
+    if (s_fdCommand < 0) {
+        pthread_mutex_unlock(&s_writeMutex);
+        return -1;
+    }
+    while (iovcnt > 0) {
+        ssize_t written = writev(s_fdCommand, iov, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    pthread_mutex_unlock(&s_writeMutex);
+    return ret;
+}
+
+#include "ril_response_queue.h"
+
+static UnsolResponseQueue s_queue;
+
+/* Same framing as ril.cpp's sendResponseRaw() with coalescing enabled */
+static int sendOrdered(const void *data, size_t dataSize) {
+    uint32_t header = htonl(dataSize);
+    struct iovec iov[2];
+
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<void *>(data);
+    iov[1].iov_len = dataSize;
+    return writeResponseOrdered(&s_queue, iov, 2, RIL_SOCKET_1);
+}
+
+static int sendQueued(const void *data, size_t dataSize) {
+    return queueResponseRaw(&s_queue, data, dataSize, RIL_SOCKET_1);
+}
+
+static void openPair(int fds[2]) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    s_fdCommand = fds[0];
+}
+
+static void closePair(int fds[2]) {
+    pthread_mutex_lock(&s_writeMutex);
+    s_fdCommand = -1;
+    pthread_mutex_unlock(&s_writeMutex);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/* Blocking read of the next record; returns false at end of stream */
+static bool nextRecord(RecordStream *rs, void **record, size_t *len) {
+    for (;;) {
+        int ret = record_stream_get_next(rs, record, len);
+        if (ret == 0) {
+            return *record != NULL;
+        }
+        if (errno != EAGAIN && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void testRecordStream() {
+    int fds[2];
+    RecordStream *rs;
+    void *record;
+    size_t len;
+    std::vector<uint8_t> big(MAX_COMMAND_BYTES, 0xa5);
+
+    openPair(fds);
+    rs = record_stream_new(fds[1], MAX_COMMAND_BYTES);
+
+    // Several records in one write, as a coalesced flush produces them
+    ResponseBuffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    CHECK(appendResponseBuffer(&buffer, "one", 3) == 0);
+    CHECK(appendResponseBuffer(&buffer, "", 0) == 0);
+    CHECK(appendResponseBuffer(&buffer, "three", 5) == 0);
+    CHECK(write(fds[0], buffer.data, buffer.size) == (ssize_t)buffer.size);
+    free(buffer.data);
+
+    CHECK(nextRecord(rs, &record, &len) && len == 3 && memcmp(record, "one", 3) == 0);
+    CHECK(nextRecord(rs, &record, &len) && len == 0);
+    CHECK(nextRecord(rs, &record, &len) && len == 5 && memcmp(record, "three", 5) == 0);
+
+    // A maximum size record split at every byte
+    uint32_t header = htonl(big.size());
+    std::vector<uint8_t> frame((uint8_t *)&header, (uint8_t *)&header + sizeof(header));
+    frame.insert(frame.end(), big.begin(), big.end());
+    size_t fed = 0;
+    int again = 0;
+    while (fed < frame.size()) {
+        CHECK(write(fds[0], &frame[fed], 1) == 1);
+        fed++;
+        int ret = record_stream_get_next(rs, &record, &len);
+        if (fed < frame.size()) {
+            if (ret == -1 && errno == EAGAIN) {
+                again++;
+            }
+        } else {
+            CHECK(ret == 0 && len == big.size());
+            CHECK(record != NULL && memcmp(record, big.data(), big.size()) == 0);
+        }
+    }
+    CHECK(again == (int)frame.size() - 1);
+
+    // End of stream
+    shutdown(fds[0], SHUT_WR);
+    CHECK(!nextRecord(rs, &record, &len));
+
+    record_stream_free(rs);
+    closePair(fds);
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct Frame {
+    uint32_t thread;
+    uint32_t seq;
+    uint32_t solicited;
+};
+
+#define ORDER_THREADS 4
+#define ORDER_FRAMES 20000
+
+static void *orderProducer(void *arg) {
+    uint32_t thread = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t seq = 0; seq < ORDER_FRAMES; seq++) {
+        Frame f = { thread, seq, (seq % 7) == 6 };
+        int ret = f.solicited ? sendOrdered(&f, sizeof(f)) : sendQueued(&f, sizeof(f));
+        CHECK(ret == 0 || (!f.solicited && ret == SEND_QUEUED));
+    }
+    return NULL;
+}
+
+/*
+ * Each producer interleaves queued (unsolicited) and ordered (solicited)
+ * responses; the client must see every thread's responses in the order
+ * that thread sent them, so a solicited response never overtakes an
+ * unsolicited one still sitting in the queue.
+ */
+static void testOrdering() {
+    int fds[2];
+    pthread_t producers[ORDER_THREADS];
+    uint32_t expected[ORDER_THREADS] = { 0 };
+    RecordStream *rs;
+    void *record;
+    size_t len;
+    int outOfOrder = 0;
+
+    openPair(fds);
+    rs = record_stream_new(fds[1], MAX_COMMAND_BYTES);
+
+    for (uintptr_t i = 0; i < ORDER_THREADS; i++) {
+        pthread_create(&producers[i], NULL, orderProducer, (void *)i);
+    }
+
+    for (int n = 0; n < ORDER_THREADS * ORDER_FRAMES; n++) {
+        if (!nextRecord(rs, &record, &len) || len != sizeof(Frame)) {
+            CHECK(false);
+            break;
+        }
+        Frame f;
+        memcpy(&f, record, sizeof(f));
+        if (f.thread >= ORDER_THREADS || f.seq != expected[f.thread]) {
+            outOfOrder++;
+        }
+        if (f.thread < ORDER_THREADS) {
+            expected[f.thread] = f.seq + 1;
+        }
+    }
+
+    for (int i = 0; i < ORDER_THREADS; i++) {
+        pthread_join(producers[i], NULL);
+        CHECK(expected[i] == ORDER_FRAMES);
+    }
+    CHECK(outOfOrder == 0);
+
+    record_stream_free(rs);
+    closePair(fds);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void armGate() {
+    pthread_mutex_lock(&s_gateMutex);
+    s_gateArmed = true;
+    s_gateEntered = false;
+    pthread_mutex_unlock(&s_gateMutex);
+}
+
+static void waitGateEntered() {
+    pthread_mutex_lock(&s_gateMutex);
+    while (!s_gateEntered) {
+        pthread_cond_wait(&s_gateCond, &s_gateMutex);
+    }
+    pthread_mutex_unlock(&s_gateMutex);
+}
+
+static void releaseGate() {
+    pthread_mutex_lock(&s_gateMutex);
+    s_gateArmed = false;
+    pthread_cond_broadcast(&s_gateCond);
+    pthread_mutex_unlock(&s_gateMutex);
+}
+
+static int s_writerResult;
+static int s_orderedResult;
+
+static void *gatedWriter(void *) {
+    s_writerResult = sendQueued("first", 5);
+    return NULL;
+}
+
+static void *orderedSender(void *) {
+    s_orderedResult = sendOrdered("solicited", 9);
+    return NULL;
+}
+
+static void testSendStatus() {
+    int fds[2];
+    pthread_t writer, ordered;
+    RecordStream *rs;
+    void *record;
+    size_t len;
+
+    openPair(fds);
+    rs = record_stream_new(fds[1], MAX_COMMAND_BYTES);
+
+    // Hold the writer inside its write; others queue behind it
+    pthread_mutex_lock(&s_gateMutex);
+    s_writeCalls = 0;
+    pthread_mutex_unlock(&s_gateMutex);
+    armGate();
+    pthread_create(&writer, NULL, gatedWriter, NULL);
+    waitGateEntered();
+
+    CHECK(sendQueued("second", 6) == SEND_QUEUED);
+    pthread_create(&ordered, NULL, orderedSender, NULL);
+    usleep(20 * 1000);
+    // The ordered send waits for the writer rather than jumping the queue
+    pthread_mutex_lock(&s_gateMutex);
+    CHECK(s_writeCalls == 1);
+    pthread_mutex_unlock(&s_gateMutex);
+
+    releaseGate();
+    pthread_join(writer, NULL);
+    pthread_join(ordered, NULL);
+    CHECK(s_writerResult == 0);
+    CHECK(s_orderedResult == 0);
+
+    CHECK(nextRecord(rs, &record, &len) && len == 5 && memcmp(record, "first", 5) == 0);
+    CHECK(nextRecord(rs, &record, &len) && len == 6 && memcmp(record, "second", 6) == 0);
+    CHECK(nextRecord(rs, &record, &len) && len == 9 && memcmp(record, "solicited", 9) == 0);
+
+    // With the client gone the ordered send reports the failure, which is
+    // what the NITZ retry in RIL_onUnsolicitedResponse() relies on
+    record_stream_free(rs);
+    closePair(fds);
+    CHECK(sendOrdered("nitz", 4) < 0);
+    CHECK(sendQueued("nitz", 4) < 0);
+}
+
+/* ---------------------------------------------------------------------- */
+
+enum BenchMode { BENCH_TWO_WRITES, BENCH_WRITEV, BENCH_COALESCED };
+
+static const char *benchModeName[] = { "write x2", "writev", "coalesced" };
+
+struct BenchArgs {
+    BenchMode mode;
+    int count;
+    size_t size;
+};
+
+static bool writeAll(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len > 0) {
+        ssize_t written = write(fd, p, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        len -= written;
+    }
+    return true;
+}
+
+/* The framing libril used before writev: header and payload separately */
+static int sendTwoWrites(const void *data, size_t dataSize) {
+    uint32_t header = htonl(dataSize);
+    int ret = 0;
+
+    waitAtGate();
+    pthread_mutex_lock(&s_gateMutex);
+    s_writeCalls++;     // two syscalls per response
+    pthread_mutex_unlock(&s_gateMutex);
+
+    pthread_mutex_lock(&s_writeMutex);
+    if (!writeAll(s_fdCommand, &header, sizeof(header))
+            || !writeAll(s_fdCommand, data, dataSize)) {
+        ret = -1;
+    }
+    pthread_mutex_unlock(&s_writeMutex);
+    return ret;
+}
+
+static void *benchProducer(void *arg) {
+    BenchArgs *a = (BenchArgs *)arg;
+    std::vector<uint8_t> payload(a->size, 0x5a);
+
+    for (int i = 0; i < a->count; i++) {
+        switch (a->mode) {
+            case BENCH_TWO_WRITES:
+                sendTwoWrites(payload.data(), payload.size());
+                break;
+            case BENCH_WRITEV:
+                sendOrdered(payload.data(), payload.size());
+                break;
+            case BENCH_COALESCED:
+                sendQueued(payload.data(), payload.size());
+                break;
+        }
+    }
+    return NULL;
+}
+
+static double elapsedMs(const struct timespec &start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void benchSocketpair(BenchMode mode, int threads, size_t size) {
+    const int perThread = 20000;
+    int fds[2];
+    std::vector<pthread_t> producers(threads);
+    BenchArgs args = { mode, perThread, size };
+    RecordStream *rs;
+    void *record;
+    size_t len;
+    struct timespec start;
+    int received = 0;
+
+    openPair(fds);
+    rs = record_stream_new(fds[1], MAX_COMMAND_BYTES);
+    pthread_mutex_lock(&s_gateMutex);
+    s_writeCalls = 0;
+    pthread_mutex_unlock(&s_gateMutex);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&producers[i], NULL, benchProducer, &args);
+    }
+    while (received < threads * perThread && nextRecord(rs, &record, &len)) {
+        received++;
+    }
+    double ms = elapsedMs(start);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(producers[i], NULL);
+    }
+
+    printf("%-10s %d thread(s) %5zu B: %7d responses in %7.1f ms  %6.0f k/s  %7d syscalls\n",
+            benchModeName[mode], threads, size, received, ms, received / ms,
+            s_writeCalls);
+
+    record_stream_free(rs);
+    closePair(fds);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    bool bench = false;
+
+    while ((opt = getopt(argc, argv, "b")) != -1) {
+        switch (opt) {
+            case 'b':
+                bench = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    // writes to a closed client must fail with EPIPE, not kill the test
+    signal(SIGPIPE, SIG_IGN);
+    initResponseQueue(&s_queue);
+
+    if (bench) {
+        const size_t sizes[] = { 64, 1024 };
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            for (int threads = 1; threads <= 4; threads *= 4) {
+                benchSocketpair(BENCH_TWO_WRITES, threads, sizes[s]);
+                benchSocketpair(BENCH_WRITEV, threads, sizes[s]);
+                benchSocketpair(BENCH_COALESCED, threads, sizes[s]);
+            }
+        }
+        return 0;
+    }
+
+    testRecordStream();
+    testOrdering();
+    testSendStatus();
+
+    if (gFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}